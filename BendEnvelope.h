@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include "CurveTable.h"
+#include "CurveTableCache.h"
+
+// A bend as a chain of breakpoint segments. Each segment moves from the level the one
+// before it ended on (0 for the first) to its own level over its own time, along its own
+// curve; levels are fractions of the bend target. The first segment is the rise itself:
+// it takes the zone's bend time and curve table, so tempo sync, morph and curve automation
+// keep working on it, and an envelope of that segment alone is the plain bend. Built on the
+// message thread, with curve tables from the shared cache, and swapped in whole by
+// processBlock.
+struct BendEnvelope
+{
+    static constexpr int maxSegments = 8;
+
+    struct Segment
+    {
+        float seconds = 0.0f; // Unused for the first segment
+        float level = 1.0f;
+        CurveTableCache::Table shape; // Unused for the first segment
+    };
+
+    std::array<Segment, maxSegments> segments;
+    int numSegments = 1;
+
+    // Back to the plain rise to the target, letting go of the segments' tables
+    void clear()
+    {
+        for (auto &segment : segments)
+            segment.shape.reset();
+
+        segments[0].level = 1.0f;
+        numSegments = 1;
+    }
+
+    void addSegment(float seconds, float level, float curve)
+    {
+        assert(numSegments < maxSegments);
+
+        auto &segment = segments[static_cast<size_t>(numSegments++)];
+        segment.seconds = seconds;
+        segment.level = level;
+        segment.shape = CurveTableCache::get(curve);
+    }
+
+    float startLevel(int segment) const
+    {
+        return segment == 0 ? 0.0f : segments[static_cast<size_t>(segment - 1)].level;
+    }
+
+    // Segment boundaries in samples for one bend time, so a voice only has to compare its
+    // elapsed time against the segment it is in and the next
+    struct Timing
+    {
+        std::array<float, maxSegments + 1> starts{}; // starts[numSegments] is the end
+        std::array<float, maxSegments> lengths{};
+    };
+
+    void computeTiming(std::int64_t durationInSamples, double sampleRate, Timing &timing) const
+    {
+        timing.lengths[0] = static_cast<float>(durationInSamples);
+
+        for (int i = 1; i < numSegments; ++i)
+            timing.lengths[static_cast<size_t>(i)] = std::max(1.0f, static_cast<float>(segments[static_cast<size_t>(i)].seconds * sampleRate));
+
+        for (int i = 0; i < numSegments; ++i)
+            timing.starts[static_cast<size_t>(i + 1)] = timing.starts[static_cast<size_t>(i)] + timing.lengths[static_cast<size_t>(i)];
+    }
+
+    // Moves segment to the one holding elapsed. Voices step forward one boundary at a
+    // time, so this is constant work per update; it only walks back if the bend time shrank.
+    int findSegment(const Timing &timing, float elapsed, int segment) const
+    {
+        while (segment < numSegments - 1 && elapsed >= timing.starts[static_cast<size_t>(segment + 1)])
+            ++segment;
+
+        while (segment > 0 && elapsed < timing.starts[static_cast<size_t>(segment)])
+            --segment;
+
+        return segment;
+    }
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// Alignment that keeps state written by different threads on different cache lines. 64 bytes
+// on x86 and most ARM cores; std::hardware_destructive_interference_size would say the same
+// but is missing from some of the standard libraries the plugin builds with.
+inline constexpr std::size_t cacheLineSize = 64;
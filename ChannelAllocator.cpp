@@ -0,0 +1,359 @@
+#include "ChannelAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+ChannelAllocator::ChannelAllocator()
+{
+    setZone(2, 14);
+}
+
+void ChannelAllocator::setZone(int firstChannel, int numChannels)
+{
+    assert(firstChannel >= 1 && numChannels >= 1 && firstChannel + numChannels - 1 <= 16);
+
+    zoneMask = ((1u << numChannels) - 1u) << (firstChannel - 1);
+    zoneSize = numChannels;
+    reset();
+}
+
+void ChannelAllocator::resize(int numChannels)
+{
+    auto firstChannel = lowestSetBit(zoneMask) + 1;
+    assert(numChannels >= 1 && firstChannel + numChannels - 1 <= 16);
+
+    zoneMask = ((1u << numChannels) - 1u) << (firstChannel - 1);
+    zoneSize = numChannels;
+
+    if (sharedPool != nullptr)
+        sharedPool->fetch_and(~(busyMask & ~zoneMask), std::memory_order_release);
+
+    busyMask &= zoneMask;
+    releasingMask &= zoneMask;
+    rebuildFreeQueue();
+    rebuildNoteIndex();
+}
+
+void ChannelAllocator::setRotation(Rotation newRotation)
+{
+    if (rotation == newRotation)
+        return;
+
+    rotation = newRotation;
+    rebuildFreeQueue();
+}
+
+void ChannelAllocator::reset()
+{
+    if (sharedPool != nullptr)
+        sharedPool->fetch_and(~busyMask, std::memory_order_release);
+
+    busyMask = 0;
+    releasingMask = 0;
+    rebuildFreeQueue();
+    rebuildNoteIndex();
+}
+
+void ChannelAllocator::setSharedPool(std::atomic<std::uint32_t> *newPool)
+{
+    if (sharedPool == newPool)
+        return;
+
+    reset();
+    sharedPool = newPool;
+}
+
+void ChannelAllocator::rebuildFreeQueue()
+{
+    freeHead = 0;
+    numQueued = 0;
+
+    for (auto mask = zoneMask & ~busyMask; mask != 0; mask &= mask - 1)
+        pushFree(lowestSetBit(mask) + 1);
+}
+
+void ChannelAllocator::pushFree(int channel)
+{
+    assert(numQueued < static_cast<int>(freeQueue.size()));
+
+    freeQueue[static_cast<size_t>((freeHead + numQueued) & 15)] = static_cast<std::uint8_t>(channel);
+    ++numQueued;
+}
+
+int ChannelAllocator::popFree()
+{
+    assert(numQueued > 0);
+
+    int channel = freeQueue[static_cast<size_t>(freeHead)];
+    freeHead = (freeHead + 1) & 15;
+    --numQueued;
+    return channel;
+}
+
+std::array<std::uint8_t, 16> ChannelAllocator::getFreeOrder() const
+{
+    std::array<std::uint8_t, 16> order{};
+
+    if (rotation == Rotation::leastRecentlyUsed)
+        for (int i = 0; i < numQueued; ++i)
+            order[static_cast<size_t>(i)] = freeQueue[static_cast<size_t>((freeHead + i) & 15)];
+
+    return order;
+}
+
+void ChannelAllocator::setFreeOrder(const std::array<std::uint8_t, 16> &order)
+{
+    if (rotation != Rotation::leastRecentlyUsed)
+        return;
+
+    freeHead = 0;
+    numQueued = 0;
+
+    for (auto channel : order)
+        if (channel != 0 && (zoneMask & ~busyMask & (1u << (channel - 1))) != 0)
+            pushFree(channel);
+}
+
+int ChannelAllocator::takeFree(std::uint32_t freeMask)
+{
+    if (sharedPool == nullptr)
+    {
+        if (freeMask == 0)
+            return 0;
+
+        return rotation == Rotation::leastRecentlyUsed ? popFree() : lowestSetBit(freeMask) + 1;
+    }
+
+    // A channel another instance holds stays in the queue, in its place
+    auto pool = sharedPool->load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        auto available = freeMask & ~pool;
+        if (available == 0)
+            return 0;
+
+        int channel = lowestSetBit(available) + 1;
+        int position = 0;
+
+        if (rotation == Rotation::leastRecentlyUsed)
+        {
+            while (((available >> (freeQueue[static_cast<size_t>((freeHead + position) & 15)] - 1)) & 1u) == 0)
+                ++position;
+
+            channel = freeQueue[static_cast<size_t>((freeHead + position) & 15)];
+        }
+
+        if (!sharedPool->compare_exchange_weak(pool, pool | (1u << (channel - 1)), std::memory_order_acquire, std::memory_order_relaxed))
+            continue;
+
+        if (rotation == Rotation::leastRecentlyUsed)
+        {
+            for (; position > 0; --position)
+                freeQueue[static_cast<size_t>((freeHead + position) & 15)] = freeQueue[static_cast<size_t>((freeHead + position - 1) & 15)];
+
+            popFree();
+        }
+
+        return channel;
+    }
+}
+
+int ChannelAllocator::allocate(int noteNumber, int velocity, bool &wasStolen)
+{
+    auto channel = takeFree(zoneMask & ~busyMask);
+
+    wasStolen = channel == 0;
+
+    if (wasStolen)
+    {
+        if ((busyMask & zoneMask) == 0 || ranksBelowHeld(noteNumber))
+        {
+            wasStolen = false;
+            return 0;
+        }
+
+        channel = chooseVictim(noteNumber);
+    }
+
+    claim(channel, noteNumber, velocity);
+    return channel;
+}
+
+int ChannelAllocator::allocateChord(const int *noteNumbers, int numNotes, int velocity, int *channels, std::uint32_t &stolenMask)
+{
+    auto freeMask = zoneMask & ~busyMask;
+    std::uint32_t chordMask = 0;
+
+    numNotes = std::min(numNotes, zoneSize);
+    stolenMask = 0;
+
+    for (int i = 0; i < numNotes; ++i)
+    {
+        auto channel = takeFree(freeMask);
+
+        if (channel != 0)
+        {
+            freeMask &= ~(1u << (channel - 1));
+        }
+        else if ((busyMask & zoneMask & ~chordMask) != 0)
+        {
+            channel = chooseVictim(noteNumbers[i], chordMask);
+            stolenMask |= 1u << (channel - 1);
+        }
+        else
+        {
+            return i;
+        }
+
+        claim(channel, noteNumbers[i], velocity);
+        chordMask |= 1u << (channel - 1);
+        channels[i] = channel;
+    }
+
+    return numNotes;
+}
+
+void ChannelAllocator::claim(int channel, int noteNumber, int velocity)
+{
+    auto index = static_cast<size_t>(channel - 1);
+
+    if ((busyMask >> index) & 1u)
+        forgetNote(channel);
+
+    notesHeld[static_cast<size_t>(noteNumber >> 6)] |= std::uint64_t{1} << (noteNumber & 63);
+    channelsOnNote[static_cast<size_t>(noteNumber)] |= static_cast<std::uint16_t>(1u << index);
+    busyMask |= 1u << index;
+    releasingMask &= ~(1u << index);
+    startOrder[index] = allocationCounter++;
+    noteOnChannel[index] = static_cast<std::uint8_t>(noteNumber);
+    velocityOnChannel[index] = static_cast<std::uint8_t>(velocity);
+}
+
+void ChannelAllocator::release(int channel)
+{
+    auto bit = 1u << (channel - 1);
+
+    if ((busyMask & bit) == 0)
+        return;
+
+    forgetNote(channel);
+    busyMask &= ~bit;
+    releasingMask &= ~bit;
+
+    if (sharedPool != nullptr)
+        sharedPool->fetch_and(~bit, std::memory_order_release);
+
+    if (rotation == Rotation::leastRecentlyUsed)
+        pushFree(channel);
+}
+
+void ChannelAllocator::setReleasing(int channel)
+{
+    releasingMask |= busyMask & (1u << (channel - 1));
+}
+
+int ChannelAllocator::chooseVictim(int noteNumber, std::uint32_t excluded) const
+{
+    int oldest = -1;
+    int quietest = -1;
+
+    // Voices that are only releasing go first, by the same policy
+    auto stealable = busyMask & zoneMask & ~excluded;
+    auto candidates = stealable & releasingMask;
+
+    if (candidates == 0)
+    {
+        if (notePriority != NotePriority::last)
+            return chooseByPriority(stealable);
+
+        candidates = stealable;
+    }
+
+    for (auto mask = candidates; mask != 0; mask &= mask - 1)
+    {
+        auto index = lowestSetBit(mask);
+        auto i = static_cast<size_t>(index);
+
+        if (stealPolicy == StealPolicy::sameNote && noteOnChannel[i] == noteNumber)
+            return index + 1;
+
+        // Counter difference keeps the ordering correct across wrap-around
+        if (oldest < 0 || static_cast<std::int32_t>(startOrder[i] - startOrder[static_cast<size_t>(oldest)]) < 0)
+            oldest = index;
+
+        if (quietest < 0 || velocityOnChannel[i] < velocityOnChannel[static_cast<size_t>(quietest)])
+            quietest = index;
+    }
+
+    assert(oldest >= 0);
+
+    return (stealPolicy == StealPolicy::quietest ? quietest : oldest) + 1;
+}
+
+void ChannelAllocator::forgetNote(int channel)
+{
+    auto note = static_cast<size_t>(noteOnChannel[static_cast<size_t>(channel - 1)]);
+    auto &channels = channelsOnNote[note];
+    channels = static_cast<std::uint16_t>(channels & ~(1u << (channel - 1)));
+
+    if (channels == 0)
+        notesHeld[note >> 6] &= ~(std::uint64_t{1} << (note & 63));
+}
+
+void ChannelAllocator::rebuildNoteIndex()
+{
+    notesHeld = {};
+    channelsOnNote = {};
+
+    for (auto mask = busyMask; mask != 0; mask &= mask - 1)
+    {
+        auto index = lowestSetBit(mask);
+        auto note = noteOnChannel[static_cast<size_t>(index)];
+        notesHeld[static_cast<size_t>(note >> 6)] |= std::uint64_t{1} << (note & 63);
+        channelsOnNote[note] = static_cast<std::uint16_t>(channelsOnNote[note] | (1u << index));
+    }
+}
+
+int ChannelAllocator::chooseByPriority(std::uint32_t candidates) const
+{
+    // From the end of the set that gives way; a chord's own channels are skipped, so this
+    // walks past at most as many notes as the chord has
+    auto fromTop = notePriority == NotePriority::lowest;
+    auto words = notesHeld;
+
+    for (;;)
+    {
+        int note;
+
+        if (fromTop)
+            note = words[1] != 0 ? 64 + highestSetBit64(words[1]) : highestSetBit64(words[0]);
+        else
+            note = words[0] != 0 ? lowestSetBit64(words[0]) : 64 + lowestSetBit64(words[1]);
+
+        auto channels = channelsOnNote[static_cast<size_t>(note)] & candidates;
+
+        if (channels != 0)
+            return lowestSetBit(channels) + 1;
+
+        words[static_cast<size_t>(note >> 6)] &= ~(std::uint64_t{1} << (note & 63));
+        assert(words[0] != 0 || words[1] != 0);
+    }
+}
+
+bool ChannelAllocator::ranksBelowHeld(int noteNumber) const
+{
+    // A releasing voice always gives way, so only a zone of held voices turns a note away
+    if (notePriority == NotePriority::last || (busyMask & zoneMask & releasingMask) != 0)
+        return false;
+
+    if (notePriority == NotePriority::highest)
+    {
+        auto lowest = notesHeld[0] != 0 ? lowestSetBit64(notesHeld[0]) : 64 + lowestSetBit64(notesHeld[1]);
+        return noteNumber < lowest;
+    }
+
+    auto highest = notesHeld[1] != 0 ? 64 + highestSetBit64(notesHeld[1]) : highestSetBit64(notesHeld[0]);
+    return noteNumber > highest;
+}
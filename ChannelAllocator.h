@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit; mask must be non-zero
+inline int lowestSetBit(std::uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Index of the lowest and highest set bits of a 64-bit word; mask must be non-zero
+inline int lowestSetBit64(std::uint64_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+inline int highestSetBit64(std::uint64_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(mask);
+#endif
+}
+
+// Hands out MPE member channels from a 16-bit free mask.
+// Channels are 1-based like MIDI; bit (channel - 1) of the masks is that channel.
+class ChannelAllocator
+{
+public:
+    enum class Rotation
+    {
+        lowestFree,       // Always reuse the lowest free channel
+        leastRecentlyUsed // Reuse the channel that has been free the longest
+    };
+
+    enum class StealPolicy
+    {
+        oldest,   // Steal the voice that started first
+        quietest, // Steal the voice with the lowest velocity
+        sameNote  // Steal a voice already playing this note, otherwise the oldest
+    };
+
+    // Which held notes keep their channels once the zone is full. Voices that are only
+    // releasing are always taken first.
+    enum class NotePriority
+    {
+        last,    // Every new note sounds; the steal policy picks what it replaces
+        highest, // The lowest held note gives way, and a note below them all gets no channel
+        lowest   // The same, mirrored
+    };
+
+    ChannelAllocator();
+    ~ChannelAllocator() { setSharedPool(nullptr); }
+
+    // Member channels are firstChannel .. firstChannel + numChannels - 1
+    void setZone(int firstChannel, int numChannels);
+    // Keeps the first channel and the voices still inside the zone
+    void resize(int numChannels);
+    void setRotation(Rotation newRotation);
+    void setStealPolicy(StealPolicy newPolicy) { stealPolicy = newPolicy; }
+    void setNotePriority(NotePriority newPriority) { notePriority = newPriority; }
+    void reset();
+
+    // Channels also have to be claimed in a pool shared with other instances (see
+    // SharedChannelPool), or null for none. Resets, so the caller ends its voices first.
+    void setSharedPool(std::atomic<std::uint32_t> *newPool);
+
+    // Returns the channel to use for a new note. If every channel is taken a busy
+    // channel is chosen by the note priority and steal policy and wasStolen is set; the
+    // caller must end the voice that was on it. Only this allocator's own voices are stolen,
+    // so with a shared pool held entirely by other instances this returns 0 and the note
+    // gets none, as it does when the note priority ranks it below every held note.
+    int allocate(int noteNumber, int velocity, bool &wasStolen);
+
+    // Channels for the notes of a chord that start together, taken in one pass: free
+    // channels in the usual order, then busy ones by the steal policy, never one this chord
+    // has just taken. Returns how many notes got a channel, at most the zone's size and
+    // fewer if a shared pool runs out; bit (channel - 1) of stolenMask marks the channels
+    // whose voices the caller must end.
+    int allocateChord(const int *noteNumbers, int numNotes, int velocity, int *channels, std::uint32_t &stolenMask);
+    void release(int channel);
+
+    // The voice on a busy channel has had its note-off and is only finishing its release
+    // bend, or sounding on under the sustain pedal; such channels are stolen before any
+    // voice that is still held
+    void setReleasing(int channel);
+
+    bool isBusy(int channel) const { return (busyMask >> (channel - 1)) & 1u; }
+    std::uint32_t getBusyMask() const { return busyMask; }
+
+    // The free channels in the order leastRecentlyUsed hands them out, 0 after the last, for
+    // putting another allocator over the same zone where this one stands. All 0 with
+    // lowestFree, which keeps no order. Setting it leaves busy channels as they are.
+    std::array<std::uint8_t, 16> getFreeOrder() const;
+    void setFreeOrder(const std::array<std::uint8_t, 16> &order);
+
+private:
+    int chooseVictim(int noteNumber, std::uint32_t excluded = 0) const;
+    int chooseByPriority(std::uint32_t candidates) const;
+    bool ranksBelowHeld(int noteNumber) const;
+    void forgetNote(int channel);
+    void rebuildNoteIndex();
+    int takeFree(std::uint32_t freeMask);
+    void claim(int channel, int noteNumber, int velocity);
+    void rebuildFreeQueue();
+    void pushFree(int channel);
+    int popFree();
+
+    std::uint32_t zoneMask = 0;
+    int zoneSize = 0;
+    std::uint32_t busyMask = 0;
+    std::uint32_t releasingMask = 0;
+
+    std::atomic<std::uint32_t> *sharedPool = nullptr;
+
+    Rotation rotation = Rotation::leastRecentlyUsed;
+    StealPolicy stealPolicy = StealPolicy::oldest;
+    NotePriority notePriority = NotePriority::last;
+
+    // Free channels in release order, only used for leastRecentlyUsed
+    std::array<std::uint8_t, 16> freeQueue{};
+    int freeHead = 0;
+    int numQueued = 0;
+
+    // Per channel state of the voice holding it, for stealing decisions
+    std::array<std::uint32_t, 16> startOrder{};
+    std::array<std::uint8_t, 16> noteOnChannel{};
+    std::array<std::uint8_t, 16> velocityOnChannel{};
+    std::uint32_t allocationCounter = 0;
+
+    // The notes on busy channels as a 128-bit set, with each note's channels, so the highest
+    // or lowest held note is a bit scan and kept up to date as channels are claimed and freed
+    std::array<std::uint64_t, 2> notesHeld{};
+    std::array<std::uint16_t, 128> channelsOnNote{};
+};
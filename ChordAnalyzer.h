@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "ChannelAllocator.h"
+
+// The set of held input notes as a 128-bit mask, updated in constant time per note event
+// so the chord under a new note never involves scanning the voices. A count per key keeps
+// the same note held on several input channels in the set until its last note-off.
+class ChordAnalyzer
+{
+public:
+    void noteOn(int note)
+    {
+        if (counts[static_cast<size_t>(note)]++ == 0)
+            held[word(note)] |= bit(note);
+    }
+
+    void noteOff(int note)
+    {
+        auto &count = counts[static_cast<size_t>(note)];
+
+        if (count == 0)
+            return;
+
+        if (--count == 0)
+            held[word(note)] &= ~bit(note);
+    }
+
+    void clear()
+    {
+        held = {};
+        counts.fill(0);
+    }
+
+    bool isHeld(int note) const { return (held[word(note)] & bit(note)) != 0; }
+
+    // Lowest held note, or -1 if none
+    int getLowestNote() const
+    {
+        for (size_t i = 0; i < held.size(); ++i)
+            if (held[i] != 0)
+                return static_cast<int>(i) * 32 + lowestSetBit(held[i]);
+
+        return -1;
+    }
+
+    // Offset in cents that takes note from equal temperament to the 5-limit just interval
+    // above the lowest held note
+    float getJustOffsetCents(int note) const { return getJustOffsetCents(note, getLowestNote()); }
+
+    // The same above root, which needn't be held; none for a root below 0
+    static float getJustOffsetCents(int note, int root)
+    {
+        static constexpr float offsets[12] = {
+            0.0f,    // 1/1
+            11.73f,  // 16/15
+            3.91f,   // 9/8
+            15.64f,  // 6/5
+            -13.69f, // 5/4
+            -1.96f,  // 4/3
+            -9.78f,  // 45/32
+            1.96f,   // 3/2
+            13.69f,  // 8/5
+            -15.64f, // 5/3
+            17.60f,  // 9/5
+            -11.73f  // 15/8
+        };
+
+        if (root < 0 || note <= root)
+            return 0.0f;
+
+        return offsets[(note - root) % 12];
+    }
+
+private:
+    static size_t word(int note) { return static_cast<size_t>(note >> 5); }
+    static std::uint32_t bit(int note) { return 1u << (note & 31); }
+
+    std::array<std::uint32_t, 4> held{};
+    std::array<std::uint8_t, 128> counts{};
+};
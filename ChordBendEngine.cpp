@@ -0,0 +1,262 @@
+#include "ChordBendEngine.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    struct Range
+    {
+        float minimum, maximum, initial;
+    };
+
+    // The plugin's ranges and defaults for the same parameters
+    constexpr std::array<Range, static_cast<size_t>(ChordBendEngine::Parameter::numParameters)> ranges{{
+        {0.0f, 2.0f, 1.0f},
+        {0.01f, 2.0f, 0.5f},
+        {-2.0f, 2.0f, 0.0f},
+        {1.0f, 96.0f, 48.0f},
+        {1.0f, 15.0f, 15.0f},
+        {0.02f, 20.0f, 1.45f},
+        {0.0f, 2.0f, 0.0f},
+        {0.0f, 2.0f, 0.0f},
+        {0.0f, 1.0f, 0.0f},
+    }};
+
+    constexpr int masterChannel = 1;
+}
+
+ChordBendEngine::ChordBendEngine(double rate) : sampleRate(rate)
+{
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = ranges[i].initial;
+
+    table.build(values[static_cast<size_t>(Parameter::bendCurve)]);
+    applyZone();
+
+    for (auto parameter : {Parameter::bendTime, Parameter::updateIntervalMs})
+        setParameter(parameter, getParameter(parameter));
+}
+
+float ChordBendEngine::getParameter(Parameter parameter) const
+{
+    return values[static_cast<size_t>(parameter)];
+}
+
+bool ChordBendEngine::setParameter(Parameter parameter, float value)
+{
+    auto index = static_cast<size_t>(parameter);
+
+    if (index >= values.size() || !std::isfinite(value))
+        return false;
+
+    value = std::clamp(value, ranges[index].minimum, ranges[index].maximum);
+
+    if (parameter == Parameter::bendRange || parameter == Parameter::zoneChannels || parameter == Parameter::stealPolicy
+        || parameter == Parameter::notePriority || parameter == Parameter::fixedPoint)
+        value = std::round(value);
+
+    auto changed = value != values[index];
+    values[index] = value;
+
+    switch (parameter)
+    {
+        case Parameter::bendTime:
+            durationSamples = std::max<std::int64_t>(1, std::llround(value * sampleRate));
+            break;
+        case Parameter::bendCurve:
+            // A table build is a thousand pows, well inside a block, and allocates nothing
+            if (changed)
+                table.build(value);
+            break;
+        case Parameter::bendRange:
+            zoneConfigPending = zoneConfigPending || changed;
+            break;
+        case Parameter::zoneChannels:
+            if (changed)
+                applyZone();
+            break;
+        case Parameter::updateIntervalMs:
+            updateInterval = std::max(1, static_cast<int>(std::lround(value * sampleRate / 1000.0)));
+            break;
+        case Parameter::stealPolicy:
+            allocator.setStealPolicy(static_cast<ChannelAllocator::StealPolicy>(static_cast<int>(value)));
+            break;
+        case Parameter::notePriority:
+            allocator.setNotePriority(static_cast<ChannelAllocator::NotePriority>(static_cast<int>(value)));
+            break;
+        default:
+            break;
+    }
+
+    return true;
+}
+
+void ChordBendEngine::applyZone()
+{
+    // Voices on channels the zone no longer has are dropped with it; a host changes the
+    // zone between notes
+    allocator.setZone(masterChannel + 1, static_cast<int>(getParameter(Parameter::zoneChannels)));
+    voices.fill({});
+    zoneConfigPending = true;
+}
+
+void ChordBendEngine::reset()
+{
+    allocator.reset();
+    voices.fill({});
+    sampleClock = 0;
+    nextUpdate = 0;
+    numDropped = 0;
+    zoneConfigPending = true;
+}
+
+int ChordBendEngine::process(const Event *input, int numInput, Event *outputEvents, int capacity, int numSamples)
+{
+    output = outputEvents;
+    outputCapacity = std::max(0, capacity);
+    numOutput = 0;
+
+    if (zoneConfigPending)
+        sendZoneConfig();
+
+    auto blockEnd = sampleClock + numSamples;
+    int next = 0;
+
+    // Input up to each bend step goes first, so a note struck on a step bends from it
+    for (;;)
+    {
+        auto stepOffset = static_cast<int>(std::min(nextUpdate, blockEnd) - sampleClock);
+
+        for (; next < numInput && static_cast<int>(input[next].sampleOffset) < stepOffset; ++next)
+        {
+            const auto &event = input[next];
+            auto offset = static_cast<int>(event.sampleOffset);
+            auto type = event.data[0] & 0xf0;
+            auto channel = (event.data[0] & 0x0f) + 1;
+
+            if (event.size == 3 && type == 0x90 && event.data[2] > 0)
+                startNote(channel, event.data[1], event.data[2], offset);
+            else if (event.size == 3 && (type == 0x80 || type == 0x90))
+                stopNote(channel, event.data[1], offset);
+            else if (numOutput < outputCapacity)
+                output[numOutput++] = event;
+            else
+                ++numDropped;
+        }
+
+        if (nextUpdate >= blockEnd)
+            break;
+
+        updateBends(stepOffset);
+        nextUpdate += updateInterval;
+    }
+
+    sampleClock = blockEnd;
+    output = nullptr;
+    return numOutput;
+}
+
+void ChordBendEngine::startNote(int inputChannel, int note, int velocity, int offset)
+{
+    bool wasStolen = false;
+    auto channel = allocator.allocate(note, velocity, wasStolen);
+
+    if (channel == 0)
+        return;
+
+    auto &voice = voices[static_cast<size_t>(channel - 1)];
+    auto status = static_cast<std::uint8_t>(channel - 1);
+
+    if (wasStolen)
+        add(offset, static_cast<std::uint8_t>(0x80 | status), voice.note, 0);
+
+    // Each note starts from the centre, whatever the channel's last note left it at
+    voice = {sampleClock + offset, static_cast<std::uint8_t>(note), static_cast<std::uint8_t>(inputChannel), 8192};
+    add(offset, static_cast<std::uint8_t>(0xe0 | status), 0, 64);
+    add(offset, static_cast<std::uint8_t>(0x90 | status), static_cast<std::uint8_t>(note), static_cast<std::uint8_t>(velocity));
+}
+
+void ChordBendEngine::stopNote(int inputChannel, int note, int offset)
+{
+    for (int channel = 1; channel <= 16; ++channel)
+    {
+        auto &voice = voices[static_cast<size_t>(channel - 1)];
+
+        if (voice.inputChannel == inputChannel && voice.note == note)
+        {
+            add(offset, static_cast<std::uint8_t>(0x80 | (channel - 1)), static_cast<std::uint8_t>(note), 0);
+            allocator.release(channel);
+            voice.inputChannel = 0;
+            return;
+        }
+    }
+}
+
+void ChordBendEngine::updateBends(int offset)
+{
+    auto target = getParameter(Parameter::bendAmount) * 8192.0f;
+    auto now = sampleClock + offset;
+
+    for (auto mask = allocator.getBusyMask(); mask != 0; mask &= mask - 1)
+    {
+        auto channel = lowestSetBit(mask) + 1;
+        auto &voice = voices[static_cast<size_t>(channel - 1)];
+
+        if (voice.inputChannel == 0)
+            continue;
+
+        auto bend = evaluateBend(voice, now, target);
+
+        if (bend != voice.lastBend)
+        {
+            voice.lastBend = bend;
+            add(offset, static_cast<std::uint8_t>(0xe0 | (channel - 1)), static_cast<std::uint8_t>(bend & 0x7f), static_cast<std::uint8_t>(bend >> 7));
+        }
+    }
+}
+
+int ChordBendEngine::evaluateBend(const Voice &voice, std::int64_t now, float target) const
+{
+    if (getParameter(Parameter::fixedPoint) != 0.0f)
+    {
+        // The target in whole steps is the one rounding; the rest is integer, and truncates
+        // toward zero as the float path does. It saturates after the curve, as the float path
+        // does too, so a target past the wheel's range still rises along the curve to the end
+        // of it rather than being cut down first; the target is bounded only to keep the
+        // product well inside 64 bits.
+        auto steps = static_cast<std::int64_t>(std::lround(std::clamp(target, -65536.0f, 65536.0f)));
+        auto level = table.evaluateFixed(FixedPoint::progress(now - voice.startSample, durationSamples));
+        return 8192 + static_cast<int>(std::clamp<std::int64_t>(steps * level / FixedPoint::one, -8192, 8191));
+    }
+
+    auto progress = std::clamp(static_cast<float>(now - voice.startSample) / static_cast<float>(durationSamples), 0.0f, 1.0f);
+    return 8192 + static_cast<int>(std::clamp(target * table.evaluate(progress), -8192.0f, 8191.0f));
+}
+
+void ChordBendEngine::sendZoneConfig()
+{
+    // The MPE configuration message for the lower zone, then the members' bend range
+    auto rpn = [this](int channel, int parameterNumber, int value)
+    {
+        auto status = static_cast<std::uint8_t>(0xb0 | (channel - 1));
+        add(0, status, 101, static_cast<std::uint8_t>(parameterNumber >> 7));
+        add(0, status, 100, static_cast<std::uint8_t>(parameterNumber & 0x7f));
+        add(0, status, 6, static_cast<std::uint8_t>(value));
+    };
+
+    rpn(masterChannel, 6, static_cast<int>(getParameter(Parameter::zoneChannels)));
+    rpn(masterChannel + 1, 0, static_cast<int>(getParameter(Parameter::bendRange)));
+    zoneConfigPending = false;
+}
+
+void ChordBendEngine::add(int offset, std::uint8_t status, std::uint8_t data1, std::uint8_t data2)
+{
+    if (numOutput >= outputCapacity)
+    {
+        ++numDropped;
+        return;
+    }
+
+    output[numOutput++] = {static_cast<std::uint32_t>(offset), 3, {status, data1, data2}};
+}
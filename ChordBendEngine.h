@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "ChannelAllocator.h"
+#include "CurveTable.h"
+
+// The chord bend in plain C++ over the core alone, for hosts that aren't plugin hosts: a
+// game audio engine runs it next to its synths through the C functions in EngineApi.h.
+// Every note-on gets an MPE member channel of a lower zone from a ChannelAllocator, and
+// bends from where it was struck to the bend amount over the bend time along the curve,
+// stepped on a fixed update interval. Other messages pass through. It is the plugin's basic
+// bend only: no envelopes, scales, tempo sync or release bends.
+//
+// Everything is held in fixed arrays made with the engine, so nothing allocates after it is
+// created. Not thread safe: parameters are set on the thread that processes, between
+// blocks, as middleware sets its plugins' parameters.
+class ChordBendEngine
+{
+public:
+    struct Event
+    {
+        std::uint32_t sampleOffset; // Within the block
+        std::uint8_t size;          // 1 to 3
+        std::uint8_t data[3];
+    };
+
+    enum class Parameter
+    {
+        bendAmount,       // Of the bend range, 0 to 2
+        bendTime,         // Seconds, 0.01 to 2
+        bendCurve,        // -2 to 2
+        bendRange,        // Semitones the member channels bend over, 1 to 96
+        zoneChannels,     // Member channels, 1 to 15
+        updateIntervalMs, // Between bend steps, 0.02 to 20
+        stealPolicy,      // ChannelAllocator::StealPolicy
+        notePriority,     // ChannelAllocator::NotePriority
+        fixedPoint,       // 1 for bends worked out in integers (FixedPoint.h), the same on every CPU
+        numParameters
+    };
+
+    explicit ChordBendEngine(double sampleRate);
+
+    // Returns false for an unknown parameter; values are clamped to their ranges
+    bool setParameter(Parameter parameter, float value);
+    float getParameter(Parameter parameter) const;
+
+    // Ends every voice without sending anything and starts the output over with the zone
+    // configuration
+    void reset();
+
+    // Takes the block's input events in time order and writes the output, also in time
+    // order, up to outputCapacity events. Returns how many were written; the rest of a
+    // block that overflows is dropped and counted in getNumDropped.
+    int process(const Event *input, int numInput, Event *output, int outputCapacity, int numSamples);
+
+    int getNumDropped() const { return numDropped; }
+
+private:
+    struct Voice
+    {
+        std::int64_t startSample = 0;
+        std::uint8_t note = 0;
+        std::uint8_t inputChannel = 0; // 0 when the channel has no voice
+        int lastBend = 8192;
+    };
+
+    void applyZone();
+    void startNote(int inputChannel, int note, int velocity, int offset);
+    void stopNote(int inputChannel, int note, int offset);
+    void updateBends(int offset);
+    int evaluateBend(const Voice &voice, std::int64_t now, float target) const;
+    void sendZoneConfig();
+    void add(int offset, std::uint8_t status, std::uint8_t data1, std::uint8_t data2);
+
+    double sampleRate;
+    std::array<float, static_cast<size_t>(Parameter::numParameters)> values{};
+
+    ChannelAllocator allocator;
+    CurveTable table;
+    std::array<Voice, 16> voices; // By member channel - 1
+    std::int64_t sampleClock = 0;
+    std::int64_t nextUpdate = 0;
+    std::int64_t durationSamples = 1;
+    int updateInterval = 1;
+    bool zoneConfigPending = true;
+
+    // The block being written
+    Event *output = nullptr;
+    int outputCapacity = 0;
+    int numOutput = 0;
+    int numDropped = 0;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <iterator>
+
+// Voicings a single key plays in chord memory mode, compiled in as intervals from the key so
+// a trigger expands to its notes with additions alone.
+struct ChordMemory
+{
+    static constexpr int maxNotes = 6;
+
+    struct Voicing
+    {
+        const char *name;
+        int numNotes;
+        std::array<int, maxNotes> intervals; // Semitones from the key, lowest first
+    };
+
+    static constexpr Voicing voicings[] = {
+        {"Major", 3, {0, 4, 7}},
+        {"Minor", 3, {0, 3, 7}},
+        {"Suspended 4th", 3, {0, 5, 7}},
+        {"Power", 3, {0, 7, 12}},
+        {"Major 7th", 4, {0, 4, 7, 11}},
+        {"Minor 7th", 4, {0, 3, 7, 10}},
+        {"Dominant 7th", 4, {0, 4, 7, 10}},
+        {"Major 9th", 5, {0, 4, 7, 11, 14}},
+        {"Minor 9th", 5, {0, 3, 7, 10, 14}},
+        {"Open Major", 4, {-12, 0, 7, 16}},
+        {"Quartal", 4, {0, 5, 10, 15}},
+    };
+
+    static constexpr int numVoicings = static_cast<int>(std::size(voicings));
+
+    // Writes the voicing's notes that fall within MIDI's range; returns how many
+    static int expand(int voicing, int key, int *notes)
+    {
+        const auto &entry = voicings[voicing];
+        int numNotes = 0;
+
+        for (int i = 0; i < entry.numNotes; ++i)
+        {
+            auto note = key + entry.intervals[static_cast<size_t>(i)];
+
+            if (note >= 0 && note <= 127)
+                notes[numNotes++] = note;
+        }
+
+        return numNotes;
+    }
+};
@@ -0,0 +1,97 @@
+#include "PluginProcessor.h"
+
+#if BCS_CLAP
+
+namespace
+{
+    clap_event_header_t makeHeader(std::uint32_t size, std::uint16_t type, int time)
+    {
+        clap_event_header_t header{};
+        header.size = size;
+        header.time = static_cast<std::uint32_t>(juce::jmax(0, time));
+        header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+        header.type = type;
+        header.flags = 0;
+        return header;
+    }
+
+    void pushMidi(const clap_output_events *outEvents, const juce::MidiMessageMetadata &event, int time)
+    {
+        const auto *data = event.data;
+        auto status = data[0] & 0xf0;
+
+        // Notes go as CLAP notes, so the host pairs them with their expressions by key and
+        // channel; a note ID is left to the host
+        if ((status == 0x90 || status == 0x80) && event.numBytes >= 3)
+        {
+            clap_event_note_t note{};
+            auto isOn = status == 0x90 && data[2] != 0;
+            note.header = makeHeader(sizeof(note), isOn ? CLAP_EVENT_NOTE_ON : CLAP_EVENT_NOTE_OFF, time);
+            note.note_id = -1;
+            note.port_index = 0;
+            note.channel = static_cast<std::int16_t>(data[0] & 0x0f);
+            note.key = static_cast<std::int16_t>(data[1]);
+            note.velocity = data[2] / 127.0;
+            outEvents->try_push(outEvents, &note.header);
+            return;
+        }
+
+        if (data[0] == 0xf0)
+        {
+            clap_event_midi_sysex_t sysex{};
+            sysex.header = makeHeader(sizeof(sysex), CLAP_EVENT_MIDI_SYSEX, time);
+            sysex.port_index = 0;
+            sysex.buffer = data;
+            sysex.size = static_cast<std::uint32_t>(event.numBytes);
+            outEvents->try_push(outEvents, &sysex.header);
+            return;
+        }
+
+        clap_event_midi_t midi{};
+        midi.header = makeHeader(sizeof(midi), CLAP_EVENT_MIDI, time);
+        midi.port_index = 0;
+        std::copy(data, data + juce::jmin(event.numBytes, 3), midi.data);
+        outEvents->try_push(outEvents, &midi.header);
+    }
+}
+
+void PitchBendProcessor::addOutboundEventsToQueue(const clap_output_events *outEvents, const juce::MidiBuffer &midiBuffer, int sampleOffset)
+{
+    // The MIDI 1.0 notes and pass-through in the buffer, and the per-note bends in the UMP
+    // output, each in time order: merged, since the host wants one ordered list
+    auto midi = midiBuffer.cbegin();
+    auto ump = umpOutput.cbegin();
+
+    while (midi != midiBuffer.cend() || ump != umpOutput.cend())
+    {
+        if (midi != midiBuffer.cend() && (ump == umpOutput.cend() || (*midi).samplePosition <= ump->samplePosition))
+        {
+            pushMidi(outEvents, *midi, (*midi).samplePosition + sampleOffset);
+            ++midi;
+            continue;
+        }
+
+        const auto &packet = ump->packet;
+
+        // Per-note pitch bend becomes the note's tuning, in semitones. The notes themselves
+        // already went out from the buffer.
+        if (juce::ump::Utils::getMessageType(packet[0]) == 0x4 && juce::ump::Utils::getStatus(packet[0]) == 0x6)
+        {
+            auto steps = (static_cast<double>(packet[1]) - 2147483648.0) / 262144.0;
+
+            clap_event_note_expression_t expression{};
+            expression.header = makeHeader(sizeof(expression), CLAP_EVENT_NOTE_EXPRESSION, ump->samplePosition + sampleOffset);
+            expression.expression_id = CLAP_NOTE_EXPRESSION_TUNING;
+            expression.note_id = -1;
+            expression.port_index = 0;
+            expression.channel = static_cast<std::int16_t>(juce::ump::Utils::getChannel(packet[0]));
+            expression.key = static_cast<std::int16_t>((packet[0] >> 8) & 0x7f);
+            expression.value = steps / static_cast<double>(semitoneScale);
+            outEvents->try_push(outEvents, &expression.header);
+        }
+
+        ++ump;
+    }
+}
+
+#endif
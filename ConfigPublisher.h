@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CacheLine.h"
+
+// A value read by the audio thread and replaced whole from any other thread. A writer
+// edits a copy of the current value and publishes it with one atomic pointer swap; the
+// reader takes the current value at the start of its work and reads it until the next
+// acquire(). Nothing is changed in place, so no read is ever torn, and the reader neither
+// locks nor frees: replaced values wait on a list until collectGarbage(), called on the
+// message thread, finds the reader can no longer be holding them.
+template <typename T>
+class ConfigPublisher
+{
+public:
+    explicit ConfigPublisher(std::unique_ptr<T> initial) : current(initial.release()) {}
+
+    ~ConfigPublisher() { delete current.load(); }
+
+    // Writer side: change is called on a copy of the current value, which then replaces it.
+    // Writers are serialized, so edits from different threads never lose one another.
+    template <typename Change>
+    void edit(Change &&change)
+    {
+        const juce::ScopedLock lock(writeLock);
+
+        auto next = std::make_unique<T>(*current.load());
+        change(*next);
+        retired.emplace_back(current.exchange(next.release()));
+    }
+
+    void collectGarbage()
+    {
+        const juce::ScopedLock lock(writeLock);
+        const auto *held = inUse.load();
+
+        for (auto i = retired.size(); i-- > 0;)
+        {
+            if (retired[i].get() != held)
+            {
+                std::swap(retired[i], retired.back());
+                retired.pop_back();
+            }
+        }
+    }
+
+    // Reader side. The value is announced before it is relied on; a swap in between is
+    // seen on the second look, and the newer value is announced instead.
+    const T &acquire()
+    {
+        auto *value = current.load();
+
+        for (;;)
+        {
+            inUse.store(value);
+            auto *latest = current.load();
+
+            if (latest == value)
+                return *value;
+
+            value = latest;
+        }
+    }
+
+private:
+    alignas(cacheLineSize) std::atomic<T *> current;
+    alignas(cacheLineSize) std::atomic<const T *> inUse{nullptr};
+
+    juce::CriticalSection writeLock;
+    std::vector<std::unique_ptr<T>> retired;
+
+    JUCE_DECLARE_NON_COPYABLE(ConfigPublisher)
+};
@@ -0,0 +1,132 @@
+#include "CurveDisplay.h"
+
+CurveDisplay::CurveDisplay(PitchBendProcessor &p)
+    : audioProcessor(p)
+{
+  setOpaque(true);
+  imageCurve = audioProcessor.bendCurve->get();
+  imageAmount = audioProcessor.getBendAmountAsFraction();
+}
+
+juce::Rectangle<float> CurveDisplay::getPlotArea() const
+{
+  return getLocalBounds().toFloat().reduced(dotRadius + 2.0f);
+}
+
+juce::Point<float> CurveDisplay::getPointOnCurve(float progress) const
+{
+  // Amounts above 1 saturate at the top of the bend range, as they do in processBlock
+  auto plot = getPlotArea();
+  auto bend = juce::jmin(1.0f, CurveTable::shape(progress, imageCurve) * imageAmount);
+
+  return {plot.getX() + progress * plot.getWidth(), plot.getBottom() - bend * plot.getHeight()};
+}
+
+juce::Rectangle<int> CurveDisplay::getDotBounds(float progress) const
+{
+  auto dot = juce::Rectangle<float>(dotRadius * 2.0f, dotRadius * 2.0f).withCentre(getPointOnCurve(progress));
+  return dot.getSmallestIntegerContainer().expanded(1);
+}
+
+void CurveDisplay::renderCurveImage(float scale)
+{
+  curveImage = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(getWidth() * scale)),
+                           juce::jmax(1, juce::roundToInt(getHeight() * scale)), false);
+
+  juce::Graphics g(curveImage);
+  g.addTransform(juce::AffineTransform::scale(scale));
+
+  g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId).darker(0.3f));
+
+  // Quarter grid and the full bend range
+  auto plot = getPlotArea();
+  g.setColour(juce::Colours::white.withAlpha(0.1f));
+
+  for (int i = 1; i < 4; ++i)
+  {
+    g.drawVerticalLine(juce::roundToInt(plot.getX() + plot.getWidth() * i / 4.0f), plot.getY(), plot.getBottom());
+    g.drawHorizontalLine(juce::roundToInt(plot.getY() + plot.getHeight() * i / 4.0f), plot.getX(), plot.getRight());
+  }
+
+  g.drawRect(plot);
+
+  juce::Path path;
+  path.startNewSubPath(getPointOnCurve(0.0f));
+
+  auto numSegments = juce::jmax(2, juce::roundToInt(plot.getWidth() / 2.0f));
+  for (int i = 1; i <= numSegments; ++i)
+    path.lineTo(getPointOnCurve(static_cast<float>(i) / numSegments));
+
+  g.setColour(juce::Colours::orange);
+  g.strokePath(path, juce::PathStrokeType(2.0f));
+}
+
+void CurveDisplay::paint(juce::Graphics &g)
+{
+  auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+  if (curveImage.isNull() || curveImage.getWidth() != juce::roundToInt(getWidth() * scale))
+    renderCurveImage(scale);
+
+  g.drawImage(curveImage, getLocalBounds().toFloat());
+
+  g.setColour(juce::Colours::white);
+
+  for (auto mask = dotMask; mask != 0; mask &= mask - 1)
+  {
+    auto centre = getPointOnCurve(dotProgress[static_cast<size_t>(lowestSetBit(mask))]);
+    g.fillEllipse(juce::Rectangle<float>(dotRadius * 2.0f, dotRadius * 2.0f).withCentre(centre));
+  }
+}
+
+void CurveDisplay::resized()
+{
+  curveImage = {};
+}
+
+void CurveDisplay::refresh()
+{
+  auto curve = audioProcessor.bendCurve->get();
+  auto amount = audioProcessor.getBendAmountAsFraction();
+
+  if (curve != imageCurve || amount != imageAmount)
+  {
+    imageCurve = curve;
+    imageAmount = amount;
+    curveImage = {};
+    repaint();
+  }
+
+  auto &positions = audioProcessor.getVoicePositions();
+
+  if (!positions.acquire())
+    return;
+
+  // Repaint only where a dot was or now is
+  const auto &latest = positions.getReadBuffer();
+
+  for (auto mask = dotMask | latest.activeMask; mask != 0; mask &= mask - 1)
+  {
+    auto slot = static_cast<size_t>(lowestSetBit(mask));
+    auto wasShown = (dotMask >> slot) & 1u;
+    auto isShown = (latest.activeMask >> slot) & 1u;
+    auto progress = latest.progress[slot];
+
+    if (wasShown && isShown && getDotBounds(progress) == getDotBounds(dotProgress[slot]))
+    {
+      dotProgress[slot] = progress;
+      continue;
+    }
+
+    if (wasShown)
+      repaint(getDotBounds(dotProgress[slot]));
+
+    if (isShown)
+    {
+      dotProgress[slot] = progress;
+      repaint(getDotBounds(progress));
+    }
+  }
+
+  dotMask = latest.activeMask;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "EditorLookAndFeel.h"
+
+// Plots the bend shape for the current amount and curve, with a dot for each sounding voice
+// at its position along the bend. The curve is rendered into a cached image only when the
+// parameters or the size change; each frame otherwise repaints just the dots that moved, and
+// nothing at all while no voice is playing.
+class CurveDisplay : public juce::Component
+{
+public:
+  explicit CurveDisplay(PitchBendProcessor &);
+
+  void paint(juce::Graphics &) override;
+  void resized() override;
+
+  // Called by the editor once per display frame
+  void refresh();
+
+  size_t getCacheBytes() const { return EditorLookAndFeel::getImageBytes(curveImage); }
+
+private:
+  static constexpr int numSlots = 16;
+  static constexpr float dotRadius = 4.0f;
+
+  PitchBendProcessor &audioProcessor;
+
+  // Shape the cached image was drawn for; the image is rendered in paint when it is null
+  juce::Image curveImage;
+  float imageCurve = 0.0f;
+  float imageAmount = 0.0f;
+
+  // Voices as last painted
+  juce::uint32 dotMask = 0;
+  std::array<float, numSlots> dotProgress{};
+
+  juce::Rectangle<float> getPlotArea() const;
+  juce::Point<float> getPointOnCurve(float progress) const;
+  juce::Rectangle<int> getDotBounds(float progress) const;
+  void renderCurveImage(float scale);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CurveDisplay)
+};
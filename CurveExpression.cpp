@@ -0,0 +1,68 @@
+#include "CurveExpression.h"
+
+bool CurveExpression::compile(const juce::String &expression, CurveTable &table, juce::String &error)
+{
+    // Sampled in one script run rather than a call per point
+    juce::JavascriptEngine engine;
+    engine.maximumExecutionTime = juce::RelativeTime::seconds(2.0);
+
+    juce::Result result = juce::Result::ok();
+    auto values = engine.evaluate("(function () { var values = []; for (var i = 0; i <= " + juce::String(CurveTable::maxPoints)
+                                      + "; ++i) { var x = i / " + juce::String(CurveTable::maxPoints) + "; values.push(+(" + expression
+                                      + "\n)); } return values; })()",
+                                  &result);
+
+    if (result.failed())
+    {
+        error = result.getErrorMessage();
+        return false;
+    }
+
+    auto *array = values.getArray();
+
+    if (array == nullptr || array->size() != CurveTable::maxPoints + 1)
+    {
+        error = "The expression didn't give a number for every point";
+        return false;
+    }
+
+    auto start = static_cast<double>((*array)[0]);
+    auto span = static_cast<double>((*array)[CurveTable::maxPoints]) - start;
+
+    if (!std::isfinite(start) || !std::isfinite(span) || span == 0.0)
+    {
+        error = "The expression must have different values at x = 0 and x = 1";
+        return false;
+    }
+
+    // Rounding in the script can dip a hair; anything more is a shape that falls back
+    constexpr double tolerance = 1.0e-4;
+    auto highest = 0.0;
+
+    for (int i = 0; i <= CurveTable::maxPoints; ++i)
+    {
+        auto level = (static_cast<double>((*array)[i]) - start) / span;
+
+        if (!std::isfinite(level))
+        {
+            error = "The expression has no value at x = " + juce::String(static_cast<double>(i) / CurveTable::maxPoints);
+            return false;
+        }
+
+        if (level < highest - tolerance || level > 1.0 + tolerance)
+        {
+            error = "The shape must keep rising from x = 0 to x = 1";
+            return false;
+        }
+
+        highest = juce::jlimit(highest, 1.0, level);
+        table.values[static_cast<size_t>(i)] = static_cast<float>(highest);
+        table.fixedValues[static_cast<size_t>(i)] = static_cast<std::int32_t>(std::lround(highest * FixedPoint::one));
+    }
+
+    // Anything that can't read the table falls back to a straight line
+    table.curve = 0.0f;
+    table.numPoints = CurveTable::maxPoints;
+    table.interpolation = CurveTable::Interpolation::linear;
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CurveTable.h"
+
+// A bend shape written as a JavaScript expression in x, the progress through the rise from
+// 0 to 1, e.g. "x * x * (3 - 2 * x)" or "Math.sin(x * Math.PI / 2)". The script runs once,
+// off the audio thread, to sample the expression into a CurveTable; nothing evaluates it
+// while rendering.
+struct CurveExpression
+{
+    // Longest expression the plugin state keeps
+    static constexpr int maxLength = 4096;
+
+    // The value at 0 and 1 are taken as the start and the end of the bend, and everything
+    // between is scaled to fit. The shape must not fall back on its way up: the table is
+    // searched by level. Returns false and sets error if the expression doesn't parse, runs
+    // too long, or gives anything else.
+    static bool compile(const juce::String &expression, CurveTable &table, juce::String &error);
+};
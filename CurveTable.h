@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include "FastPow.h"
+#include "FixedPoint.h"
+
+// Exact bend shape for one bendCurve value: progress raised to 1 + curve, or mirrored for
+// negative curves. The exponent is looked at once, when the kernel is made, and picks a
+// specialised function, so linear and the integer exponents 2 to 4 run as multiplies and only
+// the values between them call std::pow, or fastPow where approximate is enough. Callers make
+// one per curve value, outside their loops.
+class CurveKernel
+{
+public:
+    enum class Precision
+    {
+        exact,      // std::pow, for building tables
+        approximate // fastPow, for evaluating without a table
+    };
+
+    explicit CurveKernel(float curve, Precision precision = Precision::exact) : exponent(1.0f + std::abs(curve))
+    {
+        auto rising = curve >= 0.0f;
+
+        if (exponent == 1.0f)
+            select<1>(true);
+        else if (exponent == 2.0f)
+            select<2>(rising);
+        else if (exponent == 3.0f)
+            select<3>(rising);
+        else if (exponent == 4.0f)
+            select<4>(rising);
+        else if (precision == Precision::approximate)
+            select<-1>(rising);
+        else
+            select<0>(rising);
+    }
+
+    float operator()(float progress) const { return one(progress, exponent); }
+
+    // Shapes numValues progress values in place
+    void apply(float *values, int numValues) const { block(values, numValues, exponent); }
+
+    // The shapes themselves, for loops that are compiled elsewhere, like KernelDispatch's.
+    // powers 0 and -1 are the general case, which raises to exponent at run time
+    template <int power>
+    static float raise(float x, [[maybe_unused]] float exponent)
+    {
+        if constexpr (power == 0)
+        {
+            return std::pow(x, exponent);
+        }
+        else if constexpr (power == -1)
+        {
+            return fastPow(x, exponent);
+        }
+        else
+        {
+            auto result = x;
+            for (int i = 1; i < power; ++i)
+                result *= x;
+            return result;
+        }
+    }
+
+    template <int power, bool rising>
+    static float shapeOne(float progress, float exponent)
+    {
+        if constexpr (rising)
+            return raise<power>(progress, exponent);
+        else
+            return 1.0f - raise<power>(1.0f - progress, exponent);
+    }
+
+private:
+    template <int power, bool rising>
+    static void shapeBlock(float *values, int numValues, float exponent)
+    {
+        for (int i = 0; i < numValues; ++i)
+            values[i] = shapeOne<power, rising>(values[i], exponent);
+    }
+
+    template <int power>
+    void select(bool rising)
+    {
+        one = rising ? &shapeOne<power, true> : &shapeOne<power, false>;
+        block = rising ? &shapeBlock<power, true> : &shapeBlock<power, false>;
+    }
+
+    float (*one)(float, float) = nullptr;
+    void (*block)(float *, int, float) = nullptr;
+    float exponent;
+};
+
+// Bend shape sampled over progress 0..1 for one bendCurve value, so the per-voice
+// evaluation is a table read and an interpolation instead of std::pow.
+//
+// The float values are sampled at a resolution of the caller's choosing, from 16 to 1024
+// points, read linearly or as a cubic: chooseResolution finds the smallest that keeps
+// within an error, so a table holds only the cache lines its output can tell apart. The
+// fixed-point values are always at full resolution, so the fixed-point engine's output
+// never depends on it.
+struct CurveTable
+{
+    static constexpr int minPointBits = 4;
+    static constexpr int maxPointBits = 10;
+    static constexpr int maxPoints = 1 << maxPointBits;
+
+    enum class Interpolation
+    {
+        linear,
+        cubic // Catmull-Rom through the neighbouring points
+    };
+
+    struct Resolution
+    {
+        int pointBits = maxPointBits;
+        Interpolation interpolation = Interpolation::linear;
+
+        bool operator==(const Resolution &other) const { return pointBits == other.pointBits && interpolation == other.interpolation; }
+    };
+
+    float curve = 0.0f;
+    int numPoints = maxPoints; // Of values; the first numPoints + 1 are used
+    Interpolation interpolation = Interpolation::linear;
+    std::array<float, maxPoints + 1> values{};
+    std::array<std::int32_t, maxPoints + 1> fixedValues{}; // The same shape in Q30, for the fixed-point engine
+
+    // Exact shape of a single point; loops make a CurveKernel instead
+    static float shape(float progress, float curve)
+    {
+        return CurveKernel(curve)(progress);
+    }
+
+    void build(float newCurve) { build(newCurve, Resolution{}); }
+
+    void build(float newCurve, Resolution resolution)
+    {
+        curve = newCurve;
+        numPoints = 1 << resolution.pointBits;
+        interpolation = resolution.interpolation;
+
+        for (int i = 0; i <= numPoints; ++i)
+            values[static_cast<size_t>(i)] = static_cast<float>(i) / static_cast<float>(numPoints);
+
+        CurveKernel(curve).apply(values.data(), numPoints + 1);
+
+        auto exponent = FixedPoint::exponentFor(curve);
+
+        for (int i = 0; i <= maxPoints; ++i)
+            fixedValues[static_cast<size_t>(i)] = FixedPoint::shape(i << (FixedPoint::levelBits - maxPointBits), exponent, curve >= 0.0f);
+    }
+
+    Resolution getResolution() const
+    {
+        int bits = 0;
+        while ((1 << bits) < numPoints)
+            ++bits;
+
+        return {bits, interpolation};
+    }
+
+    // progress must be in 0..1
+    float evaluate(float progress) const
+    {
+        auto position = progress * static_cast<float>(numPoints);
+        auto index = std::min(static_cast<int>(position), numPoints - 1);
+        auto fraction = position - static_cast<float>(index);
+        auto i = static_cast<size_t>(index);
+
+        if (interpolation == Interpolation::linear)
+            return values[i] + fraction * (values[i + 1] - values[i]);
+
+        // Past either end the neighbour is extrapolated from the end segment
+        auto p1 = values[i];
+        auto p2 = values[i + 1];
+        auto p0 = index > 0 ? values[i - 1] : 2.0f * p1 - p2;
+        auto p3 = index < numPoints - 1 ? values[i + 2] : 2.0f * p2 - p1;
+
+        return p1 + 0.5f * fraction * ((p2 - p0) + fraction * ((2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) + fraction * (3.0f * (p1 - p2) + p3 - p0)));
+    }
+
+    // Largest difference between evaluate and the exact shape, sampled between the points
+    float maxError() const
+    {
+        constexpr int samplesPerPoint = 8;
+        auto numSamples = numPoints * samplesPerPoint;
+        CurveKernel exact(curve);
+        float error = 0.0f;
+
+        for (int i = 1; i < numSamples; ++i)
+        {
+            auto progress = static_cast<float>(i) / static_cast<float>(numSamples);
+            error = std::max(error, std::abs(evaluate(progress) - exact(progress)));
+        }
+
+        return error;
+    }
+
+    // The smallest table that keeps within maxLevelError of the exact shape, as a fraction
+    // of the full bend, trying linear before cubic at each size since it is cheaper to read.
+    // Where none does, the most accurate. Builds every size it tries, so never from the
+    // audio thread.
+    static Resolution chooseResolution(float curve, float maxLevelError)
+    {
+        auto candidate = std::make_unique<CurveTable>();
+        Resolution best;
+        auto bestError = std::numeric_limits<float>::max();
+
+        for (int bits = minPointBits; bits <= maxPointBits; ++bits)
+        {
+            for (auto order : {Interpolation::linear, Interpolation::cubic})
+            {
+                candidate->build(curve, {bits, order});
+                auto error = candidate->maxError();
+
+                if (error <= maxLevelError)
+                    return {bits, order};
+
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = {bits, order};
+                }
+            }
+        }
+
+        return best;
+    }
+
+    // The table build makes for a whole-number curve, made at compile time: with an integer
+    // exponent the shape is multiplies only, the same ones CurveKernel does
+    static constexpr CurveTable integerCurve(int curveValue)
+    {
+        CurveTable table;
+        table.curve = static_cast<float>(curveValue);
+
+        auto power = 1 + (curveValue < 0 ? -curveValue : curveValue);
+        auto raise = [power](float x)
+        {
+            auto result = x;
+            for (int i = 1; i < power; ++i)
+                result *= x;
+            return result;
+        };
+
+        for (int i = 0; i <= maxPoints; ++i)
+        {
+            auto progress = static_cast<float>(i) / maxPoints;
+            table.values[static_cast<size_t>(i)] = curveValue >= 0 ? raise(progress) : 1.0f - raise(1.0f - progress);
+            table.fixedValues[static_cast<size_t>(i)] = FixedPoint::shape(i << (FixedPoint::levelBits - maxPointBits), power << FixedPoint::exponentBits,
+                                                                         curveValue >= 0);
+        }
+
+        return table;
+    }
+
+    // evaluate in integers, for progress in Q24 within 0..1; returns Q30
+    std::int32_t evaluateFixed(std::int64_t progress) const
+    {
+        constexpr int fractionBits = FixedPoint::progressBits - maxPointBits;
+        auto index = std::min(static_cast<int>(progress >> fractionBits), maxPoints - 1);
+        auto fraction = progress - (static_cast<std::int64_t>(index) << fractionBits);
+        auto i = static_cast<size_t>(index);
+        auto step = static_cast<std::int64_t>(fixedValues[i + 1]) - fixedValues[i];
+
+        return fixedValues[i] + static_cast<std::int32_t>((step * fraction + (std::int64_t{1} << (fractionBits - 1))) >> fractionBits);
+    }
+
+    // Inverse of evaluate, between the points: the least progress at which the shape reaches
+    // level. Every shape rises from 0 to 1, so the segment holding level is found by binary
+    // search; past 1 it returns 1.
+    float progressFor(float level) const
+    {
+        auto end = values.begin() + numPoints + 1;
+        auto upper = std::lower_bound(values.begin() + 1, end, level);
+        auto index = std::min(static_cast<int>(upper - values.begin()), numPoints) - 1;
+        auto i = static_cast<size_t>(index);
+        auto step = values[i + 1] - values[i];
+        auto fraction = step > 0.0f ? std::clamp((level - values[i]) / step, 0.0f, 1.0f) : 0.0f;
+
+        return (static_cast<float>(index) + fraction) / static_cast<float>(numPoints);
+    }
+
+    // Derivative of the shape with respect to progress, from the table segment
+    float slope(float progress) const
+    {
+        auto index = std::clamp(static_cast<int>(progress * static_cast<float>(numPoints)), 0, numPoints - 1);
+        auto i = static_cast<size_t>(index);
+
+        return (values[i + 1] - values[i]) * static_cast<float>(numPoints);
+    }
+};
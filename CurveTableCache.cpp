@@ -0,0 +1,122 @@
+#include "CurveTableCache.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    struct Tables
+    {
+        std::mutex lock;
+        std::unordered_map<std::uint64_t, CurveTableCache::Table> byCurve;
+        std::unordered_map<std::uint64_t, CurveTable::Resolution> chosen;
+    };
+
+    Tables &getTables()
+    {
+        static Tables tables;
+        return tables;
+    }
+
+    // The default curve and the whole-number ones the factory presets use, built by the
+    // compiler into read-only data, so instances on them start without building anything
+    constexpr std::array<CurveTable, 5> builtInTables{CurveTable::integerCurve(-2), CurveTable::integerCurve(-1), CurveTable::integerCurve(0),
+                                                      CurveTable::integerCurve(1), CurveTable::integerCurve(2)};
+
+    std::uint64_t makeKey(float first, std::uint32_t second)
+    {
+        // -0 and 0 build the same table
+        if (first == 0.0f)
+            first = 0.0f;
+
+        std::uint32_t bits;
+        std::memcpy(&bits, &first, sizeof(bits));
+        return bits | (static_cast<std::uint64_t>(second) << 32);
+    }
+}
+
+CurveTableCache::Table CurveTableCache::get(float curve, CurveTable::Resolution resolution)
+{
+    auto &tables = getTables();
+
+    if (curve == 0.0f)
+        curve = 0.0f;
+
+    // Built-in tables last as long as the process, so they go out without an owner, and
+    // without the lock
+    if (resolution == CurveTable::Resolution{})
+        for (const auto &builtIn : builtInTables)
+            if (builtIn.curve == curve)
+                return Table(Table(), &builtIn);
+
+    auto key = makeKey(curve, static_cast<std::uint32_t>(resolution.pointBits) | (static_cast<std::uint32_t>(resolution.interpolation) << 8));
+
+    std::lock_guard<std::mutex> lock(tables.lock);
+
+    auto &table = tables.byCurve[key];
+
+    if (table != nullptr)
+        return table;
+
+    auto built = std::make_shared<CurveTable>();
+    built->build(curve, resolution);
+    table = std::move(built);
+    auto result = table;
+
+    // Growing past the limit sweeps out every table only the cache still holds
+    if (tables.byCurve.size() > maxTables)
+    {
+        for (auto it = tables.byCurve.begin(); it != tables.byCurve.end();)
+            it = it->second.use_count() == 1 ? tables.byCurve.erase(it) : std::next(it);
+    }
+
+    return result;
+}
+
+CurveTableCache::Table CurveTableCache::get(float curve, float maxLevelError)
+{
+    auto &tables = getTables();
+    std::uint32_t errorBits;
+    std::memcpy(&errorBits, &maxLevelError, sizeof(errorBits));
+    auto key = makeKey(curve, errorBits);
+
+    CurveTable::Resolution resolution;
+    bool found;
+
+    {
+        std::lock_guard<std::mutex> lock(tables.lock);
+        auto it = tables.chosen.find(key);
+        found = it != tables.chosen.end();
+
+        if (found)
+            resolution = it->second;
+    }
+
+    // Chosen off the lock, since it builds a table at every size it tries; two threads
+    // choosing at once come to the same answer
+    if (!found)
+    {
+        resolution = CurveTable::chooseResolution(curve, maxLevelError);
+
+        std::lock_guard<std::mutex> lock(tables.lock);
+
+        // Choices are a few bytes, but a dragged curve makes one per value it passes
+        if (tables.chosen.size() >= maxChoices)
+            tables.chosen.clear();
+
+        tables.chosen.emplace(key, resolution);
+    }
+
+    return get(curve, resolution);
+}
+
+size_t CurveTableCache::getMemoryBytes()
+{
+    auto &tables = getTables();
+    std::lock_guard<std::mutex> lock(tables.lock);
+    return tables.byCurve.size() * sizeof(CurveTable);
+}
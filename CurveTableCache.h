@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "CurveTable.h"
+
+// Curve tables shared by every instance in the process, keyed by the curve value and
+// resolution they were built for, so fifty instances on the same curve hold one table between them.
+// Tables are immutable once built and reference counted; a table no instance uses any
+// more is kept until the cache holds more than maxTables, so instances that come and go
+// with the same settings find their tables still built. Safe from any thread, but it
+// locks and may allocate, so never from the audio thread.
+class CurveTableCache
+{
+public:
+    using Table = std::shared_ptr<const CurveTable>;
+
+    static Table get(float curve, CurveTable::Resolution resolution = {});
+
+    // The table at the smallest resolution within maxLevelError (see CurveTable::chooseResolution).
+    // The choice is remembered with the table, so only a new curve or error pays for it.
+    static Table get(float curve, float maxLevelError);
+
+    // Bytes held by the tables in the cache, whether or not any instance still uses them
+    static size_t getMemoryBytes();
+
+private:
+    static constexpr size_t maxTables = 32;
+    static constexpr size_t maxChoices = 1024;
+};
@@ -0,0 +1,93 @@
+#include "EditorLookAndFeel.h"
+
+namespace
+{
+  // The knob's geometry as LookAndFeel_V4 draws it
+  struct Geometry
+  {
+    juce::Point<float> centre;
+    float lineWidth;
+    float arcRadius;
+
+    Geometry(int width, int height)
+    {
+      auto bounds = juce::Rectangle<int>(width, height).toFloat().reduced(10.0f);
+      auto radius = juce::jmin(bounds.getWidth(), bounds.getHeight()) / 2.0f;
+
+      centre = bounds.getCentre();
+      lineWidth = juce::jmin(8.0f, radius * 0.5f);
+      arcRadius = radius - lineWidth * 0.5f;
+    }
+
+    void strokeArc(juce::Graphics &g, float from, float to) const
+    {
+      juce::Path arc;
+      arc.addCentredArc(centre.x, centre.y, arcRadius, arcRadius, 0.0f, from, to, true);
+      g.strokePath(arc, juce::PathStrokeType(lineWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+    }
+  };
+}
+
+size_t EditorLookAndFeel::getImageBytes(const juce::Image &image)
+{
+  if (image.isNull())
+    return 0;
+
+  const juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::readOnly);
+  return static_cast<size_t>(bitmap.lineStride) * static_cast<size_t>(image.getHeight());
+}
+
+size_t EditorLookAndFeel::getCacheBytes() const
+{
+  size_t bytes = 0;
+
+  for (const auto &face : faces)
+    bytes += getImageBytes(face.image);
+
+  return bytes;
+}
+
+const juce::Image &EditorLookAndFeel::getFace(int width, int height, float scale, juce::Colour colour, float startAngle, float endAngle)
+{
+  for (const auto &face : faces)
+    if (face.width == width && face.height == height && face.scale == scale && face.colour == colour.getARGB())
+      return face.image;
+
+  juce::Image image(juce::Image::ARGB, juce::jmax(1, juce::roundToInt(width * scale)), juce::jmax(1, juce::roundToInt(height * scale)), true);
+  juce::Graphics g(image);
+  g.addTransform(juce::AffineTransform::scale(scale));
+  g.setColour(colour);
+  Geometry(width, height).strokeArc(g, startAngle, endAngle);
+
+  faces.push_back({width, height, scale, colour.getARGB(), image});
+  return faces.back().image;
+}
+
+void EditorLookAndFeel::drawRotarySlider(juce::Graphics &g, int x, int y, int width, int height, float sliderPos,
+                                         float rotaryStartAngle, float rotaryEndAngle, juce::Slider &slider)
+{
+  auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+  const auto &face = getFace(width, height, scale, slider.findColour(juce::Slider::rotarySliderOutlineColourId), rotaryStartAngle, rotaryEndAngle);
+
+  g.drawImage(face, juce::Rectangle<int>(x, y, width, height).toFloat());
+
+  Geometry geometry(width, height);
+  auto toAngle = rotaryStartAngle + sliderPos * (rotaryEndAngle - rotaryStartAngle);
+
+  g.saveState();
+  g.addTransform(juce::AffineTransform::translation(static_cast<float>(x), static_cast<float>(y)));
+
+  if (slider.isEnabled())
+  {
+    g.setColour(slider.findColour(juce::Slider::rotarySliderFillColourId));
+    geometry.strokeArc(g, rotaryStartAngle, toAngle);
+  }
+
+  auto thumbWidth = geometry.lineWidth * 2.0f;
+  juce::Point<float> thumb(geometry.centre.x + geometry.arcRadius * std::cos(toAngle - juce::MathConstants<float>::halfPi),
+                           geometry.centre.y + geometry.arcRadius * std::sin(toAngle - juce::MathConstants<float>::halfPi));
+
+  g.setColour(slider.findColour(juce::Slider::thumbColourId));
+  g.fillEllipse(juce::Rectangle<float>(thumbWidth, thumbWidth).withCentre(thumb));
+  g.restoreState();
+}
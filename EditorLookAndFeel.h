@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Rotary sliders whose static face, the track, is rasterized once per size and pixel scale
+// and drawn as an image; only the value arc and the thumb are stroked on each repaint. The
+// faces are dropped when the editor is resized or its colours change.
+class EditorLookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+  void drawRotarySlider(juce::Graphics &, int x, int y, int width, int height, float sliderPos,
+                        float rotaryStartAngle, float rotaryEndAngle, juce::Slider &) override;
+
+  void clearCache() { faces.clear(); }
+  size_t getCacheBytes() const;
+
+  // Pixel memory of a cached image, none for a null one
+  static size_t getImageBytes(const juce::Image &);
+
+private:
+  struct Face
+  {
+    int width, height;
+    float scale;
+    juce::uint32 colour;
+    juce::Image image;
+  };
+
+  // One per knob size on screen, which is one for this editor
+  std::vector<Face> faces;
+
+  const juce::Image &getFace(int width, int height, float scale, juce::Colour colour, float startAngle, float endAngle);
+};
@@ -0,0 +1,62 @@
+#include "EngineApi.h"
+
+#include <cstddef>
+#include <new>
+#include "ChordBendEngine.h"
+
+// The C events and the engine's are the same layout, so buffers pass straight through
+static_assert(sizeof(bcs_event) == sizeof(ChordBendEngine::Event), "bcs_event must match ChordBendEngine::Event");
+static_assert(offsetof(bcs_event, data) == offsetof(ChordBendEngine::Event, data), "bcs_event must match ChordBendEngine::Event");
+
+struct bcs_engine
+{
+    explicit bcs_engine(double sampleRate) : engine(sampleRate) {}
+
+    ChordBendEngine engine;
+};
+
+extern "C"
+{
+    bcs_engine *bcs_engine_create(double sample_rate)
+    {
+        if (!(sample_rate > 0.0))
+            return nullptr;
+
+        return new (std::nothrow) bcs_engine(sample_rate);
+    }
+
+    void bcs_engine_destroy(bcs_engine *engine)
+    {
+        delete engine;
+    }
+
+    int bcs_engine_set_param(bcs_engine *engine, bcs_param param, float value)
+    {
+        return engine->engine.setParameter(static_cast<ChordBendEngine::Parameter>(param), value) ? 1 : 0;
+    }
+
+    float bcs_engine_get_param(const bcs_engine *engine, bcs_param param)
+    {
+        if (param < 0 || param >= static_cast<int>(ChordBendEngine::Parameter::numParameters))
+            return 0.0f;
+
+        return engine->engine.getParameter(static_cast<ChordBendEngine::Parameter>(param));
+    }
+
+    void bcs_engine_reset(bcs_engine *engine)
+    {
+        engine->engine.reset();
+    }
+
+    int bcs_engine_process(bcs_engine *engine, const bcs_event *input, int num_input,
+                           bcs_event *output, int output_capacity, int num_samples)
+    {
+        return engine->engine.process(reinterpret_cast<const ChordBendEngine::Event *>(input), num_input,
+                                      reinterpret_cast<ChordBendEngine::Event *>(output), output_capacity, num_samples);
+    }
+
+    int bcs_engine_get_num_dropped(const bcs_engine *engine)
+    {
+        return engine->engine.getNumDropped();
+    }
+}
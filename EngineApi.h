@@ -0,0 +1,62 @@
+#ifndef BCS_ENGINE_API_H
+#define BCS_ENGINE_API_H
+
+/* The chord bend engine (ChordBendEngine) behind a plain C interface, for audio engines and
+   middleware plugin wrappers (Wwise, FMOD) that can't take C++ or JUCE. Link the
+   BetterChordStacksEngine static library. The engine allocates when it is created and
+   never again; the caller owns every event buffer. One engine is used from one thread at a
+   time, with parameters set between blocks. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct bcs_engine bcs_engine;
+
+/* One MIDI 1.0 message of one to three bytes, at a sample within the block */
+typedef struct bcs_event
+{
+    uint32_t sample_offset;
+    uint8_t size;
+    uint8_t data[3];
+} bcs_event;
+
+typedef enum bcs_param
+{
+    BCS_PARAM_BEND_AMOUNT = 0,        /* Of the bend range, 0 to 2 */
+    BCS_PARAM_BEND_TIME = 1,          /* Seconds, 0.01 to 2 */
+    BCS_PARAM_BEND_CURVE = 2,         /* -2 to 2 */
+    BCS_PARAM_BEND_RANGE = 3,         /* Semitones, 1 to 96 */
+    BCS_PARAM_ZONE_CHANNELS = 4,      /* MPE member channels, 1 to 15 */
+    BCS_PARAM_UPDATE_INTERVAL_MS = 5, /* 0.02 to 20 */
+    BCS_PARAM_STEAL_POLICY = 6,       /* 0 oldest, 1 quietest, 2 same note */
+    BCS_PARAM_NOTE_PRIORITY = 7,      /* 0 last, 1 highest, 2 lowest */
+    BCS_PARAM_FIXED_POINT = 8         /* 1 for integer bends, the same on every CPU */
+} bcs_param;
+
+/* Returns null if the engine can't be made */
+bcs_engine *bcs_engine_create(double sample_rate);
+void bcs_engine_destroy(bcs_engine *engine);
+
+/* Returns 0 for an unknown parameter; values are clamped to their ranges */
+int bcs_engine_set_param(bcs_engine *engine, bcs_param param, float value);
+float bcs_engine_get_param(const bcs_engine *engine, bcs_param param);
+
+/* Ends every voice silently; the next block starts with the MPE zone configuration */
+void bcs_engine_reset(bcs_engine *engine);
+
+/* Runs one block. input holds num_input events in time order; up to output_capacity events
+   are written to output, in time order, and their number returned. */
+int bcs_engine_process(bcs_engine *engine, const bcs_event *input, int num_input,
+                       bcs_event *output, int output_capacity, int num_samples);
+
+/* Output events dropped for want of room since the last reset */
+int bcs_engine_get_num_dropped(const bcs_engine *engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// std::pow(x, exponent) for x in 0..1 and exponent of 1 or more, as exp2(exponent * log2(x))
+// with short polynomials for both halves and no libm call. The result is within 3e-7 of the
+// exact power, under 0.003 of a 14-bit bend step at full range, which the benchmark checks
+// again against std::pow on the machine it runs on.
+inline float fastPow(float x, float exponent)
+{
+    // Clamps and selects work on the bits, as float comparisons would keep compilers that
+    // honour floating-point traps from vectorising loops over this
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+
+    // Anything below the smallest normal float raises to nothing in a bend anyway
+    bits = std::max(bits, 0x00800000u);
+
+    // x = m * 2^k with m in sqrt(1/2)..sqrt(2), so the series below stays short
+    auto k = static_cast<int>(bits >> 23) - 127;
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+    auto high = static_cast<std::uint32_t>(bits > 0x3fb504f3u);
+    bits -= high << 23;
+    k += static_cast<int>(high);
+
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+
+    // ln m = 2 atanh(t), to the t^7 term
+    auto t = (m - 1.0f) / (m + 1.0f);
+    auto t2 = t * t;
+    auto lnM = 2.0f * t * (1.0f + t2 * (1.0f / 3.0f + t2 * (1.0f / 5.0f + t2 * (1.0f / 7.0f))));
+
+    auto y = exponent * (static_cast<float>(k) + lnM * 1.44269504f);
+
+    // 2^y = 2^n * 2^f with f in -0.5..0.5; y is never positive, so truncation rounds
+    auto n = static_cast<int>(y - 0.5f);
+    auto f = y - static_cast<float>(n);
+
+    // Taylor series of e^(f ln 2) to the sixth power
+    auto p = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f + f * (0.00961812911f + f * (0.00133335581f + f * 0.000154035304f)))));
+
+    // Below 2^-126 the scale, and with it the result, is 0
+    auto scaleBits = static_cast<std::uint32_t>(std::max(n + 127, 0)) << 23;
+    float scale;
+    std::memcpy(&scale, &scaleBits, sizeof(scale));
+
+    return p * scale;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Small PCG32 generator for the audio thread: no allocation, no locks, and the same
+// sequence for the same seed on every platform, so offline renders come out identical.
+class FastRandom
+{
+public:
+    explicit FastRandom(std::uint64_t seed)
+    {
+        // SplitMix64 spreads nearby seeds, such as consecutive sample positions, apart
+        seed += 0x9e3779b97f4a7c15ull;
+        seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+        seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+        state = seed ^ (seed >> 31);
+        nextInt();
+    }
+
+    std::uint32_t nextInt()
+    {
+        auto old = state;
+        state = old * 6364136223846793005ull + 1442695040888963407ull;
+
+        auto shifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        auto rotation = static_cast<std::uint32_t>(old >> 59);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+
+    // Uniform in -1..1
+    float nextBipolar()
+    {
+        return static_cast<float>(nextInt() >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
+
+private:
+    std::uint64_t state = 0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Integer bend shapes for the fixed-point engine. Floats are only reproducible for the basic
+// operations: std::pow differs between libm builds, and compilers fuse multiplies and adds
+// differently on x86 and ARM, so the float engine can land a bend on the neighbouring step
+// on another machine. Everything here is exact integer arithmetic, with levels in Q30
+// (1 << 30 is the full rise), progress in Q24 and exponents in Q16, so the same inputs give
+// the same bends everywhere.
+namespace FixedPoint
+{
+    constexpr int levelBits = 30;
+    constexpr std::int32_t one = std::int32_t{1} << levelBits;
+    constexpr int progressBits = 24;
+    constexpr std::int64_t fullProgress = std::int64_t{1} << progressBits;
+    constexpr int exponentBits = 16;
+
+    // Bends are worked out in 1/256 of a step, and truncated to whole steps at the end as the
+    // float engine does
+    constexpr int bendFractionBits = 8;
+
+    // 2^-(1/2^(k+1)) in Q31, correctly rounded: the factors exp2 multiplies together
+    constexpr std::array<std::uint32_t, 30> inverseRoots{
+        1518500250u, 1805811301u, 1969251188u, 2056437387u, 2101467502u,
+        2124350982u, 2135885998u, 2141676973u, 2144578345u, 2146030505u,
+        2146756953u, 2147120270u, 2147301951u, 2147392798u, 2147438222u,
+        2147460935u, 2147472292u, 2147477970u, 2147480809u, 2147482228u,
+        2147482938u, 2147483293u, 2147483471u, 2147483559u, 2147483604u,
+        2147483626u, 2147483637u, 2147483642u, 2147483645u, 2147483647u,
+    };
+
+    // The Q16 exponent for a bendCurve value, 1 + |curve|. Scaling by a power of two is
+    // exact, so this is the one float step and it rounds the same everywhere.
+    inline std::int32_t exponentFor(float curve)
+    {
+        return static_cast<std::int32_t>(std::lround((1.0 + std::abs(static_cast<double>(curve))) * (1 << exponentBits)));
+    }
+
+    // elapsed over duration in Q24, clamped to 0..1
+    constexpr std::int64_t progress(std::int64_t elapsed, std::int64_t duration)
+    {
+        if (elapsed <= 0)
+            return 0;
+        if (elapsed >= duration)
+            return fullProgress;
+        return (elapsed << progressBits) / duration;
+    }
+
+    constexpr std::int32_t multiply(std::int32_t a, std::int32_t b)
+    {
+        return static_cast<std::int32_t>((static_cast<std::int64_t>(a) * b + (one >> 1)) >> levelBits);
+    }
+
+    // -log2(x) in Q30 for x in Q30, 0 < x <= 1, a bit at a time by repeated squaring
+    constexpr std::int64_t negativeLog2(std::int32_t x)
+    {
+        // x = m * 2^-shift with m in 1..2
+        int shift = 0;
+        auto m = static_cast<std::uint64_t>(x);
+
+        while (m < (std::uint64_t{1} << levelBits))
+        {
+            m <<= 1;
+            ++shift;
+        }
+
+        std::int64_t fraction = 0;
+
+        for (int bit = levelBits - 1; bit >= 0; --bit)
+        {
+            m = (m * m) >> levelBits;
+
+            if (m >= (std::uint64_t{2} << levelBits))
+            {
+                m >>= 1;
+                fraction |= std::int64_t{1} << bit;
+            }
+        }
+
+        return (static_cast<std::int64_t>(shift) << levelBits) - fraction;
+    }
+
+    // 2^-y in Q30 for y in Q30, y >= 0, as a product of the inverse roots for y's bits
+    constexpr std::int32_t exp2Negative(std::int64_t y)
+    {
+        auto whole = y >> levelBits;
+
+        if (whole > levelBits)
+            return 0;
+
+        auto fraction = y & (one - 1);
+        std::uint64_t result = std::uint64_t{1} << 31;
+
+        for (int k = 0; k < levelBits; ++k)
+            if ((fraction >> (levelBits - 1 - k)) & 1)
+                result = (result * inverseRoots[static_cast<size_t>(k)] + (std::uint64_t{1} << 30)) >> 31;
+
+        // Q31 to Q30, scaled by 2^-whole
+        auto shift = static_cast<int>(whole) + 1;
+        return static_cast<std::int32_t>((result + (std::uint64_t{1} << (shift - 1))) >> shift);
+    }
+
+    // x raised to a Q16 exponent, for x in Q30 within 0..1
+    constexpr std::int32_t pow(std::int32_t x, std::int32_t exponent)
+    {
+        if (x <= 0)
+            return 0;
+        if (x >= one)
+            return one;
+
+        // Integer exponents are multiplies, exact to the last bit like CurveKernel's
+        switch (exponent)
+        {
+            case 1 << exponentBits:
+                return x;
+            case 2 << exponentBits:
+                return multiply(x, x);
+            case 3 << exponentBits:
+                return multiply(multiply(x, x), x);
+            case 4 << exponentBits:
+            {
+                auto square = multiply(x, x);
+                return multiply(square, square);
+            }
+            default:
+                return exp2Negative((negativeLog2(x) * exponent) >> exponentBits);
+        }
+    }
+
+    // The bend shape at progress in Q30: progress raised to the exponent, or mirrored for
+    // negative curves, as CurveKernel shapes it
+    constexpr std::int32_t shape(std::int32_t progress, std::int32_t exponent, bool rising)
+    {
+        return rising ? pow(progress, exponent) : one - pow(one - progress, exponent);
+    }
+}
@@ -0,0 +1,172 @@
+#include "FlightRecorder.h"
+
+class FlightRecorder::Writer : public juce::Thread
+{
+public:
+    explicit Writer(FlightRecorder &recorder) : juce::Thread("Flight recorder writer"), owner(recorder) {}
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            owner.writePending();
+            wait(100);
+        }
+    }
+
+private:
+    FlightRecorder &owner;
+};
+
+FlightRecorder::FlightRecorder() = default;
+
+FlightRecorder::~FlightRecorder()
+{
+    stop();
+}
+
+bool FlightRecorder::start(const juce::File &directory)
+{
+    stop();
+
+    if (!directory.createDirectory())
+        return false;
+
+    // Allocated on first use only, so instances that never record don't carry the history
+    if (history.empty())
+    {
+        history.resize(static_cast<size_t>(historySize));
+        snapshots = std::make_unique<Snapshot[]>(static_cast<size_t>(numSnapshots));
+    }
+
+    nextRecord = 0;
+    numRecorded = 0;
+    numReports = 0;
+    numMissed = 0;
+    reportDirectory = directory;
+
+    writer = std::make_unique<Writer>(*this);
+    writer->startThread(juce::Thread::Priority::low);
+
+    recording.store(true, std::memory_order_release);
+    return true;
+}
+
+void FlightRecorder::stop()
+{
+    recording.store(false, std::memory_order_release);
+
+    if (writer == nullptr)
+        return;
+
+    writer->stopThread(1000);
+    writer.reset();
+
+    writePending();
+}
+
+void FlightRecorder::record(const FlightRecord &block, bool overran)
+{
+    if (!isRecording())
+        return;
+
+    history[nextRecord] = block;
+    nextRecord = (nextRecord + 1) % history.size();
+    ++numRecorded;
+
+    if (!overran)
+        return;
+
+    for (int i = 0; i < numSnapshots; ++i)
+    {
+        auto &snapshot = snapshots[static_cast<size_t>(i)];
+
+        if (snapshot.full.load(std::memory_order_acquire))
+            continue;
+
+        // The ring from its oldest record, which is the next to be overwritten
+        auto numBlocks = std::min(static_cast<size_t>(numRecorded), static_cast<size_t>(history.size()));
+        auto oldest = (nextRecord + history.size() - numBlocks) % history.size();
+        auto firstPart = juce::jmin(numBlocks, history.size() - oldest);
+
+        std::copy_n(history.begin() + static_cast<std::ptrdiff_t>(oldest), firstPart, snapshot.blocks.begin());
+        std::copy_n(history.begin(), numBlocks - firstPart, snapshot.blocks.begin() + static_cast<std::ptrdiff_t>(firstPart));
+        snapshot.numBlocks = static_cast<int>(numBlocks);
+
+        snapshot.full.store(true, std::memory_order_release);
+        return;
+    }
+
+    numMissed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FlightRecorder::writePending()
+{
+    if (snapshots == nullptr)
+        return;
+
+    for (int i = 0; i < numSnapshots; ++i)
+    {
+        auto &snapshot = snapshots[static_cast<size_t>(i)];
+
+        if (!snapshot.full.load(std::memory_order_acquire))
+            continue;
+
+        if (writeReport(snapshot))
+            numReports.fetch_add(1, std::memory_order_relaxed);
+
+        snapshot.full.store(false, std::memory_order_release);
+    }
+}
+
+bool FlightRecorder::writeReport(const Snapshot &snapshot)
+{
+    if (snapshot.numBlocks == 0)
+        return false;
+
+    const auto &overrun = snapshot.blocks[static_cast<size_t>(snapshot.numBlocks - 1)];
+
+    // The wall clock time of the overrun, from how long ago it finished
+    auto secondsAgo = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - overrun.endTicks);
+    auto when = juce::Time::getCurrentTime() - juce::RelativeTime::seconds(secondsAgo);
+
+    auto reportFile = reportDirectory.getChildFile("overrun-" + when.formatted("%Y-%m-%d_%H-%M-%S") + ".csv").getNonexistentSibling();
+    juce::FileOutputStream out(reportFile);
+
+    if (!out.openedOk())
+        return false;
+
+    auto microseconds = [](float seconds) { return juce::String(juce::roundToInt(seconds * 1.0e6f)); };
+    auto percent = [](const FlightRecord &block)
+    {
+        return juce::String(block.blockSeconds > 0.0f ? block.processSeconds / block.blockSeconds * 100.0f : 0.0f, 1);
+    };
+
+    out << "# Better Chord Stacks block overrun at " << when.toString(true, true, true, true) << "\n"
+        << "# Block at sample " << juce::String(overrun.sample) << " took " << microseconds(overrun.processSeconds) << " us for "
+        << microseconds(overrun.blockSeconds) << " us of audio (" << percent(overrun) << "%)\n"
+        << "# The " << juce::String(snapshot.numBlocks) << " blocks up to it, oldest first; times in us\n"
+        << "sample,load %,process,block,setup,decode,events,bends,output,input events,output events,bends sent,voices,quality level\n";
+
+    for (int i = 0; i < snapshot.numBlocks; ++i)
+    {
+        const auto &block = snapshot.blocks[static_cast<size_t>(i)];
+        out << juce::String(block.sample) << "," << percent(block) << "," << microseconds(block.processSeconds) << ","
+            << microseconds(block.blockSeconds);
+
+        for (auto seconds : block.phaseSeconds)
+            out << "," << microseconds(seconds);
+
+        out << "," << juce::String(block.inputEvents) << "," << juce::String(block.outputEvents) << ","
+            << juce::String(block.bendsSent) << "," << juce::String(block.activeVoices) << ","
+            << juce::String(block.qualityLevel) << "\n";
+    }
+
+    out.flush();
+    return out.getStatus().wasOk();
+}
+
+size_t FlightRecorder::getMemoryBytes() const
+{
+    return history.capacity() * sizeof(FlightRecord) + (snapshots != nullptr ? numSnapshots * sizeof(Snapshot) : 0);
+}
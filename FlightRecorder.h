@@ -0,0 +1,88 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// What one block did, as the flight recorder keeps it
+struct FlightRecord
+{
+    enum Phase
+    {
+        setup,  // Parameters, configuration and zones
+        decode, // Reading the input into events
+        events, // Notes, scheduled events and pass-through
+        bends,  // The bend passes between events
+        output, // Copying the output out, ordering and tracing it
+        numPhases
+    };
+
+    juce::int64 sample = 0;   // The block's first sample, counted from prepareToPlay
+    juce::int64 endTicks = 0; // juce::Time high-resolution ticks when it finished
+    float processSeconds = 0.0f;
+    float blockSeconds = 0.0f;
+    std::array<float, numPhases> phaseSeconds{};
+    juce::uint16 inputEvents = 0;
+    juce::uint16 outputEvents = 0;
+    juce::uint16 bendsSent = 0;
+    juce::uint8 activeVoices = 0;
+    juce::uint8 qualityLevel = 0;
+};
+
+// Why a block overran, found out after the show: the audio thread keeps the last
+// historySize blocks in a ring, and a block that takes longer than the audio it covers
+// freezes the ring into a snapshot. A background thread writes each snapshot out as a
+// report file, one per overrun. Recording a block copies one record; freezing copies the
+// ring into a preallocated snapshot and publishes it with one atomic store, with no system
+// call, lock or allocation. An overrun that finds every snapshot still waiting for the
+// writer is counted instead.
+class FlightRecorder
+{
+public:
+    static constexpr int historySize = 256;
+    static constexpr int numSnapshots = 4;
+
+    FlightRecorder();
+    ~FlightRecorder();
+
+    // Message thread. Reports are written into directory, which is created if need be.
+    bool start(const juce::File &directory);
+    void stop();
+    bool isRecording() const { return recording.load(std::memory_order_acquire); }
+
+    // Audio thread
+    void record(const FlightRecord &block, bool overran);
+
+    int getNumReports() const { return numReports.load(std::memory_order_relaxed); }
+    int getNumMissed() const { return numMissed.load(std::memory_order_relaxed); }
+
+    // Message thread
+    size_t getMemoryBytes() const;
+
+private:
+    class Writer;
+
+    struct Snapshot
+    {
+        std::array<FlightRecord, historySize> blocks; // Oldest first, the overrun last
+        int numBlocks = 0;
+        std::atomic<bool> full{false};
+    };
+
+    void writePending();
+    bool writeReport(const Snapshot &snapshot);
+
+    // Allocated on the first start and kept, so a block still recording when it stops
+    // never writes into freed memory
+    std::vector<FlightRecord> history;
+    std::unique_ptr<Snapshot[]> snapshots;
+    size_t nextRecord = 0;
+    juce::uint64 numRecorded = 0;
+
+    std::atomic<bool> recording{false};
+    std::atomic<int> numReports{0};
+    std::atomic<int> numMissed{0};
+
+    juce::File reportDirectory;
+    std::unique_ptr<Writer> writer;
+
+    JUCE_DECLARE_NON_COPYABLE(FlightRecorder)
+};
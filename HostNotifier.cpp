@@ -0,0 +1,68 @@
+#include "HostNotifier.h"
+
+HostNotifier::HostNotifier(juce::AudioProcessor &processor)
+    : owner(processor), numParameters(processor.getParameters().size())
+{
+    pending = std::make_unique<std::atomic<bool>[]>(static_cast<size_t>(numParameters));
+}
+
+void HostNotifier::setParameter(juce::RangedAudioParameter &parameter, float normalisedValue)
+{
+    auto index = parameter.getParameterIndex();
+    jassert(index >= 0 && index < numParameters);
+
+    static_cast<juce::AudioProcessorParameter &>(parameter).setValue(normalisedValue);
+
+    if (onValueSet != nullptr)
+        onValueSet(parameter);
+
+    pending[static_cast<size_t>(index)].store(true, std::memory_order_relaxed);
+    anyPending.store(true, std::memory_order_release);
+}
+
+void HostNotifier::updateDisplay(const juce::AudioProcessor::ChangeDetails &details)
+{
+    juce::uint32 changes = (details.latencyChanged ? latencyChanged : 0u) | (details.parameterInfoChanged ? parameterInfoChanged : 0u)
+                           | (details.programChanged ? programChanged : 0u)
+                           | (details.nonParameterStateChanged ? nonParameterStateChanged : 0u);
+
+    displayChanges.fetch_or(changes, std::memory_order_release);
+}
+
+void HostNotifier::flushIfDue()
+{
+    auto now = juce::Time::getMillisecondCounterHiRes();
+
+    if (now - lastFlushMs < minFlushIntervalMs)
+        return;
+
+    if (anyPending.load(std::memory_order_acquire) || displayChanges.load(std::memory_order_acquire) != 0)
+    {
+        flush();
+        lastFlushMs = now;
+    }
+}
+
+void HostNotifier::flush()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    // Cleared before the sweep, so a value set during it is caught by the next one
+    if (anyPending.exchange(false, std::memory_order_acquire))
+    {
+        const auto &parameters = owner.getParameters();
+
+        for (int i = 0; i < numParameters; ++i)
+            if (pending[static_cast<size_t>(i)].exchange(false, std::memory_order_relaxed))
+                parameters[i]->sendValueChangedMessageToListeners(parameters[i]->getValue());
+    }
+
+    if (auto changes = displayChanges.exchange(0, std::memory_order_acquire))
+    {
+        owner.updateHostDisplay(juce::AudioProcessor::ChangeDetails()
+                                    .withLatencyChanged((changes & latencyChanged) != 0)
+                                    .withParameterInfoChanged((changes & parameterInfoChanged) != 0)
+                                    .withProgramChanged((changes & programChanged) != 0)
+                                    .withNonParameterStateChanged((changes & nonParameterStateChanged) != 0));
+    }
+}
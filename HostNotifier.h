@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Every notification the plugin gives its host, batched: parameter values it sets itself
+// (presets, MIDI learn, restored state, meters) and display changes. Values and display
+// changes can be posted from any thread, the audio thread included, without a lock or an
+// allocation; the host hears of them only from flush on the message thread, which sends
+// each changed parameter once with its latest value and merges the display changes into
+// one updateHostDisplay. flushIfDue keeps that to one batch every minFlushIntervalMs,
+// however many changes are posted, so hundreds of instances loading a template or moving
+// their meters cost each host a bounded number of calls.
+class HostNotifier
+{
+public:
+    static constexpr double minFlushIntervalMs = 50.0;
+
+    // The processor's parameters must all be added by now
+    explicit HostNotifier(juce::AudioProcessor &processor);
+
+    // Any thread. The parameter takes the value at once, so the processor and its state
+    // see it; the host and the parameter's listeners hear of it at the next flush
+    void setParameter(juce::RangedAudioParameter &parameter, float normalisedValue);
+
+    // Any thread; merged with any others until the next flush
+    void updateDisplay(const juce::AudioProcessor::ChangeDetails &details);
+
+    // Message thread. flushIfDue sends what is pending unless the last batch went less than
+    // minFlushIntervalMs ago; flush sends it now
+    void flushIfDue();
+    void flush();
+
+    // Called right after setParameter sets a value, on its thread, for whatever must know
+    // sooner than the next flush; real time safe if the audio thread sets parameters
+    std::function<void(juce::RangedAudioParameter &)> onValueSet;
+
+private:
+    enum DisplayChange : juce::uint32
+    {
+        latencyChanged = 1,
+        parameterInfoChanged = 2,
+        programChanged = 4,
+        nonParameterStateChanged = 8
+    };
+
+    juce::AudioProcessor &owner;
+    std::unique_ptr<std::atomic<bool>[]> pending; // By parameter index
+    int numParameters;
+    std::atomic<bool> anyPending{false};
+    std::atomic<juce::uint32> displayChanges{0};
+    double lastFlushMs = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE(HostNotifier)
+};
@@ -0,0 +1,144 @@
+#include "KernelDispatch.h"
+
+#include <array>
+#include <cmath>
+#include "CurveTable.h"
+
+// Per-function target attributes are GCC and Clang only; MSVC builds keep the baseline
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+ #define BCS_X86_DISPATCH 1
+ #define BCS_KERNEL_TARGET(isa) __attribute__((target(isa), flatten))
+#else
+ #define BCS_X86_DISPATCH 0
+#endif
+
+namespace
+{
+    template <int power, bool rising>
+    inline void shapeLoop(float *values, int numValues, float exponent)
+    {
+        for (int i = 0; i < numValues; ++i)
+            values[i] = CurveKernel::shapeOne<power, rising>(values[i], exponent);
+    }
+
+    // CurveKernel's selection, with the approximate general case: whole exponents multiply
+    inline void shapeCurveBody(float *values, int numValues, float curve)
+    {
+        auto exponent = 1.0f + std::abs(curve);
+        auto rising = curve >= 0.0f;
+
+        if (exponent == 1.0f)
+            return;
+
+        if (exponent == 2.0f)
+            rising ? shapeLoop<2, true>(values, numValues, exponent) : shapeLoop<2, false>(values, numValues, exponent);
+        else if (exponent == 3.0f)
+            rising ? shapeLoop<3, true>(values, numValues, exponent) : shapeLoop<3, false>(values, numValues, exponent);
+        else if (exponent == 4.0f)
+            rising ? shapeLoop<4, true>(values, numValues, exponent) : shapeLoop<4, false>(values, numValues, exponent);
+        else
+            rising ? shapeLoop<-1, true>(values, numValues, exponent) : shapeLoop<-1, false>(values, numValues, exponent);
+    }
+
+    inline void applyVibratoBody(const Vibrato &vibrato, const float *elapsed, const float *phaseOffsets, float *values, int numValues)
+    {
+        vibrato.apply(elapsed, phaseOffsets, values, numValues);
+    }
+
+    void shapeCurveBaseline(float *values, int numValues, float curve)
+    {
+        shapeCurveBody(values, numValues, curve);
+    }
+
+    void applyVibratoBaseline(const Vibrato &vibrato, const float *elapsed, const float *phaseOffsets, float *values, int numValues)
+    {
+        applyVibratoBody(vibrato, elapsed, phaseOffsets, values, numValues);
+    }
+
+#if BCS_X86_DISPATCH
+    // The same bodies again, inlined into functions the compiler may use these sets for.
+    // FMA is left out on purpose: fused multiply-adds round differently.
+    BCS_KERNEL_TARGET("sse4.1") void shapeCurveSse4(float *values, int numValues, float curve)
+    {
+        shapeCurveBody(values, numValues, curve);
+    }
+
+    BCS_KERNEL_TARGET("sse4.1") void applyVibratoSse4(const Vibrato &vibrato, const float *elapsed, const float *phaseOffsets, float *values, int numValues)
+    {
+        applyVibratoBody(vibrato, elapsed, phaseOffsets, values, numValues);
+    }
+
+    BCS_KERNEL_TARGET("avx2") void shapeCurveAvx2(float *values, int numValues, float curve)
+    {
+        shapeCurveBody(values, numValues, curve);
+    }
+
+    BCS_KERNEL_TARGET("avx2") void applyVibratoAvx2(const Vibrato &vibrato, const float *elapsed, const float *phaseOffsets, float *values, int numValues)
+    {
+        applyVibratoBody(vibrato, elapsed, phaseOffsets, values, numValues);
+    }
+#endif
+
+    constexpr std::array<KernelDispatch::Kernels, static_cast<size_t>(KernelDispatch::Level::numLevels)> kernelsByLevel{{
+        {&shapeCurveBaseline, &applyVibratoBaseline},
+#if BCS_X86_DISPATCH
+        {&shapeCurveSse4, &applyVibratoSse4},
+        {&shapeCurveAvx2, &applyVibratoAvx2},
+#else
+        {&shapeCurveBaseline, &applyVibratoBaseline},
+        {&shapeCurveBaseline, &applyVibratoBaseline},
+#endif
+    }};
+}
+
+namespace KernelDispatch
+{
+    bool isSupported(Level level)
+    {
+        switch (level)
+        {
+            case Level::baseline:
+                return true;
+#if BCS_X86_DISPATCH
+            case Level::sse4:
+                return __builtin_cpu_supports("sse4.1");
+            case Level::avx2:
+                return __builtin_cpu_supports("avx2");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    Level detect()
+    {
+        if (isSupported(Level::avx2))
+            return Level::avx2;
+        if (isSupported(Level::sse4))
+            return Level::sse4;
+        return Level::baseline;
+    }
+
+    const Kernels &get(Level level)
+    {
+        // A level the CPU can't run falls back rather than fault
+        return kernelsByLevel[static_cast<size_t>(isSupported(level) ? level : Level::baseline)];
+    }
+
+    const char *getName(Level level)
+    {
+        switch (level)
+        {
+            case Level::sse4:
+                return "sse4";
+            case Level::avx2:
+                return "avx2";
+            default:
+#if defined(__aarch64__) || defined(__arm__)
+                return "neon";
+#else
+                return "baseline";
+#endif
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Vibrato.h"
+
+// The vectorised loops of the bend pass, compiled once per instruction set and picked at
+// run time, so one binary uses AVX2 on the machines that have it and still loads on the ones
+// that don't. Every variant does the same float operations lane by lane and none fuse a
+// multiply into an add, so they all give the same results. On ARM, NEON is part of the base
+// instruction set and there is only the one variant.
+namespace KernelDispatch
+{
+    enum class Level
+    {
+        baseline, // SSE2 on x86-64, NEON on ARM
+        sse4,
+        avx2,
+        numLevels
+    };
+
+    struct Kernels
+    {
+        // CurveKernel's shape with fastPow, for numValues progress values in place
+        void (*shapeCurve)(float *values, int numValues, float curve);
+
+        // Vibrato::apply
+        void (*applyVibrato)(const Vibrato &vibrato, const float *elapsed, const float *phaseOffsets, float *values, int numValues);
+    };
+
+    // The widest level this CPU runs
+    Level detect();
+    bool isSupported(Level level);
+
+    const Kernels &get(Level level);
+    const char *getName(Level level);
+}
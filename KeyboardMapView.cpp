@@ -0,0 +1,139 @@
+#include "KeyboardMapView.h"
+
+namespace
+{
+  int countWhiteKeys(int fromNote, int toNote)
+  {
+    int count = 0;
+
+    for (int note = fromNote; note < toNote; ++note)
+      count += juce::MidiMessage::isMidiNoteBlack(note) ? 0 : 1;
+
+    return count;
+  }
+}
+
+KeyboardMapView::KeyboardMapView(PitchBendProcessor &p)
+    : audioProcessor(p)
+{
+  setOpaque(true);
+}
+
+bool KeyboardMapView::isBlackKey(int note)
+{
+  return juce::MidiMessage::isMidiNoteBlack(note);
+}
+
+juce::Rectangle<float> KeyboardMapView::getKeyboardArea() const
+{
+  return getLocalBounds().toFloat().withTrimmedBottom(channelRowHeight);
+}
+
+juce::Rectangle<float> KeyboardMapView::getKeyBounds(int note) const
+{
+  auto area = getKeyboardArea();
+  auto keyWidth = area.getWidth() / static_cast<float>(countWhiteKeys(lowestNote, highestNote + 1));
+  auto x = area.getX() + keyWidth * static_cast<float>(countWhiteKeys(lowestNote, note));
+
+  // A black key straddles the line between the white keys either side of it
+  if (isBlackKey(note))
+    return {x - keyWidth * 0.35f, area.getY(), keyWidth * 0.7f, area.getHeight() * 0.6f};
+
+  return {x, area.getY(), keyWidth, area.getHeight()};
+}
+
+void KeyboardMapView::renderKeysImage(float scale)
+{
+  keysImage = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(getWidth() * scale)),
+                          juce::jmax(1, juce::roundToInt(getHeight() * scale)), false);
+
+  juce::Graphics g(keysImage);
+  g.addTransform(juce::AffineTransform::scale(scale));
+  g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId).darker(0.3f));
+
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    for (int note = lowestNote; note <= highestNote; ++note)
+    {
+      if (isBlackKey(note) != (pass == 1))
+        continue;
+
+      auto key = getKeyBounds(note);
+      g.setColour(pass == 0 ? juce::Colours::white.darker(0.1f) : juce::Colours::black);
+      g.fillRect(key.reduced(0.5f, 0.0f));
+    }
+  }
+}
+
+void KeyboardMapView::paint(juce::Graphics &g)
+{
+  auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+  if (keysImage.isNull() || keysImage.getWidth() != juce::roundToInt(getWidth() * scale))
+    renderKeysImage(scale);
+
+  g.drawImage(keysImage, getLocalBounds().toFloat());
+
+  // White keys first, so lit black keys stay on top of them
+  g.setFont(juce::FontOptions(9.0f));
+
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    for (auto mask = map.activeMask; mask != 0; mask &= mask - 1)
+    {
+      auto slot = lowestSetBit(mask);
+      int note = map.note[static_cast<size_t>(slot)];
+
+      if (note < lowestNote || note > highestNote || isBlackKey(note) != (pass == 1))
+        continue;
+
+      auto releasing = ((map.releasingMask >> slot) & 1u) != 0;
+      auto key = getKeyBounds(note).reduced(0.5f, 0.0f);
+
+      g.setColour(juce::Colours::orange.withAlpha(releasing ? 0.5f : 1.0f));
+      g.fillRect(key);
+      g.setColour(juce::Colours::black);
+      g.drawText(juce::String(slot + 1), key.removeFromBottom(12.0f), juce::Justification::centred, false);
+    }
+  }
+
+  // The channel row: note and bend in semitones on each member channel
+  auto row = getLocalBounds().toFloat().removeFromBottom(channelRowHeight);
+  auto cellWidth = row.getWidth() / 16.0f;
+
+  for (int slot = 0; slot < 16; ++slot)
+  {
+    auto cell = row.removeFromLeft(cellWidth).reduced(1.0f);
+    auto i = static_cast<size_t>(slot);
+
+    if (((map.activeMask >> slot) & 1u) == 0)
+    {
+      g.setColour(juce::Colours::white.withAlpha(0.25f));
+      g.drawText(juce::String(slot + 1), cell, juce::Justification::centred, false);
+      continue;
+    }
+
+    g.setColour(juce::Colours::orange.withAlpha(((map.releasingMask >> slot) & 1u) != 0 ? 0.5f : 1.0f));
+    g.fillRect(cell);
+    g.setColour(juce::Colours::black);
+    g.drawText(juce::MidiMessage::getMidiNoteName(map.note[i], true, true, 3) + " " + juce::String(map.bendSemitones[i], 1),
+               cell, juce::Justification::centred, false);
+  }
+}
+
+void KeyboardMapView::resized()
+{
+  keysImage = {};
+}
+
+void KeyboardMapView::refresh()
+{
+  auto previous = map;
+
+  if (!audioProcessor.getVoiceMap().read(map, mapSequence))
+    return;
+
+  // Published every block, but only a change is worth a frame
+  if (std::memcmp(&previous, &map, sizeof(map)) != 0)
+    repaint();
+}
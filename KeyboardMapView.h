@@ -0,0 +1,42 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "EditorLookAndFeel.h"
+
+// A piano keyboard with each sounding voice's key lit and labelled with its member channel,
+// over a row of the 16 channels showing the note and bend on each. Read from the processor's
+// voice map once per frame; it repaints only when the map has changed. The keys themselves
+// are rendered into a cached image when the size or pixel scale changes.
+class KeyboardMapView : public juce::Component
+{
+public:
+  explicit KeyboardMapView(PitchBendProcessor &);
+
+  void paint(juce::Graphics &) override;
+  void resized() override;
+
+  // Called by the editor once per display frame
+  void refresh();
+
+  size_t getCacheBytes() const { return EditorLookAndFeel::getImageBytes(keysImage); }
+
+private:
+  static constexpr int lowestNote = 21; // The 88 keys of a piano
+  static constexpr int highestNote = 108;
+  static constexpr float channelRowHeight = 18.0f;
+
+  PitchBendProcessor &audioProcessor;
+
+  PitchBendProcessor::VoiceMap map;
+  std::uint32_t mapSequence = 0;
+
+  juce::Image keysImage;
+
+  juce::Rectangle<float> getKeyboardArea() const;
+  juce::Rectangle<float> getKeyBounds(int note) const;
+  static bool isBlackKey(int note);
+  void renderKeysImage(float scale);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KeyboardMapView)
+};
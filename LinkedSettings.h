@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include "SeqLock.h"
+
+// Settings kept the same across every instance in the process under one link group ID, so a
+// rig of many instances is set up at soundcheck from any one of their editors. An edit to a
+// linked parameter is published as a whole block of the group's settings, and each member
+// compares the slot's sequence at the start of its next block, one atomic load, and takes
+// any values that differ from its own. Only the settings of the output and its receiver are
+// linked; each instance keeps its own bend, scope and input. Instances in other processes,
+// including sandboxed plugin hosts, have groups of their own.
+struct LinkedSettings
+{
+    static constexpr int numGroups = 16; // Group IDs are 1 to numGroups
+
+    static constexpr const char *parameterIDs[] = {"bendRange",      "outputMode",     "updateMode",        "updateRate",
+                                                   "updateCeiling",  "updatesPerBend", "budgetEnabled",     "messageBudget",
+                                                   "coalesceOutput", "coalesceDeadband", "bendDeadband",    "receiverSmoothing",
+                                                   "lookahead"};
+    static constexpr int numParameters = static_cast<int>(std::size(parameterIDs));
+    static_assert(numParameters <= 32, "Edits are marked one bit a parameter");
+
+    struct Block
+    {
+        std::uint32_t published = 0;                // Nonzero once a member has set the group up
+        std::array<float, numParameters> values{};  // Normalised, in parameterIDs order
+    };
+
+    // Written only on the message thread, which every instance in the process shares, so the
+    // slot has one writer at a time
+    static SeqLock<Block> &get(int groupId)
+    {
+        static std::array<SeqLock<Block>, numGroups> slots;
+        return slots[static_cast<size_t>(groupId - 1)];
+    }
+};
@@ -0,0 +1,88 @@
+#include "LoadMonitor.h"
+
+void LoadMonitor::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    measurer.reset(sampleRate, maximumBlockSize);
+
+    for (auto &window : windows)
+        for (auto &count : window)
+            count.store(0, std::memory_order_relaxed);
+
+    currentWindow.store(0, std::memory_order_relaxed);
+    windowSamples = static_cast<juce::int64>(windowSeconds * sampleRate);
+    samplesInWindow = 0;
+
+    resetWorstBlock();
+}
+
+void LoadMonitor::registerBlock(double processSeconds, int numSamples, juce::int64 blockStartSample)
+{
+    if (numSamples <= 0)
+        return;
+
+    measurer.registerRenderTime(processSeconds * 1000.0, numSamples);
+
+    auto load = processSeconds * sampleRate / numSamples;
+
+    if (load > worstLoad.load(std::memory_order_relaxed))
+    {
+        worstLoad.store(static_cast<float>(load), std::memory_order_relaxed);
+        worstBlockSample.store(blockStartSample, std::memory_order_relaxed);
+    }
+
+    auto window = currentWindow.load(std::memory_order_relaxed);
+
+    samplesInWindow += numSamples;
+    if (samplesInWindow >= windowSamples)
+    {
+        samplesInWindow = 0;
+        window ^= 1;
+
+        for (auto &count : windows[static_cast<size_t>(window)])
+            count.store(0, std::memory_order_relaxed);
+
+        currentWindow.store(window, std::memory_order_relaxed);
+    }
+
+    windows[static_cast<size_t>(window)][static_cast<size_t>(binForLoad(load))].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LoadMonitor::resetWorstBlock()
+{
+    worstLoad.store(0.0f, std::memory_order_relaxed);
+    worstBlockSample.store(0, std::memory_order_relaxed);
+}
+
+LoadMonitor::Histogram LoadMonitor::getHistogram() const
+{
+    Histogram counts{};
+
+    for (const auto &window : windows)
+        for (size_t bin = 0; bin < counts.size(); ++bin)
+            counts[bin] += window[bin].load(std::memory_order_relaxed);
+
+    return counts;
+}
+
+float LoadMonitor::getBinLowerEdge(int bin)
+{
+    if (bin <= 0)
+        return 0.0f;
+
+    return std::ldexp(1.0f, juce::jmin(bin, numBins - 1) - (numBins - 1));
+}
+
+int LoadMonitor::binForLoad(double load)
+{
+    if (load >= 1.0)
+        return numBins - 1;
+
+    if (load < getBinLowerEdge(1))
+        return 0;
+
+    // load = m * 2^exponent with m in [0.5, 1), so [2^-10, 1) maps onto bins 1 .. numBins - 2
+    int exponent = 0;
+    std::frexp(load, &exponent);
+    return exponent + numBins - 2;
+}
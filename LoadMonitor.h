@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Per-block DSP load: time spent in processBlock as a fraction of the real time the block
+// covers. registerBlock is called by the audio thread at the end of every block; the
+// getters may be called from any thread.
+class LoadMonitor
+{
+public:
+    // Bin 0 holds blocks below 1/1024 of their budget and every bin after it doubles, up to
+    // the last one, which holds the blocks that overran
+    static constexpr int numBins = 12;
+    using Histogram = std::array<juce::uint32, numBins>;
+
+    LoadMonitor() = default;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void registerBlock(double processSeconds, int numSamples, juce::int64 blockStartSample);
+
+    // Smoothed over the last few blocks, clipped to 1
+    double getLoad() const { return measurer.getLoadAsProportion(); }
+    int getOverrunCount() const { return measurer.getXRunCount(); }
+
+    // The most expensive block since prepare or resetWorstBlock, and where it started
+    float getWorstLoad() const { return worstLoad.load(std::memory_order_relaxed); }
+    juce::int64 getWorstBlockSample() const { return worstBlockSample.load(std::memory_order_relaxed); }
+    void resetWorstBlock();
+
+    // Block counts per bin over the last one to two windows of audio
+    Histogram getHistogram() const;
+    static float getBinLowerEdge(int bin);
+
+private:
+    static int binForLoad(double load);
+
+    juce::AudioProcessLoadMeasurer measurer;
+    double sampleRate = 44100.0;
+
+    std::atomic<float> worstLoad{0.0f};
+    std::atomic<juce::int64> worstBlockSample{0};
+
+    // Rolling histogram: blocks land in the current window; when it has covered
+    // windowSamples the older window is cleared and becomes the current one
+    static constexpr double windowSeconds = 5.0;
+    std::array<std::array<std::atomic<juce::uint32>, numBins>, 2> windows{};
+    std::atomic<int> currentWindow{0};
+    juce::int64 windowSamples = 0;
+    juce::int64 samplesInWindow = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(LoadMonitor)
+};
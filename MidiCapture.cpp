@@ -0,0 +1,203 @@
+#include "MidiCapture.h"
+
+namespace
+{
+    void writeVariableLength(juce::OutputStream &out, juce::uint64 value)
+    {
+        std::array<juce::uint8, 10> bytes;
+        size_t count = 0;
+
+        do
+        {
+            bytes[count++] = static_cast<juce::uint8>(value & 0x7f);
+            value >>= 7;
+        } while (value != 0 && count < bytes.size());
+
+        while (count > 1)
+            out.writeByte(static_cast<char>(bytes[--count] | 0x80));
+
+        out.writeByte(static_cast<char>(bytes[0]));
+    }
+}
+
+class MidiCapture::Writer : public juce::Thread
+{
+public:
+    explicit Writer(MidiCapture &capture) : juce::Thread("MIDI capture writer"), owner(capture) {}
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            owner.writePending();
+            wait(20);
+        }
+    }
+
+private:
+    MidiCapture &owner;
+};
+
+MidiCapture::MidiCapture() = default;
+
+MidiCapture::~MidiCapture()
+{
+    stop();
+}
+
+bool MidiCapture::start(const juce::File &midiFile)
+{
+    stop();
+
+    // Allocated on first use only, so instances that never capture don't carry the ring
+    if (ring.empty())
+        ring.resize(static_cast<size_t>(ringSize));
+
+    // Anything a block still in flight pushed after the last stop belongs to no capture
+    fifo.read(fifo.getNumReady());
+
+    midiFile.deleteFile();
+    auto newStream = std::make_unique<juce::FileOutputStream>(midiFile);
+
+    if (!newStream->openedOk())
+        return false;
+
+    newStream->write("MThd", 4);
+    newStream->writeIntBigEndian(6);
+    newStream->writeShortBigEndian(0); // Format 0: the one track
+    newStream->writeShortBigEndian(1);
+    newStream->writeShortBigEndian(ticksPerQuarterNote);
+    newStream->write("MTrk", 4);
+    newStream->writeIntBigEndian(0); // Track length, filled in at each flush
+
+    const juce::uint8 tempo[] = {0x00, 0xff, 0x51, 0x03, 0x07, 0xa1, 0x20}; // 500000 us per quarter note
+
+    {
+        const juce::ScopedLock sl(streamLock);
+        stream = std::move(newStream);
+        file = midiFile;
+        trackStart = stream->getPosition();
+        stream->write(tempo, sizeof(tempo));
+        lastWrittenTick = 0;
+        numDropped = 0;
+        writeEndOfTrack();
+    }
+
+    needsOrigin = true;
+    writer = std::make_unique<Writer>(*this);
+    writer->startThread(juce::Thread::Priority::low);
+
+    capturing.store(true, std::memory_order_release);
+    return true;
+}
+
+void MidiCapture::stop()
+{
+    capturing.store(false, std::memory_order_release);
+
+    if (writer == nullptr)
+        return;
+
+    writer->stopThread(1000);
+    writer.reset();
+
+    writePending();
+
+    const juce::ScopedLock sl(streamLock);
+    writeEndOfTrack();
+    stream.reset();
+}
+
+juce::File MidiCapture::getFile() const
+{
+    const juce::ScopedLock sl(streamLock);
+    return file;
+}
+
+void MidiCapture::prepare(double sampleRate)
+{
+    ticksPerSample = ticksPerSecond / sampleRate;
+    originSample = 0;
+    originTick = lastTick;
+}
+
+void MidiCapture::record(juce::int64 sample, const juce::uint8 *data, int size)
+{
+    if (!isCapturing() || size <= 0 || size > static_cast<int>(Event{}.data.size()))
+        return;
+
+    if (needsOrigin.exchange(false, std::memory_order_acquire))
+    {
+        originSample = sample;
+        originTick = 0;
+        lastTick = 0;
+    }
+
+    Event event;
+    event.tick = juce::jmax(lastTick, originTick + static_cast<juce::int64>(std::llround(static_cast<double>(sample - originSample) * ticksPerSample)));
+    event.size = static_cast<juce::uint8>(size);
+    std::copy(data, data + size, event.data.begin());
+    lastTick = event.tick;
+
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        ring[static_cast<size_t>(scope.startIndex1)] = event;
+    else
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MidiCapture::writePending()
+{
+    const juce::ScopedLock sl(streamLock);
+
+    if (stream == nullptr)
+        return;
+
+    auto writeEvent = [this](const Event &event)
+    {
+        auto status = event.data[0];
+
+        // System real-time and common messages have no place in a file
+        if (status >= 0xf0 && status != 0xf0)
+            return;
+
+        writeVariableLength(*stream, static_cast<juce::uint64>(event.tick - lastWrittenTick));
+        lastWrittenTick = event.tick;
+
+        if (status == 0xf0)
+        {
+            stream->writeByte(static_cast<char>(0xf0));
+            writeVariableLength(*stream, static_cast<juce::uint64>(event.size - 1));
+            stream->write(event.data.data() + 1, static_cast<size_t>(event.size - 1));
+        }
+        else
+        {
+            stream->write(event.data.data(), event.size);
+        }
+    };
+
+    const auto scope = fifo.read(fifo.getNumReady());
+    scope.forEach([&](int index) { writeEvent(ring[static_cast<size_t>(index)]); });
+
+    if (juce::Time::getMillisecondCounter() - lastFlushTime >= static_cast<juce::uint32>(flushSeconds * 1000))
+        writeEndOfTrack();
+}
+
+void MidiCapture::writeEndOfTrack()
+{
+    // Closes the track and fills in its length, then steps back over the end so the next
+    // events overwrite it. What is on disk is a whole file each time.
+    const juce::uint8 endOfTrack[] = {0x00, 0xff, 0x2f, 0x00};
+    auto end = stream->getPosition();
+
+    stream->write(endOfTrack, sizeof(endOfTrack));
+    auto length = stream->getPosition() - trackStart;
+
+    stream->setPosition(trackStart - 4);
+    stream->writeIntBigEndian(static_cast<int>(length));
+    stream->flush();
+    stream->setPosition(end);
+
+    lastFlushTime = juce::Time::getMillisecondCounter();
+}
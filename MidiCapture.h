@@ -0,0 +1,79 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Records the processor's MIDI 1.0 output to a standard MIDI file for as long as a show
+// runs. The audio thread stamps each event with its tick and copies it into a preallocated
+// ring without waiting; a background thread appends the ring to the file as it fills and
+// every few seconds closes the track off and flushes, so the file on disk is always a
+// complete one that ends at most flushSeconds behind. Memory stays the size of the ring
+// however long the capture runs.
+//
+// The file is format 0 at 960 ticks per quarter note and 120 bpm, so a tick is a fixed
+// 1/1920 s. Messages longer than seven bytes and MIDI 2.0 per-note output aren't captured.
+class MidiCapture
+{
+public:
+    MidiCapture();
+    ~MidiCapture();
+
+    // Message thread. Starting again while running closes the old file and starts the new one.
+    bool start(const juce::File &midiFile);
+    void stop();
+    bool isCapturing() const { return capturing.load(std::memory_order_acquire); }
+
+    // Called from prepareToPlay, which starts the sample count over
+    void prepare(double sampleRate);
+
+    // Audio thread; returns straight away unless capturing
+    void record(juce::int64 sample, const juce::uint8 *data, int size);
+
+    int getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+    juce::File getFile() const;
+
+    // Message thread
+    size_t getMemoryBytes() const { return ring.capacity() * sizeof(Event); }
+
+private:
+    class Writer;
+
+    struct Event
+    {
+        juce::int64 tick = 0;
+        std::array<juce::uint8, 7> data{};
+        juce::uint8 size = 0;
+    };
+
+    static constexpr int ringSize = 1 << 16;
+    static constexpr int ticksPerQuarterNote = 960;
+    static constexpr double ticksPerSecond = ticksPerQuarterNote * 2.0; // At 120 bpm
+    static constexpr int flushSeconds = 5;
+
+    void writePending();
+    void writeEndOfTrack();
+
+    juce::AbstractFifo fifo{ringSize};
+    std::vector<Event> ring;
+
+    std::atomic<bool> capturing{false};
+    std::atomic<int> numDropped{0};
+
+    // Audio thread: where the ticks count from. A new capture takes its first event's sample
+    // as tick 0, and a new sample count in prepare carries on from the last tick recorded.
+    std::atomic<bool> needsOrigin{true};
+    juce::int64 originSample = 0;
+    juce::int64 originTick = 0;
+    juce::int64 lastTick = 0;
+    double ticksPerSample = ticksPerSecond / 44100.0;
+
+    // Writer thread, or start and stop while it isn't running
+    juce::CriticalSection streamLock;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::File file;
+    juce::int64 trackStart = 0;    // File position of the track's first event
+    juce::int64 lastWrittenTick = 0;
+    juce::uint32 lastFlushTime = 0;
+    std::unique_ptr<Writer> writer;
+
+    JUCE_DECLARE_NON_COPYABLE(MidiCapture)
+};
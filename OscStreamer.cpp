@@ -0,0 +1,115 @@
+#include "OscStreamer.h"
+#include "ChannelAllocator.h"
+
+class OscStreamer::Sender : public juce::Thread
+{
+public:
+    explicit Sender(OscStreamer &streamer) : juce::Thread("OSC sender"), owner(streamer) {}
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            owner.sendPending();
+            wait(owner.intervalMs.load(std::memory_order_relaxed));
+        }
+    }
+
+private:
+    OscStreamer &owner;
+};
+
+OscStreamer::OscStreamer() = default;
+
+OscStreamer::~OscStreamer()
+{
+    stop();
+}
+
+bool OscStreamer::start(const juce::String &host, int port)
+{
+    stop();
+
+    // Allocated on first use only, so instances that never stream don't carry the ring
+    if (ring.empty())
+        ring.resize(static_cast<size_t>(ringSize));
+
+    // Anything a block still in flight pushed after the last stop is stale
+    fifo.read(fifo.getNumReady());
+    changedMask = 0;
+
+    if (!oscSender.connect(host, port))
+        return false;
+
+    numDropped = 0;
+    sender = std::make_unique<Sender>(*this);
+    sender->startThread(juce::Thread::Priority::low);
+
+    streaming.store(true, std::memory_order_release);
+    return true;
+}
+
+void OscStreamer::stop()
+{
+    streaming.store(false, std::memory_order_release);
+
+    if (sender == nullptr)
+        return;
+
+    sender->stopThread(1000);
+    sender.reset();
+    oscSender.disconnect();
+}
+
+void OscStreamer::setRate(float bundlesPerSecond)
+{
+    intervalMs.store(juce::jmax(1, juce::roundToInt(1000.0f / bundlesPerSecond)), std::memory_order_relaxed);
+}
+
+void OscStreamer::push(const OscVoiceRecord &record)
+{
+    if (!isStreaming())
+        return;
+
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        ring[static_cast<size_t>(scope.startIndex1)] = record;
+    else
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void OscStreamer::sendPending()
+{
+    // Only the latest record of each voice goes out; pitch and bend between bundles are
+    // of no use to a light
+    const auto scope = fifo.read(fifo.getNumReady());
+
+    scope.forEach([this](int index)
+    {
+        const auto &record = ring[static_cast<size_t>(index)];
+        latest[record.voice] = record;
+        changedMask |= 1u << record.voice;
+    });
+
+    if (changedMask == 0)
+        return;
+
+    juce::OSCBundle bundle;
+
+    for (auto mask = changedMask; mask != 0; mask &= mask - 1)
+    {
+        const auto &record = latest[static_cast<size_t>(lowestSetBit(mask))];
+
+        bundle.addElement(juce::OSCMessage("/betterchordstacks/voice",
+                                           static_cast<juce::int32>(record.voice) + 1,
+                                           static_cast<juce::int32>(record.note),
+                                           record.pitch,
+                                           record.bend,
+                                           record.sounding ? 1 : 0));
+    }
+
+    // A bundle the network refused is simply lost; the next one carries newer values
+    oscSender.send(bundle);
+    changedMask = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// One voice's state at the end of a block
+struct OscVoiceRecord
+{
+    float pitch = 0.0f; // Sounding pitch as a fractional MIDI note number
+    float bend = 0.0f;  // Current bend in semitones, tuning offset included
+    juce::uint8 voice = 0;
+    juce::uint8 note = 0;
+    bool sounding = false; // False once the voice has ended
+};
+
+// Optional OSC stream of per-voice bend state, for driving lights and visuals from the
+// same bends. The audio thread pushes fixed-size records into a preallocated ring and never
+// waits; a sender thread drains it at the configured rate and sends one bundle holding the
+// latest state of each voice that changed, so no network I/O happens on the audio thread.
+//
+// Each voice is one message, /betterchordstacks/voice, with int32 voice (1 to 16), int32
+// note, float32 pitch, float32 bend and int32 sounding (1 while the voice plays, 0 when it
+// has just ended).
+class OscStreamer
+{
+public:
+    OscStreamer();
+    ~OscStreamer();
+
+    // Message thread. Starting again while running switches to the new destination.
+    bool start(const juce::String &host, int port);
+    void stop();
+    bool isStreaming() const { return streaming.load(std::memory_order_acquire); }
+
+    // Any thread; bundles per second
+    void setRate(float bundlesPerSecond);
+
+    // Audio thread; records are dropped while the ring is full
+    void push(const OscVoiceRecord &record);
+
+    int getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+private:
+    class Sender;
+
+    static constexpr int ringSize = 4096;
+    static constexpr int numVoices = 16;
+
+    void sendPending();
+
+    juce::AbstractFifo fifo{ringSize};
+    std::vector<OscVoiceRecord> ring;
+
+    std::atomic<bool> streaming{false};
+    std::atomic<int> intervalMs{33};
+    std::atomic<int> numDropped{0};
+
+    // Sender thread only, while it runs
+    juce::OSCSender oscSender;
+    std::array<OscVoiceRecord, numVoices> latest{};
+    juce::uint32 changedMask = 0;
+
+    std::unique_ptr<Sender> sender;
+
+    JUCE_DECLARE_NON_COPYABLE(OscStreamer)
+};
@@ -0,0 +1,83 @@
+#include "PerformanceHud.h"
+
+PerformanceHud::PerformanceHud()
+{
+  setInterceptsMouseClicks(false, false);
+}
+
+void PerformanceHud::paint(juce::Graphics &g)
+{
+  g.setColour(juce::Colours::black.withAlpha(0.75f));
+  g.fillRoundedRectangle(getLocalBounds().toFloat(), 6.0f);
+
+  g.setColour(juce::Colours::white);
+  g.setFont(juce::FontOptions(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+
+  auto area = getLocalBounds().reduced(10, 8);
+  auto lineHeight = area.getHeight() / juce::jmax(1, lines.size());
+
+  for (const auto &line : lines)
+    g.drawText(line, area.removeFromTop(lineHeight), juce::Justification::centredLeft, false);
+}
+
+void PerformanceHud::setMemory(size_t instanceBytes, size_t editorBytes, size_t sharedBytes)
+{
+  memoryInstance = instanceBytes;
+  memoryEditor = editorBytes;
+  memoryShared = sharedBytes;
+}
+
+void PerformanceHud::addRecords(const TelemetryRecord *records, int numRecords)
+{
+  for (int i = 0; i < numRecords; ++i)
+  {
+    const auto &record = records[i];
+    processSeconds += record.processSeconds;
+    blockSeconds += record.blockSeconds;
+    worstProcessSeconds = juce::jmax(worstProcessSeconds, record.processSeconds);
+
+    if (record.blockSeconds > 0.0f)
+      worstBlockLoad = juce::jmax(worstBlockLoad, record.processSeconds / record.blockSeconds);
+
+    bendsSent += record.bendsSent;
+    coalescedBends += record.coalescedBends;
+    droppedBends += record.droppedBends;
+    steals += record.steals;
+    activeVoices = record.activeVoices;
+    qualityLevel = record.qualityLevel;
+  }
+
+  // Stopped or bypassed: keep showing the last interval
+  auto now = juce::Time::getMillisecondCounterHiRes();
+
+  if (blockSeconds <= 0.0f || now - lastUpdateMs < intervalMs)
+    return;
+
+  auto perSecond = [this](int count) { return juce::String(juce::roundToInt(static_cast<float>(count) / blockSeconds)); };
+
+  lines.clearQuick();
+  lines.add("Load     " + juce::String(processSeconds / blockSeconds * 100.0f, 2) + "%");
+  lines.add("Worst    " + juce::String(worstProcessSeconds * 1.0e6f, 0) + " us (" + juce::String(worstBlockLoad * 100.0f, 1) + "%)");
+  lines.add("Bends    " + perSecond(bendsSent) + "/s");
+  lines.add("Coalesce " + perSecond(coalescedBends) + "/s");
+  lines.add("Dropped  " + perSecond(droppedBends) + "/s");
+  lines.add("Voices   " + juce::String(activeVoices));
+  lines.add("Steals   " + perSecond(steals) + "/s");
+  lines.add("Quality  " + (qualityLevel == 0 ? juce::String("full") : "reduced, level " + juce::String(qualityLevel)));
+
+  auto kilobytes = [](size_t bytes) { return juce::String(static_cast<double>(bytes) / 1024.0, 0) + " KB"; };
+  lines.add("Memory   " + kilobytes(memoryInstance) + " + editor " + kilobytes(memoryEditor) + ", shared " + kilobytes(memoryShared));
+
+  processSeconds = 0.0f;
+  blockSeconds = 0.0f;
+  worstProcessSeconds = 0.0f;
+  worstBlockLoad = 0.0f;
+  bendsSent = 0;
+  coalescedBends = 0;
+  droppedBends = 0;
+  steals = 0;
+  lastUpdateMs = now;
+
+  if (isVisible())
+    repaint();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+// Overlay of what the audio thread is doing, for tuning the update rate and deadband against
+// their cost: load, the slowest block, bends per second, bends coalesced and dropped by the
+// bandwidth budget, voices and steals. The editor hands it the telemetry records it drains;
+// the figures are totalled over each interval and redrawn once per interval.
+class PerformanceHud : public juce::Component
+{
+public:
+  PerformanceHud();
+
+  void paint(juce::Graphics &) override;
+
+  // Called by the editor once per display frame with the records drained in that frame
+  void addRecords(const TelemetryRecord *records, int numRecords);
+
+  // Bytes held by the instance, by its editor's cached images, and by caches shared by
+  // every instance in the process; shown with the next interval
+  void setMemory(size_t instanceBytes, size_t editorBytes, size_t sharedBytes);
+
+private:
+  static constexpr double intervalMs = 250.0;
+
+  // Totals over the interval being gathered
+  float processSeconds = 0.0f;
+  float blockSeconds = 0.0f;
+  float worstProcessSeconds = 0.0f;
+  float worstBlockLoad = 0.0f;
+  int bendsSent = 0;
+  int coalescedBends = 0;
+  int droppedBends = 0;
+  int steals = 0;
+  int activeVoices = 0;
+  int qualityLevel = 0;
+  double lastUpdateMs = 0.0;
+
+  size_t memoryInstance = 0;
+  size_t memoryEditor = 0;
+  size_t memoryShared = 0;
+
+  // As shown
+  juce::StringArray lines;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformanceHud)
+};
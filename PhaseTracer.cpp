@@ -0,0 +1,80 @@
+#include "PhaseTracer.h"
+
+void PhaseTracer::start()
+{
+    stop();
+
+    // Allocated on first use only, so instances that never capture don't carry the ring
+    if (ring.empty())
+        ring.resize(static_cast<size_t>(ringSize));
+
+    fifo.read(fifo.getNumReady());
+    captured.clear();
+    numDropped = 0;
+    startTicks = juce::Time::getHighResolutionTicks();
+
+    capturing.store(true, std::memory_order_release);
+}
+
+void PhaseTracer::push(Event event)
+{
+    event.sample = blockSample;
+    event.threadId = juce::Thread::getCurrentThreadId();
+
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        ring[static_cast<size_t>(scope.startIndex1)] = event;
+    else
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PhaseTracer::collect()
+{
+    const auto scope = fifo.read(fifo.getNumReady());
+
+    scope.forEach([this](int index)
+    {
+        if (captured.size() < maxCapturedEvents)
+            captured.push_back(ring[static_cast<size_t>(index)]);
+        else
+            numDropped.fetch_add(1, std::memory_order_relaxed);
+    });
+}
+
+bool PhaseTracer::writeChromeTrace(const juce::File &traceFile) const
+{
+    traceFile.deleteFile();
+    juce::FileOutputStream out(traceFile);
+
+    if (!out.openedOk())
+        return false;
+
+    // Thread IDs are numbered in the order they first appear, which is all the viewer needs
+    std::vector<void *> threads;
+    auto microseconds = [this](juce::int64 ticks) { return juce::Time::highResolutionTicksToSeconds(ticks - startTicks) * 1.0e6; };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    for (size_t i = 0; i < captured.size(); ++i)
+    {
+        const auto &event = captured[i];
+        auto thread = std::find(threads.begin(), threads.end(), event.threadId);
+
+        if (thread == threads.end())
+            thread = threads.insert(threads.end(), event.threadId);
+
+        auto start = microseconds(event.startTicks);
+
+        out << (i == 0 ? "\n" : ",\n")
+            << "{\"name\":\"" << event.name << "\",\"cat\":\"processBlock\",\"ph\":\"X\""
+            << ",\"ts\":" << juce::String(start, 3)
+            << ",\"dur\":" << juce::String(microseconds(event.endTicks) - start, 3)
+            << ",\"pid\":1,\"tid\":" << static_cast<int>(thread - threads.begin()) + 1
+            << ",\"args\":{\"sample\":" << juce::String(event.sample) << "}}";
+    }
+
+    out << "\n]}\n";
+    out.flush();
+    return out.getStatus().wasOk();
+}
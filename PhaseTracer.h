@@ -0,0 +1,101 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Building with BCS_PHASE_TRACE=1 compiles in the markers around the phases of a block; by
+// default every BCS_TRACE_PHASE line is left out
+#ifndef BCS_PHASE_TRACE
+#define BCS_PHASE_TRACE 0
+#endif
+
+#if BCS_PHASE_TRACE
+#define BCS_TRACE_PHASE_NAME(line) phaseScope##line
+#define BCS_TRACE_PHASE_SCOPE(tracer, name, line) const PhaseTracer::Scope BCS_TRACE_PHASE_NAME(line)(tracer, name)
+#define BCS_TRACE_PHASE(tracer, name) BCS_TRACE_PHASE_SCOPE(tracer, name, __LINE__)
+#else
+#define BCS_TRACE_PHASE(tracer, name) ((void) 0)
+#endif
+
+// Where the time inside processBlock goes, phase by phase, for lining up with the host's
+// own callback timing in chrome://tracing or Perfetto. A scope marker stamps its phase's
+// start and end into a preallocated ring, which never waits or allocates; the thread
+// running the block is recorded with it. Whoever captures drains the ring with collect and
+// writes what it gathered as Chrome trace event JSON.
+class PhaseTracer
+{
+public:
+    struct Event
+    {
+        juce::int64 startTicks = 0;
+        juce::int64 endTicks = 0;
+        juce::int64 sample = 0; // The block's first sample, counted from prepareToPlay
+        const char *name = nullptr; // A string literal
+        void *threadId = nullptr;
+    };
+
+    class Scope
+    {
+    public:
+        Scope(PhaseTracer &tracer, const char *name) : owner(tracer.isCapturing() ? &tracer : nullptr)
+        {
+            if (owner != nullptr)
+            {
+                event.name = name;
+                event.startTicks = juce::Time::getHighResolutionTicks();
+            }
+        }
+
+        ~Scope()
+        {
+            if (owner != nullptr)
+            {
+                event.endTicks = juce::Time::getHighResolutionTicks();
+                owner->push(event);
+            }
+        }
+
+    private:
+        PhaseTracer *owner;
+        Event event;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+    PhaseTracer() = default;
+
+    // Capturing thread. start drops anything gathered before.
+    void start();
+    void stop() { capturing.store(false, std::memory_order_release); }
+    bool isCapturing() const { return capturing.load(std::memory_order_acquire); }
+
+    // Audio thread: the sample the markers that follow are stamped with
+    void setBlockSample(juce::int64 sample) { blockSample = sample; }
+
+    // Capturing thread: moves the ring's events into the capture. Call it often enough that
+    // the ring doesn't fill; events that found it full are counted instead.
+    void collect();
+    int getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+    // Writes the capture so far as a Chrome trace event file
+    bool writeChromeTrace(const juce::File &traceFile) const;
+
+    // Capturing thread
+    size_t getMemoryBytes() const { return (ring.capacity() + captured.capacity()) * sizeof(Event); }
+
+private:
+    static constexpr int ringSize = 1 << 14;
+    static constexpr size_t maxCapturedEvents = 1 << 20;
+
+    void push(Event event);
+
+    juce::AbstractFifo fifo{ringSize};
+    std::vector<Event> ring;
+    std::atomic<bool> capturing{false};
+    std::atomic<int> numDropped{0};
+    juce::int64 blockSample = 0;
+
+    std::vector<Event> captured;
+    juce::int64 startTicks = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(PhaseTracer)
+};
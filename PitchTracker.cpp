@@ -0,0 +1,213 @@
+#include "PitchTracker.h"
+
+class PitchTracker::Analyser : public juce::Thread
+{
+public:
+    explicit Analyser(PitchTracker &tracker) : juce::Thread("Pitch tracker"), owner(tracker) {}
+
+    void run() override
+    {
+        WorkgroupLink::Membership membership;
+
+        while (!threadShouldExit())
+        {
+            owner.workgroupLink.join(membership);
+            owner.analyseAvailable();
+            wait(pollIntervalMs);
+        }
+    }
+
+    static constexpr int pollIntervalMs = 10;
+
+private:
+    PitchTracker &owner;
+};
+
+PitchTracker::PitchTracker() = default;
+
+PitchTracker::~PitchTracker()
+{
+    stop();
+}
+
+void PitchTracker::start(double sampleRate)
+{
+    stop();
+
+    // Allocated on first use only, so instances that never track don't carry the buffers
+    if (ring.empty())
+    {
+        ring.resize(static_cast<size_t>(ringSize));
+        frame.resize(static_cast<size_t>(frameSize));
+        window.resize(static_cast<size_t>(frameSize));
+        spectrum.resize(static_cast<size_t>(2 << fftOrder));
+        nsdf.resize(static_cast<size_t>(frameSize / 2 + 1));
+        fft = std::make_unique<juce::dsp::FFT>(fftOrder);
+
+        for (int i = 0; i < frameSize; ++i)
+            window[static_cast<size_t>(i)] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * static_cast<float>(i) / frameSize);
+    }
+
+    inputRate = sampleRate;
+    decimation = juce::jmax(1, static_cast<int>(sampleRate / analysisRate));
+    frameRate = sampleRate / decimation;
+
+    // Anything a block still in flight pushed after the last stop is stale
+    fifo.read(fifo.getNumReady());
+    std::fill(frame.begin(), frame.end(), 0.0f);
+    numFresh = 0;
+    restartDecimation.store(true, std::memory_order_release);
+
+    // A frame's analysis is well under a millisecond of each poll; without the rights to a
+    // real-time thread, the highest ordinary priority
+    analyser = std::make_unique<Analyser>(*this);
+
+    if (!analyser->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(8).withPeriodMs(Analyser::pollIntervalMs).withProcessingTimeMs(1.0)))
+        analyser->startThread(juce::Thread::Priority::high);
+
+    tracking.store(true, std::memory_order_release);
+}
+
+void PitchTracker::stop()
+{
+    tracking.store(false, std::memory_order_release);
+    inputRate = 0.0;
+
+    if (analyser == nullptr)
+        return;
+
+    analyser->stopThread(1000);
+    analyser.reset();
+
+    // Nothing heard any more
+    results.getWriteBuffer() = {};
+    results.publish();
+}
+
+void PitchTracker::analyseAvailable()
+{
+    while (fifo.getNumReady() > 0)
+    {
+        // The frame slides along by what arrived, up to the next hop
+        auto numWanted = juce::jmin(fifo.getNumReady(), hopSize - numFresh);
+        const auto scope = fifo.read(numWanted);
+        auto *tail = frame.data() + frameSize - numWanted;
+
+        std::move(frame.begin() + numWanted, frame.end(), frame.begin());
+        std::copy_n(ring.data() + scope.startIndex1, scope.blockSize1, tail);
+        std::copy_n(ring.data() + scope.startIndex2, scope.blockSize2, tail + scope.blockSize1);
+
+        numFresh += numWanted;
+
+        if (numFresh == hopSize)
+        {
+            results.getWriteBuffer() = analyseFrame();
+            results.publish();
+            numFresh = 0;
+        }
+    }
+}
+
+PitchTrackerResult PitchTracker::analyseFrame()
+{
+    PitchTrackerResult result;
+    auto fftSize = fft->getSize();
+    float energy = 0.0f;
+
+    // Windowed and zero-padded, so the autocorrelation taken through the spectrum doesn't wrap
+    std::fill(spectrum.begin(), spectrum.end(), 0.0f);
+
+    for (int i = 0; i < frameSize; ++i)
+    {
+        auto value = frame[static_cast<size_t>(i)] * window[static_cast<size_t>(i)];
+        spectrum[static_cast<size_t>(i)] = value;
+        energy += value * value;
+    }
+
+    // Silence has no pitch
+    if (energy < 1.0e-6f * frameSize)
+        return result;
+
+    fft->performRealOnlyForwardTransform(spectrum.data(), true);
+
+    // Chord: the power in each pitch class across the tracked range, with each class strong
+    // against the strongest counted
+    std::array<float, 12> chroma{};
+    auto binHz = static_cast<float>(frameRate) / static_cast<float>(fftSize);
+    auto firstBin = juce::jmax(1, static_cast<int>(std::ceil(lowestHz / binHz)));
+    auto lastBin = juce::jmin(fftSize / 2, static_cast<int>(2.0f * highestHz / binHz));
+
+    for (int bin = 0; bin <= fftSize / 2; ++bin)
+    {
+        auto re = spectrum[static_cast<size_t>(2 * bin)];
+        auto im = spectrum[static_cast<size_t>(2 * bin + 1)];
+        auto power = re * re + im * im;
+
+        if (bin >= firstBin && bin <= lastBin)
+        {
+            auto pitch = 69.0f + 12.0f * std::log2(static_cast<float>(bin) * binHz / 440.0f);
+            chroma[static_cast<size_t>((juce::roundToInt(pitch) % 12 + 12) % 12)] += power;
+        }
+
+        spectrum[static_cast<size_t>(2 * bin)] = power;
+        spectrum[static_cast<size_t>(2 * bin + 1)] = 0.0f;
+    }
+
+    auto strongest = *std::max_element(chroma.begin(), chroma.end());
+
+    for (int pitchClass = 0; pitchClass < 12; ++pitchClass)
+        if (chroma[static_cast<size_t>(pitchClass)] >= 0.5f * strongest)
+            result.pitchClasses |= 1u << pitchClass;
+
+    // Pitch: the power spectrum transformed back is the autocorrelation, normalised (McLeod's
+    // NSDF) so the peaks of a periodic input come close to 1. The FFT's own scaling is taken
+    // out against the energy, which is the autocorrelation at lag 0.
+    fft->performRealOnlyInverseTransform(spectrum.data());
+
+    const auto *autocorrelation = spectrum.data();
+    auto scale = energy / autocorrelation[0];
+    auto minLag = juce::jmax(2, static_cast<int>(frameRate / highestHz));
+    auto maxLag = juce::jmin(frameSize / 2, static_cast<int>(frameRate / lowestHz) + 1);
+
+    auto sumOfSquares = 2.0f * energy;
+    float highest = 0.0f;
+
+    for (int lag = 1; lag <= maxLag; ++lag)
+    {
+        auto earlier = frame[static_cast<size_t>(lag - 1)] * window[static_cast<size_t>(lag - 1)];
+        auto later = frame[static_cast<size_t>(frameSize - lag)] * window[static_cast<size_t>(frameSize - lag)];
+        sumOfSquares -= earlier * earlier + later * later;
+
+        auto value = sumOfSquares > 0.0f ? 2.0f * autocorrelation[lag] * scale / sumOfSquares : 0.0f;
+        nsdf[static_cast<size_t>(lag)] = value;
+
+        if (lag >= minLag)
+            highest = juce::jmax(highest, value);
+    }
+
+    // An unclear period is noise, or too many voices to call one of them the pitch
+    constexpr float clarityThreshold = 0.6f;
+
+    if (highest < clarityThreshold)
+        return result;
+
+    // The first peak near the highest; later ones are its octaves below
+    for (int lag = minLag; lag < maxLag; ++lag)
+    {
+        auto value = nsdf[static_cast<size_t>(lag)];
+
+        if (value >= 0.9f * highest && value >= nsdf[static_cast<size_t>(lag - 1)] && value >= nsdf[static_cast<size_t>(lag + 1)])
+        {
+            auto before = nsdf[static_cast<size_t>(lag - 1)];
+            auto after = nsdf[static_cast<size_t>(lag + 1)];
+            auto curvature = before - 2.0f * value + after;
+            auto offset = curvature < 0.0f ? 0.5f * (before - after) / curvature : 0.0f;
+            auto hz = static_cast<float>(frameRate) / (static_cast<float>(lag) + offset);
+
+            result.note = 69.0f + 12.0f * std::log2(hz / 440.0f);
+            break;
+        }
+    }
+
+    return result;
+}
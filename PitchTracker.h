@@ -0,0 +1,123 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+#include "WorkgroupLink.h"
+
+// What the input is playing, as last analysed
+struct PitchTrackerResult
+{
+    float note = -1.0f;            // Fractional MIDI note of its pitch, or -1 while it has none
+    juce::uint32 pitchClasses = 0; // Bit n for each pitch class n (C = 0) strong in it
+};
+
+// Pitch and chord tracking of the plugin's audio input, for bending toward a live singer or
+// player. The audio thread only mixes the input down, decimates it to about 8 kHz and copies
+// it into a preallocated ring, never waiting; an analyser thread takes overlapping frames
+// from the ring, finds the pitch from the autocorrelation and the chord from the spectrum,
+// both through one juce::dsp::FFT, and publishes each result for the audio thread to pick up.
+// The bends wait on those results, so the analyser runs at real-time priority where the OS
+// allows it, in the audio device's workgroup when there is one.
+class PitchTracker
+{
+public:
+    PitchTracker();
+    ~PitchTracker();
+
+    // Message thread. Starting again while running restarts at the new rate.
+    void start(double sampleRate);
+    void stop();
+    bool isTracking() const { return tracking.load(std::memory_order_acquire); }
+    double getSampleRate() const { return inputRate; }
+
+    // Any thread; the analyser joins it on its next pass (see WorkgroupLink)
+    void setWorkgroup(const juce::AudioWorkgroup &workgroup) { workgroupLink.set(workgroup); }
+
+    // Audio thread; the input is dropped while the ring is full
+    template <typename SampleType>
+    void push(const SampleType *const *channels, int numChannels, int numSamples);
+
+    // Audio thread: the latest result, held until the next acquireResult()
+    void acquireResult() { results.acquire(); }
+    const PitchTrackerResult &getResult() const { return results.getReadBuffer(); }
+
+private:
+    class Analyser;
+
+    static constexpr double analysisRate = 8000.0;
+    static constexpr int ringSize = 8192;
+    static constexpr int fftOrder = 11;
+    static constexpr int frameSize = 1 << (fftOrder - 1); // Zero-padded to the FFT's size for the autocorrelation
+    static constexpr int hopSize = frameSize / 4;
+    static constexpr float lowestHz = 60.0f;
+    static constexpr float highestHz = 1000.0f;
+
+    void analyseAvailable();
+    PitchTrackerResult analyseFrame();
+
+    juce::AbstractFifo fifo{ringSize};
+    std::vector<float> ring;
+
+    std::atomic<bool> tracking{false};
+    std::atomic<bool> restartDecimation{false};
+    double inputRate = 0.0;
+    double frameRate = analysisRate; // Rate after decimation
+    int decimation = 1;
+
+    // Audio thread only
+    int decimationPhase = 0;
+    float decimationSum = 0.0f;
+
+    // Analyser thread only, while it runs
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> frame;
+    std::vector<float> window;
+    std::vector<float> spectrum;
+    std::vector<float> nsdf; // Normalised autocorrelation by lag
+    int numFresh = 0; // Samples in frame since the last analysis
+
+    TripleBuffer<PitchTrackerResult> results;
+    WorkgroupLink workgroupLink;
+    std::unique_ptr<Analyser> analyser;
+
+    JUCE_DECLARE_NON_COPYABLE(PitchTracker)
+};
+
+template <typename SampleType>
+void PitchTracker::push(const SampleType *const *channels, int numChannels, int numSamples)
+{
+    if (!isTracking() || numChannels == 0)
+        return;
+
+    if (restartDecimation.exchange(false, std::memory_order_acquire))
+    {
+        decimationPhase = 0;
+        decimationSum = 0.0f;
+    }
+
+    // Averaging each run of decimation samples is a plain low-pass ahead of dropping them
+    auto scale = 1.0f / static_cast<float>(decimation * numChannels);
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples / decimation + 1, start1, size1, start2, size2);
+    int written = 0;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            decimationSum += static_cast<float>(channels[channel][i]);
+
+        if (++decimationPhase < decimation)
+            continue;
+
+        if (written < size1)
+            ring[static_cast<size_t>(start1 + written)] = decimationSum * scale;
+        else if (written < size1 + size2)
+            ring[static_cast<size_t>(start2 + written - size1)] = decimationSum * scale;
+
+        written = juce::jmin(written + 1, size1 + size2);
+        decimationPhase = 0;
+        decimationSum = 0.0f;
+    }
+
+    fifo.finishedWrite(written);
+}
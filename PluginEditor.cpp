@@ -1,79 +1,410 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "BinaryData.h"
+
+PitchBendEditor::SharedAssets::SharedAssets()
+    : titleTypeface(juce::Typeface::createSystemTypefaceFor(BinaryData::rainyhearts_ttf, BinaryData::rainyhearts_ttfSize))
+{
+}
 
 PitchBendEditor::PitchBendEditor(PitchBendProcessor &p)
-    : AudioProcessorEditor(&p), audioProcessor(p)
+    : AudioProcessorEditor(&p), audioProcessor(p), curveDisplay(p), keyboardMap(p)
 {
-  setSize(400, 300);
+  setLookAndFeel(&lookAndFeel);
+  content.setInterceptsMouseClicks(false, true);
+  addAndMakeVisible(content);
 
   // Bend Amount Slider
   bendAmountSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
-  bendAmountSlider.setRange(0.0, 2.0, 0.01);
   bendAmountSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 90, 20);
-  bendAmountSlider.setValue(*audioProcessor.bendAmount);
-  bendAmountSlider.onValueChange = [this]
-  {
-    *audioProcessor.bendAmount = static_cast<float>(bendAmountSlider.getValue());
-  };
-  addAndMakeVisible(bendAmountSlider);
+  content.addAndMakeVisible(bendAmountSlider);
+  bendAmountAttachment = std::make_unique<SliderAttachment>(audioProcessor.parameters, "bendAmount", bendAmountSlider);
 
-  bendAmountLabel.setText("Bend Amount", juce::dontSendNotification);
   bendAmountLabel.setJustificationType(juce::Justification::centred);
   bendAmountLabel.attachToComponent(&bendAmountSlider, false);
-  addAndMakeVisible(bendAmountLabel);
+  content.addAndMakeVisible(bendAmountLabel);
 
   // Bend Time Slider
   bendTimeSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
-  bendTimeSlider.setRange(0.01, 2.0, 0.01);
   bendTimeSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 90, 20);
-  bendTimeSlider.setValue(*audioProcessor.bendTime);
-  bendTimeSlider.onValueChange = [this]
-  {
-    *audioProcessor.bendTime = static_cast<float>(bendTimeSlider.getValue());
-  };
-  addAndMakeVisible(bendTimeSlider);
+  content.addAndMakeVisible(bendTimeSlider);
+  bendTimeAttachment = std::make_unique<SliderAttachment>(audioProcessor.parameters, "bendTime", bendTimeSlider);
 
-  bendTimeLabel.setText("Bend Time (s)", juce::dontSendNotification);
   bendTimeLabel.setJustificationType(juce::Justification::centred);
   bendTimeLabel.attachToComponent(&bendTimeSlider, false);
-  addAndMakeVisible(bendTimeLabel);
+  content.addAndMakeVisible(bendTimeLabel);
 
   // Bend Curve Slider
   bendCurveSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
-  bendCurveSlider.setRange(-2.0, 2.0, 0.01);
   bendCurveSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 90, 20);
-  bendCurveSlider.setValue(*audioProcessor.bendCurve);
-  bendCurveSlider.onValueChange = [this]
-  {
-    *audioProcessor.bendCurve = static_cast<float>(bendCurveSlider.getValue());
-  };
-  addAndMakeVisible(bendCurveSlider);
+  content.addAndMakeVisible(bendCurveSlider);
+  bendCurveAttachment = std::make_unique<SliderAttachment>(audioProcessor.parameters, "bendCurve", bendCurveSlider);
 
-  bendCurveLabel.setText("Bend Curve", juce::dontSendNotification);
   bendCurveLabel.setJustificationType(juce::Justification::centred);
   bendCurveLabel.attachToComponent(&bendCurveSlider, false);
-  addAndMakeVisible(bendCurveLabel);
+  content.addAndMakeVisible(bendCurveLabel);
+
+  for (auto &control : learnableControls)
+  {
+    control.label.setText(control.title, juce::dontSendNotification);
+    control.slider.addMouseListener(this, true);
+  }
+
+  // Bend curve display
+  content.addAndMakeVisible(curveDisplay);
+
+  // Sounding voices and their member channels
+  content.addAndMakeVisible(keyboardMap);
+
+  // Status line
+  statusLabel.setJustificationType(juce::Justification::centred);
+  statusLabel.setFont(juce::FontOptions(13.0f));
+  statusLabel.setMinimumHorizontalScale(0.7f);
+  content.addAndMakeVisible(statusLabel);
+
+  // Performance overlay, hidden until asked for
+  content.addChildComponent(performanceHud);
+  hudButton.setButtonText("HUD");
+  hudButton.onClick = [this] { performanceHud.setVisible(hudButton.getToggleState()); };
+  content.addAndMakeVisible(hudButton);
+
+  // Rendering toggle
+  openGLButton.setButtonText("GPU");
+  content.addAndMakeVisible(openGLButton);
+  openGLAttachment = std::make_unique<ButtonAttachment>(audioProcessor.parameters, "openGLRendering", openGLButton);
+
+  // Tuning loader
+  tuningButton.setButtonText("Tuning...");
+  tuningButton.onClick = [this] { chooseTuning(); };
+  content.addAndMakeVisible(tuningButton);
+
+  // Output capture, which carries on with the editor closed
+  captureButton.setButtonText(audioProcessor.getMidiCapture().isCapturing() ? "Stop" : "Record");
+  captureButton.onClick = [this] { toggleCapture(); };
+  content.addAndMakeVisible(captureButton);
+
+#if BCS_PHASE_TRACE
+  phaseTraceButton.setButtonText("Trace");
+  phaseTraceButton.onClick = [this] { togglePhaseTrace(); };
+  content.addAndMakeVisible(phaseTraceButton);
+#endif
+
+  layoutContent();
+
+  // Opens at the size it was last left at
+  setResizable(true, true);
+  getConstrainer()->setFixedAspectRatio(static_cast<double>(designWidth) / designHeight);
+  setResizeLimits(designWidth / 2, designHeight / 2, designWidth * 3, designHeight * 3);
+
+  auto scale = juce::jlimit(0.5f, 3.0f, audioProcessor.getEditorScale());
+  setSize(juce::roundToInt(designWidth * scale), juce::roundToInt(designHeight * scale));
+
+  updateRenderer();
+  audioProcessor.subscribeTelemetry();
+  frameUpdater.addAnimator(frameAnimator);
+  frameAnimator.start();
 }
 
 PitchBendEditor::~PitchBendEditor()
 {
+  frameAnimator.complete();
+  audioProcessor.unsubscribeTelemetry();
+  openGLContext.detach();
+  audioProcessor.getPhaseTracer().stop();
+  setLookAndFeel(nullptr);
 }
 
-void PitchBendEditor::paint(juce::Graphics &g)
+void PitchBendEditor::toggleCapture()
+{
+  auto &capture = audioProcessor.getMidiCapture();
+
+  if (capture.isCapturing())
+  {
+    capture.stop();
+    captureButton.setButtonText("Record");
+    return;
+  }
+
+  captureChooser = std::make_unique<juce::FileChooser>("Record the output to", juce::File(), "*.mid");
+
+  captureChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting,
+                              [this](const juce::FileChooser &chooser)
+                              {
+                                auto midiFile = chooser.getResult();
+
+                                if (midiFile == juce::File())
+                                  return;
+
+                                if (audioProcessor.getMidiCapture().start(midiFile.withFileExtension("mid")))
+                                  captureButton.setButtonText("Stop");
+                                else
+                                  juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                                                         "Not recording", "Couldn't write " + midiFile.getFullPathName());
+                              });
+}
+
+#if BCS_PHASE_TRACE
+void PitchBendEditor::togglePhaseTrace()
+{
+  auto &tracer = audioProcessor.getPhaseTracer();
+
+  if (!tracer.isCapturing())
+  {
+    tracer.start();
+    phaseTraceButton.setButtonText("Stop");
+    return;
+  }
+
+  tracer.stop();
+  tracer.collect();
+  phaseTraceButton.setButtonText("Trace");
+
+  phaseTraceChooser = std::make_unique<juce::FileChooser>("Save the phase trace", juce::File(), "*.json");
+
+  phaseTraceChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting,
+                                 [this](const juce::FileChooser &chooser)
+                                 {
+                                   auto traceFile = chooser.getResult();
+
+                                   if (traceFile != juce::File() && !audioProcessor.getPhaseTracer().writeChromeTrace(traceFile))
+                                     juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                                                            "Trace not saved", "Couldn't write " + traceFile.getFullPathName());
+                                 });
+}
+#endif
+
+void PitchBendEditor::chooseTuning()
+{
+  tuningChooser = std::make_unique<juce::FileChooser>("Load a Scala tuning", juce::File(), "*.scl");
+
+  tuningChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                             [this](const juce::FileChooser &chooser)
+                             {
+                               auto scaleFile = chooser.getResult();
+
+                               if (scaleFile == juce::File())
+                                 return;
+
+                               auto mappingFile = scaleFile.withFileExtension("kbm");
+
+                               if (!mappingFile.existsAsFile())
+                                 mappingFile = juce::File();
+
+                               juce::Component::SafePointer<PitchBendEditor> editor(this);
+
+                               audioProcessor.loadTuning(scaleFile, mappingFile, [editor, scaleFile](const juce::String &error)
+                                                         {
+                                                           if (error.isNotEmpty())
+                                                             juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                                                                                    "Tuning not loaded", error);
+                                                           else if (editor != nullptr)
+                                                             editor->tuningButton.setButtonText(scaleFile.getFileNameWithoutExtension());
+                                                         });
+                             });
+}
+
+void PitchBendEditor::mouseDown(const juce::MouseEvent &e)
+{
+  if (!e.mods.isPopupMenu())
+    return;
+
+  for (const auto &control : learnableControls)
+    if (e.originalComponent == &control.slider || control.slider.isParentOf(e.originalComponent))
+      showMidiLearnMenu(control);
+}
+
+void PitchBendEditor::showMidiLearnMenu(const LearnableControl &control)
+{
+  auto mapping = audioProcessor.getMidiLearn(control.parameterID);
+  auto armed = audioProcessor.getArmedMidiLearn() == control.parameterID;
+  juce::PopupMenu menu;
+
+  if (armed)
+    menu.addItem("Cancel MIDI Learn", [this] { audioProcessor.armMidiLearn({}); });
+  else
+    menu.addItem("MIDI Learn", [this, &control] { audioProcessor.armMidiLearn(control.parameterID); });
+
+  if (mapping.channel > 0)
+    menu.addItem("Forget CC " + juce::String(mapping.controller) + " on Channel " + juce::String(mapping.channel),
+                 [this, &control] { audioProcessor.clearMidiLearn(control.parameterID); });
+
+  menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&control.slider));
+}
+
+void PitchBendEditor::updateMidiLearnLabels()
+{
+  auto armed = audioProcessor.getArmedMidiLearn();
+
+  if (armed == shownMidiLearn)
+    return;
+
+  for (const auto &control : learnableControls)
+    control.label.setText(armed == control.parameterID ? "Move a Control..." : control.title, juce::dontSendNotification);
+
+  shownMidiLearn = armed;
+}
+
+void PitchBendEditor::updateRenderer()
+{
+  // The native context is created once the editor is on screen; a null raw context after
+  // that means the system has no usable OpenGL
+  if (openGLContext.isAttached() && isShowing() && openGLContext.getRawContext() == nullptr)
+  {
+    openGLContext.detach();
+    openGLUnavailable = true;
+    openGLButton.setEnabled(false);
+  }
+
+  auto wanted = audioProcessor.openGLRendering->get() && !openGLUnavailable;
+
+  if (wanted == openGLContext.isAttached())
+    return;
+
+  if (wanted)
+    openGLContext.attachTo(*this);
+  else
+    openGLContext.detach();
+}
+
+void PitchBendEditor::onFrame()
+{
+  // Kept drained while capturing, so the audio thread's ring doesn't fill
+  if (audioProcessor.getPhaseTracer().isCapturing())
+    audioProcessor.getPhaseTracer().collect();
+
+  updateRenderer();
+  updateMidiLearnLabels();
+  curveDisplay.refresh();
+  keyboardMap.refresh();
+  updateStatus();
+}
+
+size_t PitchBendEditor::getCacheBytes() const
+{
+  return EditorLookAndFeel::getImageBytes(backgroundImage) + lookAndFeel.getCacheBytes()
+         + curveDisplay.getCacheBytes() + keyboardMap.getCacheBytes();
+}
+
+void PitchBendEditor::updateStatus()
+{
+  auto numRecords = audioProcessor.readTelemetry(telemetryRecords.data(), static_cast<int>(telemetryRecords.size()));
+  if (performanceHud.isVisible())
+    performanceHud.setMemory(audioProcessor.getMemoryFootprint().total(), getCacheBytes(), CurveTableCache::getMemoryBytes());
+
+  performanceHud.addRecords(telemetryRecords.data(), numRecords);
+
+  for (int i = 0; i < numRecords; ++i)
+  {
+    const auto &record = telemetryRecords[static_cast<size_t>(i)];
+    statusProcessSeconds += record.processSeconds;
+    statusBlockSeconds += record.blockSeconds;
+    statusBendsSent += record.bendsSent;
+  }
+
+  if (numRecords > 0)
+    latestRecord = telemetryRecords[static_cast<size_t>(numRecords - 1)];
+
+  // Nothing processed since the last update (transport stopped or bypassed); keep showing the last values
+  auto now = juce::Time::getMillisecondCounterHiRes();
+
+  if (statusBlockSeconds <= 0.0f || now - lastStatusMs < statusIntervalMs)
+    return;
+
+  // Voices and channels as of the most recent block
+  juce::String channels;
+
+  for (auto mask = latestRecord.channelMask; mask != 0; mask &= mask - 1)
+    channels << " " << (lowestSetBit(mask) + 1);
+
+  auto load = statusProcessSeconds / statusBlockSeconds;
+  auto bendsPerSecond = static_cast<float>(statusBendsSent) / statusBlockSeconds;
+
+  statusLabel.setText(juce::String(latestRecord.activeVoices) + " voices" + (channels.isEmpty() ? juce::String() : "  ch" + channels)
+                          + "  " + juce::String(juce::roundToInt(bendsPerSecond)) + " bends/s"
+                          + "  CPU " + juce::String(load * 100.0f, 2) + "% (worst " + juce::String(audioProcessor.getLoadMonitor().getWorstLoad() * 100.0f, 2) + "%)",
+                      juce::dontSendNotification);
+
+  statusProcessSeconds = 0.0f;
+  statusBlockSeconds = 0.0f;
+  statusBendsSent = 0;
+  lastStatusMs = now;
+}
+
+void PitchBendEditor::renderBackground(float scale)
 {
+  backgroundImage = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(getWidth() * scale)),
+                                juce::jmax(1, juce::roundToInt(getHeight() * scale)), false);
+
+  juce::Graphics g(backgroundImage);
   g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
 
+  g.addTransform(content.getTransform().scaled(scale));
   g.setColour(juce::Colours::white);
-  g.setFont(20.0f);
-  g.drawFittedText("Pitch Bend FX", getLocalBounds().removeFromTop(40),
-                   juce::Justification::centred, 1);
+  titleGlyphs.draw(g);
+}
+
+void PitchBendEditor::paint(juce::Graphics &g)
+{
+  auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+  if (backgroundImage.isNull() || backgroundImage.getWidth() != juce::roundToInt(getWidth() * scale))
+    renderBackground(scale);
+
+  g.drawImage(backgroundImage, getLocalBounds().toFloat());
 }
 
 void PitchBendEditor::resized()
 {
-  auto area = getLocalBounds().reduced(20);
+  auto scale = static_cast<float>(getWidth()) / designWidth;
+
+  content.setTransform(juce::AffineTransform::scale(scale));
+  backgroundImage = {};
+  lookAndFeel.clearCache();
+  audioProcessor.setEditorScale(scale);
+}
+
+void PitchBendEditor::lookAndFeelChanged()
+{
+  backgroundImage = {};
+  lookAndFeel.clearCache();
+  repaint();
+}
+
+void PitchBendEditor::layoutContent()
+{
+  content.setSize(designWidth, designHeight);
+
+  // Falls back to the default font if the embedded one couldn't be loaded
+  auto titleFont = assets->titleTypeface != nullptr ? juce::FontOptions(assets->titleTypeface).withHeight(20.0f)
+                                                    : juce::FontOptions(20.0f);
+  titleGlyphs.clear();
+  titleGlyphs.addFittedText(titleFont, "Pitch Bend FX", 0.0f, 0.0f, static_cast<float>(designWidth), 40.0f,
+                            juce::Justification::centred, 1);
+
+  openGLButton.setBounds(designWidth - 70, 10, 60, 24);
+  tuningButton.setBounds(designWidth - 170, 10, 90, 24);
+  hudButton.setBounds(designWidth - 240, 10, 60, 24);
+  captureButton.setBounds(10, 10, 70, 24);
+
+#if BCS_PHASE_TRACE
+  phaseTraceButton.setBounds(designWidth - 310, 10, 60, 24);
+#endif
+
+  auto area = content.getLocalBounds().reduced(20);
   area.removeFromTop(40); // Space for title
 
+  // Keyboard and channel map along the bottom
+  keyboardMap.setBounds(area.removeFromBottom(70));
+  area.removeFromBottom(10);
+
+  // Curve display with the status line under it, to the right of the sliders
+  auto displayArea = area.removeFromRight(280);
+  area.removeFromRight(20);
+  statusLabel.setBounds(displayArea.removeFromBottom(20));
+  displayArea.removeFromBottom(6);
+  curveDisplay.setBounds(displayArea);
+  performanceHud.setBounds(displayArea.reduced(10));
+
   auto sliderHeight = area.getHeight() / 3;
 
   auto bendAmountArea = area.removeFromTop(sliderHeight);
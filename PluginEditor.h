@@ -2,6 +2,11 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "CurveDisplay.h"
+#include "KeyboardMapView.h"
+#include "PerformanceHud.h"
+#include "PresetIndex.h"
+#include "EditorLookAndFeel.h"
 
 class PitchBendEditor : public juce::AudioProcessorEditor
 {
@@ -11,18 +16,136 @@ public:
 
   void paint(juce::Graphics &) override;
   void resized() override;
+  void lookAndFeelChanged() override;
+  void mouseDown(const juce::MouseEvent &) override;
+
+  // For the editor benchmark: one frame's updates without waiting for the display, and the
+  // HUD shown as its button shows it
+  void updateFrame() { onFrame(); }
+  void setHudVisible(bool visible) { hudButton.setToggleState(visible, juce::sendNotification); }
 
 private:
+  // Laid out once at this size; resizing scales the whole editor, which keeps its shape
+  static constexpr int designWidth = 640;
+  static constexpr int designHeight = 380;
+  using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+  using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+
   PitchBendProcessor &audioProcessor;
+  EditorLookAndFeel lookAndFeel;
+
+  // Holds the controls at the design size, scaled to the editor's
+  juce::Component content;
+
+  // Background and title rasterized at the screen's pixel scale, drawn again only after a
+  // resize or a colour change
+  juce::Image backgroundImage;
 
   juce::Slider bendAmountSlider;
   juce::Label bendAmountLabel;
+  std::unique_ptr<SliderAttachment> bendAmountAttachment;
 
   juce::Slider bendTimeSlider;
   juce::Label bendTimeLabel;
+  std::unique_ptr<SliderAttachment> bendTimeAttachment;
 
   juce::Slider bendCurveSlider;
   juce::Label bendCurveLabel;
+  std::unique_ptr<SliderAttachment> bendCurveAttachment;
+
+  // MIDI learn, from a right-click on a bend slider. The armed parameter's label asks for a
+  // controller until one arrives.
+  struct LearnableControl
+  {
+    juce::Slider &slider;
+    juce::Label &label;
+    const char *parameterID;
+    const char *title;
+  };
+
+  std::array<LearnableControl, 3> learnableControls{{{bendAmountSlider, bendAmountLabel, "bendAmount", "Bend Amount"},
+                                                     {bendTimeSlider, bendTimeLabel, "bendTime", "Bend Time (s)"},
+                                                     {bendCurveSlider, bendCurveLabel, "bendCurve", "Bend Curve"}}};
+  juce::String shownMidiLearn;
+
+  CurveDisplay curveDisplay;
+  KeyboardMapView keyboardMap;
+
+  // Activity readout, drained from the processor's telemetry every frame and shown at a
+  // readable rate
+  static constexpr double statusIntervalMs = 100.0;
+
+  juce::Label statusLabel;
+  std::array<TelemetryRecord, TelemetryFifo::capacity> telemetryRecords{};
+  TelemetryRecord latestRecord;
+  float statusProcessSeconds = 0.0f;
+  float statusBlockSeconds = 0.0f;
+  int statusBendsSent = 0;
+  double lastStatusMs = 0.0;
+
+  // The same telemetry in more detail, over the curve display while toggled on
+  PerformanceHud performanceHud;
+  juce::ToggleButton hudButton;
+
+  // GPU compositing, attached while the openGLRendering parameter is on. If no context
+  // could be created this instance stays on software rendering.
+  juce::OpenGLContext openGLContext;
+  bool openGLUnavailable = false;
+
+  juce::ToggleButton openGLButton;
+  std::unique_ptr<ButtonAttachment> openGLAttachment;
+
+  // Scala tuning; a .kbm with the same name next to the chosen .scl is loaded with it
+  juce::TextButton tuningButton;
+  std::unique_ptr<juce::FileChooser> tuningChooser;
+
+  // Records the output to a .mid file, chosen first, until pressed again
+  juce::TextButton captureButton;
+  std::unique_ptr<juce::FileChooser> captureChooser;
+
+  void toggleCapture();
+
+#if BCS_PHASE_TRACE
+  // Captures processBlock's phase timing until pressed again, then saves it as a Chrome trace
+  juce::TextButton phaseTraceButton;
+  std::unique_ptr<juce::FileChooser> phaseTraceChooser;
+
+  void togglePhaseTrace();
+#endif
+
+  // The title font, loaded from the embedded rainyhearts.ttf by the first editor to open
+  // and shared by every editor open in the process
+  struct SharedAssets
+  {
+    SharedAssets();
+    juce::Typeface::Ptr titleTypeface;
+  };
+
+  juce::SharedResourcePointer<SharedAssets> assets;
+
+  // The user preset library's index for the browser, shared by every open editor. The first
+  // editor to open starts it from the cache on disk, so it lists at once and fills in the
+  // library's changes in the background.
+  juce::SharedResourcePointer<PresetIndex> presetIndex;
+
+  // Laid out with the controls, so the background only draws the glyphs
+  juce::GlyphArrangement titleGlyphs;
+
+  // Everything on screen moves on the display's refresh, in one callback per frame for the
+  // editor, the curve display and the keyboard map, so their repaints land in the same
+  // frame. A frame with no new telemetry or voice positions repaints nothing.
+  juce::VBlankAnimatorUpdater frameUpdater{this};
+  juce::Animator frameAnimator = juce::ValueAnimatorBuilder{}.runningInfinitely().withValueChangedCallback([this](float) { onFrame(); }).build();
+
+  void layoutContent();
+  void renderBackground(float scale);
+  void chooseTuning();
+  void showMidiLearnMenu(const LearnableControl &control);
+  void updateMidiLearnLabels();
+  void updateRenderer();
+  void updateStatus();
+  size_t getCacheBytes() const;
+  void onFrame();
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchBendEditor)
 };
\ No newline at end of file
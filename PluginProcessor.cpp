@@ -1,27 +1,615 @@
 #include "PluginProcessor.h"
+#include "CurveExpression.h"
+
+#if ! BCS_HEADLESS
 #include "PluginEditor.h"
+#endif
+
+// The iPad build (BCS_MOBILE) starts from the defaults that wake the CPU least
+#ifndef BCS_MOBILE
+#define BCS_MOBILE 0
+#endif
+
+namespace
+{
+    constexpr bool mobileBuild = BCS_MOBILE != 0;
+
+    struct NoteValue
+    {
+        const char *name;
+        double quarterNotes;
+    };
+
+    constexpr NoteValue syncedNoteValues[] = {
+        {"1/64", 1.0 / 16.0},
+        {"1/32", 1.0 / 8.0},
+        {"1/16T", 1.0 / 6.0},
+        {"1/16", 1.0 / 4.0},
+        {"1/16D", 3.0 / 8.0},
+        {"1/8T", 1.0 / 3.0},
+        {"1/8", 1.0 / 2.0},
+        {"1/8D", 3.0 / 4.0},
+        {"1/4T", 2.0 / 3.0},
+        {"1/4", 1.0},
+        {"1/4D", 3.0 / 2.0},
+        {"1/2T", 4.0 / 3.0},
+        {"1/2", 2.0},
+        {"1/2D", 3.0},
+        {"1/1", 4.0},
+        {"2/1", 8.0},
+    };
+
+    // Adds an event at the end of the buffer. Unlike MidiBuffer::addEvent there is no search
+    // for the insert position, so events must arrive in time order. The bytes are copied
+    // once, straight from where they are, so a long sysex costs no more than its length.
+    void appendMidiEvent(juce::MidiBuffer &buffer, const juce::uint8 *data, int numBytes, int samplePos)
+    {
+        juce::uint8 header[sizeof(juce::int32) + sizeof(juce::uint16)];
+        juce::writeUnaligned<juce::int32>(header, samplePos);
+        juce::writeUnaligned<juce::uint16>(header + sizeof(juce::int32), static_cast<juce::uint16>(numBytes));
+
+        buffer.data.addArray(static_cast<const juce::uint8 *>(header), static_cast<int>(sizeof(header)));
+        buffer.data.addArray(data, numBytes);
+    }
+
+    juce::StringArray getSyncedNoteValueNames()
+    {
+        juce::StringArray names;
+        for (const auto &value : syncedNoteValues)
+            names.add(value.name);
+        return names;
+    }
+}
 
+// The MIDI effect build has no audio buses at all; the instrument build keeps a silent
+// stereo pair for hosts that only route MIDI out of instruments
 PitchBendProcessor::PitchBendProcessor()
+#if JucePlugin_IsMidiEffect
+    : AudioProcessor(BusesProperties()),
+#else
     : AudioProcessor(BusesProperties()
                          .withInput("Input", juce::AudioChannelSet::stereo(), true)
-                         .withOutput("Output", juce::AudioChannelSet::stereo(), true))
-{
-    addParameter(bendAmount = new juce::AudioParameterFloat("bendAmount", "Bend Amount",
-                                                            juce::NormalisableRange<float>(0.0f, 2.0f, 0.01f),
-                                                            1.0f));
-    addParameter(bendTime = new juce::AudioParameterFloat("bendTime", "Bend Time",
-                                                          juce::NormalisableRange<float>(0.01f, 2.0f, 0.01f),
-                                                          0.5f));
-    addParameter(bendCurve = new juce::AudioParameterFloat("bendCurve", "Bend Curve",
+                         .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+#endif
+      parameters(*this, nullptr, "PARAMETERS", createParameterLayout()),
+      hostNotifier(*this),
+      stateSerializer(parameters, hostNotifier)
+{
+    bendAmount = getTypedParameter<juce::AudioParameterFloat>("bendAmount");
+    bendTime = getTypedParameter<juce::AudioParameterFloat>("bendTime");
+    bendCurve = getTypedParameter<juce::AudioParameterFloat>("bendCurve");
+    channelRotation = getTypedParameter<juce::AudioParameterChoice>("channelRotation");
+    stealPolicy = getTypedParameter<juce::AudioParameterChoice>("stealPolicy");
+    voiceOverflow = getTypedParameter<juce::AudioParameterChoice>("voiceOverflow");
+    notePriority = getTypedParameter<juce::AudioParameterChoice>("notePriority");
+    updateMode = getTypedParameter<juce::AudioParameterChoice>("updateMode");
+    updateRate = getTypedParameter<juce::AudioParameterFloat>("updateRate");
+    updateCeiling = getTypedParameter<juce::AudioParameterFloat>("updateCeiling");
+    updatesPerBend = getTypedParameter<juce::AudioParameterInt>("updatesPerBend");
+    smoothAutomation = getTypedParameter<juce::AudioParameterBool>("smoothAutomation");
+    tempoSync = getTypedParameter<juce::AudioParameterBool>("tempoSync");
+    syncedBendTime = getTypedParameter<juce::AudioParameterChoice>("syncedBendTime");
+    outputMode = getTypedParameter<juce::AudioParameterChoice>("outputMode");
+    budgetEnabled = getTypedParameter<juce::AudioParameterBool>("budgetEnabled");
+    messageBudget = getTypedParameter<juce::AudioParameterInt>("messageBudget");
+    morphEnabled = getTypedParameter<juce::AudioParameterBool>("morphEnabled");
+    morphController = getTypedParameter<juce::AudioParameterInt>("morphController");
+    morphFrom = getTypedParameter<juce::AudioParameterInt>("morphFrom");
+    morphTo = getTypedParameter<juce::AudioParameterInt>("morphTo");
+    coalesceOutput = getTypedParameter<juce::AudioParameterBool>("coalesceOutput");
+    coalesceDeadband = getTypedParameter<juce::AudioParameterFloat>("coalesceDeadband");
+    openGLRendering = getTypedParameter<juce::AudioParameterBool>("openGLRendering");
+    zoneSplit = getTypedParameter<juce::AudioParameterBool>("zoneSplit");
+    splitNote = getTypedParameter<juce::AudioParameterInt>("splitNote");
+    upperZoneChannels = getTypedParameter<juce::AudioParameterInt>("upperZoneChannels");
+    upperBendAmount = getTypedParameter<juce::AudioParameterFloat>("upperBendAmount");
+    upperBendTime = getTypedParameter<juce::AudioParameterFloat>("upperBendTime");
+    upperBendCurve = getTypedParameter<juce::AudioParameterFloat>("upperBendCurve");
+    bendRange = getTypedParameter<juce::AudioParameterInt>("bendRange");
+    amountUnits = getTypedParameter<juce::AudioParameterChoice>("amountUnits");
+    bendSemitones = getTypedParameter<juce::AudioParameterFloat>("bendSemitones");
+    upperBendSemitones = getTypedParameter<juce::AudioParameterFloat>("upperBendSemitones");
+    stackMode = getTypedParameter<juce::AudioParameterChoice>("stackMode");
+    strumMode = getTypedParameter<juce::AudioParameterChoice>("strumMode");
+    strumSpread = getTypedParameter<juce::AudioParameterFloat>("strumSpread");
+    legato = getTypedParameter<juce::AudioParameterBool>("legato");
+    glideTime = getTypedParameter<juce::AudioParameterFloat>("glideTime");
+    releaseBend = getTypedParameter<juce::AudioParameterBool>("releaseBend");
+    releaseAmount = getTypedParameter<juce::AudioParameterFloat>("releaseAmount");
+    releaseTime = getTypedParameter<juce::AudioParameterFloat>("releaseTime");
+    holdTime = getTypedParameter<juce::AudioParameterFloat>("holdTime");
+    returnTime = getTypedParameter<juce::AudioParameterFloat>("returnTime");
+    returnCurve = getTypedParameter<juce::AudioParameterFloat>("returnCurve");
+    bendLayerCount = getTypedParameter<juce::AudioParameterInt>("bendLayers");
+
+    for (size_t layer = 0; layer < layerParameters.size(); ++layer)
+    {
+        auto id = "layer" + juce::String(static_cast<int>(layer) + 2);
+        layerParameters[layer] = {getTypedParameter<juce::AudioParameterFloat>(id + "Amount"),
+                                  getTypedParameter<juce::AudioParameterFloat>(id + "Time"),
+                                  getTypedParameter<juce::AudioParameterFloat>(id + "Curve"),
+                                  getTypedParameter<juce::AudioParameterFloat>(id + "Delay")};
+    }
+    velocityToAmount = getTypedParameter<juce::AudioParameterFloat>("velocityToAmount");
+    velocityToTime = getTypedParameter<juce::AudioParameterFloat>("velocityToTime");
+    velocityCurve = getTypedParameter<juce::AudioParameterFloat>("velocityCurve");
+    keyToAmount = getTypedParameter<juce::AudioParameterFloat>("keyToAmount");
+    keyToTime = getTypedParameter<juce::AudioParameterFloat>("keyToTime");
+    keyCurve = getTypedParameter<juce::AudioParameterFloat>("keyCurve");
+    humanizeAmount = getTypedParameter<juce::AudioParameterFloat>("humanizeAmount");
+    humanizeTime = getTypedParameter<juce::AudioParameterFloat>("humanizeTime");
+    humanizeCurve = getTypedParameter<juce::AudioParameterFloat>("humanizeCurve");
+    pressureToAmount = getTypedParameter<juce::AudioParameterFloat>("pressureToAmount");
+    pressureSmoothing = getTypedParameter<juce::AudioParameterFloat>("pressureSmoothing");
+    oscOutput = getTypedParameter<juce::AudioParameterBool>("oscOutput");
+    oscPort = getTypedParameter<juce::AudioParameterInt>("oscPort");
+    oscRate = getTypedParameter<juce::AudioParameterFloat>("oscRate");
+    sharedMemoryOutput = getTypedParameter<juce::AudioParameterBool>("sharedMemoryOutput");
+    bendDeadband = getTypedParameter<juce::AudioParameterFloat>("bendDeadband");
+    curveError = getTypedParameter<juce::AudioParameterFloat>("curveError");
+    receiverSmoothing = getTypedParameter<juce::AudioParameterFloat>("receiverSmoothing");
+    adaptiveQuality = getTypedParameter<juce::AudioParameterBool>("adaptiveQuality");
+    adaptiveThreshold = getTypedParameter<juce::AudioParameterFloat>("adaptiveThreshold");
+    fixedPoint = getTypedParameter<juce::AudioParameterBool>("fixedPoint");
+    fitDeadband = getTypedParameter<juce::AudioParameterBool>("fitDeadband");
+    offlineQuality = getTypedParameter<juce::AudioParameterBool>("offlineQuality");
+    stealRamp = getTypedParameter<juce::AudioParameterFloat>("stealRamp");
+    serialOutput = getTypedParameter<juce::AudioParameterBool>("serialOutput");
+    scopeChannel = getTypedParameter<juce::AudioParameterChoice>("scopeChannel");
+    scopeLowNote = getTypedParameter<juce::AudioParameterInt>("scopeLowNote");
+    scopeHighNote = getTypedParameter<juce::AudioParameterInt>("scopeHighNote");
+    retriggerDebounce = getTypedParameter<juce::AudioParameterFloat>("retriggerDebounce");
+    ccHysteresis = getTypedParameter<juce::AudioParameterInt>("ccHysteresis");
+    ccMaxRate = getTypedParameter<juce::AudioParameterFloat>("ccMaxRate");
+    previewSynth = getTypedParameter<juce::AudioParameterBool>("previewSynth");
+    masterBend = getTypedParameter<juce::AudioParameterBool>("masterBend");
+    vibratoDepth = getTypedParameter<juce::AudioParameterFloat>("vibratoDepth");
+    vibratoRate = getTypedParameter<juce::AudioParameterFloat>("vibratoRate");
+    vibratoDelay = getTypedParameter<juce::AudioParameterFloat>("vibratoDelay");
+    vibratoSpread = getTypedParameter<juce::AudioParameterFloat>("vibratoSpread");
+    pressureLane = getTypedParameter<juce::AudioParameterBool>("pressureLane");
+    pressureFrom = getTypedParameter<juce::AudioParameterInt>("pressureFrom");
+    pressureTo = getTypedParameter<juce::AudioParameterInt>("pressureTo");
+    timbreLane = getTypedParameter<juce::AudioParameterBool>("timbreLane");
+    timbreFrom = getTypedParameter<juce::AudioParameterInt>("timbreFrom");
+    timbreTo = getTypedParameter<juce::AudioParameterInt>("timbreTo");
+    latchParameters = getTypedParameter<juce::AudioParameterBool>("latchParameters");
+    lookaheadTime = getTypedParameter<juce::AudioParameterFloat>("lookahead");
+    releaseOnStop = getTypedParameter<juce::AudioParameterBool>("releaseOnStop");
+    bendTargetMode = getTypedParameter<juce::AudioParameterChoice>("bendTarget");
+    targetScale = getTypedParameter<juce::AudioParameterChoice>("scale");
+    targetScaleRoot = getTypedParameter<juce::AudioParameterChoice>("scaleRoot");
+    chordMemory = getTypedParameter<juce::AudioParameterChoice>("chordMemory");
+    transientRetrigger = getTypedParameter<juce::AudioParameterBool>("transientRetrigger");
+    transientThreshold = getTypedParameter<juce::AudioParameterFloat>("transientThreshold");
+    mpeInput = getTypedParameter<juce::AudioParameterChoice>("mpeInput");
+    sharedPool = getTypedParameter<juce::AudioParameterInt>("sharedPool");
+    autoZoneSize = getTypedParameter<juce::AudioParameterBool>("autoZoneSize");
+    linkGroup = getTypedParameter<juce::AudioParameterInt>("linkGroup");
+    meterVoices = getTypedParameter<juce::AudioParameterFloat>("meterVoices");
+    meterBendRate = getTypedParameter<juce::AudioParameterFloat>("meterBendRate");
+    meterSteals = getTypedParameter<juce::AudioParameterFloat>("meterSteals");
+    meterLoad = getTypedParameter<juce::AudioParameterFloat>("meterLoad");
+
+    for (int target = 0; target < numLearnableParameters; ++target)
+    {
+        learnableParameters[static_cast<size_t>(target)] = getTypedParameter<juce::RangedAudioParameter>(learnableParameterIDs[target]);
+        counters.learnedValues[static_cast<size_t>(target)] = -1.0f;
+    }
+
+    for (size_t i = 0; i < linkedParameters.size(); ++i)
+        linkedParameters[i] = getTypedParameter<juce::RangedAudioParameter>(LinkedSettings::parameterIDs[i]);
+
+    // The meters are written by the timer and change nothing processBlock reads
+    for (auto *parameter : getParameters())
+        if (parameter->getCategory() != juce::AudioProcessorParameter::otherMeter)
+            parameter->addListener(this);
+
+    // Values set through the notifier reach the listeners late, but the snapshot and the
+    // state cache can't wait for them
+    hostNotifier.onValueSet = [this](juce::RangedAudioParameter &parameter)
+    {
+        if (parameter.getCategory() != juce::AudioProcessorParameter::otherMeter)
+            control.parameterGeneration.fetch_add(1, std::memory_order_release);
+    };
+
+    setBendRange(bendRange->get());
+    configureZones();
+    publishedCurveTolerance = curveErrorTolerance();
+    publishCurveTable(lowerZone, bendCurve->get());
+    publishCurveTable(upperZone, upperBendCurve->get());
+
+    for (size_t layer = 0; layer < layerParameters.size(); ++layer)
+        publishLayerTable(layer, layerParameters[layer].curve->get());
+
+    publishMorphEndpoints(morphFrom->get() - 1, morphTo->get() - 1);
+    publishEnvelope(holdTime->get(), returnTime->get(), returnCurve->get());
+
+    activeConfig = &engineConfig.acquire();
+    envelope = &activeConfig->envelope;
+
+    auto logCategories = juce::SystemStats::getEnvironmentVariable("BCS_REALTIME_LOG", {});
+
+    if (logCategories.isNotEmpty())
+    {
+        auto logFile = juce::FileLogger::getSystemLogFileFolder().getChildFile("Better Chord Stacks").getChildFile("realtime.log");
+        realtimeLog.start(logFile.getNonexistentSibling(), LogCategory::fromString(logCategories));
+    }
+
+    auto flightReports = juce::SystemStats::getEnvironmentVariable("BCS_FLIGHT_RECORDER", {});
+
+    if (flightReports.isNotEmpty())
+        flightRecorder.start(juce::File::isAbsolutePath(flightReports)
+                                 ? juce::File(flightReports)
+                                 : juce::FileLogger::getSystemLogFileFolder().getChildFile("Better Chord Stacks").getChildFile("Flight Recorder"));
+
+    startTimerHz(30);
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout PitchBendProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>("bendAmount", "Bend Amount",
+                                                           juce::NormalisableRange<float>(0.0f, 2.0f, 0.01f),
+                                                           1.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("bendTime", "Bend Time",
+                                                           juce::NormalisableRange<float>(0.01f, 2.0f, 0.01f),
+                                                           0.5f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("bendCurve", "Bend Curve",
+                                                           juce::NormalisableRange<float>(-2.0f, 2.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("channelRotation", "Channel Rotation",
+                                                            juce::StringArray{"Lowest Free", "Least Recently Used"},
+                                                            1));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("stealPolicy", "Steal Policy",
+                                                            juce::StringArray{"Oldest", "Quietest", "Same Note"},
+                                                            0));
+
+    // With split zones, a note whose zone is full can take a free channel in the other zone
+    // before a voice is stolen
+    layout.add(std::make_unique<juce::AudioParameterChoice>("voiceOverflow", "Voice Overflow",
+                                                            juce::StringArray{"Steal", "Other Zone"},
+                                                            0));
+
+    // Which notes keep their channels in a full zone: the latest, or the top or bottom of
+    // what is held, which then also turns away new notes outside it
+    layout.add(std::make_unique<juce::AudioParameterChoice>("notePriority", "Note Priority",
+                                                            juce::StringArray{"Last", "Highest", "Lowest"},
+                                                            0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("updateMode", "Update Mode",
+                                                            juce::StringArray{"Fixed Rate", "Per Bend", "Adaptive", "Next Change"},
+                                                            mobileBuild ? 3 : 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("updateRate", "Update Rate",
+                                                           juce::NormalisableRange<float>(0.02f, 20.0f, 0.01f, 0.4f),
+                                                           1.45f));
+
+    // The most updates a voice sends per second in any update mode, for battery-powered
+    // hosts; the top of the range is no limit
+    layout.add(std::make_unique<juce::AudioParameterFloat>("updateCeiling", "Update Ceiling",
+                                                           juce::NormalisableRange<float>(20.0f, 50000.0f, 1.0f, 0.25f),
+                                                           mobileBuild ? 250.0f : 50000.0f));
+    layout.add(std::make_unique<juce::AudioParameterInt>("updatesPerBend", "Updates Per Bend", 4, 512, 64));
+    layout.add(std::make_unique<juce::AudioParameterBool>("smoothAutomation", "Smooth Automation", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>("tempoSync", "Tempo Sync", false));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("syncedBendTime", "Synced Bend Time",
+                                                            getSyncedNoteValueNames(), 6));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("outputMode", "Output Mode",
+                                                            juce::StringArray{"MPE", "MIDI 2.0 Per-Note", "Auto", "Single Channel"},
+                                                            0));
+    layout.add(std::make_unique<juce::AudioParameterBool>("budgetEnabled", "Bandwidth Budget", false));
+    layout.add(std::make_unique<juce::AudioParameterInt>("messageBudget", "Messages Per Second", 100, 3000, 1000));
+    layout.add(std::make_unique<juce::AudioParameterBool>("morphEnabled", "Preset Morph", false));
+    layout.add(std::make_unique<juce::AudioParameterInt>("morphController", "Morph Controller", 0, 119, 1));
+    layout.add(std::make_unique<juce::AudioParameterInt>("morphFrom", "Morph From Preset", 1, PresetBank::maxPresets, 1));
+    layout.add(std::make_unique<juce::AudioParameterInt>("morphTo", "Morph To Preset", 1, PresetBank::maxPresets, 2));
+    layout.add(std::make_unique<juce::AudioParameterBool>("coalesceOutput", "Coalesce Output", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("coalesceDeadband", "Coalesce Deadband",
+                                                           juce::NormalisableRange<float>(0.0f, 25.0f, 0.1f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("openGLRendering", "GPU Rendering", true,
+                                                          juce::AudioParameterBoolAttributes().withAutomatable(false)));
+    layout.add(std::make_unique<juce::AudioParameterBool>("zoneSplit", "Zone Split", false));
+    layout.add(std::make_unique<juce::AudioParameterInt>("splitNote", "Split Note", 0, 127, 60));
+    layout.add(std::make_unique<juce::AudioParameterInt>("upperZoneChannels", "Upper Zone Channels", 1, 13, 7));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("upperBendAmount", "Upper Bend Amount",
+                                                           juce::NormalisableRange<float>(0.0f, 2.0f, 0.01f),
+                                                           1.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("upperBendTime", "Upper Bend Time",
+                                                           juce::NormalisableRange<float>(0.01f, 2.0f, 0.01f),
+                                                           0.5f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("upperBendCurve", "Upper Bend Curve",
+                                                           juce::NormalisableRange<float>(-2.0f, 2.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterInt>("bendRange", "Bend Range", 1, 96, 48));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("amountUnits", "Amount Units",
+                                                            juce::StringArray{"Bend Range", "Semitones"}, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("bendSemitones", "Bend Semitones",
+                                                           juce::NormalisableRange<float>(0.0f, 96.0f, 0.01f),
+                                                           12.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("upperBendSemitones", "Upper Bend Semitones",
+                                                           juce::NormalisableRange<float>(0.0f, 96.0f, 0.01f),
+                                                           12.0f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("stackMode", "Stack Mode",
+                                                            juce::StringArray{"Uniform", "Just Intonation"}, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("strumMode", "Strum",
+                                                            juce::StringArray{"Off", "Up", "Down", "Random"}, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("strumSpread", "Strum Spread",
+                                                           juce::NormalisableRange<float>(0.0f, 500.0f, 0.1f, 0.5f),
+                                                           40.0f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("legato", "Legato", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("glideTime", "Glide Time",
+                                                           juce::NormalisableRange<float>(0.005f, 2.0f, 0.001f, 0.5f),
+                                                           0.1f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("releaseBend", "Release Bend", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("releaseAmount", "Release Amount",
+                                                           juce::NormalisableRange<float>(-24.0f, 24.0f, 0.01f),
+                                                           -2.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("releaseTime", "Release Time",
+                                                           juce::NormalisableRange<float>(0.01f, 2.0f, 0.01f),
+                                                           0.3f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("holdTime", "Hold Time",
+                                                           juce::NormalisableRange<float>(0.0f, 2.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("returnTime", "Return Time",
+                                                           juce::NormalisableRange<float>(0.0f, 2.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("returnCurve", "Return Curve",
+                                                           juce::NormalisableRange<float>(-2.0f, 2.0f, 0.01f),
+                                                           0.0f));
+
+    // Further bends summed onto each voice's, such as a slow scoop under a fast fall: each a
+    // rise of its own amount (semitones), time and curve, starting its delay after the note
+    layout.add(std::make_unique<juce::AudioParameterInt>("bendLayers", "Bend Layers", 1, maxBendLayers, 1));
+
+    for (int layer = 2; layer <= maxBendLayers; ++layer)
+    {
+        auto id = "layer" + juce::String(layer);
+        auto name = "Layer " + juce::String(layer);
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(id + "Amount", name + " Amount",
+                                                               juce::NormalisableRange<float>(-24.0f, 24.0f, 0.01f),
+                                                               0.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(id + "Time", name + " Time",
+                                                               juce::NormalisableRange<float>(0.01f, 4.0f, 0.01f, 0.5f),
+                                                               0.2f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(id + "Curve", name + " Curve",
+                                                               juce::NormalisableRange<float>(-2.0f, 2.0f, 0.01f),
+                                                               0.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(id + "Delay", name + " Delay",
+                                                               juce::NormalisableRange<float>(0.0f, 4.0f, 0.01f, 0.5f),
+                                                               0.0f));
+    }
+
+    // Tracking depths are the change in amount or time at the softest note, or at the
+    // bottom and top of the keyboard (in opposite directions) relative to middle C
+    layout.add(std::make_unique<juce::AudioParameterFloat>("velocityToAmount", "Velocity To Amount",
+                                                           juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("velocityToTime", "Velocity To Time",
+                                                           juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("velocityCurve", "Velocity Curve",
+                                                           juce::NormalisableRange<float>(-2.0f, 2.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("keyToAmount", "Key To Amount",
+                                                           juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("keyToTime", "Key To Time",
+                                                           juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("keyCurve", "Key Curve",
                                                            juce::NormalisableRange<float>(-2.0f, 2.0f, 0.01f),
                                                            0.0f));
 
-    channelInUse.fill(false);
-    channelInUse[0] = true; // Channel 1 is master channel in MPE lower zone
+    // Largest random change per voice: a fraction of the amount and time either way, and
+    // how far the rise may bow away from its curve
+    layout.add(std::make_unique<juce::AudioParameterFloat>("humanizeAmount", "Humanize Amount",
+                                                           juce::NormalisableRange<float>(0.0f, 0.5f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("humanizeTime", "Humanize Time",
+                                                           juce::NormalisableRange<float>(0.0f, 0.5f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("humanizeCurve", "Humanize Curve",
+                                                           juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+                                                           0.0f));
+
+    // Change in amount at full pressure, and how long a voice takes to follow its pressure (ms)
+    layout.add(std::make_unique<juce::AudioParameterFloat>("pressureToAmount", "Pressure To Amount",
+                                                           juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("pressureSmoothing", "Pressure Smoothing",
+                                                           juce::NormalisableRange<float>(0.0f, 500.0f, 1.0f),
+                                                           40.0f));
+
+    // OSC stream of the voices' bends, in bundles per second
+    layout.add(std::make_unique<juce::AudioParameterBool>("oscOutput", "OSC Output", false,
+                                                          juce::AudioParameterBoolAttributes().withAutomatable(false)));
+    layout.add(std::make_unique<juce::AudioParameterInt>("oscPort", "OSC Port", 1024, 65535, 9000,
+                                                         juce::AudioParameterIntAttributes().withAutomatable(false)));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("oscRate", "OSC Rate",
+                                                           juce::NormalisableRange<float>(5.0f, 120.0f, 1.0f),
+                                                           30.0f,
+                                                           juce::AudioParameterFloatAttributes().withAutomatable(false)));
+
+    // Every block's voices to a visualizer through shared memory (see SharedVoiceStream)
+    layout.add(std::make_unique<juce::AudioParameterBool>("sharedMemoryOutput", "Shared Memory Output", false,
+                                                          juce::AudioParameterBoolAttributes().withAutomatable(false)));
+
+    // Smallest bend change worth a message, in cents so it means the same at any bend range;
+    // the default is the 10 steps this used to be at the default range of 48 semitones
+    layout.add(std::make_unique<juce::AudioParameterFloat>("bendDeadband", "Bend Deadband",
+                                                           juce::NormalisableRange<float>(0.0f, 100.0f, 0.01f, 0.5f),
+                                                           5.86f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("fitDeadband", "Fit Deadband To Budget", false));
+
+    // Largest error the curve tables may add, in output LSBs; sets the tables' resolution
+    layout.add(std::make_unique<juce::AudioParameterFloat>("curveError", "Curve Error",
+                                                           juce::NormalisableRange<float>(0.05f, 8.0f, 0.01f, 0.5f), 0.5f,
+                                                           juce::AudioParameterFloatAttributes().withAutomatable(false)));
+
+    // The receiver's own bend smoothing time constant (ms), which bends are planned around;
+    // 0 sends the curve as it is
+    layout.add(std::make_unique<juce::AudioParameterFloat>("receiverSmoothing", "Receiver Smoothing",
+                                                           juce::NormalisableRange<float>(0.0f, 200.0f, 0.1f, 0.5f),
+                                                           0.0f));
+
+    // Under CPU pressure, fewer and coarser bends while the block load stays past the
+    // threshold (%) of real time
+    layout.add(std::make_unique<juce::AudioParameterBool>("adaptiveQuality", "Adaptive Quality", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("adaptiveThreshold", "Adaptive Quality Threshold",
+                                                           juce::NormalisableRange<float>(10.0f, 95.0f, 1.0f),
+                                                           70.0f));
+
+    // Bends worked out in integers, the same on every platform, wherever the settings allow
+    layout.add(std::make_unique<juce::AudioParameterBool>("fixedPoint", "Fixed-Point Engine", false));
+
+    // Per-sample bends with no deadband while the host renders offline
+    layout.add(std::make_unique<juce::AudioParameterBool>("offlineQuality", "Offline Render Quality", true,
+                                                          juce::AudioParameterBoolAttributes().withAutomatable(false)));
+
+    // Time a stolen channel's bend takes to move over to the new note before it starts
+    layout.add(std::make_unique<juce::AudioParameterFloat>("stealRamp", "Steal Ramp",
+                                                           juce::NormalisableRange<float>(0.0f, 20.0f, 0.1f),
+                                                           0.0f));
+
+    // Output ordered for running status on DIN and USB-MIDI 1.0 ports
+    layout.add(std::make_unique<juce::AudioParameterBool>("serialOutput", "Serial Output Order", false));
+
+    // Input channel and key range that get bent; notes outside pass through as they came
+    juce::StringArray scopeChannels{"All"};
+    for (int channel = 1; channel <= 16; ++channel)
+        scopeChannels.add(juce::String(channel));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("scopeChannel", "Input Channel", scopeChannels, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>("scopeLowNote", "Lowest Bent Note", 0, 127, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>("scopeHighNote", "Highest Bent Note", 0, 127, 127));
+
+    // Note-ons closer than this (ms) to the key's last one are taken for a retrigger and
+    // merged into the voice already playing; 0 passes every note-on
+    layout.add(std::make_unique<juce::AudioParameterFloat>("retriggerDebounce", "Retrigger Debounce",
+                                                           juce::NormalisableRange<float>(0.0f, 50.0f, 0.1f),
+                                                           0.0f));
+
+    // Continuous controllers passed through move past the hysteresis (steps) before they go
+    // on, and at most the rate (per second, 0 for any) per controller
+    layout.add(std::make_unique<juce::AudioParameterInt>("ccHysteresis", "Controller Hysteresis", 0, 8, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("ccMaxRate", "Controller Max Rate",
+                                                           juce::NormalisableRange<float>(0.0f, 500.0f, 1.0f, 0.5f),
+                                                           0.0f));
+
+    // The output played on a built-in synth in the audio output, for trying the plugin
+    // without an MPE synth (instrument and Standalone builds)
+    layout.add(std::make_unique<juce::AudioParameterBool>("previewSynth", "Preview Synth", false,
+                                                          juce::AudioParameterBoolAttributes().withAutomatable(false)));
+
+    // Chords bending in lockstep share one bend on the zone's master channel (MPE output only)
+    layout.add(std::make_unique<juce::AudioParameterBool>("masterBend", "Zone Master Bend", mobileBuild));
+
+    // Vibrato on held notes once the delay has passed; spread staggers the voices' phases
+    layout.add(std::make_unique<juce::AudioParameterFloat>("vibratoDepth", "Vibrato Depth",
+                                                           juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("vibratoRate", "Vibrato Rate",
+                                                           juce::NormalisableRange<float>(0.1f, 12.0f, 0.01f),
+                                                           5.5f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("vibratoDelay", "Vibrato Delay",
+                                                           juce::NormalisableRange<float>(0.0f, 2.0f, 0.01f),
+                                                           0.3f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("vibratoSpread", "Vibrato Spread",
+                                                           juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+                                                           0.0f));
+
+    // Pressure and timbre (CC74) lanes, moving from one value to another along the bend
+    layout.add(std::make_unique<juce::AudioParameterBool>("pressureLane", "Pressure Lane", false));
+    layout.add(std::make_unique<juce::AudioParameterInt>("pressureFrom", "Pressure From", 0, 127, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>("pressureTo", "Pressure To", 0, 127, 127));
+    layout.add(std::make_unique<juce::AudioParameterBool>("timbreLane", "Timbre Lane", false));
+    layout.add(std::make_unique<juce::AudioParameterInt>("timbreFrom", "Timbre From", 0, 127, 64));
+    layout.add(std::make_unique<juce::AudioParameterInt>("timbreTo", "Timbre To", 0, 127, 127));
+
+    // Each note keeps the bend amount, time and curve it started with
+    layout.add(std::make_unique<juce::AudioParameterBool>("latchParameters", "Latch At Note-On", false));
+
+    // Delay in ms that lets chords be seen whole before they sound, reported as latency
+    layout.add(std::make_unique<juce::AudioParameterFloat>("lookahead", "Lookahead",
+                                                           juce::NormalisableRange<float>(0.0f, 50.0f, 0.1f), 0.0f,
+                                                           juce::AudioParameterFloatAttributes().withAutomatable(false)));
+
+    // End every sounding voice when the host's transport stops
+    layout.add(std::make_unique<juce::AudioParameterBool>("releaseOnStop", "Release On Stop", true));
+
+    // Bend each note to the next degree of a scale, or toward what the audio input is
+    // playing, instead of by the bend amount
+    juce::StringArray scaleNames;
+    for (const auto &entry : ScaleTable::scales)
+        scaleNames.add(entry.name);
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("bendTarget", "Bend Target",
+                                                            juce::StringArray{"Amount", "Scale Step Up", "Scale Step Down", "Input Pitch", "Input Chord"}, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("scale", "Scale", scaleNames, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("scaleRoot", "Scale Root",
+                                                            juce::StringArray{"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"}, 0));
+
+    // Each key plays a whole stored voicing, a voice per note
+    juce::StringArray voicingNames{"Off"};
+    for (const auto &voicing : ChordMemory::voicings)
+        voicingNames.add(voicing.name);
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("chordMemory", "Chord Memory", voicingNames, 0));
+
+    // Hits in the audio input restart the bends of held notes; the threshold is how far in
+    // dB a hit must jump above the recent level
+    layout.add(std::make_unique<juce::AudioParameterBool>("transientRetrigger", "Transient Retrigger", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("transientThreshold", "Transient Threshold",
+                                                           juce::NormalisableRange<float>(3.0f, 24.0f, 0.1f), 9.0f));
+
+    // Input from an MPE controller: its per-note bends are kept and added to the generated ones
+    layout.add(std::make_unique<juce::AudioParameterChoice>("mpeInput", "MPE Input",
+                                                            juce::StringArray{"Off", "Lower Zone", "Upper Zone"}, 0));
+
+    // Instances on other tracks feeding the same synth share its channels under one pool
+    // ID; 0 keeps them to this instance
+    layout.add(std::make_unique<juce::AudioParameterInt>("sharedPool", "Shared Channel Pool", 0, SharedChannelPool::numPools, 0));
+
+    // Member channels follow the polyphony played instead of always being 14
+    layout.add(std::make_unique<juce::AudioParameterBool>("autoZoneSize", "Auto Zone Size", false));
+
+    // Instances under one link group ID keep the output settings in LinkedSettings the same:
+    // an edit in any of them reaches the rest; 0 keeps them to this instance
+    layout.add(std::make_unique<juce::AudioParameterInt>("linkGroup", "Link Group", 0, LinkedSettings::numGroups, 0));
+
+    // Read-only meters for hosts, so instances can be watched without their editors. Not
+    // part of the saved state.
+    auto meter = [&layout](const char *id, const char *name, float maximum, const char *label)
+    {
+        layout.add(std::make_unique<juce::AudioParameterFloat>(id, name, juce::NormalisableRange<float>(0.0f, maximum), 0.0f,
+                                                               juce::AudioParameterFloatAttributes()
+                                                                   .withLabel(label)
+                                                                   .withAutomatable(false)
+                                                                   .withCategory(juce::AudioProcessorParameter::otherMeter)));
+    };
+
+    meter("meterVoices", "Active Voices", 15.0f, "");
+    meter("meterBendRate", "Bends Per Second", 5000.0f, "/s");
+    meter("meterSteals", "Steals Per Second", 100.0f, "/s");
+    meter("meterLoad", "DSP Load", 100.0f, "%");
+
+    return layout;
 }
 
 PitchBendProcessor::~PitchBendProcessor()
 {
+    stopTimer();
+
+    for (auto *parameter : getParameters())
+        parameter->removeListener(this);
+
+    // Finishes what it was doing first
+    backgroundWorker = nullptr;
+
+    delete preparedStreams.exchange(nullptr);
+    freeRetiredStreams();
 }
 
 const juce::String PitchBendProcessor::getName() const
@@ -51,20 +639,28 @@ double PitchBendProcessor::getTailLengthSeconds() const
 
 int PitchBendProcessor::getNumPrograms()
 {
-    return 1;
+    return juce::jmax(1, presetBank->getNumPresets());
 }
 
 int PitchBendProcessor::getCurrentProgram()
 {
-    return 0;
+    return control.currentProgram.load();
 }
 
 void PitchBendProcessor::setCurrentProgram(int index)
 {
+    if (auto *preset = presetBank->getPreset(index))
+    {
+        control.currentProgram = index;
+        applyPresetToParameters(*preset);
+    }
 }
 
 const juce::String PitchBendProcessor::getProgramName(int index)
 {
+    if (auto *preset = presetBank->getPreset(index))
+        return juce::String::fromUTF8(preset->name, static_cast<int>(strnlen(preset->name, sizeof(preset->name))));
+
     return {};
 }
 
@@ -75,207 +671,5365 @@ void PitchBendProcessor::changeProgramName(int index, const juce::String &newNam
 void PitchBendProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     currentSampleRate = sampleRate;
-    currentTime = 0.0;
+    scheduler.rebase(sampleClock);
+    sampleClock = 0;
+    budgetTokens = 0.0;
+    pendingBendMask = 0;
+    qualityLevel = 0;
+    qualityOverSamples = 0;
+    qualityUnderSamples = 0;
+    resetDebounce();
+    resetControllerFilter();
+    loadMonitor.prepare(sampleRate, samplesPerBlock);
+    midiCapture.prepare(sampleRate);
+    kernels = &KernelDispatch::get(KernelDispatch::detect());
+
+    // Sample-rate dependent state is rebuilt with the next snapshot
+    control.parameterGeneration.fetch_add(1);
+
+    // The host may have routed us to another receiver meanwhile
+    receiverDiscovery.requestDiscovery();
+    zones[lowerZone].rampStartAmount = bendAmount->get();
+    zones[lowerZone].rampStartCurve = bendCurve->get();
+    zones[upperZone].rampStartAmount = upperBendAmount->get();
+    zones[upperZone].rampStartCurve = upperBendCurve->get();
+
+    // Reserve the output buffer up front so processBlock never grows it on the audio thread.
+    // Worst case per block: every voice emits a bend and a value per lane on every update
+    // step, plus the note on/off/initial-value traffic and pass-through of a dense input block,
+    // every held-back strummed note falling due at once, the ramps of stolen channels, and one
+    // MIDI-CI message.
+    auto minUpdateInterval = juce::jmax(1, juce::roundToInt(updateRate->range.start * sampleRate / 1000.0));
+    auto maxBendsPerBlock = maxVoices * (samplesPerBlock / minUpdateInterval + 1) * (1 + VoiceTable::numLanes);
+    auto maxEventsPerBlock = maxBendsPerBlock + (maxDecodedEventsPerBlock + maxStrummedEvents) * (2 + VoiceTable::numLanes + stealRampSteps) + 1;
+    reservedOutputBytes = static_cast<size_t>(maxEventsPerBlock) * bytesPerMidiEvent + ReceiverDiscovery::maxMessageSize;
+    outputMidi.ensureSize(reservedOutputBytes);
+    outputMidi.clear();
+    serialMidi.ensureSize(reservedOutputBytes);
+    serialMidi.clear();
+    runningStatus = -1;
+    umpOutput.reserve(static_cast<size_t>(maxEventsPerBlock));
+    umpOutput.clear();
+    maxOutputEvents = maxEventsPerBlock;
+
+    // Up to a block's worth of UMP input may wait for the lookahead, and at most four words
+    // make a packet
+    umpInputWords.reserve(static_cast<size_t>(maxUmpInputPerBlock) * 4 * 2);
+    umpInputWords.clear();
+    umpInputRuns.reserve(static_cast<size_t>(maxUmpInputPerBlock) * 2);
+    umpInputRuns.clear();
+    umpInputCursor = 0;
+
+    // The same for the further MIDI input buses
+    for (auto &queue : inputBusQueues)
+    {
+        queue.bytes.reserve(static_cast<size_t>(maxBusBytesPerBlock) * 2);
+        queue.bytes.clear();
+        queue.events.reserve(static_cast<size_t>(maxBusInputPerBlock) * 2);
+        queue.events.clear();
+        queue.cursor = 0;
+    }
+
+    // The per-block arrays, each at its worst case; what a block fills is usually far less,
+    // and the telemetry's scratchBytes shows how much
+    auto maxDecodedEvents = static_cast<size_t>(maxDecodedEventsPerBlock);
+    scratch.prepare(ScratchArena::bytesFor<InputEvent>(maxDecodedEvents) * 2
+                    + ScratchArena::bytesFor<InputEvent>(static_cast<size_t>(maxUmpInputPerBlock))
+                    + ScratchArena::bytesFor<std::array<juce::uint8, 3>>(static_cast<size_t>(maxUmpInputPerBlock))
+                    + ScratchArena::bytesFor<juce::uint8>(static_cast<size_t>(maxEventsPerBlock)));
+    scratchCapacity.store(scratch.getCapacity(), std::memory_order_relaxed);
+    counters.scratchHighWater.store(0, std::memory_order_relaxed);
+    allocateScratch();
+
+    // At most one offline bend and one value per lane per voice per sample
+    prepareBendStreams(juce::jmax(1, samplesPerBlock) * (1 + VoiceTable::numLanes));
+
+    // For blocks longer than promised, which are split into ones of this size
+    preparedBlockSize = juce::jmax(1, samplesPerBlock);
+    reservedSplitBytes = static_cast<size_t>(maxInputEventsPerBlock) * bytesPerMidiEvent;
+    splitInput.ensureSize(reservedSplitBytes);
+    chunkMidi.ensureSize(reservedOutputBytes);
+
+    coalesceSlotSamples = juce::jmax(1, juce::roundToInt(sampleRate * 0.001));
+    transientDetector.prepare(sampleRate);
+    preview.prepare(sampleRate);
+    previewActive = false;
+    mpeInputState = {};
+    mpeInputState.selectedRpn.fill(0x3fff);
+    for (auto &channel : perNoteBendSemitones)
+        channel.fill(0.0f);
+    transientSample = neverSample;
+    receiverState.forget();
+    generatedState.forget();
+
+    // Timeline positions are in samples at the old rate
+    for (auto &onsets : noteOnsets)
+        onsets.fill(-1);
+    expectedTimelineSample = -1;
+    chaseSample = -1;
 
-    // Send MPE Configuration Message to set up lower zone with 14 member channels
-    // This tells the DAW we're in MPE mode
+    reservedLookaheadBytes = static_cast<size_t>(maxLookaheadEvents) * bytesPerMidiEvent + ReceiverDiscovery::maxMessageSize;
+    lookaheadLine.ensureSize(reservedLookaheadBytes);
+    lookaheadLine.clear();
+    lookaheadBlock.ensureSize(reservedLookaheadBytes + static_cast<size_t>(maxInputEventsPerBlock) * bytesPerMidiEvent);
+    lookaheadEnd = 0;
+    upcomingNotes.clear();
+
+    auto lookahead = juce::roundToInt(lookaheadTime->get() * sampleRate / 1000.0);
+    control.lookaheadSamples.store(lookahead, std::memory_order_release);
+    setLatencySamples(lookahead);
+
+    // Queue the MPE Configuration Message again: the receiver may have been reconnected
+    // or reset along with the device
     // RPN MSB (101) = 0, RPN LSB (100) = 6 for MPE Configuration
     // Data Entry MSB (6) = number of member channels (14)
+    control.zoneConfigRequested = true;
+
+    // Voices started against the old clock and rate are ended by the next block
+    control.voiceFlushRequested = true;
 }
 
 void PitchBendProcessor::releaseResources()
 {
+    control.voiceFlushRequested = true;
+}
+
+void PitchBendProcessor::audioWorkgroupContextChanged(const juce::AudioWorkgroup &workgroup)
+{
+    // The pitch tracker's analyser is the one worker the live audio thread waits on; the
+    // render pool only runs offline, where there is no device
+    pitchTracker.setWorkgroup(workgroup);
+}
+
+void PitchBendProcessor::setNonRealtime(bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime(isNonRealtime);
+
+    // Started by the first offline render, so instances that only ever play live never start
+    // it. The audio thread renders a share of the voices too, so it takes one core less.
+    if (isNonRealtime && renderPool == nullptr)
+    {
+        auto numThreads = juce::jlimit(1, maxRenderThreads, juce::SystemStats::getNumCpus() - 1);
+
+        for (int i = 0; i < numThreads; ++i)
+            renderJobs.push_back(std::make_unique<BendStreamJob>(*this));
+
+        renderPool = std::make_unique<juce::ThreadPool>(juce::ThreadPoolOptions{}.withThreadName("Bend Render").withNumberOfThreads(numThreads));
+    }
+}
+
+void PitchBendProcessor::reset()
+{
+    control.zoneConfigRequested = true;
+    receiverState.forget();
+    generatedState.forget();
+    loadMonitor.resetWorstBlock();
+}
+
+void PitchBendProcessor::buildZoneConfigMessages()
+{
+    // The same RPNs as juce::MPEMessages::setLowerZone / setUpperZone, written straight into
+    // the fixed array because zone layout changes are picked up on the audio thread
+    numZoneConfigMessages = 0;
+
+    auto addRpn = [this](int channel, int parameterNumber, int value)
+    {
+        jassert(numZoneConfigMessages + 3 <= static_cast<int>(zoneConfigMessages.size()));
+
+        for (auto [controller, controllerValue] : {std::pair{100, parameterNumber & 0x7f}, std::pair{101, parameterNumber >> 7}, std::pair{6, value}})
+            zoneConfigMessages[static_cast<size_t>(numZoneConfigMessages++)] = {static_cast<juce::uint8>(0xb0 | (channel - 1)),
+                                                                                static_cast<juce::uint8>(controller),
+                                                                                static_cast<juce::uint8>(controllerValue)};
+    };
+
+    for (const auto &zone : zones)
+    {
+        const auto &mpeZone = zone.mpeZone;
+
+        if (!mpeZone.isActive())
+            continue;
+
+        addRpn(mpeZone.getMasterChannel(), 6, mpeZone.numMemberChannels);
+        addRpn(mpeZone.getFirstMemberChannel(), 0, mpeZone.perNotePitchbendRange);
+        addRpn(mpeZone.getMasterChannel(), 0, mpeZone.masterPitchbendRange);
+    }
+}
+
+void PitchBendProcessor::sendPendingZoneConfig()
+{
+    if (control.zoneConfigRequested.exchange(false))
+        nextZoneConfigMessage = 0;
+
+    if (nextZoneConfigMessage >= numZoneConfigMessages)
+        return;
+
+    // One RPN per sub-block, sent from the piece that starts on it, so they are as far apart
+    // whatever size the host's blocks are: everything up to the next parameter number LSB
+    // (CC 100), which starts each of them
+    if (sampleClock % subBlockSamples != 0)
+        return;
+
+    do
+    {
+        addOutputEvent(zoneConfigMessages[static_cast<size_t>(nextZoneConfigMessage++)].data(), 3, 0);
+    } while (nextZoneConfigMessage < numZoneConfigMessages && zoneConfigMessages[static_cast<size_t>(nextZoneConfigMessage)][1] != 100);
+}
+
+void PitchBendProcessor::sendPendingCiMessage()
+{
+    std::array<juce::uint8, ReceiverDiscovery::maxMessageSize> message;
+
+    if (auto numBytes = receiverDiscovery.popOutgoing(message.data()))
+    {
+        jassert(lastOutputPosition == 0);
+
+        appendMidiEvent(outputMidi, message.data(), numBytes, 0);
+        ++messagesThisBlock;
+    }
+}
+
+bool PitchBendProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
 }
 
 bool PitchBendProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const
 {
+#if JucePlugin_IsMidiEffect
+    return layouts.inputBuses.isEmpty() && layouts.outputBuses.isEmpty();
+#else
     return true;
+#endif
+}
+
+float PitchBendProcessor::curveErrorTolerance() const
+{
+    auto mode = outputMode->getIndex();
+    auto perNote = mode == 1 || (mode == autoOutputMode && receiverDiscovery.prefersPerNote());
+    auto lsbSteps = perNote ? 1.0f / 262144.0f : 1.0f;
+    auto deadbandInSteps = bendDeadband->get() * 8192.0f / (static_cast<float>(bendRange->get()) * 100.0f);
+
+    return juce::jmax(curveError->get() * lsbSteps, deadbandInSteps * 0.5f) / 8192.0f;
+}
+
+void PitchBendProcessor::publishCurveTable(int zoneIndex, float curve)
+{
+    auto table = CurveTableCache::get(curve, publishedCurveTolerance);
+    engineConfig.edit([&](EngineConfig &config) { config.curveTables[static_cast<size_t>(zoneIndex)] = std::move(table); });
+    zones[static_cast<size_t>(zoneIndex)].publishedCurve = curve;
+}
+
+void PitchBendProcessor::publishLayerTable(size_t layer, float curve)
+{
+    auto table = CurveTableCache::get(curve, publishedCurveTolerance);
+    engineConfig.edit([&](EngineConfig &config) { config.layerTables[layer] = std::move(table); });
+    publishedLayerCurves[layer] = curve;
 }
 
-int PitchBendProcessor::findAvailableMPEChannel()
+void PitchBendProcessor::publishEnvelope(float hold, float returnSeconds, float curve)
 {
-    // MPE lower zone uses channels 2-15 (channel 1 is master)
-    for (int ch = 2; ch <= 15; ++ch)
+    engineConfig.edit([&](EngineConfig &config)
     {
-        if (!channelInUse[ch - 1]) // Array is 0-indexed
+        auto &newEnvelope = config.envelope;
+        newEnvelope.clear();
+
+        if (returnSeconds > 0.0f)
         {
-            return ch;
+            if (hold > 0.0f)
+                newEnvelope.addSegment(hold, 1.0f, 0.0f);
+
+            newEnvelope.addSegment(returnSeconds, 0.0f, curve);
         }
-    }
-    return 2; // Fallback to channel 2 if all busy
+    });
+
+    publishedHoldTime = hold;
+    publishedReturnTime = returnSeconds;
+    publishedReturnCurve = curve;
 }
 
-int PitchBendProcessor::calculatePitchBend(double elapsedTime, float amount, float duration, float curve)
+void PitchBendProcessor::applyPresetToParameters(const PresetBank::Preset &preset)
 {
-    if (elapsedTime >= duration)
-        return static_cast<int>(amount * 8192.0f);
+    hostNotifier.setParameter(*bendAmount, bendAmount->convertTo0to1(preset.amount));
+    hostNotifier.setParameter(*bendTime, bendTime->convertTo0to1(preset.time));
+    hostNotifier.setParameter(*bendCurve, bendCurve->convertTo0to1(preset.curve));
+}
+
+void PitchBendProcessor::timerCallback()
+{
+    // A program change from the audio thread: once the parameters hold the preset the
+    // snapshot can go back to reading them
+    auto program = control.requestedProgram.load();
+    if (auto *preset = presetBank->getPreset(program))
+    {
+        applyPresetToParameters(*preset);
+        control.requestedProgram.compare_exchange_strong(program, -1);
+        hostNotifier.updateDisplay(ChangeDetails().withProgramChanged(true));
+    }
 
-    float progress = static_cast<float>(elapsedTime / duration);
+    // MIDI learn: a controller caught while armed is mapped first, then each mapped parameter
+    // takes the last value its controller sent
+    auto learned = counters.learnedController.exchange(-1);
+    if (learned >= 0)
+        setMidiLearn(learned >> 11, ((learned >> 7) & 0x0f) + 1, learned & 0x7f);
 
-    // Apply curve
-    if (curve != 0.0f)
+    for (size_t target = 0; target < learnableParameters.size(); ++target)
     {
-        if (curve > 0.0f)
-            progress = std::pow(progress, 1.0f + curve);
-        else
-            progress = 1.0f - std::pow(1.0f - progress, 1.0f - curve);
+        auto value = counters.learnedValues[target].exchange(-1.0f);
+        if (value >= 0.0f && value != learnableParameters[target]->getValue())
+            hostNotifier.setParameter(*learnableParameters[target], value);
     }
 
-    // Pitch bend range: -8192 to +8191
-    return static_cast<int>(progress * amount * 8192.0f);
-}
+    // Rebuild off the audio thread whenever a curve parameter has moved, or the accuracy
+    // the output needs has
+    auto tolerance = curveErrorTolerance();
+    auto retable = tolerance != publishedCurveTolerance;
+    publishedCurveTolerance = tolerance;
 
-void PitchBendProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages)
-{
-    buffer.clear();
+    auto curve = bendCurve->get();
+    if (retable || curve != zones[lowerZone].publishedCurve)
+        publishCurveTable(lowerZone, curve);
 
-    juce::MidiBuffer processedMidi;
+    auto upperCurve = upperBendCurve->get();
+    if (retable || upperCurve != zones[upperZone].publishedCurve)
+        publishCurveTable(upperZone, upperCurve);
 
-    // Send MPE zone configuration at the start (only once per block for efficiency)
-    static bool mpeConfigSent = false;
-    if (!mpeConfigSent)
+    for (size_t layer = 0; layer < layerParameters.size(); ++layer)
     {
-        // Send MPE Configuration Message for lower zone with 14 member channels
-        auto mpeConfig = juce::MPEMessages::setLowerZone(14, 48, 2);
-        for (const auto &msg : mpeConfig)
-            processedMidi.addEvent(msg, 0);
-        mpeConfigSent = true;
+        auto layerCurve = layerParameters[layer].curve->get();
+        if (retable || layerCurve != publishedLayerCurves[layer])
+            publishLayerTable(layer, layerCurve);
     }
 
-    float amount = bendAmount->get();
-    float duration = bendTime->get();
-    float curve = bendCurve->get();
+    auto hold = holdTime->get();
+    auto returnSeconds = returnTime->get();
+    auto curveBack = returnCurve->get();
+    if (hold != publishedHoldTime || returnSeconds != publishedReturnTime || curveBack != publishedReturnCurve)
+        publishEnvelope(hold, returnSeconds, curveBack);
 
-    // Process incoming MIDI messages
-    for (const auto metadata : midiMessages)
+    auto fromIndex = morphFrom->get() - 1;
+    auto toIndex = morphTo->get() - 1;
+    if (fromIndex != publishedMorphFrom || toIndex != publishedMorphTo)
+        publishMorphEndpoints(fromIndex, toIndex);
+
+    // A port that can't be used isn't retried until the port or the switch changes
+    auto port = oscOutput->get() ? oscPort->get() : 0;
+    if (port != publishedOscPort)
     {
-        auto message = metadata.getMessage();
-        int samplePos = metadata.samplePosition;
+        if (port == 0)
+            oscStreamer.stop();
+        else
+            oscStreamer.start(oscHost, port);
 
-        if (message.isNoteOn())
-        {
-            double noteStartTime = currentTime + (samplePos / currentSampleRate);
+        publishedOscPort = port;
+    }
 
-            // Find an available MPE channel for this note
-            int mpeChannel = findAvailableMPEChannel();
-            channelInUse[mpeChannel - 1] = true;
+    oscStreamer.setRate(oscRate->get());
 
-            // Add note to active notes
-            NoteInfo note;
-            note.noteNumber = message.getNoteNumber();
-            note.mpeChannel = mpeChannel;
-            note.startTime = noteStartTime;
-            note.lastBendValue = 0;
-            note.isActive = true;
-            activeNotes.push_back(note);
+    // Likewise a file that can't be mapped, until the switch changes
+    if (sharedMemoryOutput->get() != publishedSharedMemory)
+    {
+        if (publishedSharedMemory)
+            sharedVoiceStream.stop();
+        else
+            sharedVoiceStream.start();
 
-            // Send note on the MPE member channel (not the original channel)
-            juce::MidiMessage mpeNoteOn = juce::MidiMessage::noteOn(
-                mpeChannel,
-                note.noteNumber,
-                message.getVelocity());
-            processedMidi.addEvent(mpeNoteOn, samplePos);
+        publishedSharedMemory = !publishedSharedMemory;
+    }
 
-            // Initialize pitch bend to center for this channel
-            juce::MidiMessage initialBend = juce::MidiMessage::pitchWheel(mpeChannel, 8192);
-            processedMidi.addEvent(initialBend, samplePos);
-        }
-        else if (message.isNoteOff())
-        {
-            // Find the corresponding active note and send note off on its MPE channel
-            for (auto &note : activeNotes)
-            {
-                if (note.noteNumber == message.getNoteNumber() && note.isActive)
-                {
-                    // Send note off on the MPE channel
-                    juce::MidiMessage mpeNoteOff = juce::MidiMessage::noteOff(
-                        note.mpeChannel,
-                        note.noteNumber,
-                        message.getVelocity());
-                    processedMidi.addEvent(mpeNoteOff, samplePos);
-
-                    // Mark channel as free
-                    channelInUse[note.mpeChannel - 1] = false;
-                    note.isActive = false;
-                    break;
-                }
-            }
-        }
+    // Input tracking runs only while a bend target follows it, at the current rate
+    auto trackingRate = bendTargetMode->getIndex() >= 3 ? getSampleRate() : 0.0;
+    if (trackingRate != pitchTracker.getSampleRate())
+    {
+        if (trackingRate > 0.0)
+            pitchTracker.start(trackingRate);
         else
+            pitchTracker.stop();
+    }
+
+    // A new lookahead takes effect from the next block, and the host is told of it first
+    if (getSampleRate() > 0.0)
+    {
+        auto lookahead = juce::roundToInt(lookaheadTime->get() * getSampleRate() / 1000.0);
+
+        if (lookahead != getLatencySamples())
         {
-            // Pass through other messages (but might need channel remapping for CC, aftertouch, etc.)
-            processedMidi.addEvent(message, samplePos);
+            setLatencySamples(lookahead);
+            control.lookaheadSamples.store(lookahead, std::memory_order_release);
         }
     }
 
-    // Generate pitch bend updates for active notes at reduced rate
-    for (int i = 0; i < buffer.getNumSamples(); i += updateRateInSamples)
+    if (++meterTicks >= meterDecimation)
+        updateMeters();
+
+    engineConfig.collectGarbage();
+    freeRetiredStreams();
+
+    // A receiver found to want the other output is picked up like a parameter change
+    if (outputMode->getIndex() == autoOutputMode)
     {
-        double sampleTime = currentTime + (i / currentSampleRate);
+        if (!receiverDiscovery.isRunning())
+            receiverDiscovery.start();
 
-        for (auto &note : activeNotes)
-        {
-            if (!note.isActive)
-                continue;
+        if (receiverDiscovery.update(zoneSplit->get() ? 14 - upperZoneChannels->get() : 14))
+            control.parameterGeneration.fetch_add(1, std::memory_order_release);
+    }
+    else if (receiverDiscovery.isRunning())
+    {
+        receiverDiscovery.stop();
+    }
 
-            double elapsedTime = sampleTime - note.startTime;
+    publishLinkedSettings();
+    hostNotifier.flushIfDue();
+}
 
-            if (elapsedTime >= 0.0 && elapsedTime <= duration)
-            {
-                int bendValue = calculatePitchBend(elapsedTime, amount, duration, curve);
+void PitchBendProcessor::updateMeters()
+{
+    meterTicks = 0;
 
-                // Only send if value changed significantly
-                if (std::abs(bendValue - note.lastBendValue) > 10)
-                {
-                    note.lastBendValue = bendValue;
+    auto now = juce::Time::getMillisecondCounterHiRes();
+    auto seconds = (now - meteredAtMs) / 1000.0;
+    auto bends = counters.bendsSent.load(std::memory_order_relaxed);
+    auto steals = counters.steals.load(std::memory_order_relaxed);
 
-                    // Send pitch bend on this note's MPE member channel
-                    juce::MidiMessage bendMsg = juce::MidiMessage::pitchWheel(
-                        note.mpeChannel,
-                        bendValue + 8192);
-                    processedMidi.addEvent(bendMsg, i);
-                }
-            }
-        }
+    if (meteredAtMs > 0.0 && seconds > 0.0)
+    {
+        auto setMeter = [this](juce::AudioParameterFloat *parameter, double value)
+        {
+            hostNotifier.setParameter(*parameter, parameter->convertTo0to1(parameter->range.snapToLegalValue(static_cast<float>(value))));
+        };
+
+        setMeter(meterVoices, counters.activeVoices.load(std::memory_order_relaxed));
+        setMeter(meterBendRate, static_cast<double>(bends - meteredBends) / seconds);
+        setMeter(meterSteals, static_cast<double>(steals - meteredSteals) / seconds);
+        setMeter(meterLoad, loadMonitor.getLoad() * 100.0);
     }
 
-    // Clean up inactive notes
-    activeNotes.erase(
-        std::remove_if(activeNotes.begin(), activeNotes.end(),
-                       [](const NoteInfo &note)
-                       { return !note.isActive; }),
-        activeNotes.end());
+    meteredAtMs = now;
+    meteredBends = bends;
+    meteredSteals = steals;
+}
+
+void PitchBendProcessor::publishMorphEndpoints(int fromIndex, int toIndex)
+{
+    // Presets past the end of the bank fall back to its last one
+    auto lastPreset = presetBank->getNumPresets() - 1;
+    const auto &from = *presetBank->getPreset(juce::jmin(fromIndex, lastPreset));
+    const auto &to = *presetBank->getPreset(juce::jmin(toIndex, lastPreset));
+
+    // At full resolution, which the blend needs point for point
+    auto &endpoints = morphEndpoints.getWriteBuffer();
+    endpoints.from = CurveTableCache::get(from.curve);
+    endpoints.to = CurveTableCache::get(to.curve);
+    endpoints.fromAmount = from.amount;
+    endpoints.toAmount = to.amount;
+    endpoints.fromTime = from.time;
+    endpoints.toTime = to.time;
+    morphEndpoints.publish();
 
-    midiMessages.swapWith(processedMidi);
-    currentTime += buffer.getNumSamples() / currentSampleRate;
+    publishedMorphFrom = fromIndex;
+    publishedMorphTo = toIndex;
 }
 
-bool PitchBendProcessor::hasEditor() const
+void PitchBendProcessor::updateMorph()
 {
-    return true;
+    if (!morphEndpoints.acquire() && morphPosition == blendedPosition)
+        return;
+
+    const auto &endpoints = morphEndpoints.getReadBuffer();
+    auto position = morphPosition;
+    constexpr int numValues = CurveTable::maxPoints + 1;
+
+    // morphTable = from + (to - from) * position
+    auto *values = morphTable.values.data();
+    juce::FloatVectorOperations::copy(values, endpoints.to->values.data(), numValues);
+    juce::FloatVectorOperations::subtract(values, endpoints.from->values.data(), numValues);
+    juce::FloatVectorOperations::multiply(values, position, numValues);
+    juce::FloatVectorOperations::add(values, endpoints.from->values.data(), numValues);
+
+    // And the fixed-point values, blended in integers with the position in Q16
+    auto fixedPosition = static_cast<std::int64_t>(juce::roundToInt(position * 65536.0f));
+    for (size_t i = 0; i < static_cast<size_t>(numValues); ++i)
+    {
+        auto from = static_cast<std::int64_t>(endpoints.from->fixedValues[i]);
+        morphTable.fixedValues[i] = static_cast<std::int32_t>(from + (((endpoints.to->fixedValues[i] - from) * fixedPosition) >> 16));
+    }
+
+    // The blend isn't the shape of any single curve value, so it gets a curve tag of its
+    // own that processBlock passes along to select the table
+    morphTable.curve = endpoints.from->curve + (endpoints.to->curve - endpoints.from->curve) * position;
+
+    morphAmount = endpoints.fromAmount + (endpoints.toAmount - endpoints.fromAmount) * position;
+    morphTime = endpoints.fromTime + (endpoints.toTime - endpoints.fromTime) * position;
+    blendedPosition = position;
 }
 
-juce::AudioProcessorEditor *PitchBendProcessor::createEditor()
+void PitchBendProcessor::addOutputEvent(const juce::uint8 *data, int numBytes, int samplePos)
 {
-    return new PitchBendEditor(*this);
+    // processBlock produces events in time order, so they never need an ordered insert
+    jassert(samplePos >= lastOutputPosition);
+    lastOutputPosition = samplePos;
+
+    appendMidiEvent(outputMidi, data, numBytes, samplePos);
+    generatedState.update(data, numBytes);
+    ++messagesThisBlock;
 }
 
-void PitchBendProcessor::getStateInformation(juce::MemoryBlock &destData)
+void PitchBendProcessor::addChannelMessage(int type, int channel, int data1, int data2, int samplePos)
 {
-    juce::MemoryOutputStream stream(destData, true);
+    jassert(channel >= 1 && channel <= 16);
 
-    stream.writeFloat(*bendAmount);
-    stream.writeFloat(*bendTime);
-    stream.writeFloat(*bendCurve);
+    const juce::uint8 data[] = {static_cast<juce::uint8>(type | (channel - 1)),
+                                static_cast<juce::uint8>(data1 & 0x7f),
+                                static_cast<juce::uint8>(data2 & 0x7f)};
+
+    addOutputEvent(data, type == 0xc0 || type == 0xd0 ? 2 : 3, samplePos);
 }
 
-void PitchBendProcessor::setStateInformation(const void *data, int sizeInBytes)
+void PitchBendProcessor::addPitchWheel(int channel, int value, int samplePos)
 {
-    juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes), false);
+    jassert(value >= 0 && value <= 0x3fff);
+    addChannelMessage(0xe0, channel, value, value >> 7, samplePos);
+}
+
+void PitchBendProcessor::addUmpEvent(const juce::ump::PacketX2 &packet, int samplePos)
+{
+    jassert(umpOutput.size() < umpOutput.capacity());
+
+    umpOutput.push_back({samplePos, packet});
+    ++messagesThisBlock;
+}
+
+bool PitchBendProcessor::decodeMpeInput(const InputEvent &event)
+{
+    auto status = event.data[0] & 0xf0;
+    auto channel = (event.data[0] & 0x0f) + 1;
+    auto i = static_cast<size_t>(channel - 1);
+    auto isMaster = channel == params.mpeInputMaster;
+    auto &state = mpeInputState;
+
+    if (status == 0xe0 && event.numBytes >= 3)
+    {
+        auto value = static_cast<float>((event.data[1] | (event.data[2] << 7)) - 8192) / 8192.0f;
+        auto semitones = value * (isMaster ? state.masterRange : state.memberRange);
+        auto change = (semitones - state.bendSemitones[i]) * semitoneScale;
+        state.bendSemitones[i] = semitones;
+
+        auto slots = isMaster ? voices.activeMask & ~voices.releasingMask : voices.slotsForInputChannel[i];
+        shiftBaseBend(slots, change, sampleClock + event.samplePosition);
+        return true;
+    }
+
+    if (status != 0xb0 || event.numBytes < 3)
+        return false;
+
+    // Only the bend range RPN means anything here; the rest configure the controller, not
+    // the synth, and are kept from the output too
+    auto controller = event.data[1];
+    auto &rpn = state.selectedRpn[i];
+
+    if (controller == 101)
+        rpn = (rpn & 0x7f) | (event.data[2] << 7);
+    else if (controller == 100)
+        rpn = (rpn & 0x3f80) | event.data[2];
+    else if (controller == 6 && rpn == 0)
+        (isMaster ? state.masterRange : state.memberRange) = static_cast<float>(event.data[2]);
+    else if (controller != 6 && controller != 38)
+        return false;
+
+    return true;
+}
+
+float PitchBendProcessor::playerBendSteps(int inputChannel, int note) const
+{
+    auto semitones = perNoteBendSemitones[static_cast<size_t>(inputChannel - 1)][static_cast<size_t>(note)];
+
+    if (params.mpeInputMaster != 0)
+    {
+        semitones += mpeInputState.bendSemitones[static_cast<size_t>(inputChannel - 1)];
+
+        if (inputChannel != params.mpeInputMaster)
+            semitones += mpeInputState.bendSemitones[static_cast<size_t>(params.mpeInputMaster - 1)];
+    }
+
+    return semitones * semitoneScale;
+}
+
+void PitchBendProcessor::shiftBaseBend(juce::uint32 slots, float change, juce::int64 sample)
+{
+    // The voices go out with the new sum at their next update, which is now
+    for (auto mask = slots; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+        voices.baseBend[static_cast<size_t>(slot)] += change;
+
+        updateQueue.remove(slot, voices.nextUpdateSample);
+        voices.nextUpdateSample[static_cast<size_t>(slot)] = sample;
+        updateQueue.push(slot, voices.nextUpdateSample);
+    }
+}
+
+void PitchBendProcessor::handlePerNoteInput(const InputEvent &event)
+{
+    const auto *packet = event.packet;
+    auto status = juce::ump::Utils::getStatus(packet[0]);
+    auto slot = voices.findSlot(event.channel, event.note);
+    auto &bend = perNoteBendSemitones[static_cast<size_t>(event.channel - 1)][static_cast<size_t>(event.note)];
+
+    // Pitch bend, or per-note management resetting the note's controllers to default. The
+    // range is the one MPE member channels use.
+    if (status == 0x6 || (status == 0xf && (packet[0] & 1) != 0))
+    {
+        auto semitones = status == 0x6 ? static_cast<float>((static_cast<double>(packet[1]) - 2147483648.0) / 2147483648.0) * mpeInputState.memberRange : 0.0f;
+        auto change = (semitones - bend) * semitoneScale;
+        bend = semitones;
+
+        if (slot != VoiceTable::noSlot)
+            shiftBaseBend(1u << slot, change, sampleClock + event.samplePosition);
+
+        return;
+    }
+
+    if (slot == VoiceTable::noSlot || (status != 0x0 && status != 0x1))
+        return;
+
+    // Controllers go to the voice's note, which legato may have moved. MIDI 1.0 has no
+    // per-note controllers, but an MPE member channel is one note, so an assignable one goes
+    // there as the control change of its index.
+    if (activeOutputMode == OutputMode::midi2PerNote)
+    {
+        auto header = (packet[0] & ~0x7f00u) | (static_cast<juce::uint32>(voices.noteNumber[static_cast<size_t>(slot)]) << 8);
+        addUmpEvent(juce::ump::PacketX2{header, packet[1]}, event.samplePosition);
+    }
+    else if (activeOutputMode == OutputMode::mpe && status == 0x1)
+    {
+        addChannelMessage(0xb0, slot + 1, static_cast<int>(packet[0] & 0x7f), static_cast<int>(packet[1] >> 25), event.samplePosition);
+    }
+}
+
+bool PitchBendProcessor::remapExpression(const InputEvent &event)
+{
+    auto status = event.data[0] & 0xf0;
+    auto channel = (event.data[0] & 0x0f) + 1;
+
+    // Polyphonic aftertouch names its note; member channels carry it as channel pressure
+    if (status == 0xa0 && event.numBytes >= 3)
+    {
+        int slot = voices.findSlot(channel, event.data[1]);
+        if (slot == VoiceTable::noSlot)
+            return false;
+
+        if (!(lanesSending() && lanes[pressureLaneIndex].enabled))
+            addChannelMessage(0xd0, slot + 1, event.data[2], 0, event.samplePosition);
+
+        return true;
+    }
+
+    // Channel pressure and timbre (CC74) apply to every voice started from their channel
+    auto isTimbre = status == 0xb0 && event.numBytes >= 3 && event.data[1] == 74;
+    if (!(status == 0xd0 && event.numBytes >= 2) && !isTimbre)
+        return false;
+
+    auto slots = voices.slotsForInputChannel[static_cast<size_t>(channel - 1)];
+    if (slots == 0)
+        return false;
+
+    if (lanesSending() && lanes[isTimbre ? timbreLaneIndex : pressureLaneIndex].enabled)
+        return true;
+
+    for (auto mask = slots; mask != 0; mask &= mask - 1)
+        addChannelMessage(status, lowestSetBit(mask) + 1, event.data[1], isTimbre ? event.data[2] : 0, event.samplePosition);
+
+    return true;
+}
+
+void PitchBendProcessor::setZoneLayout(OutputMode newMode, bool split, int upperChannels)
+{
+    if (!split)
+        upperChannels = 0;
+
+    if (newMode == activeOutputMode && split == activeZoneSplit && upperChannels == activeUpperZoneChannels)
+        return;
+
+    BCS_LOG(realtimeLog, LogEvent::zoneLayoutChanged, sampleClock, static_cast<int>(newMode), upperChannels);
+
+    // Voices started in one format or zone have to be ended in it
+    for (auto mask = voices.activeMask; mask != 0; mask &= mask - 1)
+        endVoice(lowestSetBit(mask), 0, 0);
+
+    // Keys held in single-channel mode sound on their input channels, like ones struck in
+    // bypass, and their note-offs follow them there
+    if (activeOutputMode == OutputMode::singleChannel && newMode != OutputMode::singleChannel)
+    {
+        for (auto &channel : bypassedNotes)
+            for (size_t word = 0; word < channel.size(); ++word)
+                channel[word] |= singleChannel.heldKeys[word];
+
+        if (singleChannel.lastValue != 8192)
+            addPitchWheel(singleChannel.channel, 8192, 0);
+
+        singleChannel = {};
+    }
+
+    activeOutputMode = newMode;
+    activeZoneSplit = split;
+    activeUpperZoneChannels = upperChannels;
+
+    configureZones();
+
+    if (newMode == OutputMode::mpe)
+        control.zoneConfigRequested = true;
+}
+
+juce::ThreadPool &PitchBendProcessor::getBackgroundWorker()
+{
+    if (backgroundWorker == nullptr)
+        backgroundWorker = std::make_unique<juce::ThreadPool>(juce::ThreadPoolOptions{}.withThreadName("Background Work").withNumberOfThreads(1));
+
+    return *backgroundWorker;
+}
+
+void PitchBendProcessor::prepareBendStreams(int streamSize)
+{
+    if (streamSize == requestedStreamSize)
+        return;
+
+    requestedStreamSize = streamSize;
+
+    auto build = [this, streamSize]
+    {
+        auto storage = std::make_unique<StreamStorage>();
+
+        for (auto &stream : storage->streams)
+            stream.resize(static_cast<size_t>(streamSize));
+
+        // One built earlier and not yet picked up is simply replaced
+        delete preparedStreams.exchange(storage.release(), std::memory_order_acq_rel);
+    };
+
+    // An offline render can wait, and should be rendered the same way from its first block
+    if (isNonRealtime())
+        build();
+    else
+        getBackgroundWorker().addJob(build);
+}
+
+void PitchBendProcessor::pickUpBendStreams()
+{
+    auto *prepared = preparedStreams.exchange(nullptr, std::memory_order_acq_rel);
+
+    if (prepared == nullptr)
+        return;
+
+    // A job for an earlier, smaller block size may finish last
+    if (prepared->streams[0].size() >= static_cast<size_t>(preparedBlockSize * (1 + VoiceTable::numLanes)))
+        std::swap(bendStreams, prepared->streams);
+
+    prepared->next = retiredStreams.load(std::memory_order_relaxed);
+    while (!retiredStreams.compare_exchange_weak(prepared->next, prepared, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+void PitchBendProcessor::freeRetiredStreams()
+{
+    for (auto *storage = retiredStreams.exchange(nullptr, std::memory_order_acquire); storage != nullptr;)
+    {
+        auto *next = storage->next;
+        delete storage;
+        storage = next;
+    }
+}
+
+void PitchBendProcessor::loadTuning(const juce::File &scaleFile, const juce::File &mappingFile,
+                                    std::function<void(const juce::String &)> onLoaded)
+{
+    getBackgroundWorker().addJob([this, scaleFile, mappingFile, onLoaded]
+    {
+        juce::String error;
+        TuningTable loaded;
+
+        if (TuningTable::loadScala(scaleFile, mappingFile, loaded, error))
+            engineConfig.edit([&](EngineConfig &config) { config.tuning = loaded; });
+
+        if (onLoaded != nullptr)
+            juce::MessageManager::callAsync([onLoaded, error] { onLoaded(error); });
+    });
+}
+
+void PitchBendProcessor::setCurveExpression(const juce::String &expression, std::function<void(const juce::String &)> onCompiled)
+{
+    if (expression.length() > CurveExpression::maxLength)
+    {
+        if (onCompiled != nullptr)
+            onCompiled("The expression is longer than " + juce::String(CurveExpression::maxLength) + " characters");
+        return;
+    }
+
+    // Saved as written, even if it doesn't compile, so it can be put right later
+    parameters.state.setProperty(StateSerializer::curveExpressionProperty, expression, nullptr);
+    control.parameterGeneration.fetch_add(1, std::memory_order_release);
+
+    auto compile = [this, expression, onCompiled]
+    {
+        juce::String error;
+        std::shared_ptr<const CurveTable> table;
+
+        if (expression.isNotEmpty())
+        {
+            auto compiled = std::make_shared<CurveTable>();
+
+            if (CurveExpression::compile(expression, *compiled, error))
+                table = std::move(compiled);
+        }
+
+        engineConfig.edit([&](EngineConfig &config) { config.expressionTable = std::move(table); });
+
+        // Update intervals and next-change times were worked out for the old shape
+        control.parameterGeneration.fetch_add(1, std::memory_order_release);
+
+        if (onCompiled != nullptr)
+            juce::MessageManager::callAsync([onCompiled, error] { onCompiled(error); });
+    };
+
+    // An offline render should have the shape from its first block
+    if (isNonRealtime())
+        compile();
+    else
+        getBackgroundWorker().addJob(compile);
+}
+
+juce::String PitchBendProcessor::getCurveExpression() const
+{
+    return parameters.state[StateSerializer::curveExpressionProperty].toString();
+}
+
+PitchBendProcessor::MemoryFootprint PitchBendProcessor::getMemoryFootprint() const
+{
+    auto capacityBytes = [](const auto &vector) { return vector.capacity() * sizeof(vector[0]); };
+
+    MemoryFootprint footprint;
+    footprint.object = sizeof(*this);
+    footprint.voices = sizeof(voices);
+    footprint.scheduler = sizeof(scheduler);
+
+    // outputMidi, serialMidi and chunkMidi each hold a block's worst-case output; the
+    // lookahead buffers and splitInput hold input
+    footprint.buffers = reservedOutputBytes * 3 + reservedLookaheadBytes * 2
+                        + static_cast<size_t>(maxInputEventsPerBlock) * bytesPerMidiEvent * 2
+                        + capacityBytes(umpOutput) + capacityBytes(umpInputWords) + capacityBytes(umpInputRuns)
+                        + scratchCapacity.load(std::memory_order_relaxed);
+
+    for (const auto &queue : inputBusQueues)
+        footprint.buffers += capacityBytes(queue.bytes) + capacityBytes(queue.events);
+
+    footprint.bendStreams = static_cast<size_t>(requestedStreamSize) * bendStreams.size() * sizeof(StreamedBend);
+    footprint.tables = sizeof(EngineConfig) + (getCurveExpression().isNotEmpty() ? sizeof(CurveTable) : 0);
+    footprint.diagnostics = traceRecorder.getMemoryBytes() + midiCapture.getMemoryBytes() + realtimeLog.getMemoryBytes()
+                            + phaseTracer.getMemoryBytes() + flightRecorder.getMemoryBytes();
+    footprint.savedState = cachedState.getSize();
+
+    return footprint;
+}
+
+float PitchBendProcessor::getEditorScale() const
+{
+    return static_cast<float>(parameters.state.getProperty(StateSerializer::editorScaleProperty, 1.0f));
+}
+
+void PitchBendProcessor::setEditorScale(float scale)
+{
+    parameters.state.setProperty(StateSerializer::editorScaleProperty, scale, nullptr);
+}
+
+int PitchBendProcessor::findLearnableParameter(const juce::String &parameterID)
+{
+    for (int target = 0; target < numLearnableParameters; ++target)
+        if (parameterID == learnableParameterIDs[target])
+            return target;
+
+    return -1;
+}
+
+void PitchBendProcessor::armMidiLearn(const juce::String &parameterID)
+{
+    control.midiLearnArmed = findLearnableParameter(parameterID);
+}
+
+juce::String PitchBendProcessor::getArmedMidiLearn() const
+{
+    auto target = control.midiLearnArmed.load();
+    return target >= 0 ? juce::String(learnableParameterIDs[target]) : juce::String();
+}
+
+void PitchBendProcessor::clearMidiLearn(const juce::String &parameterID)
+{
+    auto target = findLearnableParameter(parameterID);
+
+    if (target >= 0)
+        setMidiLearn(target, 0, -1);
+}
+
+PitchBendProcessor::MidiLearnMapping PitchBendProcessor::getMidiLearn(const juce::String &parameterID) const
+{
+    auto target = findLearnableParameter(parameterID);
+
+    for (size_t channel = 0; channel < midiLearnMappings.targets.size() && target >= 0; ++channel)
+        for (size_t controller = 0; controller < 128; ++controller)
+            if (midiLearnMappings.targets[channel][controller] == target)
+                return {static_cast<int>(channel) + 1, static_cast<int>(controller)};
+
+    return {};
+}
+
+void PitchBendProcessor::setMidiLearn(int target, int channel, int controller)
+{
+    // One controller per parameter, and one parameter per controller
+    for (auto &targets : midiLearnMappings.targets)
+        std::replace(targets.begin(), targets.end(), static_cast<juce::int8>(target), MidiLearnTable::noTarget);
+
+    if (channel > 0)
+        midiLearnMappings.targets[static_cast<size_t>(channel - 1)][static_cast<size_t>(controller)] = static_cast<juce::int8>(target);
+
+    juce::MemoryOutputStream stream;
+
+    for (size_t c = 0; c < midiLearnMappings.targets.size(); ++c)
+    {
+        for (size_t cc = 0; cc < 128; ++cc)
+        {
+            auto mapped = midiLearnMappings.targets[c][cc];
+
+            if (mapped != MidiLearnTable::noTarget)
+            {
+                stream.writeByte(static_cast<char>(c + 1));
+                stream.writeByte(static_cast<char>(cc));
+                stream.writeShort(static_cast<short>(StateSerializer::findTag(learnableParameterIDs[mapped])));
+            }
+        }
+    }
+
+    parameters.state.setProperty(StateSerializer::midiLearnProperty, stream.getMemoryBlock(), nullptr);
+    control.parameterGeneration.fetch_add(1, std::memory_order_release);
+    publishMidiLearn();
+}
+
+// After a state restore: mappings for parameters this build can't learn are dropped
+void PitchBendProcessor::loadMidiLearn()
+{
+    midiLearnMappings = {};
+
+    if (const auto *data = parameters.state[StateSerializer::midiLearnProperty].getBinaryData())
+    {
+        const auto *bytes = static_cast<const juce::uint8 *>(data->getData());
+
+        for (size_t i = 0; i + 4 <= data->getSize(); i += 4)
+        {
+            auto channel = bytes[i];
+            auto controller = bytes[i + 1];
+            const auto *parameterID = StateSerializer::findParameterID(juce::ByteOrder::littleEndianShort(bytes + i + 2));
+            auto target = parameterID != nullptr ? findLearnableParameter(parameterID) : -1;
+
+            if (channel >= 1 && channel <= 16 && controller < 128 && target >= 0)
+                midiLearnMappings.targets[static_cast<size_t>(channel - 1)][controller] = static_cast<juce::int8>(target);
+        }
+    }
+
+    publishMidiLearn();
+}
+
+void PitchBendProcessor::publishMidiLearn()
+{
+    engineConfig.edit([this](EngineConfig &config) { config.midiLearn = midiLearnMappings; });
+}
+
+void PitchBendProcessor::setBendRange(int semitones)
+{
+    if (semitones == activeBendRange)
+        return;
+
+    // Sounding voices keep their channels; only the RPN carrying the range is resent
+    BCS_LOG(realtimeLog, LogEvent::bendRangeChanged, sampleClock, semitones);
+    activeBendRange = semitones;
+    semitoneScale = 8192.0f / static_cast<float>(semitones);
+
+    for (auto &zone : zones)
+        zone.mpeZone = juce::MPEZone(zone.mpeZone.zoneType, zone.mpeZone.numMemberChannels, semitones, masterBendRange());
+
+    if (activeOutputMode == OutputMode::mpe)
+    {
+        buildZoneConfigMessages();
+        control.zoneConfigRequested = true;
+    }
+}
+
+void PitchBendProcessor::setSharedPool(int poolId)
+{
+    if (poolId == activeSharedPool)
+        return;
+
+    // Channels held in one pool go back before any are claimed in the next
+    for (auto mask = voices.activeMask; mask != 0; mask &= mask - 1)
+        endVoice(lowestSetBit(mask), 0, 0);
+
+    activeSharedPool = poolId;
+
+    for (auto &zone : zones)
+        zone.allocator.setSharedPool(poolId > 0 ? &SharedChannelPool::get(poolId) : nullptr);
+}
+
+void PitchBendProcessor::setMasterBendMode(bool enabled)
+{
+    if (enabled == activeMasterBend)
+        return;
+
+    // Member channels take back the whole bend before the master range changes
+    for (auto &zone : zones)
+    {
+        if (zone.masterBend == 0)
+            continue;
+
+        centreMasterBend(zone, 0);
+
+        for (auto mask = voices.activeMask & zone.slotMask; mask != 0; mask &= mask - 1)
+        {
+            auto slot = lowestSetBit(mask);
+            sendBend(slot, voices.lastBendValue[slot], static_cast<float>(voices.lastBendValue[slot]), 0);
+        }
+    }
+
+    activeMasterBend = enabled;
+
+    for (auto &zone : zones)
+        zone.mpeZone = juce::MPEZone(zone.mpeZone.zoneType, zone.mpeZone.numMemberChannels, activeBendRange, masterBendRange());
+
+    if (activeOutputMode == OutputMode::mpe)
+    {
+        buildZoneConfigMessages();
+        control.zoneConfigRequested = true;
+    }
+}
+
+void PitchBendProcessor::centreMasterBend(Zone &zone, int samplePos)
+{
+    if (zone.masterBend == 0)
+        return;
+
+    zone.masterBend = 0;
+    addPitchWheel(zone.mpeZone.getMasterChannel(), 8192, samplePos);
+}
+
+bool PitchBendProcessor::sendLockstepBend(Zone &zone, juce::uint32 sendMask, const std::array<int, 16> &bendValues, int samplePos)
+{
+    // Every sounding voice has to be due and moving, and none can be ramping after a steal
+    auto sounding = voices.activeMask & zone.slotMask;
+
+    if (juce::countNumberOfBits(sounding) < 2 || (sounding & voices.handoffMask) != 0 || (sendMask & sounding) != sounding)
+        return false;
+
+    auto first = lowestSetBit(sounding);
+    auto master = zone.masterBend + bendValues[static_cast<size_t>(first)] - voices.lastBendValue[first];
+
+    if (master < -8192 || master > 8191)
+        return false;
+
+    for (auto mask = sounding & (sounding - 1); mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+
+        if (zone.masterBend + bendValues[static_cast<size_t>(slot)] - voices.lastBendValue[slot] != master)
+            return false;
+    }
+
+    for (auto mask = sounding; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+        voices.lastBendValue[slot] = bendValues[static_cast<size_t>(slot)];
+    }
+
+    zone.masterBend = master;
+    addPitchWheel(zone.mpeZone.getMasterChannel(), master + 8192, samplePos);
+    return true;
+}
+
+PitchBendProcessor::Zone &PitchBendProcessor::zoneForNewNote(int noteNumber)
+{
+    auto own = activeZoneSplit && noteNumber >= params.splitNote ? upperZone : lowerZone;
+
+    if (!params.spillToOtherZone)
+        return zones[own];
+
+    // Two masks each, no search, however many notes the pedal is holding
+    auto isFull = [](const Zone &zone) { return (zone.slotMask & ~zone.allocator.getBusyMask()) == 0; };
+    auto other = own == lowerZone ? upperZone : lowerZone;
+
+    return isFull(zones[own]) && !isFull(zones[other]) ? zones[other] : zones[own];
+}
+
+void PitchBendProcessor::configureZones()
+{
+    auto assignChannels = [](Zone &zone, int firstChannel, int numChannels)
+    {
+        zone.slotMask = numChannels > 0 ? ((1u << numChannels) - 1u) << (firstChannel - 1) : 0u;
+
+        if (numChannels > 0)
+            zone.allocator.setZone(firstChannel, numChannels);
+    };
+
+    auto numUpper = activeUpperZoneChannels;
+    auto &lower = zones[lowerZone];
+    auto &upper = zones[upperZone];
+
+    if (activeOutputMode == OutputMode::mpe)
+    {
+        // Master channels 1 and 16, member channels counted in from either end
+        auto numLower = autoZoneChannels > 0 ? juce::jmin(autoZoneChannels, 14 - numUpper) : 14 - numUpper;
+        lower.mpeZone = juce::MPEZone(juce::MPEZone::Type::lower, numLower, activeBendRange, masterBendRange());
+        upper.mpeZone = juce::MPEZone(juce::MPEZone::Type::upper, numUpper, activeBendRange, masterBendRange());
+        assignChannels(lower, 2, numLower);
+        assignChannels(upper, 16 - numUpper, numUpper);
+        buildZoneConfigMessages();
+    }
+    else
+    {
+        // Per-note output isn't bound to member channels, so every slot is usable
+        assignChannels(lower, 1, 16 - numUpper);
+        assignChannels(upper, 17 - numUpper, numUpper);
+    }
+
+    selectBendPass();
+}
+
+void PitchBendProcessor::processSingleChannel(int numSamples)
+{
+    auto &bend = singleChannel;
+    const auto &zone = zones[lowerZone];
+    auto target = zone.amount * zone.bendScale;
+    auto inverseDuration = 1.0f / static_cast<float>(std::max<juce::int64>(1, zone.durationInSamples));
+
+    auto sendUntil = [&](juce::int64 endSample)
+    {
+        for (; bend.nextUpdateSample < endSample; bend.nextUpdateSample += zone.updateRateInSamples)
+        {
+            auto progress = juce::jmin(1.0f, static_cast<float>(bend.nextUpdateSample - bend.startSample) * inverseDuration);
+            auto value = toPitchWheel(juce::roundToInt(juce::jlimit(-16384.0f, 16384.0f, target * zone.table->evaluate(progress))));
+
+            if (value != bend.lastValue)
+            {
+                addPitchWheel(bend.channel, value, static_cast<int>(juce::jmax(static_cast<juce::int64>(0), bend.nextUpdateSample - sampleClock)));
+                bend.lastValue = value;
+            }
+
+            // At the target, nothing more until the next bend starts
+            if (progress >= 1.0f)
+            {
+                bend.nextUpdateSample = neverSample;
+                break;
+            }
+        }
+    };
+
+    for (const auto &event : inputEvents)
+    {
+        auto eventSample = sampleClock + event.samplePosition;
+        sendUntil(eventSample + 1);
+
+        if (event.kind == InputEvent::Kind::other)
+        {
+            handleInputMessage(event);
+            continue;
+        }
+
+        auto &word = bend.heldKeys[static_cast<size_t>(event.note >> 5)];
+        auto bit = 1u << (event.note & 31);
+        auto wasHeld = (word & bit) != 0;
+
+        if (event.kind == InputEvent::Kind::noteOn)
+        {
+            // The first key starts the bend from centre, sent ahead of its note
+            if (bend.numHeld == 0)
+            {
+                if (bend.lastValue != 8192 && bend.channel != event.channel)
+                    addPitchWheel(bend.channel, 8192, event.samplePosition);
+
+                bend.channel = event.channel;
+                bend.startSample = eventSample;
+                bend.nextUpdateSample = eventSample;
+                sendUntil(eventSample + 1);
+            }
+
+            word |= bit;
+            bend.numHeld += wasHeld ? 0 : 1;
+            addChannelMessage(0x90, event.channel, event.note, event.velocity, event.samplePosition);
+        }
+        else
+        {
+            word &= ~bit;
+            bend.numHeld -= wasHeld ? 1 : 0;
+            addChannelMessage(0x80, event.channel, event.note, event.velocity, event.samplePosition);
+
+            // The last key up: centred after its note-off, ready for the next
+            if (bend.numHeld == 0 && wasHeld)
+            {
+                bend.nextUpdateSample = neverSample;
+
+                if (bend.lastValue != 8192)
+                {
+                    addPitchWheel(bend.channel, 8192, event.samplePosition);
+                    bend.lastValue = 8192;
+                }
+            }
+        }
+    }
+
+    sendUntil(sampleClock + numSamples);
+    inputEvents.clear();
+}
+
+void PitchBendProcessor::setAutoZoneSize(bool enabled)
+{
+    enabled = enabled && activeOutputMode == OutputMode::mpe && !activeZoneSplit;
+
+    if (enabled == (autoZoneChannels > 0))
+        return;
+
+    // Starts from the whole zone and shrinks once it has seen what is played; turned off, it
+    // grows back around the sounding voices
+    autoZonePeak = juce::countNumberOfBits(voices.activeMask);
+    autoZoneWindowStart = sampleClock;
+
+    if (enabled)
+        autoZoneChannels = zones[lowerZone].mpeZone.numMemberChannels;
+    else if (autoZoneChannels < 14 - activeUpperZoneChannels && activeOutputMode == OutputMode::mpe)
+        resizeLowerZone(14 - activeUpperZoneChannels, 0);
+
+    if (!enabled)
+        autoZoneChannels = 0;
+}
+
+void PitchBendProcessor::resizeLowerZone(int numChannels, int samplePos)
+{
+    auto &lower = zones[lowerZone];
+
+    if (autoZoneChannels > 0)
+        autoZoneChannels = numChannels;
+
+    lower.slotMask = ((1u << numChannels) - 1u) << 1;
+    lower.allocator.resize(numChannels);
+    lower.mpeZone = juce::MPEZone(juce::MPEZone::Type::lower, numChannels, activeBendRange, masterBendRange());
+    buildZoneConfigMessages();
+    selectBendPass();
+
+    // Only the member count has changed, and it goes ahead of the note that needs it
+    addChannelMessage(0xb0, 1, 100, 6, samplePos);
+    addChannelMessage(0xb0, 1, 101, 0, samplePos);
+    addChannelMessage(0xb0, 1, 6, numChannels, samplePos);
+    BCS_LOG(realtimeLog, LogEvent::zoneResized, sampleClock + samplePos, numChannels);
+}
+
+void PitchBendProcessor::growAutoZone(const Zone &zone, int numNotes, int samplePos)
+{
+    auto free = zone.slotMask & ~zone.allocator.getBusyMask();
+
+    if (autoZoneChannels > 0 && &zone == &zones[lowerZone] && juce::countNumberOfBits(free) < numNotes && autoZoneChannels < 14)
+    {
+        resizeLowerZone(14, samplePos);
+        autoZoneWindowStart = sampleClock + samplePos;
+    }
+}
+
+void PitchBendProcessor::updateAutoZone(int numSamples)
+{
+    if (autoZoneChannels == 0)
+        return;
+
+    autoZonePeak = juce::jmax(autoZonePeak, juce::countNumberOfBits(voices.activeMask));
+
+    if (voices.activeMask != 0 || sampleClock + numSamples - autoZoneWindowStart < static_cast<juce::int64>(autoZoneWindowSeconds * currentSampleRate))
+        return;
+
+    auto fit = juce::jmax(2, autoZonePeak + 1);
+
+    if (fit + 2 <= autoZoneChannels)
+        resizeLowerZone(fit, numSamples - 1);
+
+    autoZonePeak = 0;
+    autoZoneWindowStart = sampleClock + numSamples;
+}
+
+void PitchBendProcessor::sendNoteOn(int slot, int velocity, int samplePos)
+{
+    auto note = voices.noteNumber[slot];
+
+    if (activeOutputMode == OutputMode::mpe)
+    {
+        // Initialize pitch bend for this channel: centre, or the note's tuning offset, or where
+        // a chased voice has got to. It goes first, so the note never starts on the bend the
+        // channel's last voice left behind. Releases leave their channel where they end, so
+        // this is the one reset a channel gets, and only when it isn't there already: a
+        // release that came back, or a note with no bend, costs nothing to follow.
+        auto initialBend = toPitchWheel(static_cast<juce::int64>(voices.lastBendValue[slot]) - zoneForSlot(slot).masterBend);
+        if (generatedState.getBend(slot) != initialBend)
+            addPitchWheel(slot + 1, initialBend, samplePos);
+
+        // So do the lanes' starting values
+        if (lanesActive)
+            for (int lane = 0; lane < VoiceTable::numLanes; ++lane)
+                if (lanes[static_cast<size_t>(lane)].enabled)
+                    sendLaneValue(lane, slot, voices.lastLaneValue[static_cast<size_t>(lane)][static_cast<size_t>(slot)], samplePos);
+
+        // Send note on the MPE member channel (not the original channel)
+        addChannelMessage(0x90, slot + 1, note, velocity, samplePos);
+        BCS_LOG(realtimeLog, LogEvent::noteStarted, sampleClock + samplePos, slot + 1, note, velocity);
+        return;
+    }
+
+    auto channel = static_cast<std::uint8_t>(voices.inputChannel[slot] - 1);
+    auto velocity16 = juce::ump::Conversion::scaleTo16(static_cast<std::uint8_t>(velocity));
+
+    addUmpEvent(juce::ump::Factory::makeNoteOnV2(0, channel, static_cast<std::uint8_t>(note),
+                                                 juce::ump::Factory::NoteAttributeKind::none, velocity16, 0),
+                samplePos);
+    // The tuning offset at full resolution, unless the voice was chased to a bend beyond it
+    auto startBend = voices.lastBendValue[slot] == static_cast<int>(voices.baseBend[slot]) ? voices.baseBend[slot] : static_cast<float>(voices.lastBendValue[slot]);
+    auto initialBend = juce::jlimit<juce::int64>(0, 0xffffffff, 0x80000000ll + static_cast<juce::int64>(startBend * 262144.0f));
+    addUmpEvent(juce::ump::Factory::makePerNotePitchBendV2(0, channel, static_cast<std::uint8_t>(note),
+                                                           static_cast<std::uint32_t>(initialBend)),
+                samplePos);
+
+    // Bytestream hosts still get the notes; per-note bend has no MIDI 1.0 equivalent
+    addChannelMessage(0x90, channel + 1, note, velocity, samplePos);
+    BCS_LOG(realtimeLog, LogEvent::noteStarted, sampleClock + samplePos, channel + 1, note, velocity);
+}
+
+void PitchBendProcessor::sendNoteOff(int slot, int velocity, int samplePos)
+{
+    auto note = voices.noteNumber[slot];
+
+    if (activeOutputMode == OutputMode::mpe)
+    {
+        addChannelMessage(0x80, slot + 1, note, velocity, samplePos);
+        BCS_LOG(realtimeLog, LogEvent::noteEnded, sampleClock + samplePos, slot + 1, note);
+        return;
+    }
+
+    auto channel = static_cast<std::uint8_t>(voices.inputChannel[slot] - 1);
+    auto velocity16 = juce::ump::Conversion::scaleTo16(static_cast<std::uint8_t>(velocity));
+
+    addUmpEvent(juce::ump::Factory::makeNoteOffV2(0, channel, static_cast<std::uint8_t>(note),
+                                                  juce::ump::Factory::NoteAttributeKind::none, velocity16, 0),
+                samplePos);
+    addChannelMessage(0x80, channel + 1, note, velocity, samplePos);
+    BCS_LOG(realtimeLog, LogEvent::noteEnded, sampleClock + samplePos, channel + 1, note);
+}
+
+void PitchBendProcessor::sendBend(int slot, int bendValue, float exactBend, int samplePos)
+{
+    if (activeOutputMode == OutputMode::mpe)
+    {
+        // Send pitch bend on this note's MPE member channel, less the zone's master bend. Past
+        // the end of the wheel the receiver can't follow, so a channel already pinned there
+        // gets nothing more until the bend comes back.
+        auto value = toPitchWheel(static_cast<juce::int64>(bendValue) - zoneForSlot(slot).masterBend);
+
+        if (!isPitchWheelRail(value) || generatedState.getBend(slot) != value)
+            addPitchWheel(slot + 1, value, samplePos);
+
+        return;
+    }
+
+    // 32-bit per-note bend from the unrounded value: 14-bit steps scale by 2^18
+    auto value32 = juce::jlimit<juce::int64>(0, 0xffffffff, 0x80000000ll + static_cast<juce::int64>(exactBend * 262144.0f));
+    auto channel = static_cast<std::uint8_t>(voices.inputChannel[slot] - 1);
+
+    addUmpEvent(juce::ump::Factory::makePerNotePitchBendV2(0, channel, static_cast<std::uint8_t>(voices.noteNumber[slot]),
+                                                           static_cast<std::uint32_t>(value32)),
+                samplePos);
+}
+
+void PitchBendProcessor::sendLaneValue(int lane, int slot, int value, int samplePos)
+{
+    const auto &settings = lanes[static_cast<size_t>(lane)];
+    addChannelMessage(settings.status, slot + 1, settings.status == 0xb0 ? settings.controller : value, value, samplePos);
+}
+
+juce::uint32 PitchBendProcessor::calculateLaneValues(int lane, juce::uint32 slotMask)
+{
+    const auto &settings = lanes[static_cast<size_t>(lane)];
+    auto &values = laneValues[static_cast<size_t>(lane)];
+    const auto &last = voices.lastLaneValue[static_cast<size_t>(lane)];
+    juce::uint32 changedMask = 0;
+
+    for (int slot = 0; slot < VoiceTable::numSlots; ++slot)
+    {
+        auto i = static_cast<size_t>(slot);
+        values[i] = settings.valueAt(slotLevels[i]);
+        changedMask |= static_cast<juce::uint32>(values[i] != last[i]) << slot;
+    }
+
+    return changedMask & slotMask;
+}
+
+void PitchBendProcessor::endVoice(int slot, int velocity, int samplePos)
+{
+    // A releasing voice has had its note-off already, and a handed-over one hasn't started
+    if ((voices.releasingMask >> slot) & 1u)
+        scheduler.cancel(releaseEvents[static_cast<size_t>(slot)]);
+    else if (((voices.handoffMask >> slot) & 1u) == 0)
+        sendNoteOff(slot, velocity, samplePos);
+
+    auto bit = 1u << slot;
+    if ((pendingBendMask & bit) != 0)
+    {
+        counters.droppedBends.fetch_add(1, std::memory_order_relaxed);
+        BCS_LOG(realtimeLog, LogEvent::bendDropped, sampleClock + samplePos, slot + 1);
+        pendingBendMask &= ~bit;
+    }
+
+    voices.deactivate(slot);
+    updateQueue.remove(slot, voices.nextUpdateSample);
+
+    // The master channel goes back to centre with the zone's last voice
+    auto &zone = zoneForSlot(slot);
+    if ((voices.activeMask & zone.slotMask) == 0)
+        centreMasterBend(zone, samplePos);
+}
+
+void PitchBendProcessor::releaseVoice(int slot, int velocity, int samplePos)
+{
+    // A note still waiting for its channel never sounded, so it has nothing to release
+    if (params.releaseBend && ((voices.handoffMask >> slot) & 1u) == 0)
+    {
+        beginRelease(slot, velocity, samplePos);
+        return;
+    }
+
+    endVoice(slot, velocity, samplePos);
+
+    // Mark channel as free
+    zoneForSlot(slot).allocator.release(slot + 1);
+}
+
+void PitchBendProcessor::setSustainPedal(int channel, bool isDown, int samplePos)
+{
+    auto bit = 1u << (channel - 1);
+
+    if (isDown)
+    {
+        sustainPedals |= bit;
+        return;
+    }
+
+    sustainPedals &= ~bit;
+
+    for (auto mask = voices.sustainedMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+
+        if (voices.inputChannel[static_cast<size_t>(slot)] == channel)
+            releaseVoice(slot, 0, samplePos);
+    }
+}
+
+void PitchBendProcessor::advanceHandoff(int slot, juce::int64 tickSample, int samplePos, juce::int64 blockEnd)
+{
+    auto i = static_cast<size_t>(slot);
+    auto noteStart = voices.startSample[i];
+    auto &next = voices.nextUpdateSample[i];
+
+    if (tickSample >= noteStart)
+    {
+        // Ramp done: the note starts with the bend it has arrived at, and its own bend from there
+        voices.handoffMask &= ~(1u << slot);
+        voices.lastBendValue[i] = static_cast<int>(voices.baseBend[i]);
+        sendNoteOn(slot, voices.handoffVelocity[i], samplePos);
+        next = noteStart + zoneForSlot(slot).updateRateInSamples;
+    }
+    else
+    {
+        auto rampLength = noteStart - voices.handoffStart[i];
+        auto progress = static_cast<float>(tickSample - voices.handoffStart[i]) / static_cast<float>(rampLength);
+        auto bend = voices.handoffBend[i] + (voices.baseBend[i] - voices.handoffBend[i]) * progress;
+
+        voices.lastBendValue[i] = static_cast<int>(bend);
+        sendBend(slot, voices.lastBendValue[i], bend, samplePos);
+        ++bendsThisBlock;
+        next = juce::jmin(noteStart, tickSample + juce::jmax(static_cast<juce::int64>(1), rampLength / stealRampSteps));
+    }
+
+    if (next < blockEnd)
+        updateQueue.push(slot, voices.nextUpdateSample);
+}
+
+void PitchBendProcessor::trackPressure(const InputEvent &event)
+{
+    auto status = event.data[0] & 0xf0;
+    auto channel = (event.data[0] & 0x0f) + 1;
+
+    if (status == 0xa0 && event.numBytes >= 3)
+    {
+        int slot = voices.findSlot(channel, event.data[1]);
+
+        if (slot != VoiceTable::noSlot)
+            voices.pressureTarget[slot] = static_cast<float>(event.data[2]) / 127.0f;
+    }
+    else if (status == 0xd0 && event.numBytes >= 2)
+    {
+        auto pressure = static_cast<float>(event.data[1]) / 127.0f;
+        inputPressure[static_cast<size_t>(channel - 1)] = pressure;
+
+        for (auto mask = voices.slotsForInputChannel[static_cast<size_t>(channel - 1)]; mask != 0; mask &= mask - 1)
+            voices.pressureTarget[lowestSetBit(mask)] = pressure;
+    }
+}
+
+float PitchBendProcessor::smoothPressure(int slot, juce::int64 sample)
+{
+    // One pole over the time since the level last moved; elapsed / (elapsed + tau) stands in
+    // for 1 - exp(-elapsed / tau), which it matches over the short steps between updates
+    auto i = static_cast<size_t>(slot);
+    auto elapsed = static_cast<float>(juce::jmax(static_cast<juce::int64>(0), sample - voices.pressureSample[i]));
+
+    voices.pressureLevel[i] += (voices.pressureTarget[i] - voices.pressureLevel[i]) * elapsed / (elapsed + pressureSmoothingSamples);
+    voices.pressureSample[i] = juce::jmax(voices.pressureSample[i], sample);
+    return voices.pressureLevel[i];
+}
+
+void PitchBendProcessor::setVoiceModulation(int slot, int noteNumber, int velocity)
+{
+    voices.pressureTarget[slot] = inputPressure[static_cast<size_t>(voices.inputChannel[slot] - 1)];
+
+    voices.amountScale[slot] = velocityTracking.amount[static_cast<size_t>(velocity)] * keyTracking.amount[static_cast<size_t>(noteNumber)];
+    voices.inverseTimeScale[slot] = velocityTracking.inverseTime[static_cast<size_t>(velocity)]
+                                    * keyTracking.inverseTime[static_cast<size_t>(noteNumber)];
+    voices.curveBow[slot] = 0.0f;
+
+    // Spread by the golden ratio, so the notes of any chord land apart
+    auto scattered = static_cast<float>(noteNumber) * 0.618034f;
+    voices.vibratoPhase[slot] = params.vibratoSpread * (scattered - std::floor(scattered));
+
+    if (params.humanizeAmount != 0.0f || params.humanizeTime != 0.0f || params.humanizeCurve != 0.0f)
+    {
+        // The notes of a chord share a start sample, so the key tells them apart
+        FastRandom random(static_cast<juce::uint64>(voices.startSample[slot]) * 128u + static_cast<juce::uint64>(noteNumber));
+
+        voices.amountScale[slot] *= 1.0f + params.humanizeAmount * random.nextBipolar();
+        voices.inverseTimeScale[slot] /= 1.0f + params.humanizeTime * random.nextBipolar();
+        voices.curveBow[slot] = params.humanizeCurve * random.nextBipolar();
+    }
+
+    // Taken whether or not latching is on, so turning it on holds the bends that are playing
+    const auto &zone = zoneForSlot(slot);
+    auto target = zone.amount * zone.bendScale * voices.amountScale[slot];
+
+    if (params.targetOffsets)
+        target += voices.targetOffsetCents[slot] * semitoneScale / 100.0f;
+
+    voices.latchedTarget[slot] = target;
+    voices.latchedInverseDuration[slot] = voices.inverseTimeScale[slot] / static_cast<float>(zone.durationInSamples);
+    voices.latchedCurve[slot] = zone.curve;
+}
+
+void PitchBendProcessor::beginRelease(int slot, int velocity, int samplePos)
+{
+    sendNoteOff(slot, velocity, samplePos);
+
+    // The release bend starts from the value the synth has now; the channel stays taken,
+    // so no new note inherits the bend while it falls
+    auto startSample = sampleClock + samplePos;
+
+    if ((voices.releasingMask >> slot) & 1u)
+        scheduler.cancel(releaseEvents[static_cast<size_t>(slot)]);
+
+    voices.release(slot);
+    voices.baseBend[slot] = static_cast<float>(voices.lastBendValue[slot]);
+    voices.glideOffset[slot] = 0.0f;
+    voices.startSample[slot] = startSample;
+    voices.nextUpdateSample[slot] = startSample + zoneForSlot(slot).updateRateInSamples;
+
+    updateQueue.remove(slot, voices.nextUpdateSample);
+    updateQueue.push(slot, voices.nextUpdateSample);
+
+    zoneForSlot(slot).allocator.setReleasing(slot + 1);
+    // The pool keeps room for one end per slot besides the strummed notes
+    ScheduledEvent end;
+    end.kind = ScheduledEvent::Kind::releaseEnd;
+    end.slot = slot;
+    releaseEvents[static_cast<size_t>(slot)] = scheduler.schedule(startSample + static_cast<juce::int64>(releaseInSamples), releaseEndRank, end);
+}
+
+void PitchBendProcessor::finishRelease(int slot)
+{
+    voices.deactivate(slot);
+    updateQueue.remove(slot, voices.nextUpdateSample);
+    zoneForSlot(slot).allocator.release(slot + 1);
+}
+
+juce::uint32 PitchBendProcessor::calculateReleaseBends(juce::int64 tickSample, const CurveTable &table, juce::uint32 slotMask,
+                                                       std::array<int, VoiceTable::numSlots> &bendValues)
+{
+    auto releaseSteps = params.releaseSemitones * semitoneScale;
+    auto fixed = fixedPointEngineActive();
+    juce::uint32 changedMask = 0;
+
+    for (auto mask = slotMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+        auto i = static_cast<size_t>(slot);
+        auto progress = juce::jlimit(0.0f, 1.0f, static_cast<float>(tickSample - voices.startSample[i]) / releaseInSamples);
+
+        if (fixed)
+            slotValues[i] = static_cast<float>(evaluateFixedPointRelease(slot, tickSample, table)) / (1 << FixedPoint::bendFractionBits);
+        else
+            slotValues[i] = juce::jlimit(-8192.0f, 8191.0f, voices.baseBend[i] + table.evaluate(progress) * releaseSteps);
+        bendValues[i] = static_cast<int>(slotValues[i]);
+
+        // At the end of the release any change goes out, so it lands exactly on its target
+        auto change = std::abs(bendValues[i] - voices.lastBendValue[i]);
+        changedMask |= static_cast<juce::uint32>(change > sendThreshold || (change != 0 && progress >= 1.0f)) << slot;
+    }
+
+    return changedMask;
+}
+
+void PitchBendProcessor::refillBudget(int numSamples)
+{
+    budgetTokens = juce::jmin(budgetBurst, budgetTokens + numSamples * budgetTokensPerSample);
+}
+
+juce::uint32 PitchBendProcessor::applyBandwidthBudget(juce::uint32 sendMask, const std::array<int, 16> &bendValues)
+{
+    auto numWanted = juce::countNumberOfBits(sendMask);
+    auto numAllowed = juce::jmax(0, static_cast<int>(budgetTokens));
+
+    juce::uint32 allowedMask = sendMask;
+
+    if (numWanted > numAllowed)
+    {
+        // Send the voices furthest from their target first
+        allowedMask = 0;
+
+        for (int n = 0; n < numAllowed; ++n)
+        {
+            int best = -1;
+            int bestDistance = -1;
+
+            for (auto mask = sendMask & ~allowedMask; mask != 0; mask &= mask - 1)
+            {
+                int slot = lowestSetBit(mask);
+                int distance = std::abs(bendValues[static_cast<size_t>(slot)] - voices.lastBendValue[static_cast<size_t>(slot)]);
+
+                if (distance > bestDistance)
+                {
+                    best = slot;
+                    bestDistance = distance;
+                }
+            }
+
+            allowedMask |= 1u << best;
+        }
+
+        auto heldBack = sendMask & ~allowedMask;
+        counters.coalescedBends.fetch_add(static_cast<juce::uint64>(juce::countNumberOfBits(heldBack)), std::memory_order_relaxed);
+        pendingBendMask |= heldBack;
+    }
+
+    pendingBendMask &= ~allowedMask;
+    return allowedMask;
+}
+
+void PitchBendProcessor::fitDeadbandToBudget(int numSamples)
+{
+    // Bends per second over about the last 100 ms
+    auto blockSeconds = numSamples / currentSampleRate;
+    bendRate += (bendsThisBlock / blockSeconds - bendRate) * juce::jmin(1.0, blockSeconds / 0.1);
+
+    // A voice sends about one bend per threshold's worth of movement, so the threshold scales
+    // by how far the bends are over or under the budget, down to the deadband at the least
+    auto fitted = sendThreshold * static_cast<float>(bendRate / params.messageBudget);
+    sendThreshold = juce::jlimit(deadbandSteps, juce::jmax(deadbandSteps, maxFittedThreshold), fitted);
+}
+
+void PitchBendProcessor::applyQualityLevel()
+{
+    // A deadband of nothing widens from a floor, so every level sends fewer bends
+    auto cents = qualityLevel > 0 ? juce::jmax(params.bendDeadbandCents, minAdaptiveDeadbandCents) : params.bendDeadbandCents;
+    deadbandSteps = cents * static_cast<float>(1 << qualityLevel) * semitoneScale / 100.0f;
+
+    // Fitting only ever widens the threshold from the deadband, and carries on from where it was
+    sendThreshold = params.fitDeadband ? juce::jmax(sendThreshold, deadbandSteps) : deadbandSteps;
+    lanesActive = (params.pressureLane || params.timbreLane) && qualityLevel < lanesOffLevel;
+}
+
+void PitchBendProcessor::adaptQualityToLoad(int numSamples)
+{
+    auto level = qualityLevel;
+
+    if (!params.adaptiveQuality || isNonRealtime())
+    {
+        level = 0;
+        qualityOverSamples = 0;
+        qualityUnderSamples = 0;
+    }
+    else
+    {
+        // Down a level after a short spell past the threshold, back up only after a long one
+        // well under it, so a few heavy blocks don't send the level back and forth
+        auto load = loadMonitor.getLoad();
+        auto threshold = params.adaptiveThresholdPercent / 100.0;
+
+        if (load > threshold)
+        {
+            qualityUnderSamples = 0;
+            qualityOverSamples += numSamples;
+
+            if (qualityOverSamples >= qualityStepDownSeconds * currentSampleRate && level < maxQualityLevel)
+            {
+                ++level;
+                qualityOverSamples = 0;
+            }
+        }
+        else if (load < threshold * qualityRecoveryFraction)
+        {
+            qualityOverSamples = 0;
+            qualityUnderSamples += numSamples;
+
+            if (qualityUnderSamples >= qualityStepUpSeconds * currentSampleRate && level > 0)
+            {
+                --level;
+                qualityUnderSamples = 0;
+            }
+        }
+        else
+        {
+            qualityOverSamples = 0;
+            qualityUnderSamples = 0;
+        }
+    }
+
+    if (level != qualityLevel)
+    {
+        qualityLevel = level;
+        applyQualityLevel();
+        BCS_LOG(realtimeLog, LogEvent::qualityChanged, sampleClock, level, juce::roundToInt(loadMonitor.getLoad() * 100.0));
+    }
+}
+
+void PitchBendProcessor::parameterValueChanged(int parameterIndex, float)
+{
+    // May be called on any thread, including the audio thread during automation
+    control.parameterGeneration.fetch_add(1, std::memory_order_release);
+
+    // A linked setting that moved here rather than being taken from the group is an edit
+    for (size_t i = 0; i < linkedParameters.size(); ++i)
+    {
+        if (linkedParameters[i]->getParameterIndex() == parameterIndex)
+        {
+            auto bit = 1u << i;
+
+            if ((control.linkAdopted.fetch_and(~bit) & bit) == 0)
+                control.linkEdits.fetch_or(bit);
+
+            break;
+        }
+    }
+}
+
+void PitchBendProcessor::adoptLinkedSettings()
+{
+    if (params.linkGroup != adoptedLinkGroup)
+    {
+        adoptedLinkGroup = params.linkGroup;
+        linkSequence = 0;
+    }
+
+    if (adoptedLinkGroup == 0 || !LinkedSettings::get(adoptedLinkGroup).read(linkedBlock, linkSequence) || linkedBlock.published == 0)
+        return;
+
+    // Through the notifier, so the host and the editor hear of them as of any other change
+    for (size_t i = 0; i < linkedParameters.size(); ++i)
+    {
+        auto &parameter = *linkedParameters[i];
+
+        if (parameter.getValue() != linkedBlock.values[i])
+        {
+            control.linkAdopted.fetch_or(1u << i);
+            hostNotifier.setParameter(parameter, linkedBlock.values[i]);
+        }
+    }
+}
+
+void PitchBendProcessor::publishLinkedSettings()
+{
+    auto edits = control.linkEdits.exchange(0);
+    auto group = linkGroup->get();
+
+    if (group == 0)
+        return;
+
+    // The group's latest block, whatever was read before; edits made elsewhere are kept, and
+    // the first member sets every value
+    auto &slot = LinkedSettings::get(group);
+    LinkedSettings::Block block;
+    auto anySequence = ~juce::uint32{0};
+    slot.read(block, anySequence);
+
+    if (block.published == 0)
+        edits = ~juce::uint32{0};
+
+    bool changed = false;
+
+    for (size_t i = 0; i < linkedParameters.size(); ++i)
+    {
+        auto value = linkedParameters[i]->getValue();
+
+        if (((edits >> i) & 1) != 0 && value != block.values[i])
+        {
+            block.values[i] = value;
+            changed = true;
+        }
+    }
+
+    if (changed || block.published == 0)
+    {
+        block.published = 1;
+        slot.write(block);
+    }
+}
+
+bool PitchBendProcessor::updateParameterSnapshot()
+{
+    auto generation = control.parameterGeneration.load(std::memory_order_acquire);
+
+    if (generation == snapshotGeneration)
+        return false;
+
+    snapshotGeneration = generation;
+
+    params.amount = bendAmount->get();
+    params.time = bendTime->get();
+    params.curve = bendCurve->get();
+
+    if (pendingPreset != nullptr && control.requestedProgram.load() == -1)
+        pendingPreset = nullptr;
+
+    if (pendingPreset != nullptr)
+    {
+        params.amount = pendingPreset->amount;
+        params.time = pendingPreset->time;
+        params.curve = pendingPreset->curve;
+    }
+
+    params.rotation = static_cast<ChannelAllocator::Rotation>(channelRotation->getIndex());
+    params.stealPolicy = static_cast<ChannelAllocator::StealPolicy>(stealPolicy->getIndex());
+    params.spillToOtherZone = voiceOverflow->getIndex() == 1;
+    params.notePriority = static_cast<ChannelAllocator::NotePriority>(notePriority->getIndex());
+    params.updateMode = static_cast<UpdateMode>(updateMode->getIndex());
+    params.updateRateMs = updateRate->get();
+    params.updateCeilingHz = updateCeiling->get();
+    params.updatesPerBend = updatesPerBend->get();
+    params.tempoSync = tempoSync->get();
+    params.syncedNoteValue = syncedBendTime->getIndex();
+    params.outputMode = outputMode->getIndex() == autoOutputMode
+                            ? (receiverDiscovery.prefersPerNote() ? OutputMode::midi2PerNote : OutputMode::mpe)
+                        : outputMode->getIndex() == singleChannelOutputMode ? OutputMode::singleChannel
+                                                                            : static_cast<OutputMode>(outputMode->getIndex());
+#if BCS_CLAP
+    if (is_clap)
+        params.outputMode = OutputMode::midi2PerNote;
+#endif
+    params.budgetEnabled = budgetEnabled->get();
+    params.messageBudget = messageBudget->get();
+    params.smoothAutomation = smoothAutomation->get();
+    params.morphEnabled = morphEnabled->get();
+    params.morphController = morphController->get();
+    params.coalesceOutput = coalesceOutput->get();
+    params.coalesceDeadbandCents = coalesceDeadband->get();
+    params.zoneSplit = zoneSplit->get();
+    params.splitNote = splitNote->get();
+    params.upperZoneChannels = upperZoneChannels->get();
+    params.upperAmount = upperBendAmount->get();
+    params.upperTime = upperBendTime->get();
+    params.upperCurve = upperBendCurve->get();
+    params.bendRange = bendRange->get();
+    params.amountInSemitones = amountUnits->getIndex() == 1;
+    params.semitones = bendSemitones->get();
+    params.upperSemitones = upperBendSemitones->get();
+    params.justStacking = stackMode->getIndex() == 1;
+    params.strumMode = static_cast<StrumMode>(strumMode->getIndex());
+    params.strumSpreadMs = strumSpread->get();
+    params.legato = legato->get();
+    params.glideTime = glideTime->get();
+    params.releaseBend = releaseBend->get();
+    params.releaseSemitones = releaseAmount->get();
+    params.releaseTime = releaseTime->get();
+    params.holdTime = holdTime->get();
+    params.returnTime = returnTime->get();
+    params.returnCurve = returnCurve->get();
+    params.numBendLayers = bendLayerCount->get();
+
+    for (size_t layer = 0; layer < layerParameters.size(); ++layer)
+    {
+        const auto &layerParams = layerParameters[layer];
+        params.layers[layer] = {layerParams.amount->get(), layerParams.time->get(), layerParams.curve->get(), layerParams.delay->get()};
+    }
+
+    auto trackingChanged = velocityToAmount->get() != params.velocityToAmount || velocityToTime->get() != params.velocityToTime
+                           || velocityCurve->get() != params.velocityCurve || keyToAmount->get() != params.keyToAmount
+                           || keyToTime->get() != params.keyToTime || keyCurve->get() != params.keyCurve;
+
+    params.velocityToAmount = velocityToAmount->get();
+    params.velocityToTime = velocityToTime->get();
+    params.velocityCurve = velocityCurve->get();
+    params.keyToAmount = keyToAmount->get();
+    params.keyToTime = keyToTime->get();
+    params.keyCurve = keyCurve->get();
+    params.humanizeAmount = humanizeAmount->get();
+    params.humanizeTime = humanizeTime->get();
+    params.humanizeCurve = humanizeCurve->get();
+    params.pressureToAmount = pressureToAmount->get();
+    params.pressureSmoothingMs = pressureSmoothing->get();
+    params.bendDeadbandCents = bendDeadband->get();
+    params.receiverSmoothingMs = receiverSmoothing->get();
+    params.adaptiveQuality = adaptiveQuality->get();
+    params.adaptiveThresholdPercent = adaptiveThreshold->get();
+    params.fixedPoint = fixedPoint->get();
+    params.fitDeadband = fitDeadband->get();
+    params.offlineQuality = offlineQuality->get();
+    params.stealRampMs = stealRamp->get();
+    params.serialOutput = serialOutput->get();
+    params.scopeChannels = scopeChannel->getIndex() == 0 ? 0xffffu : 1u << (scopeChannel->getIndex() - 1);
+    params.scopeLowNote = scopeLowNote->get();
+    params.scopeHighNote = scopeHighNote->get();
+    params.debounceMs = retriggerDebounce->get();
+    params.ccHysteresis = ccHysteresis->get();
+    params.ccMaxRate = ccMaxRate->get();
+    params.previewSynth = previewSynth->get();
+    params.masterBend = masterBend->get();
+    params.vibratoDepthCents = vibratoDepth->get();
+    params.vibratoRate = vibratoRate->get();
+    params.vibratoDelay = vibratoDelay->get();
+    params.vibratoSpread = vibratoSpread->get();
+    params.pressureLane = pressureLane->get();
+    params.pressureFrom = pressureFrom->get();
+    params.pressureTo = pressureTo->get();
+    params.timbreLane = timbreLane->get();
+    params.timbreFrom = timbreFrom->get();
+    params.timbreTo = timbreTo->get();
+    params.latchParameters = latchParameters->get();
+    params.releaseOnStop = releaseOnStop->get();
+    params.scaleStep = bendTargetMode->getIndex() == 1 ? 1 : bendTargetMode->getIndex() == 2 ? -1 : 0;
+    params.inputTarget = bendTargetMode->getIndex() == 3 ? InputTarget::pitch
+                         : bendTargetMode->getIndex() == 4 ? InputTarget::chord
+                                                           : InputTarget::none;
+    params.scale = targetScale->getIndex();
+    params.scaleRoot = targetScaleRoot->getIndex();
+    params.targetOffsets = params.justStacking || params.scaleStep != 0 || params.inputTarget != InputTarget::none;
+    params.chordVoicing = chordMemory->getIndex() - 1;
+    params.transientRetrigger = transientRetrigger->get();
+    params.mpeInputMaster = mpeInput->getIndex() == 1 ? 1 : mpeInput->getIndex() == 2 ? 16 : 0;
+    params.sharedPool = sharedPool->get();
+    params.linkGroup = linkGroup->get();
+    params.autoZoneSize = autoZoneSize->get();
+    transientDetector.setThreshold(transientThreshold->get());
+
+    if (params.scaleStep != 0)
+        scaleTargets.build(params.scale, params.scaleRoot, params.scaleStep);
+
+    // Derived state that only depends on the parameters and the sample rate
+    for (auto &zone : zones)
+    {
+        zone.allocator.setRotation(params.rotation);
+        zone.allocator.setStealPolicy(params.stealPolicy);
+        zone.allocator.setNotePriority(params.notePriority);
+    }
+
+    glideInSamples = juce::jmax(1.0f, static_cast<float>(params.glideTime * currentSampleRate));
+    releaseInSamples = juce::jmax(1.0f, static_cast<float>(params.releaseTime * currentSampleRate));
+    stealRampSamples = juce::roundToInt(params.stealRampMs * currentSampleRate / 1000.0);
+    debounceSamples = juce::roundToInt(params.debounceMs * currentSampleRate / 1000.0);
+    controllerIntervalSamples = params.ccMaxRate > 0.0f ? juce::roundToInt(currentSampleRate / params.ccMaxRate) : 0;
+
+    // Values forwarded while the filter was off are long gone downstream
+    auto filterControllers = params.ccHysteresis > 0 || controllerIntervalSamples > 0;
+    if (filterControllers && !controllerFilterActive)
+        resetControllerFilter();
+    controllerFilterActive = filterControllers;
+
+    // 256 curve evaluations, only when a tracking parameter has moved
+    if (trackingChanged)
+    {
+        velocityTracking.build(params.velocityToAmount, params.velocityToTime, params.velocityCurve,
+                               [](int velocity) { return static_cast<float>(velocity - 127) / 127.0f; });
+        keyTracking.build(params.keyToAmount, params.keyToTime, params.keyCurve,
+                          [](int note) { return juce::jlimit(-1.0f, 1.0f, static_cast<float>(note - 60) / 60.0f); });
+    }
+
+    voiceScalingActive = params.velocityToAmount != 0.0f || params.velocityToTime != 0.0f
+                         || params.keyToAmount != 0.0f || params.keyToTime != 0.0f
+                         || params.humanizeAmount != 0.0f || params.humanizeTime != 0.0f;
+    curveBowActive = params.humanizeCurve != 0.0f;
+    pressureScalingActive = params.pressureToAmount != 0.0f;
+    pressureSmoothingSamples = juce::jmax(1.0f, static_cast<float>(params.pressureSmoothingMs * currentSampleRate / 1000.0));
+    receiverSmoothingSamples = static_cast<float>(params.receiverSmoothingMs * currentSampleRate / 1000.0);
+
+    lanes[pressureLaneIndex] = {params.pressureLane, 0xd0, 0, static_cast<float>(params.pressureFrom), static_cast<float>(params.pressureTo)};
+    lanes[timbreLaneIndex] = {params.timbreLane, 0xb0, 74, static_cast<float>(params.timbreFrom), static_cast<float>(params.timbreTo)};
+    lanesActive = (params.pressureLane || params.timbreLane) && qualityLevel < lanesOffLevel;
+
+    // Allow a burst of about 5 ms worth of messages
+    budgetTokensPerSample = params.messageBudget / currentSampleRate;
+    budgetBurst = juce::jmax(1.0, params.messageBudget * 0.005);
+
+    return true;
+}
+
+float PitchBendProcessor::getBendAmountAsFraction() const
+{
+    if (amountUnits->getIndex() == 1)
+        return bendSemitones->get() / static_cast<float>(bendRange->get());
+
+    return bendAmount->get();
+}
+
+bool PitchBendProcessor::updateDurationInSamples(Zone &zone, float duration)
+{
+    if (duration == zone.durationForSamples && currentSampleRate == zone.sampleRateForDuration)
+        return false;
+
+    zone.durationForSamples = duration;
+    zone.sampleRateForDuration = currentSampleRate;
+    zone.durationInSamples = juce::jmax(static_cast<juce::int64>(1), static_cast<juce::int64>(std::llround(duration * currentSampleRate)));
+    return true;
+}
+
+float PitchBendProcessor::getSyncedBendTime()
+{
+    // Keep the last known tempo when the host doesn't report one
+    auto bpm = syncedBpm > 0.0 ? syncedBpm : 120.0;
+
+    if (auto *hostPlayHead = getPlayHead())
+        if (auto position = hostPlayHead->getPosition())
+            if (auto hostBpm = position->getBpm())
+                if (*hostBpm > 0.0)
+                    bpm = *hostBpm;
+
+    auto noteValue = params.syncedNoteValue;
+
+    if (bpm != syncedBpm || noteValue != syncedNoteValue)
+    {
+        syncedBpm = bpm;
+        syncedNoteValue = noteValue;
+        syncedDuration = static_cast<float>(syncedNoteValues[noteValue].quarterNotes * 60.0 / bpm);
+    }
+
+    return syncedDuration;
+}
+
+int PitchBendProcessor::calculateUpdateInterval(const Zone &zone, UpdateMode mode) const
+{
+    double intervalInSamples;
+
+    if (mode == UpdateMode::perBend)
+        intervalInSamples = static_cast<double>(zone.durationInSamples) / params.updatesPerBend;
+    else
+        intervalInSamples = params.updateRateMs * currentSampleRate / 1000.0;
+
+    intervalInSamples = juce::jmax(intervalInSamples, currentSampleRate / params.updateCeilingHz);
+    intervalInSamples *= static_cast<double>(1 << qualityLevel);
+
+    return juce::jmax(1, juce::roundToInt(intervalInSamples));
+}
+
+int PitchBendProcessor::calculateAdaptiveInterval(const Zone &zone, juce::int64 tickSample, float bendTarget,
+                                                  const CurveTable &table, juce::uint32 slotMask) const
+{
+    // Steepest of the given voices, in bend LSBs per sample
+    auto targetStep = sendThreshold + 1.0f; // Just past the send threshold
+    auto durationInSamples = zone.durationInSamples;
+    float maxSlope = 0.0f;
+    float untilNextSegment = std::numeric_limits<float>::max();
+
+    for (auto mask = slotMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = static_cast<size_t>(lowestSetBit(mask));
+
+        // Time in the bend's own clock, which time tracking runs at rate samples per sample
+        auto rate = voiceScalingActive ? voices.inverseTimeScale[slot] : 1.0f;
+        auto target = voiceScalingActive ? voices.amountScale[slot] * bendTarget : bendTarget;
+
+        if (params.targetOffsets)
+            target += voices.targetOffsetCents[slot] * semitoneScale / 100.0f;
+
+        if (pressureScalingActive)
+            target *= 1.0f + params.pressureToAmount * voices.pressureLevel[slot];
+
+        auto gain = std::abs(target) * rate;
+        auto elapsed = static_cast<float>(tickSample - voices.startSample[slot]) * rate;
+
+        if (envelope->numSegments > 1)
+        {
+            // The segment's slope, scaled to a rise over durationInSamples like the plain bend's
+            const auto &timing = zone.envelopeTiming;
+            auto segment = voices.envelopeSegment[slot];
+            auto s = static_cast<size_t>(segment);
+            auto position = elapsed - timing.starts[s];
+
+            if (elapsed >= 0.0f && position <= timing.lengths[s])
+            {
+                const auto &shape = segment > 0 ? *envelope->segments[s].shape : table;
+                auto levelChange = envelope->segments[s].level - envelope->startLevel(segment);
+                auto scale = gain * std::abs(levelChange) * static_cast<float>(durationInSamples) / timing.lengths[s];
+
+                maxSlope = juce::jmax(maxSlope, scale * std::abs(shape.slope(juce::jlimit(0.0f, 1.0f, position / timing.lengths[s]))));
+            }
+
+            if (segment < envelope->numSegments - 1)
+                untilNextSegment = juce::jmin(untilNextSegment, (timing.starts[s + 1] - elapsed) / rate);
+        }
+        else if (elapsed >= 0.0f && elapsed <= static_cast<float>(durationInSamples))
+        {
+            auto progress = elapsed / static_cast<float>(durationInSamples);
+            auto slope = table.slope(progress);
+
+            if (curveBowActive)
+                slope += voices.curveBow[slot] * (1.0f - 2.0f * progress);
+
+            maxSlope = juce::jmax(maxSlope, gain * std::abs(slope));
+        }
+    }
+
+    maxSlope /= static_cast<float>(durationInSamples);
+    maxSlope += vibrato.maxSlope();
+
+    // Layers add the steepest of their own slopes, and like envelope segments aren't backed
+    // off past their start
+    for (size_t layer = 0; layer < static_cast<size_t>(numExtraLayers); ++layer)
+    {
+        const auto &bendLayer = bendLayers[layer];
+        float layerSlope = 0.0f;
+
+        for (auto mask = slotMask; mask != 0; mask &= mask - 1)
+        {
+            auto elapsed = static_cast<float>(tickSample - voices.startSample[static_cast<size_t>(lowestSetBit(mask))]) - bendLayer.delaySamples;
+            auto progress = elapsed * bendLayer.inverseDuration;
+
+            if (elapsed < 0.0f)
+                untilNextSegment = juce::jmin(untilNextSegment, -elapsed);
+            else if (progress <= 1.0f)
+                layerSlope = juce::jmax(layerSlope, std::abs(bendLayer.table->slope(progress)));
+        }
+
+        maxSlope += layerSlope * std::abs(bendLayer.steps) * bendLayer.inverseDuration;
+    }
+
+    // updateRate is the densest spacing; flat stretches back off to 16 times that
+    auto minInterval = calculateUpdateInterval(zone, UpdateMode::fixedRate);
+    auto maxInterval = minInterval * 16;
+
+    // A hold is flat, but the segment after it may not be; don't back off past its start
+    if (untilNextSegment < static_cast<float>(maxInterval))
+        maxInterval = juce::jmax(minInterval, static_cast<int>(std::ceil(untilNextSegment)));
+
+    if (maxSlope <= targetStep / static_cast<float>(maxInterval))
+        return maxInterval;
+
+    return juce::jlimit(minInterval, maxInterval, static_cast<int>(targetStep / maxSlope));
+}
+
+juce::int64 PitchBendProcessor::predictNextChange(const Zone &zone, int slot, juce::int64 tickSample, float bendTarget, float curve) const
+{
+    auto i = static_cast<size_t>(slot);
+    const auto &table = *zone.table;
+
+    // updateRate is still the densest spacing
+    auto soonest = tickSample + calculateUpdateInterval(zone, UpdateMode::fixedRate);
+
+    // Only a plain rise along a table this block holds still has a shape to invert. Envelopes,
+    // bows, glides, vibrato, pressure, latched voices, ramps, morphs, layers, releases and
+    // bends held back by the budget fall back to the fixed rate.
+    auto elapsed = static_cast<float>(tickSample - voices.startSample[i]);
+    auto gliding = params.legato && voices.glideOffset[i] != 0.0f && elapsed < glideInSamples;
+
+    if (envelope->numSegments > 1 || curveBowActive || gliding || vibrato.isActive() || pressureScalingActive || params.latchParameters || zone.rampParameters || table.curve != curve
+        || numExtraLayers > 0 || &table == &morphTable || (((voices.releasingMask | pendingBendMask) >> slot) & 1u) != 0)
+        return soonest;
+
+    // The voice's target and clock, as calculatePitchBends has them
+    auto target = bendTarget;
+    auto rate = 1.0f;
+
+    if (voiceScalingActive)
+    {
+        target *= voices.amountScale[i];
+        rate = voices.inverseTimeScale[i];
+    }
+
+    if (params.targetOffsets)
+        target += voices.targetOffsetCents[i] * semitoneScale / 100.0f;
+
+    // The bend first past the threshold, in the direction it moves. Bends are truncated
+    // toward zero, so on the near side of zero that is one step further out.
+    auto last = static_cast<float>(voices.lastBendValue[i]);
+    auto step = target > 0.0f ? 1.0f : -1.0f;
+    auto threshold = last + step * (std::floor(sendThreshold) + 1.0f);
+    auto edge = threshold * step > 0.0f ? threshold : threshold - step;
+    auto level = target != 0.0f ? (edge - voices.baseBend[i]) / target : 2.0f;
+
+    // Flat, or the bend ends (or saturates) before it moves that far: only its final value
+    // is left to send, when the bend is done, and then nothing until a parameter changes
+    if (level > 1.0f || edge > 8191.0f || edge < -8192.0f)
+    {
+        auto finalBend = static_cast<int>(juce::jlimit(-8192.0f, 8191.0f, voices.baseBend[i] + target));
+
+        if (finalBend == voices.lastBendValue[i])
+            return neverSample;
+
+        level = 1.0f;
+    }
+
+    auto progress = level >= 1.0f ? 1.0f : level > 0.0f ? table.progressFor(level) : 0.0f;
+    auto due = voices.startSample[i] + static_cast<juce::int64>(std::ceil(static_cast<double>(progress) * static_cast<double>(zone.durationInSamples) / rate));
+
+    return juce::jmax(soonest, due);
+}
+
+float PitchBendProcessor::evaluateVoiceBend(const Zone &zone, int slot, juce::int64 tickSample, float bendTarget, float curve, float &level)
+{
+    // One voice of calculatePitchBends, or of calculateReleaseBends, without the shared scratch
+    auto i = static_cast<size_t>(slot);
+    auto elapsed = static_cast<float>(tickSample - voices.startSample[i]);
+    const auto &table = *zone.table;
+
+    if (((voices.releasingMask >> slot) & 1u) != 0)
+    {
+        level = -1.0f;
+
+        if (fixedPointEngineActive())
+            return static_cast<float>(evaluateFixedPointRelease(slot, tickSample, table)) / (1 << FixedPoint::bendFractionBits);
+
+        auto progress = juce::jlimit(0.0f, 1.0f, elapsed / releaseInSamples);
+        return juce::jlimit(-8192.0f, 8191.0f, voices.baseBend[i] + table.evaluate(progress) * params.releaseSemitones * semitoneScale);
+    }
+
+    if (fixedPointEngineActive())
+    {
+        std::int32_t fixedLevel;
+        auto bend = evaluateFixedPointBend(slot, tickSample, juce::roundToInt(bendTarget), table, curve, zone.durationInSamples, fixedLevel);
+        level = static_cast<float>(fixedLevel) / FixedPoint::one;
+        return static_cast<float>(juce::jlimit<juce::int64>(-(8192 << FixedPoint::bendFractionBits), 8191 << FixedPoint::bendFractionBits, bend))
+             / (1 << FixedPoint::bendFractionBits);
+    }
+
+    auto glide = params.legato ? juce::jlimit(0.0f, 1.0f, 1.0f - elapsed / glideInSamples) * voices.glideOffset[i] : 0.0f;
+    auto vibratoBend = vibrato.isActive() ? vibrato.at(elapsed, voices.vibratoPhase[i]) : 0.0f;
+    auto pressure = pressureScalingActive ? 1.0f + params.pressureToAmount * smoothPressure(slot, tickSample) : 1.0f;
+
+    if (params.latchParameters && envelope->numSegments <= 1)
+    {
+        auto progress = juce::jlimit(0.0f, 1.0f, elapsed * voices.latchedInverseDuration[i]);
+        auto voiceCurve = voices.latchedCurve[i];
+        level = table.curve == voiceCurve ? table.evaluate(progress) : CurveKernel(voiceCurve, CurveKernel::Precision::approximate)(progress);
+
+        if (curveBowActive)
+            level += voices.curveBow[i] * (progress - progress * progress);
+
+        return juce::jlimit(-8192.0f, 8191.0f, level * voices.latchedTarget[i] * pressure + voices.baseBend[i] + glide + vibratoBend + sumBendLayers(i, tickSample));
+    }
+
+    if (voiceScalingActive)
+        elapsed *= voices.inverseTimeScale[i];
+
+    auto shape = [&](float progress)
+    {
+        return table.curve == curve ? table.evaluate(progress) : CurveKernel(curve, CurveKernel::Precision::approximate)(progress);
+    };
+
+    if (envelope->numSegments > 1)
+    {
+        const auto &timing = zone.envelopeTiming;
+        auto segment = envelope->findSegment(timing, elapsed, voices.envelopeSegment[i]);
+        auto s = static_cast<size_t>(segment);
+        voices.envelopeSegment[i] = segment;
+
+        auto phase = juce::jlimit(0.0f, 1.0f, (elapsed - timing.starts[s]) / timing.lengths[s]);
+        auto segmentShape = segment > 0 ? envelope->segments[s].shape->evaluate(phase) : shape(phase);
+
+        if (segment == 0 && curveBowActive)
+            segmentShape += voices.curveBow[i] * phase * (1.0f - phase);
+
+        auto from = envelope->startLevel(segment);
+        level = from + (envelope->segments[s].level - from) * segmentShape;
+    }
+    else
+    {
+        auto progress = juce::jlimit(0.0f, 1.0f, elapsed / static_cast<float>(zone.durationInSamples));
+        level = shape(progress);
+
+        if (curveBowActive)
+            level += voices.curveBow[i] * (progress - progress * progress);
+    }
+
+    auto target = voiceScalingActive ? voices.amountScale[i] * bendTarget : bendTarget;
+
+    if (params.targetOffsets)
+        target += voices.targetOffsetCents[i] * semitoneScale / 100.0f;
+
+    return juce::jlimit(-8192.0f, 8191.0f, level * target * pressure + voices.baseBend[i] + glide + vibratoBend + sumBendLayers(i, tickSample));
+}
+
+void PitchBendProcessor::updateBendLayers()
+{
+    // One layer is the plain bend, and the pass skips the layer code altogether
+    numExtraLayers = params.numBendLayers - 1;
+    bendLayersEnd = 0.0f;
+
+    for (size_t layer = 0; layer < static_cast<size_t>(numExtraLayers); ++layer)
+    {
+        const auto &settings = params.layers[layer];
+        auto durationInSamples = juce::jmax(1.0f, settings.time * static_cast<float>(currentSampleRate));
+        auto &bendLayer = bendLayers[layer];
+
+        bendLayer.steps = settings.semitones * semitoneScale;
+        bendLayer.delaySamples = settings.delay * static_cast<float>(currentSampleRate);
+        bendLayer.inverseDuration = 1.0f / durationInSamples;
+        bendLayer.curve = settings.curve;
+        bendLayer.table = activeConfig->layerTables[layer].get();
+        bendLayersEnd = juce::jmax(bendLayersEnd, bendLayer.delaySamples + durationInSamples);
+    }
+}
+
+float PitchBendProcessor::sumBendLayers(size_t slot, juce::int64 tickSample) const
+{
+    auto elapsed = static_cast<float>(tickSample - voices.startSample[slot]);
+    float sum = 0.0f;
+
+    for (size_t layer = 0; layer < static_cast<size_t>(numExtraLayers); ++layer)
+    {
+        const auto &bendLayer = bendLayers[layer];
+        auto progress = juce::jlimit(0.0f, 1.0f, (elapsed - bendLayer.delaySamples) * bendLayer.inverseDuration);
+        auto level = bendLayer.table->curve == bendLayer.curve ? bendLayer.table->evaluate(progress)
+                                                               : CurveKernel(bendLayer.curve, CurveKernel::Precision::approximate)(progress);
+        sum += level * bendLayer.steps;
+    }
+
+    return sum;
+}
+
+void PitchBendProcessor::addBendLayers(juce::int64 tickSample, int numSlots)
+{
+    constexpr auto allSlots = static_cast<juce::uint32>((1ull << VoiceTable::numSlots) - 1);
+    auto leaders = (allSlots >> (VoiceTable::numSlots - numSlots)) & ~voices.followerMask;
+
+    // Each layer in the same pass as the first: elapsed time, progress, then its own table
+    for (size_t layer = 0; layer < static_cast<size_t>(numExtraLayers); ++layer)
+    {
+        const auto &bendLayer = bendLayers[layer];
+
+        for (int slot = 0; slot < numSlots; ++slot)
+            slotElapsed[static_cast<size_t>(slot)] = static_cast<float>(tickSample - voices.startSample[static_cast<size_t>(slot)]);
+
+        juce::FloatVectorOperations::add(slotElapsed.data(), -bendLayer.delaySamples, numSlots);
+        juce::FloatVectorOperations::multiply(slotElapsed.data(), bendLayer.inverseDuration, numSlots);
+        juce::FloatVectorOperations::clip(slotElapsed.data(), slotElapsed.data(), 0.0f, 1.0f, numSlots);
+
+        if (bendLayer.table->curve == bendLayer.curve)
+        {
+            for (auto mask = leaders; mask != 0; mask &= mask - 1)
+            {
+                auto i = static_cast<size_t>(lowestSetBit(mask));
+                slotElapsed[i] = bendLayer.table->evaluate(slotElapsed[i]);
+            }
+
+            for (auto mask = voices.followerMask; mask != 0; mask &= mask - 1)
+            {
+                auto i = static_cast<size_t>(lowestSetBit(mask));
+                slotElapsed[i] = slotElapsed[static_cast<size_t>(voices.groupLeader[i])];
+            }
+        }
+        else
+        {
+            kernels->shapeCurve(slotElapsed.data(), numSlots, bendLayer.curve);
+        }
+
+        juce::FloatVectorOperations::addWithMultiply(slotValues.data(), slotElapsed.data(), bendLayer.steps, numSlots);
+    }
+}
+
+void PitchBendProcessor::renderBendStreams(juce::uint32 slotMask)
+{
+    for (auto mask = slotMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+        auto i = static_cast<size_t>(slot);
+        auto &zone = zoneForSlot(slot);
+        auto &stream = bendStreams[i];
+        int size = 0;
+
+        for (auto tick = juce::jmax(renderFrom, voices.startSample[i]); tick < renderEnd; ++tick)
+        {
+            auto samplePos = static_cast<int>(tick - sampleClock);
+            auto bendTarget = zone.amount;
+            auto curve = zone.curve;
+
+            if (zone.rampParameters)
+            {
+                auto position = rampPosition(samplePos);
+                bendTarget = zone.startAmount + (zone.amount - zone.startAmount) * position;
+                curve = zone.startCurve + (zone.curve - zone.startCurve) * position;
+            }
+
+            float level;
+            auto exactBend = evaluateVoiceBend(zone, slot, tick, bendTarget * zone.bendScale, curve, level);
+            auto value = static_cast<int>(exactBend);
+
+            // Any change at all goes out
+            if (value != voices.lastBendValue[i])
+            {
+                stream[static_cast<size_t>(size++)] = {samplePos, value, exactBend, 0};
+                voices.lastBendValue[i] = value;
+            }
+
+            for (int lane = 0; lanesSending() && level >= 0.0f && lane < VoiceTable::numLanes; ++lane)
+            {
+                auto &last = voices.lastLaneValue[static_cast<size_t>(lane)][i];
+                auto laneValue = lanes[static_cast<size_t>(lane)].valueAt(level);
+
+                if (lanes[static_cast<size_t>(lane)].enabled && laneValue != last)
+                {
+                    stream[static_cast<size_t>(size++)] = {samplePos, laneValue, 0.0f, lane + 1};
+                    last = laneValue;
+                }
+            }
+        }
+
+        bendStreamSizes[i] = size;
+    }
+}
+
+void PitchBendProcessor::renderBendsUntil(juce::int64 endSample)
+{
+    renderFrom = renderedUntil;
+    renderEnd = endSample;
+
+    if (renderEnd <= renderFrom || voices.activeMask == 0)
+        return;
+
+    renderedUntil = renderEnd;
+    auto activeMask = voices.activeMask;
+
+    // Handing voices to the pool only pays for itself over enough of them and a long enough span
+    if (renderPool != nullptr && juce::countNumberOfBits(activeMask) >= minParallelVoices && renderEnd - renderFrom >= minParallelSpan)
+    {
+        // Voices are dealt out in turn; the last share is rendered here while the pool runs the others
+        std::array<juce::uint32, maxRenderThreads + 1> shares{};
+        auto numShares = renderJobs.size() + 1;
+        size_t next = 0;
+
+        for (auto mask = activeMask; mask != 0; mask &= mask - 1)
+            shares[next++ % numShares] |= 1u << lowestSetBit(mask);
+
+        for (size_t j = 0; j < renderJobs.size(); ++j)
+        {
+            renderJobs[j]->slotMask = shares[j];
+
+            if (shares[j] != 0)
+                renderPool->addJob(renderJobs[j].get(), false);
+        }
+
+        renderBendStreams(shares[numShares - 1]);
+
+        for (size_t j = 0; j < renderJobs.size(); ++j)
+            if (shares[j] != 0)
+                renderPool->waitForJobToFinish(renderJobs[j].get(), -1);
+    }
+    else
+    {
+        renderBendStreams(activeMask);
+    }
+
+    // Merge the streams in time order, lower slots first on the same sample like the grid
+    std::array<int, VoiceTable::numSlots> positions{};
+
+    for (;;)
+    {
+        int best = -1;
+        int bestSample = std::numeric_limits<int>::max();
+
+        for (auto mask = activeMask; mask != 0; mask &= mask - 1)
+        {
+            auto i = static_cast<size_t>(lowestSetBit(mask));
+
+            if (positions[i] < bendStreamSizes[i] && bendStreams[i][static_cast<size_t>(positions[i])].samplePosition < bestSample)
+            {
+                best = static_cast<int>(i);
+                bestSample = bendStreams[i][static_cast<size_t>(positions[i])].samplePosition;
+            }
+        }
+
+        if (best < 0)
+            break;
+
+        const auto &bend = bendStreams[static_cast<size_t>(best)][static_cast<size_t>(positions[static_cast<size_t>(best)]++)];
+
+        if (bend.lane == 0)
+        {
+            sendBend(best, bend.value, bend.exactBend, bend.samplePosition);
+            ++bendsThisBlock;
+        }
+        else
+        {
+            sendLaneValue(bend.lane - 1, best, bend.value, bend.samplePosition);
+        }
+    }
+}
+
+void PitchBendProcessor::evaluateEnvelope(const BendEnvelope::Timing &timing, const CurveTable &table, float curve)
+{
+    // For the first segment while its table is on its way
+    const CurveKernel kernel(curve, CurveKernel::Precision::approximate);
+
+    // Inactive slots keep their elapsed times and are masked out by the caller; followers
+    // copy their leaders after
+    for (auto mask = voices.activeMask & ~voices.followerMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = static_cast<size_t>(lowestSetBit(mask));
+        auto elapsed = slotValues[slot];
+        auto segment = envelope->findSegment(timing, elapsed, voices.envelopeSegment[slot]);
+        auto s = static_cast<size_t>(segment);
+        voices.envelopeSegment[slot] = segment;
+
+        // Past the last segment its level holds
+        auto phase = juce::jlimit(0.0f, 1.0f, (elapsed - timing.starts[s]) / timing.lengths[s]);
+        auto shape = segment > 0 ? envelope->segments[s].shape->evaluate(phase)
+                   : table.curve == curve ? table.evaluate(phase)
+                                          : kernel(phase);
+
+        if (segment == 0 && curveBowActive)
+            shape += voices.curveBow[slot] * phase * (1.0f - phase);
+        auto from = envelope->startLevel(segment);
+
+        slotValues[slot] = from + (envelope->segments[s].level - from) * shape;
+    }
+
+    for (auto mask = voices.followerMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = static_cast<size_t>(lowestSetBit(mask));
+        auto leader = static_cast<size_t>(voices.groupLeader[slot]);
+        slotValues[slot] = slotValues[leader];
+        voices.envelopeSegment[slot] = voices.envelopeSegment[leader];
+    }
+}
+
+void PitchBendProcessor::copyGroupValues()
+{
+    for (auto mask = voices.followerMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = static_cast<size_t>(lowestSetBit(mask));
+        slotValues[slot] = slotValues[static_cast<size_t>(voices.groupLeader[slot])];
+    }
+}
+
+juce::uint32 PitchBendProcessor::calculatePitchBends(juce::int64 tickSample, float bendTarget, float curve, const CurveTable &table,
+                                                     juce::int64 durationInSamples, const BendEnvelope::Timing &envelopeTiming,
+                                                     std::array<int, VoiceTable::numSlots> &bendValues)
+{
+    if (fixedPointEngineActive())
+        return calculateFixedPointBends(tickSample, bendTarget, curve, table, durationInSamples, bendValues);
+
+    return (this->*bendPass)(tickSample, bendTarget, curve, table, durationInSamples, envelopeTiming, bendValues);
+}
+
+void PitchBendProcessor::selectBendPass()
+{
+    // Voices only ever take the zones' slots, and voices already sounding keep theirs until
+    // they end, so together they give the slots a pass has to cover
+    auto usedMask = zones[lowerZone].slotMask | zones[upperZone].slotMask | voices.activeMask;
+    int numUsed = 0;
+
+    while (numUsed < VoiceTable::numSlots && (usedMask >> numUsed) != 0)
+        ++numUsed;
+
+    if (numUsed <= 4)
+        bendPass = &PitchBendProcessor::calculateSlotBends<4>;
+    else if (numUsed <= 8)
+        bendPass = &PitchBendProcessor::calculateSlotBends<8>;
+    else if (numUsed <= 12)
+        bendPass = &PitchBendProcessor::calculateSlotBends<12>;
+    else
+        bendPass = &PitchBendProcessor::calculateSlotBends<VoiceTable::numSlots>;
+}
+
+template <int numSlots>
+juce::uint32 PitchBendProcessor::calculateSlotBends(juce::int64 tickSample, float bendTarget, float curve, const CurveTable &table,
+                                                    juce::int64 durationInSamples, const BendEnvelope::Timing &envelopeTiming,
+                                                    std::array<int, VoiceTable::numSlots> &bendValues)
+{
+    juce::uint32 inWindowMask = 0;
+
+    // Elapsed time per slot; past the bend time the target holds, so bends held back or
+    // stopped short of it still go out once. inactive slots are evaluated too and masked out at the end
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        auto elapsed = tickSample - voices.startSample[static_cast<size_t>(slot)];
+        slotValues[static_cast<size_t>(slot)] = static_cast<float>(elapsed);
+        inWindowMask |= static_cast<juce::uint32>(elapsed >= 0) << slot;
+    }
+
+    // Legato glides fade each voice's glide offset out over glideTime from its start
+    if (params.legato)
+    {
+        juce::FloatVectorOperations::multiply(slotGlides.data(), slotValues.data(), -1.0f / glideInSamples, numSlots);
+        juce::FloatVectorOperations::add(slotGlides.data(), 1.0f, numSlots);
+        juce::FloatVectorOperations::clip(slotGlides.data(), slotGlides.data(), 0.0f, 1.0f, numSlots);
+        juce::FloatVectorOperations::multiply(slotGlides.data(), voices.glideOffset.data(), numSlots);
+    }
+
+    // Latched voices rise over their own duration to their own target, so one multiply takes
+    // them straight to progress; ramps and parameter moves since their note-on pass them by
+    auto latched = params.latchParameters && envelope->numSegments <= 1;
+
+    // Time tracking stretches each voice's bend by running its clock slower or faster
+    if (latched)
+        juce::FloatVectorOperations::multiply(slotValues.data(), voices.latchedInverseDuration.data(), numSlots);
+    else if (voiceScalingActive)
+        juce::FloatVectorOperations::multiply(slotValues.data(), voices.inverseTimeScale.data(), numSlots);
+
+    // Voices past the end of their bend and glide hold their final value from here on
+    auto bendEnd = latched                    ? 1.0f
+                 : envelope->numSegments > 1 ? envelopeTiming.starts[static_cast<size_t>(envelope->numSegments)]
+                                             : static_cast<float>(durationInSamples);
+    juce::uint32 settledMask = 0;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        auto i = static_cast<size_t>(slot);
+        settledMask |= static_cast<juce::uint32>(slotValues[i] >= bendEnd && (!params.legato || slotGlides[i] == 0.0f)) << slot;
+    }
+
+    if (vibrato.isActive())
+        settledMask = 0;
+
+    // Layers running past the bend hold their voices unsettled until they end too
+    if (numExtraLayers > 0)
+    {
+        for (int slot = 0; slot < numSlots; ++slot)
+        {
+            auto elapsed = static_cast<float>(tickSample - voices.startSample[static_cast<size_t>(slot)]);
+            settledMask &= ~(static_cast<juce::uint32>(elapsed < bendLayersEnd) << slot);
+        }
+    }
+
+    if (envelope->numSegments > 1)
+    {
+        evaluateEnvelope(envelopeTiming, table, curve);
+    }
+    else
+    {
+        if (!latched)
+            juce::FloatVectorOperations::multiply(slotValues.data(), 1.0f / static_cast<float>(durationInSamples), numSlots);
+
+        juce::FloatVectorOperations::clip(slotValues.data(), slotValues.data(), 0.0f, 1.0f, numSlots);
+
+        // Humanized curves bow by curveBow * p * (1 - p), which leaves both ends in place
+        if (curveBowActive)
+        {
+            juce::FloatVectorOperations::multiply(slotBows.data(), slotValues.data(), slotValues.data(), numSlots);
+            juce::FloatVectorOperations::subtract(slotBows.data(), slotValues.data(), slotBows.data(), numSlots);
+            juce::FloatVectorOperations::multiply(slotBows.data(), voices.curveBow.data(), numSlots);
+        }
+
+        // Apply curve; until the table for a new curve value arrives, evaluate it directly.
+        // Latched voices whose curve the zone has moved on from are evaluated directly too.
+        // Group followers are skipped where the voices are evaluated one by one, and copy
+        // their leaders' values after.
+        if (latched)
+        {
+            for (auto mask = voices.activeMask & ~voices.followerMask; mask != 0; mask &= mask - 1)
+            {
+                auto i = static_cast<size_t>(lowestSetBit(mask));
+                auto voiceCurve = voices.latchedCurve[i];
+
+                slotValues[i] = table.curve == voiceCurve ? table.evaluate(slotValues[i])
+                                                          : CurveKernel(voiceCurve, CurveKernel::Precision::approximate)(slotValues[i]);
+            }
+        }
+        else if (table.curve == curve)
+        {
+            constexpr auto passMask = static_cast<juce::uint32>((1ull << numSlots) - 1);
+
+            for (auto mask = passMask & ~voices.followerMask; mask != 0; mask &= mask - 1)
+            {
+                auto i = static_cast<size_t>(lowestSetBit(mask));
+                slotValues[i] = table.evaluate(slotValues[i]);
+            }
+        }
+        else
+        {
+            kernels->shapeCurve(slotValues.data(), numSlots, curve);
+        }
+
+        copyGroupValues();
+
+        if (curveBowActive)
+            juce::FloatVectorOperations::add(slotValues.data(), slotBows.data(), numSlots);
+    }
+
+    if (lanesActive)
+        std::copy_n(slotValues.begin(), numSlots, slotLevels.begin());
+
+    // Pitch bend range: -8192 to +8191; targets past the receiver's range saturate at its top
+    if (latched)
+    {
+        juce::FloatVectorOperations::multiply(slotValues.data(), voices.latchedTarget.data(), numSlots);
+    }
+    else if (voiceScalingActive)
+    {
+        if (params.targetOffsets)
+            juce::FloatVectorOperations::multiply(slotTargets.data(), voices.targetOffsetCents.data(), semitoneScale / 100.0f, numSlots);
+        else
+            juce::FloatVectorOperations::clear(slotTargets.data(), numSlots);
+
+        juce::FloatVectorOperations::addWithMultiply(slotTargets.data(), voices.amountScale.data(), bendTarget, numSlots);
+        juce::FloatVectorOperations::multiply(slotValues.data(), slotTargets.data(), numSlots);
+    }
+    else if (params.targetOffsets)
+    {
+        juce::FloatVectorOperations::multiply(slotTargets.data(), voices.targetOffsetCents.data(), semitoneScale / 100.0f, numSlots);
+        juce::FloatVectorOperations::add(slotTargets.data(), bendTarget, numSlots);
+        juce::FloatVectorOperations::multiply(slotValues.data(), slotTargets.data(), numSlots);
+    }
+    else
+    {
+        juce::FloatVectorOperations::multiply(slotValues.data(), bendTarget, numSlots);
+    }
+
+    // Pressure deepens each rise (or with a negative depth, flattens it) as it moves; the
+    // levels glide in the same pass, every slot up to this tick
+    if (pressureScalingActive)
+    {
+        for (int slot = 0; slot < numSlots; ++slot)
+            smoothPressure(slot, tickSample);
+
+        juce::FloatVectorOperations::multiply(slotTargets.data(), voices.pressureLevel.data(), params.pressureToAmount, numSlots);
+        juce::FloatVectorOperations::add(slotTargets.data(), 1.0f, numSlots);
+        juce::FloatVectorOperations::multiply(slotValues.data(), slotTargets.data(), numSlots);
+    }
+
+    // The bend rises from each voice's tuning offset
+    juce::FloatVectorOperations::add(slotValues.data(), voices.baseBend.data(), numSlots);
+
+    if (params.legato)
+        juce::FloatVectorOperations::add(slotValues.data(), slotGlides.data(), numSlots);
+
+    // Vibrato rides on top, on the voices' own clocks rather than the time-tracked ones
+    if (vibrato.isActive())
+    {
+        for (int slot = 0; slot < numSlots; ++slot)
+            slotElapsed[static_cast<size_t>(slot)] = static_cast<float>(tickSample - voices.startSample[static_cast<size_t>(slot)]);
+
+        kernels->applyVibrato(vibrato, slotElapsed.data(), voices.vibratoPhase.data(), slotValues.data(), numSlots);
+    }
+
+    if (numExtraLayers > 0)
+        addBendLayers(tickSample, numSlots);
+
+    juce::FloatVectorOperations::clip(slotValues.data(), slotValues.data(), -8192.0f, 8191.0f, numSlots);
+
+    if (receiverSmoothingSamples > 0.0f)
+        shapeBends(tickSample);
+
+    juce::uint32 changedMask = 0;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        auto i = static_cast<size_t>(slot);
+        bendValues[i] = static_cast<int>(slotValues[i]);
+
+        // Only send if value changed significantly, except that a settled bend always ends
+        // exactly on its target, however close the value sent before it was
+        auto change = std::abs(bendValues[i] - voices.lastBendValue[i]);
+        changedMask |= static_cast<juce::uint32>(change > sendThreshold || (change != 0 && ((settledMask >> slot) & 1u) != 0)) << slot;
+    }
+
+    return changedMask & inWindowMask & voices.activeMask;
+}
+
+bool PitchBendProcessor::fixedPointEngineActive() const
+{
+    return params.fixedPoint && envelope->numSegments <= 1 && !params.latchParameters && !voiceScalingActive && !curveBowActive
+           && !pressureScalingActive && !vibrato.isActive() && receiverSmoothingSamples == 0.0f && numExtraLayers == 0;
+}
+
+juce::int64 PitchBendProcessor::evaluateFixedPointBend(int slot, juce::int64 tickSample, int targetSteps, const CurveTable &table,
+                                                       float curve, juce::int64 durationInSamples, std::int32_t &level) const
+{
+    constexpr int fractionBits = FixedPoint::bendFractionBits;
+    auto i = static_cast<size_t>(slot);
+    auto elapsed = tickSample - voices.startSample[i];
+    auto progress = FixedPoint::progress(elapsed, durationInSamples);
+
+    // Until the table for a new curve value arrives, the shape is worked out directly
+    level = table.curve == curve ? table.evaluateFixed(progress)
+                                 : FixedPoint::shape(static_cast<std::int32_t>(progress << (FixedPoint::levelBits - FixedPoint::progressBits)),
+                                                     FixedPoint::exponentFor(curve), curve >= 0.0f);
+
+    auto target = static_cast<juce::int64>(targetSteps);
+
+    if (params.targetOffsets)
+        target += juce::roundToInt(voices.targetOffsetCents[i] * semitoneScale / 100.0f);
+
+    auto bend = (level * target) >> (FixedPoint::levelBits - fractionBits);
+    bend += juce::roundToInt(voices.baseBend[i] * (1 << fractionBits));
+
+    // Legato glides fade each voice's glide offset out over glideTime from its start
+    if (params.legato && voices.glideOffset[i] != 0.0f)
+    {
+        auto glideSamples = static_cast<juce::int64>(juce::jmax(1, juce::roundToInt(glideInSamples)));
+        auto remaining = glideSamples - juce::jlimit<juce::int64>(0, glideSamples, elapsed);
+        bend += juce::roundToInt(voices.glideOffset[i] * (1 << fractionBits)) * remaining / glideSamples;
+    }
+
+    return bend;
+}
+
+juce::int64 PitchBendProcessor::evaluateFixedPointRelease(int slot, juce::int64 tickSample, const CurveTable &table) const
+{
+    constexpr int fractionBits = FixedPoint::bendFractionBits;
+    auto i = static_cast<size_t>(slot);
+    auto releaseSamples = static_cast<juce::int64>(juce::jmax(1, juce::roundToInt(releaseInSamples)));
+    auto level = table.evaluateFixed(FixedPoint::progress(tickSample - voices.startSample[i], releaseSamples));
+    auto releaseSteps = static_cast<juce::int64>(juce::roundToInt(params.releaseSemitones * semitoneScale));
+
+    auto bend = ((level * releaseSteps) >> (FixedPoint::levelBits - fractionBits)) + juce::roundToInt(voices.baseBend[i] * (1 << fractionBits));
+    return juce::jlimit<juce::int64>(-(8192 << fractionBits), 8191 << fractionBits, bend);
+}
+
+juce::uint32 PitchBendProcessor::calculateFixedPointBends(juce::int64 tickSample, float bendTarget, float curve, const CurveTable &table,
+                                                          juce::int64 durationInSamples, std::array<int, VoiceTable::numSlots> &bendValues)
+{
+    constexpr int fractionBits = FixedPoint::bendFractionBits;
+    auto targetSteps = juce::roundToInt(bendTarget);
+    auto glideSamples = static_cast<juce::int64>(juce::jmax(1, juce::roundToInt(glideInSamples)));
+    juce::uint32 inWindowMask = 0;
+    juce::uint32 changedMask = 0;
+
+    // Only active voices: the float engine's pass over every slot is for the vector operations
+    for (auto mask = voices.activeMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+        auto i = static_cast<size_t>(slot);
+        auto elapsed = tickSample - voices.startSample[i];
+
+        std::int32_t level;
+        auto bend = juce::jlimit<juce::int64>(-(8192 << fractionBits), 8191 << fractionBits,
+                                              evaluateFixedPointBend(slot, tickSample, targetSteps, table, curve, durationInSamples, level));
+
+        // Truncated toward zero, as the float engine's bends are
+        bendValues[i] = static_cast<int>(bend / (1 << fractionBits));
+        slotValues[i] = static_cast<float>(bend) / (1 << fractionBits);
+
+        if (lanesActive)
+            slotLevels[i] = static_cast<float>(level) / FixedPoint::one;
+
+        auto settled = elapsed >= durationInSamples && (!params.legato || voices.glideOffset[i] == 0.0f || elapsed >= glideSamples);
+        auto change = std::abs(bendValues[i] - voices.lastBendValue[i]);
+
+        inWindowMask |= static_cast<juce::uint32>(elapsed >= 0) << slot;
+        changedMask |= static_cast<juce::uint32>(change > sendThreshold || (change != 0 && settled)) << slot;
+    }
+
+    return changedMask & inWindowMask;
+}
+
+void PitchBendProcessor::shapeBends(juce::int64 tickSample)
+{
+    constexpr int numSlots = VoiceTable::numSlots;
+    std::copy(slotValues.begin(), slotValues.end(), slotCurves.begin());
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        auto i = static_cast<size_t>(slot);
+        auto held = static_cast<float>(voices.lastBendValue[i]);
+        auto interval = static_cast<float>(tickSample - voices.heardSample[i]);
+
+        if (interval <= 0.0f)
+        {
+            slotHeard[i] = voices.heardBend[i];
+            continue;
+        }
+
+        // The receiver has been gliding toward the bend it holds since the last one went out
+        auto decay = std::exp(-interval / receiverSmoothingSamples);
+        auto heard = held + (voices.heardBend[i] - held) * decay;
+        slotHeard[i] = heard;
+
+        // Over another interval like the last, a bend of x takes the receiver to
+        // x + (heard - x) * decay; solved for x that lands on the curve's next value. Close
+        // updates against long smoothing would call for huge overshoots, so the bend goes at
+        // most as far past the curve as the receiver is short of it.
+        auto next = 2.0f * slotCurves[i] - voices.shapedFrom[i];
+        auto planned = (next - heard * decay) / (1.0f - decay);
+        auto reach = std::abs(next - heard);
+
+        slotValues[i] = juce::jlimit(-8192.0f, 8191.0f, juce::jlimit(next - reach, next + reach, planned));
+    }
+}
+
+void PitchBendProcessor::noteBendsHeard(juce::uint32 slotMask, juce::int64 tickSample)
+{
+    for (auto mask = slotMask; mask != 0; mask &= mask - 1)
+    {
+        auto i = static_cast<size_t>(lowestSetBit(mask));
+        voices.heardBend[i] = slotHeard[i];
+        voices.heardSample[i] = tickSample;
+        voices.shapedFrom[i] = slotCurves[i];
+    }
+}
+
+int PitchBendProcessor::nextStrumDelay(const InputEvent *position, const InputEvent *end)
+{
+    auto samplePos = position->samplePosition;
+
+    // First note-on of a chord: collect every note-on on this sample and rank them
+    if (samplePos != strumChordPosition)
+    {
+        strumChordPosition = samplePos;
+        strumChordSize = 0;
+        strumChordNext = 0;
+
+        for (auto *it = position; it != end && it->samplePosition == samplePos && strumChordSize < maxStrumChord; ++it)
+            if (it->kind == InputEvent::Kind::noteOn)
+                strumChordNotes[static_cast<size_t>(strumChordSize++)] = it->note;
+
+        std::array<juce::uint8, maxStrumChord> order;
+        auto orderEnd = order.begin() + strumChordSize;
+        std::iota(order.begin(), orderEnd, juce::uint8{0});
+
+        if (params.strumMode == StrumMode::random)
+        {
+            for (int i = strumChordSize - 1; i > 0; --i)
+                std::swap(order[static_cast<size_t>(i)], order[static_cast<size_t>(strumRandom.nextInt(i + 1))]);
+        }
+        else
+        {
+            auto up = params.strumMode == StrumMode::up;
+
+            std::sort(order.begin(), orderEnd, [&](juce::uint8 a, juce::uint8 b)
+            {
+                auto noteA = strumChordNotes[a], noteB = strumChordNotes[b];
+                return noteA != noteB ? (noteA < noteB) == up : a < b;
+            });
+        }
+
+        for (int rank = 0; rank < strumChordSize; ++rank)
+            strumChordRanks[order[static_cast<size_t>(rank)]] = static_cast<juce::uint8>(rank);
+    }
+
+    if (strumChordSize < 2 || strumChordNext >= strumChordSize)
+        return 0;
+
+    // strumSpread is the time from the first note of the chord to the last
+    auto rank = strumChordRanks[static_cast<size_t>(strumChordNext++)];
+    auto spreadInSamples = params.strumSpreadMs * currentSampleRate / 1000.0;
+
+    return juce::roundToInt(rank * spreadInSamples / (strumChordSize - 1));
+}
+
+int PitchBendProcessor::nextLegatoSlot(const InputEvent *position, const InputEvent *end)
+{
+    auto samplePos = position->samplePosition;
+
+    // First note-on of a chord: match all of its notes against the held voices at once.
+    // Strummed notes are left out, they are matched when their turn comes.
+    if (samplePos != legatoChordPosition)
+    {
+        std::array<int, VoiceMatcher::maxNotes> notes;
+        legatoChordPosition = samplePos;
+        legatoChordSize = 0;
+        legatoChordNext = 0;
+
+        for (auto *it = position; it != end && it->samplePosition == samplePos && legatoChordSize < VoiceMatcher::maxNotes; ++it)
+            if (it->kind == InputEvent::Kind::noteOn)
+                notes[static_cast<size_t>(legatoChordSize++)] = it->note;
+
+        planLegato(notes.data(), legatoChordSize, sampleClock + samplePos, legatoSlots.data());
+    }
+
+    if (legatoChordNext >= legatoChordSize)
+        return VoiceTable::noSlot;
+
+    return legatoSlots[static_cast<size_t>(legatoChordNext++)];
+}
+
+void PitchBendProcessor::planLegato(const int *notes, int numNotes, juce::int64 startSample, juce::int8 *slots) const
+{
+    for (int i = 0; i < numNotes; ++i)
+        slots[i] = VoiceTable::noSlot;
+
+    // Voices never move between zones, so each zone is matched on its own
+    for (size_t z = 0; z < zones.size(); ++z)
+    {
+        std::array<int, VoiceMatcher::maxNotes> zoneNotes, noteIndices, heldNotesInZone, heldSlots, assignment;
+        int numZoneNotes = 0, numHeld = 0;
+
+        for (int i = 0; i < numNotes; ++i)
+        {
+            auto upper = activeZoneSplit && notes[i] >= params.splitNote;
+
+            if (static_cast<size_t>(upper ? upperZone : lowerZone) == z)
+            {
+                noteIndices[static_cast<size_t>(numZoneNotes)] = i;
+                zoneNotes[static_cast<size_t>(numZoneNotes++)] = notes[i];
+            }
+        }
+
+        for (auto mask = voices.activeMask & ~(voices.releasingMask | voices.sustainedMask) & zones[z].slotMask; mask != 0; mask &= mask - 1)
+        {
+            auto slot = lowestSetBit(mask);
+
+            if (voices.startSample[static_cast<size_t>(slot)] < startSample)
+            {
+                heldSlots[static_cast<size_t>(numHeld)] = slot;
+                heldNotesInZone[static_cast<size_t>(numHeld++)] = voices.inputNote[static_cast<size_t>(slot)];
+            }
+        }
+
+        VoiceMatcher::match(zoneNotes.data(), numZoneNotes, heldNotesInZone.data(), numHeld, assignment.data());
+
+        for (int i = 0; i < numZoneNotes; ++i)
+            if (assignment[static_cast<size_t>(i)] >= 0)
+                slots[noteIndices[static_cast<size_t>(i)]] = static_cast<juce::int8>(heldSlots[static_cast<size_t>(assignment[static_cast<size_t>(i)])]);
+    }
+}
+
+// Nothing here touches audio, so both precisions only clear their buffer (free when the host
+// has already marked it clear, and the MIDI effect build has no channels) and share the MIDI
+// processing; hosts running in double precision need no conversion buffers for us
+template <typename SampleType>
+void PitchBendProcessor::detectTransient(const juce::AudioBuffer<SampleType> &buffer)
+{
+    // Turned on as of the last block's snapshot. An onset not used by the end of its block
+    // is forgotten.
+    auto onset = params.transientRetrigger ? transientDetector.process(buffer.getArrayOfReadPointers(), getTotalNumInputChannels(), buffer.getNumSamples()) : -1;
+    transientSample = onset >= 0 ? sampleClock + onset : neverSample;
+}
+
+template <typename SampleType>
+void PitchBendProcessor::renderPreview(juce::AudioBuffer<SampleType> &buffer, const juce::MidiBuffer &midiMessages)
+{
+    if (!params.previewSynth || buffer.getNumChannels() == 0)
+    {
+        if (previewActive)
+            preview.reset();
+
+        previewActive = false;
+        return;
+    }
+
+    // Outside MPE the notes stay on their input channels; MIDI 2.0 per-note bends go out as
+    // UMP and aren't heard
+    juce::MPEZoneLayout layout;
+    const auto &lower = zones[lowerZone].mpeZone;
+    const auto &upper = zones[upperZone].mpeZone;
+    layout.setLowerZone(lower.numMemberChannels, lower.perNotePitchbendRange, lower.masterPitchbendRange);
+    layout.setUpperZone(upper.numMemberChannels, upper.perNotePitchbendRange, upper.masterPitchbendRange);
+
+    previewActive = true;
+    preview.follow(activeOutputMode != OutputMode::mpe, params.bendRange, layout);
+    preview.render(buffer, midiMessages);
+}
+
+void PitchBendProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages)
+{
+    pitchTracker.push(buffer.getArrayOfReadPointers(), getTotalNumInputChannels(), buffer.getNumSamples());
+    detectTransient(buffer);
+    buffer.clear();
+    processMidi(buffer.getNumSamples(), midiMessages);
+    renderPreview(buffer, midiMessages);
+}
+
+void PitchBendProcessor::processBlock(juce::AudioBuffer<double> &buffer, juce::MidiBuffer &midiMessages)
+{
+    pitchTracker.push(buffer.getArrayOfReadPointers(), getTotalNumInputChannels(), buffer.getNumSamples());
+    detectTransient(buffer);
+    buffer.clear();
+    processMidi(buffer.getNumSamples(), midiMessages);
+    renderPreview(buffer, midiMessages);
+}
+
+void PitchBendProcessor::processBlockBypassed(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages)
+{
+    buffer.clear();
+    processBypassedMidi(buffer.getNumSamples(), midiMessages);
+}
+
+void PitchBendProcessor::processBlockBypassed(juce::AudioBuffer<double> &buffer, juce::MidiBuffer &midiMessages)
+{
+    buffer.clear();
+    processBypassedMidi(buffer.getNumSamples(), midiMessages);
+}
+
+void PitchBendProcessor::handleInputMessage(const InputEvent &event)
+{
+    // Read from the bytes in the input buffer; the status byte of a channel message carries
+    // its type and channel
+    auto status = event.data[0] & 0xf0;
+    auto isChannelMessage = event.data[0] < 0xf0;
+    auto controller = status == 0xb0 && event.numBytes >= 3 ? event.data[1] : -1;
+    auto learnTarget = controller >= 0 ? activeConfig->midiLearn.targets[event.data[0] & 0x0f][static_cast<size_t>(controller)] : MidiLearnTable::noTarget;
+
+    // Followed whatever happens to the message itself
+    if (status == 0xa0 || status == 0xd0)
+        trackPressure(event);
+
+    if (controller >= 0 && control.midiLearnArmed.load(std::memory_order_relaxed) >= 0)
+    {
+        // Caught for the armed parameter and consumed; the timer maps it
+        auto target = control.midiLearnArmed.exchange(-1);
+
+        if (target >= 0)
+        {
+            counters.learnedController = target << 11 | (event.data[0] & 0x0f) << 7 | controller;
+            counters.learnedValues[static_cast<size_t>(target)] = static_cast<float>(event.data[2]) / 127.0f;
+        }
+    }
+    else if (learnTarget != MidiLearnTable::noTarget)
+    {
+        // Consumed, so controller floods meant for us never reach the synth downstream
+        counters.learnedValues[static_cast<size_t>(learnTarget)].store(static_cast<float>(event.data[2]) / 127.0f, std::memory_order_relaxed);
+    }
+    else if (params.mpeInputMaster != 0 && isChannelMessage && decodeMpeInput(event))
+    {
+        // The player's bend is carried in the voices' own
+    }
+    else if (params.morphEnabled && isChannelMessage && controller == params.morphController)
+    {
+        // Consumed; the new position is blended in at the start of the next block
+        morphPosition = static_cast<float>(event.data[2]) / 127.0f;
+    }
+    else if (auto *preset = isChannelMessage && status == 0xc0 && event.numBytes >= 2 ? presetBank->getPreset(event.data[1]) : nullptr)
+    {
+        // Consumed rather than forwarded so the synth downstream keeps its patch. The
+        // preset takes over from the next block; the parameters catch up on the timer.
+        pendingPreset = preset;
+        control.currentProgram = event.data[1];
+        control.requestedProgram = control.currentProgram.load();
+        control.parameterGeneration.fetch_add(1, std::memory_order_release);
+    }
+    else if (isChannelMessage && controller == 64 && ((params.scopeChannels >> (event.data[0] & 0x0f)) & 1) != 0)
+    {
+        setSustainPedal((event.data[0] & 0x0f) + 1, event.data[2] >= 64, event.samplePosition);
+
+        // Keys outside the bent range sound on the input channel, and are held there too
+        if (params.scopeLowNote > 0 || params.scopeHighNote < 127)
+            addOutputEvent(event.data, event.numBytes, event.samplePosition);
+    }
+    else if (event.data[0] == 0xf0 && receiverDiscovery.consume(event.data, event.numBytes))
+    {
+        // MIDI-CI, taken by the Auto output mode's discovery
+    }
+    else if (activeOutputMode != OutputMode::mpe || !isChannelMessage || !remapExpression(event))
+    {
+        // Pass through other messages; per-note expression was remapped to its voices
+        addOutputEvent(event.data, event.numBytes, event.samplePosition);
+    }
+}
+
+void PitchBendProcessor::addUmpInput(int samplePosition, const juce::uint32 *words, int numWords)
+{
+    // Runs decoded in earlier blocks make room first
+    if (umpInputCursor != 0)
+    {
+        auto consumed = umpInputCursor < umpInputRuns.size() ? umpInputRuns[umpInputCursor].begin : static_cast<int>(umpInputWords.size());
+        umpInputWords.erase(umpInputWords.begin(), umpInputWords.begin() + consumed);
+        umpInputRuns.erase(umpInputRuns.begin(), umpInputRuns.begin() + static_cast<std::ptrdiff_t>(umpInputCursor));
+        umpInputCursor = 0;
+
+        for (auto &run : umpInputRuns)
+        {
+            run.begin -= consumed;
+            run.end -= consumed;
+        }
+    }
+
+    if (numWords <= 0 || umpInputRuns.size() == umpInputRuns.capacity()
+        || umpInputWords.size() + static_cast<size_t>(numWords) > umpInputWords.capacity())
+        return;
+
+    // Delayed with the MIDI input, so the two stay in step
+    auto sample = sampleClock + juce::jmax(0, samplePosition) + control.lookaheadSamples.load(std::memory_order_acquire);
+    auto begin = static_cast<int>(umpInputWords.size());
+
+    umpInputWords.insert(umpInputWords.end(), words, words + numWords);
+    umpInputRuns.push_back({sample, begin, begin + numWords});
+}
+
+void PitchBendProcessor::addMidiInput(int bus, const juce::MidiBuffer &events)
+{
+    // Bus 0 is the host's MidiBuffer
+    if (bus <= 0 || bus >= maxMidiInputBuses)
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto &queue = inputBusQueues[static_cast<size_t>(bus - 1)];
+
+    // Events decoded in earlier blocks make room first
+    if (queue.cursor != 0)
+    {
+        auto consumed = queue.cursor < queue.events.size() ? queue.events[queue.cursor].begin : static_cast<int>(queue.bytes.size());
+        queue.bytes.erase(queue.bytes.begin(), queue.bytes.begin() + consumed);
+        queue.events.erase(queue.events.begin(), queue.events.begin() + static_cast<std::ptrdiff_t>(queue.cursor));
+        queue.cursor = 0;
+
+        for (auto &event : queue.events)
+            event.begin -= consumed;
+    }
+
+    // Delayed with the host's input, so the buses stay in step
+    auto blockStart = sampleClock + control.lookaheadSamples.load(std::memory_order_acquire);
+
+    for (const auto metadata : events)
+    {
+        if (queue.events.size() == queue.events.capacity() || queue.bytes.size() + static_cast<size_t>(metadata.numBytes) > queue.bytes.capacity())
+            return;
+
+        auto begin = static_cast<int>(queue.bytes.size());
+        queue.bytes.insert(queue.bytes.end(), metadata.data, metadata.data + metadata.numBytes);
+        queue.events.push_back({blockStart + juce::jmax(0, metadata.samplePosition), begin, metadata.numBytes});
+    }
+}
+
+void PitchBendProcessor::setMidiInputChannels(int bus, juce::uint16 channels)
+{
+    jassert(bus >= 0 && bus < maxMidiInputBuses);
+    auto shift = static_cast<juce::uint64>(bus) * 16;
+    auto current = inputBusChannels.load(std::memory_order_relaxed);
+
+    while (!inputBusChannels.compare_exchange_weak(current, (current & ~(juce::uint64{0xffff} << shift)) | (juce::uint64{channels} << shift),
+                                                   std::memory_order_relaxed))
+    {
+    }
+}
+
+juce::uint16 PitchBendProcessor::getMidiInputChannels(int bus) const
+{
+    jassert(bus >= 0 && bus < maxMidiInputBuses);
+    return static_cast<juce::uint16>(inputBusChannels.load(std::memory_order_relaxed) >> (bus * 16));
+}
+
+bool PitchBendProcessor::hasBusInput() const
+{
+    for (const auto &queue : inputBusQueues)
+        if (queue.cursor < queue.events.size())
+            return true;
+
+    return false;
+}
+
+void PitchBendProcessor::decodeUmpInput(int numSamples)
+{
+    umpInputEvents.clear();
+    umpInputBytes.clear();
+
+    auto blockEnd = sampleClock + numSamples;
+
+    for (; umpInputCursor < umpInputRuns.size() && umpInputRuns[umpInputCursor].sample < blockEnd; ++umpInputCursor)
+    {
+        const auto &run = umpInputRuns[umpInputCursor];
+        const auto *words = umpInputWords.data();
+
+        for (juce::ump::Iterator it(words + run.begin, static_cast<size_t>(run.end - run.begin) * sizeof(juce::uint32)); it->data() < words + run.end; ++it)
+        {
+            const auto &view = *it;
+            auto type = juce::ump::Utils::getMessageType(view[0]);
+
+            // Channel voice messages only, of either protocol, and none cut short at the end
+            // of a run
+            if ((type != 0x2 && type != 0x4) || umpInputEvents.size() == umpInputEvents.capacity()
+                || it->data() + view.size() > words + run.end)
+                continue;
+
+            InputEvent event;
+            event.samplePosition = static_cast<int>(run.sample - sampleClock);
+            event.channel = static_cast<juce::uint8>(juce::ump::Utils::getChannel(view[0]) + 1);
+            event.note = static_cast<juce::uint8>((view[0] >> 8) & 0x7f);
+
+            auto status = juce::ump::Utils::getStatus(view[0]);
+            auto statusByte = static_cast<juce::uint8>((status << 4) | (event.channel - 1));
+            auto data1 = static_cast<juce::uint8>((view[0] >> 8) & 0x7f);
+            auto data2 = static_cast<juce::uint8>(view[0] & 0x7f);
+            auto numBytes = status == 0xc || status == 0xd ? 2 : 3;
+
+            if (type == 0x4)
+            {
+                // Per-note messages are handled from the packet; the rest take the MIDI 1.0
+                // form the engine and the pass-through already deal in
+                if (status <= 0x1 || status == 0x6 || status == 0xf)
+                {
+                    event.packet = view.data();
+                    umpInputEvents.push_back(event);
+                    continue;
+                }
+
+                auto value = view[1];
+
+                if (status == 0x8 || status == 0x9)
+                    data2 = static_cast<juce::uint8>(status == 0x9 ? juce::jmax(1u, value >> 25) : value >> 25);
+                else if (status == 0xa || status == 0xb)
+                    data2 = static_cast<juce::uint8>(value >> 25);
+                else if (status == 0xc)
+                    data1 = static_cast<juce::uint8>((value >> 24) & 0x7f);
+                else if (status == 0xd)
+                    data1 = static_cast<juce::uint8>(value >> 25);
+                else if (status == 0xe)
+                {
+                    data1 = static_cast<juce::uint8>((value >> 18) & 0x7f);
+                    data2 = static_cast<juce::uint8>(value >> 25);
+                }
+                else
+                    continue;
+            }
+
+            umpInputBytes.push_back({statusByte, data1, data2});
+            event.data = umpInputBytes.back().data();
+            event.numBytes = numBytes;
+            umpInputEvents.push_back(event);
+        }
+    }
+}
+
+void PitchBendProcessor::resetDebounce()
+{
+    lastOnsetSample.fill(std::numeric_limits<juce::int64>::min());
+    debounceKeysDown.fill(0);
+    debouncedNoteOffs.fill(0);
+}
+
+bool PitchBendProcessor::debounceNote(const InputEvent &event, juce::int64 sample)
+{
+    auto key = static_cast<size_t>(event.note);
+
+    if (event.kind == InputEvent::Kind::noteOff)
+    {
+        if (debouncedNoteOffs[key] > 0)
+        {
+            --debouncedNoteOffs[key];
+            return true;
+        }
+
+        debounceKeysDown[key] = static_cast<juce::uint8>(juce::jmax(0, debounceKeysDown[key] - 1));
+        return false;
+    }
+
+    // Per-note messages and keys from before the last prepareToPlay never count as retriggers
+    if (event.packet == nullptr && sample >= lastOnsetSample[key] && sample - lastOnsetSample[key] < debounceSamples)
+    {
+        if (debounceKeysDown[key] > 0 && debouncedNoteOffs[key] < 255)
+            ++debouncedNoteOffs[key];
+
+        return true;
+    }
+
+    lastOnsetSample[key] = sample;
+    debounceKeysDown[key] = static_cast<juce::uint8>(juce::jmin(255, debounceKeysDown[key] + 1));
+    return false;
+}
+
+void PitchBendProcessor::resetControllerFilter()
+{
+    forwardedControllerValue.fill(noControllerValue);
+    forwardedControllerSample.fill(std::numeric_limits<juce::int64>::min() / 2);
+    heldControllerMask.fill(0);
+    numHeldControllers = 0;
+}
+
+bool PitchBendProcessor::isJitterController(int controller)
+{
+    // Bank select, data entry, LSBs, switches, (N)RPN numbers and mode messages are exact
+    return (controller >= 1 && controller <= 31 && controller != 6) || (controller >= 70 && controller <= 95)
+           || (controller >= 102 && controller <= 119);
+}
+
+bool PitchBendProcessor::filterController(const InputEvent &event, juce::int64 sample)
+{
+    if ((event.data[0] & 0xf0) != 0xb0 || event.numBytes < 3 || !isJitterController(event.data[1]))
+        return false;
+
+    auto index = static_cast<size_t>((event.data[0] & 0x0f) << 7 | event.data[1]);
+    auto value = event.data[2];
+    auto last = forwardedControllerValue[index];
+    auto &heldWord = heldControllerMask[index >> 5];
+    auto heldBit = 1u << (index & 31);
+
+    auto release = [&]
+    {
+        if ((heldWord & heldBit) != 0)
+        {
+            heldWord &= ~heldBit;
+            --numHeldControllers;
+        }
+    };
+
+    // Within the hysteresis of what the synth has, nothing to send, and nothing held either
+    if (last != noControllerValue && std::abs(value - last) <= params.ccHysteresis && value != 0 && value != 127)
+    {
+        release();
+        return true;
+    }
+
+    if (last == value)
+    {
+        release();
+        return true;
+    }
+
+    if (sample - forwardedControllerSample[index] < controllerIntervalSamples)
+    {
+        heldControllerValue[index] = value;
+
+        if ((heldWord & heldBit) == 0)
+        {
+            heldWord |= heldBit;
+            ++numHeldControllers;
+        }
+
+        return true;
+    }
+
+    release();
+    forwardedControllerValue[index] = value;
+    forwardedControllerSample[index] = sample;
+    return false;
+}
+
+void PitchBendProcessor::flushHeldControllers(int numSamples)
+{
+    auto sample = sampleClock + numSamples - 1;
+    int numFlushed = 0;
+
+    for (size_t word = 0; word < heldControllerMask.size(); ++word)
+    {
+        for (auto mask = heldControllerMask[word]; mask != 0; mask &= mask - 1)
+        {
+            auto index = word * 32 + static_cast<size_t>(lowestSetBit(mask));
+
+            if (sample - forwardedControllerSample[index] < controllerIntervalSamples)
+                continue;
+
+            if (numFlushed == maxControllerFlushes || inputEvents.size() == inputEvents.capacity())
+                return;
+
+            auto &bytes = flushedControllerBytes[static_cast<size_t>(numFlushed++)];
+            bytes = {static_cast<juce::uint8>(0xb0 | (index >> 7)), static_cast<juce::uint8>(index & 0x7f), heldControllerValue[index]};
+
+            InputEvent event;
+            event.data = bytes.data();
+            event.numBytes = 3;
+            event.samplePosition = numSamples - 1;
+            inputEvents.push_back(event);
+
+            heldControllerMask[word] &= ~(1u << (index & 31));
+            --numHeldControllers;
+            forwardedControllerValue[index] = heldControllerValue[index];
+            forwardedControllerSample[index] = sample;
+        }
+    }
+}
+
+void PitchBendProcessor::decodeInput(const juce::MidiBuffer &midiMessages, int numSamples)
+{
+    BCS_TRACE_PHASE(phaseTracer, "decode");
+
+    inputEvents.clear();
+    deferredEvents.clear();
+
+    if (hasUmpInput())
+        decodeUmpInput(numSamples);
+    else
+        umpInputEvents.clear();
+
+    auto decode = [this](InputEvent event)
+    {
+        if (event.packet != nullptr)
+            return event;
+
+        auto kind = InputEvent::kindByStatus[static_cast<size_t>(event.data[0] >> 4)];
+
+        if (kind != InputEvent::Kind::other && event.numBytes >= 3)
+        {
+            event.kind = event.data[2] != 0 ? kind : InputEvent::Kind::noteOff;
+            event.channel = static_cast<juce::uint8>((event.data[0] & 0x0f) + 1);
+            event.note = event.data[1];
+            event.velocity = event.data[2];
+
+            // Out of scope, a note-on goes through as it came, with no voice, and its key is
+            // marked like one struck in bypass so its note-off follows it even if the scope
+            // changes meanwhile
+            auto inScope = ((params.scopeChannels >> (event.channel - 1)) & 1) != 0
+                        && event.note >= params.scopeLowNote && event.note <= params.scopeHighNote;
+            auto &word = bypassedNotes[static_cast<size_t>(event.channel - 1)][static_cast<size_t>(event.note >> 5)];
+            auto bit = 1u << (event.note & 31);
+
+            if (!inScope && event.kind == InputEvent::Kind::noteOn)
+            {
+                word |= bit;
+                event.kind = InputEvent::Kind::other;
+            }
+            else if (!inScope && (word & bit) != 0)
+            {
+                word &= ~bit;
+                event.kind = InputEvent::Kind::other;
+            }
+        }
+
+        return event;
+    };
+
+    // On each sample the note-offs go first, so the channels they free are there for that
+    // sample's note-ons; except a note-off for a key struck earlier on the same sample, which
+    // has to stay after it. Everything else keeps its order.
+    //
+    // A MidiBuffer filled through addEvent is in order, but one written directly need not be.
+    // Events before the previous one or outside the block are moved onto the nearest sample
+    // that keeps them in order and inside it, which the scheduling below relies on.
+    //
+    // The inputs are merged as they are read, with no combined buffer: each sample takes the
+    // host's MidiBuffer's events, then each further bus's in bus order, then the UMP input's.
+    // With at most a handful of inputs the earliest is found by looking at each head in turn.
+    // A bus's channel filter drops its channel messages as they are read.
+    auto channels = inputBusChannels.load(std::memory_order_relaxed);
+    auto hostChannels = static_cast<juce::uint16>(channels);
+    auto end = midiMessages.cend();
+    auto umpEnd = umpInputEvents.cend();
+    auto ump = umpInputEvents.cbegin();
+    int lastPosition = 0;
+
+    auto isHeard = [](const juce::uint8 *data, juce::uint16 busChannels)
+    { return data[0] >= 0xf0 || ((busChannels >> (data[0] & 0x0f)) & 1) != 0; };
+
+    struct BusCursor
+    {
+        const QueuedInputEvent *next, *end;
+        const juce::uint8 *bytes;
+        juce::uint16 channels;
+    };
+
+    std::array<BusCursor, maxMidiInputBuses - 1> buses;
+    size_t numBuses = 0;
+    auto blockEnd = sampleClock + numSamples;
+
+    for (size_t i = 0; i < inputBusQueues.size(); ++i)
+    {
+        auto &queue = inputBusQueues[i];
+        auto first = queue.cursor;
+
+        // Beyond a block's share, the rest wait for the next block
+        while (queue.cursor < queue.events.size() && queue.events[queue.cursor].sample < blockEnd
+               && queue.cursor - first < static_cast<size_t>(maxBusInputPerBlock))
+            ++queue.cursor;
+
+        if (queue.cursor != first)
+            buses[numBuses++] = {queue.events.data() + first, queue.events.data() + queue.cursor, queue.bytes.data(),
+                                 static_cast<juce::uint16>(channels >> ((i + 1) * 16))};
+    }
+
+    auto busPosition = [this](const QueuedInputEvent &event)
+    { return static_cast<int>(juce::jmax(juce::int64{0}, event.sample - sampleClock)); };
+
+    auto busesPending = [&]
+    {
+        for (size_t i = 0; i < numBuses; ++i)
+            if (buses[i].next != buses[i].end)
+                return true;
+
+        return false;
+    };
+
+    // Only notes touch the keys struck on the sample; a flood of pressure or controllers
+    // goes straight to the deferred list
+    auto add = [&](InputEvent event, int samplePos)
+    {
+        event = decode(event);
+        event.samplePosition = samplePos;
+
+        if (event.kind == InputEvent::Kind::other)
+        {
+            if (controllerFilterActive && event.packet == nullptr && filterController(event, sampleClock + samplePos))
+                return;
+
+            deferredEvents.push_back(event);
+            return;
+        }
+
+        if (debounceSamples > 0 && debounceNote(event, sampleClock + samplePos))
+            return;
+
+        auto &word = keysStruckThisSample[static_cast<size_t>(event.channel - 1)][static_cast<size_t>(event.note >> 5)];
+        auto bit = 1u << (event.note & 31);
+
+        if (event.kind == InputEvent::Kind::noteOn)
+            word |= bit;
+
+        if (event.kind == InputEvent::Kind::noteOff && (word & bit) == 0)
+            inputEvents.push_back(event);
+        else
+            deferredEvents.push_back(event);
+    };
+
+    for (auto it = midiMessages.cbegin(); it != end || ump != umpEnd || busesPending();)
+    {
+        auto samplePos = juce::jmin(it != end ? juce::jlimit(lastPosition, numSamples - 1, (*it).samplePosition) : numSamples,
+                                    ump != umpEnd ? juce::jlimit(lastPosition, numSamples - 1, ump->samplePosition) : numSamples);
+
+        for (size_t i = 0; i < numBuses; ++i)
+            if (buses[i].next != buses[i].end)
+                samplePos = juce::jmin(samplePos, juce::jlimit(lastPosition, numSamples - 1, busPosition(*buses[i].next)));
+
+        auto firstDeferred = deferredEvents.size();
+        lastPosition = samplePos;
+
+        for (; it != end && juce::jlimit(samplePos, numSamples - 1, (*it).samplePosition) == samplePos; ++it)
+        {
+            const auto metadata = *it;
+
+            if (!isHeard(metadata.data, hostChannels))
+                continue;
+
+            InputEvent event;
+            event.data = metadata.data;
+            event.numBytes = metadata.numBytes;
+            add(event, samplePos);
+        }
+
+        for (size_t i = 0; i < numBuses; ++i)
+        {
+            auto &bus = buses[i];
+
+            for (; bus.next != bus.end && juce::jlimit(samplePos, numSamples - 1, busPosition(*bus.next)) == samplePos; ++bus.next)
+            {
+                if (!isHeard(bus.bytes + bus.next->begin, bus.channels))
+                    continue;
+
+                InputEvent event;
+                event.data = bus.bytes + bus.next->begin;
+                event.numBytes = bus.next->numBytes;
+                add(event, samplePos);
+            }
+        }
+
+        for (; ump != umpEnd && juce::jlimit(samplePos, numSamples - 1, ump->samplePosition) == samplePos; ++ump)
+            add(*ump, samplePos);
+
+        for (auto i = firstDeferred; i < deferredEvents.size(); ++i)
+        {
+            const auto &event = deferredEvents[i];
+
+            if (event.kind != InputEvent::Kind::other)
+                keysStruckThisSample[static_cast<size_t>(event.channel - 1)][static_cast<size_t>(event.note >> 5)] = 0;
+
+            inputEvents.push_back(event);
+        }
+    }
+
+    if (numHeldControllers > 0)
+        flushHeldControllers(numSamples);
+
+    jassert(inputEvents.size() <= inputEvents.capacity());
+}
+
+void PitchBendProcessor::delayInput(int numSamples, juce::MidiBuffer &midiMessages)
+{
+    constexpr int headerSize = sizeof(juce::int32) + sizeof(juce::uint16);
+    auto delay = control.lookaheadSamples.load(std::memory_order_acquire);
+
+    if (delay == 0 && lookaheadLine.isEmpty())
+        return;
+
+    auto isNoteOn = [](const juce::uint8 *data, int numBytes) { return numBytes >= 3 && (data[0] & 0xf0) == 0x90 && data[2] != 0; };
+
+    // Input joins the line delay samples on, never ahead of what is already waiting, so the
+    // order holds while the delay shrinks
+    int numDelayed = 0;
+
+    for (const auto metadata : midiMessages)
+    {
+        if (static_cast<size_t>(lookaheadLine.data.size() + headerSize + metadata.numBytes) > reservedLookaheadBytes)
+            break;
+
+        lookaheadEnd = juce::jmax(lookaheadEnd, juce::jlimit(0, numSamples - 1, metadata.samplePosition) + delay);
+        appendMidiEvent(lookaheadLine, metadata.data, metadata.numBytes, lookaheadEnd);
+        ++numDelayed;
+
+        if (isNoteOn(metadata.data, metadata.numBytes))
+            upcomingNotes.noteOn(metadata.data[1] & 0x7f);
+    }
+
+    // Everything due in this block leaves the line; the rest moves up by the block
+    lookaheadBlock.clear();
+
+    auto *line = lookaheadLine.data.begin();
+    auto lineSize = lookaheadLine.data.size();
+    int offset = 0;
+
+    for (; offset < lineSize; )
+    {
+        auto samplePos = juce::readUnaligned<juce::int32>(line + offset);
+        auto numBytes = static_cast<int>(juce::readUnaligned<juce::uint16>(line + offset + sizeof(juce::int32)));
+
+        if (samplePos >= numSamples)
+            break;
+
+        appendMidiEvent(lookaheadBlock, line + offset + headerSize, numBytes, samplePos);
+
+        if (isNoteOn(line + offset + headerSize, numBytes))
+            upcomingNotes.noteOff(line[offset + headerSize + 1] & 0x7f);
+
+        offset += headerSize + numBytes;
+    }
+
+    lookaheadLine.data.removeRange(0, offset);
+    line = lookaheadLine.data.begin();
+    lineSize = lookaheadLine.data.size();
+
+    for (offset = 0; offset < lineSize; )
+    {
+        juce::writeUnaligned<juce::int32>(line + offset, juce::readUnaligned<juce::int32>(line + offset) - numSamples);
+        offset += headerSize + static_cast<int>(juce::readUnaligned<juce::uint16>(line + offset + sizeof(juce::int32)));
+    }
+
+    lookaheadEnd = juce::jmax(0, lookaheadEnd - numSamples);
+
+    // Past the reserved storage, input goes through as it came
+    int index = 0;
+
+    for (const auto metadata : midiMessages)
+        if (index++ >= numDelayed)
+            appendMidiEvent(lookaheadBlock, metadata.data, metadata.numBytes, metadata.samplePosition);
+
+    midiMessages.clear();
+    midiMessages.data.addArray(lookaheadBlock.data);
+}
+
+float PitchBendProcessor::justOffsetCents(int note) const
+{
+    auto root = heldNotes.getLowestNote();
+    auto upcomingRoot = upcomingNotes.getLowestNote();
+
+    if (upcomingRoot >= 0 && (root < 0 || upcomingRoot < root))
+        root = upcomingRoot;
+
+    return ChordAnalyzer::getJustOffsetCents(note, root);
+}
+
+float PitchBendProcessor::noteTargetOffsetCents(int note) const
+{
+    auto cents = params.scaleStep != 0 ? scaleTargets.targetCents[static_cast<size_t>(note)] : 0.0f;
+    const auto &heard = pitchTracker.getResult();
+
+    if (params.inputTarget == InputTarget::pitch && heard.note >= 0.0f)
+    {
+        auto distance = heard.note - static_cast<float>(note);
+        cents += 100.0f * (distance - 12.0f * std::round(distance / 12.0f));
+    }
+    else if (params.inputTarget == InputTarget::chord && heard.pitchClasses != 0)
+    {
+        // Nearest first, and up before down at the tritone
+        for (int step = 0; step <= 6; ++step)
+        {
+            if (((heard.pitchClasses >> ((note + step) % 12)) & 1u) != 0)
+            {
+                cents += static_cast<float>(step * 100);
+                break;
+            }
+
+            if (((heard.pitchClasses >> ((note - step + 12) % 12)) & 1u) != 0)
+            {
+                cents -= static_cast<float>(step * 100);
+                break;
+            }
+        }
+    }
+
+    if (params.justStacking)
+        cents += justOffsetCents(note);
+
+    return cents;
+}
+
+void PitchBendProcessor::followTransport(int numSamples)
+{
+    auto flush = control.voiceFlushRequested.exchange(false);
+    timelineKnown = false;
+
+    if (auto *hostPlayHead = getPlayHead())
+    {
+        if (auto position = hostPlayHead->getPosition())
+        {
+            auto isPlaying = position->getIsPlaying();
+            flush = flush || (params.releaseOnStop && transportWasPlaying && !isPlaying);
+            transportWasPlaying = isPlaying;
+
+            if (auto timeInSamples = position->getTimeInSamples())
+            {
+                // Jumped: what was sounding is gone, and the host chases what sounds here
+                if (expectedTimelineSample >= 0 && *timeInSamples != expectedTimelineSample)
+                {
+                    flush = true;
+                    chaseSample = sampleClock + control.lookaheadSamples.load(std::memory_order_acquire);
+                }
+
+                timelineOffset = *timeInSamples - sampleClock;
+                timelineKnown = true;
+                expectedTimelineSample = *timeInSamples + (isPlaying ? numSamples : 0);
+            }
+        }
+    }
+
+    if (!timelineKnown)
+        expectedTimelineSample = -1;
+
+    // Nothing to end is nothing to do; the request isn't kept for voices still to come
+    flushPending = flush && (voices.activeMask != 0 || numStrummedEvents != 0);
+}
+
+void PitchBendProcessor::flushVoices(int samplePos)
+{
+    // Members are centred one by one below, so the master has to be first
+    for (auto &zone : zones)
+        centreMasterBend(zone, samplePos);
+
+    for (auto mask = voices.activeMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+
+        endVoice(slot, 0, samplePos);
+        sendBend(slot, 0, 0.0f, samplePos);
+        zoneForSlot(slot).allocator.release(slot + 1);
+    }
+
+    // Release ends went with their voices
+    scheduler.clear();
+    numStrummedEvents = 0;
+    heldNotes.clear();
+    sustainPedals = 0;
+    flushPending = false;
+}
+
+void PitchBendProcessor::chaseVoice(int slot, juce::int64 startSample)
+{
+    auto i = static_cast<size_t>(slot);
+    auto &zone = zoneForSlot(slot);
+    auto onset = noteOnsets[static_cast<size_t>(voices.inputChannel[i] - 1)][static_cast<size_t>(voices.inputNote[i])];
+    auto timelineSample = startSample + timelineOffset;
+    juce::int64 elapsed;
+
+    if (timelineKnown && onset >= 0 && onset <= timelineSample)
+        elapsed = timelineSample - onset;
+    else if (params.latchParameters && envelope->numSegments <= 1)
+        elapsed = static_cast<juce::int64>(std::ceil(1.0f / juce::jmax(voices.latchedInverseDuration[i], 1.0e-9f)));
+    else
+        elapsed = static_cast<juce::int64>(std::ceil(static_cast<float>(zone.durationInSamples) / (voiceScalingActive ? voices.inverseTimeScale[i] : 1.0f)));
+
+    // Started back then, so the note goes out with the bend it has got to by now
+    voices.startSample[i] = startSample - elapsed;
+
+    float level;
+    voices.lastBendValue[i] = static_cast<int>(evaluateVoiceBend(zone, slot, startSample, zone.amount * zone.bendScale, zone.curve, level));
+}
+
+void PitchBendProcessor::processMidi(int numSamples, juce::MidiBuffer &midiMessages)
+{
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    hostBlockTally = {};
+    phaseTicks.fill(0);
+
+    delayInput(numSamples, midiMessages);
+    followTransport(numSamples);
+
+    // A block inside one sub-block, or one a parked instance only passes through, runs as it
+    // is. A host may also send more than it promised in prepareToPlay, which is cut the same.
+    auto fitsWhole = numSamples <= juce::jmin(preparedBlockSize, samplesToNextCut());
+    auto parked = numSamples <= preparedBlockSize && isParked() && !hasUmpInput() && !hasBusInput()
+                  && (midiMessages.isEmpty() || passesThroughUntouched(midiMessages, numSamples));
+
+    if (fitsWhole || parked)
+    {
+        processMidiBlock(numSamples, midiMessages, 0, numSamples);
+        finishHostBlock(startTicks, numSamples, midiMessages);
+        return;
+    }
+
+    // The input is held for the cut in what prepareToPlay reserved for it, so a dense block
+    // doesn't allocate here; events past that are dropped and counted
+    constexpr int headerSize = sizeof(juce::int32) + sizeof(juce::uint16);
+    splitInput.clear();
+    int numDropped = 0;
+
+    for (const auto metadata : midiMessages)
+    {
+        if (static_cast<size_t>(splitInput.data.size() + headerSize + metadata.numBytes) > reservedSplitBytes)
+            ++numDropped;
+        else
+            splitInput.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+    }
+
+    if (numDropped > 0)
+        counters.droppedInput.fetch_add(static_cast<juce::uint64>(numDropped), std::memory_order_relaxed);
+
+    midiMessages.clear();
+
+    auto input = splitInput.cbegin();
+
+    // processMidiBlock moves the clock on, so each cut is found from where the last piece ended
+    for (int chunkStart = 0, chunkLength = 0; chunkStart < numSamples; chunkStart += chunkLength)
+    {
+        chunkLength = juce::jmin(numSamples - chunkStart, preparedBlockSize, samplesToNextCut());
+        chunkMidi.clear();
+
+        // The last piece takes whatever is left, including events past the end
+        auto isLast = chunkStart + chunkLength == numSamples;
+
+        for (; input != splitInput.cend() && (isLast || (*input).samplePosition < chunkStart + chunkLength); ++input)
+        {
+            const auto metadata = *input;
+            chunkMidi.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition - chunkStart);
+        }
+
+        processMidiBlock(chunkLength, chunkMidi, chunkStart, numSamples);
+
+        for (const auto metadata : chunkMidi)
+            midiMessages.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition + chunkStart);
+    }
+
+    finishHostBlock(startTicks, numSamples, midiMessages);
+}
+
+void PitchBendProcessor::finishHostBlock(juce::int64 startTicks, int numSamples, const juce::MidiBuffer &output)
+{
+    // After the last piece, with the clock already moved on past the host block
+    auto processSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    loadMonitor.registerBlock(processSeconds, numSamples, sampleClock - numSamples);
+
+    if (!hostBlockTally.parked)
+    {
+        if (oscStreamer.isStreaming())
+            pushOscVoices();
+
+        adaptQualityToLoad(numSamples);
+    }
+
+    pushTelemetry(processSeconds, numSamples);
+    recordFlight(processSeconds, numSamples, output);
+}
+
+void PitchBendProcessor::allocateScratch()
+{
+    scratch.reset();
+
+    auto maxDecodedEvents = static_cast<size_t>(maxDecodedEventsPerBlock);
+    inputEvents.allocate(scratch, maxDecodedEvents);
+    deferredEvents.allocate(scratch, maxDecodedEvents);
+    umpInputEvents.allocate(scratch, static_cast<size_t>(maxUmpInputPerBlock));
+    umpInputBytes.allocate(scratch, static_cast<size_t>(maxUmpInputPerBlock));
+    supersededEvents.allocate(scratch, static_cast<size_t>(maxOutputEvents));
+}
+
+size_t PitchBendProcessor::scratchBytesUsed() const
+{
+    return inputEvents.getPeakBytes() + deferredEvents.getPeakBytes() + umpInputEvents.getPeakBytes() + umpInputBytes.getPeakBytes()
+           + supersededEvents.getPeakBytes();
+}
+
+void PitchBendProcessor::processMidiBlock(int numSamples, juce::MidiBuffer &midiMessages, int blockOffset, int blockSamples)
+{
+    hostBlockOffset = blockOffset;
+    hostBlockSamples = blockSamples;
+
+    allocateScratch();
+    adoptLinkedSettings();
+    phaseTracer.setBlockSample(sampleClock);
+    BCS_TRACE_PHASE(phaseTracer, "processBlock");
+
+    // Phase boundaries for the flight recorder, stamped only while it runs; processMidi
+    // clears the phase times once for the host block, and its pieces add to them
+    auto recordingFlight = flightRecorder.isRecording();
+    auto phaseStart = recordingFlight ? juce::Time::getHighResolutionTicks() : 0;
+
+    auto endPhase = [&](FlightRecord::Phase phase)
+    {
+        if (recordingFlight)
+        {
+            auto now = juce::Time::getHighResolutionTicks();
+            phaseTicks[static_cast<size_t>(phase)] += now - phaseStart;
+            phaseStart = now;
+        }
+    };
+
+    // Fast path for parked instances: only the clock, the budget and the load figures move on.
+    // Input that all passes through as it came is left in the host's buffer, not rebuilt; the
+    // mirror and the budget still see it go out.
+    if (isParked() && !hasUmpInput() && !hasBusInput() && (midiMessages.isEmpty() || passesThroughUntouched(midiMessages, numSamples)))
+    {
+        int passedThrough = 0;
+
+        for (const auto metadata : midiMessages)
+        {
+            receiverState.update(metadata.data, metadata.numBytes);
+            generatedState.update(metadata.data, metadata.numBytes);
+            ++passedThrough;
+        }
+
+        if (params.budgetEnabled)
+        {
+            refillBudget(numSamples);
+            budgetTokens -= passedThrough;
+        }
+
+        if (params.serialOutput && !midiMessages.isEmpty())
+            orderForRunningStatus(midiMessages);
+
+        if (traceRecorder.isCapturing() && !midiMessages.isEmpty())
+            recordTrace(midiMessages);
+
+        if (midiCapture.isCapturing() && !midiMessages.isEmpty())
+            captureOutput(midiMessages);
+
+        sampleClock += numSamples;
+        messagesThisBlock = 0;
+        bendsThisBlock = 0;
+        hostBlockTally.inputEvents += passedThrough;
+        return;
+    }
+
+    hostBlockTally.parked = false;
+
+    outputMidi.clear();
+    umpOutput.clear();
+    messagesThisBlock = 0;
+    bendsThisBlock = 0;
+    lastOutputPosition = 0;
+
+    if (flushPending)
+        flushVoices(0);
+
+    bool parametersChanged = updateParameterSnapshot();
+
+    if (parametersChanged)
+    {
+        setZoneLayout(params.outputMode, params.zoneSplit, params.upperZoneChannels);
+        setBendRange(params.bendRange);
+        setMasterBendMode(params.masterBend);
+        setSharedPool(params.sharedPool);
+        setAutoZoneSize(params.autoZoneSize);
+
+        applyQualityLevel();
+        vibrato.set(params.vibratoDepthCents * semitoneScale / 100.0f, params.vibratoRate, params.vibratoDelay, currentSampleRate);
+    }
+
+    if (activeOutputMode == OutputMode::mpe)
+        sendPendingZoneConfig();
+
+    if (receiverDiscovery.hasOutgoing())
+        sendPendingCiMessage();
+
+    auto &lower = zones[lowerZone];
+    auto &upper = zones[upperZone];
+    lower.amount = params.amountInSemitones ? params.semitones : params.amount;
+    lower.curve = params.curve;
+    lower.bendScale = params.amountInSemitones ? semitoneScale : 8192.0f;
+    upper.amount = params.amountInSemitones ? params.upperSemitones : params.upperAmount;
+    upper.curve = params.upperCurve;
+    upper.bendScale = lower.bendScale;
+    float lowerTime = params.time;
+
+    // Morphing replaces the lower zone's bend parameters with the blend of the two presets,
+    // whose amounts are always fractions of the bend range
+    if (params.morphEnabled)
+    {
+        updateMorph();
+        lower.amount = morphAmount;
+        lower.bendScale = 8192.0f;
+        lower.curve = morphTable.curve;
+        lowerTime = morphTime;
+
+        // Only the blended table has this shape, so the curve must not ramp through others
+        lower.startCurve = lower.curve;
+        lower.rampStartCurve = lower.curve;
+    }
+
+    // A scale step or the input is the voice's whole target, carried in its offset
+    if (params.scaleStep != 0 || params.inputTarget != InputTarget::none)
+    {
+        lower.amount = 0.0f;
+        upper.amount = 0.0f;
+    }
+
+    // The input as last heard, for the whole block
+    if (params.inputTarget != InputTarget::none)
+        pitchTracker.acquireResult();
+
+    // One configuration for the whole block, whatever is published meanwhile
+    activeConfig = &engineConfig.acquire();
+    const auto *expressionTable = activeConfig->expressionTable.get();
+
+    // A curve expression's table is the only one with its shape, so, as with the morph, the
+    // curve takes the table's value and doesn't ramp
+    if (expressionTable != nullptr)
+    {
+        for (auto &zone : zones)
+        {
+            if (params.morphEnabled && &zone == &lower)
+                continue;
+
+            zone.curve = expressionTable->curve;
+            zone.startCurve = zone.curve;
+            zone.rampStartCurve = zone.curve;
+        }
+    }
+
+    // The synced duration can also move with the host tempo, so it is checked every block
+    auto syncedTime = params.tempoSync ? getSyncedBendTime() : 0.0f;
+
+    for (auto &zone : zones)
+    {
+        // Hosts only hand us one value per parameter per block, so with smoothing enabled the
+        // bend amount and curve ramp linearly from the previous host block's values across
+        // this one, through all the pieces it is cut into
+        if (hostBlockOffset == 0)
+        {
+            zone.startAmount = zone.rampStartAmount;
+            zone.startCurve = zone.rampStartCurve;
+        }
+
+        zone.rampParameters = params.smoothAutomation && (zone.amount != zone.startAmount || zone.curve != zone.startCurve);
+        zone.rampStartAmount = zone.amount;
+        zone.rampStartCurve = zone.curve;
+
+        auto time = &zone == &lower ? lowerTime : params.upperTime;
+        bool durationChanged = updateDurationInSamples(zone, params.tempoSync ? syncedTime : time);
+
+        if (parametersChanged || durationChanged)
+        {
+            zone.updateRateInSamples = calculateUpdateInterval(zone, params.updateMode);
+
+            // Next-change times were predicted from the old parameters, and parked voices
+            // have none at all; they are evaluated again at the start of this block
+            for (auto mask = voices.activeMask & zone.slotMask; mask != 0; mask &= mask - 1)
+            {
+                auto &next = voices.nextUpdateSample[static_cast<size_t>(lowestSetBit(mask))];
+
+                if (params.updateMode == UpdateMode::nextChange || next == neverSample)
+                    next = juce::jmin(next, sampleClock);
+            }
+        }
+
+        zone.table = expressionTable != nullptr ? expressionTable : activeConfig->curveTables[static_cast<size_t>(&zone - zones.data())].get();
+    }
+
+    if (params.morphEnabled)
+        lower.table = &morphTable;
+
+    updateBendLayers();
+    envelope = &activeConfig->envelope;
+
+    if (envelope->numSegments > 1)
+        for (auto &zone : zones)
+            envelope->computeTiming(zone.durationInSamples, currentSampleRate, zone.envelopeTiming);
+
+    const auto &tuning = activeConfig->tuning;
+
+    // Pitch bend updates. Each voice runs on its own update grid from its start sample; the
+    // voices of both zones due within this block wait in one min-heap by next update time, and
+    // voices of a zone due on the same sample (a chord struck together) are evaluated as one batch.
+    std::array<int, VoiceTable::numSlots> bendValues{};
+    auto mode = params.updateMode;
+
+    auto blockEnd = sampleClock + numSamples;
+    bool useBudget = params.budgetEnabled;
+    int lastTick = 0;
+
+    // The zone configuration has already spent its share of the budget
+    if (useBudget)
+        budgetTokens -= messagesThisBlock;
+
+    updateQueue.clear();
+
+    // Offline, the grid and the budget give way to per-sample streams, once there is room
+    // for this block's
+    pickUpBendStreams();
+    renderOffline = params.offlineQuality && isNonRealtime()
+                    && bendStreams[0].size() >= static_cast<size_t>(numSamples * (1 + VoiceTable::numLanes));
+    renderedUntil = sampleClock;
+
+    for (auto mask = voices.activeMask; mask != 0; mask &= mask - 1)
+    {
+        int slot = lowestSetBit(mask);
+        if (voices.nextUpdateSample[static_cast<size_t>(slot)] < blockEnd)
+            updateQueue.push(slot, voices.nextUpdateSample);
+    }
+
+    // Sends every update due before endSample. Called ahead of each input event and once for
+    // the rest of the block, so all output is produced in time order and only ever appended.
+    auto sendBendsUntil = [&](juce::int64 endSample)
+    {
+        BCS_TRACE_PHASE(phaseTracer, "bends");
+        endPhase(FlightRecord::events);
+
+        if (renderOffline)
+        {
+            renderBendsUntil(endSample);
+            endPhase(FlightRecord::bends);
+            return;
+        }
+
+        while (!updateQueue.isEmpty() && voices.nextUpdateSample[static_cast<size_t>(updateQueue.top())] < endSample)
+        {
+            auto tickSample = voices.nextUpdateSample[static_cast<size_t>(updateQueue.top())];
+            juce::uint32 dueMask = 0;
+
+            while (!updateQueue.isEmpty() && voices.nextUpdateSample[static_cast<size_t>(updateQueue.top())] == tickSample)
+                dueMask |= 1u << updateQueue.pop(voices.nextUpdateSample);
+
+            // Updates that fell due before this block (the grid crossed a prepareToPlay) go out at its start
+            int samplePos = static_cast<int>(juce::jmax(static_cast<juce::int64>(0), tickSample - sampleClock));
+
+            if (useBudget)
+            {
+                refillBudget(samplePos - lastTick);
+                lastTick = samplePos;
+            }
+
+            // Stolen channels still ramping over to their new note
+            if (auto handoffs = dueMask & voices.handoffMask)
+            {
+                auto messagesBeforeRamp = messagesThisBlock;
+
+                for (auto mask = handoffs; mask != 0; mask &= mask - 1)
+                    advanceHandoff(lowestSetBit(mask), tickSample, samplePos, blockEnd);
+
+                if (useBudget)
+                    budgetTokens -= messagesThisBlock - messagesBeforeRamp;
+
+                dueMask &= ~handoffs;
+            }
+
+            for (auto &zone : zones)
+            {
+                auto zoneDueMask = dueMask & zone.slotMask;
+
+                if (zoneDueMask == 0)
+                    continue;
+
+                float tickAmount = zone.amount;
+                float tickCurve = zone.curve;
+
+                if (zone.rampParameters)
+                {
+                    auto position = rampPosition(samplePos);
+                    tickAmount = zone.startAmount + (zone.amount - zone.startAmount) * position;
+                    tickCurve = zone.startCurve + (zone.curve - zone.startCurve) * position;
+                }
+
+                auto sendMask = calculatePitchBends(tickSample, tickAmount * zone.bendScale, tickCurve, *zone.table, zone.durationInSamples,
+                                                    zone.envelopeTiming, bendValues)
+                                & zoneDueMask;
+
+                // Releasing voices follow their release bend instead
+                if (auto releasing = zoneDueMask & voices.releasingMask)
+                    sendMask = (sendMask & ~releasing) | calculateReleaseBends(tickSample, *zone.table, releasing, bendValues);
+
+                if (useBudget)
+                {
+                    sendMask = applyBandwidthBudget(sendMask, bendValues);
+                    budgetTokens -= juce::countNumberOfBits(sendMask);
+                }
+
+                if (receiverSmoothingSamples > 0.0f)
+                    noteBendsHeard(sendMask & ~voices.releasingMask, tickSample);
+
+                // A chord moving in lockstep takes one master bend; the budget gets the rest back
+                if (activeMasterBend && activeOutputMode == OutputMode::mpe && sendLockstepBend(zone, sendMask, bendValues, samplePos))
+                {
+                    if (useBudget)
+                        budgetTokens += juce::countNumberOfBits(sendMask) - 1;
+
+                    bendsThisBlock += 1;
+                    sendMask = 0;
+                }
+
+                bendsThisBlock += juce::countNumberOfBits(sendMask);
+
+                for (auto mask = sendMask; mask != 0; mask &= mask - 1)
+                {
+                    int slot = lowestSetBit(mask);
+                    voices.lastBendValue[slot] = bendValues[slot];
+
+                    sendBend(slot, bendValues[slot], slotValues[static_cast<size_t>(slot)], samplePos);
+                }
+
+                // The lanes ride the same tick, from the levels the bends were just built on.
+                // Whatever the budget can't cover now is caught up on a later tick.
+                if (lanesSending())
+                {
+                    for (int lane = 0; lane < VoiceTable::numLanes; ++lane)
+                    {
+                        if (!lanes[static_cast<size_t>(lane)].enabled)
+                            continue;
+
+                        auto laneMask = calculateLaneValues(lane, zoneDueMask & ~voices.releasingMask);
+                        auto count = juce::countNumberOfBits(laneMask);
+
+                        if (useBudget)
+                        {
+                            if (budgetTokens < count)
+                                continue;
+
+                            budgetTokens -= count;
+                        }
+
+                        for (auto mask = laneMask; mask != 0; mask &= mask - 1)
+                        {
+                            auto slot = static_cast<size_t>(lowestSetBit(mask));
+                            voices.lastLaneValue[static_cast<size_t>(lane)][slot] = laneValues[static_cast<size_t>(lane)][slot];
+                            sendLaneValue(lane, static_cast<int>(slot), laneValues[static_cast<size_t>(lane)][slot], samplePos);
+                        }
+                    }
+                }
+
+                auto interval = mode == UpdateMode::adaptive ? calculateAdaptiveInterval(zone, tickSample, tickAmount * zone.bendScale, *zone.table, zoneDueMask)
+                                                             : zone.updateRateInSamples;
+
+                for (auto mask = zoneDueMask; mask != 0; mask &= mask - 1)
+                {
+                    int slot = lowestSetBit(mask);
+                    auto &next = voices.nextUpdateSample[static_cast<size_t>(slot)];
+                    next = mode == UpdateMode::nextChange ? predictNextChange(zone, slot, tickSample, tickAmount * zone.bendScale, tickCurve)
+                                                          : tickSample + interval;
+
+                    if (next < blockEnd)
+                        updateQueue.push(slot, voices.nextUpdateSample);
+                }
+            }
+        }
+
+        endPhase(FlightRecord::bends);
+    };
+
+    // legatoSlot is a held voice to glide over to this note, or VoiceTable::noSlot. A note of
+    // a chord memory voicing comes with its channel already taken, and whether it was stolen.
+    auto startNote = [&](int inputChannel, int noteNumber, int velocity, int samplePos, int legatoSlot,
+                         int allocatedChannel = 0, bool allocatedByStealing = false)
+    {
+        BCS_TRACE_PHASE(phaseTracer, "note-on");
+
+        auto startSample = sampleClock + samplePos;
+
+        // A planned voice may have been stolen by an earlier note of the same chord
+        if (legatoSlot != VoiceTable::noSlot && !(voices.isActive(legatoSlot) && voices.startSample[legatoSlot] < startSample))
+            legatoSlot = VoiceTable::noSlot;
+
+        // Retriggered without a note-off: release the previous voice for this key first,
+        // unless it is the one gliding over
+        int previousSlot = voices.findSlot(inputChannel, noteNumber);
+        if (previousSlot != VoiceTable::noSlot)
+        {
+            if (previousSlot != legatoSlot)
+            {
+                endVoice(previousSlot, 0, samplePos);
+                zoneForSlot(previousSlot).allocator.release(previousSlot + 1);
+            }
+
+            heldNotes.noteOff(noteNumber);
+        }
+
+        heldNotes.noteOn(noteNumber);
+
+        if (timelineKnown && startSample != chaseSample)
+            noteOnsets[static_cast<size_t>(inputChannel - 1)][static_cast<size_t>(noteNumber)] = startSample + timelineOffset;
+
+        auto tuningSteps = [&](int cents) { return juce::jlimit(-8192.0f, 8191.0f, (static_cast<float>(cents) + tuning.offsetCents[static_cast<size_t>(noteNumber)]) * semitoneScale / 100.0f); };
+
+        if (legatoSlot != VoiceTable::noSlot)
+        {
+            // Keep the synth's voice and bend it from where it is now to the new note; the
+            // next update carries the first step. The old key no longer ends it.
+            int slot = legatoSlot;
+            auto newBase = tuningSteps((noteNumber - voices.noteNumber[slot]) * 100) + playerBendSteps(inputChannel, noteNumber);
+
+            voices.retarget(slot, inputChannel, noteNumber);
+            voices.glideOffset[slot] = static_cast<float>(voices.lastBendValue[slot]) - newBase;
+            voices.baseBend[slot] = newBase;
+            voices.startSample[slot] = startSample;
+            voices.nextUpdateSample[slot] = startSample + zoneForSlot(slot).updateRateInSamples;
+            voices.targetOffsetCents[slot] = noteTargetOffsetCents(noteNumber);
+            setVoiceModulation(slot, noteNumber, velocity);
+
+            updateQueue.remove(slot, voices.nextUpdateSample);
+
+            if (voices.nextUpdateSample[slot] < blockEnd)
+                updateQueue.push(slot, voices.nextUpdateSample);
+
+            return;
+        }
+
+        // Find an available MPE channel for this note in the zone its key belongs to
+        auto &zone = allocatedChannel != 0 ? zoneForSlot(allocatedChannel - 1) : zoneForNewNote(noteNumber);
+        bool wasStolen = allocatedByStealing;
+
+        if (allocatedChannel == 0)
+            growAutoZone(zone, 1, samplePos);
+
+        int mpeChannel = allocatedChannel != 0 ? allocatedChannel : zone.allocator.allocate(noteNumber, velocity, wasStolen);
+
+        // Every channel of a shared pool is held by other instances, or the note priority
+        // keeps the held notes over it: the note is dropped
+        if (mpeChannel == 0)
+        {
+            counters.droppedNotes.fetch_add(1, std::memory_order_relaxed);
+            BCS_LOG(realtimeLog, LogEvent::noteDropped, sampleClock + samplePos, noteNumber);
+            return;
+        }
+
+        int slot = mpeChannel - 1;
+        auto stolenBend = static_cast<float>(voices.lastBendValue[slot]);
+
+        // Zone full: end the stolen voice so it doesn't hang. A chord's were ended before its
+        // first note started.
+        if (wasStolen && allocatedChannel == 0)
+        {
+            BCS_LOG(realtimeLog, LogEvent::voiceStolen, sampleClock + samplePos, slot + 1, voices.noteNumber[slot]);
+            endVoice(slot, 0, samplePos);
+            counters.steals.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        voices.activate(slot, inputChannel, noteNumber);
+        voices.startSample[slot] = startSample;
+        voices.nextUpdateSample[slot] = voices.startSample[slot] + zone.updateRateInSamples;
+        voices.baseBend[slot] = tuningSteps(0) + playerBendSteps(inputChannel, noteNumber);
+        voices.glideOffset[slot] = 0.0f;
+        voices.lastBendValue[slot] = static_cast<int>(voices.baseBend[slot]);
+
+        for (int lane = 0; lane < VoiceTable::numLanes; ++lane)
+            voices.lastLaneValue[static_cast<size_t>(lane)][static_cast<size_t>(slot)] = lanes[static_cast<size_t>(lane)].valueAt(0.0f);
+        voices.targetOffsetCents[slot] = noteTargetOffsetCents(noteNumber);
+        setVoiceModulation(slot, noteNumber, velocity);
+        voices.pressureLevel[slot] = voices.pressureTarget[slot];
+        voices.pressureSample[slot] = startSample;
+        voices.heardBend[slot] = voices.baseBend[slot];
+        voices.heardSample[slot] = startSample;
+        voices.shapedFrom[slot] = voices.baseBend[slot];
+
+        if (startSample == chaseSample)
+            chaseVoice(slot, startSample);
+
+        // The note and its bend start once the channel has ramped over from the stolen voice
+        auto handOver = wasStolen && stealRampSamples > 0 && activeOutputMode == OutputMode::mpe && !renderOffline;
+
+        if (handOver)
+        {
+            voices.handoffMask |= 1u << slot;
+            voices.handoffBend[slot] = stolenBend;
+            voices.handoffStart[slot] = startSample;
+            voices.handoffVelocity[slot] = velocity;
+            voices.lastBendValue[slot] = static_cast<int>(stolenBend);
+            voices.startSample[slot] = startSample + stealRampSamples;
+            voices.nextUpdateSample[slot] = startSample + juce::jmax(1, stealRampSamples / stealRampSteps);
+        }
+
+        if (voices.nextUpdateSample[slot] < blockEnd)
+            updateQueue.push(slot, voices.nextUpdateSample);
+
+        if (!handOver)
+        {
+            voices.joinGroup(slot, zone.slotMask);
+            sendNoteOn(slot, velocity, samplePos);
+        }
+    };
+
+    auto stopNote = [&](int inputChannel, int noteNumber, int velocity, int samplePos)
+    {
+        BCS_TRACE_PHASE(phaseTracer, "note-off");
+
+        heldNotes.noteOff(noteNumber);
+
+        // Look up the voice started by this channel/note and send note off on its MPE channel
+        int slot = voices.findSlot(inputChannel, noteNumber);
+
+        if (slot == VoiceTable::noSlot)
+        {
+            // Played during bypass, so it sounds on the input channel unbent
+            auto &word = bypassedNotes[static_cast<size_t>(inputChannel - 1)][static_cast<size_t>(noteNumber >> 5)];
+            auto bit = 1u << (noteNumber & 31);
+
+            if ((word & bit) != 0)
+            {
+                word &= ~bit;
+                addChannelMessage(0x80, inputChannel, noteNumber, velocity, samplePos);
+            }
+
+            return;
+        }
+
+        // Held by the pedal: it sounds on until the pedal lifts, and is stolen before the
+        // voices still held
+        if (((sustainPedals >> (inputChannel - 1)) & 1u) != 0 && ((voices.handoffMask >> slot) & 1u) == 0)
+        {
+            voices.sustain(slot);
+            zoneForSlot(slot).allocator.setReleasing(slot + 1);
+            return;
+        }
+
+        releaseVoice(slot, velocity, samplePos);
+    };
+
+    // Chord memory: the key plays its voicing, in the key's zone, on channels taken together.
+    // The notes start on the same sample, unstrummed.
+    auto startChord = [&](int inputChannel, int key, int velocity, int samplePos)
+    {
+        BCS_TRACE_PHASE(phaseTracer, "note-on");
+
+        std::array<int, ChordMemory::maxNotes> notes;
+        std::array<int, ChordMemory::maxNotes> channels;
+        std::uint32_t stolenMask;
+
+        auto numNotes = ChordMemory::expand(params.chordVoicing, key, notes.data());
+        auto &zone = zoneForNewNote(key);
+        growAutoZone(zone, numNotes, samplePos);
+        numNotes = zone.allocator.allocateChord(notes.data(), numNotes, velocity, channels.data(), stolenMask);
+
+        // A stolen voice still answers to its key, and mustn't be taken for a retrigger of
+        // one of the chord's notes
+        for (auto mask = stolenMask; mask != 0; mask &= mask - 1)
+        {
+            auto stolen = lowestSetBit(mask);
+            BCS_LOG(realtimeLog, LogEvent::voiceStolen, sampleClock + samplePos, stolen + 1, voices.noteNumber[stolen]);
+            endVoice(stolen, 0, samplePos);
+            counters.steals.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for (int i = 0; i < numNotes; ++i)
+        {
+            auto channel = channels[static_cast<size_t>(i)];
+            startNote(inputChannel, notes[static_cast<size_t>(i)], velocity, samplePos, VoiceTable::noSlot,
+                      channel, ((stolenMask >> (channel - 1)) & 1u) != 0);
+        }
+
+        chordTriggers[static_cast<size_t>(inputChannel - 1)][static_cast<size_t>(key)] = static_cast<juce::int8>(params.chordVoicing + 1);
+    };
+
+    // The voicing the key started, even if chord memory has been changed since
+    auto stopChord = [&](int inputChannel, int key, int velocity, int samplePos)
+    {
+        BCS_TRACE_PHASE(phaseTracer, "note-off");
+
+        auto &trigger = chordTriggers[static_cast<size_t>(inputChannel - 1)][static_cast<size_t>(key)];
+        std::array<int, ChordMemory::maxNotes> notes;
+        auto numNotes = ChordMemory::expand(trigger - 1, key, notes.data());
+
+        for (int i = 0; i < numNotes; ++i)
+            stopNote(inputChannel, notes[static_cast<size_t>(i)], velocity, samplePos);
+
+        trigger = 0;
+    };
+
+    // Later notes of a strummed chord wait their turn; false if there's no room for another
+    auto holdBack = [&](juce::int64 sample, ScheduledEvent::Kind kind, int channel, int note, int velocity)
+    {
+        if (numStrummedEvents == maxStrummedEvents)
+            return false;
+
+        ScheduledEvent event;
+        event.kind = kind;
+        event.channel = channel;
+        event.note = note;
+        event.velocity = velocity;
+        scheduler.schedule(sample, strummedNoteRank, event);
+        ++numStrummedEvents;
+        return true;
+    };
+
+    // Everything scheduled before endSample, in time order: release bends that end free
+    // their channels, and strummed notes take their turn
+    auto runScheduledUntil = [&](juce::int64 endSample)
+    {
+        BCS_TRACE_PHASE(phaseTracer, "cleanup");
+
+        scheduler.drainUntil(endSample, [&](juce::int64 sample, const ScheduledEvent &event)
+        {
+            if (event.kind == ScheduledEvent::Kind::releaseEnd)
+            {
+                finishRelease(event.slot);
+                return;
+            }
+
+            --numStrummedEvents;
+            int samplePos = static_cast<int>(juce::jmax(static_cast<juce::int64>(0), sample - sampleClock));
+
+            sendBendsUntil(sampleClock + samplePos);
+            auto messagesBeforeEvent = messagesThisBlock;
+
+            if (event.kind == ScheduledEvent::Kind::strummedNoteOn)
+            {
+                // Strummed notes start one at a time, so each glides over the nearest held voice
+                juce::int8 legatoSlot = VoiceTable::noSlot;
+                auto note = event.note;
+
+                if (params.legato)
+                    planLegato(&note, 1, sample, &legatoSlot);
+
+                startNote(event.channel, event.note, event.velocity, samplePos, legatoSlot);
+            }
+            else
+                stopNote(event.channel, event.note, event.velocity, samplePos);
+
+            if (useBudget)
+                budgetTokens -= messagesThisBlock - messagesBeforeEvent;
+        });
+    };
+
+    // An onset in the audio input: the bends of held voices start again from it, and any
+    // glide is over
+    auto restartBendsAt = [&](juce::int64 sample)
+    {
+        runScheduledUntil(sample);
+        sendBendsUntil(sample);
+
+        for (auto mask = voices.activeMask & ~(voices.releasingMask | voices.handoffMask); mask != 0; mask &= mask - 1)
+        {
+            auto slot = lowestSetBit(mask);
+            auto i = static_cast<size_t>(slot);
+
+            voices.startSample[i] = sample;
+            voices.glideOffset[i] = 0.0f;
+            voices.envelopeSegment[i] = 0;
+
+            updateQueue.remove(slot, voices.nextUpdateSample);
+            voices.nextUpdateSample[i] = sample;
+
+            if (sample < blockEnd)
+                updateQueue.push(slot, voices.nextUpdateSample);
+        }
+
+        transientSample = neverSample;
+    };
+
+    strumChordPosition = -1;
+    legatoChordPosition = -1;
+
+    // Process incoming MIDI messages, decoded in one pass with each sample's note-offs first
+    endPhase(FlightRecord::setup);
+    decodeInput(midiMessages, numSamples);
+    endPhase(FlightRecord::decode);
+
+    if (activeOutputMode == OutputMode::singleChannel)
+        processSingleChannel(numSamples);
+
+    const auto *inputEnd = inputEvents.data() + inputEvents.size();
+
+    juce::int64 caughtUpTo = -1;
+
+    for (const auto *event = inputEvents.data(); event != inputEnd; ++event)
+    {
+        int samplePos = event->samplePosition;
+        auto eventSample = sampleClock + samplePos;
+
+        if (eventSample >= transientSample)
+            restartBendsAt(transientSample);
+
+        // Nothing an event does falls due on its own sample, so a burst on one sample catches up once
+        if (eventSample != caughtUpTo)
+        {
+            runScheduledUntil(eventSample + 1);
+            sendBendsUntil(eventSample);
+            caughtUpTo = eventSample;
+        }
+
+        auto messagesBeforeEvent = messagesThisBlock;
+
+        if (event->kind == InputEvent::Kind::noteOn && params.chordVoicing >= 0)
+        {
+            startChord(event->channel, event->note, event->velocity, samplePos);
+        }
+        else if (event->kind == InputEvent::Kind::noteOff
+                 && chordTriggers[static_cast<size_t>(event->channel - 1)][static_cast<size_t>(event->note)] != 0)
+        {
+            stopChord(event->channel, event->note, event->velocity, samplePos);
+        }
+        else if (event->kind == InputEvent::Kind::noteOn)
+        {
+            int inputChannel = event->channel;
+            int noteNumber = event->note;
+            auto &strumDelay = strumDelays[static_cast<size_t>(inputChannel - 1)][static_cast<size_t>(noteNumber)];
+            strumDelay = params.strumMode != StrumMode::off ? nextStrumDelay(event, inputEnd) : 0;
+
+            // Later notes of a strummed chord wait in the queue; if it is full they play now
+            if (strumDelay == 0 || !holdBack(eventSample + strumDelay, ScheduledEvent::Kind::strummedNoteOn, inputChannel, noteNumber, event->velocity))
+            {
+                strumDelay = 0;
+                auto legatoSlot = params.legato ? nextLegatoSlot(event, inputEnd) : VoiceTable::noSlot;
+                startNote(inputChannel, noteNumber, event->velocity, samplePos, legatoSlot);
+            }
+        }
+        else if (event->kind == InputEvent::Kind::noteOff)
+        {
+            // A strummed note ends as late as it started, so it keeps its length
+            int inputChannel = event->channel;
+            int noteNumber = event->note;
+            auto &strumDelay = strumDelays[static_cast<size_t>(inputChannel - 1)][static_cast<size_t>(noteNumber)];
+
+            if (strumDelay == 0 || !holdBack(eventSample + strumDelay, ScheduledEvent::Kind::strummedNoteOff, inputChannel, noteNumber, event->velocity))
+                stopNote(inputChannel, noteNumber, event->velocity, samplePos);
+
+            strumDelay = 0;
+        }
+        else if (event->packet != nullptr)
+        {
+            handlePerNoteInput(*event);
+        }
+        else
+        {
+            handleInputMessage(*event);
+        }
+
+        // Note and pass-through traffic spends from the same budget as the bends
+        if (useBudget)
+            budgetTokens -= messagesThisBlock - messagesBeforeEvent;
+    }
+
+    if (transientSample < blockEnd)
+        restartBendsAt(transientSample);
+
+    runScheduledUntil(blockEnd);
+    sendBendsUntil(blockEnd);
+
+    if (activeOutputMode == OutputMode::mpe)
+        updateAutoZone(numSamples);
+
+    if (useBudget)
+        refillBudget(numSamples - lastTick);
+
+    // Growing past the reservation means the audio thread just hit the allocator
+    jassert(outputMidi.data.size() <= static_cast<int>(reservedOutputBytes));
+
+    // Copy rather than swap so the reserved storage stays with us; the host's buffer only
+    // grows until it reaches its own steady-state size. outputMidi is already in time order,
+    // so its storage is copied over whole.
+    midiMessages.clear();
+
+    copyOutput(midiMessages);
+
+    if (params.serialOutput)
+        orderForRunningStatus(midiMessages);
+
+    if (traceRecorder.isCapturing())
+        recordTrace(midiMessages);
+
+    if (midiCapture.isCapturing())
+        captureOutput(midiMessages);
+
+    endPhase(FlightRecord::output);
+
+    if (params.fitDeadband)
+        fitDeadbandToBudget(numSamples);
+
+    sampleClock += numSamples;
+    publishVoicePositions();
+    hostBlockTally.inputEvents += static_cast<int>(inputEvents.size());
+    hostBlockTally.bendsSent += bendsThisBlock;
+}
+
+void PitchBendProcessor::processBypassedMidi(int numSamples, juce::MidiBuffer &midiMessages)
+{
+    // Bypassed, the latency still stands
+    delayInput(numSamples, midiMessages);
+    umpInputCursor = umpInputRuns.size();
+
+    for (auto &queue : inputBusQueues)
+        queue.cursor = queue.events.size();
+
+    // Entering bypass: end just the sounding voices, on their own channels, and centre their
+    // bends so notes played through meanwhile aren't detuned. Strummed notes not yet started
+    // are dropped.
+    if (voices.activeMask != 0 || numStrummedEvents != 0)
+    {
+        outputMidi.clear();
+        umpOutput.clear();
+        lastOutputPosition = 0;
+
+        // The pedal passes straight through while bypassed, so its state goes too
+        flushVoices(0);
+
+        // Ahead of the input, which then goes through as it came
+        for (const auto metadata : midiMessages)
+            appendMidiEvent(outputMidi, metadata.data, metadata.numBytes, metadata.samplePosition);
+
+        midiMessages.clear();
+        midiMessages.data.addArray(outputMidi.data);
+    }
+
+    for (const auto metadata : midiMessages)
+    {
+        auto status = metadata.data[0] & 0xf0;
+
+        if (metadata.numBytes < 3 || (status != 0x90 && status != 0x80))
+            continue;
+
+        auto &word = bypassedNotes[static_cast<size_t>(metadata.data[0] & 0x0f)][static_cast<size_t>(metadata.data[1] >> 5)];
+        auto bit = 1u << (metadata.data[1] & 31);
+        word = status == 0x90 && metadata.data[2] != 0 ? word | bit : word & ~bit;
+    }
+
+    // Input goes through unseen by the mirror
+    receiverState.forget();
+    generatedState.forget();
+    sampleClock += numSamples;
+}
+
+bool PitchBendProcessor::isParked() const
+{
+    // A parameter or program change still goes through a full block, so its derived state is
+    // in place before anything plays; so does a zone configuration still to be sent
+    return voices.activeMask == 0 && numStrummedEvents == 0
+           && control.parameterGeneration.load(std::memory_order_acquire) == snapshotGeneration
+           && (activeOutputMode != OutputMode::mpe || (!control.zoneConfigRequested.load() && nextZoneConfigMessage >= numZoneConfigMessages))
+           && !receiverDiscovery.hasOutgoing();
+}
+
+bool PitchBendProcessor::isQuiet() const
+{
+    return isParked() && !flushPending && pendingPreset == nullptr && pendingBendMask == 0 && singleChannel.numHeld == 0
+           && heldNotes.getLowestNote() < 0 && upcomingNotes.getLowestNote() < 0 && lookaheadLine.isEmpty() && !hasUmpInput()
+           && !hasBusInput();
+}
+
+template <typename Self, typename Visitor>
+void PitchBendProcessor::visitCheckpointState(Self &self, Visitor &&visit)
+{
+    // Voices, the scheduler and the lookahead are empty, and a voice's slot is set afresh by
+    // its next note. Chase onsets are left out: they only count for keys held over a jump.
+    for (auto &zone : self.zones)
+    {
+        visit(zone.masterBend);
+        visit(zone.rampStartAmount);
+        visit(zone.rampStartCurve);
+    }
+
+    visit(self.receiverState);
+    visit(self.generatedState);
+    visit(self.runningStatus);
+    visit(self.budgetTokens);
+    visit(self.bendRate);
+    visit(self.sendThreshold);
+    visit(self.sustainPedals);
+    visit(self.mpeInputState);
+    visit(self.perNoteBendSemitones);
+    visit(self.inputPressure);
+    visit(self.bypassedNotes);
+    visit(self.morphPosition);
+    visit(self.singleChannel.channel);
+    visit(self.singleChannel.lastValue);
+    visit(self.strumRandom);
+    visit(self.transportWasPlaying);
+    visit(self.expectedTimelineSample);
+}
+
+bool PitchBendProcessor::saveCheckpoint(EngineCheckpoint &checkpoint) const
+{
+    if (!isQuiet() || activeSharedPool != 0 || autoZoneChannels != 0 || receiverDiscovery.isRunning())
+        return false;
+
+    checkpoint.sampleClock = sampleClock;
+    checkpoint.state.reset();
+
+    juce::MemoryOutputStream out(checkpoint.state, false);
+
+    for (const auto &zone : zones)
+    {
+        auto order = zone.allocator.getFreeOrder();
+        out.write(order.data(), order.size());
+    }
+
+    visitCheckpointState(*this, [&out](const auto &value)
+                         {
+                             static_assert(std::is_trivially_copyable_v<std::decay_t<decltype(value)>>);
+                             out.write(&value, sizeof(value));
+                         });
+    out.flush();
+    return true;
+}
+
+void PitchBendProcessor::restoreCheckpoint(const EngineCheckpoint &checkpoint)
+{
+    juce::MemoryInputStream in(checkpoint.state, false);
+
+    for (auto &zone : zones)
+    {
+        std::array<std::uint8_t, 16> order{};
+        in.read(order.data(), static_cast<int>(order.size()));
+        zone.allocator.setFreeOrder(order);
+    }
+
+    visitCheckpointState(*this, [&in](auto &value) { in.read(&value, static_cast<int>(sizeof(value))); });
+
+    sampleClock = checkpoint.sampleClock;
+    scheduler.jumpTo(sampleClock);
+
+    // The checkpoint's instance had sent its zone configuration and chased nothing; the morph
+    // table is rebuilt for the restored position
+    control.zoneConfigRequested = false;
+    nextZoneConfigMessage = numZoneConfigMessages;
+    chaseSample = -1;
+    flushPending = false;
+    blendedPosition = -1.0f;
+}
+
+bool PitchBendProcessor::passesThroughUntouched(const juce::MidiBuffer &midiMessages, int numSamples) const
+{
+    // With no voices, expression has nowhere to go and passes through; what's left to catch
+    // is anything that starts a note, holds one, or is consumed
+    int lastPosition = 0;
+
+    for (const auto metadata : midiMessages)
+    {
+        const auto *data = metadata.data;
+
+        if (metadata.samplePosition < lastPosition || metadata.samplePosition >= numSamples)
+            return false;
+
+        lastPosition = metadata.samplePosition;
+
+        if (data[0] == 0xf0)
+        {
+            // Possibly MIDI-CI, which discovery may take
+            if (metadata.numBytes >= 4 && data[1] == 0x7e && data[3] == 0x0d)
+                return false;
+
+            continue;
+        }
+
+        if (data[0] > 0xf0)
+            continue;
+
+        auto status = data[0] & 0xf0;
+
+        if (status == 0x80 || status == 0x90)
+            return false;
+
+        if (status == 0xb0 && metadata.numBytes >= 3)
+        {
+            auto inScope = ((params.scopeChannels >> (data[0] & 0x0f)) & 1) != 0;
+
+            if ((data[1] == 64 && inScope) || (params.morphEnabled && data[1] == params.morphController))
+                return false;
+        }
+
+        if (status == 0xc0 && metadata.numBytes >= 2 && presetBank->getPreset(data[1]) != nullptr)
+            return false;
+    }
+
+    return true;
+}
+
+void PitchBendProcessor::recordFlight(double processSeconds, int numSamples, const juce::MidiBuffer &output)
+{
+    if (!flightRecorder.isRecording())
+        return;
+
+    // After the block, with the clock already moved on past it
+    FlightRecord record;
+    record.sample = sampleClock - numSamples;
+    record.endTicks = juce::Time::getHighResolutionTicks();
+    record.processSeconds = static_cast<float>(processSeconds);
+    record.blockSeconds = static_cast<float>(numSamples / currentSampleRate);
+
+    for (size_t phase = 0; phase < phaseTicks.size(); ++phase)
+        record.phaseSeconds[phase] = static_cast<float>(juce::Time::highResolutionTicksToSeconds(phaseTicks[phase]));
+
+    record.inputEvents = static_cast<juce::uint16>(juce::jmin(hostBlockTally.inputEvents, 0xffff));
+    record.outputEvents = static_cast<juce::uint16>(juce::jmin(output.getNumEvents(), 0xffff));
+    record.bendsSent = static_cast<juce::uint16>(juce::jmin(hostBlockTally.bendsSent, 0xffff));
+    record.activeVoices = static_cast<juce::uint8>(juce::countNumberOfBits(voices.activeMask));
+    record.qualityLevel = static_cast<juce::uint8>(qualityLevel);
+
+    // An offline render running slower than real time is no overrun
+    flightRecorder.record(record, processSeconds > record.blockSeconds && !isNonRealtime());
+}
+
+void PitchBendProcessor::pushTelemetry(double processSeconds, int numSamples)
+{
+    auto blockSeconds = static_cast<float>(numSamples / currentSampleRate);
+    auto activeVoices = static_cast<juce::uint8>(juce::countNumberOfBits(voices.activeMask));
+    auto subscribed = telemetrySubscribed.load(std::memory_order_acquire);
+
+    if (subscribed)
+    {
+        TelemetryRecord record;
+        record.processSeconds = static_cast<float>(processSeconds);
+        record.blockSeconds = blockSeconds;
+        record.channelMask = voices.activeMask;
+        record.bendsSent = static_cast<juce::uint16>(juce::jmin(hostBlockTally.bendsSent, 0xffff));
+        record.activeVoices = activeVoices;
+        record.qualityLevel = static_cast<juce::uint8>(qualityLevel);
+        record.scratchBytes = static_cast<juce::uint32>(scratchBytesUsed());
+
+        // Only this thread adds to the counters, so the change since the last record is this
+        // block's. A new subscriber's first record starts from the totals as they are now.
+        auto blockShare = [resync = !telemetryWasSubscribed](const std::atomic<juce::uint64> &counter, juce::uint64 &lastTotal)
+        {
+            auto total = counter.load(std::memory_order_relaxed);
+            auto change = resync ? 0 : std::min<std::uint64_t>(total - lastTotal, 0xffff);
+            lastTotal = total;
+            return static_cast<juce::uint16>(change);
+        };
+
+        record.coalescedBends = blockShare(counters.coalescedBends, telemetryCoalescedBends);
+        record.droppedBends = blockShare(counters.droppedBends, telemetryDroppedBends);
+        record.steals = blockShare(counters.steals, telemetrySteals);
+        telemetry.push(record);
+    }
+
+    telemetryWasSubscribed = subscribed;
+
+    counters.bendsSent.fetch_add(static_cast<juce::uint64>(hostBlockTally.bendsSent), std::memory_order_relaxed);
+    counters.activeVoices.store(activeVoices, std::memory_order_relaxed);
+
+    // Only this thread writes it
+    if (auto scratchBytes = scratchBytesUsed(); scratchBytes > counters.scratchHighWater.load(std::memory_order_relaxed))
+        counters.scratchHighWater.store(scratchBytes, std::memory_order_relaxed);
+
+    if (processSeconds > blockSeconds)
+        BCS_LOG(realtimeLog, LogEvent::blockOverrun, sampleClock, juce::roundToInt(processSeconds * 1.0e6),
+                juce::roundToInt(blockSeconds * 1.0e6f));
+}
+
+void PitchBendProcessor::subscribeTelemetry()
+{
+    // Records left from an earlier editor would show as this one's first frames
+    telemetry.discard();
+    telemetrySubscribed.store(true, std::memory_order_release);
+}
+
+void PitchBendProcessor::recordTrace(const juce::MidiBuffer &output)
+{
+    // Exactly what the host receives, after coalescing
+    for (const auto metadata : output)
+        traceRecorder.recordMidi(sampleClock + metadata.samplePosition, metadata.data, metadata.numBytes);
+
+    for (const auto &timed : umpOutput)
+        traceRecorder.recordPacket(sampleClock + timed.samplePosition, timed.packet);
+}
+
+void PitchBendProcessor::captureOutput(const juce::MidiBuffer &output)
+{
+    for (const auto metadata : output)
+        midiCapture.record(sampleClock + metadata.samplePosition, metadata.data, metadata.numBytes);
+}
+
+void PitchBendProcessor::pushOscVoices()
+{
+    // Every sounding voice, and once more each voice that ended since the last block
+    for (auto mask = voices.activeMask | oscVoiceMask; mask != 0; mask &= mask - 1)
+    {
+        auto slot = lowestSetBit(mask);
+        auto semitones = static_cast<float>(voices.lastBendValue[slot]) / semitoneScale;
+
+        OscVoiceRecord record;
+        record.voice = static_cast<juce::uint8>(slot);
+        record.note = static_cast<juce::uint8>(voices.noteNumber[slot]);
+        record.bend = semitones;
+        record.pitch = static_cast<float>(voices.noteNumber[slot]) + semitones;
+        record.sounding = voices.isActive(slot);
+        oscStreamer.push(record);
+    }
+
+    oscVoiceMask = voices.activeMask;
+}
+
+void PitchBendProcessor::publishVoicePositions()
+{
+    auto subscribed = telemetrySubscribed.load(std::memory_order_acquire);
+
+    if (!subscribed && !sharedVoiceStream.isStreaming())
+        return;
+
+    auto &positions = voicePositions.getWriteBuffer();
+    positions.activeMask = voices.activeMask;
+
+    VoiceMap map;
+    map.activeMask = voices.activeMask;
+    map.releasingMask = voices.releasingMask;
+
+    for (auto mask = voices.activeMask; mask != 0; mask &= mask - 1)
+    {
+        int slot = lowestSetBit(mask);
+        auto i = static_cast<size_t>(slot);
+        map.note[i] = static_cast<juce::uint8>(voices.noteNumber[i]);
+        map.inputChannel[i] = static_cast<juce::uint8>(voices.inputChannel[i]);
+        map.bendSemitones[i] = static_cast<float>(voices.lastBendValue[i]) / semitoneScale;
+
+        auto elapsed = static_cast<float>(sampleClock - voices.startSample[slot]);
+        auto duration = static_cast<float>(zoneForSlot(slot).durationInSamples);
+
+        if (voiceScalingActive)
+            elapsed *= voices.inverseTimeScale[static_cast<size_t>(slot)];
+
+        positions.progress[static_cast<size_t>(slot)] = juce::jlimit(0.0f, 1.0f, elapsed / duration);
+    }
+
+    if (subscribed)
+    {
+        voicePositions.publish();
+        voiceMap.write(map);
+    }
+
+    if (sharedVoiceStream.isStreaming())
+    {
+        SharedVoiceFrame frame;
+        frame.sample = sampleClock;
+        frame.sampleRate = static_cast<float>(currentSampleRate);
+        frame.activeMask = map.activeMask;
+        frame.releasingMask = map.releasingMask;
+        frame.bend = map.bendSemitones;
+        frame.note = map.note;
+        frame.inputChannel = map.inputChannel;
+
+        for (auto mask = map.activeMask; mask != 0; mask &= mask - 1)
+        {
+            auto i = static_cast<size_t>(lowestSetBit(mask));
+            frame.pitch[i] = static_cast<float>(map.note[i]) + map.bendSemitones[i];
+            frame.progress[i] = positions.progress[i];
+        }
+
+        sharedVoiceStream.write(frame);
+    }
+}
+
+void PitchBendProcessor::orderForRunningStatus(juce::MidiBuffer &buffer)
+{
+    serialMidi.clear();
+
+    auto end = buffer.cend();
+
+    for (auto groupStart = buffer.cbegin(); groupStart != end;)
+    {
+        auto samplePos = (*groupStart).samplePosition;
+
+        // Channels in the order they first appear on this sample, led by the one the last
+        // message sent left running
+        std::array<int, 16> rank;
+        rank.fill(-1);
+        int numChannels = 0;
+
+        if (runningStatus >= 0)
+            rank[static_cast<size_t>(runningStatus & 0x0f)] = numChannels++;
+
+        auto groupEnd = groupStart;
+
+        for (; groupEnd != end && (*groupEnd).samplePosition == samplePos; ++groupEnd)
+        {
+            auto status = (*groupEnd).data[0];
+            auto &channelRank = rank[static_cast<size_t>(status & 0x0f)];
+
+            if (status < 0xf0 && channelRank < 0)
+                channelRank = numChannels++;
+        }
+
+        // One pass per channel keeps each channel's own messages in order, then the system
+        // messages, which cancel running status anyway
+        for (int pass = 0; pass <= numChannels; ++pass)
+        {
+            for (auto it = groupStart; it != groupEnd; ++it)
+            {
+                const auto metadata = *it;
+                auto status = metadata.data[0];
+                auto isChannelMessage = status < 0xf0;
+
+                if (isChannelMessage ? rank[static_cast<size_t>(status & 0x0f)] != pass : pass != numChannels)
+                    continue;
+
+                appendMidiEvent(serialMidi, metadata.data, metadata.numBytes, samplePos);
+
+                // Real-time messages leave running status alone; other system messages end it
+                if (isChannelMessage)
+                    runningStatus = status;
+                else if (status < 0xf8)
+                    runningStatus = -1;
+            }
+        }
+
+        groupStart = groupEnd;
+    }
+
+    jassert(serialMidi.data.size() <= static_cast<int>(reservedOutputBytes));
+
+    buffer.clear();
+    buffer.data.addArray(serialMidi.data);
+}
+
+void PitchBendProcessor::copyOutput(juce::MidiBuffer &destination)
+{
+    BCS_TRACE_PHASE(phaseTracer, "swap");
+
+    // Coalesced streams: pitch bend on channels 0..15, channel pressure on 16..31
+    auto streamOf = [](const juce::uint8 *data)
+    {
+        auto type = data[0] & 0xf0;
+        auto channel = data[0] & 0x0f;
+        return type == 0xe0 ? channel : type == 0xd0 ? 16 + channel : -1;
+    };
+
+    auto coalesce = params.coalesceOutput;
+    supersededEvents.clear();
+
+    // Mark every event that a later one in the same stream and slot overrides
+    if (coalesce)
+    {
+        std::array<int, 32> lastEvent;
+        std::array<int, 32> lastSlot;
+        lastEvent.fill(-1);
+
+        for (const auto metadata : outputMidi)
+        {
+            auto index = static_cast<int>(supersededEvents.size());
+            supersededEvents.push_back(0);
+
+            auto stream = streamOf(metadata.data);
+
+            // A note on or off in between keeps the bend its release or attack was heard at
+            if ((metadata.data[0] & 0xe0) == 0x80)
+            {
+                auto channel = static_cast<size_t>(metadata.data[0] & 0x0f);
+                lastEvent[channel] = -1;
+                lastEvent[16 + channel] = -1;
+            }
+
+            if (stream < 0)
+                continue;
+
+            auto s = static_cast<size_t>(stream);
+            auto slot = metadata.samplePosition / coalesceSlotSamples;
+
+            if (lastEvent[s] >= 0 && lastSlot[s] == slot)
+                supersededEvents[static_cast<size_t>(lastEvent[s])] = 1;
+
+            lastEvent[s] = index;
+            lastSlot[s] = slot;
+        }
+
+        jassert(supersededEvents.size() <= supersededEvents.capacity());
+    }
+
+    // Then a bend within the deadband of the one last sent, and anything the receiver
+    // already has, goes no further. A bend to either end of the wheel always goes, or one
+    // pinned there would stop up to a deadband short of it.
+    auto deadband = coalesce ? juce::roundToInt(params.coalesceDeadbandCents * 8192.0f / (activeBendRange * 100.0f)) : 0;
+    size_t index = 0;
+    juce::uint64 saved = 0;
+
+    for (const auto metadata : outputMidi)
+    {
+        bool keep = !coalesce || supersededEvents[index++] == 0;
+
+        if (keep && deadband > 0 && (metadata.data[0] & 0xf0) == 0xe0 && metadata.numBytes == 3)
+        {
+            auto last = receiverState.getBend(metadata.data[0] & 0x0f);
+            auto value = metadata.data[1] | (metadata.data[2] << 7);
+            keep = last < 0 || std::abs(value - last) > deadband || (isPitchWheelRail(value) && value != last);
+        }
+
+        if (keep && receiverState.update(metadata.data, metadata.numBytes))
+            appendMidiEvent(destination, metadata.data, metadata.numBytes, metadata.samplePosition);
+        else
+            ++saved;
+    }
+
+    counters.savedMessages.fetch_add(saved, std::memory_order_relaxed);
+}
+
+// The command line tools build without the editor, so they need no OpenGL
+bool PitchBendProcessor::hasEditor() const
+{
+#if BCS_HEADLESS
+    return false;
+#else
+    return true;
+#endif
+}
+
+juce::AudioProcessorEditor *PitchBendProcessor::createEditor()
+{
+#if BCS_HEADLESS
+    return nullptr;
+#else
+    return new PitchBendEditor(*this);
+#endif
+}
+
+void PitchBendProcessor::getStateInformation(juce::MemoryBlock &destData)
+{
+    // Read first: a change made while writing leaves the cache stale for the next call
+    auto generation = control.parameterGeneration.load(std::memory_order_acquire);
+    const juce::ScopedLock lock(stateCacheLock);
+
+    if (cachedState.isEmpty() || generation != cachedStateGeneration)
+    {
+        stateSerializer.write(cachedState);
+        cachedStateGeneration = generation;
+    }
+
+    destData = cachedState;
+}
+
+void PitchBendProcessor::setStateInformation(const void *data, int sizeInBytes)
+{
+    if (!stateSerializer.read(data, sizeInBytes))
+        setLegacyStateInformation(data, sizeInBytes);
+
+    setCurveExpression(getCurveExpression());
+    loadMidiLearn();
+}
+
+// Sessions saved before the versioned format: raw values in a fixed order
+void PitchBendProcessor::setLegacyStateInformation(const void *data, int sizeInBytes)
+{
+    juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes), false);
 
     *bendAmount = stream.readFloat();
     *bendTime = stream.readFloat();
     *bendCurve = stream.readFloat();
+
+    // Older sessions stop after the bend parameters
+    if (!stream.isExhausted())
+    {
+        *channelRotation = stream.readInt();
+        *stealPolicy = stream.readInt();
+    }
+
+    if (!stream.isExhausted())
+    {
+        *updateMode = stream.readInt();
+        *updateRate = stream.readFloat();
+        *updatesPerBend = stream.readInt();
+    }
+
+    if (!stream.isExhausted())
+    {
+        *budgetEnabled = stream.readBool();
+        *messageBudget = stream.readInt();
+    }
+
+    if (!stream.isExhausted())
+        *outputMode = stream.readInt();
+
+    if (!stream.isExhausted())
+    {
+        *tempoSync = stream.readBool();
+        *syncedBendTime = stream.readInt();
+    }
+
+    if (!stream.isExhausted())
+        *smoothAutomation = stream.readBool();
 }
 
 juce::AudioProcessor *JUCE_CALLTYPE createPluginFilter()
@@ -1,17 +1,82 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <cstddef>
+#include "BendEnvelope.h"
+#include "CacheLine.h"
+#include "ChannelAllocator.h"
+#include "LinkedSettings.h"
+#include "SharedChannelPool.h"
+#include "ChordAnalyzer.h"
+#include "ChordMemory.h"
+#include "FastRandom.h"
+#include "HostNotifier.h"
+#include "PresetBank.h"
+#include "CurveTable.h"
+#include "CurveTableCache.h"
+#include "LoadMonitor.h"
+#include "MidiCapture.h"
+#include "OscStreamer.h"
+#include "PitchTracker.h"
+#include "PreviewSynth.h"
+#include "ReceiverDiscovery.h"
+#include "ReceiverMirror.h"
+#include "ScaleTable.h"
+#include "ScratchArena.h"
+#include "SeqLock.h"
+#include "SharedVoiceStream.h"
+#include "StateSerializer.h"
+#include "TimingWheel.h"
+#include "Telemetry.h"
+#include "TraceRecorder.h"
+#include "RealtimeLog.h"
+#include "PhaseTracer.h"
+#include "FlightRecorder.h"
+#include "KernelDispatch.h"
+#include "TrackingTable.h"
+#include "TransientDetector.h"
+#include "TripleBuffer.h"
+#include "ConfigPublisher.h"
+#include "TuningTable.h"
+#include "Vibrato.h"
+#include "VoiceMatcher.h"
+#include "Ump.h"
 
-class PitchBendProcessor : public juce::AudioProcessor
+#if BCS_CLAP
+#include <clap-juce-extensions/clap-juce-extensions.h>
+#endif
+
+class PitchBendProcessor : public juce::AudioProcessor,
+#if BCS_CLAP
+                           public clap_juce_extensions::clap_properties,
+                           public clap_juce_extensions::clap_juce_audio_processor_capabilities,
+#endif
+                           private juce::AudioProcessorParameter::Listener,
+                           private juce::Timer
 {
 public:
     PitchBendProcessor();
     ~PitchBendProcessor() override;
 
+#if BCS_CLAP
+    // Under CLAP the bends go out as note expressions (ClapOutput.cpp): output runs in the
+    // per-note mode whatever outputMode says, and the block's notes and per-note bends are
+    // handed to the host as CLAP events in place of MIDI
+    bool supportsOutboundEvents() override { return true; }
+    void addOutboundEventsToQueue(const clap_output_events *outEvents, const juce::MidiBuffer &midiBuffer, int sampleOffset) override;
+#endif
+
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void setNonRealtime(bool isNonRealtime) noexcept override;
+    void reset() override;
+    void audioWorkgroupContextChanged(const juce::AudioWorkgroup &workgroup) override;
     bool isBusesLayoutSupported(const BusesLayout &layouts) const override;
     void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
+    void processBlock(juce::AudioBuffer<double> &, juce::MidiBuffer &) override;
+    void processBlockBypassed(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
+    void processBlockBypassed(juce::AudioBuffer<double> &, juce::MidiBuffer &) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     juce::AudioProcessorEditor *createEditor() override;
     bool hasEditor() const override;
@@ -31,29 +96,1744 @@ public:
     void getStateInformation(juce::MemoryBlock &destData) override;
     void setStateInformation(const void *data, int sizeInBytes) override;
 
-    // Parameters
+    // Parameters, owned by the value tree state; the typed pointers are for processBlock
+    juce::AudioProcessorValueTreeState parameters;
+
+    // Every parameter the plugin sets itself, and every display change, goes to the host
+    // through here, batched on the message thread
+    HostNotifier hostNotifier;
+
     juce::AudioParameterFloat *bendAmount;
     juce::AudioParameterFloat *bendTime;
     juce::AudioParameterFloat *bendCurve;
+    juce::AudioParameterChoice *channelRotation;
+    juce::AudioParameterChoice *stealPolicy;
+    juce::AudioParameterChoice *voiceOverflow;
+    juce::AudioParameterChoice *notePriority;
+    juce::AudioParameterChoice *updateMode;
+    juce::AudioParameterFloat *updateRate;
+    juce::AudioParameterFloat *updateCeiling;
+    juce::AudioParameterInt *updatesPerBend;
+    juce::AudioParameterBool *smoothAutomation;
+    juce::AudioParameterBool *tempoSync;
+    juce::AudioParameterChoice *syncedBendTime;
+    juce::AudioParameterChoice *outputMode;
+    juce::AudioParameterBool *budgetEnabled;
+    juce::AudioParameterInt *messageBudget;
+    juce::AudioParameterBool *morphEnabled;
+    juce::AudioParameterInt *morphController;
+    juce::AudioParameterInt *morphFrom;
+    juce::AudioParameterInt *morphTo;
+    juce::AudioParameterBool *coalesceOutput;
+    juce::AudioParameterFloat *coalesceDeadband;
+    juce::AudioParameterBool *openGLRendering; // Editor only, not automatable
+    juce::AudioParameterBool *zoneSplit;
+    juce::AudioParameterInt *splitNote;
+    juce::AudioParameterInt *upperZoneChannels;
+    juce::AudioParameterFloat *upperBendAmount;
+    juce::AudioParameterFloat *upperBendTime;
+    juce::AudioParameterFloat *upperBendCurve;
+    juce::AudioParameterInt *bendRange;
+    juce::AudioParameterChoice *amountUnits;
+    juce::AudioParameterFloat *bendSemitones;
+    juce::AudioParameterFloat *upperBendSemitones;
+    juce::AudioParameterChoice *stackMode;
+    juce::AudioParameterChoice *strumMode;
+    juce::AudioParameterFloat *strumSpread;
+    juce::AudioParameterBool *legato;
+    juce::AudioParameterFloat *glideTime;
+    juce::AudioParameterBool *releaseBend;
+    juce::AudioParameterFloat *releaseAmount;
+    juce::AudioParameterFloat *releaseTime;
+    juce::AudioParameterFloat *holdTime;
+    juce::AudioParameterFloat *returnTime;
+    juce::AudioParameterFloat *returnCurve;
+    juce::AudioParameterInt *bendLayerCount;
+
+    struct LayerParameters
+    {
+        juce::AudioParameterFloat *amount, *time, *curve, *delay;
+    };
+
+    static constexpr int maxBendLayers = 3;
+    std::array<LayerParameters, maxBendLayers - 1> layerParameters{};
+
+    juce::AudioParameterFloat *velocityToAmount;
+    juce::AudioParameterFloat *velocityToTime;
+    juce::AudioParameterFloat *velocityCurve;
+    juce::AudioParameterFloat *keyToAmount;
+    juce::AudioParameterFloat *keyToTime;
+    juce::AudioParameterFloat *keyCurve;
+    juce::AudioParameterFloat *humanizeAmount;
+    juce::AudioParameterFloat *humanizeTime;
+    juce::AudioParameterFloat *humanizeCurve;
+    juce::AudioParameterFloat *pressureToAmount;
+    juce::AudioParameterFloat *pressureSmoothing;
+    juce::AudioParameterBool *oscOutput;
+    juce::AudioParameterInt *oscPort;
+    juce::AudioParameterFloat *oscRate;
+    juce::AudioParameterBool *sharedMemoryOutput;
+    juce::AudioParameterFloat *bendDeadband;
+    juce::AudioParameterFloat *curveError;
+    juce::AudioParameterFloat *receiverSmoothing;
+    juce::AudioParameterBool *adaptiveQuality;
+    juce::AudioParameterFloat *adaptiveThreshold;
+    juce::AudioParameterBool *fixedPoint;
+    juce::AudioParameterBool *fitDeadband;
+    juce::AudioParameterBool *offlineQuality;
+    juce::AudioParameterFloat *stealRamp;
+    juce::AudioParameterBool *serialOutput;
+    juce::AudioParameterChoice *scopeChannel;
+    juce::AudioParameterInt *scopeLowNote;
+    juce::AudioParameterInt *scopeHighNote;
+    juce::AudioParameterFloat *retriggerDebounce;
+    juce::AudioParameterInt *ccHysteresis;
+    juce::AudioParameterFloat *ccMaxRate;
+    juce::AudioParameterBool *previewSynth;
+    juce::AudioParameterBool *masterBend;
+    juce::AudioParameterFloat *vibratoDepth;
+    juce::AudioParameterFloat *vibratoRate;
+    juce::AudioParameterFloat *vibratoDelay;
+    juce::AudioParameterFloat *vibratoSpread;
+    juce::AudioParameterBool *pressureLane;
+    juce::AudioParameterInt *pressureFrom;
+    juce::AudioParameterInt *pressureTo;
+    juce::AudioParameterBool *timbreLane;
+    juce::AudioParameterInt *timbreFrom;
+    juce::AudioParameterInt *timbreTo;
+    juce::AudioParameterBool *latchParameters;
+    juce::AudioParameterBool *releaseOnStop;
+    juce::AudioParameterFloat *lookaheadTime;
+    juce::AudioParameterChoice *bendTargetMode;
+    juce::AudioParameterChoice *targetScale;
+    juce::AudioParameterChoice *targetScaleRoot;
+    juce::AudioParameterChoice *chordMemory;
+    juce::AudioParameterBool *transientRetrigger;
+    juce::AudioParameterFloat *transientThreshold;
+    juce::AudioParameterChoice *mpeInput;
+    juce::AudioParameterInt *sharedPool;
+    juce::AudioParameterBool *autoZoneSize;
+    juce::AudioParameterInt *linkGroup;
+
+    // Read-only meters, updated from the counters below by the timer
+    juce::AudioParameterFloat *meterVoices;
+    juce::AudioParameterFloat *meterBendRate;
+    juce::AudioParameterFloat *meterSteals;
+    juce::AudioParameterFloat *meterLoad;
+
+    // The lower zone's bend amount as a fraction of the receiver's bend range, whichever
+    // units it is set in; for display on the message thread
+    float getBendAmountAsFraction() const;
+
+    // Bends held back by the bandwidth budget: a later message carried their value
+    // (coalesced), or the voice ended before it could be sent (dropped)
+    juce::uint64 getCoalescedBendCount() const { return counters.coalescedBends.load(std::memory_order_relaxed); }
+    juce::uint64 getDroppedBendCount() const { return counters.droppedBends.load(std::memory_order_relaxed); }
+
+    // Outgoing MIDI 1.0 messages removed by output coalescing
+    juce::uint64 getSavedMessageCount() const { return counters.savedMessages.load(std::memory_order_relaxed); }
+
+    // Running totals behind the meters, for readers on any thread
+    juce::uint64 getBendsSentCount() const { return counters.bendsSent.load(std::memory_order_relaxed); }
+    juce::uint64 getStealCount() const { return counters.steals.load(std::memory_order_relaxed); }
+    juce::uint64 getDroppedNoteCount() const { return counters.droppedNotes.load(std::memory_order_relaxed); }
+    juce::uint64 getDroppedInputCount() const { return counters.droppedInput.load(std::memory_order_relaxed); }
+    int getActiveVoiceCount() const { return counters.activeVoices.load(std::memory_order_relaxed); }
+
+    // The most of the per-block scratch arena any block has filled since prepareToPlay, and
+    // what the arena holds, in bytes
+    size_t getScratchHighWater() const { return counters.scratchHighWater.load(std::memory_order_relaxed); }
+    size_t getScratchCapacity() const { return scratchCapacity.load(std::memory_order_relaxed); }
+
+    // Per-block telemetry for the editor; only one reader may drain it. The audio thread
+    // writes it, and the voice positions and map below, only while the editor is subscribed,
+    // so an instance with its editor closed spends nothing on display. Message thread.
+    void subscribeTelemetry();
+    void unsubscribeTelemetry() { telemetrySubscribed.store(false, std::memory_order_release); }
+    int readTelemetry(TelemetryRecord *destination, int maxRecords) { return telemetry.read(destination, maxRecords); }
+
+    // Load of this instance against each block's real-time budget, including the worst block
+    LoadMonitor &getLoadMonitor() { return loadMonitor; }
+
+    // Bytes this instance holds, by what holds them. The object counts everything kept in
+    // place, the voice table and the scheduler among it; the rest is what it has allocated,
+    // as reserved in prepareToPlay. Curve tables are shared and counted by
+    // CurveTableCache::getMemoryBytes instead. Message thread only.
+    struct MemoryFootprint
+    {
+        size_t object = 0;
+        size_t voices = 0;      // Part of the object
+        size_t scheduler = 0;   // Part of the object
+        size_t buffers = 0;     // Input, output and lookahead buffers for one block
+        size_t bendStreams = 0; // Offline rendering's per-sample streams
+        size_t tables = 0;      // Envelope, tuning and the curve expression's table
+        size_t diagnostics = 0; // Trace, capture, log and phase tracing rings and the flight recorder, once started
+        size_t savedState = 0;
+
+        size_t total() const { return object + buffers + bendStreams + tables + diagnostics + savedState; }
+    };
+
+    MemoryFootprint getMemoryFootprint() const;
+
+    // What processBlock carries from one note to the next, taken between notes: the channel
+    // rotation, what the receiver was last sent, the budget, pedals and input expression.
+    // Another instance with the same settings restored from it plays on as this one would,
+    // so a long render can be split at quiet points and its segments rendered in parallel.
+    struct EngineCheckpoint
+    {
+        juce::int64 sampleClock = 0;
+        juce::MemoryBlock state;
+
+        bool operator==(const EngineCheckpoint &other) const { return sampleClock == other.sampleClock && state == other.state; }
+        bool operator!=(const EngineCheckpoint &other) const { return !operator==(other); }
+    };
+
+    // Nothing sounding, held, scheduled or waiting in the lookahead, and nothing still to send
+    bool isQuiet() const;
+
+    // Fails unless quiet, and with a shared channel pool, an auto-sized zone or MIDI-CI
+    // discovery, which keep state outside the instance. Both on the audio thread or with
+    // none running; restore after at least one block, so the parameters have been taken.
+    bool saveCheckpoint(EngineCheckpoint &checkpoint) const;
+    void restoreCheckpoint(const EngineCheckpoint &checkpoint);
+
+    // Loads a Scala scale and optional keyboard mapping (an empty File for none) on a
+    // background thread; the table is swapped in at the start of a later block. onLoaded
+    // runs on the message thread with an empty string, or the reason the files were rejected.
+    void loadTuning(const juce::File &scaleFile, const juce::File &mappingFile,
+                    std::function<void(const juce::String &)> onLoaded = nullptr);
+
+    // Replaces the bendCurve shape of both zones with a JavaScript expression in x (see
+    // CurveExpression); an empty string goes back to bendCurve. The expression is saved with
+    // the state and compiled to a table on a background thread, to be swapped in at the
+    // start of a later block. onCompiled runs on the message thread with an empty string, or
+    // the reason it was rejected; a rejected expression also falls back to bendCurve.
+    void setCurveExpression(const juce::String &expression,
+                            std::function<void(const juce::String &)> onCompiled = nullptr);
+    juce::String getCurveExpression() const;
+
+    // Size of the editor relative to its design size, kept with the state so a session
+    // reopens it as it was. Message thread only.
+    float getEditorScale() const;
+    void setEditorScale(float scale);
+
+    // MIDI learn: a controller on one input channel moves one of these parameters. Arming a
+    // parameter gives it the next controller to arrive. Mapped controllers are consumed in
+    // the decode pass instead of passed on, so the synth downstream never sees them; the
+    // parameter catches up on the timer, like a program change. Mappings are kept with the
+    // state. Message thread only.
+    static constexpr const char *learnableParameterIDs[] = {"bendAmount", "bendTime", "bendCurve"};
+    static constexpr int numLearnableParameters = static_cast<int>(std::size(learnableParameterIDs));
+
+    struct MidiLearnMapping
+    {
+        int channel = 0; // 1 to 16, or 0 for none
+        int controller = -1;
+    };
+
+    void armMidiLearn(const juce::String &parameterID); // An empty ID disarms
+    juce::String getArmedMidiLearn() const;
+    void clearMidiLearn(const juce::String &parameterID);
+    MidiLearnMapping getMidiLearn(const juce::String &parameterID) const;
+
+    // Opt-in capture of all output with absolute sample times, for regression diffing
+    TraceRecorder &getTraceRecorder() { return traceRecorder; }
+
+    // The output as a standard MIDI file, streamed to disk for as long as a show runs
+    MidiCapture &getMidiCapture() { return midiCapture; }
+
+    // What the audio thread is doing, as lines in a log file; off until started. Setting
+    // BCS_REALTIME_LOG in the environment to a list of categories (see LogCategory) starts
+    // it with the plugin, logging to a file in the system log folder.
+    RealtimeLog &getRealtimeLog() { return realtimeLog; }
+
+    // Timing of each phase of processBlock; captures nothing unless built with BCS_PHASE_TRACE
+    PhaseTracer &getPhaseTracer() { return phaseTracer; }
+
+    // A report of the blocks leading up to each overrun; off until started. Setting
+    // BCS_FLIGHT_RECORDER in the environment starts it with the plugin, writing into that
+    // folder, or into one in the system log folder if it isn't an absolute path.
+    FlightRecorder &getFlightRecorder() { return flightRecorder; }
+
+    // Per-voice pitch and bend over OSC to oscHost, while the oscOutput parameter is on
+    OscStreamer &getOscStreamer() { return oscStreamer; }
+    static constexpr const char *oscHost = "127.0.0.1";
+
+    // Every block's voices through shared memory, while sharedMemoryOutput is on
+    SharedVoiceStream &getSharedVoiceStream() { return sharedVoiceStream; }
+
+    // How far along its bend each sounding voice is, published at the end of every block.
+    // Bit (slot) of activeMask marks the voices on member channel slot + 1.
+    struct VoicePositions
+    {
+        juce::uint32 activeMask = 0;
+        std::array<float, 16> progress{};
+    };
+
+    // Only the editor may acquire; published while it is subscribed
+    TripleBuffer<VoicePositions> &getVoicePositions() { return voicePositions; }
+
+    // The note and bend on each member channel, for the editor's keyboard and channel map;
+    // published with the positions. Any number of readers.
+    struct VoiceMap
+    {
+        juce::uint32 activeMask = 0;
+        juce::uint32 releasingMask = 0;
+        std::array<juce::uint8, 16> note{};
+        std::array<juce::uint8, 16> inputChannel{};
+        std::array<float, 16> bendSemitones{};
+    };
+
+    const SeqLock<VoiceMap> &getVoiceMap() const { return voiceMap; }
+
+    enum class OutputMode
+    {
+        mpe,         // MIDI 1.0, one MPE member channel per voice
+        midi2PerNote, // MIDI 2.0 per-note pitch bend on group 1, on the note's input channel
+        singleChannel // MIDI 1.0 for synths without MPE: one bend for every held note, on the input channel
+    };
+
+    // The outputMode choice that picks one of the above by asking the receiver over MIDI-CI,
+    // and the one after it
+    static constexpr int autoOutputMode = 2;
+    static constexpr int singleChannelOutputMode = 3;
+
+    // MIDI 2.0 voice events of the last block, for hosts and embedders that consume UMP.
+    // While this mode is active the MidiBuffer carries the MIDI 1.0 notes and pass-through
+    // messages only.
+    struct TimedPacket
+    {
+        int samplePosition;
+        juce::ump::PacketX2 packet;
+    };
+
+    const std::vector<TimedPacket> &getUmpOutput() const { return umpOutput; }
+
+    // MIDI 2.0 input, for hosts and embedders that have it: packets added before processBlock
+    // are decoded there alongside the MidiBuffer, straight from the packet stream. Per-note
+    // pitch bends are added to their note's bend at full resolution, and per-note controllers
+    // follow the note to its voice. Call on the audio thread; positions are within the coming
+    // block, in order, and packets past the reserved space are dropped. Not kept while bypassed.
+    void addUmpInput(int samplePosition, const juce::uint32 *words, int numWords);
+
+    // Further MIDI inputs beside the host's MidiBuffer, which is bus 0, for hosts and wrappers
+    // with several event inputs: a keyboard, a sequencer, a control surface for MIDI learn.
+    // Call on the audio thread before processBlock with a bus's events for the coming block,
+    // in order. They wait at their absolute samples, delayed with the host's input, and the
+    // decode pass merges every bus by time straight into the block's input. Events past the
+    // reserved space are dropped, and none are kept while bypassed.
+    static constexpr int maxMidiInputBuses = 4;
+    void addMidiInput(int bus, const juce::MidiBuffer &events);
+
+    // Any thread: the channels a bus is heard on, one bit each from channel 1 up. Channel
+    // messages on the others are dropped in the merge; system messages always pass. Every
+    // channel by default.
+    void setMidiInputChannels(int bus, juce::uint16 channels);
+    juce::uint16 getMidiInputChannels(int bus) const;
+
+    enum class UpdateMode
+    {
+        fixedRate, // Every updateRate milliseconds
+        perBend,   // updatesPerBend messages spread over bendTime
+        adaptive,  // Dense where the curve is steep, sparse where it is flat
+        nextChange // Each voice when its bend next moves past the send threshold
+    };
+
+    // Bend targets taken from the audio input
+    enum class InputTarget
+    {
+        none,
+        pitch, // The octave of the input's pitch nearest the note, detuning included
+        chord  // The nearest pitch class strong in the input
+    };
+
+    enum class StrumMode
+    {
+        off,  // Notes on the same sample start together
+        up,   // Lowest note first, highest strumSpread later
+        down, // Highest note first
+        random
+    };
 
 private:
-    struct NoteInfo
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    template <typename ParameterType>
+    ParameterType *getTypedParameter(const juce::String &parameterID)
     {
-        int noteNumber;
-        int mpeChannel; // The MPE member channel this note is on
-        double startTime;
-        int lastBendValue;
-        bool isActive;
+        auto *parameter = dynamic_cast<ParameterType *>(parameters.getParameter(parameterID));
+        jassert(parameter != nullptr);
+        return parameter;
+    }
+
+    void setLegacyStateInformation(const void *data, int sizeInBytes);
+
+    StateSerializer stateSerializer;
+
+    // The last state written, for hosts that ask on every autosave and undo point. Every
+    // parameter change moves parameterGeneration on, so an unchanged instance hands back its
+    // copy without serializing. Guarded for hosts that save from more than one thread; never
+    // touched by the audio thread.
+    juce::CriticalSection stateCacheLock;
+    juce::MemoryBlock cachedState;
+    juce::uint32 cachedStateGeneration = 0;
+
+    // Written from other threads and read by processBlock: parameter changes from the host
+    // or the editor, program changes and zone handshake requests. Kept on a cache line of
+    // their own, apart from the state below, so automation moving a parameter on another core
+    // never takes away the lines the audio thread is working in.
+    struct alignas(cacheLineSize) ControlFlags
+    {
+        std::atomic<juce::uint32> parameterGeneration{1};
+        std::atomic<int> currentProgram{0};
+        std::atomic<int> requestedProgram{-1};
+        std::atomic<bool> zoneConfigRequested{true};
+        std::atomic<int> lookaheadSamples{0}; // Set along with the reported latency
+        std::atomic<bool> voiceFlushRequested{false};
+        std::atomic<int> midiLearnArmed{-1}; // Index into learnableParameterIDs
+
+        // By index into LinkedSettings::parameterIDs: values taken from the link group, whose
+        // notifications aren't edits, and edits made here still to be published
+        std::atomic<juce::uint32> linkAdopted{0};
+        std::atomic<juce::uint32> linkEdits{0};
+    };
+
+    // Written by processBlock and polled by the editor and the meters, likewise on a line of
+    // their own
+    struct alignas(cacheLineSize) OutputCounters
+    {
+        std::atomic<juce::uint64> coalescedBends{0};
+        std::atomic<juce::uint64> droppedBends{0};
+        std::atomic<juce::uint64> savedMessages{0};
+        std::atomic<juce::uint64> bendsSent{0};
+        std::atomic<juce::uint64> steals{0};
+        std::atomic<juce::uint64> droppedNotes{0}; // No channel left in a shared pool
+        std::atomic<juce::uint64> droppedInput{0}; // Past the input a split block can hold
+        std::atomic<int> activeVoices{0};
+        std::atomic<size_t> scratchHighWater{0}; // Most of the scratch arena one block has filled
+
+        // MIDI learn: the controller caught while armed, as target << 11 | channel << 7 |
+        // controller, and the latest value of each mapped parameter, normalised; -1 when the
+        // timer has taken them
+        std::atomic<int> learnedController{-1};
+        std::array<std::atomic<float>, numLearnableParameters> learnedValues;
     };
 
-    std::vector<NoteInfo> activeNotes;
-    std::array<bool, 16> channelInUse; // Track which MPE channels are in use
+    ControlFlags control;
+    OutputCounters counters;
+
+    // Every array a block uses only while it runs comes from here, sized in prepareToPlay
+    // and taken afresh at the top of each block by allocateScratch. scratchBytesUsed is what
+    // the block filled of them; its largest goes to the telemetry and scratchHighWater.
+    ScratchArena scratch;
+    int maxOutputEvents = 0;
+    std::atomic<size_t> scratchCapacity{0};
+    void allocateScratch();
+    size_t scratchBytesUsed() const;
+
+    // Presets from the shared bank. Program changes on the audio thread switch the snapshot
+    // to the preset record at once and leave control.requestedProgram for the timer, which
+    // copies the preset into the parameters so the host and editor follow.
+    juce::SharedResourcePointer<PresetBank> presetBank;
+    const PresetBank::Preset *pendingPreset = nullptr;
+
+    void applyPresetToParameters(const PresetBank::Preset &preset);
+
+    // Live morph between two bank presets, positioned by morphController. The endpoint
+    // tables are built on the message thread; the blended table is rebuilt in processBlock
+    // only when the controller or the endpoints move, at a fixed cost of one table lerp.
+    struct MorphEndpoints
+    {
+        CurveTableCache::Table from, to;
+        float fromAmount = 1.0f, toAmount = 1.0f;
+        float fromTime = 0.5f, toTime = 0.5f;
+    };
+
+    TripleBuffer<MorphEndpoints> morphEndpoints;
+    int publishedMorphFrom = -1;
+    int publishedMorphTo = -1;
+
+    CurveTable morphTable;
+    float morphPosition = 0.0f;  // Controller value, 0..1
+    float blendedPosition = -1.0f; // Position morphTable was built for
+    float morphAmount = 1.0f;
+    float morphTime = 0.5f;
+
+    void publishMorphEndpoints(int fromIndex, int toIndex);
+    void updateMorph();
+
+    // Fixed-capacity voice table, one slot per MIDI channel (slot = channel - 1).
+    // Stored as parallel arrays so the bend loop only touches the fields it needs,
+    // with activeMask marking which slots hold a sounding note. slotForInputNote maps
+    // the incoming (channel, note) pair back to its slot so note-off is a single lookup.
+    // noteNumber is the note the voice sounds; a legato glide hands the voice to another
+    // input key, so the key it answers to is kept apart in inputNote. After its note-off a
+    // voice with a release bend stays active, answering to no key, until the bend is done;
+    // so does one whose note-off came under the sustain pedal, until the pedal lifts.
+    struct VoiceTable
+    {
+        static constexpr int numSlots = 16;
+        static constexpr int numLanes = 2; // Modulation lanes besides the bend
+        static constexpr juce::int8 noSlot = -1;
+
+        VoiceTable() { clear(); }
+
+        std::array<int, numSlots> noteNumber{};
+        std::array<int, numSlots> inputNote{};
+        std::array<int, numSlots> inputChannel{};
+        std::array<juce::int64, numSlots> startSample{};
+        std::array<juce::int64, numSlots> nextUpdateSample{};
+        std::array<int, numSlots> lastBendValue{};
+        std::array<std::array<int, numSlots>, numLanes> lastLaneValue{};
+        std::array<float, numSlots> targetOffsetCents{}; // Added to the bend target, from the chord at note-on
+        std::array<float, numSlots> baseBend{};          // Static tuning in 14-bit steps, where the bend starts
+        std::array<float, numSlots> glideOffset{};       // Glide start relative to baseBend, fading out over glideTime
+        std::array<int, numSlots> envelopeSegment{};     // Envelope segment the voice was last evaluated in
+        std::array<float, numSlots> amountScale{};       // Velocity and key tracking, from the note-on
+        std::array<float, numSlots> inverseTimeScale{};
+        std::array<float, numSlots> curveBow{};          // Humanized bow added to the rise's curve
+        std::array<float, numSlots> vibratoPhase{};      // Vibrato phase offset in cycles, from the note-on
+
+        // Pressure on the voice's key, 0 to 1: input only moves the target, and the bend loop
+        // glides the level after it, from the sample it last got to
+        std::array<float, numSlots> pressureTarget{};
+        std::array<float, numSlots> pressureLevel{};
+        std::array<juce::int64, numSlots> pressureSample{};
+
+        // Bend shaping: the receiver's smoothed bend as of heardSample, and the curve's value
+        // when the last bend went out
+        std::array<float, numSlots> heardBend{};
+        std::array<juce::int64, numSlots> heardSample{};
+        std::array<float, numSlots> shapedFrom{};
+
+        // The bend as it was at note-on, for latched voices: target in steps with tracking
+        // and chord offset applied, duration inverted with the time tracking folded in, and
+        // the curve, whose table is used while the zone still holds it
+        std::array<float, numSlots> latchedTarget{};
+        std::array<float, numSlots> latchedInverseDuration{};
+        std::array<float, numSlots> latchedCurve{};
+        juce::uint32 activeMask = 0;
+        juce::uint32 releasingMask = 0;
+        juce::uint32 sustainedMask = 0;
+
+        // Voices that started on the same sample with the same time scaling, curve and bow
+        // have the same curve value on every tick, so the bend pass evaluates each group's
+        // leader and copies it to the followers. A voice leaves its group when it ends, is
+        // released or glides to a new note.
+        std::array<int, numSlots> groupLeader{};
+        juce::uint32 followerMask = 0;
+
+        // A voice started on a stolen channel whose note waits while the channel's bend ramps
+        // from the stolen voice's (handoffBend, at handoffStart) to its own; startSample is
+        // when its note sounds
+        juce::uint32 handoffMask = 0;
+        std::array<float, numSlots> handoffBend{};
+        std::array<juce::int64, numSlots> handoffStart{};
+        std::array<int, numSlots> handoffVelocity{};
+
+        std::array<std::array<juce::int8, 128>, 16> slotForInputNote;
+        std::array<juce::uint32, 16> slotsForInputChannel{}; // Active slots started from each input channel
+
+        bool isActive(int slot) const { return (activeMask >> slot) & 1u; }
+        int findSlot(int channel, int note) const { return slotForInputNote[channel - 1][note]; }
+
+        void activate(int slot, int channel, int note)
+        {
+            noteNumber[slot] = note;
+            inputNote[slot] = note;
+            inputChannel[slot] = channel;
+            slotForInputNote[channel - 1][note] = static_cast<juce::int8>(slot);
+            slotsForInputChannel[channel - 1] |= 1u << slot;
+            activeMask |= 1u << slot;
+            envelopeSegment[slot] = 0;
+        }
+
+        // Joins the group of the first voice among candidates that it shares a curve with
+        void joinGroup(int slot, juce::uint32 candidates)
+        {
+            auto i = static_cast<size_t>(slot);
+
+            for (auto mask = candidates & activeMask & ~(followerMask | releasingMask | handoffMask | (1u << slot)); mask != 0; mask &= mask - 1)
+            {
+                auto leader = lowestSetBit(mask);
+                auto l = static_cast<size_t>(leader);
+
+                if (startSample[l] == startSample[i] && inverseTimeScale[l] == inverseTimeScale[i] && curveBow[l] == curveBow[i]
+                    && latchedInverseDuration[l] == latchedInverseDuration[i] && latchedCurve[l] == latchedCurve[i])
+                {
+                    groupLeader[i] = leader;
+                    followerMask |= 1u << slot;
+                    return;
+                }
+            }
+        }
+
+        // A leader hands its group to its lowest follower
+        void leaveGroup(int slot)
+        {
+            groupLeader[static_cast<size_t>(slot)] = slot;
+
+            if (((followerMask >> slot) & 1u) != 0)
+            {
+                followerMask &= ~(1u << slot);
+                return;
+            }
+
+            int newLeader = noSlot;
+
+            for (auto mask = followerMask; mask != 0; mask &= mask - 1)
+            {
+                auto follower = lowestSetBit(mask);
+                auto &leader = groupLeader[static_cast<size_t>(follower)];
+
+                if (leader != slot)
+                    continue;
+
+                if (newLeader == noSlot)
+                {
+                    newLeader = follower;
+                    followerMask &= ~(1u << follower);
+                }
+
+                leader = newLeader;
+            }
+        }
+
+        void deactivate(int slot)
+        {
+            leaveGroup(slot);
+
+            auto &entry = slotForInputNote[inputChannel[slot] - 1][inputNote[slot]];
+            if (entry == slot)
+                entry = noSlot;
+            slotsForInputChannel[inputChannel[slot] - 1] &= ~(1u << slot);
+            activeMask &= ~(1u << slot);
+            releasingMask &= ~(1u << slot);
+            sustainedMask &= ~(1u << slot);
+            handoffMask &= ~(1u << slot);
+        }
+
+        // Note-off with a release bend to finish: stays active but no longer answers to its key
+        void release(int slot)
+        {
+            deactivate(slot);
+            activeMask |= 1u << slot;
+            releasingMask |= 1u << slot;
+        }
+
+        // Note-off under the sustain pedal: sounds on, answering to no key, with its channel
+        // still taken so no new note is bent on it
+        void sustain(int slot)
+        {
+            deactivate(slot);
+            activeMask |= 1u << slot;
+            sustainedMask |= 1u << slot;
+        }
+
+        // Legato: the sounding voice now answers to another input key
+        void retarget(int slot, int channel, int note)
+        {
+            deactivate(slot);
+            inputNote[slot] = note;
+            inputChannel[slot] = channel;
+            slotForInputNote[channel - 1][note] = static_cast<juce::int8>(slot);
+            slotsForInputChannel[channel - 1] |= 1u << slot;
+            activeMask |= 1u << slot;
+            envelopeSegment[slot] = 0;
+        }
+
+        void clear()
+        {
+            activeMask = 0;
+            releasingMask = 0;
+            sustainedMask = 0;
+            handoffMask = 0;
+            followerMask = 0;
+            slotsForInputChannel.fill(0);
+            for (auto &channel : slotForInputNote)
+                channel.fill(noSlot);
+        }
+    };
+
+    // Starts on a fresh cache line, so the voice table never shares one with the control flags
+    // or the end of a neighbouring instance
+    alignas(cacheLineSize) VoiceTable voices;
+
+    // Slots due for a bend update within the current block, soonest first
+    struct UpdateQueue
+    {
+        using Times = std::array<juce::int64, VoiceTable::numSlots>;
+
+        struct Later
+        {
+            const Times &times;
+            bool operator()(int a, int b) const { return times[static_cast<size_t>(a)] > times[static_cast<size_t>(b)]; }
+        };
+
+        std::array<int, VoiceTable::numSlots> slots{};
+        int size = 0;
+
+        bool isEmpty() const { return size == 0; }
+        int top() const { return slots[0]; }
+        void clear() { size = 0; }
+
+        void push(int slot, const Times &times)
+        {
+            slots[static_cast<size_t>(size++)] = slot;
+            std::push_heap(slots.begin(), slots.begin() + size, Later{times});
+        }
+
+        int pop(const Times &times)
+        {
+            std::pop_heap(slots.begin(), slots.begin() + size, Later{times});
+            return slots[static_cast<size_t>(--size)];
+        }
+
+        // For voices that end or restart while queued
+        void remove(int slot, const Times &times)
+        {
+            auto end = slots.begin() + size;
+            auto found = std::find(slots.begin(), end, slot);
+
+            if (found == end)
+                return;
+
+            *found = *(end - 1);
+            --size;
+            std::make_heap(slots.begin(), slots.begin() + size, Later{times});
+        }
+    };
+
+    UpdateQueue updateQueue;
+
+    // Events for later blocks, by absolute sample: strummed notes held back until their turn
+    // and the ends of release bends, which free their voices' channels. Ends go before notes
+    // on the same sample, so a strummed note can have a channel freed then; strummed notes on
+    // one sample leave in the order they came in.
+    struct ScheduledEvent
+    {
+        enum class Kind : juce::uint8
+        {
+            strummedNoteOn,
+            strummedNoteOff,
+            releaseEnd
+        };
+
+        Kind kind = Kind::strummedNoteOn;
+        int channel = 0, note = 0, velocity = 0; // Strummed notes
+        int slot = 0;                            // Release ends
+    };
+
+    static constexpr int maxStrummedEvents = 256;
+    static constexpr int releaseEndRank = 0;
+    static constexpr int strummedNoteRank = 1;
+
+    using Scheduler = TimingWheel<ScheduledEvent, maxStrummedEvents + VoiceTable::numSlots>;
+    Scheduler scheduler;
+    int numStrummedEvents = 0;
+    std::array<Scheduler::Handle, VoiceTable::numSlots> releaseEvents{}; // Valid while the voice is releasing
+    std::array<std::array<int, 128>, 16> strumDelays{}; // Per input key, how late its note-on was played
+    std::array<std::array<juce::int8, 128>, 16> chordTriggers{}; // Per input key, 1 + the voicing it plays, or 0
+
+    // Rank of each note-on in the chord on the current sample, in strum order
+    static constexpr int maxStrumChord = 128;
+    int strumChordPosition = -1;
+    int strumChordSize = 0;
+    int strumChordNext = 0;
+    std::array<juce::uint8, maxStrumChord> strumChordNotes{};
+    std::array<juce::uint8, maxStrumChord> strumChordRanks{};
+    juce::Random strumRandom;
+
+    // Keys whose note-on went through unprocessed while bypassed, so their note-offs are
+    // passed through too after bypass ends, one bit per note on each input channel
+    std::array<std::array<juce::uint32, 4>, 16> bypassedNotes{};
+
+    // One input event, decoded once per block. Note events carry their fields; other messages
+    // point into the input buffer, which stays untouched until the block's output replaces it.
+    struct InputEvent
+    {
+        enum class Kind : juce::uint8
+        {
+            noteOn,
+            noteOff, // Including note-on at velocity 0
+            other
+        };
+
+        // By a MIDI 1.0 status byte's high nibble, so decoding a message is one lookup
+        // however the input is made up; a note-on at velocity 0 becomes a note-off after it
+        static constexpr std::array<Kind, 16> kindByStatus{
+            Kind::other, Kind::other, Kind::other, Kind::other, Kind::other, Kind::other, Kind::other, Kind::other,
+            Kind::noteOff, Kind::noteOn, Kind::other, Kind::other, Kind::other, Kind::other, Kind::other, Kind::other};
+
+        int samplePosition = 0;
+        Kind kind = Kind::other;
+        juce::uint8 channel = 1, note = 0, velocity = 0;
+        const juce::uint8 *data = nullptr;
+        int numBytes = 0;
+        const juce::uint32 *packet = nullptr; // A MIDI 2.0 per-note message, which has no MIDI 1.0 form
+    };
+
+    // The block's input in processing order, and the events that follow each sample's
+    // note-offs; both from the scratch arena
+    ScratchArray<InputEvent> inputEvents;
+    ScratchArray<InputEvent> deferredEvents;
+    std::array<std::array<juce::uint32, 4>, 16> keysStruckThisSample{}; // Cleared again after each sample
+
+    void decodeInput(const juce::MidiBuffer &midiMessages, int numSamples);
+
+    // Retrigger debounce: a note-on for a key struck less than debounceSamples ago is dropped
+    // in the decode pass, so a pad's double trigger costs no channel, note or bend reset. If
+    // the key was still down, its next note-off is dropped with it, leaving the first voice
+    // to end on the last one. One onset and one count per key, across input channels.
+    int debounceSamples = 0;
+    std::array<juce::int64, 128> lastOnsetSample{};
+    std::array<juce::uint8, 128> debounceKeysDown{};
+    std::array<juce::uint8, 128> debouncedNoteOffs{};
+
+    bool debounceNote(const InputEvent &event, juce::int64 sample);
+    void resetDebounce();
+
+    // Controller dejitter for pass-through: a continuous controller goes on only once it has
+    // moved more than ccHysteresis from the value last forwarded, or reached either end, and at
+    // most ccMaxRate times a second. A value held back by the rate waits, and the last one goes
+    // out on the block's final sample once its interval is up, so the synth ends where the
+    // controller did. Switches, data entry, (N)RPN numbers, LSBs and mode messages pass as they
+    // are. Flat arrays over every channel and controller, read and written in the decode pass.
+    static constexpr int numFilteredControllers = 16 * 128;
+    static constexpr int maxControllerFlushes = 64;
+    static constexpr juce::uint8 noControllerValue = 0xff;
+
+    bool controllerFilterActive = false;
+    juce::int64 controllerIntervalSamples = 0;
+    std::array<juce::uint8, numFilteredControllers> forwardedControllerValue{};
+    std::array<juce::int64, numFilteredControllers> forwardedControllerSample{};
+    std::array<juce::uint8, numFilteredControllers> heldControllerValue{};
+    std::array<juce::uint32, numFilteredControllers / 32> heldControllerMask{};
+    int numHeldControllers = 0;
+    std::array<std::array<juce::uint8, 3>, maxControllerFlushes> flushedControllerBytes{};
+
+    static bool isJitterController(int controller);
+    bool filterController(const InputEvent &event, juce::int64 sample);
+    void flushHeldControllers(int numSamples);
+    void resetControllerFilter();
+
+    // UMP input waiting for its block, at absolute samples, and the MIDI 1.0 bytes of the
+    // channel-wide messages decoded from it; all reserved in prepareToPlay
+    struct UmpInputRun
+    {
+        juce::int64 sample;
+        int begin, end; // Words in umpInputWords
+    };
+
+    std::vector<juce::uint32> umpInputWords;
+    std::vector<UmpInputRun> umpInputRuns;
+    size_t umpInputCursor = 0; // First run not yet decoded
+    ScratchArray<InputEvent> umpInputEvents;
+    ScratchArray<std::array<juce::uint8, 3>> umpInputBytes;
+
+    bool hasUmpInput() const { return umpInputCursor < umpInputRuns.size(); }
+    void decodeUmpInput(int numSamples);
+
+    // Input from the further buses waiting for its block, at absolute samples, with its
+    // bytes; reserved in prepareToPlay
+    struct QueuedInputEvent
+    {
+        juce::int64 sample;
+        int begin, numBytes; // Bytes in the queue's bytes
+    };
+
+    struct InputBusQueue
+    {
+        std::vector<juce::uint8> bytes;
+        std::vector<QueuedInputEvent> events;
+        size_t cursor = 0; // First event not yet decoded
+    };
+
+    std::array<InputBusQueue, maxMidiInputBuses - 1> inputBusQueues;
+    std::atomic<juce::uint64> inputBusChannels{~juce::uint64{0}}; // 16 bits a bus, bus 0 lowest
+
+    bool hasBusInput() const;
+
+    // Per-note pitch bends and controllers from UMP input
+    void handlePerNoteInput(const InputEvent &event);
+
+    // Program changes, the morph controller, MIDI-CI, expression and pass-through
+    void handleInputMessage(const InputEvent &event);
+
+    // Delay in samples for the note-on at position; ranks its chord on the chord's first note
+    int nextStrumDelay(const InputEvent *position, const InputEvent *end);
+
+    // Legato: the held voice each note-on of the current chord glides over, planned on the
+    // chord's first note-on. Voices started on the chord's own sample never qualify.
+    float glideInSamples = 4800.0f;
+    int legatoChordPosition = -1;
+    int legatoChordSize = 0;
+    int legatoChordNext = 0;
+    std::array<juce::int8, VoiceMatcher::maxNotes> legatoSlots{};
+
+    // Release bends: each runs from the voice's bend at note-off over releaseTime, after
+    // which its channel is freed by the event scheduled for the end.
+    float releaseInSamples = 14400.0f;
+
+    void beginRelease(int slot, int velocity, int samplePos);
+    void finishRelease(int slot);
+    juce::uint32 calculateReleaseBends(juce::int64 tickSample, const CurveTable &table, juce::uint32 slotMask,
+                                       std::array<int, VoiceTable::numSlots> &bendValues);
+
+    int nextLegatoSlot(const InputEvent *position, const InputEvent *end);
+    void planLegato(const int *notes, int numNotes, juce::int64 startSample, juce::int8 *slots) const;
+
+    // Scratch for the batched bend evaluation: elapsed time, then progress, then the
+    // unrounded bend in 14-bit steps
+    using SlotValues = std::array<float, VoiceTable::numSlots>;
+    alignas(16) SlotValues slotValues{};
+    alignas(16) SlotValues slotTargets{};
+    alignas(16) SlotValues slotGlides{};
+    alignas(16) SlotValues slotBows{};
+    alignas(16) SlotValues slotElapsed{};
+    alignas(16) SlotValues slotLevels{}; // Each voice's rise, 0 to 1, before its target
+    alignas(16) SlotValues slotCurves{}; // The bend on the curve, before shaping
+    alignas(16) SlotValues slotHeard{};  // What the receiver's smoothing has made of the last bend sent
+
+    // Bend shaping, for receivers that smooth bends themselves with a one-pole of
+    // receiverSmoothing: each bend is planned so the receiver's smoothed pitch reaches the
+    // curve by the next update, instead of stepping after it. The curve there is taken on from
+    // its last two sends, with the next update as far off as the last one. Sparse updates
+    // then track the curve with fewer, larger steps.
+    float receiverSmoothingSamples = 0.0f; // 0 with shaping off
+    void shapeBends(juce::int64 tickSample);
+    void noteBendsHeard(juce::uint32 slotMask, juce::int64 tickSample);
+
+    // slotValues of each group follower from its leader's
+    void copyGroupValues();
+
+    // The layers past the first as this block runs them, from bendLayers; each is a rise
+    // along its own table from delaySamples after the note-on. Summed onto the bend in the
+    // pass, after vibrato and before the clip and send threshold.
+    struct BendLayer
+    {
+        float steps = 0.0f;
+        float delaySamples = 0.0f;
+        float inverseDuration = 1.0f;
+        float curve = 0.0f;
+        const CurveTable *table = nullptr;
+    };
+
+    std::array<BendLayer, maxBendLayers - 1> bendLayers{};
+    int numExtraLayers = 0;     // 0 runs the single-layer pass untouched
+    float bendLayersEnd = 0.0f; // Samples after the note-on when the last layer ends
+
+    void updateBendLayers();
+    float sumBendLayers(size_t slot, juce::int64 tickSample) const;
+    void addBendLayers(juce::int64 tickSample, int numSlots);
+
+    // Modulation lanes: channel pressure and timbre (CC74) on the member channels, rising
+    // from one value to another along the same curve and time as the bend. They are
+    // evaluated on the bend's ticks from slotLevels, one pass over the slots per lane, and
+    // go out through the same budget and merge. A lane takes over its kind of expression on
+    // the member channels, so remapped input of that kind is dropped. MPE output only.
+    struct ModulationLane
+    {
+        bool enabled = false;
+        int status = 0xd0;  // Channel pressure, or 0xb0 for a controller
+        int controller = 0; // Controller number for 0xb0
+        float from = 0.0f;
+        float to = 127.0f;
+
+        int valueAt(float level) const { return juce::jlimit(0, 127, juce::roundToInt(from + (to - from) * level)); }
+    };
+
+    static constexpr int pressureLaneIndex = 0;
+    static constexpr int timbreLaneIndex = 1;
+    std::array<ModulationLane, VoiceTable::numLanes> lanes;
+    std::array<std::array<int, VoiceTable::numSlots>, VoiceTable::numLanes> laneValues{};
+    bool lanesActive = false;
+
+    bool lanesSending() const { return lanesActive && activeOutputMode == OutputMode::mpe; }
+
+    // Values of one lane at this tick's slotLevels; returns the slots in slotMask whose value changed
+    juce::uint32 calculateLaneValues(int lane, juce::uint32 slotMask);
+    void sendLaneValue(int lane, int slot, int value, int samplePos);
     double currentSampleRate = 44100.0;
-    double currentTime = 0.0;
-    int updateRateInSamples = 64; // Update pitch bend every N samples
+    juce::int64 sampleClock = 0; // Samples processed since prepareToPlay
+
+    // Everything processBlock reads from the parameters, captured only when the listener
+    // has bumped the generation since the last capture
+    struct ParameterSnapshot
+    {
+        float amount = 1.0f;
+        float time = 0.5f;
+        float curve = 0.0f;
+        ChannelAllocator::Rotation rotation = ChannelAllocator::Rotation::leastRecentlyUsed;
+        ChannelAllocator::StealPolicy stealPolicy = ChannelAllocator::StealPolicy::oldest;
+        bool spillToOtherZone = false;
+        ChannelAllocator::NotePriority notePriority = ChannelAllocator::NotePriority::last;
+        UpdateMode updateMode = UpdateMode::fixedRate;
+        float updateRateMs = 1.45f;
+        float updateCeilingHz = 50000.0f;
+        int updatesPerBend = 64;
+        bool tempoSync = false;
+        int syncedNoteValue = 0;
+        OutputMode outputMode = OutputMode::mpe;
+        bool budgetEnabled = false;
+        int messageBudget = 1000;
+        bool smoothAutomation = false;
+        bool morphEnabled = false;
+        int morphController = 1;
+        bool coalesceOutput = false;
+        float coalesceDeadbandCents = 0.0f;
+        bool zoneSplit = false;
+        int splitNote = 60;
+        int upperZoneChannels = 7;
+        float upperAmount = 1.0f;
+        float upperTime = 0.5f;
+        float upperCurve = 0.0f;
+        int bendRange = 48;
+        bool amountInSemitones = false;
+        float semitones = 12.0f;
+        float upperSemitones = 12.0f;
+        bool justStacking = false;
+        StrumMode strumMode = StrumMode::off;
+        float strumSpreadMs = 40.0f;
+        bool legato = false;
+        float glideTime = 0.1f;
+        bool releaseBend = false;
+        float releaseSemitones = -2.0f;
+        float releaseTime = 0.3f;
+        float holdTime = 0.0f;
+        float returnTime = 0.0f;
+        float returnCurve = 0.0f;
+        int numBendLayers = 1;
+
+        struct Layer
+        {
+            float semitones = 0.0f;
+            float time = 0.2f;
+            float curve = 0.0f;
+            float delay = 0.0f;
+        };
+
+        std::array<Layer, maxBendLayers - 1> layers{};
+        float velocityToAmount = 0.0f;
+        float velocityToTime = 0.0f;
+        float velocityCurve = 0.0f;
+        float keyToAmount = 0.0f;
+        float keyToTime = 0.0f;
+        float keyCurve = 0.0f;
+        float humanizeAmount = 0.0f;
+        float humanizeTime = 0.0f;
+        float humanizeCurve = 0.0f;
+        float pressureToAmount = 0.0f;
+        float pressureSmoothingMs = 40.0f;
+        float bendDeadbandCents = 5.86f;
+        float receiverSmoothingMs = 0.0f;
+        bool adaptiveQuality = false;
+        float adaptiveThresholdPercent = 70.0f;
+        bool fixedPoint = false;
+        bool fitDeadband = false;
+        bool offlineQuality = true;
+        float stealRampMs = 0.0f;
+        bool serialOutput = false;
+        juce::uint32 scopeChannels = 0xffff; // One bit per input channel, from bit 0
+        int scopeLowNote = 0;
+        int scopeHighNote = 127;
+        float debounceMs = 0.0f;
+        int ccHysteresis = 0;
+        float ccMaxRate = 0.0f;
+        bool previewSynth = false;
+        bool masterBend = false;
+        float vibratoDepthCents = 0.0f;
+        float vibratoRate = 5.5f;
+        float vibratoDelay = 0.3f;
+        float vibratoSpread = 0.0f;
+        bool pressureLane = false;
+        int pressureFrom = 0;
+        int pressureTo = 127;
+        bool timbreLane = false;
+        int timbreFrom = 64;
+        int timbreTo = 127;
+        bool latchParameters = false;
+        bool releaseOnStop = true;
+        int scaleStep = 0; // 1 or -1 to bend a degree of the scale up or down in place of the amount
+        InputTarget inputTarget = InputTarget::none; // Also in place of the amount
+        int scale = 0;
+        int scaleRoot = 0;
+        bool targetOffsets = false; // Voices' targetOffsetCents count, from just stacking or scale steps
+        int chordVoicing = -1; // Index into ChordMemory::voicings, or -1 with chord memory off
+        bool transientRetrigger = false;
+        int mpeInputMaster = 0; // Master channel of the MPE input zone, or 0 for input that isn't MPE
+        int sharedPool = 0;     // Pool ID of the channels shared with other instances, or 0 for none
+        bool autoZoneSize = false;
+        int linkGroup = 0;      // Link group ID, or 0 for settings of this instance's own
+    };
+
+    ParameterSnapshot params;
+
+    // Velocity and key tracking of the bend amount and time, rebuilt with the snapshot when
+    // their parameters move. Each voice takes its factors at note-on, along with its random
+    // humanization, drawn from a generator seeded by the note's sample time and key so renders
+    // repeat exactly. With every depth at zero the bend loop skips them.
+    TrackingTable velocityTracking;
+    TrackingTable keyTracking;
+    bool voiceScalingActive = false;
+    bool curveBowActive = false;
+
+    void setVoiceModulation(int slot, int noteNumber, int velocity);
+
+    // Pressure (polyphonic aftertouch, or channel pressure for the voices of its channel)
+    // scales each voice's rise by 1 + pressureToAmount * its smoothed level. Channel pressure
+    // is also kept per input channel, since an MPE controller sends it just before the note.
+    std::array<float, 16> inputPressure{};
+    float pressureSmoothingSamples = 1.0f;
+    bool pressureScalingActive = false;
+
+    void trackPressure(const InputEvent &event);
+    float smoothPressure(int slot, juce::int64 sample);
+    juce::uint32 snapshotGeneration = 0;
+
+    bool updateParameterSnapshot();
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override {}
+
+    // One MPE zone: its voice pool and bend engine. The lower zone follows the main bend
+    // parameters and the morph; with the split on, notes from splitNote up go to the upper
+    // zone, which has bend parameters of its own. Voice slots stay channel - 1 throughout,
+    // so the zones' slot masks never overlap.
+    struct Zone
+    {
+        juce::MPEZone mpeZone{juce::MPEZone::Type::lower};
+        ChannelAllocator allocator;
+        juce::uint32 slotMask = 0; // Empty while the zone is unused
+        int masterBend = 0;        // Last bend sent on the master channel, added to every member's
+
+        // This block's bend parameters, and the start point of their automation ramps
+        float amount = 1.0f;
+        float curve = 0.0f;
+        float startAmount = 1.0f;
+        float startCurve = 0.0f;
+        bool rampParameters = false;
+        const CurveTable *table = nullptr;
+        float bendScale = 8192.0f; // 14-bit bend steps per unit of amount
+
+        // Values at the end of the previous host block
+        float rampStartAmount = 1.0f;
+        float rampStartCurve = 0.0f;
+
+        // bendTime in samples, recomputed only when the time or sample rate changes
+        juce::int64 durationInSamples = 1;
+        float durationForSamples = -1.0f;
+        double sampleRateForDuration = 0.0;
+        int updateRateInSamples = 64; // Update pitch bend every N samples
+
+        // The curve its table in the engine configuration was built for
+        float publishedCurve = 0.0f;
+
+        // Where the envelope's segments fall for this block's bend time
+        BendEnvelope::Timing envelopeTiming;
+    };
+
+    static constexpr int lowerZone = 0;
+    static constexpr int upperZone = 1;
+    std::array<Zone, 2> zones;
+
+    Zone &zoneForSlot(int slot) { return zones[(zones[upperZone].slotMask >> slot) & 1u]; }
+
+    // The zone a new note takes its channel in: its key's zone, or with spillToOtherZone the
+    // other one while its own has no free channel and the other has
+    Zone &zoneForNewNote(int noteNumber);
+
+    bool updateDurationInSamples(Zone &zone, float duration);
+
+    // Everything processBlock reads that is too large to rebuild on the audio thread: each
+    // zone's curve table, from the shared cache; the attack/hold/return envelope shared by
+    // both zones (the rise, an optional hold at the target, then a return to the note's own
+    // pitch; with no return time, the plain rise); the table compiled from the curve
+    // expression, which stands in for both zones' tables while there is one; and the tuning
+    // table a note-on reads its note's offset from. Built on the message thread or the
+    // background worker and swapped in whole, so a block reads one configuration from start
+    // to end. Replaced ones, and the curve table references they hold, are dropped by the timer.
+    // The MIDI learn table rides along, so a decode pass looks a controller up in one load.
+    struct MidiLearnTable
+    {
+        static constexpr juce::int8 noTarget = -1;
+
+        MidiLearnTable()
+        {
+            for (auto &channel : targets)
+                channel.fill(noTarget);
+        }
+
+        // Index into learnableParameterIDs, per input channel and controller
+        std::array<std::array<juce::int8, 128>, 16> targets;
+    };
+
+    struct EngineConfig
+    {
+        std::array<CurveTableCache::Table, 2> curveTables;
+        std::array<CurveTableCache::Table, maxBendLayers - 1> layerTables;
+        std::shared_ptr<const CurveTable> expressionTable;
+        BendEnvelope envelope;
+        TuningTable tuning;
+        MidiLearnTable midiLearn;
+    };
+
+    ConfigPublisher<EngineConfig> engineConfig{std::make_unique<EngineConfig>()};
+    const EngineConfig *activeConfig = nullptr; // Acquired at the start of each block
+    const BendEnvelope *envelope = nullptr;
+
+    // The message thread's copy of the MIDI learn table, kept in the state as midiLearnProperty
+    // and published into the engine configuration whenever it changes
+    MidiLearnTable midiLearnMappings;
+    std::array<juce::RangedAudioParameter *, numLearnableParameters> learnableParameters{};
+
+    // Link group: the linked parameters, in LinkedSettings::parameterIDs order. The audio thread
+    // takes the group's block when its sequence moves on, and the timer publishes edits.
+    std::array<juce::RangedAudioParameter *, LinkedSettings::numParameters> linkedParameters{};
+    int adoptedLinkGroup = 0;
+    juce::uint32 linkSequence = 0;
+    LinkedSettings::Block linkedBlock;
+
+    void adoptLinkedSettings();
+    void publishLinkedSettings();
+
+    static int findLearnableParameter(const juce::String &parameterID);
+    void setMidiLearn(int target, int channel, int controller);
+    void publishMidiLearn();
+    void loadMidiLearn();
+
+    std::array<float, maxBendLayers - 1> publishedLayerCurves{};
+    void publishLayerTable(size_t layer, float curve);
+
+    float publishedHoldTime = -1.0f;
+    float publishedReturnTime = -1.0f;
+    float publishedReturnCurve = 0.0f;
+
+    void publishEnvelope(float hold, float returnSeconds, float curve);
+
+    // Turns the elapsed times in slotValues into envelope levels for the active voices
+    void evaluateEnvelope(const BendEnvelope::Timing &timing, const CurveTable &table, float curve);
+
+    // Tempo sync: host BPM is read once per block and the synced note value converted to
+    // seconds only when the tempo or the chosen note value changes
+    double syncedBpm = 0.0;
+    int syncedNoteValue = -1;
+    float syncedDuration = 0.5f;
+
+    float getSyncedBendTime();
+
+    void processMidi(int numSamples, juce::MidiBuffer &midiMessages);
+    void processMidiBlock(int numSamples, juce::MidiBuffer &midiMessages, int blockOffset, int blockSamples);
+    void finishHostBlock(juce::int64 startTicks, int numSamples, const juce::MidiBuffer &output);
+    void processBypassedMidi(int numSamples, juce::MidiBuffer &midiMessages);
+
+    // Voices don't outlive prepareToPlay, releaseResources or, with releaseOnStop, the host's
+    // transport stopping: the next block ends every sounding voice on its own channel and
+    // centres its bend, in one pass over the active slots, and frees the channels.
+    bool flushPending = false;
+    bool transportWasPlaying = false;
+
+    void followTransport(int numSamples);
+    void flushVoices(int samplePos);
+
+    // Seek chase: when the playhead jumps, the voices are flushed and the host's chased
+    // note-ons, which arrive at the start of the first block after the jump, start voices
+    // whose bends carry on from the key's onset on the timeline, as recorded when it was
+    // played, or from the end of the rise for keys never played. Timeline positions are
+    // sampleClock plus timelineOffset, so they are delayed by the lookahead like the notes.
+    juce::int64 expectedTimelineSample = -1; // Where the playhead should be next block, -1 if unknown
+    juce::int64 timelineOffset = 0;
+    bool timelineKnown = false;
+    juce::int64 chaseSample = -1; // Clock sample the chased note-ons arrive at
+    std::array<std::array<juce::int64, 128>, 16> noteOnsets{}; // Per input channel and key, -1 if none
+
+    void chaseVoice(int slot, juce::int64 startSample);
+
+    // Blocks are processed in pieces through these, cut at every multiple of subBlockSamples
+    // on the sample clock and never longer than preparedBlockSize, which everything reserved
+    // is sized for. Whatever size of block the host sends, the decisions made once a block
+    // (the parameter snapshot, lockstep, the budget's refill) then come at the same points,
+    // and a block of 8192 costs what 128 blocks of 64 do. A parked instance's block goes
+    // through whole, as it has nothing to decide.
+    static constexpr int subBlockSamples = 64;
+    int preparedBlockSize = 512;
+    juce::MidiBuffer splitInput;
+    size_t reservedSplitBytes = 0;
+    juce::MidiBuffer chunkMidi;
+
+    // Where the piece being processed starts in its host block, and the host block's length.
+    // Automation ramps run across the whole host block, not piece by piece.
+    int hostBlockOffset = 0;
+    int hostBlockSamples = 1;
+
+    // What the pieces of a host block handled, summed so the load monitor, the quality level,
+    // telemetry and the flight recorder see one block per host block rather than per piece
+    struct HostBlockTally
+    {
+        int inputEvents = 0;
+        int bendsSent = 0;
+        bool parked = true; // Every piece took the parked fast path
+    };
+
+    HostBlockTally hostBlockTally;
+
+    float rampPosition(int samplePos) const { return static_cast<float>(hostBlockOffset + samplePos) / static_cast<float>(hostBlockSamples); }
+
+    // Samples from the clock to the next cut, 1 to subBlockSamples
+    int samplesToNextCut() const { return subBlockSamples - static_cast<int>(sampleClock % subBlockSamples); }
+
+    // Lookahead: input waits in a delay line for lookaheadSamples, reported to the host as
+    // latency, so notes are known before they are played. Note-ons still waiting count
+    // toward the chord that just stacking tunes to, so the notes of a rolled chord are tuned
+    // to its root from the first one. Positions in the line are relative to the block being
+    // processed; its storage is reserved in prepareToPlay, and input that doesn't fit goes
+    // through undelayed rather than allocate.
+    static constexpr int maxLookaheadEvents = 4096;
+    juce::MidiBuffer lookaheadLine;
+    juce::MidiBuffer lookaheadBlock;
+    size_t reservedLookaheadBytes = 0;
+    int lookaheadEnd = 0; // Position of the last event in the line
+    ChordAnalyzer upcomingNotes;
+
+    void delayInput(int numSamples, juce::MidiBuffer &midiMessages);
+    float justOffsetCents(int note) const;
+
+    // Per-note scale step targets, rebuilt with the parameter snapshot
+    ScaleTable scaleTargets;
+
+    // What a note-on adds to its voice's bend target
+    float noteTargetOffsetCents(int note) const;
+
+    // Output events are built here; storage is reserved in prepareToPlay
+    juce::MidiBuffer outputMidi;
+    size_t reservedOutputBytes = 0;
+    int messagesThisBlock = 0;
+    int bendsThisBlock = 0;
+    int lastOutputPosition = 0;
+
+    TelemetryFifo telemetry;
+    std::atomic<bool> telemetrySubscribed{false};
+    bool telemetryWasSubscribed = false; // Audio thread: at the last block
+    LoadMonitor loadMonitor;
+
+    // Counter totals at the last telemetry record, so each record carries its block's share
+    juce::uint64 telemetryCoalescedBends = 0;
+    juce::uint64 telemetryDroppedBends = 0;
+    juce::uint64 telemetrySteals = 0;
+    TraceRecorder traceRecorder;
+    MidiCapture midiCapture;
+    RealtimeLog realtimeLog;
+    PhaseTracer phaseTracer;
+
+    // Each block's phase times and what it handled, kept while the flight recorder runs
+    FlightRecorder flightRecorder;
+    std::array<juce::int64, FlightRecord::numPhases> phaseTicks{};
+
+    void recordFlight(double processSeconds, int numSamples, const juce::MidiBuffer &output);
+    TripleBuffer<VoicePositions> voicePositions;
+    SeqLock<VoiceMap> voiceMap;
+
+    // Started and stopped by timerCallback as the OSC parameters change
+    OscStreamer oscStreamer;
+    int publishedOscPort = 0; // 0 while not streaming
+
+    SharedVoiceStream sharedVoiceStream;
+    bool publishedSharedMemory = false;
+    juce::uint32 oscVoiceMask = 0; // Voices the stream last saw sounding
+
+    // Runs while a bend target follows the audio input; started and stopped by timerCallback
+    PitchTracker pitchTracker;
+
+    // Onsets in the audio input restart the bends of held voices, at transientSample
+    TransientDetector transientDetector;
+    juce::int64 transientSample = neverSample;
+
+    template <typename SampleType>
+    void detectTransient(const juce::AudioBuffer<SampleType> &buffer);
+
+    // Plays the output into the audio buses while previewSynth is on, for auditioning without
+    // an MPE synth; the MIDI effect build has no buses and never sounds it
+    PreviewSynth preview;
+    bool previewActive = false;
+
+    template <typename SampleType>
+    void renderPreview(juce::AudioBuffer<SampleType> &buffer, const juce::MidiBuffer &midiMessages);
+
+    // Runs on the timer while the Auto output mode is selected; its messages go out one per block
+    ReceiverDiscovery receiverDiscovery;
+    void sendPendingCiMessage();
+
+    void recordTrace(const juce::MidiBuffer &output);
+    void captureOutput(const juce::MidiBuffer &output);
+    void pushOscVoices();
+    void publishVoicePositions();
+    void pushTelemetry(double processSeconds, int numSamples);
+
+    // Parked: nothing sounding, queued or changed, so the block only carries its input
+    bool isParked() const;
+
+    // Calls visit on each member an EngineCheckpoint keeps, for saving (Self const) and restoring
+    template <typename Self, typename Visitor>
+    static void visitCheckpointState(Self &self, Visitor &&visit);
+
+    // For a parked instance: true if every input event would go through exactly as it came,
+    // in order and inside the block, with none the processor acts on
+    bool passesThroughUntouched(const juce::MidiBuffer &midiMessages, int numSamples) const;
+
+    // MPE zone handshake. Requested by prepareToPlay, reset and any change of the zone
+    // layout, then sent one complete RPN per block so it never lands as a single burst.
+    std::array<std::array<juce::uint8, 3>, 18> zoneConfigMessages{};
+    int numZoneConfigMessages = 0;
+    int nextZoneConfigMessage = 0;
+
+    // Receiver's per-note bend range in semitones, sent with the zone configuration. The
+    // scale from semitones to 14-bit bend steps is only recomputed when the range changes.
+    int activeBendRange = 48;
+    float semitoneScale = 8192.0f / 48.0f;
+
+    void setBendRange(int semitones);
+
+    // With the master bend on, a tick where every sounding voice in a zone moves by the same
+    // amount goes out as one bend on the zone's master channel instead of one per member. The
+    // master range then matches the members', so the receiver adds the two step for step;
+    // lastBendValue stays the combined value and member channels carry the difference.
+    bool activeMasterBend = false;
+
+    int masterBendRange() const { return activeMasterBend ? activeBendRange : 2; }
+    void setMasterBendMode(bool enabled);
+
+    // Instances with the same pool ID claim member channels from one process-wide set, so
+    // several feeding one receiver don't collide
+    int activeSharedPool = 0;
+    void setSharedPool(int poolId);
+    void centreMasterBend(Zone &zone, int samplePos);
+    bool sendLockstepBend(Zone &zone, juce::uint32 sendMask, const std::array<int, 16> &bendValues, int samplePos);
+
+    // Held input notes, for finding the chord a new note joins
+    ChordAnalyzer heldNotes;
+
+    // Tuning tables are parsed, and offline render storage built, on one worker thread,
+    // started by the first job so instances a host only scans never start it
+    std::unique_ptr<juce::ThreadPool> backgroundWorker;
+    juce::ThreadPool &getBackgroundWorker();
+    void buildZoneConfigMessages();
+    void sendPendingZoneConfig();
+
+    // UMP output, reserved alongside outputMidi
+    std::vector<TimedPacket> umpOutput;
+
+    // Output is written as raw bytes, without a MidiMessage per event. A channel message
+    // takes its status nibble (0x80 to 0xe0), channel 1 to 16 and data bytes; program change
+    // and channel pressure go out as two bytes, the rest as three.
+    void addOutputEvent(const juce::uint8 *data, int numBytes, int samplePos);
+    void addChannelMessage(int type, int channel, int data1, int data2, int samplePos);
+    void addPitchWheel(int channel, int value, int samplePos);
+    void addUmpEvent(const juce::ump::PacketX2 &packet, int samplePos);
+
+    // Output format and zone layout; any change ends every voice
+    OutputMode activeOutputMode = OutputMode::mpe;
+    bool activeZoneSplit = false;
+    int activeUpperZoneChannels = 0;
+
+    void setZoneLayout(OutputMode newMode, bool split, int upperChannels);
+    void configureZones();
+
+    // Single-channel output skips voices and the allocator: notes pass through and the held
+    // keys are only a bitset. The lower zone's bend starts with the first key held, notes
+    // joining it ride along, and it is evaluated once per tick whatever the polyphony.
+    struct SingleChannelBend
+    {
+        std::array<juce::uint32, 4> heldKeys{};
+        int numHeld = 0;
+        int channel = 1; // Input channel of the note that started the bend
+        juce::int64 startSample = 0;
+        juce::int64 nextUpdateSample = neverSample;
+        int lastValue = 8192;
+    };
+
+    SingleChannelBend singleChannel;
+
+    // Plays the block's decoded input in single-channel mode and leaves none for the voices
+    void processSingleChannel(int numSamples);
+
+    // Auto zone size: an unsplit MPE zone has only as many member channels as are being
+    // played, for receivers that pay per channel. It grows back to all 14 the moment a note
+    // would otherwise steal, and shrinks to the peak polyphony plus one only in silence, a
+    // whole window after it last changed and by at least two channels, so it doesn't thrash.
+    static constexpr double autoZoneWindowSeconds = 4.0;
+    int autoZoneChannels = 0; // Member channels while auto-sized, otherwise 0
+    int autoZonePeak = 0;
+    juce::int64 autoZoneWindowStart = 0;
+
+    void setAutoZoneSize(bool enabled);
+    void resizeLowerZone(int numChannels, int samplePos);
+    void growAutoZone(const Zone &zone, int numNotes, int samplePos);
+    void updateAutoZone(int numSamples);
+
+    // Output stage: writes voice events in the format of the active output mode
+    void sendNoteOn(int slot, int velocity, int samplePos);
+    void sendNoteOff(int slot, int velocity, int samplePos);
+    void sendBend(int slot, int bendValue, float exactBend, int samplePos);
+
+    // A bend in signed steps as the 14-bit wheel value that carries it, saturated at the
+    // wheel's ends rather than wrapped; wide enough that no offset summed into it overflows
+    static int toPitchWheel(juce::int64 steps) { return static_cast<int>(juce::jlimit<juce::int64>(0, 0x3fff, steps + 8192)); }
+    static bool isPitchWheelRail(int value) { return value == 0 || value == 0x3fff; }
+
+    void endVoice(int slot, int velocity, int samplePos);
+
+    // Note-off for a voice: its release bend if there is one, otherwise the end of it
+    void releaseVoice(int slot, int velocity, int samplePos);
+
+    // Sustain pedal (CC 64) per input channel, one bit each. Consumed rather than passed on:
+    // note-offs under it are held back here, and lifting it releases every voice it held
+    // from that channel at once.
+    juce::uint32 sustainPedals = 0;
+
+    void setSustainPedal(int channel, bool isDown, int samplePos);
+
+    // Voice stealing: the stolen voice gets its note-off at once. In MPE output, with a steal
+    // ramp set, the channel's bend then moves to the new voice's in stealRampSteps updates
+    // before its note-on, so the stolen voice's tail doesn't jump in pitch.
+    static constexpr int stealRampSteps = 4;
+    int stealRampSamples = 0;
+
+    void advanceHandoff(int slot, juce::int64 tickSample, int samplePos, juce::int64 blockEnd);
+
+    // Moves per-note expression from the input channel onto the member channels of the
+    // voices it belongs to. Returns false if the message should pass through unchanged.
+    bool remapExpression(const InputEvent &event);
+
+    // MPE input: the player's own bends, decoded per input channel and added to the base of
+    // the voices started from it, so each voice sends one combined bend. The master
+    // channel's bend moves the whole zone. Bend range RPNs set the input's ranges.
+    struct MpeInputState
+    {
+        std::array<float, 16> bendSemitones{};
+        std::array<int, 16> selectedRpn{};
+        float memberRange = 48.0f;
+        float masterRange = 2.0f;
+    };
+
+    MpeInputState mpeInputState;
+
+    // Returns false for messages that aren't the input zone's bends or bend ranges
+    bool decodeMpeInput(const InputEvent &event);
+    float playerBendSteps(int inputChannel, int note) const;
+
+    // MIDI 2.0 per-note pitch bend from UMP input, kept per input channel and key
+    std::array<std::array<float, 128>, 16> perNoteBendSemitones{};
+
+    // Moves the base of the given voices by change steps; they send from sample on
+    void shiftBaseBend(juce::uint32 slots, float change, juce::int64 sample);
+
+    // Bandwidth budget: a token bucket refilled at messageBudget per second. Every
+    // outgoing message spends a token; bends are held back when the bucket is empty.
+    double budgetTokens = 0.0;
+    double budgetTokensPerSample = 0.0;
+    double budgetBurst = 1.0;
+    juce::uint32 pendingBendMask = 0; // Slots with a bend held back by the budget
+
+    // Output is copied to the host buffer through a mirror of the receiver's state, which
+    // drops bends, pressure and CC74 that repeat the value the channel already has. With
+    // coalescing on, of the bends or pressure messages on one channel within one slot only
+    // the last survives, and a bend within the deadband of the one last sent is dropped too.
+    int coalesceSlotSamples = 48;
+    ScratchArray<juce::uint8> supersededEvents; // Per event of outputMidi, from the scratch arena
+    ReceiverMirror receiverState;
+
+    // The same for everything processBlock has put out, before copyOutput drops anything, so
+    // a note-on can leave out the bend reset its channel already holds. Forgotten with
+    // receiverState.
+    ReceiverMirror generatedState;
+
+    void copyOutput(juce::MidiBuffer &destination);
+
+    // Serial output order: DIN and USB-MIDI 1.0 ports drop the status byte of a message that
+    // repeats the one before it. The messages on each sample are grouped by channel, the
+    // channel left running from the last sample first, so a channel's bends and notes go out
+    // back to back. The bytes themselves are left to the driver, as a MidiBuffer holds whole
+    // messages only.
+    juce::MidiBuffer serialMidi; // Reserved in prepareToPlay
+    int runningStatus = -1;
+
+    void orderForRunningStatus(juce::MidiBuffer &buffer);
+
+    void refillBudget(int numSamples);
+    juce::uint32 applyBandwidthBudget(juce::uint32 sendMask, const std::array<int, 16> &bendValues);
+
+    // A bend goes out once it has moved more than sendThreshold 14-bit steps from the value
+    // last sent, or by any amount once the bend has settled on its target. The threshold is
+    // the bendDeadband parameter in steps; with fitDeadband on it is widened past that, block
+    // by block, until the bends alone fit messageBudget.
+    float deadbandSteps = 10.0f;
+    float sendThreshold = 10.0f;
+
+    // Held voices' vibrato, rebuilt with the deadband. It keeps a bend from ever settling,
+    // so with it on bends go out only past the threshold.
+    Vibrato vibrato;
+    double bendRate = 0.0; // Bends per second, smoothed, while fitting
+    static constexpr float maxFittedThreshold = 1024.0f;
+
+    void fitDeadbandToBudget(int numSamples);
+
+    // Adaptive quality: while the smoothed block load stays past adaptiveThreshold the level
+    // steps down, each level doubling the update interval and the deadband, with the lanes
+    // quiet from lanesOffLevel on. Back to full quality offline, or with it off.
+    static constexpr int maxQualityLevel = 3;
+    static constexpr int lanesOffLevel = 2;
+    static constexpr float minAdaptiveDeadbandCents = 1.0f;
+    static constexpr double qualityStepDownSeconds = 0.05;
+    static constexpr double qualityStepUpSeconds = 2.0;
+    static constexpr double qualityRecoveryFraction = 0.6; // Of the threshold, for stepping back up
+    int qualityLevel = 0;
+    juce::int64 qualityOverSamples = 0;
+    juce::int64 qualityUnderSamples = 0;
+
+    void applyQualityLevel();
+    void adaptQualityToLoad(int numSamples);
+
+    // Offline quality: while the host renders offline and offlineQuality is on, every voice is
+    // evaluated on every sample and any change of its bend goes out, with no budget. Each span
+    // between input events is rendered into one stream per voice, in parallel on renderPool
+    // when enough voices sound, then merged into the output in time order.
+    struct StreamedBend
+    {
+        int samplePosition;
+        int value;
+        float exactBend;
+        int lane; // 0 for the bend, otherwise 1 + the modulation lane
+    };
+
+    class BendStreamJob : public juce::ThreadPoolJob
+    {
+    public:
+        explicit BendStreamJob(PitchBendProcessor &p) : juce::ThreadPoolJob("Bend Streams"), processor(p) {}
+
+        JobStatus runJob() override
+        {
+            processor.renderBendStreams(slotMask);
+            return jobHasFinished;
+        }
+
+        juce::uint32 slotMask = 0;
+
+    private:
+        PitchBendProcessor &processor;
+    };
+
+    static constexpr int maxRenderThreads = 7;
+    static constexpr int minParallelVoices = 4;
+    static constexpr int minParallelSpan = 64;
+
+    bool renderOffline = false;
+    juce::int64 renderedUntil = 0;
+    juce::int64 renderFrom = 0;
+    juce::int64 renderEnd = 0;
+    std::array<std::vector<StreamedBend>, 16> bendStreams;
+    std::array<int, 16> bendStreamSizes{};
+
+    // The streams are sized for the prepared block on the background worker, so a device
+    // switch doesn't wait for them: processBlock swaps the built ones in, and renders on the
+    // update grid until they have arrived. Storage swapped out, or built for a size since
+    // replaced, waits on retiredStreams for the timer to free it.
+    struct StreamStorage
+    {
+        std::array<std::vector<StreamedBend>, 16> streams;
+        StreamStorage *next = nullptr;
+    };
+
+    int requestedStreamSize = 0;
+    std::atomic<StreamStorage *> preparedStreams{nullptr};
+    std::atomic<StreamStorage *> retiredStreams{nullptr};
+
+    void prepareBendStreams(int streamSize);
+    void pickUpBendStreams();
+    void freeRetiredStreams();
+
+    // Jobs outlive the pool, which is started by the first setNonRealtime(true)
+    std::vector<std::unique_ptr<BendStreamJob>> renderJobs;
+    std::unique_ptr<juce::ThreadPool> renderPool;
+
+    // Bend of one voice at tickSample, unrounded; moves its envelope segment along. level
+    // gets the rise before its target, or -1 for a release.
+    float evaluateVoiceBend(const Zone &zone, int slot, juce::int64 tickSample, float bendTarget, float curve, float &level);
+    void renderBendStreams(juce::uint32 slotMask);
+    void renderBendsUntil(juce::int64 endSample);
+
+    static constexpr int maxVoices = 15;
+    static constexpr int maxInputEventsPerBlock = 512;
+    static constexpr int maxUmpInputPerBlock = 512;
+    static constexpr int maxBusInputPerBlock = 256;   // For each further MIDI input bus
+    static constexpr int maxBusBytesPerBlock = 4096;
+    static constexpr int maxDecodedEventsPerBlock = maxInputEventsPerBlock + maxUmpInputPerBlock + (maxMidiInputBuses - 1) * maxBusInputPerBlock;
+    static constexpr size_t bytesPerMidiEvent = 3 + sizeof(juce::int32) + sizeof(juce::uint16);
+
+    int calculateUpdateInterval(const Zone &zone, UpdateMode mode) const;
+    int calculateAdaptiveInterval(const Zone &zone, juce::int64 tickSample, float bendTarget, const CurveTable &table,
+                                  juce::uint32 slotMask) const;
+
+    // Next Change mode: the sample at which slot's bend will next differ from the value last
+    // sent by more than sendThreshold, found by inverting the curve table; the end of the bend
+    // if only its final value is left, or neverSample once that has been sent
+    juce::int64 predictNextChange(const Zone &zone, int slot, juce::int64 tickSample, float bendTarget, float curve) const;
+    static constexpr juce::int64 neverSample = std::numeric_limits<juce::int64>::max();
+
+    void publishCurveTable(int zoneIndex, float curve);
+    void timerCallback() override;
+
+    // Largest curve table error, as a fraction of a full-scale bend, that the output can't
+    // show: curveError output LSBs, 14-bit steps or the 2^18 finer 32-bit per-note ones, or
+    // half the bend deadband where that is wider. Curve tables are published at the smallest
+    // resolution within it, and again whenever it changes.
+    float curveErrorTolerance() const;
+    float publishedCurveTolerance = -1.0f;
+
+    // Meters move every meterDecimation timer ticks, with rates over the time since the last
+    static constexpr int meterDecimation = 10;
+    int meterTicks = 0;
+    double meteredAtMs = 0.0;
+    juce::uint64 meteredBends = 0;
+    juce::uint64 meteredSteals = 0;
+
+    void updateMeters();
+
+    // Evaluates every voice slot in one pass. bendTarget is the bend at the end of the curve,
+    // in 14-bit steps, to which just stacking adds each voice's chord offset. Returns the mask of slots whose bend moved past the send threshold, or settled;
+    // their new values are left in bendValues.
+    juce::uint32 calculatePitchBends(juce::int64 tickSample, float bendTarget, float curve, const CurveTable &table,
+                                     juce::int64 durationInSamples, const BendEnvelope::Timing &envelopeTiming,
+                                     std::array<int, VoiceTable::numSlots> &bendValues);
+
+    // The curve and vibrato loops of the bend pass for the widest instruction set this CPU
+    // runs, picked in prepareToPlay
+    const KernelDispatch::Kernels *kernels = &KernelDispatch::get(KernelDispatch::Level::baseline);
+
+    // The pass behind calculatePitchBends, built for a number of slots: only as many as the
+    // zones can hand out, rounded up to whole vectors of four, so a small MPE zone leaves the
+    // rest of the table alone. Each count is a separate instantiation with fixed-size loops;
+    // selectBendPass picks one whenever the zones are laid out or resized.
+    template <int numSlots>
+    juce::uint32 calculateSlotBends(juce::int64 tickSample, float bendTarget, float curve, const CurveTable &table,
+                                    juce::int64 durationInSamples, const BendEnvelope::Timing &envelopeTiming,
+                                    std::array<int, VoiceTable::numSlots> &bendValues);
+
+    using BendPass = decltype(&PitchBendProcessor::calculateSlotBends<VoiceTable::numSlots>);
+    BendPass bendPass = nullptr;
+    void selectBendPass();
+
+    // Fixed-point engine: with fixedPoint on, bends are worked out in FixedPoint's integers
+    // instead of floats, so a render gives the same bends on every platform. Only plain rises
+    // qualify; envelopes, humanized curves, tracking, pressure, vibrato, latched parameters and
+    // bend shaping have no integer form and keep the float engine. Tuning offsets and glides
+    // are rounded to 1/256 step on the way in.
+    bool fixedPointEngineActive() const;
 
-    int calculatePitchBend(double elapsedTime, float amount, float duration, float curve);
-    int findAvailableMPEChannel();
+    // slot's bend at tickSample in 1/256 steps, unclamped; level gets its rise in Q30
+    juce::int64 evaluateFixedPointBend(int slot, juce::int64 tickSample, int targetSteps, const CurveTable &table, float curve,
+                                       juce::int64 durationInSamples, std::int32_t &level) const;
+    juce::int64 evaluateFixedPointRelease(int slot, juce::int64 tickSample, const CurveTable &table) const;
+    juce::uint32 calculateFixedPointBends(juce::int64 tickSample, float bendTarget, float curve, const CurveTable &table,
+                                          juce::int64 durationInSamples, std::array<int, VoiceTable::numSlots> &bendValues);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchBendProcessor)
 };
\ No newline at end of file
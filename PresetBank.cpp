@@ -0,0 +1,105 @@
+#include "PresetBank.h"
+
+namespace
+{
+    // Written to disk the first time no bank exists, and used directly if that fails
+    constexpr PresetBank::Preset factoryPresets[] = {
+        {"Default", 1.0f, 0.5f, 0.0f, 0.0f},
+        {"Subtle Drift", 0.2f, 1.2f, 0.0f, 0.0f},
+        {"Quick Scoop", 1.0f, 0.08f, -1.0f, 0.0f},
+        {"Slow Swell", 1.0f, 1.5f, 1.0f, 0.0f},
+        {"Whole Tone Rise", 2.0f, 0.5f, 0.0f, 0.0f},
+        {"Snap", 0.5f, 0.03f, -2.0f, 0.0f},
+        {"Lazy Slide", 2.0f, 2.0f, 1.5f, 0.0f},
+        {"Tape Wobble", 0.1f, 0.3f, 0.5f, 0.0f},
+    };
+}
+
+PresetBank::PresetBank()
+{
+    auto file = getDefaultFile();
+
+    if (!map(file) && writeFactoryBank(file))
+        map(file);
+
+    if (presets == nullptr)
+    {
+        presets = factoryPresets;
+        numPresets = static_cast<int>(std::size(factoryPresets));
+    }
+}
+
+juce::File PresetBank::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("Better Chord Stacks")
+        .getChildFile("Presets.bank");
+}
+
+bool PresetBank::map(const juce::File &file)
+{
+    if (!file.existsAsFile())
+        return false;
+
+    auto mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+    if (mapping->getData() == nullptr)
+        return false;
+
+    auto count = countRecords(mapping->getData(), mapping->getSize());
+
+    if (count < 0)
+        return false;
+
+    presets = reinterpret_cast<const Preset *>(static_cast<const char *>(mapping->getData()) + sizeof(Header));
+    numPresets = count;
+    mappedFile = std::move(mapping);
+    return true;
+}
+
+int PresetBank::countRecords(const void *data, size_t size)
+{
+    if (size < sizeof(Header))
+        return -1;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.magic != magic || header.version != currentVersion || header.recordSize != sizeof(Preset))
+        return -1;
+
+    auto count = juce::jmin(static_cast<int>(header.numPresets), maxPresets);
+
+    if (size < sizeof(Header) + static_cast<size_t>(count) * sizeof(Preset))
+        return -1;
+
+    return count;
+}
+
+bool PresetBank::writeFactoryBank(const juce::File &file)
+{
+    if (!file.getParentDirectory().createDirectory())
+        return false;
+
+    Header header{magic, currentVersion, static_cast<juce::uint16>(std::size(factoryPresets)),
+                  static_cast<juce::uint32>(sizeof(Preset)), 0};
+
+    // Write to a temporary file so other instances never map a half-written bank
+    juce::TemporaryFile temp(file);
+
+    {
+        juce::FileOutputStream stream(temp.getFile());
+
+        if (!stream.openedOk())
+            return false;
+
+        stream.write(&header, sizeof(header));
+        stream.write(factoryPresets, sizeof(factoryPresets));
+        stream.flush();
+
+        if (stream.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
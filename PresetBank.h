@@ -0,0 +1,65 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Bend presets stored as fixed-size records in one memory-mapped file.
+//
+// One bank is shared by every plugin instance in the process through
+// juce::SharedResourcePointer; the file is mapped when the first instance is created and
+// unmapped with the last. Records are read in place, so switching presets on the audio
+// thread is just picking a pointer.
+class PresetBank
+{
+public:
+    // On-disk record, native byte order
+    struct Preset
+    {
+        char name[24];
+        float amount;
+        float time;
+        float curve;
+        float reserved;
+    };
+
+    static_assert(sizeof(Preset) == 40, "Preset records are part of the file format");
+
+    static constexpr int maxPresets = 128;
+
+    PresetBank();
+
+    int getNumPresets() const { return numPresets; }
+
+    // Null if index is out of range; safe to call from any thread
+    const Preset *getPreset(int index) const
+    {
+        return juce::isPositiveAndBelow(index, numPresets) ? presets + index : nullptr;
+    }
+
+    static juce::File getDefaultFile();
+
+    // Records in a bank file's data, the first at recordsOffset; -1 if it isn't a bank
+    static int countRecords(const void *data, size_t size);
+    static constexpr size_t recordsOffset = 16;
+
+private:
+    static constexpr juce::uint32 magic = 0x42534342; // "BCSB"
+    static constexpr juce::uint16 currentVersion = 1;
+
+    struct Header
+    {
+        juce::uint32 magic;
+        juce::uint16 version;
+        juce::uint16 numPresets;
+        juce::uint32 recordSize;
+        juce::uint32 reserved;
+    };
+
+    static_assert(sizeof(Header) == recordsOffset, "The header is part of the file format");
+
+    bool map(const juce::File &file);
+    static bool writeFactoryBank(const juce::File &file);
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    const Preset *presets = nullptr;
+    int numPresets = 0;
+};
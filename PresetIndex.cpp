@@ -0,0 +1,266 @@
+#include "PresetIndex.h"
+
+static_assert(sizeof(PresetIndex::Entry) == 40, "Entries are written to the cache as they are");
+
+class PresetIndex::Indexer : public juce::Thread
+{
+public:
+    explicit Indexer(PresetIndex &index) : juce::Thread("Preset indexer"), owner(index) {}
+
+    void run() override
+    {
+        owner.loadCache();
+
+        while (!threadShouldExit())
+        {
+            owner.refresh();
+            wait(pollIntervalMs);
+        }
+    }
+
+private:
+    PresetIndex &owner;
+};
+
+PresetIndex::PresetIndex() : indexer(std::make_unique<Indexer>(*this))
+{
+    indexer->startThread(juce::Thread::Priority::background);
+}
+
+PresetIndex::~PresetIndex()
+{
+    indexer->stopThread(5000);
+}
+
+std::shared_ptr<const PresetIndex::Snapshot> PresetIndex::getSnapshot() const
+{
+    const juce::SpinLock::ScopedLockType sl(snapshotLock);
+    return current;
+}
+
+void PresetIndex::publish(std::shared_ptr<const Snapshot> snapshot)
+{
+    {
+        const juce::SpinLock::ScopedLockType sl(snapshotLock);
+        std::swap(current, snapshot);
+    }
+
+    // The old snapshot goes here, off the lock, unless a reader still holds it
+    snapshot.reset();
+    sendChangeMessage();
+}
+
+juce::File PresetIndex::getLibraryDirectory()
+{
+    return PresetBank::getDefaultFile().getSiblingFile("Presets");
+}
+
+juce::File PresetIndex::getCacheFile()
+{
+    return PresetBank::getDefaultFile().getSiblingFile("PresetIndex.cache");
+}
+
+juce::uint64 PresetIndex::hashRecord(const PresetBank::Preset &preset)
+{
+    // FNV-1a over the record's bytes
+    juce::uint64 hash = 14695981039346656037ull;
+    auto *bytes = reinterpret_cast<const juce::uint8 *>(&preset);
+
+    for (size_t i = 0; i < sizeof(preset); ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+void PresetIndex::indexBank(const juce::File &file, juce::uint32 bankIndex, std::vector<Entry> &entries)
+{
+    // Mapped rather than read, so only the header and records are touched
+    juce::MemoryMappedFile mapping(file, juce::MemoryMappedFile::readOnly);
+
+    if (mapping.getData() == nullptr)
+        return;
+
+    auto count = PresetBank::countRecords(mapping.getData(), mapping.getSize());
+    auto *records = static_cast<const char *>(mapping.getData()) + PresetBank::recordsOffset;
+
+    for (int i = 0; i < count; ++i)
+    {
+        PresetBank::Preset preset;
+        std::memcpy(&preset, records + static_cast<size_t>(i) * sizeof(preset), sizeof(preset));
+
+        Entry entry;
+        std::memcpy(entry.name, preset.name, sizeof(entry.name));
+        entry.hash = hashRecord(preset);
+        entry.offset = static_cast<juce::uint32>(PresetBank::recordsOffset + static_cast<size_t>(i) * sizeof(preset));
+        entry.bank = bankIndex;
+        entries.push_back(entry);
+    }
+}
+
+bool PresetIndex::readPreset(const Snapshot &snapshot, const Entry &entry, PresetBank::Preset &preset)
+{
+    if (entry.bank >= snapshot.banks.size())
+        return false;
+
+    juce::FileInputStream stream(getLibraryDirectory().getChildFile(snapshot.banks[entry.bank].path));
+
+    if (!stream.openedOk() || !stream.setPosition(entry.offset) || stream.read(&preset, sizeof(preset)) != static_cast<int>(sizeof(preset)))
+        return false;
+
+    return hashRecord(preset) == entry.hash;
+}
+
+bool PresetIndex::refresh()
+{
+    auto previous = getSnapshot();
+    auto root = getLibraryDirectory();
+
+    std::unordered_map<juce::String, const Bank *> previousBanks;
+
+    for (const auto &bank : previous->banks)
+        previousBanks.emplace(bank.path, &bank);
+
+    auto next = std::make_shared<Snapshot>();
+    next->entries.reserve(previous->entries.size());
+    bool changed = false;
+
+    for (const auto &item : juce::RangedDirectoryIterator(root, true, "*.bank", juce::File::findFiles))
+    {
+        if (juce::Thread::currentThreadShouldExit())
+            return false;
+
+        auto file = item.getFile();
+        auto bankIndex = static_cast<juce::uint32>(next->banks.size());
+
+        Bank bank;
+        bank.path = file.getRelativePathFrom(root);
+        bank.size = item.getFileSize();
+        bank.modified = item.getModificationTime().toMilliseconds();
+        bank.tags = juce::StringArray::fromTokens(file.getParentDirectory().getRelativePathFrom(root), "/\\", "");
+        bank.tags.removeString(".");
+        bank.tags.add(file.getFileNameWithoutExtension());
+        bank.firstEntry = static_cast<juce::uint32>(next->entries.size());
+
+        // Unchanged banks keep their entries; only new and edited ones are read. Files that
+        // aren't banks are kept with no entries, so they aren't read again.
+        auto found = previousBanks.find(bank.path);
+
+        if (found != previousBanks.end() && found->second->size == bank.size && found->second->modified == bank.modified)
+        {
+            auto from = previous->entries.begin() + found->second->firstEntry;
+
+            for (auto entry = from; entry != from + found->second->numEntries; ++entry)
+            {
+                next->entries.push_back(*entry);
+                next->entries.back().bank = bankIndex;
+            }
+        }
+        else
+        {
+            indexBank(file, bankIndex, next->entries);
+            changed = true;
+        }
+
+        bank.numEntries = static_cast<juce::uint32>(next->entries.size()) - bank.firstEntry;
+        next->banks.push_back(std::move(bank));
+    }
+
+    // Nothing new or edited, so a different count means banks were removed
+    changed = changed || next->banks.size() != previous->banks.size();
+
+    if (!changed)
+        return false;
+
+    writeCache(*next);
+    publish(std::move(next));
+    return true;
+}
+
+void PresetIndex::loadCache()
+{
+    juce::FileInputStream stream(getCacheFile());
+
+    if (!stream.openedOk() || static_cast<juce::uint32>(stream.readInt()) != cacheMagic
+        || static_cast<juce::uint32>(stream.readInt()) != cacheVersion)
+        return;
+
+    auto snapshot = std::make_shared<Snapshot>();
+    auto numBanks = stream.readInt();
+    auto numEntries = stream.readInt();
+
+    if (numBanks < 0 || numEntries < 0 || numEntries > stream.getNumBytesRemaining() / static_cast<juce::int64>(sizeof(Entry)))
+        return;
+
+    snapshot->banks.resize(static_cast<size_t>(numBanks));
+
+    for (auto &bank : snapshot->banks)
+    {
+        bank.path = stream.readString();
+        bank.size = stream.readInt64();
+        bank.modified = stream.readInt64();
+        bank.firstEntry = static_cast<juce::uint32>(stream.readInt());
+        bank.numEntries = static_cast<juce::uint32>(stream.readInt());
+
+        for (auto numTags = stream.readInt(); numTags > 0 && !stream.isExhausted(); --numTags)
+            bank.tags.add(stream.readString());
+
+        if (stream.isExhausted() || static_cast<juce::uint64>(bank.firstEntry) + bank.numEntries > static_cast<juce::uint64>(numEntries))
+            return;
+    }
+
+    snapshot->entries.resize(static_cast<size_t>(numEntries));
+    auto bytes = static_cast<int>(snapshot->entries.size() * sizeof(Entry));
+
+    if (stream.read(snapshot->entries.data(), bytes) != bytes)
+        return;
+
+    for (const auto &entry : snapshot->entries)
+        if (entry.bank >= snapshot->banks.size())
+            return;
+
+    publish(std::move(snapshot));
+}
+
+void PresetIndex::writeCache(const Snapshot &snapshot) const
+{
+    auto file = getCacheFile();
+
+    if (!file.getParentDirectory().createDirectory())
+        return;
+
+    // Through a temporary file, so a crash mid-write leaves the last good cache
+    juce::TemporaryFile temp(file);
+
+    {
+        juce::FileOutputStream stream(temp.getFile());
+
+        if (!stream.openedOk())
+            return;
+
+        stream.writeInt(static_cast<int>(cacheMagic));
+        stream.writeInt(static_cast<int>(cacheVersion));
+        stream.writeInt(static_cast<int>(snapshot.banks.size()));
+        stream.writeInt(static_cast<int>(snapshot.entries.size()));
+
+        for (const auto &bank : snapshot.banks)
+        {
+            stream.writeString(bank.path);
+            stream.writeInt64(bank.size);
+            stream.writeInt64(bank.modified);
+            stream.writeInt(static_cast<int>(bank.firstEntry));
+            stream.writeInt(static_cast<int>(bank.numEntries));
+            stream.writeInt(bank.tags.size());
+
+            for (const auto &tag : bank.tags)
+                stream.writeString(tag);
+        }
+
+        stream.write(snapshot.entries.data(), snapshot.entries.size() * sizeof(Entry));
+        stream.flush();
+
+        if (stream.getStatus().failed())
+            return;
+    }
+
+    temp.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PresetBank.h"
+
+// Index of the user's preset library: every record of every .bank file under the library
+// folder, for the preset browser. One index is shared by every editor in the process
+// through juce::SharedResourcePointer.
+//
+// A background thread loads the index cached on disk, publishes it, then walks the
+// library comparing each bank's size and modification time against the cache and reads
+// only the banks that changed. It keeps walking every few seconds to pick up files added,
+// edited or removed, and rewrites the cache after each change. Walks only stat the files,
+// so the cost of a large unchanged library is a directory listing, and nothing waits on
+// the thread: a browser opening takes the latest snapshot as it is.
+class PresetIndex : public juce::ChangeBroadcaster
+{
+public:
+    // One preset record, 40 bytes; its tags are its bank's
+    struct Entry
+    {
+        char name[24];
+        juce::uint64 hash;    // Of the record's bytes, to find it again after files move
+        juce::uint32 offset;  // Of the record in its bank file
+        juce::uint32 bank;    // Index into Snapshot::banks
+    };
+
+    struct Bank
+    {
+        juce::String path; // Relative to the library folder
+        juce::int64 size = 0;
+        juce::int64 modified = 0;
+        juce::StringArray tags; // The folders it is in and its own name
+        juce::uint32 firstEntry = 0;
+        juce::uint32 numEntries = 0;
+    };
+
+    struct Snapshot
+    {
+        std::vector<Bank> banks;
+        std::vector<Entry> entries;
+    };
+
+    PresetIndex();
+    ~PresetIndex() override;
+
+    // Any thread; never waits on a walk
+    std::shared_ptr<const Snapshot> getSnapshot() const;
+
+    // Reads the entry's record back from its bank; false if the bank has changed under it
+    static bool readPreset(const Snapshot &snapshot, const Entry &entry, PresetBank::Preset &preset);
+
+    static juce::File getLibraryDirectory();
+    static juce::File getCacheFile();
+
+private:
+    class Indexer;
+
+    static constexpr juce::uint32 cacheMagic = 0x49534342; // "BCSI"
+    static constexpr juce::uint32 cacheVersion = 1;
+    static constexpr int pollIntervalMs = 3000;
+
+    static juce::uint64 hashRecord(const PresetBank::Preset &preset);
+    static void indexBank(const juce::File &file, juce::uint32 bankIndex, std::vector<Entry> &entries);
+
+    void loadCache();
+    void writeCache(const Snapshot &snapshot) const;
+    bool refresh();
+    void publish(std::shared_ptr<const Snapshot> snapshot);
+
+    mutable juce::SpinLock snapshotLock;
+    std::shared_ptr<const Snapshot> current = std::make_shared<Snapshot>();
+    std::unique_ptr<Indexer> indexer;
+
+    JUCE_DECLARE_NON_COPYABLE(PresetIndex)
+};
@@ -0,0 +1,198 @@
+#include "PreviewSynth.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr float idleIncrement = 0.01f;
+    constexpr float attackSeconds = 0.005f;
+    constexpr float releaseSeconds = 0.08f;
+    constexpr float gainSmoothing = 0.005f; // Per sample, so pressure doesn't zipper
+    constexpr float outputGain = 0.2f;      // Headroom for a full zone
+}
+
+// Hands the note's changes to its lane; the synth renders the lanes itself
+class PreviewSynth::Voice : public juce::MPESynthesiserVoice
+{
+public:
+    Voice(PreviewSynth &owner, int laneIndex) : synth(owner), lane(laneIndex) {}
+
+    void noteStarted() override { synth.startLane(lane, getCurrentlyPlayingNote()); }
+
+    void noteStopped(bool allowTailOff) override
+    {
+        if (allowTailOff)
+        {
+            synth.releaseLane(lane);
+        }
+        else
+        {
+            synth.levels[static_cast<size_t>(lane)] = 0.0f;
+            synth.levelSteps[static_cast<size_t>(lane)] = 0.0f;
+            clearCurrentNote();
+        }
+    }
+
+    void notePressureChanged() override { synth.updateLane(lane, getCurrentlyPlayingNote()); }
+    void notePitchbendChanged() override { synth.updateLane(lane, getCurrentlyPlayingNote()); }
+    void noteTimbreChanged() override { synth.updateLane(lane, getCurrentlyPlayingNote()); }
+    void noteKeyStateChanged() override {}
+
+    void renderNextBlock(juce::AudioBuffer<float> &, int, int) override {}
+    void renderNextBlock(juce::AudioBuffer<double> &, int, int) override {}
+
+    void finish() { clearCurrentNote(); }
+
+private:
+    PreviewSynth &synth;
+    const int lane;
+};
+
+PreviewSynth::PreviewSynth()
+{
+    increments.fill(idleIncrement);
+
+    for (int lane = 0; lane < numVoices; ++lane)
+    {
+        auto *voice = new Voice(*this, lane);
+        laneVoices[static_cast<size_t>(lane)] = voice;
+        addVoice(voice);
+    }
+
+    setVoiceStealingEnabled(true);
+
+    // Until the output's own zone messages say otherwise
+    juce::MPEZoneLayout layout;
+    layout.setLowerZone(15);
+    setZoneLayout(layout);
+}
+
+void PreviewSynth::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    attackStep = static_cast<float>(1.0 / (attackSeconds * sampleRate));
+    releaseStep = static_cast<float>(-1.0 / (releaseSeconds * sampleRate));
+    setCurrentPlaybackSampleRate(sampleRate);
+
+    filtered.fill(0.0f);
+    levels.fill(0.0f);
+    levelSteps.fill(0.0f);
+    gains.fill(0.0f);
+    targetGains.fill(0.0f);
+}
+
+void PreviewSynth::reset()
+{
+    turnOffAllVoices(false);
+    following = false;
+}
+
+void PreviewSynth::follow(bool legacy, int bendRange, const juce::MPEZoneLayout &zones)
+{
+    if (following && legacy == legacyMode && (!legacy || bendRange == legacyBendRange))
+        return;
+
+    following = true;
+    legacyMode = legacy;
+    legacyBendRange = bendRange;
+
+    if (legacy)
+        enableLegacyMode(bendRange, juce::Range<int>(1, 17));
+    else
+        setZoneLayout(zones);
+}
+
+void PreviewSynth::startLane(int lane, const juce::MPENote &note)
+{
+    auto i = static_cast<size_t>(lane);
+    phases[i] = 0.0f;
+    filtered[i] = 0.0f;
+    levels[i] = 0.0f;
+    levelSteps[i] = attackStep;
+    gains[i] = 0.0f;
+    updateLane(lane, note);
+}
+
+void PreviewSynth::updateLane(int lane, const juce::MPENote &note)
+{
+    auto i = static_cast<size_t>(lane);
+    increments[i] = juce::jlimit(1.0e-5f, 0.45f, static_cast<float>(note.getFrequencyInHertz() / sampleRate));
+
+    // Timbre sweeps the cutoff over seven octaves up from 150 Hz
+    auto cutoff = 150.0 * std::exp2(7.0 * note.timbre.asUnsignedFloat());
+    cutoffs[i] = static_cast<float>(1.0 - std::exp(-juce::MathConstants<double>::twoPi * juce::jmin(cutoff, 0.45 * sampleRate) / sampleRate));
+
+    targetGains[i] = outputGain * note.noteOnVelocity.asUnsignedFloat() * (0.4f + 0.6f * note.pressure.asUnsignedFloat());
+}
+
+void PreviewSynth::releaseLane(int lane)
+{
+    levelSteps[static_cast<size_t>(lane)] = releaseStep;
+}
+
+void PreviewSynth::renderNextSubBlock(juce::AudioBuffer<float> &buffer, int startSample, int numSamples)
+{
+    renderLanes(buffer, startSample, numSamples);
+}
+
+void PreviewSynth::renderNextSubBlock(juce::AudioBuffer<double> &buffer, int startSample, int numSamples)
+{
+    renderLanes(buffer, startSample, numSamples);
+}
+
+template <typename SampleType>
+void PreviewSynth::renderLanes(juce::AudioBuffer<SampleType> &buffer, int startSample, int numSamples)
+{
+    const juce::ScopedLock lock(voicesLock);
+
+    if (std::none_of(laneVoices.begin(), laneVoices.end(), [](const Voice *voice) { return voice->isActive(); }))
+        return;
+
+    auto numChannels = buffer.getNumChannels();
+    auto *const *channels = buffer.getArrayOfWritePointers();
+
+    for (int sample = startSample; sample < startSample + numSamples; ++sample)
+    {
+        // Every voice's next sample at once. Nothing here branches on the lane, so it
+        // vectorises across the voices.
+        for (size_t v = 0; v < numVoices; ++v)
+        {
+            auto phase = phases[v];
+            auto increment = increments[v];
+
+            // The naive saw, less the polyBLEP residual either side of the wrap
+            auto after = phase / increment;
+            auto before = (phase - 1.0f) / increment;
+            auto saw = 2.0f * phase - 1.0f;
+            saw -= phase < increment         ? after + after - after * after - 1.0f
+                   : phase > 1.0f - increment ? before * before + before + before + 1.0f
+                                              : 0.0f;
+
+            phase += increment;
+            phases[v] = phase >= 1.0f ? phase - 1.0f : phase;
+
+            filtered[v] += cutoffs[v] * (saw - filtered[v]);
+            levels[v] = juce::jlimit(0.0f, 1.0f, levels[v] + levelSteps[v]);
+            gains[v] += gainSmoothing * (targetGains[v] - gains[v]);
+            outputs[v] = filtered[v] * levels[v] * gains[v];
+        }
+
+        auto mix = 0.0f;
+        for (auto output : outputs)
+            mix += output;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][sample] += static_cast<SampleType>(mix);
+    }
+
+    // Voices whose release has run out are free for the next note
+    for (size_t v = 0; v < numVoices; ++v)
+    {
+        if (levelSteps[v] < 0.0f && levels[v] <= 0.0f)
+        {
+            levelSteps[v] = 0.0f;
+            laneVoices[v]->finish();
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+// A small MPE synth for hearing the bends without setting one up: a band-limited saw per
+// voice through a one-pole low-pass, with velocity and pressure setting the level and timbre
+// (CC74) opening the filter. juce::MPESynthesiser tracks the notes and their expression, but
+// the rendering is done here for every voice together, one sample of all of them per inner
+// loop over state kept in arrays, so the compiler runs the voices side by side in vector
+// lanes. The voices are made up front and nothing allocates once it is prepared.
+class PreviewSynth : private juce::MPESynthesiser
+{
+public:
+    // One per MPE member channel, and one over
+    static constexpr int numVoices = 16;
+
+    PreviewSynth();
+
+    void prepare(double sampleRate);
+
+    // Ends every note at once, silently, and forgets the layout
+    void reset();
+
+    // Takes up the output's format, when it is new: MPE zones, whose later changes come in
+    // with the RPNs in the output itself, or in legacy mode notes on their input channels
+    // bending over bendRange semitones
+    void follow(bool legacy, int bendRange, const juce::MPEZoneLayout &zones);
+
+    // Plays the block's output MIDI into buffer, adding to what is there
+    template <typename SampleType>
+    void render(juce::AudioBuffer<SampleType> &buffer, const juce::MidiBuffer &midi)
+    {
+        renderNextBlock(buffer, midi, 0, buffer.getNumSamples());
+    }
+
+private:
+    class Voice;
+
+    void renderNextSubBlock(juce::AudioBuffer<float> &buffer, int startSample, int numSamples) override;
+    void renderNextSubBlock(juce::AudioBuffer<double> &buffer, int startSample, int numSamples) override;
+
+    template <typename SampleType>
+    void renderLanes(juce::AudioBuffer<SampleType> &buffer, int startSample, int numSamples);
+
+    void startLane(int lane, const juce::MPENote &note);
+    void updateLane(int lane, const juce::MPENote &note);
+    void releaseLane(int lane);
+
+    // Voice state, a lane per voice. Idle lanes run too, silent, with an increment that keeps
+    // the saw's corrections finite.
+    alignas(64) std::array<float, numVoices> phases{};
+    alignas(64) std::array<float, numVoices> increments{};
+    alignas(64) std::array<float, numVoices> cutoffs{};  // One-pole coefficients
+    alignas(64) std::array<float, numVoices> filtered{};
+    alignas(64) std::array<float, numVoices> levels{};   // Envelope, 0..1
+    alignas(64) std::array<float, numVoices> levelSteps{};
+    alignas(64) std::array<float, numVoices> gains{};
+    alignas(64) std::array<float, numVoices> targetGains{};
+    alignas(64) std::array<float, numVoices> outputs{};
+
+    std::array<Voice *, numVoices> laneVoices{};
+    double sampleRate = 44100.0;
+    float attackStep = 0.0f;
+    float releaseStep = 0.0f;
+    bool following = false;
+    bool legacyMode = false;
+    int legacyBendRange = 0;
+};
@@ -0,0 +1,200 @@
+#include "RealtimeLog.h"
+
+juce::uint32 LogCategory::fromString(const juce::String &names)
+{
+    juce::uint32 categories = 0;
+
+    for (auto name : juce::StringArray::fromTokens(names, ",", {}))
+    {
+        name = name.trim().toLowerCase();
+
+        if (name == "all")
+            categories |= all;
+        else if (name == "voices")
+            categories |= voices;
+        else if (name == "zones")
+            categories |= zones;
+        else if (name == "timing")
+            categories |= timing;
+    }
+
+    return categories;
+}
+
+class RealtimeLog::Writer : public juce::Thread
+{
+public:
+    explicit Writer(RealtimeLog &log) : juce::Thread("Realtime log writer"), owner(log) {}
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            owner.writePending();
+            wait(50);
+        }
+    }
+
+private:
+    RealtimeLog &owner;
+};
+
+RealtimeLog::RealtimeLog() = default;
+
+RealtimeLog::~RealtimeLog()
+{
+    stop();
+}
+
+bool RealtimeLog::start(const juce::File &logFile, juce::uint32 categories)
+{
+    stop();
+
+    // Allocated on first use only, so instances that never log don't carry the ring
+    if (ring.empty())
+        ring.resize(static_cast<size_t>(ringSize));
+
+    // Anything a block still in flight pushed after the last stop belongs to no log
+    fifo.read(fifo.getNumReady());
+
+    if (!logFile.getParentDirectory().createDirectory())
+        return false;
+
+    {
+        const juce::ScopedLock sl(loggerLock);
+        logger = std::make_unique<juce::FileLogger>(logFile, "Better Chord Stacks audio thread log", 0);
+        numDropped = 0;
+        numDroppedWritten = 0;
+        startTicks = juce::Time::getHighResolutionTicks();
+    }
+
+    writer = std::make_unique<Writer>(*this);
+    writer->startThread(juce::Thread::Priority::low);
+
+    setCategories(categories);
+    return true;
+}
+
+void RealtimeLog::stop()
+{
+    setCategories(0);
+
+    if (writer == nullptr)
+        return;
+
+    writer->stopThread(1000);
+    writer.reset();
+
+    writePending();
+
+    const juce::ScopedLock sl(loggerLock);
+    logger.reset();
+}
+
+juce::uint32 RealtimeLog::categoryOf(LogEvent event)
+{
+    switch (event)
+    {
+        case LogEvent::noteStarted:
+        case LogEvent::noteEnded:
+        case LogEvent::voiceStolen:
+        case LogEvent::noteDropped:
+            return LogCategory::voices;
+
+        case LogEvent::zoneResized:
+        case LogEvent::zoneLayoutChanged:
+        case LogEvent::bendRangeChanged:
+            return LogCategory::zones;
+
+        case LogEvent::bendDropped:
+        case LogEvent::blockOverrun:
+        case LogEvent::qualityChanged:
+            return LogCategory::timing;
+
+        case LogEvent::numEvents:
+            break;
+    }
+
+    return 0;
+}
+
+juce::String RealtimeLog::format(const LogRecord &record)
+{
+    const auto &args = record.args;
+
+    switch (record.event)
+    {
+        case LogEvent::noteStarted:
+            return "note " + juce::String(args[1]) + " on channel " + juce::String(args[0]) + ", velocity " + juce::String(args[2]);
+        case LogEvent::noteEnded:
+            return "note " + juce::String(args[1]) + " off channel " + juce::String(args[0]);
+        case LogEvent::voiceStolen:
+            return "stole channel " + juce::String(args[0]) + " from note " + juce::String(args[1]);
+        case LogEvent::noteDropped:
+            return "dropped note " + juce::String(args[0]) + ", no channel free in the shared pool";
+        case LogEvent::bendDropped:
+            return "bend held back on channel " + juce::String(args[0]) + " dropped with its voice";
+        case LogEvent::zoneResized:
+            return "lower zone resized to " + juce::String(args[0]) + " member channels";
+        case LogEvent::zoneLayoutChanged:
+            return "output mode " + juce::String(args[0]) + ", upper zone " + juce::String(args[1]) + " channels";
+        case LogEvent::bendRangeChanged:
+            return "bend range " + juce::String(args[0]) + " semitones";
+        case LogEvent::blockOverrun:
+            return "block overran: " + juce::String(args[0]) + " us for " + juce::String(args[1]) + " us of audio";
+        case LogEvent::qualityChanged:
+            return "adaptive quality level " + juce::String(args[0]) + " at " + juce::String(args[1]) + "% load";
+        case LogEvent::numEvents:
+            break;
+    }
+
+    return {};
+}
+
+void RealtimeLog::push(LogEvent event, juce::int64 sample, int arg0, int arg1, int arg2)
+{
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 == 0)
+    {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto &record = ring[static_cast<size_t>(scope.startIndex1)];
+    record.sample = sample;
+    record.ticks = juce::Time::getHighResolutionTicks();
+    record.args = {arg0, arg1, arg2};
+    record.event = event;
+}
+
+void RealtimeLog::waitUntilWritten()
+{
+    if (getCategories() != 0)
+        writePending();
+}
+
+void RealtimeLog::writePending()
+{
+    const juce::ScopedLock sl(loggerLock);
+
+    if (logger == nullptr)
+        return;
+
+    // Read before draining: every drop so far happened with these records already queued
+    auto dropped = numDropped.load(std::memory_order_relaxed);
+
+    const auto scope = fifo.read(fifo.getNumReady());
+    scope.forEach([this](int index)
+    {
+        const auto &record = ring[static_cast<size_t>(index)];
+        auto milliseconds = juce::Time::highResolutionTicksToSeconds(record.ticks - startTicks) * 1000.0;
+        logger->logMessage(juce::String(milliseconds, 3) + " ms, sample " + juce::String(record.sample) + ": " + format(record));
+    });
+
+    if (dropped != numDroppedWritten)
+    {
+        logger->logMessage(juce::String(dropped - numDroppedWritten) + " records dropped, the ring was full");
+        numDroppedWritten = dropped;
+    }
+}
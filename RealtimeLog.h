@@ -0,0 +1,114 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Building with BCS_REALTIME_LOG=0 compiles out every BCS_LOG line, arguments and all
+#ifndef BCS_REALTIME_LOG
+#define BCS_REALTIME_LOG 1
+#endif
+
+#if BCS_REALTIME_LOG
+#define BCS_LOG(log, ...) (log).write(__VA_ARGS__)
+#else
+#define BCS_LOG(log, ...) ((void) 0)
+#endif
+
+// What the audio thread can log, with the arguments each takes. The text for each is in
+// RealtimeLog.cpp and is only put together on the writer thread.
+enum class LogEvent : juce::uint8
+{
+    noteStarted,       // Member channel, note, velocity
+    noteEnded,         // Member channel, note
+    voiceStolen,       // Member channel, note
+    noteDropped,       // Note
+    bendDropped,       // Member channel
+    zoneResized,       // Member channels
+    zoneLayoutChanged, // Output mode, upper zone channels
+    bendRangeChanged,  // Semitones
+    blockOverrun,      // Microseconds taken, microseconds the block covered
+    qualityChanged,    // Adaptive quality level, load in percent
+    numEvents
+};
+
+// Events are logged by category, chosen while running; a category's bit set in the mask
+// passed to start or setCategories turns it on
+struct LogCategory
+{
+    enum : juce::uint32
+    {
+        voices = 1 << 0, // Notes starting, ending, stolen and dropped
+        zones = 1 << 1,  // Layout, zone size and bend range
+        timing = 1 << 2, // Blocks that overran, bends held back, quality levels
+        all = voices | zones | timing
+    };
+
+    // From a comma-separated list of names ("voices,timing"), or "all"
+    static juce::uint32 fromString(const juce::String &names);
+};
+
+struct LogRecord
+{
+    juce::int64 sample = 0; // Absolute, counted from prepareToPlay
+    juce::int64 ticks = 0;  // juce::Time high-resolution ticks when it was written
+    std::array<juce::int32, 3> args{};
+    LogEvent event = LogEvent::numEvents;
+};
+
+// Logging the audio thread can do. write copies a fixed-size record into a preallocated
+// ring and never waits, allocates or formats; a background thread turns the records into
+// lines for a juce::FileLogger. With no category on, write is one relaxed load.
+class RealtimeLog
+{
+public:
+    RealtimeLog();
+    ~RealtimeLog();
+
+    // Message thread. Starting again while running switches to the new file.
+    bool start(const juce::File &logFile, juce::uint32 categories);
+    void stop();
+
+    // Any thread, while running or not
+    void setCategories(juce::uint32 categories) { enabledCategories.store(categories, std::memory_order_relaxed); }
+    juce::uint32 getCategories() const { return enabledCategories.load(std::memory_order_relaxed); }
+
+    // Audio thread. Use it through BCS_LOG, so it can be compiled out.
+    void write(LogEvent event, juce::int64 sample, int arg0 = 0, int arg1 = 0, int arg2 = 0)
+    {
+        if ((getCategories() & categoryOf(event)) != 0)
+            push(event, sample, arg0, arg1, arg2);
+    }
+
+    // For offline rendering, which outruns the writer thread: formats everything queued
+    void waitUntilWritten();
+
+    int getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+    // Message thread
+    size_t getMemoryBytes() const { return ring.capacity() * sizeof(LogRecord); }
+
+private:
+    class Writer;
+
+    static constexpr int ringSize = 1 << 12;
+
+    static juce::uint32 categoryOf(LogEvent event);
+    static juce::String format(const LogRecord &record);
+
+    void push(LogEvent event, juce::int64 sample, int arg0, int arg1, int arg2);
+    void writePending();
+
+    juce::AbstractFifo fifo{ringSize};
+    std::vector<LogRecord> ring;
+
+    // Off until started, so write costs nothing in instances that never log
+    std::atomic<juce::uint32> enabledCategories{0};
+    std::atomic<int> numDropped{0};
+    int numDroppedWritten = 0;
+    juce::int64 startTicks = 0;
+
+    juce::CriticalSection loggerLock; // Between the writer thread and start/stop, never the audio thread
+    std::unique_ptr<juce::FileLogger> logger;
+    std::unique_ptr<Writer> writer;
+
+    JUCE_DECLARE_NON_COPYABLE(RealtimeLog)
+};
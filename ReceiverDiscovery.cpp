@@ -0,0 +1,235 @@
+#include "ReceiverDiscovery.h"
+
+namespace
+{
+    using juce::midi_ci::ChannelInGroup;
+
+    // F0 7E <device ID> 0D <sub-ID> <version> <source MUID> <destination MUID> ...
+    constexpr int destinationMuidOffset = 10;
+
+    juce::uint32 readMuid(const juce::uint8 *data)
+    {
+        // Four 7-bit bytes, least significant first
+        return static_cast<juce::uint32>(data[0]) | static_cast<juce::uint32>(data[1]) << 7
+               | static_cast<juce::uint32>(data[2]) << 14 | static_cast<juce::uint32>(data[3]) << 21;
+    }
+}
+
+void ReceiverDiscovery::MessageRing::allocate()
+{
+    if (bytes.empty())
+        bytes.resize(static_cast<size_t>(capacity));
+}
+
+bool ReceiverDiscovery::MessageRing::push(const juce::uint8 *data, int numBytes)
+{
+    if (numBytes > maxMessageSize || fifo.getFreeSpace() < numBytes + 2)
+        return false;
+
+    // The size and the message are committed together, so the reader never sees one alone
+    const auto scope = fifo.write(numBytes + 2);
+    int i = 0;
+
+    scope.forEach([&](int index)
+    {
+        bytes[static_cast<size_t>(index)] = i < 2 ? static_cast<juce::uint8>(numBytes >> (8 * i)) : data[i - 2];
+        ++i;
+    });
+
+    return true;
+}
+
+int ReceiverDiscovery::MessageRing::pop(juce::uint8 *destination)
+{
+    if (fifo.getNumReady() == 0)
+        return 0;
+
+    int numBytes = 0, shift = 0;
+    fifo.read(2).forEach([&](int index)
+    {
+        numBytes |= bytes[static_cast<size_t>(index)] << shift;
+        shift += 8;
+    });
+
+    int i = 0;
+    fifo.read(numBytes).forEach([&](int index) { destination[i++] = bytes[static_cast<size_t>(index)]; });
+
+    return numBytes;
+}
+
+ReceiverDiscovery::ReceiverDiscovery() = default;
+
+ReceiverDiscovery::~ReceiverDiscovery()
+{
+    stop();
+}
+
+void ReceiverDiscovery::start()
+{
+    stop();
+
+    incoming.allocate();
+    outgoing.allocate();
+    received.resize(static_cast<size_t>(maxMessageSize));
+
+    // Replies to a previous run are of no use to this one
+    while (incoming.pop(received.data()) > 0)
+    {
+    }
+
+    // 0x7D is the manufacturer ID set aside for non-commercial use
+    const auto options = juce::midi_ci::DeviceOptions()
+                             .withOutputs({this})
+                             .withDeviceInfo({{std::byte{0x7d}, std::byte{0x00}, std::byte{0x00}}, {}, {}, {}})
+                             .withFeatures(juce::midi_ci::DeviceFeatures()
+                                               .withProfileConfigurationSupported()
+                                               .withPropertyExchangeSupported())
+                             .withMaxSysExSize(static_cast<size_t>(maxMessageSize - 2));
+
+    device = std::make_unique<juce::midi_ci::Device>(options);
+    device->addListener(*this);
+
+    receiver.reset();
+    discoveryAttempts = 0;
+    enabledMemberChannels = -1;
+    ourMuid.store(device->getMuid().get(), std::memory_order_release);
+}
+
+void ReceiverDiscovery::stop()
+{
+    ourMuid.store(0, std::memory_order_release);
+    perNote.store(false, std::memory_order_relaxed);
+
+    // The Device invalidates its MUID on the way out, through the outgoing ring
+    device.reset();
+    receiver.reset();
+}
+
+bool ReceiverDiscovery::update(int memberChannels)
+{
+    jassert(isRunning());
+
+    // The MIDI 1.0 byte stream only ever carries group 1
+    while (auto numBytes = incoming.pop(received.data()))
+        device->processMessage({0, {reinterpret_cast<const std::byte *>(received.data() + 1), static_cast<size_t>(numBytes - 2)}});
+
+    // A MUID collision makes the Device pick a new one
+    ourMuid.store(device->getMuid().get(), std::memory_order_release);
+
+    if (discoveryRequested.exchange(false, std::memory_order_relaxed))
+    {
+        receiver.reset();
+        discoveryAttempts = 0;
+    }
+
+    // Until something answers, or it is clear nothing will
+    auto now = juce::Time::getMillisecondCounter();
+
+    if (!receiver.has_value() && discoveryAttempts < maxDiscoveryAttempts
+        && (discoveryAttempts == 0 || now - lastDiscoveryMs >= retryIntervalMs))
+    {
+        device->sendDiscovery();
+        lastDiscoveryMs = now;
+        ++discoveryAttempts;
+    }
+
+    if (receiver.has_value() && memberChannels != enabledMemberChannels && offersMpeProfile())
+    {
+        // Profile On counts the manager channel along with its members
+        device->sendProfileEnablement(*receiver, ChannelInGroup::channel0, mpeProfile,
+                                      memberChannels > 0 ? memberChannels + 1 : 0);
+        enabledMemberChannels = memberChannels;
+    }
+
+    auto wantsPerNote = receiver.has_value() && !offersMpe() && declaresMidi2();
+    return perNote.exchange(wantsPerNote, std::memory_order_relaxed) != wantsPerNote;
+}
+
+bool ReceiverDiscovery::consume(const juce::uint8 *data, int numBytes)
+{
+    auto muid = ourMuid.load(std::memory_order_acquire);
+
+    if (muid == 0 || numBytes < destinationMuidOffset + 5 || data[1] != 0x7e || data[3] != 0x0d)
+        return false;
+
+    auto destination = readMuid(data + destinationMuidOffset);
+
+    // Dropped while the ring is full; discovery simply asks again
+    if (destination == muid || destination == juce::midi_ci::MUID::getBroadcast().get())
+        incoming.push(data, numBytes);
+
+    // None of it passes through: with the receiver's output routed back to us, that would
+    // hand the receiver its own messages
+    return true;
+}
+
+int ReceiverDiscovery::popOutgoing(juce::uint8 *destination)
+{
+    return outgoing.pop(destination);
+}
+
+void ReceiverDiscovery::processMessage(juce::ump::BytesOnGroup message)
+{
+    std::array<juce::uint8, maxMessageSize> framed;
+    auto numBytes = static_cast<int>(message.bytes.size()) + 2;
+
+    // Never larger than the Device was told it may send
+    jassert(numBytes <= maxMessageSize);
+
+    if (numBytes > maxMessageSize)
+        return;
+
+    framed[0] = 0xf0;
+    std::memcpy(framed.data() + 1, message.bytes.data(), message.bytes.size());
+    framed[static_cast<size_t>(numBytes - 1)] = 0xf7;
+
+    outgoing.push(framed.data(), numBytes);
+}
+
+void ReceiverDiscovery::deviceAdded(juce::midi_ci::MUID muid)
+{
+    // The first device to answer is taken to be the receiver
+    if (receiver.has_value())
+        return;
+
+    receiver = muid;
+    enabledMemberChannels = -1;
+
+    // Either is skipped if the receiver didn't declare it in its discovery reply
+    device->sendProfileInquiry(muid, ChannelInGroup::wholeBlock);
+    device->sendPropertyCapabilitiesInquiry(muid);
+}
+
+void ReceiverDiscovery::deviceRemoved(juce::midi_ci::MUID muid)
+{
+    if (receiver == muid)
+        receiver.reset();
+}
+
+bool ReceiverDiscovery::offersMpeProfile() const
+{
+    // Offered on the lower zone's manager channel, channel 1
+    const auto *states = device->getProfileStateForMuid(*receiver, juce::midi_ci::ChannelAddress{}.withChannel(ChannelInGroup::channel0));
+    return states != nullptr && states->get(mpeProfile).isSupported();
+}
+
+bool ReceiverDiscovery::offersMpe() const
+{
+    if (offersMpeProfile())
+        return true;
+
+    if (const auto *channels = device->getChannelListForMuid(*receiver).getArray())
+        for (const auto &channel : *channels)
+            if (channel.getProperty("clusterType", {}) == juce::var("mpe"))
+                return true;
+
+    return false;
+}
+
+bool ReceiverDiscovery::declaresMidi2() const
+{
+    // Bit 1 of the capability byte is MIDI-CI 1.1's protocol negotiation, which only MIDI 2.0
+    // devices set
+    auto discovery = device->getDiscoveryInfoForMuid(*receiver);
+    return discovery.has_value() && (discovery->capabilities & std::byte{0x02}) != std::byte{};
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Asks the receiver downstream over MIDI-CI what it can play, for the Auto output mode.
+// Discovery goes out on the plugin's MIDI output and the replies come back on its input, so
+// the host has to route the receiver's MIDI output back to the plugin.
+//
+// A receiver offering the MPE profile, or listing an MPE cluster in its property exchange
+// channel list, gets MPE; the profile is then switched on across the lower zone, so the
+// receiver follows the bend range the zone configuration sends rather than one set by hand.
+// A receiver doing neither that declares MIDI 2.0 protocol support gets per-note bend.
+// Anything else, silence included, stays on MPE, which any receiver can be configured for.
+//
+// The Device lives on the message thread. The audio thread hands it replies addressed to our
+// MUID and takes its outgoing messages through two preallocated rings, so it never waits on
+// it or allocates for it.
+class ReceiverDiscovery : private juce::midi_ci::DeviceListener,
+                          private juce::midi_ci::DeviceMessageHandler
+{
+public:
+    ReceiverDiscovery();
+    ~ReceiverDiscovery() override;
+
+    // Message thread. update() passes the replies received since the last call to the Device,
+    // retries discovery while nothing has answered and keeps the MPE profile's channel count
+    // in step with the zone. Returns true when the preferred output has changed.
+    void start();
+    void stop();
+    bool isRunning() const { return device != nullptr; }
+    bool update(int memberChannels);
+
+    // Any thread; discovery starts over on the next update, as after a change of routing
+    void requestDiscovery() { discoveryRequested.store(true, std::memory_order_relaxed); }
+
+    // Any thread; false until a receiver has been found that wants per-note bend
+    bool prefersPerNote() const { return perNote.load(std::memory_order_relaxed); }
+
+    // Audio thread. consume() takes a complete SysEx message, F0 to F7, and returns true if it
+    // was MIDI-CI, which while running is all kept from the output; anything else should pass
+    // through. popOutgoing() copies the next message to send, F0 to F7, and returns its size,
+    // or 0 if there is none.
+    static constexpr int maxMessageSize = 514; // 512 bytes of MIDI-CI, F0 and F7
+
+    bool consume(const juce::uint8 *data, int numBytes);
+    bool hasOutgoing() const { return outgoing.hasMessage(); }
+    int popOutgoing(juce::uint8 *destination);
+
+private:
+    // Whole SysEx messages, each behind its uint16 size; one writer and one reader
+    class MessageRing
+    {
+    public:
+        void allocate();
+        bool push(const juce::uint8 *data, int numBytes);
+        int pop(juce::uint8 *destination); // destination holds maxMessageSize
+        bool hasMessage() const { return fifo.getNumReady() > 0; }
+
+    private:
+        static constexpr int capacity = 4096;
+
+        juce::AbstractFifo fifo{capacity};
+        std::vector<juce::uint8> bytes;
+    };
+
+    void processMessage(juce::ump::BytesOnGroup message) override;
+
+    void deviceAdded(juce::midi_ci::MUID muid) override;
+    void deviceRemoved(juce::midi_ci::MUID muid) override;
+
+    bool offersMpeProfile() const;
+    bool offersMpe() const;
+    bool declaresMidi2() const;
+
+    // MIDI-CI Profile ID of the MPE profile
+    static constexpr juce::midi_ci::Profile mpeProfile{std::byte{0x7e}, std::byte{0x31}, std::byte{0x00},
+                                                       std::byte{0x01}, std::byte{0x01}};
+
+    static constexpr int maxDiscoveryAttempts = 5;
+    static constexpr juce::uint32 retryIntervalMs = 2000;
+
+    // Allocated by the first start, and kept so the audio thread never sees them go
+    MessageRing incoming, outgoing;
+    std::atomic<juce::uint32> ourMuid{0}; // 0 while stopped
+
+    std::atomic<bool> discoveryRequested{false};
+    std::atomic<bool> perNote{false};
+
+    // Message thread only
+    std::unique_ptr<juce::midi_ci::Device> device;
+    std::optional<juce::midi_ci::MUID> receiver;
+    std::vector<juce::uint8> received; // One message out of incoming
+    int discoveryAttempts = 0;
+    juce::uint32 lastDiscoveryMs = 0;
+    int enabledMemberChannels = -1; // Of the MPE profile; -1 before it has been switched on
+
+    JUCE_DECLARE_NON_COPYABLE(ReceiverDiscovery)
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// What the receiver last heard on each channel for the values that are sent over and over:
+// pitch bend, channel pressure and timbre (CC74). A message that would leave them as they
+// are changes nothing and can be dropped. A value is -1 until it is sent, and again after a
+// reset or whenever the output may have gone somewhere the mirror didn't see.
+class ReceiverMirror
+{
+public:
+    ReceiverMirror() { forget(); }
+
+    void forget()
+    {
+        bend.fill(-1);
+        pressure.fill(-1);
+        timbre.fill(-1);
+    }
+
+    // Last bend on a channel (0 to 15), or -1 if unknown
+    int getBend(int channel) const { return bend[static_cast<size_t>(channel)]; }
+
+    // Records a message on its way out. Returns false if the receiver already has its value;
+    // anything not tracked changes state as far as the mirror knows.
+    bool update(const std::uint8_t *data, int numBytes)
+    {
+        auto status = data[0];
+
+        if (status == 0xff)
+        {
+            forget();
+            return true;
+        }
+
+        if (status >= 0xf0 || numBytes < 2)
+            return true;
+
+        auto channel = static_cast<size_t>(status & 0x0f);
+
+        switch (status & 0xf0)
+        {
+        case 0xd0:
+            return exchange(pressure[channel], data[1]);
+
+        case 0xe0:
+            return numBytes < 3 || exchange(bend[channel], data[1] | (data[2] << 7));
+
+        case 0xb0:
+            if (numBytes < 3)
+                return true;
+
+            if (data[1] == 74)
+                return exchange(timbre[channel], data[2]);
+
+            // Reset All Controllers: receivers differ on what it covers
+            if (data[1] == 121)
+            {
+                bend[channel] = -1;
+                pressure[channel] = -1;
+                timbre[channel] = -1;
+            }
+
+            return true;
+
+        default:
+            return true;
+        }
+    }
+
+private:
+    std::array<std::int16_t, 16> bend;
+    std::array<std::int8_t, 16> pressure;
+    std::array<std::int8_t, 16> timbre;
+
+    template <typename Value>
+    static bool exchange(Value &last, int value)
+    {
+        if (last == value)
+            return false;
+
+        last = static_cast<Value>(value);
+        return true;
+    }
+};
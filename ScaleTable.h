@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// Bend targets that land on a scale: for each MIDI note, the distance in cents to the next
+// note of the scale above it, or below it. A note on the scale moves a whole degree; one
+// off it moves to the nearest degree that way. Rebuilt only when the scale, root or
+// direction change, so a note-on finds its target with one lookup.
+struct ScaleTable
+{
+    // Scales as twelve bits, bit n for n semitones above the root
+    struct Scale
+    {
+        const char *name;
+        unsigned int degrees;
+    };
+
+    static constexpr Scale scales[] = {
+        {"Major", 0xab5},
+        {"Natural Minor", 0x5ad},
+        {"Harmonic Minor", 0x9ad},
+        {"Melodic Minor", 0xaad},
+        {"Dorian", 0x6ad},
+        {"Mixolydian", 0x6b5},
+        {"Major Pentatonic", 0x295},
+        {"Minor Pentatonic", 0x4a9},
+        {"Blues", 0x4e9},
+        {"Whole Tone", 0x555},
+        {"Chromatic", 0xfff},
+    };
+
+    std::array<float, 128> targetCents{};
+    int scale = -1;
+    int root = 0;
+    int direction = 0;
+
+    // direction is 1 for up and -1 for down
+    void build(int newScale, int newRoot, int newDirection)
+    {
+        if (newScale == scale && newRoot == root && newDirection == direction)
+            return;
+
+        scale = newScale;
+        root = newRoot;
+        direction = newDirection;
+
+        auto degrees = scales[scale].degrees;
+
+        for (int note = 0; note < 128; ++note)
+        {
+            auto degree = ((note - root) % 12 + 12) % 12;
+            int step = 1;
+
+            while (((degrees >> ((degree + direction * step + 12) % 12)) & 1u) == 0)
+                ++step;
+
+            targetCents[static_cast<size_t>(note)] = static_cast<float>(direction * step * 100);
+        }
+    }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CacheLine.h"
+
+// One bump-pointer arena for the arrays a block needs only while it runs: decoded input,
+// change masks, group lists, emission queues. prepare() allocates it once, off the audio
+// thread, for the worst block the processor was prepared for; each block resets it at its
+// start and takes its arrays from it in turn, so the audio thread never allocates and a
+// block's temporaries sit together in memory. Each array keeps how much of it the block
+// filled, for sizing them.
+class ScratchArena
+{
+public:
+    // Not the audio thread. Anything taken from it before is gone.
+    void prepare(size_t capacityBytes)
+    {
+        // Rounded up to whole cache lines, from an aligned start
+        capacity = (capacityBytes + cacheLineSize - 1) & ~(cacheLineSize - 1);
+        storage.reset(new std::byte[capacity + cacheLineSize]);
+
+        auto start = reinterpret_cast<std::uintptr_t>(storage.get());
+        base = storage.get() + ((cacheLineSize - (start & (cacheLineSize - 1))) & (cacheLineSize - 1));
+        used = 0;
+    }
+
+    // Audio thread, at the top of each block
+    void reset() { used = 0; }
+
+    // Audio thread: space for count values, aligned for T and left uninitialised, or nullptr
+    // if the arena is full, which prepare() should have made impossible
+    template <typename T>
+    T *allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "Nothing taken from the arena is ever destroyed");
+
+        auto start = (used + alignof(T) - 1) & ~(alignof(T) - 1);
+        auto end = start + count * sizeof(T);
+
+        if (end > capacity)
+        {
+            jassertfalse;
+            return nullptr;
+        }
+
+        used = end;
+        return reinterpret_cast<T *>(base + start);
+    }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+
+    // Bytes count values of T take, with the worst-case padding before them
+    template <typename T>
+    static constexpr size_t bytesFor(size_t count)
+    {
+        return count * sizeof(T) + alignof(T) - 1;
+    }
+
+private:
+    std::unique_ptr<std::byte[]> storage;
+    std::byte *base = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+};
+
+// A fixed-capacity array taken from a ScratchArena for one block, with the part of
+// std::vector's interface the processor uses. Valid until the arena's next reset; values
+// pushed past its capacity are dropped.
+template <typename T>
+class ScratchArray
+{
+public:
+    // Audio thread, after the arena's reset
+    void allocate(ScratchArena &arena, size_t maxSize)
+    {
+        elements = arena.allocate<T>(maxSize);
+        maxElements = elements != nullptr ? maxSize : 0;
+        numElements = 0;
+        peakElements = 0;
+    }
+
+    void push_back(const T &value)
+    {
+        jassert(numElements < maxElements);
+
+        if (numElements < maxElements)
+        {
+            new (elements + numElements++) T(value);
+            peakElements = juce::jmax(peakElements, numElements);
+        }
+    }
+
+    void clear() { numElements = 0; }
+
+    // The most it has held since it was allocated, in bytes
+    size_t getPeakBytes() const { return peakElements * sizeof(T); }
+
+    size_t size() const { return numElements; }
+    size_t capacity() const { return maxElements; }
+    bool empty() const { return numElements == 0; }
+
+    T *data() { return elements; }
+    const T *data() const { return elements; }
+    T &operator[](size_t index) { return elements[index]; }
+    const T &operator[](size_t index) const { return elements[index]; }
+    T &back() { return elements[numElements - 1]; }
+
+    T *begin() { return elements; }
+    T *end() { return elements + numElements; }
+    const T *begin() const { return elements; }
+    const T *end() const { return elements + numElements; }
+    const T *cbegin() const { return elements; }
+    const T *cend() const { return elements + numElements; }
+
+private:
+    T *elements = nullptr;
+    size_t maxElements = 0;
+    size_t numElements = 0;
+    size_t peakElements = 0;
+};
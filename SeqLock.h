@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Latest value of a small plain struct for any number of readers, without locks. The writer
+// never waits: it makes the sequence odd, stores the value word by word and makes it even
+// again. A reader copies the words out between two looks at the sequence and tries again if
+// they differ or the first was odd, so it never keeps half a write. Meant for a few hundred
+// bytes written once per block and read once per frame.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "The value is copied as raw words");
+
+public:
+    // Writer side; one writer only
+    void write(const T &value)
+    {
+        std::array<std::uint32_t, numWords> buffer{};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+
+        auto sequence = sequenceNumber.load(std::memory_order_relaxed);
+        sequenceNumber.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < numWords; ++i)
+            words[i].store(buffer[i], std::memory_order_relaxed);
+
+        sequenceNumber.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Reader side. Returns false, leaving value as it was, if nothing has been written since
+    // the read that set lastSequence.
+    bool read(T &value, std::uint32_t &lastSequence) const
+    {
+        std::array<std::uint32_t, numWords> buffer;
+
+        for (;;)
+        {
+            auto before = sequenceNumber.load(std::memory_order_acquire);
+
+            if (before == lastSequence)
+                return false;
+
+            if ((before & 1) != 0)
+                continue;
+
+            for (size_t i = 0; i < numWords; ++i)
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequenceNumber.load(std::memory_order_relaxed) == before)
+            {
+                std::memcpy(static_cast<void *>(&value), buffer.data(), sizeof(T));
+                lastSequence = before;
+                return true;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t numWords = (sizeof(T) + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+
+    std::atomic<std::uint32_t> sequenceNumber{0};
+    std::array<std::atomic<std::uint32_t>, numWords> words{};
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Member channels claimed by every instance in the process that feeds the same receiver.
+// Instances opt in with the same pool ID and then take channels only by flipping their bit
+// from clear to set with compare-and-swap, so two audio threads can never both win one
+// channel, and neither ever waits on the other.
+//
+// Ordering: a successful claim is an acquire, and clearing a bit on release is a release,
+// so an instance that takes a channel sees everything the previous owner did before it let
+// go, including its note-off having been queued. Nothing is promised about when the two
+// hosts' output reaches the receiver: the pool keeps instances off each other's channels,
+// it doesn't order their MIDI. Instances in other processes, including sandboxed plugin
+// hosts, have pools of their own.
+struct SharedChannelPool
+{
+    static constexpr int numPools = 16; // Pool IDs are 1 to numPools
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "Claims are made on the audio thread");
+
+    // Bit (channel - 1) is set while some instance holds that channel
+    static std::atomic<std::uint32_t> &get(int poolId)
+    {
+        static std::array<std::atomic<std::uint32_t>, numPools> pools{};
+        return pools[static_cast<size_t>(poolId - 1)];
+    }
+};
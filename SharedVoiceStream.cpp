@@ -0,0 +1,69 @@
+#include "SharedVoiceStream.h"
+
+static_assert(std::atomic<juce::uint64>::is_always_lock_free, "the frame count is shared with other processes");
+
+SharedVoiceStream::~SharedVoiceStream()
+{
+    stop();
+    mapping.reset();
+    file.deleteFile();
+}
+
+bool SharedVoiceStream::createMapping()
+{
+    auto folder = juce::File("/dev/shm");
+
+    if (!folder.isDirectory())
+        folder = juce::File::getSpecialLocation(juce::File::tempDirectory);
+
+    file = folder.getChildFile("BetterChordStacks-" + juce::Uuid().toString() + ".voices");
+
+    // Written out in full, so every page exists before the audio thread touches it
+    {
+        juce::FileOutputStream out(file);
+
+        if (!out.openedOk() || !out.writeRepeatedByte(0, fileSize))
+            return false;
+    }
+
+    mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readWrite, false);
+
+    if (mapping->getData() == nullptr || mapping->getSize() < fileSize)
+    {
+        mapping.reset();
+        file.deleteFile();
+        return false;
+    }
+
+    auto *base = static_cast<juce::uint8 *>(mapping->getData());
+    header = new (base) Header{magic, version, static_cast<juce::uint32>(sizeof(SharedVoiceFrame)), numFrames, {0}, {0}};
+    frames = base + framesOffset;
+    return true;
+}
+
+bool SharedVoiceStream::start()
+{
+    if (mapping == nullptr && !createMapping())
+        return false;
+
+    header->streaming.store(1, std::memory_order_release);
+    streaming.store(true, std::memory_order_release);
+    return true;
+}
+
+void SharedVoiceStream::stop()
+{
+    streaming.store(false, std::memory_order_release);
+
+    if (header != nullptr)
+        header->streaming.store(0, std::memory_order_release);
+}
+
+void SharedVoiceStream::write(const SharedVoiceFrame &frame)
+{
+    if (!isStreaming())
+        return;
+
+    std::memcpy(frames + (framesWritten % numFrames) * sizeof(SharedVoiceFrame), &frame, sizeof(frame));
+    header->framesWritten.store(++framesWritten, std::memory_order_release);
+}
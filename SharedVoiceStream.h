@@ -0,0 +1,86 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// One block's voice state, as a visualizer reads it out of the shared ring. The layout is
+// fixed: readers in other languages map it field by field, little-endian.
+struct SharedVoiceFrame
+{
+    juce::int64 sample = 0; // Sample clock at the end of the block
+    float sampleRate = 0.0f;
+    juce::uint32 activeMask = 0; // Bit (slot) for the voice on member channel slot + 1
+    juce::uint32 releasingMask = 0;
+    juce::uint32 reserved = 0;
+    std::array<float, 16> pitch{};    // Sounding pitch as a fractional MIDI note number
+    std::array<float, 16> bend{};     // Bend in semitones, tuning offset included
+    std::array<float, 16> progress{}; // How far along its rise, 0 to 1
+    std::array<juce::uint8, 16> note{};
+    std::array<juce::uint8, 16> inputChannel{};
+};
+
+static_assert(sizeof(SharedVoiceFrame) == 248, "the frame layout is read by other processes");
+
+// Optional stream of per-voice state to a visualizer on the same machine, through a memory
+// mapped file instead of a socket: one frame per block, at the full block rate. The audio
+// thread copies the frame into the ring and publishes it with a single atomic store, with
+// no system call and no lock; the file is created, sized and touched on the message thread,
+// so writing it never faults a page in.
+//
+// The file is BetterChordStacks-<id>.voices in /dev/shm where there is one, otherwise the
+// temporary folder, and is deleted with the instance. It starts with a header:
+//
+//   offset 0   uint32 magic 'BCSV', uint32 version 1, uint32 frame size, uint32 frame count
+//   offset 16  uint32 streaming, 1 while frames are being written
+//   offset 64  uint64 frames written, atomic, on a cache line of its own
+//   offset 128 the frames, frame n in slot n % frame count
+//
+// A reader loads the count (acquire), copies a frame below it, then loads the count again:
+// the copy is whole if the frame is still more recent than count - frame count. The writer
+// never waits for readers, so one that falls behind skips ahead.
+class SharedVoiceStream
+{
+public:
+    SharedVoiceStream() = default;
+    ~SharedVoiceStream();
+
+    // Message thread. The file is made on the first start and kept until the instance goes,
+    // so a block still writing when it stops never writes into unmapped memory.
+    bool start();
+    void stop();
+    bool isStreaming() const { return streaming.load(std::memory_order_acquire); }
+
+    juce::File getFile() const { return file; }
+
+    // Audio thread
+    void write(const SharedVoiceFrame &frame);
+
+    static constexpr juce::uint32 magic = 0x56534342; // "BCSV" little-endian
+    static constexpr juce::uint32 version = 1;
+    static constexpr juce::uint32 numFrames = 1024;
+
+private:
+    struct Header
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        juce::uint32 frameSize;
+        juce::uint32 numFrames;
+        std::atomic<juce::uint32> streaming;
+        alignas(64) std::atomic<juce::uint64> framesWritten;
+    };
+
+    static constexpr size_t framesOffset = 128;
+    static constexpr size_t fileSize = framesOffset + numFrames * sizeof(SharedVoiceFrame);
+
+    bool createMapping();
+
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    Header *header = nullptr;
+    juce::uint8 *frames = nullptr;
+    juce::uint64 framesWritten = 0; // The audio thread's own count
+
+    std::atomic<bool> streaming{false};
+
+    JUCE_DECLARE_NON_COPYABLE(SharedVoiceStream)
+};
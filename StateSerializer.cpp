@@ -0,0 +1,201 @@
+#include "StateSerializer.h"
+
+StateSerializer::StateSerializer(juce::AudioProcessorValueTreeState &valueTreeState, HostNotifier &notifier)
+    : state(valueTreeState), hostNotifier(notifier)
+{
+    for (const auto &field : parameterFields)
+    {
+        jassert(field.tag < maxTag);
+        parametersByTag[field.tag] = state.getParameter(field.parameterID);
+        jassert(parametersByTag[field.tag] != nullptr);
+    }
+}
+
+juce::uint16 StateSerializer::findTag(const juce::String &parameterID)
+{
+    for (const auto &field : parameterFields)
+        if (parameterID == field.parameterID)
+            return field.tag;
+
+    return 0;
+}
+
+const char *StateSerializer::findParameterID(juce::uint16 tag)
+{
+    for (const auto &field : parameterFields)
+        if (field.tag == tag)
+            return field.parameterID;
+
+    return nullptr;
+}
+
+void StateSerializer::write(juce::MemoryBlock &destData) const
+{
+    writeFields(destData);
+
+    if (destData.getSize() > compressionThreshold)
+        compress(destData);
+}
+
+void StateSerializer::compress(juce::MemoryBlock &data)
+{
+    juce::MemoryBlock compressed;
+
+    {
+        juce::MemoryOutputStream stream(compressed, false);
+        stream.writeInt(static_cast<int>(compressedMagic));
+        stream.writeInt(static_cast<int>(data.getSize()));
+
+        juce::GZIPCompressorOutputStream zlib(stream, 1);
+        zlib.write(data.getData(), data.getSize());
+    }
+
+    // Data that doesn't shrink is kept as it is
+    if (compressed.getSize() < data.getSize())
+        data.swapWith(compressed);
+}
+
+void StateSerializer::writeFields(juce::MemoryBlock &destData) const
+{
+    auto expression = state.state[curveExpressionProperty].toString();
+    auto expressionSize = static_cast<int>(expression.getNumBytesAsUTF8());
+    constexpr auto numParameterFields = static_cast<int>(std::size(parameterFields));
+    auto hasEditorScale = state.state.hasProperty(editorScaleProperty);
+    const auto *midiLearn = state.state[midiLearnProperty].getBinaryData();
+    auto midiLearnSize = midiLearn != nullptr ? static_cast<int>(midiLearn->getSize()) : 0;
+    auto numFields = numParameterFields + (expressionSize > 0 ? 1 : 0) + (hasEditorScale ? 1 : 0) + (midiLearnSize > 0 ? 1 : 0);
+
+    destData.setSize(static_cast<size_t>(headerSize + numParameterFields * (fieldHeaderSize + 4) + expressionSize));
+    juce::MemoryOutputStream stream(destData, false);
+
+    stream.writeInt(static_cast<int>(magic));
+    stream.writeShort(static_cast<short>(currentVersion));
+    stream.writeShort(static_cast<short>(numFields));
+
+    for (const auto &field : parameterFields)
+    {
+        auto *parameter = parametersByTag[field.tag];
+
+        stream.writeShort(static_cast<short>(field.tag));
+        stream.writeShort(4);
+        stream.writeFloat(parameter->convertFrom0to1(parameter->getValue()));
+    }
+
+    if (expressionSize > 0)
+    {
+        stream.writeShort(static_cast<short>(curveExpressionTag));
+        stream.writeShort(static_cast<short>(expressionSize));
+        stream.write(expression.toRawUTF8(), static_cast<size_t>(expressionSize));
+    }
+
+    if (hasEditorScale)
+    {
+        stream.writeShort(static_cast<short>(editorScaleTag));
+        stream.writeShort(4);
+        stream.writeFloat(static_cast<float>(state.state[editorScaleProperty]));
+    }
+
+    if (midiLearnSize > 0)
+    {
+        stream.writeShort(static_cast<short>(midiLearnTag));
+        stream.writeShort(static_cast<short>(midiLearnSize));
+        stream.write(midiLearn->getData(), static_cast<size_t>(midiLearnSize));
+    }
+}
+
+bool StateSerializer::isVersionedState(const void *data, int sizeInBytes)
+{
+    if (sizeInBytes < headerSize)
+        return false;
+
+    auto tag = juce::ByteOrder::littleEndianInt(data);
+    return tag == magic || tag == compressedMagic;
+}
+
+bool StateSerializer::read(const void *data, int sizeInBytes) const
+{
+    if (!isVersionedState(data, sizeInBytes))
+        return false;
+
+    if (juce::ByteOrder::littleEndianInt(data) != compressedMagic)
+        return readFields(data, sizeInBytes);
+
+    auto *bytes = static_cast<const juce::uint8 *>(data);
+    auto uncompressedSize = static_cast<int>(juce::ByteOrder::littleEndianInt(bytes + 4));
+
+    if (uncompressedSize < headerSize || uncompressedSize > maxUncompressedSize)
+        return true;
+
+    juce::MemoryInputStream source(bytes + compressedHeaderSize, static_cast<size_t>(sizeInBytes - compressedHeaderSize), false);
+    juce::GZIPDecompressorInputStream zlib(source);
+    juce::MemoryBlock uncompressed;
+
+    // Damaged data restores as far as it goes, like truncated uncompressed state
+    auto numRead = zlib.readIntoMemoryBlock(uncompressed, uncompressedSize);
+
+    if (numRead >= static_cast<size_t>(headerSize) && juce::ByteOrder::littleEndianInt(uncompressed.getData()) == magic)
+        readFields(uncompressed.getData(), static_cast<int>(numRead));
+
+    return true;
+}
+
+bool StateSerializer::readFields(const void *data, int sizeInBytes) const
+{
+    auto *bytes = static_cast<const juce::uint8 *>(data);
+    auto *end = bytes + sizeInBytes;
+    auto numFields = juce::ByteOrder::littleEndianShort(bytes + 6);
+
+    bytes += headerSize;
+
+    // State without an expression goes back to the bendCurve shapes, and without mappings
+    // forgets the ones there were
+    juce::String expression;
+    juce::MemoryBlock midiLearn;
+
+    for (int i = 0; i < numFields && end - bytes >= fieldHeaderSize; ++i)
+    {
+        auto tag = juce::ByteOrder::littleEndianShort(bytes);
+        auto size = juce::ByteOrder::littleEndianShort(bytes + 2);
+        bytes += fieldHeaderSize;
+
+        // Truncated data: keep what was read so far
+        if (end - bytes < size)
+            break;
+
+        auto *parameter = tag < maxTag ? parametersByTag[tag] : nullptr;
+
+        if (parameter != nullptr && size == 4)
+        {
+            auto bits = juce::ByteOrder::littleEndianInt(bytes);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+
+            // Unchanged values are skipped so large templates don't flood the host with
+            // parameter change notifications
+            auto normalised = parameter->convertTo0to1(value);
+            if (normalised != parameter->getValue())
+                hostNotifier.setParameter(*parameter, normalised);
+        }
+        else if (tag == curveExpressionTag)
+        {
+            expression = juce::String::fromUTF8(reinterpret_cast<const char *>(bytes), size);
+        }
+        else if (tag == editorScaleTag && size == 4)
+        {
+            auto bits = juce::ByteOrder::littleEndianInt(bytes);
+            float scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+            state.state.setProperty(editorScaleProperty, scale, nullptr);
+        }
+        else if (tag == midiLearnTag)
+        {
+            midiLearn.replaceAll(bytes, size);
+        }
+
+        bytes += size;
+    }
+
+    state.state.setProperty(curveExpressionProperty, expression, nullptr);
+    state.state.setProperty(midiLearnProperty, std::move(midiLearn), nullptr);
+    return true;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "HostNotifier.h"
+
+// Versioned binary plugin state.
+//
+// Layout, little endian:
+//   uint32 magic, uint16 version, uint16 number of fields,
+//   then per field: uint16 tag, uint16 payload size, payload.
+//
+// Parameter fields carry the parameter's real value as a float32; the curve expression, when
+// there is one, is a field of its UTF-8 text, and MIDI learn mappings are a field of four
+// bytes each: uint8 input channel, uint8 controller, uint16 parameter tag. Readers skip tags
+// they don't know, so newer sessions still load in older builds. Restoring reads straight out
+// of the host's buffer without any intermediate copy or allocation.
+//
+// State larger than compressionThreshold is stored compressed instead, as
+//   uint32 compressedMagic, uint32 size of the state above, then the state as zlib data,
+// at the fastest level: templates with hundreds of instances load sooner for it. Smaller
+// state isn't worth the time and stays as it is.
+class StateSerializer
+{
+public:
+    static constexpr juce::uint32 magic = 0x50534342; // "BCSP"
+    static constexpr juce::uint32 compressedMagic = 0x5a534342; // "BCSZ"
+    static constexpr juce::uint16 currentVersion = 1;
+    static constexpr size_t compressionThreshold = 4096;
+
+    // Tags are permanent: never reuse or renumber one
+    struct ParameterField
+    {
+        juce::uint16 tag;
+        const char *parameterID;
+    };
+
+    static constexpr ParameterField parameterFields[] = {
+        {1, "bendAmount"},
+        {2, "bendTime"},
+        {3, "bendCurve"},
+        {4, "channelRotation"},
+        {5, "stealPolicy"},
+        {6, "updateMode"},
+        {7, "updateRate"},
+        {8, "updatesPerBend"},
+        {9, "budgetEnabled"},
+        {10, "messageBudget"},
+        {11, "outputMode"},
+        {12, "tempoSync"},
+        {13, "syncedBendTime"},
+        {14, "smoothAutomation"},
+        {15, "morphEnabled"},
+        {16, "morphController"},
+        {17, "morphFrom"},
+        {18, "morphTo"},
+        {19, "coalesceOutput"},
+        {20, "coalesceDeadband"},
+        {21, "openGLRendering"},
+        {22, "zoneSplit"},
+        {23, "splitNote"},
+        {24, "upperZoneChannels"},
+        {25, "upperBendAmount"},
+        {26, "upperBendTime"},
+        {27, "upperBendCurve"},
+        {28, "bendRange"},
+        {29, "amountUnits"},
+        {30, "bendSemitones"},
+        {31, "upperBendSemitones"},
+        {32, "stackMode"},
+        {33, "strumMode"},
+        {34, "strumSpread"},
+        {35, "legato"},
+        {36, "glideTime"},
+        {37, "releaseBend"},
+        {38, "releaseAmount"},
+        {39, "releaseTime"},
+        {40, "holdTime"},
+        {41, "returnTime"},
+        {42, "returnCurve"},
+        {43, "velocityToAmount"},
+        {44, "velocityToTime"},
+        {45, "velocityCurve"},
+        {46, "keyToAmount"},
+        {47, "keyToTime"},
+        {48, "keyCurve"},
+        {49, "humanizeAmount"},
+        {50, "humanizeTime"},
+        {51, "humanizeCurve"},
+        {52, "oscOutput"},
+        {53, "oscPort"},
+        {54, "oscRate"},
+        {55, "bendDeadband"},
+        {56, "fitDeadband"},
+        {57, "offlineQuality"},
+        {58, "stealRamp"},
+        {59, "serialOutput"},
+        {60, "scopeChannel"},
+        {61, "scopeLowNote"},
+        {62, "scopeHighNote"},
+        {63, "masterBend"},
+        {64, "vibratoDepth"},
+        {65, "vibratoRate"},
+        {66, "vibratoDelay"},
+        {67, "vibratoSpread"},
+        {68, "pressureLane"},
+        {69, "pressureFrom"},
+        {70, "pressureTo"},
+        {71, "timbreLane"},
+        {72, "timbreFrom"},
+        {73, "timbreTo"},
+        {74, "latchParameters"},
+        {75, "lookahead"},
+        {76, "releaseOnStop"},
+        {77, "bendTarget"},
+        {78, "scale"},
+        {79, "scaleRoot"},
+        {80, "chordMemory"},
+        {81, "transientRetrigger"},
+        {82, "transientThreshold"},
+        {83, "mpeInput"},
+        {84, "sharedPool"},
+        {85, "autoZoneSize"},
+        {86, "sharedMemoryOutput"},
+        {87, "pressureToAmount"},
+        {88, "pressureSmoothing"},
+        {89, "receiverSmoothing"},
+        {90, "adaptiveQuality"},
+        {91, "adaptiveThreshold"},
+        {92, "fixedPoint"},
+        {93, "voiceOverflow"},
+        {94, "notePriority"},
+        {95, "retriggerDebounce"},
+        {96, "ccHysteresis"},
+        {97, "ccMaxRate"},
+        {98, "previewSynth"},
+        {99, "updateCeiling"},
+        {100, "bendLayers"},
+        {101, "layer2Amount"},
+        {102, "layer2Time"},
+        {103, "layer2Curve"},
+        {104, "layer2Delay"},
+        {105, "layer3Amount"},
+        {106, "layer3Time"},
+        {107, "layer3Curve"},
+        {108, "layer3Delay"},
+        {109, "curveError"},
+        {110, "linkGroup"},
+    };
+
+    // Fields that aren't parameters, numbered clear of them
+    static constexpr juce::uint16 curveExpressionTag = 1000;
+    static constexpr juce::uint16 editorScaleTag = 1001;
+    static constexpr juce::uint16 midiLearnTag = 1002;
+
+    // Where the curve expression, the editor's size and the MIDI learn mappings (as binary
+    // data in the field's layout) are kept in the value tree between saves
+    static constexpr const char *curveExpressionProperty = "curveExpression";
+    static constexpr const char *editorScaleProperty = "editorScale";
+    static constexpr const char *midiLearnProperty = "midiLearn";
+
+    // The tag of a parameter, or 0 if it isn't saved
+    static juce::uint16 findTag(const juce::String &parameterID);
+    static const char *findParameterID(juce::uint16 tag);
+
+    // Restored values are set through notifier, which tells the host of them in one batch
+    StateSerializer(juce::AudioProcessorValueTreeState &state, HostNotifier &notifier);
+
+    void write(juce::MemoryBlock &destData) const;
+
+    // Returns false if the data isn't in this format, e.g. a session saved before it existed
+    bool read(const void *data, int sizeInBytes) const;
+
+    static bool isVersionedState(const void *data, int sizeInBytes);
+
+private:
+    static constexpr int headerSize = 8;
+    static constexpr int fieldHeaderSize = 4;
+    static constexpr int maxTag = 128;
+    static constexpr int compressedHeaderSize = 8;
+    static constexpr int maxUncompressedSize = 1 << 24;
+
+    void writeFields(juce::MemoryBlock &destData) const;
+    bool readFields(const void *data, int sizeInBytes) const;
+
+    static void compress(juce::MemoryBlock &data);
+
+    juce::AudioProcessorValueTreeState &state;
+    HostNotifier &hostNotifier;
+
+    // Parameters resolved once by tag so restoring needs no string lookups
+    std::array<juce::RangedAudioParameter *, maxTag> parametersByTag{};
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// What one processBlock call did, written by the audio thread for display
+struct TelemetryRecord
+{
+    float processSeconds = 0.0f;  // Wall-clock time spent in processBlock
+    float blockSeconds = 0.0f;    // Audio time covered by the block
+    juce::uint32 channelMask = 0; // Bit (channel - 1) is set while a voice holds that channel
+    juce::uint16 bendsSent = 0;
+    juce::uint16 coalescedBends = 0; // Held back by the bandwidth budget, value carried later
+    juce::uint16 droppedBends = 0;   // Held back until the voice ended
+    juce::uint16 steals = 0;
+    juce::uint8 activeVoices = 0;
+    juce::uint8 qualityLevel = 0; // Adaptive quality's level, 0 at full quality
+    juce::uint32 scratchBytes = 0; // Of the scratch arena, what the block's arrays filled
+};
+
+// Single-producer/single-consumer ring of telemetry records over a juce::AbstractFifo.
+// The audio thread pushes one record per block and never waits: if the reader falls behind
+// the ring fills up and further records are dropped.
+class TelemetryFifo
+{
+public:
+    static constexpr int capacity = 1024;
+
+    TelemetryFifo() = default;
+
+    // Producer side
+    void push(const TelemetryRecord &record)
+    {
+        const auto scope = fifo.write(1);
+
+        if (scope.blockSize1 > 0)
+            records[static_cast<size_t>(scope.startIndex1)] = record;
+    }
+
+    // Consumer side; copies out up to maxRecords, oldest first, and returns how many
+    int read(TelemetryRecord *destination, int maxRecords)
+    {
+        const auto scope = fifo.read(juce::jmin(maxRecords, fifo.getNumReady()));
+        scope.forEach([&](int index) { *destination++ = records[static_cast<size_t>(index)]; });
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    // Consumer side; drops whatever is waiting
+    void discard() { fifo.read(fifo.getNumReady()); }
+
+private:
+    juce::AbstractFifo fifo{capacity};
+    std::array<TelemetryRecord, capacity> records{};
+
+    JUCE_DECLARE_NON_COPYABLE(TelemetryFifo)
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "ChannelAllocator.h"
+
+// Events scheduled by absolute sample for later blocks, held in a fixed pool on a wheel of
+// three levels of 256 buckets: single samples, then 256 samples each, then 65536, with
+// anything further out on an overflow list. Scheduling and cancelling are constant time.
+// Draining visits only the buckets that hold something, found through a bit per bucket,
+// and moves a coarser bucket down a level when the wheel reaches it. Events come out in
+// time order; on the same sample lower ranks go first, then the order they were scheduled.
+template <typename Payload, int capacity>
+class TimingWheel
+{
+public:
+    using Handle = std::int32_t;
+    static constexpr Handle none = -1;
+
+    TimingWheel() { clear(); }
+
+    bool isEmpty() const { return numScheduled == 0; }
+
+    // Returns none if the pool is full. A sample already drained past is due at once.
+    Handle schedule(std::int64_t sample, int rank, const Payload &payload)
+    {
+        if (freeList == none)
+            return none;
+
+        auto handle = freeList;
+        auto &entry = entries[static_cast<size_t>(handle)];
+        freeList = entry.next;
+        entry.sample = sample;
+        entry.rank = static_cast<std::uint8_t>(rank);
+        entry.payload = payload;
+        ++numScheduled;
+
+        place(handle);
+        return handle;
+    }
+
+    // The handle must be one still scheduled
+    void cancel(Handle handle)
+    {
+        unlink(handle);
+        recycle(handle);
+    }
+
+    void clear()
+    {
+        heads.fill(none);
+        tails.fill(none);
+        occupied.fill(0);
+
+        for (int i = 0; i < capacity; ++i)
+            entries[static_cast<size_t>(i)].next = i + 1 < capacity ? i + 1 : none;
+
+        freeList = 0;
+        numScheduled = 0;
+    }
+
+    // Calls function(sample, payload) for each event before endSample. The function may
+    // schedule and cancel; an event it schedules on the sample being drained comes out too.
+    // endSample must not go back.
+    template <typename Function>
+    void drainUntil(std::int64_t endSample, Function &&function)
+    {
+        while (now < endSample)
+        {
+            // Nothing to keep in place, so the wheel can jump
+            if (numScheduled == 0)
+            {
+                now = endSample;
+                return;
+            }
+
+            auto limit = std::min((now | (levelSize - 1)) + 1, endSample);
+            auto bucket = nextOccupied(static_cast<int>(now & (levelSize - 1)), static_cast<int>((limit - 1) & (levelSize - 1)));
+
+            if (bucket >= 0)
+            {
+                now = (now & ~static_cast<std::int64_t>(levelSize - 1)) + bucket;
+
+                while (heads[static_cast<size_t>(bucket)] != none)
+                {
+                    auto handle = heads[static_cast<size_t>(bucket)];
+                    const auto &entry = entries[static_cast<size_t>(handle)];
+                    auto sample = entry.sample;
+                    auto payload = entry.payload;
+
+                    unlink(handle);
+                    recycle(handle);
+                    function(sample, payload);
+                }
+
+                ++now;
+            }
+            else
+            {
+                now = limit;
+            }
+
+            if ((now & (levelSize - 1)) == 0)
+                cascade();
+        }
+    }
+
+    // For an empty wheel taking up where another stopped; does nothing unless empty
+    void jumpTo(std::int64_t sample)
+    {
+        if (numScheduled == 0)
+            now = sample;
+    }
+
+    // For when the sample clock restarts; anything already due comes out at once. Handles
+    // stay valid.
+    void rebase(std::int64_t oldClock)
+    {
+        // Every list in index order is time order: a level only holds buckets past the
+        // current one
+        std::array<Handle, capacity> order;
+        int count = 0;
+
+        for (int list = 0; list < numLists; ++list)
+            for (auto handle = heads[static_cast<size_t>(list)]; handle != none; handle = entries[static_cast<size_t>(handle)].next)
+                order[static_cast<size_t>(count++)] = handle;
+
+        heads.fill(none);
+        tails.fill(none);
+        occupied.fill(0);
+        now = 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            auto &entry = entries[static_cast<size_t>(order[static_cast<size_t>(i)])];
+            entry.sample = std::max(static_cast<std::int64_t>(0), entry.sample - oldClock);
+            place(order[static_cast<size_t>(i)]);
+        }
+    }
+
+private:
+    static constexpr int levelBits = 8;
+    static constexpr int levelSize = 1 << levelBits;
+    static constexpr int overflowList = 3 * levelSize;
+    static constexpr int numLists = overflowList + 1;
+
+    struct Entry
+    {
+        std::int64_t sample = 0;
+        Handle next = none;
+        Handle prev = none;
+        std::int16_t list = 0;
+        std::uint8_t rank = 0;
+        Payload payload{};
+    };
+
+    std::array<Entry, static_cast<size_t>(capacity)> entries;
+    std::array<Handle, numLists> heads;
+    std::array<Handle, numLists> tails;
+    std::array<std::uint32_t, (numLists + 31) / 32> occupied;
+    Handle freeList = none;
+    int numScheduled = 0;
+    std::int64_t now = 0; // First sample not yet drained
+
+    void place(Handle handle)
+    {
+        auto key = std::max(entries[static_cast<size_t>(handle)].sample, now);
+        int list;
+
+        if ((key >> levelBits) == (now >> levelBits))
+            list = static_cast<int>(key & (levelSize - 1));
+        else if ((key >> (2 * levelBits)) == (now >> (2 * levelBits)))
+            list = levelSize + static_cast<int>((key >> levelBits) & (levelSize - 1));
+        else if ((key >> (3 * levelBits)) == (now >> (3 * levelBits)))
+            list = 2 * levelSize + static_cast<int>((key >> (2 * levelBits)) & (levelSize - 1));
+        else
+            list = overflowList;
+
+        link(handle, list);
+    }
+
+    void link(Handle handle, int list)
+    {
+        auto &entry = entries[static_cast<size_t>(handle)];
+        auto after = tails[static_cast<size_t>(list)];
+
+        // A single-sample bucket keeps its ranks in order; coarser ones keep the order events
+        // came in, which moving them down preserves
+        if (list < levelSize)
+            while (after != none && entries[static_cast<size_t>(after)].rank > entry.rank)
+                after = entries[static_cast<size_t>(after)].prev;
+
+        auto before = after == none ? heads[static_cast<size_t>(list)] : entries[static_cast<size_t>(after)].next;
+        entry.list = static_cast<std::int16_t>(list);
+        entry.prev = after;
+        entry.next = before;
+        (after == none ? heads[static_cast<size_t>(list)] : entries[static_cast<size_t>(after)].next) = handle;
+        (before == none ? tails[static_cast<size_t>(list)] : entries[static_cast<size_t>(before)].prev) = handle;
+        occupied[static_cast<size_t>(list >> 5)] |= 1u << (list & 31);
+    }
+
+    void unlink(Handle handle)
+    {
+        const auto &entry = entries[static_cast<size_t>(handle)];
+        auto list = static_cast<size_t>(entry.list);
+
+        (entry.prev == none ? heads[list] : entries[static_cast<size_t>(entry.prev)].next) = entry.next;
+        (entry.next == none ? tails[list] : entries[static_cast<size_t>(entry.next)].prev) = entry.prev;
+
+        if (heads[list] == none)
+            occupied[list >> 5] &= ~(1u << (list & 31));
+    }
+
+    void recycle(Handle handle)
+    {
+        entries[static_cast<size_t>(handle)].next = freeList;
+        freeList = handle;
+        --numScheduled;
+    }
+
+    // First occupied single-sample bucket from first to last, or -1
+    int nextOccupied(int first, int last) const
+    {
+        for (int word = first >> 5; word <= last >> 5; ++word)
+        {
+            auto bits = occupied[static_cast<size_t>(word)];
+
+            if (word == first >> 5)
+                bits &= ~0u << (first & 31);
+
+            if (word == last >> 5 && (last & 31) != 31)
+                bits &= (2u << (last & 31)) - 1;
+
+            if (bits != 0)
+                return word * 32 + lowestSetBit(bits);
+        }
+
+        return -1;
+    }
+
+    // Entering a new window of single samples: its events come down from the levels above
+    void cascade()
+    {
+        if ((now & ((static_cast<std::int64_t>(1) << (3 * levelBits)) - 1)) == 0)
+            redistribute(overflowList);
+
+        if ((now & ((static_cast<std::int64_t>(1) << (2 * levelBits)) - 1)) == 0)
+            redistribute(2 * levelSize + static_cast<int>((now >> (2 * levelBits)) & (levelSize - 1)));
+
+        redistribute(levelSize + static_cast<int>((now >> levelBits) & (levelSize - 1)));
+    }
+
+    void redistribute(int list)
+    {
+        auto handle = heads[static_cast<size_t>(list)];
+
+        heads[static_cast<size_t>(list)] = none;
+        tails[static_cast<size_t>(list)] = none;
+        occupied[static_cast<size_t>(list >> 5)] &= ~(1u << (list & 31));
+
+        while (handle != none)
+        {
+            auto next = entries[static_cast<size_t>(handle)].next;
+            place(handle);
+            handle = next;
+        }
+    }
+};
@@ -0,0 +1,205 @@
+#include "TraceRecorder.h"
+
+namespace
+{
+    void writeLittleEndian(juce::uint8 *destination, juce::uint32 value)
+    {
+        for (int i = 0; i < 4; ++i)
+            destination[i] = static_cast<juce::uint8>(value >> (8 * i));
+    }
+}
+
+class TraceRecorder::Writer : public juce::Thread
+{
+public:
+    explicit Writer(TraceRecorder &recorder) : juce::Thread("Trace writer"), owner(recorder) {}
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            owner.writePending();
+            wait(20);
+        }
+    }
+
+private:
+    TraceRecorder &owner;
+};
+
+TraceRecorder::TraceRecorder() = default;
+
+TraceRecorder::~TraceRecorder()
+{
+    stop();
+}
+
+bool TraceRecorder::start(const juce::File &traceFile)
+{
+    stop();
+
+    // Allocated on first use only, so instances that never capture don't carry the ring
+    if (ring.empty())
+        ring.resize(static_cast<size_t>(ringSize));
+
+    // Anything a block still in flight pushed after the last stop belongs to no trace
+    fifo.read(fifo.getNumReady());
+
+    traceFile.deleteFile();
+    auto newStream = std::make_unique<juce::FileOutputStream>(traceFile);
+
+    if (!newStream->openedOk())
+        return false;
+
+    newStream->writeInt(magic);
+    newStream->writeInt(version);
+
+    {
+        const juce::ScopedLock sl(streamLock);
+        stream = std::move(newStream);
+        numDropped = 0;
+        numDroppedWritten = 0;
+    }
+
+    writer = std::make_unique<Writer>(*this);
+    writer->startThread(juce::Thread::Priority::low);
+
+    capturing.store(true, std::memory_order_release);
+    return true;
+}
+
+void TraceRecorder::stop()
+{
+    capturing.store(false, std::memory_order_release);
+
+    if (writer == nullptr)
+        return;
+
+    writer->stopThread(1000);
+    writer.reset();
+
+    writePending();
+
+    const juce::ScopedLock sl(streamLock);
+    stream.reset();
+}
+
+void TraceRecorder::recordMidi(juce::int64 sample, const juce::uint8 *data, int size)
+{
+    if (!isCapturing())
+        return;
+
+    TraceEvent event;
+    event.sample = sample;
+
+    if (size <= static_cast<int>(event.data.size()))
+    {
+        event.kind = TraceEvent::midi1;
+        event.size = static_cast<juce::uint8>(size);
+        std::copy(data, data + size, event.data.begin());
+    }
+    else
+    {
+        juce::uint32 hash = 2166136261u;
+
+        for (int i = 0; i < size; ++i)
+            hash = (hash ^ data[i]) * 16777619u;
+
+        event.kind = TraceEvent::longMessage;
+        event.size = 8;
+        writeLittleEndian(event.data.data(), static_cast<juce::uint32>(size));
+        writeLittleEndian(event.data.data() + 4, hash);
+    }
+
+    push(event);
+}
+
+void TraceRecorder::recordPacket(juce::int64 sample, const juce::ump::PacketX2 &packet)
+{
+    if (!isCapturing())
+        return;
+
+    TraceEvent event;
+    event.sample = sample;
+    event.kind = TraceEvent::ump;
+    event.size = 8;
+    writeLittleEndian(event.data.data(), packet[0]);
+    writeLittleEndian(event.data.data() + 4, packet[1]);
+
+    push(event);
+}
+
+void TraceRecorder::push(const TraceEvent &event)
+{
+    const auto scope = fifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        ring[static_cast<size_t>(scope.startIndex1)] = event;
+    else
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TraceRecorder::waitUntilWritten()
+{
+    if (isCapturing())
+        writePending();
+}
+
+bool TraceRecorder::writePending()
+{
+    const juce::ScopedLock sl(streamLock);
+
+    if (stream == nullptr)
+        return false;
+
+    // Read before draining: every drop so far happened with these events already queued
+    auto dropped = numDropped.load(std::memory_order_relaxed);
+
+    auto writeEvent = [this](const TraceEvent &event)
+    {
+        stream->writeInt64(event.sample);
+        stream->writeByte(static_cast<char>(event.kind));
+        stream->writeByte(static_cast<char>(event.size));
+        stream->write(event.data.data(), event.size);
+    };
+
+    const auto scope = fifo.read(fifo.getNumReady());
+    scope.forEach([&](int index) { writeEvent(ring[static_cast<size_t>(index)]); });
+
+    if (dropped != numDroppedWritten)
+    {
+        TraceEvent gap;
+        gap.kind = TraceEvent::gap;
+        gap.sample = dropped - numDroppedWritten;
+        writeEvent(gap);
+        numDroppedWritten = dropped;
+    }
+
+    return stream->getStatus().wasOk();
+}
+
+bool TraceRecorder::readTrace(const juce::File &traceFile, std::vector<TraceEvent> &events)
+{
+    juce::FileInputStream input(traceFile);
+
+    if (!input.openedOk() || input.readInt() != magic || input.readInt() != version)
+        return false;
+
+    events.clear();
+
+    while (!input.isExhausted())
+    {
+        TraceEvent event;
+        event.sample = input.readInt64();
+        event.kind = static_cast<TraceEvent::Kind>(input.readByte());
+        event.size = static_cast<juce::uint8>(input.readByte());
+
+        if (event.kind > TraceEvent::gap || event.size > event.data.size()
+            || input.read(event.data.data(), event.size) != event.size)
+            return false;
+
+        events.push_back(event);
+    }
+
+    return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Ump.h"
+
+// One captured output event. MIDI 1.0 messages of up to eight bytes and UMP packets are
+// stored whole; longer messages (SysEx) are stored as their length and a hash, which is
+// enough to tell whether two traces match.
+struct TraceEvent
+{
+    enum Kind : juce::uint8
+    {
+        midi1,       // data holds the raw message
+        ump,         // data holds a 64-bit packet, first word first, each word little-endian
+        longMessage, // data holds the byte count and an FNV-1a hash, both 32-bit little-endian
+        gap          // Events were dropped here because the ring was full; sample is how many
+    };
+
+    juce::int64 sample = 0; // Absolute, counted from prepareToPlay
+    std::array<juce::uint8, 8> data{};
+    Kind kind = midi1;
+    juce::uint8 size = 0;
+
+    bool operator==(const TraceEvent &other) const
+    {
+        return sample == other.sample && kind == other.kind && size == other.size
+               && std::equal(data.begin(), data.begin() + size, other.data.begin());
+    }
+
+    bool operator!=(const TraceEvent &other) const { return !operator==(other); }
+};
+
+// Opt-in capture of everything the processor outputs, for proving a change left the output
+// bit-identical. The audio thread copies events into a preallocated ring and never waits;
+// a background thread writes them out to a trace file.
+//
+// Trace file: "BCST" magic and a version as 32-bit little-endian integers, then per event
+// its sample (64-bit), kind and size (8-bit each) and size bytes of data.
+class TraceRecorder
+{
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    // Message thread. Starting again while running switches to the new file.
+    bool start(const juce::File &traceFile);
+    void stop();
+    bool isCapturing() const { return capturing.load(std::memory_order_acquire); }
+
+    // Audio thread; both return straight away unless capturing
+    void recordMidi(juce::int64 sample, const juce::uint8 *data, int size);
+    void recordPacket(juce::int64 sample, const juce::ump::PacketX2 &packet);
+
+    // For offline rendering, which outruns the writer thread: blocks until the ring is empty
+    void waitUntilWritten();
+
+    int getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+    // Message thread
+    size_t getMemoryBytes() const { return ring.capacity() * sizeof(TraceEvent); }
+
+    // Reads a whole trace file; returns false if it isn't one
+    static bool readTrace(const juce::File &traceFile, std::vector<TraceEvent> &events);
+
+private:
+    class Writer;
+
+    static constexpr int ringSize = 1 << 16;
+    static constexpr int magic = 0x54534342; // "BCST"
+    static constexpr int version = 1;
+
+    void push(const TraceEvent &event);
+    bool writePending();
+
+    juce::AbstractFifo fifo{ringSize};
+    std::vector<TraceEvent> ring;
+
+    std::atomic<bool> capturing{false};
+    std::atomic<int> numDropped{0};
+    int numDroppedWritten = 0;
+
+    juce::CriticalSection streamLock; // Between the writer thread and start/stop, never the audio thread
+    std::unique_ptr<juce::FileOutputStream> stream;
+    std::unique_ptr<Writer> writer;
+
+    JUCE_DECLARE_NON_COPYABLE(TraceRecorder)
+};
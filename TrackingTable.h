@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include "CurveTable.h"
+
+// Scale factors for the bend amount and time over one note-on property (velocity or note
+// number), built when the tracking parameters change and read once per note-on. Time is
+// stored inverted, as the bend loop divides elapsed time by it.
+struct TrackingTable
+{
+    std::array<float, 128> amount;
+    std::array<float, 128> inverseTime;
+
+    TrackingTable()
+    {
+        amount.fill(1.0f);
+        inverseTime.fill(1.0f);
+    }
+
+    // position maps a value 0..127 to how far it is from the one that leaves the bend as
+    // set; depth is the change in amount or time at a position of 1, both shaped by curve
+    template <typename Position>
+    void build(float amountDepth, float timeDepth, float curve, Position position)
+    {
+        const CurveKernel kernel(curve);
+
+        for (int i = 0; i < 128; ++i)
+        {
+            auto x = position(i);
+            auto shaped = std::copysign(kernel(std::abs(x)), x);
+            auto s = static_cast<size_t>(i);
+
+            amount[s] = std::max(0.0f, 1.0f + amountDepth * shaped);
+            inverseTime[s] = 1.0f / std::max(0.05f, 1.0f + timeDepth * shaped);
+        }
+    }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Onsets in the audio input, for restarting bends on a drummer's hits. The input is taken
+// in runs of runLength samples whose peak, from FloatVectorOperations::findMinAndMax over
+// each channel, drives a fast envelope and a slow one; an onset is the fast envelope
+// jumping threshold above the slow one, and no other is reported for a hold-off time after.
+// One vectorised pass over the input and a few multiplies per run, with nothing allocated.
+class TransientDetector
+{
+public:
+    void prepare(double sampleRate)
+    {
+        auto runsPerSecond = sampleRate / runLength;
+        fastRelease = static_cast<float>(std::exp(-1.0 / (0.005 * runsPerSecond)));
+        slowFollow = static_cast<float>(std::exp(-1.0 / (0.2 * runsPerSecond)));
+        holdOffRuns = juce::roundToInt(0.05 * runsPerSecond);
+        fast = 0.0f;
+        slow = 0.0f;
+        runsSinceOnset = holdOffRuns;
+    }
+
+    void setThreshold(float decibels) { ratio = juce::Decibels::decibelsToGain(decibels); }
+
+    // Returns the position of the block's first onset, to within a run, or -1 if there is
+    // none. Whatever is left past the last whole run starts the next block's first run.
+    template <typename SampleType>
+    int process(const SampleType *const *channels, int numChannels, int numSamples)
+    {
+        int onset = -1;
+
+        for (int start = 0; start < numSamples && numChannels > 0;)
+        {
+            auto length = juce::jmin(runLength - runFill, numSamples - start);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto range = juce::FloatVectorOperations::findMinAndMax(channels[channel] + start, length);
+                runPeak = juce::jmax(runPeak, static_cast<float>(juce::jmax(-range.getStart(), range.getEnd())));
+            }
+
+            runFill += length;
+
+            if (runFill == runLength)
+            {
+                fast = juce::jmax(runPeak, fast * fastRelease);
+
+                if (++runsSinceOnset >= holdOffRuns && fast > noiseFloor && fast > slow * ratio)
+                {
+                    if (onset < 0)
+                        onset = start;
+
+                    runsSinceOnset = 0;
+                }
+
+                slow = runPeak + slowFollow * (slow - runPeak);
+                runFill = 0;
+                runPeak = 0.0f;
+            }
+
+            start += length;
+        }
+
+        return onset;
+    }
+
+private:
+    static constexpr int runLength = 32;
+    static constexpr float noiseFloor = 0.01f; // -40 dBFS
+
+    float fastRelease = 0.0f;
+    float slowFollow = 0.0f;
+    float ratio = 2.8f;
+    int holdOffRuns = 0;
+
+    float fast = 0.0f;
+    float slow = 0.0f;
+    float runPeak = 0.0f;
+    int runFill = 0;
+    int runsSinceOnset = 0;
+};
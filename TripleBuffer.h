@@ -0,0 +1,48 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CacheLine.h"
+
+// Single-writer/single-reader handoff of a value type without locks.
+// The writer fills getWriteBuffer() and calls publish(); the reader calls acquire() at
+// the start of its work and reads getReadBuffer() until the next acquire(). Neither side
+// ever touches the buffer the other one holds, so large tables can be swapped in whole.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    // Writer side
+    T &getWriteBuffer() { return buffers[static_cast<size_t>(backIndex)]; }
+
+    void publish()
+    {
+        backIndex = middle.exchange(backIndex | dirtyFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Reader side; returns true if a newer value was picked up
+    bool acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & dirtyFlag) == 0)
+            return false;
+
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T &getReadBuffer() const { return buffers[static_cast<size_t>(frontIndex)]; }
+
+private:
+    static constexpr int dirtyFlag = 4;
+    static constexpr int indexMask = 3;
+
+    // The reader's index, the writer's and the exchanged one each on their own cache line, so
+    // a publish only disturbs the reader through middle
+    std::array<T, 3> buffers{};
+    alignas(cacheLineSize) int frontIndex = 0;
+    alignas(cacheLineSize) int backIndex = 1;
+    alignas(cacheLineSize) std::atomic<int> middle{2};
+
+    JUCE_DECLARE_NON_COPYABLE(TripleBuffer)
+};
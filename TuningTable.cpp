@@ -0,0 +1,204 @@
+#include "TuningTable.h"
+
+namespace
+{
+    // Lines that aren't comments, first word only; Scala allows text after the value
+    juce::StringArray getValueLines(const juce::String &text)
+    {
+        juce::StringArray lines, values;
+        lines.addLines(text);
+
+        for (auto &line : lines)
+            if (!line.startsWithChar('!'))
+                values.add(line.trim().upToFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf("\t", false, false));
+
+        return values;
+    }
+
+    bool isInteger(const juce::String &value)
+    {
+        return value.isNotEmpty() && value.trimCharactersAtStart("-").containsOnly("0123456789");
+    }
+
+    // One scale line: cents if it has a decimal point, otherwise a ratio like 3/2 or 2
+    bool parsePitch(const juce::String &value, double &cents)
+    {
+        if (value.containsChar('.'))
+        {
+            if (!value.trimCharactersAtStart("-").containsOnly("0123456789."))
+                return false;
+
+            cents = value.getDoubleValue();
+            return true;
+        }
+
+        auto numerator = value.upToFirstOccurrenceOf("/", false, false);
+        auto denominator = value.containsChar('/') ? value.fromFirstOccurrenceOf("/", false, false) : juce::String("1");
+
+        if (!isInteger(numerator) || !isInteger(denominator) || numerator.getLargeIntValue() <= 0 || denominator.getLargeIntValue() <= 0)
+            return false;
+
+        cents = 1200.0 * std::log2(static_cast<double>(numerator.getLargeIntValue()) / static_cast<double>(denominator.getLargeIntValue()));
+        return true;
+    }
+
+    int floorDivide(int value, int divisor)
+    {
+        return value / divisor - (value % divisor < 0 ? 1 : 0);
+    }
+}
+
+bool TuningTable::parseScala(const juce::String &scale, const juce::String &mapping, TuningTable &table,
+                             juce::String &error)
+{
+    // Scale: a description, the number of pitches, then the pitches above 1/1; the last is the period
+    auto scaleValues = getValueLines(scale);
+    scaleValues.remove(0); // The description, which may be blank
+    scaleValues.removeEmptyStrings();
+
+    if (scaleValues.isEmpty() || !isInteger(scaleValues[0]) || scaleValues[0].getIntValue() <= 0)
+    {
+        error = "The scale has no pitch count";
+        return false;
+    }
+
+    auto numPitches = scaleValues[0].getIntValue();
+
+    if (scaleValues.size() < numPitches + 1)
+    {
+        error = "The scale has fewer pitches than it declares";
+        return false;
+    }
+
+    std::vector<double> pitches(static_cast<size_t>(numPitches));
+
+    for (int i = 0; i < numPitches; ++i)
+    {
+        if (!parsePitch(scaleValues[i + 1], pitches[static_cast<size_t>(i)]))
+        {
+            error = "Bad pitch in the scale: " + scaleValues[i + 1];
+            return false;
+        }
+    }
+
+    // Keyboard mapping: size, first and last note, middle note (scale degree 0), reference
+    // note and its frequency, the degree of the formal octave, then one degree or x per key
+    int mapSize = 0, firstNote = 0, lastNote = 127, middleNote = 60, referenceNote = 60, octaveDegree = numPitches;
+    double referenceFrequency = 440.0 * std::pow(2.0, (60 - 69) / 12.0);
+    std::vector<int> keyDegrees;
+
+    if (mapping.isNotEmpty())
+    {
+        auto values = getValueLines(mapping);
+        values.removeEmptyStrings();
+
+        if (values.size() < 7)
+        {
+            error = "The keyboard mapping is missing its header";
+            return false;
+        }
+
+        for (int i : {0, 1, 2, 3, 4, 6})
+        {
+            if (!isInteger(values[i]))
+            {
+                error = "Bad number in the keyboard mapping: " + values[i];
+                return false;
+            }
+        }
+
+        mapSize = values[0].getIntValue();
+        firstNote = juce::jlimit(0, 127, values[1].getIntValue());
+        lastNote = juce::jlimit(0, 127, values[2].getIntValue());
+        middleNote = values[3].getIntValue();
+        referenceNote = values[4].getIntValue();
+        referenceFrequency = values[5].getDoubleValue();
+        octaveDegree = values[6].getIntValue() > 0 ? values[6].getIntValue() : numPitches;
+
+        if (mapSize < 0 || referenceFrequency <= 0.0)
+        {
+            error = "Bad keyboard mapping header";
+            return false;
+        }
+
+        // Keys past the end of a short mapping are unmapped
+        for (int i = 0; i < mapSize; ++i)
+        {
+            auto value = values[7 + i];
+            keyDegrees.push_back(isInteger(value) ? value.getIntValue() : -1);
+        }
+    }
+
+    auto pitchOfDegree = [&](int degree)
+    {
+        auto period = floorDivide(degree, numPitches);
+        auto step = degree - period * numPitches;
+
+        return period * pitches.back() + (step == 0 ? 0.0 : pitches[static_cast<size_t>(step - 1)]);
+    };
+
+    // Cents above the middle note, or false for a key the mapping leaves out
+    auto pitchOfNote = [&](int note, double &cents)
+    {
+        auto key = note - middleNote;
+
+        if (mapSize == 0)
+        {
+            cents = pitchOfDegree(key);
+            return true;
+        }
+
+        auto repeat = floorDivide(key, mapSize);
+        auto degree = keyDegrees[static_cast<size_t>(key - repeat * mapSize)];
+
+        if (degree < 0)
+            return false;
+
+        cents = repeat * pitchOfDegree(octaveDegree) + pitchOfDegree(degree);
+        return true;
+    };
+
+    double referenceCents = 0.0;
+
+    if (!pitchOfNote(referenceNote, referenceCents))
+    {
+        error = "The keyboard mapping leaves out its reference note";
+        return false;
+    }
+
+    // Absolute pitch in cents above 12-TET note 0, for comparing against 100 * note
+    auto origin = 6900.0 + 1200.0 * std::log2(referenceFrequency / 440.0) - referenceCents;
+
+    for (int note = 0; note < 128; ++note)
+    {
+        double cents = 0.0;
+        auto &offset = table.offsetCents[static_cast<size_t>(note)];
+
+        if (note >= firstNote && note <= lastNote && pitchOfNote(note, cents))
+            offset = static_cast<float>(origin + cents - 100.0 * note);
+        else
+            offset = 0.0f;
+    }
+
+    return true;
+}
+
+bool TuningTable::loadScala(const juce::File &scaleFile, const juce::File &mappingFile, TuningTable &table,
+                            juce::String &error)
+{
+    if (!scaleFile.existsAsFile())
+    {
+        error = "Can't find " + scaleFile.getFullPathName();
+        return false;
+    }
+
+    if (mappingFile != juce::File() && !mappingFile.existsAsFile())
+    {
+        error = "Can't find " + mappingFile.getFullPathName();
+        return false;
+    }
+
+    auto mapping = mappingFile != juce::File() ? mappingFile.loadFileAsString() : juce::String();
+
+    return parseScala(scaleFile.loadFileAsString(), mapping, table, error);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Static tuning: each MIDI note's offset from 12-tone equal temperament (A4 = 440 Hz) in
+// cents. All zero is standard tuning.
+struct TuningTable
+{
+    std::array<float, 128> offsetCents{};
+
+    // Builds the table from the text of a Scala scale (.scl) and, optionally, a keyboard
+    // mapping (.kbm). Without a mapping the scale starts on middle C at its 12-TET pitch.
+    // Keys the mapping leaves out keep their 12-TET pitch. Returns false and sets error if
+    // either file is malformed.
+    static bool parseScala(const juce::String &scale, const juce::String &mapping, TuningTable &table,
+                           juce::String &error);
+
+    static bool loadScala(const juce::File &scaleFile, const juce::File &mappingFile, TuningTable &table,
+                          juce::String &error);
+};
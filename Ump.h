@@ -0,0 +1,8 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// JUCE's UMP headers aren't part of the module header and have no include guards, so they
+// are pulled in once here. MidiDataConcatenator has to come first.
+#include <juce_audio_basics/midi/juce_MidiDataConcatenator.h>
+#include <juce_audio_basics/midi/ump/juce_UMP.h>
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Per-voice vibrato layered on the bend: a sine of depth 14-bit steps that fades in over one
+// cycle once delaySamples have passed since the note started. Each voice's phase is worked
+// out from its elapsed time plus its own offset, so it doesn't drift with the update grid
+// and renders the same at any block size. The loop over voices has no branches, so
+// compilers vectorise it.
+struct Vibrato
+{
+    float depth = 0.0f; // Peak deviation in 14-bit steps; none at 0
+    float cyclesPerSample = 0.0f;
+    float delaySamples = 0.0f;
+    float inverseFadeSamples = 1.0f;
+
+    bool isActive() const { return depth != 0.0f; }
+
+    void set(float depthSteps, float rateHz, float delaySeconds, double sampleRate)
+    {
+        depth = depthSteps;
+        cyclesPerSample = static_cast<float>(rateHz / sampleRate);
+        delaySamples = static_cast<float>(delaySeconds * sampleRate);
+        inverseFadeSamples = cyclesPerSample;
+    }
+
+    // sin(2 pi phase), phase in cycles: a parabola through the half cycle with one refining
+    // step, within 0.1% of the peak
+    static float sine(float phase)
+    {
+        auto x = 2.0f * (phase - std::floor(phase)) - 1.0f;
+        auto y = 4.0f * x - 4.0f * x * std::abs(x);
+        y += 0.225f * (y * std::abs(y) - y);
+        return -y;
+    }
+
+    float at(float elapsed, float phaseOffset) const
+    {
+        auto fade = std::clamp((elapsed - delaySamples) * inverseFadeSamples, 0.0f, 1.0f);
+        return depth * fade * sine(elapsed * cyclesPerSample + phaseOffset);
+    }
+
+    // Adds each voice's vibrato at its elapsed time in samples
+    void apply(const float *elapsed, const float *phaseOffsets, float *values, int numValues) const
+    {
+        for (int i = 0; i < numValues; ++i)
+            values[i] += at(elapsed[i], phaseOffsets[i]);
+    }
+
+    // Steepest rise, in steps per sample
+    float maxSlope() const { return depth * 6.2831853f * cyclesPerSample; }
+};
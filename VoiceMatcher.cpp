@@ -0,0 +1,87 @@
+#include "VoiceMatcher.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+
+int VoiceMatcher::match(const int *newNotes, int numNew, const int *oldNotes, int numOld, int *assignment)
+{
+    assert(numNew <= maxNotes && numOld <= maxNotes);
+
+    for (int i = 0; i < numNew; ++i)
+        assignment[i] = -1;
+
+    if (numNew == 0 || numOld == 0)
+        return 0;
+
+    auto sortByPitch = [](const int *notes, int numNotes, std::array<int, maxNotes> &order)
+    {
+        std::iota(order.begin(), order.begin() + numNotes, 0);
+        std::sort(order.begin(), order.begin() + numNotes, [notes](int a, int b)
+        {
+            return notes[a] != notes[b] ? notes[a] < notes[b] : a < b;
+        });
+    };
+
+    std::array<int, maxNotes> newOrder, oldOrder;
+    sortByPitch(newNotes, numNew, newOrder);
+    sortByPitch(oldNotes, numOld, oldOrder);
+
+    // Every note of the smaller side is paired with one of the larger side
+    bool newIsSmaller = numNew <= numOld;
+    const auto *smallNotes = newIsSmaller ? newNotes : oldNotes;
+    const auto *largeNotes = newIsSmaller ? oldNotes : newNotes;
+    const auto &smallOrder = newIsSmaller ? newOrder : oldOrder;
+    const auto &largeOrder = newIsSmaller ? oldOrder : newOrder;
+    auto numPairs = std::min(numNew, numOld);
+    auto slack = std::max(numNew, numOld) - numPairs;
+
+    auto pitchOf = [](const int *notes, const std::array<int, maxNotes> &order, int rank)
+    {
+        return notes[order[static_cast<size_t>(rank)]];
+    };
+
+    // cost[i][d]: cheapest pairing of the lowest i of the smaller side within the lowest
+    // i + d of the larger side
+    std::array<std::array<int, maxNotes + 1>, maxNotes + 1> cost;
+    cost[0].fill(0);
+
+    for (int i = 1; i <= numPairs; ++i)
+    {
+        for (int d = 0; d <= slack; ++d)
+        {
+            auto j = i + d;
+            auto pair = cost[static_cast<size_t>(i - 1)][static_cast<size_t>(d)]
+                        + std::abs(pitchOf(smallNotes, smallOrder, i - 1) - pitchOf(largeNotes, largeOrder, j - 1));
+            auto skip = d > 0 ? cost[static_cast<size_t>(i)][static_cast<size_t>(d - 1)] : std::numeric_limits<int>::max();
+
+            cost[static_cast<size_t>(i)][static_cast<size_t>(d)] = std::min(pair, skip);
+        }
+    }
+
+    // Walk back from the full pairing, leaving out the larger side's notes that were skipped
+    for (int i = numPairs, d = slack; i > 0;)
+    {
+        if (d > 0 && cost[static_cast<size_t>(i)][static_cast<size_t>(d)] == cost[static_cast<size_t>(i)][static_cast<size_t>(d - 1)])
+        {
+            --d;
+            continue;
+        }
+
+        auto smallIndex = smallOrder[static_cast<size_t>(i - 1)];
+        auto largeIndex = largeOrder[static_cast<size_t>(i + d - 1)];
+
+        if (newIsSmaller)
+            assignment[smallIndex] = largeIndex;
+        else
+            assignment[largeIndex] = smallIndex;
+
+        --i;
+    }
+
+    return numPairs;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Pairs the notes of a new chord with held voices so the total pitch movement is as small
+// as possible. On a line the cheapest pairing never crosses, so both sides are sorted by
+// pitch (n log n) and matched in order; when the sides differ in size, a dynamic program
+// over the order-preserving pairings picks which notes sit out. For chords of equal size
+// that is a single straight pass.
+class VoiceMatcher
+{
+public:
+    static constexpr int maxNotes = 16;
+
+    // For each new note, writes the index of the old note it takes over to assignment, or
+    // -1 if it should start a voice of its own. Returns the number of pairs.
+    static int match(const int *newNotes, int numNew, const int *oldNotes, int numOld, int *assignment);
+};
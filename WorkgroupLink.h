@@ -0,0 +1,60 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// The audio device's workgroup, passed on to the worker threads the audio thread waits on,
+// so the OS schedules them with its callback, on Apple Silicon on the performance cores,
+// rather than as ordinary threads it may put on the efficiency cores. The host sets it
+// whenever its device changes, through AudioProcessor::audioWorkgroupContextChanged; each
+// worker rejoins on its next pass. Threads nothing real time waits on, the log, trace and
+// capture writers and the OSC sender, stay out of it at low priority.
+class WorkgroupLink
+{
+public:
+    // A worker thread's membership, kept by the thread
+    struct Membership
+    {
+        juce::WorkgroupToken token;
+        juce::uint32 generation = 0;
+    };
+
+    // Any thread but a worker's; an empty workgroup takes the workers out
+    void set(const juce::AudioWorkgroup &newWorkgroup)
+    {
+        {
+            const juce::SpinLock::ScopedLockType sl(lock);
+            workgroup = newWorkgroup;
+        }
+
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    // Worker thread, once per pass: joins the workgroup last set if it has changed since,
+    // leaving the one before. A load and a compare while it hasn't.
+    void join(Membership &membership) const
+    {
+        auto current = generation.load(std::memory_order_acquire);
+
+        if (current == membership.generation)
+            return;
+
+        juce::AudioWorkgroup latest;
+
+        {
+            const juce::SpinLock::ScopedLockType sl(lock);
+            latest = workgroup;
+        }
+
+        membership.token.reset();
+
+        if (latest)
+            latest.join(membership.token);
+
+        membership.generation = current;
+    }
+
+private:
+    mutable juce::SpinLock lock;
+    juce::AudioWorkgroup workgroup;
+    std::atomic<juce::uint32> generation{0};
+};
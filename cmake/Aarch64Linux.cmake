@@ -0,0 +1,14 @@
+# cmake/Aarch64Linux.cmake
+#
+# Cross compiles for 64-bit ARM Linux (Raspberry Pi 3 and later, Bela Gem) with the GNU
+# toolchain. Point CMAKE_SYSROOT at the board's root file system for its ALSA headers.
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+set(CMAKE_C_COMPILER aarch64-linux-gnu-gcc)
+set(CMAKE_CXX_COMPILER aarch64-linux-gnu-g++)
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_PACKAGE ONLY)
@@ -1,7 +1,9 @@
 # cmake/GenerateGitVersion.cmake
 execute_process(
     COMMAND git rev-parse --short HEAD
+    WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
     OUTPUT_VARIABLE GIT_HASH
+    ERROR_QUIET
     OUTPUT_STRIP_TRAILING_WHITESPACE
 )
 
@@ -0,0 +1,32 @@
+# cmake/ProfileGuidedOptimization.cmake
+#
+# BCS_PGO=GENERATE builds instrumented targets that write raw profiles to BCS_PGO_DIR;
+# BCS_PGO=USE rebuilds them from BCS_PGO_DIR/default.profdata, merged from those with
+# llvm-profdata. Clang profiles are keyed by function, so a profile recorded with the
+# benchmark also fits the plugin targets built from the same sources.
+# scripts/pgo_build.sh runs the whole flow.
+set(BCS_PGO "OFF" CACHE STRING "Profile-guided optimisation: OFF, GENERATE or USE")
+set_property(CACHE BCS_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(BCS_PGO_DIR "${CMAKE_SOURCE_DIR}/build-pgo-profile" CACHE PATH "Where PGO profiles are written and read")
+
+if(NOT BCS_PGO STREQUAL "OFF" AND NOT CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    message(WARNING "BCS_PGO needs Clang or AppleClang; building without profile-guided optimisation")
+    set(BCS_PGO "OFF")
+endif()
+
+function(bcs_enable_pgo target)
+    if(BCS_PGO STREQUAL "GENERATE")
+        target_compile_options(${target} PRIVATE "-fprofile-instr-generate=${BCS_PGO_DIR}/%p.profraw")
+        target_link_options(${target} PUBLIC "-fprofile-instr-generate")
+    elseif(BCS_PGO STREQUAL "USE")
+        if(NOT EXISTS "${BCS_PGO_DIR}/default.profdata")
+            message(FATAL_ERROR "BCS_PGO=USE but ${BCS_PGO_DIR}/default.profdata doesn't exist")
+        endif()
+
+        # Code the benchmark never ran has no profile; that is expected, not a warning
+        target_compile_options(${target} PRIVATE
+            "-fprofile-instr-use=${BCS_PGO_DIR}/default.profdata"
+            -Wno-profile-instr-unprofiled
+            -Wno-profile-instr-out-of-date)
+    endif()
+endfunction()
@@ -0,0 +1,233 @@
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "ChannelAllocator.h"
+#include "CurveTableCache.h"
+#include "VoiceMatcher.h"
+
+// Python module over BetterChordStacksCore, for generating datasets without the plugin or
+// a process per file. Built with -DBCS_PYTHON=ON:
+//
+//   import numpy as np, bcs_core
+//
+//   allocator = bcs_core.Allocator(first_channel=2, num_channels=14)
+//   ends = allocator.assign(messages)       # uint32 array, rewritten in place
+//   bcs_core.shape_curve(0.5, progress)     # float32 array, rewritten in place
+//   pairs = bcs_core.match_voices(new_notes, old_notes)
+//
+// MIDI events are packed one per uint32 as status | data1 << 8 | data2 << 16, the bytes in
+// the order they go out. Arrays are taken as they are, never copied, so they must already
+// have the right dtype and be C-contiguous and writeable. The work runs with the GIL
+// released, so a Python thread pool keeps as many cores busy as it has threads; an
+// Allocator belongs to one thread at a time.
+
+namespace py = pybind11;
+
+namespace
+{
+    using PackedEvents = py::array_t<std::uint32_t, py::array::c_style>;
+    using Floats = py::array_t<float, py::array::c_style>;
+    using Ints = py::array_t<std::int32_t, py::array::c_style>;
+
+    void requireWriteable(const py::array &array, const char *name)
+    {
+        if (!array.writeable())
+            throw py::value_error(std::string(name) + " must be writeable");
+    }
+
+    // Member channels for the notes of a packed MIDI stream, through a ChannelAllocator that
+    // keeps its state from one call to the next, so a performance can come in pieces
+    class Allocator
+    {
+    public:
+        Allocator(int firstChannel, int numChannels, const std::string &rotation, const std::string &stealPolicy)
+        {
+            if (firstChannel < 1 || numChannels < 1 || firstChannel + numChannels - 1 > 16)
+                throw py::value_error("the zone must lie within channels 1 to 16");
+
+            allocator.setZone(firstChannel, numChannels);
+            allocator.setRotation(parseRotation(rotation));
+            allocator.setStealPolicy(parseStealPolicy(stealPolicy));
+            reset();
+        }
+
+        void reset()
+        {
+            allocator.reset();
+
+            for (auto &channel : channelForKey)
+                channel.fill(0);
+
+            keyOnChannel.fill(noKey);
+        }
+
+        // Moves each note-on and its note-off to the note's member channel, in place. Note-offs
+        // of voices already ended, and note-ons that got no channel, become 0. Returns the
+        // voices the caller must end, as rows of (event index, member channel, note): each
+        // with a note-off just before that event, for a voice stolen or a key struck again.
+        py::array_t<std::int32_t> assign(PackedEvents messages)
+        {
+            requireWriteable(messages, "messages");
+
+            auto *events = messages.mutable_data();
+            auto numEvents = messages.size();
+            std::vector<std::array<std::int32_t, 3>> ends;
+
+            {
+                py::gil_scoped_release release;
+
+                for (py::ssize_t i = 0; i < numEvents; ++i)
+                    assignEvent(events[i], static_cast<std::int32_t>(i), ends);
+            }
+
+            py::array_t<std::int32_t> result({static_cast<py::ssize_t>(ends.size()), static_cast<py::ssize_t>(3)});
+
+            if (!ends.empty())
+                std::memcpy(result.mutable_data(), ends.data(), ends.size() * sizeof(ends[0]));
+
+            return result;
+        }
+
+    private:
+        static constexpr std::uint16_t noKey = 0xffff;
+
+        ChannelAllocator allocator;
+        std::array<std::array<std::uint8_t, 128>, 16> channelForKey{}; // Per input channel and key, 0 for none
+        std::array<std::uint16_t, 16> keyOnChannel{};                   // Input channel << 7 | key, per member channel
+
+        static ChannelAllocator::Rotation parseRotation(const std::string &name)
+        {
+            if (name == "least_recently_used")
+                return ChannelAllocator::Rotation::leastRecentlyUsed;
+            if (name == "lowest_free")
+                return ChannelAllocator::Rotation::lowestFree;
+
+            throw py::value_error("rotation must be 'least_recently_used' or 'lowest_free'");
+        }
+
+        static ChannelAllocator::StealPolicy parseStealPolicy(const std::string &name)
+        {
+            if (name == "oldest")
+                return ChannelAllocator::StealPolicy::oldest;
+            if (name == "quietest")
+                return ChannelAllocator::StealPolicy::quietest;
+            if (name == "same_note")
+                return ChannelAllocator::StealPolicy::sameNote;
+
+            throw py::value_error("steal_policy must be 'oldest', 'quietest' or 'same_note'");
+        }
+
+        void endVoice(int channel, std::int32_t index, std::vector<std::array<std::int32_t, 3>> &ends)
+        {
+            auto key = keyOnChannel[static_cast<size_t>(channel - 1)];
+            ends.push_back({index, channel, key & 0x7f});
+            channelForKey[static_cast<size_t>(key >> 7)][static_cast<size_t>(key & 0x7f)] = 0;
+            keyOnChannel[static_cast<size_t>(channel - 1)] = noKey;
+        }
+
+        void assignEvent(std::uint32_t &event, std::int32_t index, std::vector<std::array<std::int32_t, 3>> &ends)
+        {
+            auto status = static_cast<int>(event & 0xf0);
+            auto inputChannel = static_cast<size_t>(event & 0x0f);
+            auto note = static_cast<int>((event >> 8) & 0x7f);
+            auto velocity = static_cast<int>((event >> 16) & 0x7f);
+
+            if (status != 0x90 && status != 0x80)
+                return;
+
+            auto &held = channelForKey[inputChannel][static_cast<size_t>(note)];
+
+            if (status == 0x80 || velocity == 0)
+            {
+                if (held == 0)
+                {
+                    event = 0;
+                    return;
+                }
+
+                auto channel = static_cast<int>(held);
+                keyOnChannel[static_cast<size_t>(channel - 1)] = noKey;
+                held = 0;
+                allocator.release(channel);
+                event = (event & ~0x0fu) | static_cast<std::uint32_t>(channel - 1);
+                return;
+            }
+
+            // Struck again while still sounding: the old voice ends first
+            if (held != 0)
+            {
+                auto channel = static_cast<int>(held);
+                endVoice(channel, index, ends);
+                allocator.release(channel);
+            }
+
+            bool wasStolen = false;
+            auto channel = allocator.allocate(note, velocity, wasStolen);
+
+            if (channel == 0)
+            {
+                event = 0;
+                return;
+            }
+
+            if (wasStolen)
+                endVoice(channel, index, ends);
+
+            held = static_cast<std::uint8_t>(channel);
+            keyOnChannel[static_cast<size_t>(channel - 1)] = static_cast<std::uint16_t>(inputChannel << 7 | static_cast<size_t>(note));
+            event = (event & ~0x0fu) | static_cast<std::uint32_t>(channel - 1);
+        }
+    };
+
+    // Replaces each progress value, clamped to 0..1, with the bend shape for curve, from the
+    // same shared table the plugin evaluates
+    void shapeCurve(float curve, Floats progress)
+    {
+        requireWriteable(progress, "progress");
+
+        auto table = CurveTableCache::get(curve);
+        auto *values = progress.mutable_data();
+        auto numValues = progress.size();
+
+        py::gil_scoped_release release;
+
+        for (py::ssize_t i = 0; i < numValues; ++i)
+            values[i] = table->evaluate(std::clamp(values[i], 0.0f, 1.0f));
+    }
+
+    // For each new note, the index of the old note whose voice glides to it, or -1
+    Ints matchVoices(const Ints &newNotes, const Ints &oldNotes)
+    {
+        if (newNotes.size() > VoiceMatcher::maxNotes || oldNotes.size() > VoiceMatcher::maxNotes)
+            throw py::value_error("at most 16 notes a side");
+
+        Ints assignment(newNotes.size());
+        VoiceMatcher::match(newNotes.data(), static_cast<int>(newNotes.size()), oldNotes.data(),
+                            static_cast<int>(oldNotes.size()), assignment.mutable_data());
+        return assignment;
+    }
+}
+
+PYBIND11_MODULE(bcs_core, module)
+{
+    module.doc() = "Better Chord Stacks voice allocation and bend curves, without the plugin";
+
+    py::class_<Allocator>(module, "Allocator")
+        .def(py::init<int, int, const std::string &, const std::string &>(),
+             py::arg("first_channel") = 2, py::arg("num_channels") = 14,
+             py::arg("rotation") = "least_recently_used", py::arg("steal_policy") = "oldest")
+        .def("assign", &Allocator::assign, py::arg("messages").noconvert(),
+             "Moves note events to member channels in place; returns the voices to end as rows of (index, channel, note)")
+        .def("reset", &Allocator::reset, "Frees every channel");
+
+    module.def("shape_curve", &shapeCurve, py::arg("curve"), py::arg("progress").noconvert(),
+               "Shapes float32 progress values in place along the bend curve");
+    module.def("match_voices", &matchVoices, py::arg("new_notes"), py::arg("old_notes"),
+               "Pairs new notes with old ones for the least total movement");
+}
@@ -0,0 +1,81 @@
+#!/bin/bash
+
+# Block-size regression check. Renders the same MIDI at block sizes 1, 7, 64, 512 and 4096
+# and compares each render's output trace, event by event, against the one at 512, or with
+# GOLDEN_DIR set against the trace of the same name there. Bends are scheduled on absolute
+# sample times, so a host's buffer size must not change a render; any difference fails the
+# check. The bandwidth budget (and so a fitted deadband) charges some messages once per
+# 64-sample piece, so with it on only block sizes that are multiples of 64 match; give
+# BLOCK_SIZES="64 512 4096" to check those. BLOCK_SIZES must include 512.
+#
+# CTest runs it over tests/block_size against the traces in tests/block_size/golden. After a
+# change meant to change renders, write those again with
+# "Better Chord Stacks Render" --trace --output tests/block_size/golden tests/block_size
+# and delete the .mid files it leaves beside them.
+
+# Sample usage, from the repository root, after building BetterChordStacksRender and
+# BetterChordStacksTraceDiff into build/
+# ./scripts/block_size_check.sh path/to/midi-folder
+# BUILD_DIR=build-release ./scripts/block_size_check.sh song.mid --set bendCurve=-1
+# GOLDEN_DIR=tests/block_size/golden ./scripts/block_size_check.sh tests/block_size
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <file.mid | folder> [renderer options...]"
+    exit 1
+fi
+
+INPUT="$1"
+shift
+
+BUILD_DIR=${BUILD_DIR:-build}
+BLOCK_SIZES=${BLOCK_SIZES:-"1 7 64 512 4096"}
+REFERENCE_BLOCK_SIZE=512
+OUTPUT_DIR=$(mktemp -d)
+trap 'rm -rf "$OUTPUT_DIR"' EXIT
+
+RENDER=${RENDER:-$(find "$BUILD_DIR"/BetterChordStacksRender_artefacts -type f -name "Better Chord Stacks Render" | head -n 1)}
+TRACE_DIFF=${TRACE_DIFF:-$(find "$BUILD_DIR"/BetterChordStacksTraceDiff_artefacts -type f -name "Better Chord Stacks Trace Diff" | head -n 1)}
+
+if [ -z "$RENDER" ] || [ -z "$TRACE_DIFF" ]; then
+    echo "Error: couldn't find the renderer and trace diff in $BUILD_DIR."
+    exit 1
+fi
+
+for BLOCK_SIZE in $BLOCK_SIZES; do
+    echo "=== Rendering at block size $BLOCK_SIZE ==="
+    "$RENDER" --trace --block-size "$BLOCK_SIZE" --output "$OUTPUT_DIR/$BLOCK_SIZE" "$@" "$INPUT" > /dev/null
+done
+
+FAILED=0
+
+if [ -n "$GOLDEN_DIR" ]; then
+    REFERENCE_DIR="$GOLDEN_DIR"
+    REFERENCE_NAME="the trace in $GOLDEN_DIR"
+else
+    REFERENCE_DIR="$OUTPUT_DIR/$REFERENCE_BLOCK_SIZE"
+    REFERENCE_NAME="the render at block size $REFERENCE_BLOCK_SIZE"
+fi
+
+# With GOLDEN_DIR every block size is compared, 512 included, and a trace missing there fails
+for ACTUAL in "$OUTPUT_DIR/$REFERENCE_BLOCK_SIZE"/*.trace; do
+    NAME=$(basename "$ACTUAL")
+
+    for BLOCK_SIZE in $BLOCK_SIZES; do
+        if [ -z "$GOLDEN_DIR" ] && [ "$BLOCK_SIZE" = "$REFERENCE_BLOCK_SIZE" ]; then
+            continue
+        fi
+
+        if ! "$TRACE_DIFF" "$REFERENCE_DIR/$NAME" "$OUTPUT_DIR/$BLOCK_SIZE/$NAME"; then
+            echo "FAILED: $NAME at block size $BLOCK_SIZE differs from $REFERENCE_NAME"
+            FAILED=1
+        fi
+    done
+done
+
+if [ $FAILED -ne 0 ]; then
+    exit 1
+fi
+
+echo "Done. Every render matches $REFERENCE_NAME."
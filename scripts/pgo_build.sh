@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# Profile-guided Release build of the plugins, left in build/ for the Makefile's pkg target.
+# Builds the instrumented benchmark, runs its sweep as the training workload, merges the
+# raw profiles and rebuilds everything with them. Needs Clang (AppleClang on macOS).
+
+# Sample usage, from the repository root
+# ./scripts/pgo_build.sh
+# make pkg BUILD_TYPE=Release
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+PROFILE_DIR="build-pgo-profile"
+SECONDS_PER_CONFIG=${SECONDS_PER_CONFIG:-2}
+
+if command -v xcrun > /dev/null; then
+    PROFDATA="xcrun llvm-profdata"
+else
+    PROFDATA="llvm-profdata"
+fi
+
+rm -rf "$PROFILE_DIR"
+mkdir -p "$PROFILE_DIR"
+
+echo "=== Building the instrumented benchmark ==="
+cmake --preset pgo-generate
+cmake --build --preset pgo-generate
+
+BENCHMARK=$(find build-pgo-generate/BetterChordStacksBenchmark_artefacts -type f -name "Better Chord Stacks Benchmark" | head -n 1)
+
+if [ -z "$BENCHMARK" ]; then
+    echo "Error: couldn't find the benchmark in build-pgo-generate."
+    exit 1
+fi
+
+echo "=== Recording profiles ==="
+LLVM_PROFILE_FILE="$PROFILE_DIR/%p.profraw" "$BENCHMARK" --seconds=$SECONDS_PER_CONFIG > /dev/null
+$PROFDATA merge -output="$PROFILE_DIR/default.profdata" "$PROFILE_DIR"/*.profraw
+
+echo "=== Building with the merged profile ==="
+cmake --preset pgo-use
+cmake --build --preset pgo-use
+
+echo "Done. Package the tuned build with: make pkg BUILD_TYPE=Release"
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+
+# Writes the block-size check's MIDI corpus. Each file starts its notes off the 64-sample grid
+# at 48 kHz and overlaps them, so bends begin and end inside the renderer's blocks at every
+# size. Standard library only; run it again and re-render the golden traces after changing it.
+
+# Sample usage, from the repository root
+# python3 tests/block_size/make_corpus.py tests/block_size
+
+import os
+import struct
+import sys
+
+TICKS_PER_QUARTER = 960
+TEMPO = 500000  # 120 bpm, so one tick is 25 samples at 48 kHz
+
+
+def variable_length(value):
+    data = [value & 0x7f]
+    value >>= 7
+
+    while value:
+        data.insert(0, 0x80 | (value & 0x7f))
+        value >>= 7
+
+    return bytes(data)
+
+
+def write_file(path, events):
+    # events: (tick, status, data...) on channel 1, in any order
+    track = bytearray()
+    track += variable_length(0) + bytes([0xff, 0x51, 0x03]) + TEMPO.to_bytes(3, "big")
+    last_tick = 0
+
+    # Note offs before note ons at the same tick
+    for tick, *message in sorted(events, key=lambda e: (e[0], e[1] & 0xf0 != 0x80)):
+        track += variable_length(tick - last_tick) + bytes(message)
+        last_tick = tick
+
+    track += variable_length(0) + bytes([0xff, 0x2f, 0x00])
+
+    with open(path, "wb") as f:
+        f.write(b"MThd" + struct.pack(">IHHH", 6, 0, 1, TICKS_PER_QUARTER))
+        f.write(b"MTrk" + struct.pack(">I", len(track)) + track)
+
+
+def note(events, tick, length, key, velocity):
+    events.append((tick, 0x90, key, velocity))
+    events.append((tick + length, 0x80, key, 0))
+
+
+# Stacked triads and sevenths whose notes land a few ticks apart, held across each other
+def chords():
+    events = []
+    roots = [48, 53, 55, 50, 45, 52, 47, 48]
+
+    for i, root in enumerate(roots):
+        start = 37 + i * 1931
+        intervals = [0, 4, 7, 11] if i % 2 else [0, 3, 7]
+
+        for j, interval in enumerate(intervals):
+            note(events, start + j * 3, 2203 - j * 7, root + interval, 64 + 13 * j)
+
+    return events
+
+
+# A legato line over a held bass, each note starting before the last one ends
+def legato():
+    events = []
+    note(events, 11, 15013, 36, 90)
+    line = [60, 62, 64, 67, 65, 64, 62, 59, 60, 64, 67, 72, 71, 67, 64, 60]
+
+    for i, key in enumerate(line):
+        note(events, 101 + i * 917, 977, key, 70 + (i * 5) % 50)
+
+    return events
+
+
+# Dense repeated chords with pitch wheel, pressure and mod wheel moving throughout
+def controllers():
+    events = []
+
+    for i in range(24):
+        start = 5 + i * 403
+        root = 55 + (i * 5) % 12
+
+        for j, interval in enumerate([0, 7, 12]):
+            note(events, start + j, 389, root + interval, 50 + (i * 7 + j * 11) % 70)
+
+    for i in range(240):
+        tick = 17 + i * 41
+        bend = 8192 + int(3000 * ((i % 40) - 20) / 20)
+        events.append((tick, 0xe0, bend & 0x7f, bend >> 7))
+        events.append((tick + 13, 0xd0, (i * 3) % 128))
+        events.append((tick + 29, 0xb0, 1, (i * 5) % 128))
+
+    return events
+
+
+def main():
+    folder = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+
+    for name, events in [("chords", chords()), ("legato", legato()), ("controllers", controllers())]:
+        write_file(os.path.join(folder, name + ".mid"), events)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1055 @@
+#include <JuceHeader.h>
+#include "GitVersion.h"
+#include "PluginProcessor.h"
+
+#if JUCE_LINUX
+ #include <dlfcn.h>
+#endif
+
+// processBlock benchmark: drives the processor with synthetic chord stacks and prints one
+// JSON object per line for each configuration, for regression tracking.
+//
+//   BetterChordStacksBenchmark [--full] [--seconds=<s>] [--output=<file>] [--baseline=<file>] [--threshold=<%>]
+//   BetterChordStacksBenchmark --compare=<file> --baseline=<file> [--threshold=<%>]
+//   BetterChordStacksBenchmark --stress [--seconds=<s>] [--seed=<n>]
+//
+// By default each axis (block size, sample rate, voices, note density, update rate) is
+// swept on its own around a typical session; --full runs every combination. Times are
+// wall-clock nanoseconds per processBlock call. Allocations are counted on the calling
+// thread while processBlock runs and should always be zero.
+//
+// Instance startup and state restore are then timed over 500 instances, as for a host
+// scan and a large template, fastPow against std::pow, with its worst error in bend steps,
+// the vibrato's sine against std::sin, and each runtime-dispatched kernel at every
+// instruction set level the CPU supports.
+// Then 100 instances are processed on every core at once while another thread automates
+// their parameters, as in a host that runs plugins on parallel threads. Last, 1, 10, 100
+// and 500 instances are hosted in AudioProcessorGraphs fed the same MIDI, rendered on one
+// thread and split across every core, for the time of a whole host callback and the
+// memory each instance costs.
+//
+// --output also writes every result to one JSON document, in the schema below, tagged with
+// the commit the build is from, for keeping as a baseline. --baseline compares this run, or
+// with --compare a document written before, against one: a figure more than --threshold
+// percent worse (default 10) than the same configuration's in the baseline is printed as a
+// regression, and the exit code is 1 if there are any.
+//
+//   {"schema": 1, "gitHash": "...", "date": "...", "cpu": "...", "cores": n,
+//    "results": [{"benchmark": "processBlock", ...}, ...]}
+//
+// Each result is one of the objects printed, its configuration followed by its figures.
+// Fields are only ever added to a benchmark, and one whose meaning changes gets a new name,
+// so documents from any release compare.
+//
+// --stress instead fuzzes the processor with random MIDI, parameter and state changes,
+// resets and re-prepares, and exits with an error on the first processBlock call that
+// allocates or, on Linux, locks a mutex.
+
+namespace
+{
+    // Per thread, so the processor's timer and the message thread are not counted
+    thread_local bool countingAllocations = false;
+    thread_local juce::int64 allocationCount = 0;
+    thread_local juce::int64 lockCount = 0;
+
+    // Bytes held by every thread, for the memory cost of an instance. Each block carries
+    // its size in a header, kept at the alignment malloc guarantees.
+    std::atomic<juce::int64> liveBytes{0};
+    constexpr size_t sizeHeader = alignof(std::max_align_t);
+
+    void *allocate(size_t size)
+    {
+        if (countingAllocations)
+            ++allocationCount;
+
+        if (auto *p = static_cast<char *>(std::malloc(size + sizeHeader)))
+        {
+            *reinterpret_cast<size_t *>(p) = size;
+            liveBytes.fetch_add(static_cast<juce::int64>(size), std::memory_order_relaxed);
+            return p + sizeHeader;
+        }
+
+        throw std::bad_alloc();
+    }
+
+    void deallocate(void *p) noexcept
+    {
+        if (p == nullptr)
+            return;
+
+        auto *block = static_cast<char *>(p) - sizeHeader;
+        liveBytes.fetch_sub(static_cast<juce::int64>(*reinterpret_cast<size_t *>(block)), std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { deallocate(p); }
+void operator delete[](void *p) noexcept { deallocate(p); }
+void operator delete(void *p, size_t) noexcept { deallocate(p); }
+void operator delete[](void *p, size_t) noexcept { deallocate(p); }
+
+#if JUCE_LINUX
+// Counts mutex locks taken while processBlock runs; CriticalSection and std::mutex both
+// end up here
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    using LockFunction = int (*)(pthread_mutex_t *);
+    static auto realLock = reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+
+    if (countingAllocations)
+        ++lockCount;
+
+    return realLock(mutex);
+}
+#endif
+
+namespace
+{
+    struct Config
+    {
+        int blockSize = 512;
+        double sampleRate = 48000.0;
+        int voices = 6;
+        double notesPerSecond = 8.0;
+        float updateRateMs = 1.45f;
+    };
+
+    struct Result
+    {
+        int numBlocks = 0;
+        double meanNs = 0.0;
+        double p50Ns = 0.0;
+        double p99Ns = 0.0;
+        double maxNs = 0.0;
+        double allocationsPerBlock = 0.0;
+        double messagesPerSecond = 0.0; // Output, per second of audio
+        double bytesPerInstance = 0.0;  // Once prepared
+    };
+
+    // Chords of config.voices notes, struck so that notes start at notesPerSecond on
+    // average; each chord is released just before the next one
+    class ChordStackSource
+    {
+    public:
+        explicit ChordStackSource(const Config &config)
+            : voices(config.voices),
+              chordInterval(juce::jmax(1, juce::roundToInt(config.sampleRate * config.voices / config.notesPerSecond)))
+        {
+        }
+
+        void fillBlock(juce::MidiBuffer &midi, juce::int64 blockStart, int blockSize)
+        {
+            midi.clear();
+
+            while (nextChord < blockStart + blockSize)
+            {
+                auto position = static_cast<int>(juce::jmax(static_cast<juce::int64>(0), nextChord - blockStart));
+
+                for (int i = 0; i < voices; ++i)
+                    if (rootNote >= 0)
+                        midi.addEvent(juce::MidiMessage::noteOff(1, rootNote + i * 4), position);
+
+                rootNote = 36 + random.nextInt(juce::jmax(1, 92 - voices * 4));
+
+                for (int i = 0; i < voices; ++i)
+                    midi.addEvent(juce::MidiMessage::noteOn(1, rootNote + i * 4, static_cast<juce::uint8>(40 + random.nextInt(80))), position);
+
+                nextChord += chordInterval;
+            }
+        }
+
+    private:
+        int voices;
+        int chordInterval;
+        juce::int64 nextChord = 0;
+        int rootNote = -1;
+        juce::Random random{1234};
+    };
+
+    Result run(const Config &config, double seconds)
+    {
+        auto bytesBefore = liveBytes.load();
+        auto processorOwner = std::make_unique<PitchBendProcessor>();
+        auto &processor = *processorOwner;
+        processor.updateRate->setValueNotifyingHost(processor.updateRate->convertTo0to1(config.updateRateMs));
+        processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+        processor.prepareToPlay(config.sampleRate, config.blockSize);
+        auto bytesPerInstance = static_cast<double>(liveBytes.load() - bytesBefore);
+
+        juce::AudioBuffer<float> buffer(2, config.blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(65536);
+        ChordStackSource source(config);
+
+        auto numBlocks = juce::jmax(100, static_cast<int>(seconds * config.sampleRate / config.blockSize));
+        auto warmupBlocks = numBlocks / 10;
+        std::vector<double> times;
+        times.reserve(static_cast<size_t>(numBlocks));
+        juce::int64 allocations = 0;
+        juce::int64 messages = 0;
+        juce::int64 blockStart = 0;
+
+        for (int block = 0; block < warmupBlocks + numBlocks; ++block)
+        {
+            source.fillBlock(midi, blockStart, config.blockSize);
+            blockStart += config.blockSize;
+
+            allocationCount = 0;
+            countingAllocations = true;
+            auto start = std::chrono::steady_clock::now();
+
+            processor.processBlock(buffer, midi);
+
+            auto end = std::chrono::steady_clock::now();
+            countingAllocations = false;
+
+            if (block >= warmupBlocks)
+            {
+                times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+                allocations += allocationCount;
+                messages += midi.getNumEvents();
+            }
+        }
+
+        processor.releaseResources();
+
+        Result result;
+        result.numBlocks = numBlocks;
+        result.meanNs = std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size());
+        result.allocationsPerBlock = static_cast<double>(allocations) / numBlocks;
+        result.messagesPerSecond = static_cast<double>(messages) * config.sampleRate / (static_cast<double>(numBlocks) * config.blockSize);
+        result.bytesPerInstance = bytesPerInstance;
+
+        std::sort(times.begin(), times.end());
+        auto percentile = [&](double p) { return times[static_cast<size_t>(p * static_cast<double>(times.size() - 1))]; };
+        result.p50Ns = percentile(0.5);
+        result.p99Ns = percentile(0.99);
+        result.maxNs = times.back();
+
+        return result;
+    }
+
+    // Everything printed, for --output and --baseline
+    juce::Array<juce::var> collectedResults;
+
+    void print(const juce::var &object)
+    {
+        std::cout << juce::JSON::toString(object, true) << std::endl;
+        collectedResults.add(object);
+    }
+
+    void runAndPrint(const Config &config, double seconds)
+    {
+        auto result = run(config, seconds);
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("benchmark", "processBlock");
+        object->setProperty("blockSize", config.blockSize);
+        object->setProperty("sampleRate", config.sampleRate);
+        object->setProperty("voices", config.voices);
+        object->setProperty("notesPerSecond", config.notesPerSecond);
+        object->setProperty("updateRateMs", config.updateRateMs);
+        object->setProperty("blocks", result.numBlocks);
+        object->setProperty("nsPerBlock", juce::roundToInt(result.meanNs));
+        object->setProperty("p50", juce::roundToInt(result.p50Ns));
+        object->setProperty("p99", juce::roundToInt(result.p99Ns));
+        object->setProperty("max", juce::roundToInt(result.maxNs));
+        object->setProperty("allocationsPerBlock", result.allocationsPerBlock);
+        object->setProperty("messagesPerSecond", result.messagesPerSecond);
+        object->setProperty("bytesPerInstance", juce::roundToInt(result.bytesPerInstance));
+        print(juce::var(object));
+    }
+
+    // Instance startup: a host scan constructs and destroys each plugin in turn, while a
+    // large template constructs and prepares many instances that then stay alive
+    void runStartup(int numInstances)
+    {
+        auto nanosecondsSince = [](std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < numInstances; ++i)
+            PitchBendProcessor processor;
+
+        auto scanNs = nanosecondsSince(start);
+
+        std::vector<std::unique_ptr<PitchBendProcessor>> processors;
+        processors.reserve(static_cast<size_t>(numInstances));
+        start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < numInstances; ++i)
+            processors.push_back(std::make_unique<PitchBendProcessor>());
+
+        auto constructNs = nanosecondsSince(start);
+        start = std::chrono::steady_clock::now();
+
+        for (auto &processor : processors)
+        {
+            processor->setRateAndBufferSizeDetails(48000.0, 512);
+            processor->prepareToPlay(48000.0, 512);
+        }
+
+        auto prepareNs = nanosecondsSince(start);
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("benchmark", "startup");
+        object->setProperty("instances", numInstances);
+        object->setProperty("nsPerScan", juce::roundToInt(scanNs / numInstances));
+        object->setProperty("nsPerConstruct", juce::roundToInt(constructNs / numInstances));
+        object->setProperty("nsPerPrepare", juce::roundToInt(prepareNs / numInstances));
+        print(juce::var(object));
+    }
+
+    // Saving and restoring state on many instances at once, as when a large template is
+    // saved or loads. A save repeated without changes is answered from the cached state.
+    void runStateRestore(int numInstances)
+    {
+        std::vector<std::unique_ptr<PitchBendProcessor>> processors;
+        for (int i = 0; i < numInstances; ++i)
+            processors.push_back(std::make_unique<PitchBendProcessor>());
+
+        *processors.front()->bendAmount = 0.75f;
+        *processors.front()->bendCurve = -1.0f;
+
+        juce::MemoryBlock state;
+        double saveNs[2] = {};
+
+        for (auto &ns : saveNs)
+        {
+            auto saveStart = std::chrono::steady_clock::now();
+
+            for (auto &processor : processors)
+                processor->getStateInformation(state);
+
+            ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - saveStart).count();
+        }
+
+        processors.front()->getStateInformation(state);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto &processor : processors)
+            processor->setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("benchmark", "stateRestore");
+        object->setProperty("instances", numInstances);
+        object->setProperty("stateBytes", static_cast<int>(state.getSize()));
+        object->setProperty("nsTotal", static_cast<juce::int64>(elapsed));
+        object->setProperty("nsPerInstance", juce::roundToInt(elapsed / numInstances));
+        object->setProperty("nsPerSave", juce::roundToInt(saveNs[0] / numInstances));
+        object->setProperty("nsPerCachedSave", juce::roundToInt(saveNs[1] / numInstances));
+        print(juce::var(object));
+    }
+
+    // Many instances processed on parallel threads, each thread taking every numThreads-th
+    // one, while this thread keeps moving a parameter on all of them as host automation
+    // would. Slowdown against the same run without automation is the cost of the audio
+    // threads' state being disturbed by the writes.
+    void runParallelInstances(int numInstances, double seconds)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 128;
+        const Config config{blockSize, sampleRate, 6, 8.0, 1.45f};
+
+        auto numThreads = juce::jmax(1, static_cast<int>(std::thread::hardware_concurrency()));
+        auto numBlocks = juce::jmax(100, static_cast<int>(seconds * sampleRate / blockSize / numInstances * numThreads));
+
+        std::vector<std::unique_ptr<PitchBendProcessor>> processors;
+        std::vector<std::unique_ptr<ChordStackSource>> sources;
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            processors.push_back(std::make_unique<PitchBendProcessor>());
+            processors.back()->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processors.back()->prepareToPlay(sampleRate, blockSize);
+            sources.push_back(std::make_unique<ChordStackSource>(config));
+        }
+
+        auto runThreads = [&](bool automate)
+        {
+            std::atomic<int> running{numThreads};
+            std::vector<std::thread> threads;
+            auto start = std::chrono::steady_clock::now();
+
+            for (int t = 0; t < numThreads; ++t)
+            {
+                threads.emplace_back([&, t]
+                {
+                    juce::AudioBuffer<float> buffer(2, blockSize);
+                    juce::MidiBuffer midi;
+                    midi.ensureSize(65536);
+
+                    for (int block = 0; block < numBlocks; ++block)
+                    {
+                        for (int i = t; i < numInstances; i += numThreads)
+                        {
+                            sources[static_cast<size_t>(i)]->fillBlock(midi, static_cast<juce::int64>(block) * blockSize, blockSize);
+                            processors[static_cast<size_t>(i)]->processBlock(buffer, midi);
+                        }
+                    }
+
+                    --running;
+                });
+            }
+
+            juce::Random random(99);
+
+            while (automate && running.load() > 0)
+                for (auto &processor : processors)
+                    processor->bendAmount->setValueNotifyingHost(random.nextFloat());
+
+            for (auto &thread : threads)
+                thread.join();
+
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        auto quietNs = runThreads(false);
+        auto automatedNs = runThreads(true);
+        auto blocksPerThread = static_cast<double>(numBlocks) * numInstances / numThreads;
+
+        for (auto &processor : processors)
+            processor->releaseResources();
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("benchmark", "parallelInstances");
+        object->setProperty("instances", numInstances);
+        object->setProperty("threads", numThreads);
+        object->setProperty("blockSize", blockSize);
+        object->setProperty("nsPerBlock", juce::roundToInt(quietNs / blocksPerThread));
+        object->setProperty("nsPerBlockAutomated", juce::roundToInt(automatedNs / blocksPerThread));
+        print(juce::var(object));
+    }
+
+    // Instances hosted as a host hosts them: nodes of an AudioProcessorGraph, each fed the
+    // graph's MIDI input and feeding its MIDI output. With more than one thread the
+    // instances are split into one graph per thread, as a host renders parallel tracks, and
+    // every callback waits for all of them. Times are wall-clock nanoseconds per callback;
+    // bytes per instance is everything allocated building and preparing the graphs.
+    void runGraphScaling(int numInstances, int numThreads, double seconds)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 256;
+        const Config config{blockSize, sampleRate, 6, 8.0, 1.45f};
+
+        numThreads = juce::jlimit(1, numInstances, numThreads);
+        auto bytesBefore = liveBytes.load();
+
+        std::vector<std::unique_ptr<juce::AudioProcessorGraph>> graphs;
+
+        for (int t = 0; t < numThreads; ++t)
+        {
+            auto graph = std::make_unique<juce::AudioProcessorGraph>();
+            using IO = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+            constexpr auto none = juce::AudioProcessorGraph::UpdateKind::none;
+            constexpr auto midi = juce::AudioProcessorGraph::midiChannelIndex;
+
+            auto input = graph->addNode(std::make_unique<IO>(IO::midiInputNode), std::nullopt, none);
+            auto output = graph->addNode(std::make_unique<IO>(IO::midiOutputNode), std::nullopt, none);
+
+            for (int i = t; i < numInstances; i += numThreads)
+            {
+                auto node = graph->addNode(std::make_unique<PitchBendProcessor>(), std::nullopt, none);
+                graph->addConnection({{input->nodeID, midi}, {node->nodeID, midi}}, none);
+                graph->addConnection({{node->nodeID, midi}, {output->nodeID, midi}}, none);
+            }
+
+            graph->rebuild();
+            graph->setPlayConfigDetails(0, 0, sampleRate, blockSize);
+            graph->prepareToPlay(sampleRate, blockSize);
+            graphs.push_back(std::move(graph));
+        }
+
+        auto bytesPerInstance = static_cast<double>(liveBytes.load() - bytesBefore) / numInstances;
+
+        auto numBlocks = juce::jmax(50, static_cast<int>(seconds * sampleRate / blockSize / juce::jmax(1, numInstances / 10)));
+        std::vector<double> times;
+        times.reserve(static_cast<size_t>(numBlocks));
+
+        // Each graph has its own copy of the input, which processing replaces with its output
+        std::vector<juce::AudioBuffer<float>> buffers(static_cast<size_t>(numThreads), juce::AudioBuffer<float>(0, blockSize));
+        std::vector<juce::MidiBuffer> midiBuffers(static_cast<size_t>(numThreads));
+        std::vector<std::unique_ptr<ChordStackSource>> sources;
+
+        for (int t = 0; t < numThreads; ++t)
+        {
+            midiBuffers[static_cast<size_t>(t)].ensureSize(65536);
+            sources.push_back(std::make_unique<ChordStackSource>(config));
+        }
+
+        auto renderGraph = [&](int t, int block)
+        {
+            auto i = static_cast<size_t>(t);
+            sources[i]->fillBlock(midiBuffers[i], static_cast<juce::int64>(block) * blockSize, blockSize);
+            graphs[i]->processBlock(buffers[i], midiBuffers[i]);
+        };
+
+        // This thread renders graph 0 and times the callback; the others wait for each block
+        std::atomic<int> blocksStarted{0};
+        std::atomic<int> graphsDone{0};
+        std::vector<std::thread> threads;
+
+        for (int t = 1; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                for (int block = 0; block < numBlocks; ++block)
+                {
+                    while (blocksStarted.load(std::memory_order_acquire) <= block)
+                        std::this_thread::yield();
+
+                    renderGraph(t, block);
+                    graphsDone.fetch_add(1, std::memory_order_release);
+                }
+            });
+        }
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            auto start = std::chrono::steady_clock::now();
+            blocksStarted.store(block + 1, std::memory_order_release);
+
+            renderGraph(0, block);
+
+            while (graphsDone.load(std::memory_order_acquire) < (block + 1) * (numThreads - 1))
+                std::this_thread::yield();
+
+            times.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        for (auto &graph : graphs)
+            graph->releaseResources();
+
+        auto meanNs = std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size());
+        std::sort(times.begin(), times.end());
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("benchmark", "graphScaling");
+        object->setProperty("instances", numInstances);
+        object->setProperty("threads", numThreads);
+        object->setProperty("blockSize", blockSize);
+        object->setProperty("blocks", numBlocks);
+        object->setProperty("nsPerCallback", juce::roundToInt(meanNs));
+        object->setProperty("p99", juce::roundToInt(times[static_cast<size_t>(0.99 * static_cast<double>(times.size() - 1))]));
+        object->setProperty("max", juce::roundToInt(times.back()));
+        object->setProperty("load", meanNs * 1.0e-9 * sampleRate / blockSize);
+        object->setProperty("bytesPerInstance", juce::roundToInt(bytesPerInstance));
+        print(juce::var(object));
+    }
+
+    // fastPow against std::pow over the progress values and exponents the curves use, with
+    // the worst difference in 14-bit bend steps at full range
+    void runPow(float exponent)
+    {
+        constexpr int numValues = 4096;
+        constexpr int numPasses = 2000;
+
+        std::vector<float> progress(numValues), results(numValues);
+        for (int i = 0; i < numValues; ++i)
+            progress[static_cast<size_t>(i)] = static_cast<float>(i) / (numValues - 1);
+
+        auto timePerCall = [&](auto &&function)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (int pass = 0; pass < numPasses; ++pass)
+            {
+                for (int i = 0; i < numValues; ++i)
+                    results[static_cast<size_t>(i)] = function(progress[static_cast<size_t>(i)]);
+
+                juce::ignoreUnused(*static_cast<volatile float *>(results.data()));
+            }
+
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (numPasses * numValues);
+        };
+
+        auto stdNs = timePerCall([exponent](float x) { return std::pow(x, exponent); });
+        auto fastNs = timePerCall([exponent](float x) { return fastPow(x, exponent); });
+
+        double maxError = 0.0;
+        for (auto x : progress)
+            maxError = juce::jmax(maxError, std::abs(static_cast<double>(fastPow(x, exponent)) - std::pow(static_cast<double>(x), static_cast<double>(exponent))));
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("benchmark", "pow");
+        object->setProperty("exponent", exponent);
+        object->setProperty("nsPerStdPow", stdNs);
+        object->setProperty("nsPerFastPow", fastNs);
+        object->setProperty("maxErrorSteps", maxError * 8192.0);
+        print(juce::var(object));
+    }
+
+    // The vibrato's sine against std::sin over a few cycles, with the worst difference as a
+    // fraction of the depth
+    void runSine()
+    {
+        constexpr int numValues = 4096;
+        constexpr int numPasses = 2000;
+
+        std::vector<float> phases(numValues), results(numValues);
+        for (int i = 0; i < numValues; ++i)
+            phases[static_cast<size_t>(i)] = 4.0f * static_cast<float>(i) / numValues - 2.0f;
+
+        auto timePerCall = [&](auto &&function)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (int pass = 0; pass < numPasses; ++pass)
+            {
+                for (int i = 0; i < numValues; ++i)
+                    results[static_cast<size_t>(i)] = function(phases[static_cast<size_t>(i)]);
+
+                juce::ignoreUnused(*static_cast<volatile float *>(results.data()));
+            }
+
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (numPasses * numValues);
+        };
+
+        auto stdNs = timePerCall([](float x) { return std::sin(juce::MathConstants<float>::twoPi * x); });
+        auto fastNs = timePerCall([](float x) { return Vibrato::sine(x); });
+
+        double maxError = 0.0;
+        for (auto x : phases)
+            maxError = juce::jmax(maxError, std::abs(static_cast<double>(Vibrato::sine(x)) - std::sin(juce::MathConstants<double>::twoPi * x)));
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("benchmark", "sine");
+        object->setProperty("nsPerStdSin", stdNs);
+        object->setProperty("nsPerVibratoSine", fastNs);
+        object->setProperty("maxError", maxError);
+        print(juce::var(object));
+    }
+
+    // Each dispatched kernel at every level this CPU runs, over a bend pass's worth of slots,
+    // and whether it matches the baseline bit for bit
+    void runKernels()
+    {
+        constexpr int numValues = 16;
+        constexpr int numPasses = 2000000;
+
+        std::vector<float> progress(numValues), elapsed(numValues), phases(numValues), results(numValues), expected(numValues);
+        for (int i = 0; i < numValues; ++i)
+        {
+            progress[static_cast<size_t>(i)] = static_cast<float>(i) / (numValues - 1);
+            elapsed[static_cast<size_t>(i)] = 1000.0f * static_cast<float>(i);
+            phases[static_cast<size_t>(i)] = 0.0625f * static_cast<float>(i);
+        }
+
+        Vibrato vibrato;
+        vibrato.set(400.0f, 5.5f, 0.0f, 48000.0);
+
+        auto timePerValue = [&](auto &&kernel)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (int pass = 0; pass < numPasses; ++pass)
+            {
+                std::copy(progress.begin(), progress.end(), results.begin());
+                kernel(results.data());
+                juce::ignoreUnused(*static_cast<volatile float *>(results.data()));
+            }
+
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (numPasses * numValues);
+        };
+
+        auto detected = KernelDispatch::detect();
+
+        for (int level = 0; level < static_cast<int>(KernelDispatch::Level::numLevels); ++level)
+        {
+            auto kernelLevel = static_cast<KernelDispatch::Level>(level);
+
+            if (!KernelDispatch::isSupported(kernelLevel))
+                continue;
+
+            const auto &kernels = KernelDispatch::get(kernelLevel);
+            const auto &baseline = KernelDispatch::get(KernelDispatch::Level::baseline);
+
+            auto shape = [&](const KernelDispatch::Kernels &k, float *values) { k.shapeCurve(values, numValues, 0.37f); };
+            auto wobble = [&](const KernelDispatch::Kernels &k, float *values) { k.applyVibrato(vibrato, elapsed.data(), phases.data(), values, numValues); };
+
+            auto matches = [&](auto &&kernel)
+            {
+                std::copy(progress.begin(), progress.end(), expected.begin());
+                std::copy(progress.begin(), progress.end(), results.begin());
+                kernel(baseline, expected.data());
+                kernel(kernels, results.data());
+                return std::memcmp(expected.data(), results.data(), numValues * sizeof(float)) == 0;
+            };
+
+            auto *object = new juce::DynamicObject();
+            object->setProperty("benchmark", "kernels");
+            object->setProperty("level", KernelDispatch::getName(kernelLevel));
+            object->setProperty("selected", kernelLevel == detected);
+            object->setProperty("nsPerCurveValue", timePerValue([&](float *values) { shape(kernels, values); }));
+            object->setProperty("nsPerVibratoValue", timePerValue([&](float *values) { wobble(kernels, values); }));
+            object->setProperty("matchesBaseline", matches(shape) && matches(wobble));
+            print(juce::var(object));
+        }
+    }
+
+    // Real-time safety fuzzing. Everything a host may do between blocks is done at random,
+    // and every processBlock call must run without allocating or locking.
+    int runStressTest(double seconds, juce::int64 seed)
+    {
+        juce::Random random(seed);
+        PitchBendProcessor processor;
+
+        const int maxBlockSizes[] = {32, 128, 512, 2048};
+        const double sampleRates[] = {44100.0, 48000.0, 96000.0};
+        double sampleRate = 48000.0;
+        int maxBlockSize = 512;
+
+        auto prepare = [&]
+        {
+            sampleRate = sampleRates[random.nextInt(3)];
+            maxBlockSize = maxBlockSizes[random.nextInt(4)];
+            processor.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+            processor.prepareToPlay(sampleRate, maxBlockSize);
+        };
+
+        prepare();
+
+        constexpr int bufferSize = 4096;
+        juce::AudioBuffer<float> buffer(2, bufferSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(65536);
+
+        auto &parameters = processor.getParameters();
+        juce::MemoryBlock savedState;
+        double renderedSeconds = 0.0;
+        juce::int64 numBlocks = 0;
+
+        while (renderedSeconds < seconds)
+        {
+            // Host-side changes between blocks
+            auto action = random.nextInt(1000);
+
+            if (action < 2)
+                prepare();
+            else if (action < 6)
+                processor.reset();
+            else if (action < 10)
+                processor.getStateInformation(savedState);
+            else if (action < 14 && savedState.getSize() > 0)
+                processor.setStateInformation(savedState.getData(), static_cast<int>(savedState.getSize()));
+
+            for (int i = random.nextInt(3); --i >= 0;)
+                parameters[random.nextInt(parameters.size())]->setValueNotifyingHost(random.nextFloat());
+
+            // Now and then a block longer than prepareToPlay promised, as some hosts send
+            auto blockSizeLimit = random.nextInt(50) == 0 ? juce::jmin(bufferSize, maxBlockSize * 3) : maxBlockSize;
+
+            // Dense enough to keep the zone full and stealing; mixes notes, expression,
+            // program changes and controllers on every channel
+            auto numSamples = 1 + random.nextInt(blockSizeLimit);
+            midi.clear();
+
+            for (int i = random.nextInt(64); --i >= 0;)
+            {
+                auto position = random.nextInt(numSamples);
+                auto channel = 1 + random.nextInt(16);
+                auto note = random.nextInt(128);
+
+                switch (random.nextInt(8))
+                {
+                    case 0:
+                    case 1:
+                    case 2: midi.addEvent(juce::MidiMessage::noteOn(channel, note, static_cast<juce::uint8>(1 + random.nextInt(127))), position); break;
+                    case 3:
+                    case 4: midi.addEvent(juce::MidiMessage::noteOff(channel, note), position); break;
+                    case 5: midi.addEvent(juce::MidiMessage::channelPressureChange(channel, random.nextInt(128)), position); break;
+                    case 6: midi.addEvent(juce::MidiMessage::aftertouchChange(channel, note, random.nextInt(128)), position); break;
+                    default: midi.addEvent(random.nextBool() ? juce::MidiMessage::controllerEvent(channel, random.nextInt(120), random.nextInt(128))
+                                                             : juce::MidiMessage::programChange(channel, random.nextInt(16)),
+                                           position);
+                        break;
+                }
+            }
+
+            buffer.setSize(2, numSamples, false, false, true);
+
+            allocationCount = 0;
+            lockCount = 0;
+            countingAllocations = true;
+
+            processor.processBlock(buffer, midi);
+
+            countingAllocations = false;
+
+            int lastPosition = 0;
+            bool ordered = true;
+
+            for (const auto metadata : midi)
+            {
+                ordered = ordered && metadata.samplePosition >= lastPosition && metadata.samplePosition < numSamples;
+                lastPosition = metadata.samplePosition;
+            }
+
+            if (allocationCount > 0 || lockCount > 0 || !ordered)
+            {
+                std::cerr << "Block " << numBlocks << " (seed " << seed << "): " << allocationCount << " allocations, "
+                          << lockCount << " locks" << (ordered ? "" : ", output out of order") << std::endl;
+                return 1;
+            }
+
+            renderedSeconds += numSamples / sampleRate;
+            ++numBlocks;
+        }
+
+        std::cout << "Stress test passed: " << numBlocks << " blocks, " << juce::roundToInt(renderedSeconds) << " s" << std::endl;
+        return 0;
+    }
+
+    constexpr int resultsSchema = 1;
+
+    juce::var makeDocument()
+    {
+        auto *document = new juce::DynamicObject();
+        document->setProperty("schema", resultsSchema);
+        document->setProperty("gitHash", GIT_COMMIT_HASH);
+        document->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+        document->setProperty("cpu", juce::SystemStats::getCpuModel());
+        document->setProperty("cores", juce::SystemStats::getNumCpus());
+        document->setProperty("results", collectedResults);
+        return juce::var(document);
+    }
+
+    // The figures compared, each with whether a rise in it is a regression. Any other
+    // property of a result but these names its configuration; the number of blocks timed
+    // follows --seconds, the reference implementations' times aren't ours, and which kernel
+    // is selected follows the CPU, so those aren't compared at all.
+    struct Figure
+    {
+        const char *name;
+        bool lowerIsBetter;
+    };
+
+    constexpr Figure comparedFigures[] = {
+        {"nsPerBlock", true}, {"p50", true}, {"p99", true}, {"max", true},
+        {"allocationsPerBlock", true}, {"bytesPerInstance", true},
+        {"messagesPerSecond", true}, // What the receiver has to take
+        {"nsPerScan", true}, {"nsPerConstruct", true}, {"nsPerPrepare", true},
+        {"stateBytes", true}, {"nsTotal", true}, {"nsPerInstance", true}, {"nsPerSave", true}, {"nsPerCachedSave", true},
+        {"nsPerBlockAutomated", true}, {"nsPerCallback", true}, {"load", true},
+        {"nsPerFastPow", true}, {"maxErrorSteps", true}, {"nsPerVibratoSine", true}, {"maxError", true},
+        {"nsPerCurveValue", true}, {"nsPerVibratoValue", true}, {"matchesBaseline", false},
+    };
+
+    const char *const uncomparedProperties[] = {"blocks", "nsPerStdPow", "nsPerStdSin", "selected"};
+
+    const Figure *findFigure(const juce::Identifier &name)
+    {
+        for (const auto &figure : comparedFigures)
+            if (name == juce::Identifier(figure.name))
+                return &figure;
+
+        return nullptr;
+    }
+
+    juce::String getConfigurationKey(const juce::var &result)
+    {
+        juce::String key;
+
+        if (auto *object = result.getDynamicObject())
+        {
+            for (const auto &property : object->getProperties())
+            {
+                auto uncompared = std::any_of(std::begin(uncomparedProperties), std::end(uncomparedProperties),
+                                              [&](const char *name) { return property.name == juce::Identifier(name); });
+
+                if (!uncompared && findFigure(property.name) == nullptr)
+                    key << property.name.toString() << '=' << property.value.toString() << ' ';
+            }
+        }
+
+        return key.trimEnd();
+    }
+
+    juce::var readDocument(const juce::String &path)
+    {
+        auto document = juce::JSON::parse(juce::File::getCurrentWorkingDirectory().getChildFile(path));
+
+        if (static_cast<int>(document["schema"]) != resultsSchema || !document["results"].isArray())
+        {
+            std::cerr << path << " isn't a benchmark results document" << std::endl;
+            return {};
+        }
+
+        return document;
+    }
+
+    // Prints one line per figure worse than the baseline's by more than thresholdPercent,
+    // then a summary; returns the exit code, 1 if there were any
+    int compare(const juce::var &baseline, const juce::var &current, double thresholdPercent)
+    {
+        std::map<juce::String, juce::var> baselineResults;
+
+        for (const auto &result : *baseline["results"].getArray())
+            baselineResults[getConfigurationKey(result)] = result;
+
+        int numCompared = 0;
+        int numRegressions = 0;
+
+        for (const auto &result : *current["results"].getArray())
+        {
+            auto key = getConfigurationKey(result);
+            auto found = baselineResults.find(key);
+
+            if (found == baselineResults.end())
+                continue;
+
+            for (const auto &figure : comparedFigures)
+            {
+                if (!result.hasProperty(figure.name) || !found->second.hasProperty(figure.name))
+                    continue;
+
+                auto before = static_cast<double>(found->second[figure.name]);
+                auto now = static_cast<double>(result[figure.name]);
+                auto worse = figure.lowerIsBetter ? now - before : before - now;
+                ++numCompared;
+
+                // A figure that was zero, like allocations, regresses on any rise at all
+                if (worse <= 0.0 || worse <= std::abs(before) * thresholdPercent / 100.0)
+                    continue;
+
+                ++numRegressions;
+
+                auto *object = new juce::DynamicObject();
+                object->setProperty("regression", key);
+                object->setProperty("figure", figure.name);
+                object->setProperty("baseline", before);
+                object->setProperty("current", now);
+
+                if (before != 0.0)
+                    object->setProperty("changePercent", (now - before) * 100.0 / std::abs(before));
+
+                std::cout << juce::JSON::toString(juce::var(object), true) << std::endl;
+            }
+        }
+
+        auto *summary = new juce::DynamicObject();
+        summary->setProperty("comparison", baseline["gitHash"].toString() + ".." + current["gitHash"].toString());
+        summary->setProperty("thresholdPercent", thresholdPercent);
+        summary->setProperty("figuresCompared", numCompared);
+        summary->setProperty("regressions", numRegressions);
+        std::cout << juce::JSON::toString(juce::var(summary), true) << std::endl;
+
+        return numRegressions > 0 ? 1 : 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI init;
+    juce::ArgumentList args(argc, argv);
+
+    auto full = args.containsOption("--full");
+    auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 10.0;
+    auto threshold = args.containsOption("--threshold") ? args.getValueForOption("--threshold").getDoubleValue() : 10.0;
+    juce::var baseline;
+
+    if (args.containsOption("--baseline") && (baseline = readDocument(args.getValueForOption("--baseline"))).isVoid())
+        return 1;
+
+    if (args.containsOption("--compare"))
+    {
+        auto current = readDocument(args.getValueForOption("--compare"));
+
+        if (current.isVoid() || baseline.isVoid())
+        {
+            if (baseline.isVoid())
+                std::cerr << "--compare needs a --baseline" << std::endl;
+
+            return 1;
+        }
+
+        return compare(baseline, current, threshold);
+    }
+
+    if (args.containsOption("--stress"))
+    {
+        auto seed = args.containsOption("--seed") ? args.getValueForOption("--seed").getLargeIntValue() : juce::Time::currentTimeMillis();
+        return runStressTest(seconds, seed);
+    }
+
+    const int blockSizes[] = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+    const double sampleRates[] = {44100.0, 48000.0, 96000.0, 192000.0};
+    const int voiceCounts[] = {1, 3, 6, 10, 15};
+    const double densities[] = {2.0, 8.0, 32.0, 128.0};
+    const float updateRates[] = {0.25f, 1.45f, 5.0f, 20.0f};
+
+    const Config typical;
+
+    if (full)
+    {
+        for (auto blockSize : blockSizes)
+            for (auto sampleRate : sampleRates)
+                for (auto voices : voiceCounts)
+                    for (auto density : densities)
+                        for (auto updateRate : updateRates)
+                            runAndPrint({blockSize, sampleRate, voices, density, updateRate}, seconds);
+    }
+    else
+    {
+        for (auto blockSize : blockSizes)
+            runAndPrint({blockSize, typical.sampleRate, typical.voices, typical.notesPerSecond, typical.updateRateMs}, seconds);
+
+        for (auto sampleRate : sampleRates)
+            runAndPrint({typical.blockSize, sampleRate, typical.voices, typical.notesPerSecond, typical.updateRateMs}, seconds);
+
+        for (auto voices : voiceCounts)
+            runAndPrint({typical.blockSize, typical.sampleRate, voices, typical.notesPerSecond, typical.updateRateMs}, seconds);
+
+        for (auto density : densities)
+            runAndPrint({typical.blockSize, typical.sampleRate, typical.voices, density, typical.updateRateMs}, seconds);
+
+        for (auto updateRate : updateRates)
+            runAndPrint({typical.blockSize, typical.sampleRate, typical.voices, typical.notesPerSecond, updateRate}, seconds);
+    }
+
+    runStartup(500);
+    runStateRestore(500);
+
+    for (auto exponent : {1.37f, 2.5f, 3.9f})
+        runPow(exponent);
+
+    runSine();
+    runKernels();
+    runParallelInstances(100, seconds);
+
+    auto numCores = static_cast<int>(std::thread::hardware_concurrency());
+
+    for (auto numInstances : {1, 10, 100, 500})
+    {
+        runGraphScaling(numInstances, 1, seconds);
+
+        if (numInstances > 1 && numCores > 1)
+            runGraphScaling(numInstances, numCores, seconds);
+    }
+
+    auto document = makeDocument();
+
+    if (args.containsOption("--output"))
+    {
+        auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+
+        if (!file.replaceWithText(juce::JSON::toString(document)))
+        {
+            std::cerr << "Couldn't write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    return baseline.isVoid() ? 0 : compare(baseline, document, threshold);
+}
@@ -0,0 +1,185 @@
+#include <JuceHeader.h>
+#include "PluginEditor.h"
+
+// Editor paint and layout benchmark: renders PitchBendEditor, with its curve display,
+// keyboard map and performance HUD, into an offscreen image at several editor sizes and
+// pixel scales, and prints one JSON object per line for each, for regression tracking.
+//
+//   BetterChordStacksEditorBenchmark [--frames=<n>]
+//
+// Between frames the processor plays a block of moving chords, so the curve display, the
+// map and the HUD all have something new to draw, and the editor runs its per-frame update
+// as the display's refresh would. Times are wall-clock milliseconds: the resize and layout,
+// the first paint at the size (which rasterizes the cached images), and then each paint
+// after it, which should draw from the caches. Allocations are counted on the message
+// thread while the steady paints run.
+
+namespace
+{
+    // Only the message thread paints, so the processor's timer threads are not counted
+    thread_local bool countingAllocations = false;
+    thread_local juce::int64 allocationCount = 0;
+
+    void *allocate(size_t size)
+    {
+        if (countingAllocations)
+            ++allocationCount;
+
+        if (auto *p = std::malloc(size))
+            return p;
+
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // A six-note chord struck every quarter second, each held for most of a second
+    class ChordSource
+    {
+    public:
+        void fillBlock(juce::MidiBuffer &midi, int blockSize)
+        {
+            midi.clear();
+
+            for (int i = 0; i < blockSize; ++i, ++sample)
+            {
+                if (sample % chordSpacing == 0)
+                {
+                    if (!held.empty())
+                        for (auto note : held)
+                            midi.addEvent(juce::MidiMessage::noteOff(1, note), i);
+
+                    held.clear();
+                    auto root = 48 + static_cast<int>((sample / chordSpacing) % 12);
+
+                    for (auto interval : {0, 4, 7, 11, 14, 17})
+                    {
+                        held.push_back(root + interval);
+                        midi.addEvent(juce::MidiMessage::noteOn(1, root + interval, static_cast<juce::uint8>(100)), i);
+                    }
+                }
+            }
+        }
+
+    private:
+        static constexpr juce::int64 chordSpacing = 12000;
+        juce::int64 sample = 0;
+        std::vector<int> held;
+    };
+
+    void print(const juce::var &object)
+    {
+        std::cout << juce::JSON::toString(object, true) << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI init;
+    juce::ArgumentList args(argc, argv);
+
+    auto numFrames = args.containsOption("--frames") ? juce::jmax(1, args.getValueForOption("--frames").getIntValue()) : 200;
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 800; // A 60 Hz frame
+
+    PitchBendProcessor processor;
+    processor.openGLRendering->setValueNotifyingHost(0.0f);
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    std::unique_ptr<juce::AudioProcessorEditor> created(processor.createEditor());
+    auto &editor = dynamic_cast<PitchBendEditor &>(*created);
+    editor.setHudVisible(true);
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    ChordSource source;
+
+    const float editorScales[] = {0.5f, 1.0f, 1.5f, 2.0f};
+    const float pixelScales[] = {1.0f, 2.0f};
+
+    for (auto editorScale : editorScales)
+    {
+        for (auto pixelScale : pixelScales)
+        {
+            auto layoutStart = Clock::now();
+            editor.setSize(juce::roundToInt(640 * editorScale), juce::roundToInt(380 * editorScale));
+            auto layoutMs = millisecondsSince(layoutStart);
+
+            juce::Image image(juce::Image::ARGB, juce::roundToInt(static_cast<float>(editor.getWidth()) * pixelScale),
+                              juce::roundToInt(static_cast<float>(editor.getHeight()) * pixelScale), true);
+
+            auto paint = [&]
+            {
+                juce::Graphics g(image);
+                g.addTransform(juce::AffineTransform::scale(pixelScale));
+                editor.paintEntireComponent(g, true);
+            };
+
+            auto frame = [&]
+            {
+                source.fillBlock(midi, blockSize);
+                processor.processBlock(buffer, midi);
+                editor.updateFrame();
+            };
+
+            frame();
+            auto firstStart = Clock::now();
+            paint();
+            auto firstPaintMs = millisecondsSince(firstStart);
+
+            std::vector<double> times;
+            times.reserve(static_cast<size_t>(numFrames));
+            juce::int64 allocations = 0;
+
+            for (int i = 0; i < numFrames; ++i)
+            {
+                frame();
+
+                allocationCount = 0;
+                countingAllocations = true;
+                auto start = Clock::now();
+
+                paint();
+
+                times.push_back(millisecondsSince(start));
+                countingAllocations = false;
+                allocations += allocationCount;
+            }
+
+            std::sort(times.begin(), times.end());
+
+            auto *object = new juce::DynamicObject();
+            object->setProperty("editorScale", editorScale);
+            object->setProperty("pixelScale", pixelScale);
+            object->setProperty("width", image.getWidth());
+            object->setProperty("height", image.getHeight());
+            object->setProperty("layoutMs", layoutMs);
+            object->setProperty("firstPaintMs", firstPaintMs);
+            object->setProperty("msPerFrame", std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size()));
+            object->setProperty("p99Ms", times[static_cast<size_t>(0.99 * static_cast<double>(times.size() - 1))]);
+            object->setProperty("allocationsPerPaint", static_cast<double>(allocations) / numFrames);
+            print(juce::var(object));
+        }
+    }
+
+    created.reset();
+    processor.releaseResources();
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include "ChordBendEngine.h"
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Embedded MIDI router: ChordBendEngine between two ALSA raw MIDI ports, for a small Linux
+// box (Raspberry Pi, Bela) sitting between a keyboard and a synth. It is built from the
+// core alone, with no JUCE, GUI or audio device, by its own CMake project in tools/embedded,
+// and is ready as soon as the ports open.
+//
+//   BetterChordStacksEmbeddedRouter --input <port> --output <port> [options]
+//
+//   --input <port>         ALSA raw MIDI port to read, as "amidi -l" lists it (hw:1,0,0)
+//   --output <port>        ALSA raw MIDI port to write
+//   --sample-rate <hz>     Rate of the engine's sample clock (default: 48000)
+//   --set <id>=<value>     Set a parameter: bendAmount, bendTime, bendCurve, bendRange,
+//                          zoneChannels, updateRate (ms), stealPolicy, notePriority or
+//                          fixedPoint; may be repeated
+//
+// The fixed-point engine is on unless set off, so a box bends exactly as any other does. The
+// loop waits on the input for at most one update interval; each wake processes the time
+// since the last as one block, with any messages that came in at its last sample, and writes
+// the output at once. The sample clock follows the wall clock. Runs until interrupted, then
+// silences the zone.
+
+namespace
+{
+    std::atomic<bool> stopRequested{false};
+
+    using Parameter = ChordBendEngine::Parameter;
+
+    constexpr int maxEvents = 1024;
+
+    struct NamedParameter
+    {
+        const char *id;
+        Parameter parameter;
+    };
+
+    // The plugin's parameter IDs where it has the same parameter
+    constexpr NamedParameter parameterNames[] = {
+        {"bendAmount", Parameter::bendAmount},
+        {"bendTime", Parameter::bendTime},
+        {"bendCurve", Parameter::bendCurve},
+        {"bendRange", Parameter::bendRange},
+        {"zoneChannels", Parameter::zoneChannels},
+        {"updateRate", Parameter::updateIntervalMs},
+        {"stealPolicy", Parameter::stealPolicy},
+        {"notePriority", Parameter::notePriority},
+        {"fixedPoint", Parameter::fixedPoint},
+    };
+
+    [[noreturn]] void fail(const std::string &message)
+    {
+        std::fprintf(stderr, "%s\n", message.c_str());
+        std::exit(1);
+    }
+
+    // Splits the input byte stream into messages, with running status. SysEx can't go
+    // through the engine's three-byte events and is skipped; real-time bytes go straight on.
+    class MidiParser
+    {
+    public:
+        // True when byte completes a message, which is then in event
+        bool push(std::uint8_t byte, ChordBendEngine::Event &event)
+        {
+            if (byte >= 0xf8)
+            {
+                event = {0, 1, {byte, 0, 0}};
+                return true;
+            }
+
+            if (byte >= 0x80)
+            {
+                inSysEx = byte == 0xf0;
+                status = byte < 0xf0 ? byte : 0; // System common cancels running status
+                numData = 0;
+                return false;
+            }
+
+            if (inSysEx || status == 0)
+                return false;
+
+            data[numData++] = byte;
+            auto type = status & 0xf0;
+            auto needed = type == 0xc0 || type == 0xd0 ? 1 : 2;
+
+            if (numData < needed)
+                return false;
+
+            event = {0, static_cast<std::uint8_t>(needed + 1), {status, data[0], needed == 2 ? data[1] : std::uint8_t{0}}};
+            numData = 0;
+            return true;
+        }
+
+    private:
+        std::uint8_t status = 0;
+        std::uint8_t data[2]{};
+        int numData = 0;
+        bool inSysEx = false;
+    };
+
+    void writeEvents(snd_rawmidi_t *output, const ChordBendEngine::Event *events, int numEvents)
+    {
+        std::uint8_t bytes[maxEvents * 3];
+        size_t size = 0;
+
+        for (int i = 0; i < numEvents; ++i)
+            for (int b = 0; b < events[i].size; ++b)
+                bytes[size++] = events[i].data[b];
+
+        if (size > 0 && snd_rawmidi_write(output, bytes, size) < 0)
+            std::fprintf(stderr, "Output write failed\n");
+    }
+
+    // Note-offs and centred bends on every member channel
+    void silenceZone(snd_rawmidi_t *output, const ChordBendEngine &engine)
+    {
+        ChordBendEngine::Event events[32];
+        int numEvents = 0;
+        auto numChannels = static_cast<int>(engine.getParameter(Parameter::zoneChannels));
+
+        for (int channel = 2; channel <= numChannels + 1; ++channel)
+        {
+            auto index = static_cast<std::uint8_t>(channel - 1);
+            events[numEvents++] = {0, 3, {static_cast<std::uint8_t>(0xb0 | index), 123, 0}};
+            events[numEvents++] = {0, 3, {static_cast<std::uint8_t>(0xe0 | index), 0, 64}};
+        }
+
+        writeEvents(output, events, numEvents);
+        snd_rawmidi_drain(output);
+    }
+
+    void setParameter(ChordBendEngine &engine, const std::string &assignment)
+    {
+        auto equals = assignment.find('=');
+
+        if (equals != std::string::npos)
+        {
+            auto id = assignment.substr(0, equals);
+
+            for (const auto &named : parameterNames)
+            {
+                if (id == named.id)
+                {
+                    engine.setParameter(named.parameter, std::strtof(assignment.c_str() + equals + 1, nullptr));
+                    return;
+                }
+            }
+        }
+
+        fail("Unknown parameter in --set " + assignment);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    auto launchTime = std::chrono::steady_clock::now();
+
+    std::string inputName, outputName;
+    double sampleRate = 48000.0;
+    std::vector<std::string> assignments;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto nextValue = [&]
+        {
+            if (i + 1 >= argc)
+                fail("Missing value for " + arg);
+            return std::string(argv[++i]);
+        };
+
+        if (arg == "--input")
+            inputName = nextValue();
+        else if (arg == "--output")
+            outputName = nextValue();
+        else if (arg == "--sample-rate")
+            sampleRate = std::strtod(nextValue().c_str(), nullptr);
+        else if (arg == "--set")
+            assignments.push_back(nextValue());
+        else
+            fail("Unknown option " + arg);
+    }
+
+    if (inputName.empty() || outputName.empty())
+        fail("Usage: BetterChordStacksEmbeddedRouter --input <port> --output <port> [--sample-rate <hz>] [--set <id>=<value>...]");
+
+    if (!(sampleRate >= 8000.0 && sampleRate <= 768000.0))
+        fail("--sample-rate must be between 8000 and 768000");
+
+    ChordBendEngine engine(sampleRate);
+    engine.setParameter(Parameter::fixedPoint, 1.0f);
+
+    for (const auto &assignment : assignments)
+        setParameter(engine, assignment);
+
+    snd_rawmidi_t *input = nullptr;
+    snd_rawmidi_t *output = nullptr;
+
+    if (snd_rawmidi_open(&input, nullptr, inputName.c_str(), SND_RAWMIDI_NONBLOCK) < 0)
+        fail("Couldn't open " + inputName);
+
+    if (snd_rawmidi_open(nullptr, &output, outputName.c_str(), 0) < 0)
+        fail("Couldn't open " + outputName);
+
+    std::signal(SIGINT, [](int) { stopRequested = true; });
+    std::signal(SIGTERM, [](int) { stopRequested = true; });
+
+    std::vector<pollfd> descriptors(static_cast<size_t>(snd_rawmidi_poll_descriptors_count(input)));
+    snd_rawmidi_poll_descriptors(input, descriptors.data(), static_cast<unsigned int>(descriptors.size()));
+
+    ChordBendEngine::Event inputEvents[maxEvents];
+    ChordBendEngine::Event outputEvents[maxEvents];
+    std::uint8_t bytes[256];
+    MidiParser parser;
+
+    auto clockStart = std::chrono::steady_clock::now();
+    std::int64_t processedSamples = 0;
+
+    std::fprintf(stderr, "Ready in %.1f ms\n", std::chrono::duration<double, std::milli>(clockStart - launchTime).count());
+
+    while (!stopRequested)
+    {
+        auto timeoutMs = std::max(1, static_cast<int>(std::ceil(engine.getParameter(Parameter::updateIntervalMs))));
+        poll(descriptors.data(), static_cast<nfds_t>(descriptors.size()), timeoutMs);
+
+        int numInput = 0;
+        ssize_t numBytes;
+
+        while ((numBytes = snd_rawmidi_read(input, bytes, sizeof(bytes))) > 0)
+            for (ssize_t i = 0; i < numBytes; ++i)
+                if (parser.push(bytes[i], inputEvents[numInput]) && numInput < maxEvents - 1)
+                    ++numInput;
+
+        // The time since the last block, at least a sample so the input has one to sit on.
+        // After a stall of over a second the clock jumps on rather than catch up.
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - clockStart).count();
+        auto target = static_cast<std::int64_t>(elapsed * sampleRate);
+        auto numSamples = static_cast<int>(std::clamp<std::int64_t>(target - processedSamples, 1, static_cast<std::int64_t>(sampleRate)));
+
+        for (int i = 0; i < numInput; ++i)
+            inputEvents[i].sampleOffset = static_cast<std::uint32_t>(numSamples - 1);
+
+        auto numOutput = engine.process(inputEvents, numInput, outputEvents, maxEvents, numSamples);
+        writeEvents(output, outputEvents, numOutput);
+        processedSamples = std::max(processedSamples + numSamples, target);
+    }
+
+    silenceZone(output, engine);
+    snd_rawmidi_close(input);
+    snd_rawmidi_close(output);
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+// libFuzzer target for the MIDI processing core, built with address and undefined behaviour
+// sanitizers when configured with -DBCS_FUZZ=ON (clang only):
+//
+//   BetterChordStacksFuzz [libFuzzer options] [corpus folder]
+//
+// Each input is read as a sample rate, a prepared block size and a few parameter values,
+// then as blocks of arbitrary MIDI bytes: any status, truncated messages, sysex without its
+// end byte, blocks up to four times longer than prepared and event times out of order or
+// outside the block. The events are written into the MidiBuffer directly, as addEvent would
+// sort and filter them.
+//
+// Besides the sanitizers' own checks, every processBlock call must run without allocating
+// and within a fixed time per event and per sample; either failure aborts with the block.
+// Inputs stay within what prepareToPlay reserves for: up to maxInputBytes of input per
+// block.
+
+namespace
+{
+    thread_local bool countingAllocations = false;
+    thread_local juce::int64 allocationCount = 0;
+
+    void *allocate(size_t size)
+    {
+        if (countingAllocations)
+            ++allocationCount;
+
+        if (auto *p = std::malloc(size == 0 ? 1 : size))
+            return p;
+
+        throw std::bad_alloc();
+    }
+
+    // The processor reserves for 512 input events of up to 3 bytes, each with a 6-byte header
+    constexpr int maxInputBytes = 512 * 9;
+
+    // Generous enough for sanitized builds; a slow path that scales with the voices or the
+    // block rather than the events still shows up at the sizes the fuzzer reaches
+    constexpr double maxMicrosecondsPerEvent = 500.0;
+    constexpr double maxMicrosecondsPerSample = 5.0;
+
+    class ByteReader
+    {
+    public:
+        ByteReader(const juce::uint8 *dataToRead, size_t sizeToRead) : data(dataToRead), size(sizeToRead) {}
+
+        bool isEmpty() const { return position >= size; }
+        int next8() { return position < size ? data[position++] : 0; }
+        int next16() { return next8() | (next8() << 8); }
+
+    private:
+        const juce::uint8 *data;
+        size_t size;
+        size_t position = 0;
+    };
+
+    void appendRawEvent(juce::MidiBuffer &buffer, const juce::uint8 *data, int numBytes, int samplePos)
+    {
+        constexpr int headerSize = sizeof(juce::int32) + sizeof(juce::uint16);
+        auto offset = buffer.data.size();
+
+        buffer.data.insertMultiple(offset, 0, headerSize + numBytes);
+
+        auto *d = buffer.data.begin() + offset;
+        juce::writeUnaligned<juce::int32>(d, samplePos);
+        juce::writeUnaligned<juce::uint16>(d + sizeof(juce::int32), static_cast<juce::uint16>(numBytes));
+        std::memcpy(d + headerSize, data, static_cast<size_t>(numBytes));
+    }
+
+    [[noreturn]] void fail(const juce::String &reason, int numSamples, const juce::MidiBuffer &input)
+    {
+        std::cerr << reason << " in a block of " << numSamples << " samples with input:" << std::endl;
+
+        for (const auto metadata : input)
+            std::cerr << "  " << metadata.samplePosition << ": "
+                      << juce::String::toHexString(metadata.data, metadata.numBytes) << std::endl;
+
+        std::abort();
+    }
+
+    std::unique_ptr<juce::ScopedJuceInitialiser_GUI> juceInitialiser;
+    std::unique_ptr<PitchBendProcessor> processor;
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+extern "C" int LLVMFuzzerInitialize(int *, char ***)
+{
+    juceInitialiser = std::make_unique<juce::ScopedJuceInitialiser_GUI>();
+    processor = std::make_unique<PitchBendProcessor>();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const juce::uint8 *data, size_t size)
+{
+    ByteReader input(data, size);
+
+    // Set up outside the checks, as a host would between blocks
+    const double sampleRates[] = {44100.0, 48000.0, 96000.0, 192000.0};
+    auto sampleRate = sampleRates[input.next8() % 4];
+    auto preparedBlockSize = 1 + input.next16() % 4096;
+
+    processor->setRateAndBufferSizeDetails(sampleRate, preparedBlockSize);
+    processor->prepareToPlay(sampleRate, preparedBlockSize);
+
+    auto &parameters = processor->getParameters();
+    for (int i = input.next8() % 8; --i >= 0;)
+        parameters[input.next8() % parameters.size()]->setValueNotifyingHost(static_cast<float>(input.next8()) / 255.0f);
+
+    auto maxBlockSize = preparedBlockSize * 4;
+    juce::AudioBuffer<float> buffer(2, maxBlockSize);
+    juce::MidiBuffer midi, sentInput;
+    midi.ensureSize(1 << 20);
+    sentInput.ensureSize(maxInputBytes);
+
+    while (!input.isEmpty())
+    {
+        auto numSamples = 1 + input.next16() % maxBlockSize;
+        int numEvents = 0;
+        midi.clear();
+
+        // Times anywhere from before the block to a quarter past its end, in any order
+        for (auto count = input.next8(); --count >= 0 && !input.isEmpty();)
+        {
+            juce::uint8 bytes[256];
+            auto samplePos = static_cast<int>(static_cast<juce::int16>(input.next16())) % (numSamples + numSamples / 4 + 1);
+            bytes[0] = static_cast<juce::uint8>(input.next8());
+
+            // Channel messages keep to three bytes; sysex runs as long as the input says,
+            // with or without its end byte
+            auto numBytes = bytes[0] == 0xf0 ? 1 + input.next8() : 1 + input.next8() % 3;
+            for (int i = 1; i < numBytes; ++i)
+                bytes[i] = static_cast<juce::uint8>(input.next8());
+
+            if (midi.data.size() + 6 + numBytes > maxInputBytes)
+                break;
+
+            appendRawEvent(midi, bytes, numBytes, samplePos);
+            ++numEvents;
+        }
+
+        sentInput.clear();
+        sentInput.data.addArray(midi.data);
+        buffer.setSize(2, numSamples, false, false, true);
+
+        allocationCount = 0;
+        countingAllocations = true;
+        auto start = std::chrono::steady_clock::now();
+
+        processor->processBlock(buffer, midi);
+
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        countingAllocations = false;
+
+        if (allocationCount > 0)
+            fail(juce::String(allocationCount) + " allocations", numSamples, sentInput);
+
+        if (elapsed > (numEvents + 1) * maxMicrosecondsPerEvent + numSamples * maxMicrosecondsPerSample)
+            fail(juce::String(elapsed, 0) + " us", numSamples, sentInput);
+    }
+
+    processor->releaseResources();
+    return 0;
+}
@@ -0,0 +1,271 @@
+#include <JuceHeader.h>
+
+// Loopback latency probe: plays timed notes through the router over a pair of loopback
+// MIDI ports and timestamps what comes back, to pick update rate and budget settings that
+// keep a hardware synth tight.
+//
+//   BetterChordStacksLatency --router <executable> --send <name> --receive <name>
+//                            --router-input <name> --router-output <name> [options]
+//
+//   --router <executable>  BetterChordStacksRouter, started once per setting
+//   --send <name>          Port the probe plays into; must loop back to --router-input
+//   --receive <name>       Port the probe listens on; --router-output must loop back to it
+//   --router-input <name>  The router's input, passed to it as --input
+//   --router-output <name> The router's output, passed to it as --output
+//   --update-rates <ms,..> Update rates to measure (default: 0.5,1.45,5)
+//   --budgets <n,..>       Bandwidth budgets in messages per second, 0 for none (default: 0,1000)
+//   --notes <n>            Notes played per setting (default: 50)
+//   --note-length <ms>     How long each note is held (default: 300)
+//
+// Notes are played one at a time with a gap after each. Latency is from sending a note-on
+// to its note-on coming back; jitter is how far each gap between the bends that follow on
+// its channel is from the update rate. Both are timed on the probe's clock, so the ports'
+// own latency is included, as it would be with a synth. Prints one JSON object per line
+// for each setting, with histograms in 0.25 ms bins from 0 to 10 ms and one bin for
+// anything later.
+
+namespace
+{
+    constexpr double binWidthMs = 0.25;
+    constexpr int numBins = 40;
+
+    struct Histogram
+    {
+        std::vector<double> values;
+
+        void add(double ms) { values.push_back(ms); }
+
+        juce::var toVar() const
+        {
+            std::vector<double> sorted(values);
+            std::sort(sorted.begin(), sorted.end());
+
+            auto *object = new juce::DynamicObject();
+            object->setProperty("count", static_cast<int>(sorted.size()));
+
+            if (!sorted.empty())
+            {
+                auto percentile = [&](double p) { return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1))]; };
+                object->setProperty("meanMs", std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size()));
+                object->setProperty("p50Ms", percentile(0.5));
+                object->setProperty("p99Ms", percentile(0.99));
+                object->setProperty("maxMs", sorted.back());
+            }
+
+            juce::Array<juce::var> bins;
+            bins.insertMultiple(0, 0, numBins + 1);
+
+            for (auto ms : sorted)
+            {
+                auto bin = juce::jlimit(0, numBins, static_cast<int>(ms / binWidthMs));
+                bins.set(bin, static_cast<int>(bins[bin]) + 1);
+            }
+
+            object->setProperty("bins", bins);
+            return juce::var(object);
+        }
+    };
+
+    // What comes back for the note being played, filled in on the input's callback thread
+    class Listener : public juce::MidiInputCallback
+    {
+    public:
+        void expect(int noteNumber, double sentMs)
+        {
+            const juce::ScopedLock sl(lock);
+            note = noteNumber;
+            noteSentMs = sentMs;
+            channel = 0;
+            lastBendMs = 0.0;
+        }
+
+        void take(Histogram &latency, Histogram &intervals)
+        {
+            const juce::ScopedLock sl(lock);
+
+            for (auto ms : receivedLatencies)
+                latency.add(ms);
+
+            for (auto ms : receivedIntervals)
+                intervals.add(ms);
+
+            receivedLatencies.clear();
+            receivedIntervals.clear();
+        }
+
+    private:
+        void handleIncomingMidiMessage(juce::MidiInput *, const juce::MidiMessage &message) override
+        {
+            auto receivedMs = message.getTimeStamp() * 1000.0;
+            const juce::ScopedLock sl(lock);
+
+            if (message.isNoteOn() && message.getNoteNumber() == note && channel == 0)
+            {
+                channel = message.getChannel();
+                receivedLatencies.push_back(receivedMs - noteSentMs);
+            }
+            else if (message.isPitchWheel() && message.getChannel() == channel)
+            {
+                if (lastBendMs > 0.0)
+                    receivedIntervals.push_back(receivedMs - lastBendMs);
+
+                lastBendMs = receivedMs;
+            }
+            else if (message.isNoteOff() && message.getChannel() == channel)
+            {
+                channel = -1; // Bends after the note-off belong to no note
+            }
+        }
+
+        juce::CriticalSection lock;
+        int note = -1;
+        int channel = -1;
+        double noteSentMs = 0.0;
+        double lastBendMs = 0.0;
+        std::vector<double> receivedLatencies;
+        std::vector<double> receivedIntervals;
+    };
+
+    struct ProbeSettings
+    {
+        juce::String router, send, receive, routerInput, routerOutput;
+        juce::StringArray updateRates{"0.5", "1.45", "5"};
+        juce::StringArray budgets{"0", "1000"};
+        int numNotes = 50;
+        int noteLengthMs = 300;
+    };
+
+    juce::MidiDeviceInfo findDevice(const juce::Array<juce::MidiDeviceInfo> &devices, const juce::String &name)
+    {
+        for (auto &device : devices)
+            if (device.name == name)
+                return device;
+
+        for (auto &device : devices)
+            if (device.name.containsIgnoreCase(name))
+                return device;
+
+        juce::ConsoleApplication::fail("No MIDI device matches " + name);
+        return {};
+    }
+
+    void measure(const ProbeSettings &settings, const juce::String &updateRate, const juce::String &budget,
+                 juce::MidiOutput &output, Listener &listener)
+    {
+        juce::ChildProcess router;
+        auto budgetEnabled = budget.getIntValue() > 0;
+
+        juce::StringArray command{settings.router, "--input", settings.routerInput, "--output", settings.routerOutput,
+                                  "--set", "updateRate=" + updateRate, "--set", juce::String("budgetEnabled=") + (budgetEnabled ? "1" : "0")};
+
+        if (budgetEnabled)
+            command.addArray({"--set", "messageBudget=" + budget});
+
+        if (!router.start(command, 0))
+            juce::ConsoleApplication::fail("Couldn't start " + settings.router);
+
+        // The router opens its ports before it prints anything, which isn't read here
+        juce::Thread::sleep(1000);
+
+        if (!router.isRunning())
+            juce::ConsoleApplication::fail("The router exited; check --router-input and --router-output");
+
+        Histogram latency, intervals;
+        juce::Random random(7);
+
+        for (int i = 0; i < settings.numNotes; ++i)
+        {
+            auto note = 48 + random.nextInt(24);
+
+            listener.expect(note, juce::Time::getMillisecondCounterHiRes());
+            output.sendMessageNow(juce::MidiMessage::noteOn(1, note, static_cast<juce::uint8>(100)));
+            juce::Thread::sleep(settings.noteLengthMs);
+
+            output.sendMessageNow(juce::MidiMessage::noteOff(1, note));
+            juce::Thread::sleep(100);
+
+            listener.take(latency, intervals);
+        }
+
+        router.kill();
+
+        // Jitter is the distance from the interval the router was asked for
+        Histogram jitter;
+        for (auto ms : intervals.values)
+            jitter.add(std::abs(ms - updateRate.getDoubleValue()));
+
+        auto *object = new juce::DynamicObject();
+        object->setProperty("updateRateMs", updateRate.getDoubleValue());
+        object->setProperty("messageBudget", budget.getIntValue());
+        object->setProperty("notes", settings.numNotes);
+        object->setProperty("latency", latency.toVar());
+        object->setProperty("bendJitter", jitter.toVar());
+        std::cout << juce::JSON::toString(juce::var(object), true) << std::endl;
+    }
+
+    int run(const juce::ArgumentList &args)
+    {
+        ProbeSettings settings;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto arg = args[i];
+            auto nextValue = [&]
+            {
+                if (i + 1 >= args.size())
+                    juce::ConsoleApplication::fail("Missing value for " + arg.text);
+                return args[++i].text;
+            };
+
+            if (arg == "--router")
+                settings.router = nextValue();
+            else if (arg == "--send")
+                settings.send = nextValue();
+            else if (arg == "--receive")
+                settings.receive = nextValue();
+            else if (arg == "--router-input")
+                settings.routerInput = nextValue();
+            else if (arg == "--router-output")
+                settings.routerOutput = nextValue();
+            else if (arg == "--update-rates")
+                settings.updateRates = juce::StringArray::fromTokens(nextValue(), ",", {});
+            else if (arg == "--budgets")
+                settings.budgets = juce::StringArray::fromTokens(nextValue(), ",", {});
+            else if (arg == "--notes")
+                settings.numNotes = juce::jmax(1, nextValue().getIntValue());
+            else if (arg == "--note-length")
+                settings.noteLengthMs = juce::jmax(10, nextValue().getIntValue());
+            else
+                juce::ConsoleApplication::fail("Unknown option " + arg.text);
+        }
+
+        if (settings.router.isEmpty() || settings.send.isEmpty() || settings.receive.isEmpty()
+            || settings.routerInput.isEmpty() || settings.routerOutput.isEmpty())
+            juce::ConsoleApplication::fail("Usage: BetterChordStacksLatency --router <executable> --send <name> --receive <name> "
+                                           "--router-input <name> --router-output <name> [options]");
+
+        auto output = juce::MidiOutput::openDevice(findDevice(juce::MidiOutput::getAvailableDevices(), settings.send).identifier);
+        Listener listener;
+        auto input = juce::MidiInput::openDevice(findDevice(juce::MidiInput::getAvailableDevices(), settings.receive).identifier, &listener);
+
+        if (output == nullptr || input == nullptr)
+            juce::ConsoleApplication::fail("Couldn't open " + settings.send + " and " + settings.receive);
+
+        input->start();
+
+        for (auto &updateRate : settings.updateRates)
+            for (auto &budget : settings.budgets)
+                measure(settings, updateRate.trim(), budget.trim(), *output, listener);
+
+        input->stop();
+        return 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI init;
+    juce::ArgumentList args(argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return run(args); });
+}
@@ -0,0 +1,2149 @@
+#include <JuceHeader.h>
+#include <bitset>
+#include <random>
+#include "PluginProcessor.h"
+
+// Offline renderer: runs PitchBendProcessor over MIDI files without a host and writes the
+// processed MIDI, one file per thread pool job.
+//
+//   BetterChordStacksRender [options] <file.mid | folder>...
+//
+//   --output <folder>      Where to write results (default: ./rendered)
+//   --block-size <n>       Render block size in samples (default: 512)
+//   --sample-rate <hz>     Render sample rate (default: 48000)
+//   --threads <n>          Files rendered in parallel (default: one per core)
+//   --state <file>         Plugin state to load first, as saved by the plugin
+//   --set <id>=<value>     Set a parameter by ID to a real value; may be repeated
+//   --trace                Also write <name>.trace, every output event with its sample
+//                          time, for comparison with BetterChordStacksTraceDiff
+//   --log <categories>     Also write <name>.log, the audio thread's log for the given
+//                          categories ("voices,zones,timing" or "all")
+//   --phase-trace          Also write <name>.phases.json, the time each phase of every
+//                          block took, for chrome://tracing or Perfetto. Needs a build
+//                          with BCS_PHASE_TRACE.
+//   --non-realtime         Render as a host bounce does, in the offline quality mode
+//   --segments <n>         Split each file at up to n - 1 quiet points and render the
+//                          segments in parallel (default: 1). The output is the same as
+//                          rendered whole; not with --trace, --log, --phase-trace or --audio.
+//   --audio <wav | flac>   Also write <name>.wav or <name>.flac, the processed MIDI played
+//                          on the preview synth, in 24-bit stereo
+//   --coordinator <port>   Hand the files out to workers that connect on port instead of
+//                          rendering them here; MIDI output only
+//   --bind <address>       The address a coordinator listens on (default: 127.0.0.1, so
+//                          only workers on this machine); 0.0.0.0 for every interface
+//   --worker <host:port>   Render the files a coordinator hands out, --threads at a time,
+//                          in its settings, until it has none left. Takes no files.
+//   --token <secret>       The secret a coordinator and its workers share; a worker that
+//                          can't show it is handed nothing and its results are never taken.
+//                          Needed with --coordinator and --worker (default: the
+//                          BCS_RENDER_TOKEN environment variable).
+//   --job-timeout <s>      How long a coordinator waits on a file before handing it to
+//                          another worker (default: 600)
+//   --worker-wait <s>      How long a coordinator goes without a worker before rendering
+//                          what is left itself, --threads at a time (default: 60)
+//   --cache <folder>       Where results are kept for later runs to reuse, by a hash of
+//                          the input, the settings and the engine version; a folder shared
+//                          by several machines shares their results (default: the output
+//                          folder's .results). Not with --trace, --log, --phase-trace or
+//                          --audio, which always render.
+//   --no-reuse             Render every file again, replacing its cached result
+//
+// Output files hold the input's meta events (tempo, time signature, names) in track 1 and
+// the processed stream in track 2. Only the MIDI 1.0 output is written, so renders should
+// use the MPE output mode.
+//
+// Audio goes through one background writer thread shared by every render, which buffers a
+// few seconds per file, so the renders keep every core busy while the disk catches up.
+
+namespace
+{
+    struct RenderSettings
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        juce::MemoryBlock state;
+        juce::StringPairArray parameterValues;
+        juce::File outputFolder;
+        bool writeTrace = false;
+        juce::uint32 logCategories = 0;
+        bool writePhaseTrace = false;
+        bool nonRealtime = false;
+        int numSegments = 1;
+        juce::String audioFormat; // "wav", "flac", or empty for none
+        juce::TimeSliceThread *audioWriterThread = nullptr;
+    };
+
+    // Events with their bytes packed one after another in one array, so a file's worth costs
+    // two allocations rather than one per event. Every event's bytes are a whole message.
+    struct EventList
+    {
+        struct Event
+        {
+            double ticks;
+            juce::int64 sample;
+            juce::uint32 offset, size; // Of its bytes
+        };
+
+        std::vector<Event> events;
+        std::vector<juce::uint8> bytes;
+
+        void add(double ticks, juce::int64 sample, const juce::uint8 *data, size_t size)
+        {
+            events.push_back({ticks, sample, static_cast<juce::uint32>(bytes.size()), static_cast<juce::uint32>(size)});
+            bytes.insert(bytes.end(), data, data + size);
+        }
+
+        // The status byte, then the rest of the message from elsewhere
+        void addWithStatus(double ticks, juce::uint8 status, const juce::uint8 *data, size_t size)
+        {
+            events.push_back({ticks, 0, static_cast<juce::uint32>(bytes.size()), static_cast<juce::uint32>(size + 1)});
+            bytes.push_back(status);
+            bytes.insert(bytes.end(), data, data + size);
+        }
+
+        void append(const EventList &other)
+        {
+            auto base = static_cast<juce::uint32>(bytes.size());
+            bytes.insert(bytes.end(), other.bytes.begin(), other.bytes.end());
+
+            for (auto event : other.events)
+            {
+                event.offset += base;
+                events.push_back(event);
+            }
+        }
+
+        void clear()
+        {
+            events.clear();
+            bytes.clear();
+        }
+
+        const juce::uint8 *getData(const Event &event) const { return bytes.data() + event.offset; }
+    };
+
+    bool isNoteOn(const juce::uint8 *data, juce::uint32 size) { return size >= 3 && (data[0] & 0xf0) == 0x90 && data[2] != 0; }
+
+    bool isNoteOff(const juce::uint8 *data, juce::uint32 size)
+    {
+        return size >= 3 && ((data[0] & 0xf0) == 0x80 || ((data[0] & 0xf0) == 0x90 && data[2] == 0));
+    }
+
+    juce::uint32 readBigEndian(const juce::uint8 *data, int numBytes)
+    {
+        juce::uint32 value = 0;
+
+        for (int i = 0; i < numBytes; ++i)
+            value = (value << 8) | data[i];
+
+        return value;
+    }
+
+    // False if it runs past end or is longer than the four bytes allowed
+    bool readVariableLength(const juce::uint8 *&data, const juce::uint8 *end, juce::uint32 &value)
+    {
+        value = 0;
+
+        for (int i = 0; i < 4 && data < end; ++i)
+        {
+            auto byte = *data++;
+            value = (value << 7) | (byte & 0x7f);
+
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    void writeVariableLength(juce::MemoryOutputStream &out, juce::uint32 value)
+    {
+        auto buffer = value & 0x7f;
+
+        while ((value >>= 7) != 0)
+            buffer = (buffer << 8) | (value & 0x7f) | 0x80;
+
+        for (;;)
+        {
+            out.writeByte(static_cast<char>(buffer & 0xff));
+
+            if ((buffer & 0x80) == 0)
+                break;
+
+            buffer >>= 8;
+        }
+    }
+
+    // As juce::MidiMessageSequence::updateMatchedPairs does: a note-off, on the same tick, before
+    // any note-on of a key already down, for the events from first on
+    void addMatchingNoteOffs(EventList &list, size_t first)
+    {
+        std::bitset<16 * 128> down;
+        std::vector<EventList::Event> matched;
+
+        for (auto index = first; index < list.events.size(); ++index)
+        {
+            const auto &event = list.events[index];
+            const auto *data = list.getData(event);
+
+            if (isNoteOn(data, event.size))
+            {
+                auto key = static_cast<size_t>((data[0] & 0x0f) * 128 + (data[1] & 0x7f));
+
+                if (down[key])
+                {
+                    const juce::uint8 noteOff[] = {static_cast<juce::uint8>(0x80 | (data[0] & 0x0f)), data[1], 0};
+
+                    if (matched.empty())
+                        matched.assign(list.events.begin() + static_cast<std::ptrdiff_t>(first),
+                                       list.events.begin() + static_cast<std::ptrdiff_t>(index));
+
+                    matched.push_back({event.ticks, event.sample, static_cast<juce::uint32>(list.bytes.size()), 3});
+                    list.bytes.insert(list.bytes.end(), noteOff, noteOff + 3);
+                }
+
+                down[key] = true;
+            }
+            else if (isNoteOff(data, event.size))
+            {
+                down[static_cast<size_t>((data[0] & 0x0f) * 128 + (data[1] & 0x7f))] = false;
+            }
+
+            if (!matched.empty())
+                matched.push_back(list.events[index]);
+        }
+
+        // Most files have no notes struck twice, and are left as they are
+        if (!matched.empty())
+        {
+            list.events.resize(first);
+            list.events.insert(list.events.end(), matched.begin(), matched.end());
+        }
+    }
+
+    // A standard MIDI file read straight from its mapped bytes, one track chunk after another,
+    // into the form the render takes: the channel and system messages of every track in one
+    // time-ordered list, with running status expanded and system exclusive given back its
+    // 0xf0, and the meta events in another for the output and the tempo map.
+    struct MidiFileContents
+    {
+        int timeFormat = 0;
+        EventList messages;
+        EventList metaEvents; // All but the end of track
+        double endTicks = 0.0; // Of the last event of any kind, the end of track included
+
+        bool parse(const juce::uint8 *data, size_t size)
+        {
+            const auto *end = data + size;
+
+            if (size < 14 || std::memcmp(data, "MThd", 4) != 0)
+                return false;
+
+            auto headerSize = readBigEndian(data + 4, 4);
+
+            if (headerSize < 6 || headerSize > size - 8)
+                return false;
+
+            auto numChunks = readBigEndian(data + 10, 2);
+            timeFormat = static_cast<short>(readBigEndian(data + 12, 2));
+            data += 8 + headerSize;
+
+            // Messages take at least two bytes of the file, and running status adds at most one
+            messages.events.reserve(size / 2);
+            messages.bytes.reserve(size + size / 2);
+            std::vector<size_t> trackStarts;
+
+            for (juce::uint32 chunk = 0; chunk < numChunks; ++chunk)
+            {
+                if (end - data < 8)
+                    return false;
+
+                auto isTrack = std::memcmp(data, "MTrk", 4) == 0;
+                auto chunkSize = readBigEndian(data + 4, 4);
+                data += 8;
+
+                if (chunkSize > static_cast<size_t>(end - data))
+                    return false;
+
+                if (isTrack)
+                {
+                    trackStarts.push_back(messages.events.size());
+                    parseTrack(data, data + chunkSize);
+                }
+
+                data += chunkSize;
+            }
+
+            trackStarts.push_back(messages.events.size());
+
+            // Each track is in time order already. They are merged as juce::MidiMessageSequence
+            // sorts tracks added one after another: on the same tick, earlier tracks first.
+            auto byTicks = [](const EventList::Event &a, const EventList::Event &b) { return a.ticks < b.ticks; };
+            auto first = messages.events.begin();
+
+            for (size_t track = 2; track < trackStarts.size(); ++track)
+                std::inplace_merge(first, first + static_cast<std::ptrdiff_t>(trackStarts[track - 1]),
+                                   first + static_cast<std::ptrdiff_t>(trackStarts[track]), byTicks);
+
+            std::stable_sort(metaEvents.events.begin(), metaEvents.events.end(), byTicks);
+            return true;
+        }
+
+    private:
+        void parseTrack(const juce::uint8 *data, const juce::uint8 *end)
+        {
+            auto trackStart = messages.events.size();
+            double ticks = 0.0;
+            juce::uint8 runningStatus = 0;
+
+            while (data < end)
+            {
+                juce::uint32 delta;
+
+                if (!readVariableLength(data, end, delta) || data >= end)
+                    break;
+
+                ticks += delta;
+                endTicks = juce::jmax(endTicks, ticks);
+
+                auto status = *data;
+
+                if (status < 0x80)
+                    status = runningStatus;
+                else
+                    ++data;
+
+                if (status < 0x80)
+                    break;
+
+                juce::uint32 length;
+
+                if (status < 0xf0)
+                {
+                    // Channel messages are all three bytes but program change and pressure
+                    length = (status & 0xe0) == 0xc0 ? 1 : 2;
+
+                    if (static_cast<size_t>(end - data) < length)
+                        break;
+
+                    messages.addWithStatus(ticks, status, data, length);
+                    runningStatus = status;
+                }
+                else if (status == 0xf0 || status == 0xf7)
+                {
+                    if (!readVariableLength(data, end, length) || static_cast<size_t>(end - data) < length)
+                        break;
+
+                    // A 0xf7 chunk is sent as it is, a continuation or an escape
+                    if (status == 0xf0)
+                        messages.addWithStatus(ticks, status, data, length);
+                    else if (length > 0)
+                        messages.add(ticks, 0, data, length);
+                }
+                else if (status == 0xff)
+                {
+                    // Kept as juce::MidiMessage keeps them: the type and length bytes too
+                    const auto *start = data - 1;
+
+                    if (data >= end)
+                        break;
+
+                    auto type = *data++;
+
+                    if (!readVariableLength(data, end, length) || static_cast<size_t>(end - data) < length)
+                        break;
+
+                    if (type == 0x2f)
+                        break;
+
+                    data += length;
+                    metaEvents.add(ticks, 0, start, static_cast<size_t>(data - start));
+                    continue;
+                }
+                else
+                {
+                    length = status == 0xf2 ? 2 : status == 0xf1 || status == 0xf3 ? 1 : 0;
+
+                    if (static_cast<size_t>(end - data) < length)
+                        break;
+
+                    messages.addWithStatus(ticks, status, data, length);
+                }
+
+                data += length;
+            }
+
+            reorderNoteOns(trackStart);
+            addMatchingNoteOffs(messages, trackStart);
+        }
+
+        // As juce::MidiFile reads a track: on each tick, a note-on is swapped with the last
+        // note-off of the same key after it, so a note struck again isn't ended at once
+        void reorderNoteOns(size_t trackStart)
+        {
+            auto &events = messages.events;
+            auto trackEnd = events.end();
+
+            for (auto run = events.begin() + static_cast<std::ptrdiff_t>(trackStart); run != trackEnd;)
+            {
+                auto ticks = run->ticks;
+                auto runEnd = std::find_if(run, trackEnd, [ticks](const EventList::Event &event) { return event.ticks != ticks; });
+
+                for (auto it = run; it != runEnd;)
+                {
+                    auto noteOn = std::find_if(it, runEnd, [this](const EventList::Event &event)
+                                               { return isNoteOn(messages.getData(event), event.size); });
+
+                    if (noteOn == runEnd)
+                        break;
+
+                    const auto *onData = messages.getData(*noteOn);
+                    auto noteOff = runEnd;
+
+                    for (auto candidate = runEnd; candidate != noteOn + 1;)
+                    {
+                        --candidate;
+                        const auto *offData = messages.getData(*candidate);
+
+                        if (isNoteOff(offData, candidate->size) && (offData[0] & 0x0f) == (onData[0] & 0x0f) && offData[1] == onData[1])
+                        {
+                            noteOff = candidate;
+                            break;
+                        }
+                    }
+
+                    if (noteOff == runEnd)
+                        break;
+
+                    std::iter_swap(noteOn, noteOff);
+                    it = noteOn + 1;
+                }
+
+                run = runEnd;
+            }
+        }
+    };
+
+    // Written as juce::MidiFile writes a track, with running status for channel messages, into
+    // a stream with room for it already
+    void writeTrack(juce::MemoryOutputStream &out, const EventList &list)
+    {
+        out.writeIntBigEndian(static_cast<int>(juce::ByteOrder::bigEndianInt("MTrk")));
+        auto lengthPosition = out.getPosition();
+        out.writeIntBigEndian(0);
+
+        int lastTick = 0;
+        juce::uint8 lastStatus = 0;
+
+        for (size_t i = 0; i < list.events.size(); ++i)
+        {
+            const auto &event = list.events[i];
+            auto tick = juce::roundToInt(event.ticks);
+            writeVariableLength(out, static_cast<juce::uint32>(juce::jmax(0, tick - lastTick)));
+            lastTick = tick;
+
+            const auto *data = list.getData(event);
+            auto size = event.size;
+            auto status = data[0];
+
+            if (status == lastStatus && (status & 0xf0) != 0xf0 && size > 1 && i > 0)
+            {
+                ++data;
+                --size;
+            }
+            else if (status == 0xf0)
+            {
+                out.writeByte(static_cast<char>(status));
+                ++data;
+                --size;
+                writeVariableLength(out, size);
+            }
+
+            out.write(data, size);
+            lastStatus = status;
+        }
+
+        const juce::uint8 endOfTrack[] = {0x00, 0xff, 0x2f, 0x00};
+        out.write(endOfTrack, sizeof(endOfTrack));
+
+        auto trackEnd = out.getPosition();
+        out.setPosition(lengthPosition);
+        out.writeIntBigEndian(static_cast<int>(trackEnd - lengthPosition - 4));
+        out.setPosition(trackEnd);
+    }
+
+    // Conversion between seconds and ticks through the file's tempo map, built once per file
+    // as a table of constant-tempo segments. A conversion is a binary search of the table, or
+    // with a Cursor, for times that move forward, a step on from the last one.
+    class TempoMap
+    {
+        struct Segment
+        {
+            double startSeconds;
+            double startTicks;
+            double secondsPerTick;
+        };
+
+    public:
+        // Reads the file's timestamps as ticks
+        explicit TempoMap(const MidiFileContents &file)
+        {
+            auto timeFormat = file.timeFormat;
+
+            if (timeFormat <= 0)
+            {
+                // SMPTE: a fixed number of ticks per second and no tempo
+                auto framesPerSecond = -(timeFormat >> 8);
+                auto ticksPerFrame = timeFormat & 0xff;
+                segments.push_back({0.0, 0.0, 1.0 / (framesPerSecond * ticksPerFrame)});
+                return;
+            }
+
+            ticksPerQuarterNote = timeFormat;
+            segments.push_back({0.0, 0.0, 0.5 / ticksPerQuarterNote}); // 120 bpm until told otherwise
+
+            for (const auto &event : file.metaEvents.events)
+            {
+                // Type, length, then the microseconds per quarter note in three bytes
+                const auto *data = file.metaEvents.getData(event);
+
+                if (event.size < 6 || data[1] != 0x51 || data[2] != 3)
+                    continue;
+
+                auto secondsPerQuarterNote = static_cast<double>(readBigEndian(data + 3, 3)) / 1000000.0;
+                auto seconds = toSeconds(segments.back(), event.ticks);
+
+                segments.push_back({seconds, event.ticks, secondsPerQuarterNote / ticksPerQuarterNote});
+            }
+        }
+
+        double secondsToTicks(double seconds) const
+        {
+            return toTicks(segments[findSegment(seconds, &Segment::startSeconds)], seconds);
+        }
+
+        double ticksToSeconds(double ticks) const
+        {
+            return toSeconds(segments[findSegment(ticks, &Segment::startTicks)], ticks);
+        }
+
+        double getBpmAt(double seconds) const
+        {
+            if (ticksPerQuarterNote <= 0)
+                return 120.0;
+
+            return 60.0 / (segments[findSegment(seconds, &Segment::startSeconds)].secondsPerTick * ticksPerQuarterNote);
+        }
+
+        // Converts times that mostly rise, like a render's events in order, by walking on from
+        // the segment the last one was in; only a step back searches
+        class Cursor
+        {
+        public:
+            explicit Cursor(const TempoMap &map) : tempoMap(map) {}
+
+            double secondsToTicks(double seconds) { return toTicks(seek(seconds, &Segment::startSeconds), seconds); }
+            double ticksToSeconds(double ticks) { return toSeconds(seek(ticks, &Segment::startTicks), ticks); }
+
+        private:
+            const Segment &seek(double time, double Segment::*start)
+            {
+                const auto &segments = tempoMap.segments;
+
+                if (time < segments[index].*start)
+                    index = tempoMap.findSegment(time, start);
+
+                while (index + 1 < segments.size() && segments[index + 1].*start <= time)
+                    ++index;
+
+                return segments[index];
+            }
+
+            const TempoMap &tempoMap;
+            size_t index = 0;
+        };
+
+    private:
+        static double toTicks(const Segment &segment, double seconds)
+        {
+            return segment.startTicks + (seconds - segment.startSeconds) / segment.secondsPerTick;
+        }
+
+        static double toSeconds(const Segment &segment, double ticks)
+        {
+            return segment.startSeconds + (ticks - segment.startTicks) * segment.secondsPerTick;
+        }
+
+        // The segment holding time, measured by start; times before the first are in it
+        size_t findSegment(double time, double Segment::*start) const
+        {
+            auto next = std::upper_bound(segments.begin() + 1, segments.end(), time,
+                                         [start](double t, const Segment &segment) { return t < segment.*start; });
+            return static_cast<size_t>(next - segments.begin()) - 1;
+        }
+
+        std::vector<Segment> segments;
+        int ticksPerQuarterNote = 0;
+    };
+
+    // Tells the processor the tempo of the file at the block being rendered, for tempo sync
+    class RenderPlayHead : public juce::AudioPlayHead
+    {
+    public:
+        RenderPlayHead(const TempoMap &map, double rate) : tempoMap(map), sampleRate(rate) {}
+
+        void setTimeInSamples(juce::int64 newTime) { timeInSamples = newTime; }
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            auto seconds = static_cast<double>(timeInSamples) / sampleRate;
+
+            PositionInfo info;
+            info.setTimeInSamples(timeInSamples);
+            info.setTimeInSeconds(seconds);
+            info.setBpm(tempoMap.getBpmAt(seconds));
+            info.setIsPlaying(true);
+            return info;
+        }
+
+    private:
+        const TempoMap &tempoMap;
+        double sampleRate;
+        juce::int64 timeInSamples = 0;
+    };
+
+    // Long enough for the last bend to reach its target after the final input event
+    constexpr double renderTailSeconds = 2.5;
+
+    // For reserving the output: bends on a handful of voices at a typical update rate
+    constexpr double expectedOutputEventsPerSecond = 1000.0;
+
+    void applySettings(PitchBendProcessor &processor, const RenderSettings &settings)
+    {
+        processor.setNonRealtime(settings.nonRealtime);
+
+        if (settings.state.getSize() > 0)
+            processor.setStateInformation(settings.state.getData(), static_cast<int>(settings.state.getSize()));
+
+        for (auto &id : settings.parameterValues.getAllKeys())
+        {
+            if (auto *parameter = processor.parameters.getParameter(id))
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(settings.parameterValues[id].getFloatValue()));
+        }
+    }
+
+    // A file's input, with each event's sample time
+    struct RenderInput
+    {
+        EventList events;
+        juce::int64 lengthInSamples = 0;
+        int latency = 0;
+    };
+
+    // A processor set up for rendering, following its own play head
+    struct RenderInstance
+    {
+        RenderInstance(const TempoMap &tempoMap, const RenderSettings &renderSettings)
+            : settings(renderSettings), playHead(tempoMap, renderSettings.sampleRate)
+        {
+            applySettings(processor, settings);
+            processor.setPlayHead(&playHead);
+            processor.setRateAndBufferSizeDetails(settings.sampleRate, settings.blockSize);
+            processor.prepareToPlay(settings.sampleRate, settings.blockSize);
+        }
+
+        ~RenderInstance()
+        {
+            processor.releaseResources();
+            processor.setPlayHead(nullptr);
+        }
+
+        // Takes up at the checkpoint's sample in its state. A few empty blocks go first, whose
+        // output is dropped, so the parameters are taken and the zone configuration sent.
+        void resume(const PitchBendProcessor::EngineCheckpoint &checkpoint)
+        {
+            prime(checkpoint.sampleClock);
+            processor.restoreCheckpoint(checkpoint);
+        }
+
+        // Takes up at sample as if nothing had been played before it; false if the processor
+        // can't be checkpointed in these settings
+        bool resumeIdle(juce::int64 sample)
+        {
+            PitchBendProcessor::EngineCheckpoint idle;
+            prime(sample);
+
+            if (!processor.saveCheckpoint(idle))
+                return false;
+
+            idle.sampleClock = sample;
+            processor.restoreCheckpoint(idle);
+            return true;
+        }
+
+        const RenderSettings &settings;
+        RenderPlayHead playHead;
+        PitchBendProcessor processor;
+
+    private:
+        static constexpr int maxPrimingBlocks = 64;
+
+        void prime(juce::int64 sample)
+        {
+            juce::AudioBuffer<float> buffer(2, settings.blockSize);
+            juce::MidiBuffer midi;
+
+            playHead.setTimeInSamples(sample - settings.blockSize);
+
+            for (int i = 0; i < maxPrimingBlocks && (i == 0 || !processor.isQuiet()); ++i)
+            {
+                midi.clear();
+                processor.processBlock(buffer, midi);
+            }
+        }
+    };
+
+    // Samples each file's audio writer holds for the background thread
+    constexpr double audioBufferSeconds = 4.0;
+
+    // A writer feeding file from the shared background thread, or null if it can't be made
+    std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> createAudioWriter(const juce::File &file, const RenderSettings &settings)
+    {
+        std::unique_ptr<juce::AudioFormat> format;
+
+        if (settings.audioFormat == "flac")
+            format = std::make_unique<juce::FlacAudioFormat>();
+        else
+            format = std::make_unique<juce::WavAudioFormat>();
+
+        auto fileStream = std::make_unique<juce::FileOutputStream>(file);
+
+        if (!fileStream->openedOk())
+            return nullptr;
+
+        std::unique_ptr<juce::OutputStream> stream = std::move(fileStream);
+        auto writer = format->createWriterFor(stream, juce::AudioFormatWriterOptions{}
+                                                          .withSampleRate(settings.sampleRate)
+                                                          .withNumChannels(2)
+                                                          .withBitsPerSample(24));
+
+        if (writer == nullptr)
+            return nullptr;
+
+        return std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(writer.release(), *settings.audioWriterThread,
+                                                                         juce::roundToInt(audioBufferSeconds * settings.sampleRate));
+    }
+
+    // Renders the blocks from one sample up to another, both block aligned, adding the output
+    // to output and the preview synth's audio to audioOutput where they aren't null
+    void renderBlocks(RenderInstance &instance, const RenderInput &input, const TempoMap &tempoMap,
+                      juce::int64 from, juce::int64 to, EventList *output,
+                      juce::AudioFormatWriter::ThreadedWriter *audioOutput = nullptr)
+    {
+        auto &processor = instance.processor;
+        const auto &settings = instance.settings;
+        auto &traceRecorder = processor.getTraceRecorder();
+        auto &realtimeLog = processor.getRealtimeLog();
+        auto &phaseTracer = processor.getPhaseTracer();
+
+        juce::AudioBuffer<float> buffer(2, settings.blockSize);
+        juce::MidiBuffer midi;
+
+        const auto &events = input.events.events;
+        auto nextEvent = std::lower_bound(events.begin(), events.end(), from,
+                                          [](const EventList::Event &event, juce::int64 sample) { return event.sample < sample; });
+        TempoMap::Cursor outputTime(tempoMap);
+
+        for (auto blockStart = from; blockStart < to; blockStart += settings.blockSize)
+        {
+            auto blockEnd = blockStart + settings.blockSize;
+            midi.clear();
+
+            for (; nextEvent != events.end() && nextEvent->sample < blockEnd; ++nextEvent)
+                midi.addEvent(input.events.getData(*nextEvent), static_cast<int>(nextEvent->size),
+                              static_cast<int>(juce::jmax(static_cast<juce::int64>(0), nextEvent->sample - blockStart)));
+
+            // The audio input stays silent, whatever the synth played into the buffer last block
+            buffer.clear();
+            instance.playHead.setTimeInSamples(blockStart);
+            processor.processBlock(buffer, midi);
+
+            if (audioOutput != nullptr)
+            {
+                // Moved back by the latency like the MIDI. A full buffer means the disk is
+                // behind, and the render waits for it rather than drop audio.
+                auto skip = static_cast<int>(juce::jlimit(static_cast<juce::int64>(0), static_cast<juce::int64>(settings.blockSize),
+                                                          input.latency - blockStart));
+                const float *channels[] = {buffer.getReadPointer(0, skip), buffer.getReadPointer(1, skip)};
+
+                if (skip < settings.blockSize)
+                    while (!audioOutput->write(channels, settings.blockSize - skip))
+                        juce::Thread::sleep(1);
+            }
+
+            // Rendering runs far ahead of the trace and log writers, so their rings are emptied every block
+            traceRecorder.waitUntilWritten();
+            realtimeLog.waitUntilWritten();
+
+            if (settings.writePhaseTrace)
+                phaseTracer.collect();
+
+            if (output == nullptr)
+                continue;
+
+            // Built straight from the buffer's bytes, already stamped with their tick. Output is
+            // moved back by the reported latency, as a host would compensate for it.
+            for (const auto metadata : midi)
+            {
+                auto sample = juce::jmax(static_cast<juce::int64>(0), blockStart + metadata.samplePosition - input.latency);
+                auto seconds = static_cast<double>(sample) / settings.sampleRate;
+                output->add(outputTime.secondsToTicks(seconds), sample, metadata.data, static_cast<size_t>(metadata.numBytes));
+            }
+        }
+    }
+
+    // Block-aligned samples where the input has gone quiet for long enough that nothing
+    // should still be sounding or waiting, with nothing held and the next event no earlier
+    std::vector<juce::int64> findQuietPoints(const RenderInput &input, const RenderSettings &settings)
+    {
+        std::vector<juce::int64> points;
+        std::array<std::array<juce::uint8, 128>, 16> held{};
+        int numHeld = 0;
+        juce::uint32 pedals = 0;
+        auto settleSamples = static_cast<juce::int64>(std::ceil(renderTailSeconds * settings.sampleRate)) + input.latency;
+        auto blockSize = static_cast<juce::int64>(settings.blockSize);
+        juce::int64 lastSample = -1;
+
+        for (const auto &event : input.events.events)
+        {
+            auto sample = event.sample;
+            auto point = (lastSample + settleSamples + blockSize - 1) / blockSize * blockSize;
+
+            if (lastSample >= 0 && numHeld == 0 && pedals == 0 && point <= sample)
+                points.push_back(point);
+
+            lastSample = sample;
+
+            const auto *data = input.events.getData(event);
+
+            if (event.size < 3 || data[0] >= 0xf0)
+                continue;
+
+            auto channel = static_cast<size_t>(data[0] & 0x0f);
+            auto &count = held[channel][static_cast<size_t>(data[1] & 0x7f)];
+
+            if (isNoteOn(data, event.size))
+            {
+                ++count;
+                ++numHeld;
+            }
+            else if (isNoteOff(data, event.size) && count > 0)
+            {
+                --count;
+                --numHeld;
+            }
+            else if ((data[0] & 0xf0) == 0xb0 && data[1] == 64)
+            {
+                if (data[2] >= 64)
+                    pedals |= 1u << channel;
+                else
+                    pedals &= ~(1u << channel);
+            }
+        }
+
+        return points;
+    }
+
+    // Each segment is rendered by its own instance, which first plays from an earlier quiet
+    // point so its channel rotation and receiver state are likely to have come round to
+    // where the segment before leaves them. The guess is checked against the state that
+    // segment really ended in, and a segment that guessed wrong is rendered again from it.
+    struct RenderSegment
+    {
+        juce::int64 warmupStart = 0, start = 0, end = 0;
+        PitchBendProcessor::EngineCheckpoint startState, endState;
+        bool hasStartState = false, hasEndState = false;
+        EventList output;
+    };
+
+    // How far back before its start a segment begins playing, at least
+    constexpr double segmentWarmupSeconds = 10.0;
+
+    // Renders a segment from the given state at its start, or, with none, from its warm-up
+    // start as if nothing had been played before
+    void renderSegment(RenderSegment &segment, const PitchBendProcessor::EngineCheckpoint *startState,
+                       const RenderInput &input, const TempoMap &tempoMap, const RenderSettings &settings)
+    {
+        RenderInstance instance(tempoMap, settings);
+        segment.output.clear();
+
+        if (startState != nullptr)
+        {
+            instance.resume(*startState);
+            segment.startState = *startState;
+            segment.hasStartState = true;
+        }
+        else
+        {
+            auto canResume = segment.warmupStart == 0 || instance.resumeIdle(segment.warmupStart);
+            renderBlocks(instance, input, tempoMap, segment.warmupStart, segment.start, nullptr);
+            segment.hasStartState = canResume && instance.processor.saveCheckpoint(segment.startState);
+        }
+
+        renderBlocks(instance, input, tempoMap, segment.start, segment.end, &segment.output);
+        segment.hasEndState = instance.processor.saveCheckpoint(segment.endState);
+    }
+
+    void renderSegmented(const RenderInput &input, const TempoMap &tempoMap, const RenderSettings &settings,
+                         EventList &output)
+    {
+        auto quietPoints = findQuietPoints(input, settings);
+        std::vector<RenderSegment> segments(1);
+
+        // Splits at the quiet points nearest to equal lengths
+        for (int i = 1; i < settings.numSegments && !quietPoints.empty(); ++i)
+        {
+            auto target = input.lengthInSamples * i / settings.numSegments;
+            auto nearest = std::min_element(quietPoints.begin(), quietPoints.end(),
+                                            [target](juce::int64 a, juce::int64 b) { return std::abs(a - target) < std::abs(b - target); });
+
+            if (*nearest > segments.back().start && *nearest < input.lengthInSamples)
+            {
+                segments.back().end = *nearest;
+                segments.emplace_back().start = *nearest;
+            }
+        }
+
+        segments.back().end = input.lengthInSamples;
+
+        auto warmupSamples = static_cast<juce::int64>(segmentWarmupSeconds * settings.sampleRate);
+
+        for (size_t i = 1; i < segments.size(); ++i)
+        {
+            auto &segment = segments[i];
+            segment.warmupStart = segments[i - 1].start;
+
+            for (auto point : quietPoints)
+                if (point > segment.warmupStart && point <= segment.start - warmupSamples)
+                    segment.warmupStart = point;
+        }
+
+        {
+            juce::ThreadPool pool(static_cast<int>(segments.size()));
+
+            for (auto &segment : segments)
+                pool.addJob([&, job = &segment] { renderSegment(*job, nullptr, input, tempoMap, settings); });
+
+            while (pool.getNumJobs() > 0)
+                juce::Thread::sleep(1);
+        }
+
+        for (size_t i = 1; i < segments.size();)
+        {
+            const auto &previous = segments[i - 1];
+            auto &segment = segments[i];
+
+            if (previous.hasEndState && segment.hasStartState && previous.endState == segment.startState)
+            {
+                ++i;
+            }
+            else if (previous.hasEndState)
+            {
+                renderSegment(segment, &previous.endState, input, tempoMap, settings);
+                ++i;
+            }
+            else
+            {
+                // The segment before never came to rest, so the two become one, rendered from
+                // the state the first really started in
+                segments[i - 1].end = segment.end;
+                segments.erase(segments.begin() + static_cast<std::ptrdiff_t>(i));
+                renderSegment(segments[i - 1], i > 1 ? &segments[i - 2].endState : nullptr, input, tempoMap, settings);
+            }
+        }
+
+        for (const auto &segment : segments)
+            output.append(segment.output);
+    }
+
+    // Returns the rendered length in seconds
+    double renderFile(const juce::File &inputFile, const RenderSettings &settings)
+    {
+        // Mapped rather than read, and parsed where it lies
+        MidiFileContents file;
+
+        {
+            juce::MemoryMappedFile mapping(inputFile, juce::MemoryMappedFile::readOnly);
+
+            if (mapping.getData() == nullptr || !file.parse(static_cast<const juce::uint8 *>(mapping.getData()), mapping.getSize()))
+                juce::ConsoleApplication::fail("Couldn't read " + inputFile.getFullPathName());
+        }
+
+        TempoMap tempoMap(file);
+
+        // The events keep their ticks; their samples come from the tempo map in one pass, as
+        // the merged tracks are in time order. Meta events keep their tick times in the output.
+        RenderInput input;
+        input.events = std::move(file.messages);
+        TempoMap::Cursor inputTime(tempoMap);
+
+        for (auto &event : input.events.events)
+            event.sample = static_cast<juce::int64>(std::llround(inputTime.ticksToSeconds(event.ticks) * settings.sampleRate));
+
+        // Room for about as much output as a busy render makes for its length
+        EventList output;
+        auto lengthInSeconds = tempoMap.ticksToSeconds(file.endTicks) + renderTailSeconds;
+        auto expectedEvents = static_cast<size_t>(lengthInSeconds * expectedOutputEventsPerSecond) + input.events.events.size() * 2;
+        output.events.reserve(expectedEvents);
+        output.bytes.reserve(expectedEvents * 3);
+
+        if (settings.numSegments > 1)
+        {
+            // The latency is fixed by the settings, so any instance tells it
+            input.latency = RenderInstance(tempoMap, settings).processor.getLatencySamples();
+            input.lengthInSamples = static_cast<juce::int64>(std::ceil(lengthInSeconds * settings.sampleRate)) + input.latency;
+            renderSegmented(input, tempoMap, settings, output);
+        }
+        else
+        {
+            RenderInstance instance(tempoMap, settings);
+            auto &processor = instance.processor;
+            input.latency = processor.getLatencySamples();
+            input.lengthInSamples = static_cast<juce::int64>(std::ceil(lengthInSeconds * settings.sampleRate)) + input.latency;
+
+            auto &traceRecorder = processor.getTraceRecorder();
+            auto traceFile = settings.outputFolder.getChildFile(inputFile.getFileNameWithoutExtension() + ".trace");
+
+            if (settings.writeTrace && !traceRecorder.start(traceFile))
+                juce::ConsoleApplication::fail("Couldn't write " + traceFile.getFullPathName());
+
+            auto &realtimeLog = processor.getRealtimeLog();
+            auto logFile = settings.outputFolder.getChildFile(inputFile.getFileNameWithoutExtension() + ".log");
+
+            if (settings.logCategories != 0)
+            {
+                logFile.deleteFile();
+
+                if (!realtimeLog.start(logFile, settings.logCategories))
+                    juce::ConsoleApplication::fail("Couldn't write " + logFile.getFullPathName());
+            }
+
+            auto &phaseTracer = processor.getPhaseTracer();
+
+            if (settings.writePhaseTrace)
+                phaseTracer.start();
+
+            // Written to a temporary file like the MIDI, and moved over it once the writer
+            // has flushed the rest
+            std::unique_ptr<juce::TemporaryFile> audioTemp;
+            std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> audioWriter;
+
+            if (settings.audioFormat.isNotEmpty())
+            {
+                audioTemp = std::make_unique<juce::TemporaryFile>(
+                    settings.outputFolder.getChildFile(inputFile.getFileNameWithoutExtension() + "." + settings.audioFormat));
+                audioWriter = createAudioWriter(audioTemp->getFile(), settings);
+
+                if (audioWriter == nullptr)
+                    juce::ConsoleApplication::fail("Couldn't write " + audioTemp->getTargetFile().getFullPathName());
+            }
+
+            renderBlocks(instance, input, tempoMap, 0, input.lengthInSamples, &output, audioWriter.get());
+
+            traceRecorder.stop();
+            realtimeLog.stop();
+
+            if (audioWriter != nullptr)
+            {
+                audioWriter.reset();
+
+                if (!audioTemp->overwriteTargetFileWithTemporary())
+                    juce::ConsoleApplication::fail("Couldn't write " + audioTemp->getTargetFile().getFullPathName());
+            }
+
+            if (settings.writePhaseTrace)
+            {
+                phaseTracer.stop();
+                auto phaseFile = settings.outputFolder.getChildFile(inputFile.getFileNameWithoutExtension() + ".phases.json");
+
+                if (!phaseTracer.writeChromeTrace(phaseFile))
+                    juce::ConsoleApplication::fail("Couldn't write " + phaseFile.getFullPathName());
+            }
+        }
+
+        addMatchingNoteOffs(output, 0);
+
+        // A type 1 file of the meta events and the output, built whole in a buffer sized for
+        // it and written in one go: each event takes at most its bytes, a four-byte delta and
+        // a sysex length
+        juce::MemoryOutputStream result(64 + file.metaEvents.bytes.size() + output.bytes.size()
+                                        + (file.metaEvents.events.size() + output.events.size()) * 8);
+        result.writeIntBigEndian(static_cast<int>(juce::ByteOrder::bigEndianInt("MThd")));
+        result.writeIntBigEndian(6);
+        result.writeShortBigEndian(1);
+        result.writeShortBigEndian(2);
+        result.writeShortBigEndian(static_cast<short>(file.timeFormat));
+        writeTrack(result, file.metaEvents);
+        writeTrack(result, output);
+
+        // Written to a temporary file first so a failed render never leaves half a file
+        juce::TemporaryFile temp(settings.outputFolder.getChildFile(inputFile.getFileName()));
+
+        if (!temp.getFile().replaceWithData(result.getData(), result.getDataSize()) || !temp.overwriteTargetFileWithTemporary())
+            juce::ConsoleApplication::fail("Couldn't write " + temp.getTargetFile().getFullPathName());
+
+        return lengthInSeconds;
+    }
+
+    void addInputs(const juce::File &fileOrFolder, juce::Array<juce::File> &inputs)
+    {
+        if (fileOrFolder.isDirectory())
+            inputs.addArray(fileOrFolder.findChildFiles(juce::File::findFiles, true, "*.mid;*.midi"));
+        else if (fileOrFolder.existsAsFile())
+            inputs.add(fileOrFolder);
+        else
+            juce::ConsoleApplication::fail("No such file or folder: " + fileOrFolder.getFullPathName());
+    }
+
+    // Distributed rendering. A coordinator holds the file list and hands each file out as a
+    // job to worker processes on any number of machines. A worker opens one connection per
+    // thread, takes the coordinator's settings on each, and renders a file at a time on it,
+    // so a run scales with the workers' threads as long as there are more files than them.
+    //
+    // Results go into the RenderCache, and a file rendered before in the same settings, on
+    // any run, is copied from there rather than handed out.
+    // A job its worker fails, or that is lost with the connection or passes --job-timeout,
+    // goes back on the queue for another, up to maxJobAttempts in all.
+    //
+    // On the connection each frame is a magic number, its type and its length, then that
+    // many bytes.
+    //
+    // A connection starts with the coordinator's challenge, 32 random bytes, which the worker
+    // answers with the SHA-256 of those bytes followed by the shared token, so the token itself
+    // never goes over the connection. Only a worker whose answer matches gets the settings and
+    // jobs, and until then a frame longer than an answer ends the connection, so a stranger can
+    // neither feed results into the cache nor make the coordinator buffer much.
+    constexpr juce::uint32 frameMagic = 0x52534342; // "BCSR"
+    constexpr juce::int64 maxFrameBytes = 256 * 1024 * 1024;
+    constexpr int maxJobAttempts = 3;
+    constexpr int workerConnectSeconds = 30;
+    constexpr int handshakeTimeoutMs = 10000;
+    constexpr size_t challengeBytes = 32;
+
+    // Bumped whenever the same input in the same settings renders differently, so results
+    // from older builds aren't reused and older workers aren't taken on
+    constexpr int resultsVersion = 1;
+
+    enum class FrameType : juce::uint32
+    {
+        settings = 1, // Coordinator to worker, once on each connection
+        job,          // Coordinator to worker: job index, file name, file
+        result,       // Worker to coordinator: job index, success, seconds rendered, file
+        finished,     // Coordinator to worker: nothing left
+        challenge,    // Coordinator to worker, first on each connection: random bytes
+        answer        // Worker to coordinator: the challenge's answer for the token
+    };
+
+    bool writeAll(juce::StreamingSocket &socket, const void *data, size_t size)
+    {
+        auto *bytes = static_cast<const char *>(data);
+
+        while (size > 0)
+        {
+            auto written = socket.write(bytes, static_cast<int>(juce::jmin(size, static_cast<size_t>(1 << 20))));
+
+            if (written <= 0)
+                return false;
+
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+
+        return true;
+    }
+
+    bool sendFrame(juce::StreamingSocket &socket, FrameType type, const juce::MemoryBlock &payload)
+    {
+        juce::MemoryOutputStream header;
+        header.writeInt(static_cast<int>(frameMagic));
+        header.writeInt(static_cast<int>(type));
+        header.writeInt64(static_cast<juce::int64>(payload.getSize()));
+
+        return writeAll(socket, header.getData(), header.getDataSize()) && writeAll(socket, payload.getData(), payload.getSize());
+    }
+
+    // Waits up to timeoutMs for the frame to begin, or for as long as it takes if negative
+    bool receiveFrame(juce::StreamingSocket &socket, FrameType &type, juce::MemoryBlock &payload, int timeoutMs = -1,
+                      juce::int64 maxBytes = maxFrameBytes)
+    {
+        char header[16];
+
+        if (socket.waitUntilReady(true, timeoutMs) != 1 || socket.read(header, sizeof(header), true) != static_cast<int>(sizeof(header)))
+            return false;
+
+        juce::MemoryInputStream in(header, sizeof(header), false);
+
+        if (static_cast<juce::uint32>(in.readInt()) != frameMagic)
+            return false;
+
+        type = static_cast<FrameType>(in.readInt());
+        auto size = in.readInt64();
+
+        if (size < 0 || size > maxBytes)
+            return false;
+
+        payload.setSize(static_cast<size_t>(size));
+        return size == 0 || socket.read(payload.getData(), static_cast<int>(size), true) == static_cast<int>(size);
+    }
+
+    juce::MemoryBlock makeChallenge()
+    {
+        std::random_device source;
+        juce::MemoryBlock challenge(challengeBytes);
+
+        for (size_t i = 0; i < challengeBytes; ++i)
+            challenge[i] = static_cast<char>(source() & 0xff);
+
+        return challenge;
+    }
+
+    juce::MemoryBlock answerChallenge(const juce::MemoryBlock &challenge, const juce::String &token)
+    {
+        juce::MemoryBlock data(challenge);
+        data.append(token.toRawUTF8(), token.getNumBytesAsUTF8());
+        return juce::SHA256(data).getRawData();
+    }
+
+    // Compares every byte whatever the first difference, so the time taken says nothing of
+    // how much of an answer was right
+    bool isRightAnswer(const juce::MemoryBlock &challenge, const juce::String &token, const juce::MemoryBlock &answer)
+    {
+        auto expected = answerChallenge(challenge, token);
+
+        if (answer.getSize() != expected.getSize())
+            return false;
+
+        juce::uint8 difference = 0;
+
+        for (size_t i = 0; i < expected.getSize(); ++i)
+            difference |= static_cast<juce::uint8>(expected[i] ^ answer[i]);
+
+        return difference == 0;
+    }
+
+    // What a worker needs of the settings; the rest are the coordinator's own
+    juce::MemoryBlock writeSettings(const RenderSettings &settings)
+    {
+        juce::MemoryOutputStream out;
+        out.writeInt(resultsVersion);
+        out.writeDouble(settings.sampleRate);
+        out.writeInt(settings.blockSize);
+        out.writeBool(settings.nonRealtime);
+        out.writeInt(settings.numSegments);
+        out.writeInt64(static_cast<juce::int64>(settings.state.getSize()));
+        out << settings.state;
+
+        auto ids = settings.parameterValues.getAllKeys();
+        out.writeInt(ids.size());
+
+        for (auto &id : ids)
+        {
+            out.writeString(id);
+            out.writeString(settings.parameterValues[id]);
+        }
+
+        return out.getMemoryBlock();
+    }
+
+    bool readSettings(const juce::MemoryBlock &data, RenderSettings &settings)
+    {
+        juce::MemoryInputStream in(data, false);
+
+        if (in.readInt() != resultsVersion)
+            return false;
+
+        settings.sampleRate = in.readDouble();
+        settings.blockSize = in.readInt();
+        settings.nonRealtime = in.readBool();
+        settings.numSegments = in.readInt();
+
+        auto stateSize = in.readInt64();
+
+        if (stateSize < 0 || stateSize > in.getNumBytesRemaining())
+            return false;
+
+        settings.state.reset();
+        in.readIntoMemoryBlock(settings.state, static_cast<juce::pointer_sized_int>(stateSize));
+
+        for (auto numValues = in.readInt(); numValues > 0 && !in.isExhausted(); --numValues)
+        {
+            auto id = in.readString();
+            settings.parameterValues.set(id, in.readString());
+        }
+
+        return settings.sampleRate >= 8000.0 && settings.blockSize > 0 && settings.numSegments > 0;
+    }
+
+    // Earlier results, for any later run pointed at the same folder, on this machine or
+    // another, to reuse. Each is kept as <key>.mid, where the key is the SHA-256 of the
+    // settings as writeSettings gives them, resultsVersion among them, and of the SHA-256 of
+    // the input's bytes; a file is rendered again only if it, the plugin state, a parameter or
+    // the engine changed.
+    //
+    // The folder's index file holds each input's hash with the size and modification time it
+    // had when hashed, 56 bytes an input, so an unchanged library is looked up without reading
+    // it. Inputs it doesn't know, or that have changed, are hashed through a mapping of them,
+    // on whichever thread asks for their key. Each run merges what it hashed into the index
+    // on disk when it finishes; runs finishing at once may lose each other's entries, which
+    // costs only hashing those inputs again.
+    class RenderCache
+    {
+    public:
+        using Key = std::array<juce::uint8, 32>;
+
+        explicit RenderCache(const juce::File &cacheFolder) : folder(cacheFolder) { readIndex(inputs); }
+
+        const juce::File &getFolder() const { return folder; }
+
+        // Any thread. False if the input couldn't be read.
+        bool getKey(const juce::MemoryBlock &settings, const juce::File &input, Key &key)
+        {
+            auto pathHash = hashPath(input.getFullPathName());
+            InputEntry entry{input.getSize(), input.getLastModificationTime().toMilliseconds(), {}};
+            auto found = inputs.find(pathHash);
+
+            if (found != inputs.end() && found->second.size == entry.size && found->second.modified == entry.modified)
+            {
+                entry.digest = found->second.digest;
+            }
+            else
+            {
+                juce::MemoryMappedFile mapping(input, juce::MemoryMappedFile::readOnly);
+
+                if (mapping.getData() == nullptr)
+                    return false;
+
+                copyDigest(juce::SHA256(mapping.getData(), mapping.getSize()), entry.digest);
+
+                const juce::ScopedLock sl(lock);
+                hashed[pathHash] = entry;
+            }
+
+            juce::MemoryOutputStream keyData(settings.getSize() + entry.digest.size());
+            keyData << settings;
+            keyData.write(entry.digest.data(), entry.digest.size());
+            copyDigest(juce::SHA256(keyData.getData(), keyData.getDataSize()), key);
+            return true;
+        }
+
+        // Any thread: the result stored under key, copied to destination; false if there is none
+        bool restore(const Key &key, const juce::File &destination) const
+        {
+            auto stored = getResultFile(key);
+            juce::TemporaryFile temp(destination);
+            return stored.existsAsFile() && stored.copyFileTo(temp.getFile()) && temp.overwriteTargetFileWithTemporary();
+        }
+
+        // Any thread, each through a temporary file so a result is never half written
+        bool store(const Key &key, const void *data, size_t size) const
+        {
+            juce::TemporaryFile temp(getResultFile(key));
+            return size > 0 && temp.getFile().replaceWithData(data, size) && temp.overwriteTargetFileWithTemporary();
+        }
+
+        bool store(const Key &key, const juce::File &result) const
+        {
+            juce::TemporaryFile temp(getResultFile(key));
+            return result.copyFileTo(temp.getFile()) && temp.overwriteTargetFileWithTemporary();
+        }
+
+        // Once the run's keys are all taken
+        bool writeIndex()
+        {
+            const juce::ScopedLock sl(lock);
+
+            if (hashed.empty())
+                return true;
+
+            // Over what other runs have written since this one read it
+            std::unordered_map<juce::uint64, InputEntry> entries;
+            readIndex(entries);
+
+            for (auto &[pathHash, entry] : hashed)
+                entries[pathHash] = entry;
+
+            juce::TemporaryFile temp(folder.getChildFile(indexFileName));
+
+            {
+                juce::FileOutputStream stream(temp.getFile());
+
+                if (!stream.openedOk())
+                    return false;
+
+                stream.writeInt(static_cast<int>(indexMagic));
+                stream.writeInt(indexVersion);
+                stream.writeInt(static_cast<int>(entries.size()));
+
+                for (auto &[pathHash, entry] : entries)
+                {
+                    stream.writeInt64(static_cast<juce::int64>(pathHash));
+                    stream.writeInt64(entry.size);
+                    stream.writeInt64(entry.modified);
+                    stream.write(entry.digest.data(), entry.digest.size());
+                }
+
+                stream.flush();
+
+                if (stream.getStatus().failed())
+                    return false;
+            }
+
+            return temp.overwriteTargetFileWithTemporary();
+        }
+
+    private:
+        struct InputEntry
+        {
+            juce::int64 size = 0;
+            juce::int64 modified = 0;
+            Key digest{}; // Of its bytes
+        };
+
+        static constexpr const char *indexFileName = "index";
+        static constexpr juce::uint32 indexMagic = 0x43534342; // "BCSC"
+        static constexpr int indexVersion = 1;
+        static constexpr juce::int64 indexEntryBytes = 56;
+
+        juce::File getResultFile(const Key &key) const { return folder.getChildFile(juce::String::toHexString(key.data(), static_cast<int>(key.size()), 0) + ".mid"); }
+
+        static void copyDigest(const juce::SHA256 &sha, Key &digest)
+        {
+            auto raw = sha.getRawData();
+            std::memcpy(digest.data(), raw.getData(), digest.size());
+        }
+
+        // FNV-1a over the path's UTF-8
+        static juce::uint64 hashPath(const juce::String &path)
+        {
+            juce::uint64 hash = 14695981039346656037ull;
+
+            for (auto *c = path.toRawUTF8(); *c != 0; ++c)
+                hash = (hash ^ static_cast<juce::uint8>(*c)) * 1099511628211ull;
+
+            return hash;
+        }
+
+        void readIndex(std::unordered_map<juce::uint64, InputEntry> &entries) const
+        {
+            juce::FileInputStream stream(folder.getChildFile(indexFileName));
+
+            if (!stream.openedOk() || static_cast<juce::uint32>(stream.readInt()) != indexMagic || stream.readInt() != indexVersion)
+                return;
+
+            auto numEntries = stream.readInt();
+
+            if (numEntries < 0 || numEntries > stream.getNumBytesRemaining() / indexEntryBytes)
+                return;
+
+            entries.reserve(entries.size() + static_cast<size_t>(numEntries));
+
+            for (int i = 0; i < numEntries; ++i)
+            {
+                auto pathHash = static_cast<juce::uint64>(stream.readInt64());
+                InputEntry entry;
+                entry.size = stream.readInt64();
+                entry.modified = stream.readInt64();
+                stream.read(entry.digest.data(), static_cast<int>(entry.digest.size()));
+                entries[pathHash] = entry;
+            }
+        }
+
+        const juce::File folder;
+        std::unordered_map<juce::uint64, InputEntry> inputs; // By hash of the full path, as read; not changed after
+        juce::CriticalSection lock;
+        std::unordered_map<juce::uint64, InputEntry> hashed; // This run's
+    };
+
+    class RenderCoordinator : private juce::Thread
+    {
+    public:
+        struct Job
+        {
+            juce::File input;
+            RenderCache::Key key; // Of the result
+            int attempts = 0;
+        };
+
+        RenderCoordinator(std::vector<Job> jobsToRun, const RenderSettings &renderSettings, juce::MemoryBlock settings, const RenderCache &resultCache,
+                          const juce::String &sharedToken, int timeoutSeconds, int workerWaitSeconds, int numLocalThreads)
+            : juce::Thread("Render coordinator"), jobs(std::move(jobsToRun)), localSettings(renderSettings), settingsData(std::move(settings)),
+              outputFolder(renderSettings.outputFolder), cache(resultCache), token(sharedToken), jobTimeoutMs(timeoutSeconds * 1000),
+              workerWaitMs(workerWaitSeconds * 1000.0), numLocalRenderers(numLocalThreads)
+        {
+            for (size_t i = 0; i < jobs.size(); ++i)
+                pending.push_back(i);
+
+            numUnfinished = static_cast<int>(jobs.size());
+        }
+
+        ~RenderCoordinator() override
+        {
+            stopThread(2000);
+
+            // Workers still connected are told there is nothing left
+            for (auto *connection : connections)
+                connection->stopThread(jobTimeoutMs + 2000);
+
+            // A file being rendered here can't be cut short
+            for (auto *renderer : localRenderers)
+                renderer->stopThread(-1);
+        }
+
+        bool start(int port, const juce::String &bindAddress)
+        {
+            if (!listener.createListener(port, bindAddress))
+                return false;
+
+            startThread();
+            return true;
+        }
+
+        // Returns the files that couldn't be rendered. Once no worker has been connected for
+        // --worker-wait, what is left is rendered here, alongside any that connect later.
+        int waitUntilFinished(double &totalSeconds)
+        {
+            const juce::ScopedLock sl(lock);
+            auto lastWorkerTime = juce::Time::getMillisecondCounterHiRes();
+
+            while (numUnfinished > 0)
+            {
+                auto now = juce::Time::getMillisecondCounterHiRes();
+
+                if (numWorkers > 0)
+                {
+                    lastWorkerTime = now;
+                }
+                else if (localRenderers.isEmpty() && now - lastWorkerTime > workerWaitMs)
+                {
+                    std::cout << "No workers for " << juce::roundToInt(workerWaitMs / 1000.0) << " s; rendering the " << numUnfinished
+                              << " files left here" << std::endl;
+
+                    for (int i = 0; i < numLocalRenderers; ++i)
+                        localRenderers.add(new LocalRenderer(*this))->startThread();
+                }
+
+                const juce::ScopedUnlock ul(lock);
+                jobFinished.wait(100);
+            }
+
+            totalSeconds = renderedSeconds;
+            return numFailed;
+        }
+
+    private:
+        class Connection : public juce::Thread
+        {
+        public:
+            Connection(RenderCoordinator &coordinator, juce::StreamingSocket *workerSocket)
+                : juce::Thread("Render worker " + workerSocket->getHostName()), owner(coordinator), socket(workerSocket)
+            {
+            }
+
+            void run() override
+            {
+                auto challenge = makeChallenge();
+                juce::MemoryBlock payload;
+                FrameType type;
+
+                if (!sendFrame(*socket, FrameType::challenge, challenge)
+                    || !receiveFrame(*socket, type, payload, handshakeTimeoutMs, static_cast<juce::int64>(challengeBytes))
+                    || type != FrameType::answer || !isRightAnswer(challenge, owner.token, payload))
+                {
+                    // Closed now, not with the coordinator, so the worker hears it was refused
+                    std::cerr << "Refused a worker at " << socket->getHostName() << " that didn't show the token" << std::endl;
+                    socket->close();
+                    return;
+                }
+
+                if (!sendFrame(*socket, FrameType::settings, owner.settingsData))
+                    return;
+
+                const WorkerCount count(owner);
+
+                size_t index;
+
+                while (owner.takeJob(index, *this))
+                {
+                    auto &job = owner.jobs[index];
+                    juce::MemoryBlock input;
+
+                    if (!job.input.loadFileAsData(input))
+                    {
+                        owner.finishJob(index, false);
+                        continue;
+                    }
+
+                    juce::MemoryOutputStream out;
+                    out.writeInt(static_cast<int>(index));
+                    out.writeString(job.input.getFileName());
+                    out << input;
+
+                    // A worker that can't be reached or gives no answer in time has its job
+                    // handed to another, and is dropped
+                    if (!sendFrame(*socket, FrameType::job, out.getMemoryBlock())
+                        || !receiveFrame(*socket, type, payload, owner.jobTimeoutMs) || type != FrameType::result)
+                    {
+                        owner.finishJob(index, false);
+                        return;
+                    }
+
+                    juce::MemoryInputStream in(payload, false);
+                    auto resultIndex = in.readInt();
+                    auto succeeded = in.readBool();
+                    auto seconds = in.readDouble();
+                    juce::MemoryBlock result;
+                    in.readIntoMemoryBlock(result);
+
+                    if (resultIndex != static_cast<int>(index))
+                    {
+                        owner.finishJob(index, false);
+                        return;
+                    }
+
+                    owner.finishJob(index, succeeded && owner.storeResult(job, result), seconds);
+                }
+
+                sendFrame(*socket, FrameType::finished, {});
+            }
+
+        private:
+            RenderCoordinator &owner;
+            std::unique_ptr<juce::StreamingSocket> socket;
+        };
+
+        // Counts a connection as a worker while it is taking jobs
+        struct WorkerCount
+        {
+            explicit WorkerCount(RenderCoordinator &coordinator) : owner(coordinator)
+            {
+                const juce::ScopedLock sl(owner.lock);
+                ++owner.numWorkers;
+            }
+
+            ~WorkerCount()
+            {
+                const juce::ScopedLock sl(owner.lock);
+                --owner.numWorkers;
+            }
+
+            RenderCoordinator &owner;
+
+            JUCE_DECLARE_NON_COPYABLE(WorkerCount)
+        };
+
+        // Takes jobs as a connection does, but renders them in this process
+        class LocalRenderer : public juce::Thread
+        {
+        public:
+            explicit LocalRenderer(RenderCoordinator &coordinator) : juce::Thread("Local renderer"), owner(coordinator) {}
+
+            void run() override
+            {
+                size_t index;
+
+                while (owner.takeJob(index, *this))
+                {
+                    auto &job = owner.jobs[index];
+                    auto outputFile = owner.outputFolder.getChildFile(job.input.getFileName());
+                    double seconds = 0.0;
+
+                    auto render = [&] { seconds = renderFile(job.input, owner.localSettings); return 0; };
+                    auto succeeded = juce::ConsoleApplication::invokeCatchingFailures(render) == 0 && owner.cache.store(job.key, outputFile);
+
+                    owner.finishJob(index, succeeded, seconds);
+                }
+            }
+
+        private:
+            RenderCoordinator &owner;
+        };
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                if (listener.waitUntilReady(true, 200) != 1)
+                    continue;
+
+                if (auto *client = listener.waitForNextConnection())
+                {
+                    const juce::ScopedLock sl(lock);
+                    connections.add(new Connection(*this, client))->startThread();
+                }
+            }
+
+            listener.close();
+        }
+
+        // False once every job is finished. Waits while the last ones are out, as any of
+        // them may come back to be run again.
+        bool takeJob(size_t &index, juce::Thread &connection)
+        {
+            const juce::ScopedLock sl(lock);
+
+            while (pending.empty())
+            {
+                if (numUnfinished == 0 || connection.threadShouldExit())
+                    return false;
+
+                const juce::ScopedUnlock ul(lock);
+                jobFinished.wait(100);
+            }
+
+            index = pending.front();
+            pending.pop_front();
+            ++jobs[index].attempts;
+            return true;
+        }
+
+        void finishJob(size_t index, bool succeeded, double seconds = 0.0)
+        {
+            {
+                const juce::ScopedLock sl(lock);
+                auto &job = jobs[index];
+
+                if (succeeded)
+                {
+                    renderedSeconds += seconds;
+                    --numUnfinished;
+                    std::cout << job.input.getFileName() << std::endl;
+                }
+                else if (job.attempts < maxJobAttempts)
+                {
+                    pending.push_back(index);
+                }
+                else
+                {
+                    ++numFailed;
+                    --numUnfinished;
+                    std::cerr << "Couldn't render " << job.input.getFullPathName() << " in " << maxJobAttempts << " attempts" << std::endl;
+                }
+            }
+
+            jobFinished.signal();
+        }
+
+        // Into the cache first, each through a temporary file, so neither is ever half written
+        bool storeResult(const Job &job, const juce::MemoryBlock &result)
+        {
+            juce::TemporaryFile temp(outputFolder.getChildFile(job.input.getFileName()));
+
+            return cache.store(job.key, result.getData(), result.getSize())
+                   && temp.getFile().replaceWithData(result.getData(), result.getSize()) && temp.overwriteTargetFileWithTemporary();
+        }
+
+        std::vector<Job> jobs;
+        const RenderSettings localSettings;
+        const juce::MemoryBlock settingsData;
+        const juce::File outputFolder;
+        const RenderCache &cache;
+        const juce::String token;
+        const int jobTimeoutMs;
+        const double workerWaitMs;
+        const int numLocalRenderers;
+
+        juce::CriticalSection lock;
+        juce::WaitableEvent jobFinished;
+        std::deque<size_t> pending;
+        int numUnfinished = 0;
+        int numFailed = 0;
+        int numWorkers = 0; // Connections past the handshake
+        double renderedSeconds = 0.0;
+
+        juce::StreamingSocket listener;
+        juce::OwnedArray<Connection> connections;
+        juce::OwnedArray<LocalRenderer> localRenderers;
+
+        JUCE_DECLARE_NON_COPYABLE(RenderCoordinator)
+    };
+
+    int runCoordinator(const juce::Array<juce::File> &inputs, const RenderSettings &settings, RenderCache &cache, bool reuseResults,
+                       int numThreads, int port, const juce::String &bindAddress, const juce::String &token, int jobTimeoutSeconds,
+                       int workerWaitSeconds)
+    {
+        auto settingsData = writeSettings(settings);
+
+        // Keys are taken numThreads files at a time, and files rendered before in these
+        // settings are copied from the cache as they are
+        enum class Outcome
+        {
+            unreadable,
+            reused,
+            toRender
+        };
+
+        std::vector<RenderCoordinator::Job> candidates(static_cast<size_t>(inputs.size()));
+        std::vector<Outcome> outcomes(candidates.size(), Outcome::unreadable);
+
+        {
+            juce::ThreadPool pool(numThreads);
+
+            for (size_t i = 0; i < candidates.size(); ++i)
+            {
+                pool.addJob([&, i]
+                            {
+                                auto &job = candidates[i];
+                                job.input = inputs[static_cast<int>(i)];
+
+                                if (!cache.getKey(settingsData, job.input, job.key))
+                                    return;
+
+                                auto reused = reuseResults && cache.restore(job.key, settings.outputFolder.getChildFile(job.input.getFileName()));
+                                outcomes[i] = reused ? Outcome::reused : Outcome::toRender;
+                            });
+            }
+
+            while (pool.getNumJobs() > 0)
+                juce::Thread::sleep(10);
+        }
+
+        std::vector<RenderCoordinator::Job> jobs;
+        int numReused = 0;
+
+        for (size_t i = 0; i < candidates.size(); ++i)
+        {
+            if (outcomes[i] == Outcome::unreadable)
+                juce::ConsoleApplication::fail("Couldn't read " + candidates[i].input.getFullPathName());
+
+            if (outcomes[i] == Outcome::reused)
+                ++numReused;
+            else
+                jobs.push_back(candidates[i]);
+        }
+
+        if (!cache.writeIndex())
+            std::cerr << "Couldn't update the index in " << cache.getFolder().getFullPathName() << std::endl;
+
+        auto numJobs = static_cast<int>(jobs.size());
+        RenderCoordinator coordinator(std::move(jobs), settings, settingsData, cache, token, jobTimeoutSeconds, workerWaitSeconds, numThreads);
+        auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+        if (numJobs > 0)
+        {
+            if (!coordinator.start(port, bindAddress))
+                juce::ConsoleApplication::fail("Couldn't listen on " + bindAddress + ":" + juce::String(port));
+
+            std::cout << numJobs << " files to render, " << numReused << " from earlier results; waiting for workers on " << bindAddress << ":"
+                      << port << std::endl;
+        }
+
+        double totalSeconds = 0.0;
+        auto numFailed = coordinator.waitUntilFinished(totalSeconds);
+        auto elapsed = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+        std::cout << inputs.size() - numFailed << " of " << inputs.size() << " files (" << numReused << " from earlier results), "
+                  << juce::String(totalSeconds, 1) << " s of MIDI in " << juce::String(elapsed, 2) << " s ("
+                  << juce::roundToInt(totalSeconds / juce::jmax(elapsed, 0.001)) << "x real time)" << std::endl;
+
+        return numFailed == 0 ? 0 : 1;
+    }
+
+    // One connection's worth of a worker: renders each file it is sent in a folder of its own
+    // and sends the result back. Returns the files rendered.
+    int runWorkerConnection(const juce::String &host, int port, const juce::String &token, const juce::File &scratchFolder)
+    {
+        juce::StreamingSocket socket;
+        auto connectUntil = juce::Time::getMillisecondCounterHiRes() + workerConnectSeconds * 1000.0;
+
+        // The coordinator may still be reading its files
+        while (!socket.connect(host, port, 2000))
+        {
+            if (juce::Time::getMillisecondCounterHiRes() > connectUntil)
+                juce::ConsoleApplication::fail("Couldn't connect to " + host + ":" + juce::String(port));
+
+            juce::Thread::sleep(500);
+        }
+
+        FrameType type;
+        juce::MemoryBlock payload;
+        RenderSettings settings;
+        auto coordinator = host + ":" + juce::String(port);
+
+        if (!receiveFrame(socket, type, payload, handshakeTimeoutMs) || type != FrameType::challenge
+            || !sendFrame(socket, FrameType::answer, answerChallenge(payload, token)))
+            juce::ConsoleApplication::fail("The coordinator at " + coordinator + " runs another version");
+
+        if (!receiveFrame(socket, type, payload) || type != FrameType::settings || !readSettings(payload, settings))
+            juce::ConsoleApplication::fail("The coordinator at " + coordinator + " refused the token, or runs another version");
+
+        auto inputFolder = scratchFolder.getChildFile("input");
+        settings.outputFolder = scratchFolder.getChildFile("output");
+
+        if (!inputFolder.createDirectory() || !settings.outputFolder.createDirectory())
+            juce::ConsoleApplication::fail("Couldn't create " + scratchFolder.getFullPathName());
+
+        int numRendered = 0;
+
+        while (receiveFrame(socket, type, payload) && type == FrameType::job)
+        {
+            juce::MemoryInputStream in(payload, false);
+            auto index = in.readInt();
+            auto name = juce::File::createLegalFileName(in.readString());
+            juce::MemoryBlock input;
+            in.readIntoMemoryBlock(input);
+
+            auto inputFile = inputFolder.getChildFile(name);
+            auto outputFile = settings.outputFolder.getChildFile(name);
+            double seconds = 0.0;
+            juce::MemoryBlock result;
+
+            auto succeeded = inputFile.replaceWithData(input.getData(), input.getSize())
+                             && juce::ConsoleApplication::invokeCatchingFailures([&] { seconds = renderFile(inputFile, settings); return 0; }) == 0
+                             && outputFile.loadFileAsData(result);
+
+            inputFile.deleteFile();
+            outputFile.deleteFile();
+
+            juce::MemoryOutputStream out;
+            out.writeInt(index);
+            out.writeBool(succeeded);
+            out.writeDouble(seconds);
+            out << result;
+
+            if (!sendFrame(socket, FrameType::result, out.getMemoryBlock()))
+                break;
+
+            numRendered += succeeded ? 1 : 0;
+        }
+
+        return numRendered;
+    }
+
+    int runWorker(const juce::String &address, const juce::String &token, int numThreads)
+    {
+        auto host = address.upToLastOccurrenceOf(":", false, false);
+        auto port = address.fromLastOccurrenceOf(":", false, false).getIntValue();
+
+        if (host.isEmpty() || port <= 0)
+            juce::ConsoleApplication::fail("--worker takes <host>:<port>");
+
+        auto scratchRoot = juce::File::createTempFile("render");
+        std::atomic<int> numRendered{0};
+        std::atomic<int> numFailed{0};
+
+        {
+            juce::ThreadPool pool(numThreads);
+
+            for (int i = 0; i < numThreads; ++i)
+            {
+                pool.addJob([&, i]
+                            {
+                                if (juce::ConsoleApplication::invokeCatchingFailures([&]
+                                    {
+                                        numRendered += runWorkerConnection(host, port, token, scratchRoot.getChildFile(juce::String(i)));
+                                        return 0;
+                                    }) != 0)
+                                    ++numFailed;
+                            });
+            }
+
+            while (pool.getNumJobs() > 0)
+                juce::Thread::sleep(10);
+        }
+
+        scratchRoot.deleteRecursively();
+        std::cout << numRendered << " files rendered for " << address << std::endl;
+        return numFailed == numThreads ? 1 : 0;
+    }
+
+    int run(const juce::ArgumentList &args)
+    {
+        RenderSettings settings;
+        settings.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile("rendered");
+        int numThreads = juce::SystemStats::getNumCpus();
+        juce::Array<juce::File> inputs;
+        int coordinatorPort = 0;
+        juce::String bindAddress = "127.0.0.1";
+        juce::String coordinatorAddress;
+        auto token = juce::SystemStats::getEnvironmentVariable("BCS_RENDER_TOKEN", {});
+        int jobTimeoutSeconds = 600;
+        int workerWaitSeconds = 60;
+        juce::File cacheFolder;
+        bool reuseResults = true;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto arg = args[i];
+            auto nextValue = [&]
+            {
+                if (i + 1 >= args.size())
+                    juce::ConsoleApplication::fail("Missing value for " + arg.text);
+                return args[++i];
+            };
+
+            if (arg == "--output")
+                settings.outputFolder = nextValue().resolveAsFile();
+            else if (arg == "--block-size")
+                settings.blockSize = juce::jlimit(1, 65536, nextValue().text.getIntValue());
+            else if (arg == "--sample-rate")
+                settings.sampleRate = juce::jlimit(8000.0, 768000.0, nextValue().text.getDoubleValue());
+            else if (arg == "--threads")
+                numThreads = juce::jmax(1, nextValue().text.getIntValue());
+            else if (arg == "--state")
+                nextValue().resolveAsExistingFile().loadFileAsData(settings.state);
+            else if (arg == "--trace")
+                settings.writeTrace = true;
+            else if (arg == "--log")
+                settings.logCategories = LogCategory::fromString(nextValue().text);
+            else if (arg == "--phase-trace")
+            {
+                if (!BCS_PHASE_TRACE)
+                    juce::ConsoleApplication::fail("--phase-trace needs a build with BCS_PHASE_TRACE=ON");
+
+                settings.writePhaseTrace = true;
+            }
+            else if (arg == "--non-realtime")
+                settings.nonRealtime = true;
+            else if (arg == "--segments")
+                settings.numSegments = juce::jlimit(1, 256, nextValue().text.getIntValue());
+            else if (arg == "--audio")
+            {
+                settings.audioFormat = nextValue().text.toLowerCase();
+
+                if (settings.audioFormat != "wav" && settings.audioFormat != "flac")
+                    juce::ConsoleApplication::fail("--audio takes wav or flac");
+            }
+            else if (arg == "--coordinator")
+                coordinatorPort = juce::jlimit(1, 65535, nextValue().text.getIntValue());
+            else if (arg == "--bind")
+                bindAddress = nextValue().text;
+            else if (arg == "--worker")
+                coordinatorAddress = nextValue().text;
+            else if (arg == "--token")
+                token = nextValue().text;
+            else if (arg == "--job-timeout")
+                jobTimeoutSeconds = juce::jmax(1, nextValue().text.getIntValue());
+            else if (arg == "--worker-wait")
+                workerWaitSeconds = juce::jmax(0, nextValue().text.getIntValue());
+            else if (arg == "--cache")
+                cacheFolder = nextValue().resolveAsFile();
+            else if (arg == "--no-reuse")
+                reuseResults = false;
+            else if (arg == "--set")
+            {
+                auto assignment = nextValue().text;
+                settings.parameterValues.set(assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                                             assignment.fromFirstOccurrenceOf("=", false, false).trim());
+            }
+            else if (arg.isOption())
+                juce::ConsoleApplication::fail("Unknown option " + arg.text);
+            else
+                addInputs(arg.resolveAsFile(), inputs);
+        }
+
+        if ((coordinatorPort > 0 || coordinatorAddress.isNotEmpty()) && token.isEmpty())
+            juce::ConsoleApplication::fail("--coordinator and --worker need the shared --token, or BCS_RENDER_TOKEN set");
+
+        // The coordinator's settings are the ones that count
+        if (coordinatorAddress.isNotEmpty())
+            return runWorker(coordinatorAddress, token, numThreads);
+
+        if (inputs.isEmpty())
+            juce::ConsoleApplication::fail("Usage: BetterChordStacksRender [options] <file.mid | folder>...");
+
+        // A segment's synth would start silent where the one before it was still sounding
+        if (settings.numSegments > 1 && (settings.writeTrace || settings.logCategories != 0 || settings.writePhaseTrace || settings.audioFormat.isNotEmpty()))
+            juce::ConsoleApplication::fail("--segments can't be combined with --trace, --log, --phase-trace or --audio");
+
+        // Workers send back only the MIDI
+        if (coordinatorPort > 0 && (settings.writeTrace || settings.logCategories != 0 || settings.writePhaseTrace || settings.audioFormat.isNotEmpty()))
+            juce::ConsoleApplication::fail("--coordinator can't be combined with --trace, --log, --phase-trace or --audio");
+
+        if (!settings.outputFolder.createDirectory())
+            juce::ConsoleApplication::fail("Couldn't create " + settings.outputFolder.getFullPathName());
+
+        // Only the MIDI is cached, so renders that write anything else always run
+        auto useCache = !(settings.writeTrace || settings.logCategories != 0 || settings.writePhaseTrace || settings.audioFormat.isNotEmpty());
+        RenderCache cache(cacheFolder == juce::File() ? settings.outputFolder.getChildFile(".results") : cacheFolder);
+
+        if (useCache && !cache.getFolder().createDirectory())
+            juce::ConsoleApplication::fail("Couldn't create " + cache.getFolder().getFullPathName());
+
+        if (coordinatorPort > 0)
+            return runCoordinator(inputs, settings, cache, reuseResults, numThreads, coordinatorPort, bindAddress, token, jobTimeoutSeconds,
+                                  workerWaitSeconds);
+
+        juce::TimeSliceThread audioWriterThread("Audio writer");
+
+        if (settings.audioFormat.isNotEmpty())
+        {
+            settings.parameterValues.set("previewSynth", "1");
+            settings.audioWriterThread = &audioWriterThread;
+            audioWriterThread.startThread();
+        }
+
+        juce::ThreadPool pool(numThreads);
+        juce::CriticalSection printLock;
+        std::atomic<int> numFailed{0};
+        std::atomic<int> numReused{0};
+        double totalSeconds = 0.0;
+        auto startTime = juce::Time::getMillisecondCounterHiRes();
+        auto settingsData = writeSettings(settings);
+
+        // Each file is hashed on the thread that would render it, alongside the others' renders
+        auto renderAndReport = [&](const juce::File &input)
+        {
+            RenderCache::Key key;
+            auto outputFile = settings.outputFolder.getChildFile(input.getFileName());
+            auto cached = useCache && cache.getKey(settingsData, input, key);
+
+            if (cached && reuseResults && cache.restore(key, outputFile))
+            {
+                ++numReused;
+                return 0;
+            }
+
+            auto seconds = renderFile(input, settings);
+
+            // A file that can't be cached is rendered again next time, nothing worse
+            if (cached && !cache.store(key, outputFile))
+                std::cerr << "Couldn't cache " << input.getFileName() << std::endl;
+
+            const juce::ScopedLock sl(printLock);
+            totalSeconds += seconds;
+            std::cout << input.getFileName() << std::endl;
+            return 0;
+        };
+
+        for (auto &input : inputs)
+        {
+            pool.addJob([&, input]
+                        {
+                            if (juce::ConsoleApplication::invokeCatchingFailures([&] { return renderAndReport(input); }) != 0)
+                                ++numFailed;
+                        });
+        }
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(10);
+
+        auto elapsed = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+        if (useCache && !cache.writeIndex())
+            std::cerr << "Couldn't update the index in " << cache.getFolder().getFullPathName() << std::endl;
+
+        std::cout << inputs.size() - numFailed << " of " << inputs.size() << " files (" << numReused << " from earlier results), "
+                  << juce::String(totalSeconds, 1) << " s of MIDI in " << juce::String(elapsed, 2) << " s ("
+                  << juce::roundToInt(totalSeconds / juce::jmax(elapsed, 0.001)) << "x real time)" << std::endl;
+
+        return numFailed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI init;
+    juce::ArgumentList args(argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return run(args); });
+}
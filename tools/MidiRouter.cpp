@@ -0,0 +1,797 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include <csignal>
+
+// MIDI router: runs PitchBendProcessor between a MIDI input and a MIDI output device, with
+// no audio device, so it can sit between a controller and a hardware synth.
+//
+//   BetterChordStacksRouter --list
+//   BetterChordStacksRouter --input <name> --output <name> [--output <name>...] [options]
+//
+//   --input <name>         Input device, by name, part of its name, or number from --list,
+//                          or udp:[<address>:]<port> to listen on a UDP port
+//   --output <name>        Output device, likewise, or udp:<host>:<port> to send to a UDP
+//                          address; may be repeated, the first being port 1
+//   --route <ch>=<port>[:<ch>]
+//                          Send what the processor outputs on channel ch to that port,
+//                          on the given channel or the same one; may be repeated. Channels
+//                          not routed go to port 1 unchanged.
+//   --sample-rate <hz>     Rate of the processor's sample clock (default: 48000)
+//   --state <file>         Plugin state to load first, as saved by the plugin
+//   --set <id>=<value>     Set a parameter by ID to a real value; may be repeated
+//   --lookahead <ms>       Constant output delay that lets every event go out at its own
+//                          sample time instead of when its block was processed (default: 0)
+//   --metrics <port>       Serve counters in the Prometheus text format at
+//                          http://<host>:<port>/metrics
+//
+// Each incoming message is processed at once on the input device's callback thread, as the
+// last sample of a block that covers the time since the previous one. Between messages a
+// high-resolution timer processes the time since the last block at the update rate, so
+// bends move on with no input. The processor's sample clock follows the wall clock, so bend
+// and strum times mean what they do in a host.
+//
+// With no lookahead each block's output is sent as soon as it is made, late by up to one
+// timer interval. With a lookahead the blocks are handed to the output's own thread with
+// their start time, and every event leaves exactly that long after its sample. Runs until
+// interrupted, then ends every voice.
+//
+// Routing is by output channel, which in MPE output is the voice's slot, so chord voices can
+// be split over several mono synths: --route 2=1:1 --route 3=2:1 --route 4=3:1 plays the
+// first three member channels on three synths that each listen on channel 1. System messages
+// go to port 1.
+//
+// Over the network each datagram carries whole MIDI messages back to back, running status
+// allowed, with no header: the lean framing of most UDP MIDI bridges, and what one router's
+// network output sends another's input (udp:5004 listens on the RTP-MIDI data port). There
+// is no session or journal, so on a lossy network a lost note-off hangs its note. A socket
+// thread reads datagrams and processes the messages in each as one block, like the messages
+// from an input device; an output sends each block as one datagram, so a tick's bends for
+// every voice travel together, as soon as they are made, whatever the lookahead.
+//
+// The threads that process blocks, the tick timer's and the network input's, run at real-time
+// priority where the OS allows it. There is no audio device, so no audio workgroup for them
+// to join; hosts and the Standalone app pass theirs to the processor's own workers instead.
+//
+// The metrics endpoint runs on a low-priority thread of its own and only loads atomics, so
+// a scrape never holds up a block. It reports the processor's voices, bends, steals, dropped
+// and coalesced messages and load, and the router's ticks, a histogram of how long each took
+// from its callback to its output being sent, that histogram's 99th percentile, and errors
+// on the network ports. Device outputs report no errors to count.
+
+namespace
+{
+    std::atomic<bool> stopRequested{false};
+
+    // Where one output channel goes, fixed before the router starts
+    struct Route
+    {
+        int port = 0;
+        int channel = 0; // 0 to 15
+    };
+
+    using RoutingTable = std::array<Route, 16>;
+
+    // What the router reports about itself, updated by the threads doing the work and read by
+    // the metrics endpoint
+    struct RouterStats
+    {
+        // Bin 0 holds ticks up to 16 us and every bin after it doubles, up to the last one,
+        // which holds everything slower
+        static constexpr int numBins = 12;
+        static double getBinUpperEdge(int bin) { return 16.0e-6 * static_cast<double>(1 << bin); }
+
+        void registerTick(double seconds)
+        {
+            int bin = 0;
+            while (bin < numBins - 1 && seconds > getBinUpperEdge(bin))
+                ++bin;
+
+            ticks.fetch_add(1, std::memory_order_relaxed);
+            tickNanoseconds.fetch_add(static_cast<juce::uint64>(seconds * 1.0e9), std::memory_order_relaxed);
+            tickHistogram[static_cast<size_t>(bin)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::atomic<juce::uint64> ticks{0};
+        std::atomic<juce::uint64> tickNanoseconds{0};
+        std::array<std::atomic<juce::uint64>, numBins> tickHistogram{};
+        std::atomic<juce::uint64> portErrors{0};
+    };
+
+    // Device identifiers of the form udp:[<host>:]<port> name a socket instead of a device
+    bool isNetworkAddress(const juce::String &identifier) { return identifier.startsWithIgnoreCase("udp:"); }
+    juce::String networkHost(const juce::String &identifier)
+    {
+        auto address = identifier.substring(4);
+        return address.containsChar(':') ? address.upToLastOccurrenceOf(":", false, false) : juce::String();
+    }
+
+    int networkPort(const juce::String &identifier) { return identifier.fromLastOccurrenceOf(":", false, false).getIntValue(); }
+
+    // MIDI from a UDP port, on a thread of its own that hands each datagram's messages to the
+    // handler together, in order
+    class NetworkInput : private juce::Thread
+    {
+    public:
+        using Handler = std::function<void(const juce::MidiMessage *messages, int numMessages)>;
+
+        NetworkInput(Handler handlerToUse, std::atomic<juce::uint64> &errorCount)
+            : juce::Thread("Network MIDI input"), handler(std::move(handlerToUse)), errors(errorCount)
+        {
+            messages.reserve(packet.size() / 2);
+        }
+
+        ~NetworkInput() override { stop(); }
+
+        bool open(const juce::String &address, int port)
+        {
+            return address.isEmpty() ? socket.bindToPort(port) : socket.bindToPort(port, address);
+        }
+
+        // It runs the processor, so it is real time wherever the OS grants that, as the tick
+        // timer's thread is; otherwise the highest ordinary priority
+        void start()
+        {
+            if (!startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(9).withProcessingTimeMs(1.0)))
+                startThread(juce::Thread::Priority::highest);
+        }
+
+        void stop()
+        {
+            signalThreadShouldExit();
+            socket.shutdown();
+            stopThread(1000);
+        }
+
+    private:
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                auto ready = socket.waitUntilReady(true, 100);
+
+                if (ready < 0)
+                {
+                    if (!threadShouldExit())
+                        errors.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+
+                if (ready == 0)
+                    continue;
+
+                auto size = socket.read(packet.data(), static_cast<int>(packet.size()), false);
+
+                if (size < 0)
+                    errors.fetch_add(1, std::memory_order_relaxed);
+                else if (size > 0)
+                {
+                    parse(size);
+
+                    if (!messages.empty())
+                        handler(messages.data(), static_cast<int>(messages.size()));
+                }
+            }
+        }
+
+        // Data bytes with no status to run on, and anything cut off at the end, are dropped
+        void parse(int size)
+        {
+            messages.clear();
+            juce::uint8 runningStatus = 0;
+
+            for (int position = 0; position < size;)
+            {
+                if (packet[static_cast<size_t>(position)] < 0x80 && runningStatus == 0)
+                {
+                    ++position;
+                    continue;
+                }
+
+                int numBytesUsed = 0;
+                juce::MidiMessage message(packet.data() + position, size - position, numBytesUsed, runningStatus, 0.0, false);
+
+                if (numBytesUsed <= 0)
+                    break;
+
+                position += numBytesUsed;
+                auto status = message.getRawData()[0];
+
+                if (status < 0xf0)
+                    runningStatus = status;
+                else if (status < 0xf8)
+                    runningStatus = 0;
+
+                messages.push_back(std::move(message));
+            }
+        }
+
+        Handler handler;
+        std::atomic<juce::uint64> &errors;
+        juce::DatagramSocket socket;
+        std::array<juce::uint8, 65536> packet{};
+        std::vector<juce::MidiMessage> messages;
+
+        JUCE_DECLARE_NON_COPYABLE(NetworkInput)
+    };
+
+    // MIDI to a UDP address, one datagram per block, split only where a block outgrows one
+    class NetworkOutput
+    {
+    public:
+        NetworkOutput(const juce::String &hostToUse, int portToUse, std::atomic<juce::uint64> &errorCount)
+            : host(hostToUse), port(portToUse), errors(errorCount)
+        {
+            packet.reserve(maxDatagramSize);
+        }
+
+        void send(const juce::MidiBuffer &block)
+        {
+            packet.clear();
+
+            for (const auto metadata : block)
+            {
+                if (!packet.empty() && packet.size() + static_cast<size_t>(metadata.numBytes) > maxDatagramSize)
+                    flush();
+
+                packet.insert(packet.end(), metadata.data, metadata.data + metadata.numBytes);
+            }
+
+            flush();
+        }
+
+    private:
+        void flush()
+        {
+            if (!packet.empty() && socket.write(host, port, packet.data(), static_cast<int>(packet.size())) < 0)
+                errors.fetch_add(1, std::memory_order_relaxed);
+
+            packet.clear();
+        }
+
+        // Under the usual Ethernet MTU, so a block is never fragmented in the network
+        static constexpr size_t maxDatagramSize = 1400;
+
+        juce::String host;
+        int port;
+        std::atomic<juce::uint64> &errors;
+        juce::DatagramSocket socket;
+        std::vector<juce::uint8> packet;
+
+        JUCE_DECLARE_NON_COPYABLE(NetworkOutput)
+    };
+
+    // One output port: a MIDI device or a UDP address
+    struct OutputPort
+    {
+        std::unique_ptr<juce::MidiOutput> device;
+        std::unique_ptr<NetworkOutput> network;
+
+        bool isOpen() const { return device != nullptr || network != nullptr; }
+    };
+
+    class Router : private juce::MidiInputCallback,
+                   private juce::HighResolutionTimer
+    {
+    public:
+        Router(PitchBendProcessor &processorToUse, double rate, double lookahead, const RoutingTable &routingTable)
+            : processor(processorToUse), sampleRate(rate), lookaheadMs(lookahead), routes(routingTable)
+        {
+            processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor.prepareToPlay(sampleRate, blockSize);
+            midi.ensureSize(65536);
+
+            for (int channel = 0; channel < 16; ++channel)
+                identityRouting = identityRouting && routes[static_cast<size_t>(channel)].port == 0 && routes[static_cast<size_t>(channel)].channel == channel;
+        }
+
+        ~Router() override { stopTimer(); }
+
+        bool open(const juce::MidiDeviceInfo &inputInfo, const juce::Array<juce::MidiDeviceInfo> &outputInfos)
+        {
+            for (auto &info : outputInfos)
+            {
+                auto &port = outputs.emplace_back();
+                portMidi.emplace_back().ensureSize(65536);
+
+                if (isNetworkAddress(info.identifier))
+                {
+                    port.network = std::make_unique<NetworkOutput>(networkHost(info.identifier), networkPort(info.identifier), stats.portErrors);
+                    continue;
+                }
+
+                port.device = juce::MidiOutput::openDevice(info.identifier);
+
+                if (port.device == nullptr)
+                    return false;
+
+                if (lookaheadMs > 0.0)
+                    port.device->startBackgroundThread();
+            }
+
+            if (isNetworkAddress(inputInfo.identifier))
+            {
+                networkInput = std::make_unique<NetworkInput>([this](const juce::MidiMessage *messages, int numMessages)
+                                                              { processUntilNow(messages, numMessages); },
+                                                              stats.portErrors);
+
+                if (!networkInput->open(networkHost(inputInfo.identifier), networkPort(inputInfo.identifier)))
+                    return false;
+            }
+            else
+            {
+                input = juce::MidiInput::openDevice(inputInfo.identifier, this);
+
+                if (input == nullptr)
+                    return false;
+            }
+
+            startMs = juce::Time::getMillisecondCounterHiRes();
+            startTimer(tickInterval());
+
+            if (networkInput != nullptr)
+                networkInput->start();
+            else
+                input->start();
+
+            return true;
+        }
+
+        const RouterStats &getStats() const { return stats; }
+
+        // Ends every voice, with the input and the timer already stopped
+        void close()
+        {
+            if (input != nullptr)
+                input->stop();
+
+            if (networkInput != nullptr)
+                networkInput->stop();
+
+            stopTimer();
+
+            const juce::ScopedLock sl(processLock);
+
+            if (!outputs.empty() && outputs.back().isOpen())
+            {
+                juce::AudioBuffer<float> bypassBuffer(0, 1);
+                midi.clear();
+                processor.processBlockBypassed(bypassBuffer, midi);
+
+                for (auto &output : outputs)
+                {
+                    if (output.device != nullptr)
+                    {
+                        output.device->clearAllPendingMessages();
+                        output.device->stopBackgroundThread();
+                    }
+                }
+
+                lookaheadMs = 0.0;
+                send(midi, 0);
+            }
+
+            processor.releaseResources();
+        }
+
+    private:
+        void handleIncomingMidiMessage(juce::MidiInput *, const juce::MidiMessage &message) override
+        {
+            processUntilNow(&message, 1);
+        }
+
+        void hiResTimerCallback() override
+        {
+            processUntilNow(nullptr, 0);
+
+            // Follows the update rate as it is changed
+            if (auto interval = tickInterval(); interval != getTimerInterval())
+                startTimer(interval);
+        }
+
+        int tickInterval() const { return juce::jmax(1, juce::roundToInt(processor.updateRate->get())); }
+
+        // One block from the end of the last one up to now, with the messages, if any, on its
+        // last sample in order. At least one sample long, so messages arriving one after the
+        // other keep their order.
+        void processUntilNow(const juce::MidiMessage *messages, int numMessages)
+        {
+            auto callbackTicks = juce::Time::getHighResolutionTicks();
+            const juce::ScopedLock sl(processLock);
+
+            auto now = static_cast<juce::int64>((juce::Time::getMillisecondCounterHiRes() - startMs) * sampleRate / 1000.0);
+
+            if (numMessages == 0 && now <= sampleClock)
+                return;
+
+            auto blockStart = sampleClock;
+            auto numSamples = static_cast<int>(juce::jlimit<juce::int64>(1, maxCatchUpSamples, now - sampleClock));
+            sampleClock = juce::jmax(sampleClock + numSamples, now);
+
+            midi.clear();
+            for (int i = 0; i < numMessages; ++i)
+                midi.addEvent(messages[i], numSamples - 1);
+
+            buffer.setSize(0, numSamples, false, false, true);
+            processor.processBlock(buffer, midi);
+
+            if (!midi.isEmpty())
+                send(midi, blockStart);
+
+            stats.registerTick(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - callbackTicks));
+        }
+
+        // Splits a block over the ports by the routing table, one lookup per channel message
+        void send(const juce::MidiBuffer &block, juce::int64 blockStart)
+        {
+            if (identityRouting)
+            {
+                sendToPort(0, block, blockStart);
+                return;
+            }
+
+            for (auto &portBuffer : portMidi)
+                portBuffer.clear();
+
+            for (const auto metadata : block)
+            {
+                if (metadata.data[0] >= 0xf0)
+                {
+                    portMidi.front().addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+                    continue;
+                }
+
+                const auto &route = routes[static_cast<size_t>(metadata.data[0] & 0x0f)];
+                juce::uint8 data[3] = {static_cast<juce::uint8>((metadata.data[0] & 0xf0) | route.channel)};
+                std::copy(metadata.data + 1, metadata.data + juce::jmin(metadata.numBytes, 3), data + 1);
+
+                portMidi[static_cast<size_t>(route.port)].addEvent(data, juce::jmin(metadata.numBytes, 3), metadata.samplePosition);
+            }
+
+            for (size_t port = 0; port < outputs.size(); ++port)
+                if (!portMidi[port].isEmpty())
+                    sendToPort(port, portMidi[port], blockStart);
+        }
+
+        // Everything up to the last sample is already due; with a lookahead it goes out that
+        // much later, on its own sample's time. A network port has no clock to send against.
+        void sendToPort(size_t port, const juce::MidiBuffer &block, juce::int64 blockStart)
+        {
+            if (outputs[port].network != nullptr)
+            {
+                outputs[port].network->send(block);
+                return;
+            }
+
+            auto &output = *outputs[port].device;
+
+            if (lookaheadMs > 0.0)
+                output.sendBlockOfMessages(block, startMs + static_cast<double>(blockStart) * 1000.0 / sampleRate + lookaheadMs, sampleRate);
+            else
+                output.sendBlockOfMessagesNow(block);
+        }
+
+        static constexpr int blockSize = 512;
+
+        // A block after a stall, when the timer was held up, doesn't render the whole stall;
+        // the bends a voice would have sent meanwhile collapse into this much
+        static constexpr juce::int64 maxCatchUpSamples = 4 * blockSize;
+
+        PitchBendProcessor &processor;
+        double sampleRate;
+        double lookaheadMs;
+        RoutingTable routes;
+        RouterStats stats;
+        bool identityRouting = true;
+        double startMs = 0.0;
+        juce::int64 sampleClock = 0;
+
+        juce::CriticalSection processLock;
+        juce::AudioBuffer<float> buffer{0, blockSize};
+        juce::MidiBuffer midi;
+
+        std::unique_ptr<juce::MidiInput> input;
+        std::unique_ptr<NetworkInput> networkInput;
+        std::vector<OutputPort> outputs;
+        std::vector<juce::MidiBuffer> portMidi;
+
+        JUCE_DECLARE_NON_COPYABLE(Router)
+    };
+
+    // Prometheus text exposition over plain HTTP, one request per connection. Anything but
+    // GET /metrics is answered 404.
+    class MetricsServer : private juce::Thread
+    {
+    public:
+        MetricsServer(PitchBendProcessor &processorToRead, const RouterStats &statsToRead)
+            : juce::Thread("Metrics"), processor(processorToRead), loadMonitor(processorToRead.getLoadMonitor()), stats(statsToRead)
+        {
+        }
+
+        ~MetricsServer() override { stopThread(2000); }
+
+        bool start(int port)
+        {
+            if (!listener.createListener(port))
+                return false;
+
+            startThread(juce::Thread::Priority::background);
+            return true;
+        }
+
+    private:
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                if (listener.waitUntilReady(true, 200) != 1)
+                    continue;
+
+                if (std::unique_ptr<juce::StreamingSocket> client{listener.waitForNextConnection()})
+                    respond(*client);
+            }
+
+            listener.close();
+        }
+
+        void respond(juce::StreamingSocket &client)
+        {
+            char request[1024] = {};
+
+            if (client.waitUntilReady(true, 1000) != 1 || client.read(request, sizeof(request) - 1, false) <= 0)
+                return;
+
+            auto isMetrics = juce::String(request).startsWith("GET /metrics ") || juce::String(request).startsWith("GET /metrics?");
+            auto body = isMetrics ? exposition() : juce::String("Not found\n");
+            auto response = juce::String(isMetrics ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n")
+                          + (isMetrics ? "Content-Type: text/plain; version=0.0.4\r\n" : "Content-Type: text/plain\r\n")
+                          + "Content-Length: " + juce::String(body.getNumBytesAsUTF8()) + "\r\n"
+                          + "Connection: close\r\n\r\n" + body;
+
+            client.write(response.toRawUTF8(), static_cast<int>(response.getNumBytesAsUTF8()));
+        }
+
+        juce::String exposition() const
+        {
+            juce::String text;
+
+            auto metric = [&](const char *name, const char *type, const char *help, const juce::String &value)
+            {
+                text << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n"
+                     << name << " " << value << "\n";
+            };
+
+            metric("bcs_active_voices", "gauge", "Voices sounding", juce::String(processor.getActiveVoiceCount()));
+            metric("bcs_bends_sent_total", "counter", "Pitch bends sent", juce::String(processor.getBendsSentCount()));
+            metric("bcs_coalesced_bends_total", "counter", "Bends held back by the bandwidth budget and carried by a later one", juce::String(processor.getCoalescedBendCount()));
+            metric("bcs_dropped_bends_total", "counter", "Bends held back by the bandwidth budget until their voice ended", juce::String(processor.getDroppedBendCount()));
+            metric("bcs_coalesced_messages_total", "counter", "Outgoing messages removed by output coalescing", juce::String(processor.getSavedMessageCount()));
+            metric("bcs_dropped_notes_total", "counter", "Notes that found no free channel", juce::String(processor.getDroppedNoteCount()));
+            metric("bcs_dropped_input_total", "counter", "Input events past what a split block can hold", juce::String(processor.getDroppedInputCount()));
+            metric("bcs_steals_total", "counter", "Voices stolen for new notes", juce::String(processor.getStealCount()));
+            metric("bcs_dsp_load", "gauge", "Processing time over real time, smoothed", juce::String(loadMonitor.getLoad(), 4));
+            metric("bcs_overruns_total", "counter", "Blocks that took longer than the time they cover", juce::String(loadMonitor.getOverrunCount()));
+            metric("bcs_router_port_errors_total", "counter", "Failed reads and writes on network ports", juce::String(stats.portErrors.load(std::memory_order_relaxed)));
+
+            // Bins read one by one, so the count is their sum rather than the tick counter,
+            // which may have moved on
+            std::array<juce::uint64, RouterStats::numBins> bins;
+            juce::uint64 count = 0;
+
+            for (size_t bin = 0; bin < bins.size(); ++bin)
+                count += (bins[bin] = stats.tickHistogram[bin].load(std::memory_order_relaxed));
+
+            text << "# HELP bcs_router_tick_seconds Time from a tick's callback to its output being sent\n"
+                 << "# TYPE bcs_router_tick_seconds histogram\n";
+
+            juce::uint64 cumulative = 0;
+            juce::String p99 = "0";
+            bool foundP99 = false;
+
+            for (int bin = 0; bin < RouterStats::numBins; ++bin)
+            {
+                cumulative += bins[static_cast<size_t>(bin)];
+                auto edge = bin == RouterStats::numBins - 1 ? juce::String("+Inf") : juce::String(RouterStats::getBinUpperEdge(bin), 6);
+
+                text << "bcs_router_tick_seconds_bucket{le=\"" << edge << "\"} " << juce::String(cumulative) << "\n";
+
+                if (!foundP99 && count > 0 && static_cast<double>(cumulative) >= 0.99 * static_cast<double>(count))
+                {
+                    p99 = edge;
+                    foundP99 = true;
+                }
+            }
+
+            text << "bcs_router_tick_seconds_sum " << juce::String(static_cast<double>(stats.tickNanoseconds.load(std::memory_order_relaxed)) * 1.0e-9, 6) << "\n"
+                 << "bcs_router_tick_seconds_count " << juce::String(count) << "\n";
+
+            metric("bcs_router_tick_seconds_p99", "gauge", "Upper edge of the histogram bin holding the 99th percentile tick", p99);
+            metric("bcs_router_ticks_total", "counter", "Blocks processed", juce::String(stats.ticks.load(std::memory_order_relaxed)));
+            return text;
+        }
+
+        const PitchBendProcessor &processor;
+        const LoadMonitor &loadMonitor;
+        const RouterStats &stats;
+        juce::StreamingSocket listener;
+
+        JUCE_DECLARE_NON_COPYABLE(MetricsServer)
+    };
+
+    // By number from --list, exact name, or the first name containing it. A UDP address is
+    // passed on as it is, with needsHost for an output, which has to know where to send.
+    juce::MidiDeviceInfo findDevice(const juce::Array<juce::MidiDeviceInfo> &devices, const juce::String &name, bool needsHost)
+    {
+        if (isNetworkAddress(name))
+        {
+            if (networkPort(name) < 1 || networkPort(name) > 65535 || (needsHost && networkHost(name).isEmpty()))
+                juce::ConsoleApplication::fail("Bad network address " + name);
+
+            return {name, name};
+        }
+
+        if (name.containsOnly("0123456789") && juce::isPositiveAndBelow(name.getIntValue(), devices.size()))
+            return devices[name.getIntValue()];
+
+        for (auto &device : devices)
+            if (device.name == name)
+                return device;
+
+        for (auto &device : devices)
+            if (device.name.containsIgnoreCase(name))
+                return device;
+
+        juce::ConsoleApplication::fail("No MIDI device matches " + name);
+        return {};
+    }
+
+    void listDevices()
+    {
+        auto print = [](const char *heading, const juce::Array<juce::MidiDeviceInfo> &devices)
+        {
+            std::cout << heading << std::endl;
+            for (int i = 0; i < devices.size(); ++i)
+                std::cout << "  " << i << ": " << devices[i].name << std::endl;
+        };
+
+        print("Inputs:", juce::MidiInput::getAvailableDevices());
+        print("Outputs:", juce::MidiOutput::getAvailableDevices());
+    }
+
+    // Polls for an interrupt on the message thread, where the dispatch loop can be stopped
+    class StopPoller : private juce::Timer
+    {
+    public:
+        StopPoller() { startTimer(50); }
+
+    private:
+        void timerCallback() override
+        {
+            if (stopRequested)
+                juce::MessageManager::getInstance()->stopDispatchLoop();
+        }
+    };
+
+    int run(const juce::ArgumentList &args)
+    {
+        juce::String inputName;
+        juce::StringArray outputNames, routeArgs;
+        double sampleRate = 48000.0;
+        double lookaheadMs = 0.0;
+        int metricsPort = 0;
+        juce::MemoryBlock state;
+        juce::StringPairArray parameterValues;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto arg = args[i];
+            auto nextValue = [&]
+            {
+                if (i + 1 >= args.size())
+                    juce::ConsoleApplication::fail("Missing value for " + arg.text);
+                return args[++i];
+            };
+
+            if (arg == "--list")
+            {
+                listDevices();
+                return 0;
+            }
+
+            if (arg == "--input")
+                inputName = nextValue().text;
+            else if (arg == "--output")
+                outputNames.add(nextValue().text);
+            else if (arg == "--route")
+                routeArgs.add(nextValue().text);
+            else if (arg == "--sample-rate")
+                sampleRate = juce::jlimit(8000.0, 768000.0, nextValue().text.getDoubleValue());
+            else if (arg == "--lookahead")
+                lookaheadMs = juce::jlimit(0.0, 100.0, nextValue().text.getDoubleValue());
+            else if (arg == "--metrics")
+                metricsPort = juce::jlimit(0, 65535, nextValue().text.getIntValue());
+            else if (arg == "--state")
+                nextValue().resolveAsExistingFile().loadFileAsData(state);
+            else if (arg == "--set")
+            {
+                auto assignment = nextValue().text;
+                parameterValues.set(assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                                    assignment.fromFirstOccurrenceOf("=", false, false).trim());
+            }
+            else
+                juce::ConsoleApplication::fail("Unknown option " + arg.text);
+        }
+
+        if (inputName.isEmpty() || outputNames.isEmpty())
+            juce::ConsoleApplication::fail("Usage: BetterChordStacksRouter --input <name> --output <name> [options]");
+
+        auto inputInfo = findDevice(juce::MidiInput::getAvailableDevices(), inputName, false);
+        juce::Array<juce::MidiDeviceInfo> outputInfos;
+
+        for (auto &name : outputNames)
+            outputInfos.add(findDevice(juce::MidiOutput::getAvailableDevices(), name, true));
+
+        RoutingTable routes;
+        for (int channel = 0; channel < 16; ++channel)
+            routes[static_cast<size_t>(channel)] = {0, channel};
+
+        for (auto &route : routeArgs)
+        {
+            auto from = route.upToFirstOccurrenceOf("=", false, false).getIntValue();
+            auto target = route.fromFirstOccurrenceOf("=", false, false);
+            auto port = target.upToFirstOccurrenceOf(":", false, false).getIntValue();
+            auto to = target.containsChar(':') ? target.fromFirstOccurrenceOf(":", false, false).getIntValue() : from;
+
+            if (from < 1 || from > 16 || to < 1 || to > 16 || port < 1 || port > outputInfos.size())
+                juce::ConsoleApplication::fail("Bad route " + route);
+
+            routes[static_cast<size_t>(from - 1)] = {port - 1, to - 1};
+        }
+
+        PitchBendProcessor processor;
+
+        if (state.getSize() > 0)
+            processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+
+        for (auto &id : parameterValues.getAllKeys())
+        {
+            if (auto *parameter = processor.parameters.getParameter(id))
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(parameterValues[id].getFloatValue()));
+            else
+                juce::ConsoleApplication::fail("Unknown parameter " + id);
+        }
+
+        Router router(processor, sampleRate, lookaheadMs, routes);
+        MetricsServer metrics(processor, router.getStats());
+
+        if (metricsPort > 0 && !metrics.start(metricsPort))
+            juce::ConsoleApplication::fail("Couldn't listen on port " + juce::String(metricsPort));
+
+        juce::StringArray outputList;
+
+        for (auto &info : outputInfos)
+            outputList.add(info.name);
+
+        if (!router.open(inputInfo, outputInfos))
+            juce::ConsoleApplication::fail("Couldn't open " + inputInfo.name + " and " + outputList.joinIntoString(", "));
+
+        std::cout << inputInfo.name << " -> " << outputList.joinIntoString(", ") << ", interrupt to stop" << std::endl;
+
+        std::signal(SIGINT, [](int) { stopRequested = true; });
+        std::signal(SIGTERM, [](int) { stopRequested = true; });
+
+        // The processor's timer copies presets into the parameters, so the message thread runs
+        StopPoller poller;
+        juce::MessageManager::getInstance()->runDispatchLoop();
+
+        router.close();
+        return 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI init;
+    juce::ArgumentList args(argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return run(args); });
+}
@@ -0,0 +1,102 @@
+#include <JuceHeader.h>
+#include "TraceRecorder.h"
+
+// Compares two output traces event by event, as written by the processor's trace
+// recorder (BetterChordStacksRender --trace).
+//
+//   BetterChordStacksTraceDiff [--max-differences <n>] <expected.trace> <actual.trace>
+//
+// Prints the first differences and exits with 0 if the traces are identical, 1 if they
+// differ or either one has a gap from dropped events.
+
+namespace
+{
+    juce::String describe(const TraceEvent &event)
+    {
+        static const char *const kindNames[] = {"midi", "ump", "long", "gap"};
+
+        if (event.kind == TraceEvent::gap)
+            return "gap of " + juce::String(event.sample) + " dropped events";
+
+        return "sample " + juce::String(event.sample) + " " + kindNames[event.kind] + " "
+               + juce::String::toHexString(event.data.data(), event.size);
+    }
+
+    int countGaps(const std::vector<TraceEvent> &events)
+    {
+        return static_cast<int>(std::count_if(events.begin(), events.end(),
+                                              [](const TraceEvent &event) { return event.kind == TraceEvent::gap; }));
+    }
+
+    int run(const juce::ArgumentList &args)
+    {
+        int maxDifferences = 10;
+        juce::Array<juce::File> files;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            auto arg = args[i];
+
+            if (arg == "--max-differences")
+            {
+                if (i + 1 >= args.size())
+                    juce::ConsoleApplication::fail("Missing value for " + arg.text);
+
+                maxDifferences = juce::jmax(0, args[++i].text.getIntValue());
+            }
+            else if (arg.isOption())
+                juce::ConsoleApplication::fail("Unknown option " + arg.text);
+            else
+                files.add(arg.resolveAsExistingFile());
+        }
+
+        if (files.size() != 2)
+            juce::ConsoleApplication::fail("Usage: BetterChordStacksTraceDiff [--max-differences <n>] <expected.trace> <actual.trace>");
+
+        std::vector<TraceEvent> expected, actual;
+
+        if (!TraceRecorder::readTrace(files[0], expected))
+            juce::ConsoleApplication::fail("Not a trace file: " + files[0].getFullPathName());
+
+        if (!TraceRecorder::readTrace(files[1], actual))
+            juce::ConsoleApplication::fail("Not a trace file: " + files[1].getFullPathName());
+
+        // Matched by index: after an insertion everything following differs, so only the first
+        // few are worth printing
+        auto numCompared = juce::jmin(expected.size(), actual.size());
+        int numDifferences = 0;
+
+        for (size_t i = 0; i < numCompared; ++i)
+        {
+            if (expected[i] == actual[i])
+                continue;
+
+            if (numDifferences++ < maxDifferences)
+                std::cout << "event " << i << ":\n  - " << describe(expected[i]) << "\n  + " << describe(actual[i]) << std::endl;
+        }
+
+        if (expected.size() != actual.size())
+            std::cout << "event count: " << expected.size() << " expected, " << actual.size() << " actual" << std::endl;
+
+        auto numGaps = countGaps(expected) + countGaps(actual);
+
+        if (numGaps > 0)
+            std::cout << numGaps << " gaps from dropped events; the traces are incomplete" << std::endl;
+
+        if (numDifferences == 0 && expected.size() == actual.size() && numGaps == 0)
+        {
+            std::cout << "identical, " << expected.size() << " events" << std::endl;
+            return 0;
+        }
+
+        std::cout << numDifferences << " of " << numCompared << " events differ" << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return run(args); });
+}